@@ -486,7 +486,7 @@ struct posix_files_if {
     int (*read)(struct posix_file* file, void* data, int64_t bytes, int64_t *transferred);
     int (*write)(struct posix_file* file, const void* data, int64_t bytes, int64_t *transferred);
     int (*flush)(struct posix_file* file);
-    void    (*close)(struct posix_file* file);
+    int (*close)(struct posix_file* file); // write errors may surface here
     int (*write_fully)(const char* filename, const void* data,
                            int64_t bytes, int64_t *transferred);
     bool (*exists)(const char* pathname);
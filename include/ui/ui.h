@@ -9,8 +9,27 @@
 #include "ui/ui_draw.h"
 #include "ui/dxd.h"
 #include "ui/ui_view.h"
+#include "ui/ui_nodes.h"
+#include "ui/ui_layout.h"
 #include "ui/ui_containers.h"
+#include "ui/ui_vlist.h"
+#include "ui/ui_rtree.h"
+#include "ui/ui_region.h"
+#include "ui/ui_pixels.h"
+#include "ui/ui_parallel.h"
+#include "ui/ui_resample.h"
+#include "ui/ui_mipmap.h"
+#include "ui/ui_decode.h"
+#include "ui/ui_gif.h"
+#include "ui/ui_animation.h"
+#include "ui/ui_mandelbrot.h"
+#include "ui/ui_colormap.h"
+#include "ui/ui_raster.h"
 #include "ui/ui_edit_doc.h"
+#include "ui/ui_edit_advance.h"
+#include "ui/ui_edit_lines.h"
+#include "ui/ui_edit_runs.h"
+#include "ui/ui_edit_find.h"
 #include "ui/ui_edit_view.h"
 #include "ui/ui_label.h"
 #include "ui/ui_button.h"
@@ -0,0 +1,74 @@
+#pragma once
+/* Copyright (c) Dmitry "Leo" Kuznetsov 2021-24 see LICENSE for details */
+#include "posix/posix.h"
+
+posix_begin_c
+
+// Animated GIF playback with bounded memory.
+//
+// Background thread decodes frames with ui_gif (see ui_gif.h) one at
+// a time ahead of playback into a small ring of .ring_frames w x h
+// RGBA frames. One frame of the ring is shown, the rest are ready or
+// being decoded. Memory does not depend on the number of frames:
+//     (ring_frames + 1) * w * h * 4 + LZW tables
+// instead of frames * w * h * 4 of fully decoded animation.
+//
+// advance(a, now) switches to the next ready frame when the delay of
+// the current one has expired and returns the time (posix_clock
+// seconds) of the next frame change. Delays accumulate from due time
+// (not from the time of the call) so animation does not drift:
+//
+//     static void step(struct posix_work* w) {
+//         w->when = ui_animation.advance(&a, posix_clock.seconds());
+//         ui_app.request_redraw();
+//         ui_app.post(w);
+//     }
+//
+// Headless, tested with test/test4.c (--bench: samples/*.gif).
+
+enum { ui_animation_max_ring = 8 };
+
+struct ui_animation_frame {
+    uint8_t* pixels; // w * h * 4 RGBA
+    int32_t  index;  // frame number in animation
+    int32_t  delay;  // milliseconds
+};
+
+struct ui_animation {
+    struct ui_gif gif;
+    int32_t w;
+    int32_t h;
+    struct ui_animation_frame ring[ui_animation_max_ring];
+    int32_t ring_frames;
+    int32_t current; // shown frame in .ring[] or -1
+    int32_t tail;    // next .ring[] frame to decode into
+    volatile int32_t ready; // decoded frames not yet shown
+    fp64_t  due;     // time to show next frame
+    posix_event_t wake; // decoder waits for free frame in the ring
+    posix_thread_t thread;
+    volatile int32_t quit;
+    volatile int32_t error; // of decoder 0 or errno
+    volatile int64_t bytes; // allocated, see memory()
+    struct { // updated by decoder thread, consistent after dispose()
+        int64_t decoded; // frames
+        fp64_t  decode;  // seconds spent decoding
+        fp64_t  played;  // seconds of animation decoded (sum of delays)
+        int64_t late;    // advance() calls without ready frame when due
+    } stats;
+};
+
+struct ui_animation_if {
+    // init() data must outlive animation, ring_frames: 2..max_ring
+    int (*init)(struct ui_animation* a, const void* data, int64_t bytes,
+                int32_t ring_frames);
+    // frame() shown frame or null before first advance()
+    const struct ui_animation_frame* (*frame)(const struct ui_animation* a);
+    fp64_t (*advance)(struct ui_animation* a, fp64_t now);
+    int64_t (*memory)(const struct ui_animation* a); // bytes allocated
+    void (*dispose)(struct ui_animation* a);
+    void (*test)(void);
+};
+
+extern struct ui_animation_if ui_animation;
+
+posix_end_c
@@ -101,6 +101,7 @@ struct ui_app { // TODO: split to struct ui_app and struct ui_app_if, move data
     struct ui_rect crc;  // client rectangle
     struct ui_rect mrc;  // monitor rectangle
     struct ui_rect prc;  // previously invalidated paint rectangle inside crc
+    struct ui_region dirty; // being repainted inside crc, prc is its bounds
     struct ui_rect work_area; // current monitor work area
     int32_t   caption_height; // caption height
     struct ui_wh   border;    // frame border size
@@ -170,6 +171,9 @@ struct ui_app { // TODO: split to struct ui_app and struct ui_app_if, move data
                                   // make_topmost() + request_focus()
     // measure and layout:
     void (*request_layout)(void); // requests layout on UI tree before paint()
+    // request_relayout() when only `v` changed: measure() of clean
+    // subtrees is not repeated (see ui_view.dirty())
+    void (*request_relayout)(struct ui_view* v);
     void (*invalidate)(const struct ui_rect* rc);
     void (*full_screen)(bool on);
     void (*set_cursor)(ui_cursor_t c);
@@ -215,6 +219,8 @@ struct ui_app { // TODO: split to struct ui_app and struct ui_app_if, move data
     fp64_t paint_fps;  // EMA of last 128 paints
     fp64_t paint_last; // posix_clock.seconds() of last paint
     fp64_t paint_dt_min; // minimum time between 2 paints
+    int64_t paint_pixels;    // pixels repainted by last paint
+    fp64_t paint_pixels_avg; // EMA of last 32 paints
 };
 
 extern struct ui_app ui_app;
@@ -0,0 +1,76 @@
+#pragma once
+/* Copyright (c) Dmitry "Leo" Kuznetsov 2021-24 see LICENSE for details */
+#include "posix/posix.h"
+
+posix_begin_c
+
+// Array at a time color space conversions and colormaps.
+//
+// ui_colors.rgb_to_hsi(), hsi_to_rgb(), interpolate() etc. convert a
+// single ui_color_t in fp64. Kernels below convert `n` colors in fp32.
+// Colors are 32 bit ui_color_t (r, g, b, a bytes from lsb to msb, e.g.
+// (uint32_t)ui_color_rgba(r, g, b, a)) and hue, saturation, intensity
+// are planar arrays: h in [0..360), s and i in [0..1].
+//
+// color_to_hsi() and hsi_to_color() are the fp64 single color math of
+// ui_colors.rgb_to_hsi() and hsi_to_rgb() (r, g, b in [0..255]).
+// rgb_to_hsi() and hsi_to_rgb() are the same math in fp32.
+// hsi_to_rgb() (as ui_colors.hsi_to_rgb()) treats i as the value of
+// HSV color model and is the inverse of rgb_to_hsv(). Results differ
+// from fp64 ui_colors functions by at most 1 in 255 (see test()):
+// channels are rounded to nearest where ui_colors truncates them.
+//
+// to_linear() and to_srgb() convert 8 bit sRGB channels to linear
+// light [0..1] and back (rounded to nearest, saturated, NaN -> 0):
+// to_srgb(to_linear(c)) == c. Both are table lookups, vectorized with
+// AVX2 gathers and scalar on SSE2 and NEON (no gathers, 4 lane loads
+// and stores of table entries measured no faster than scalar).
+//
+// gradient() fills `entries` (e.g. 256 or 4096) colormap from `count`
+// color stops at `positions` [0..1] (null: evenly spaced) interpolated
+// in one of ui_colormap_space. Repeat the first stop at the end for
+// cyclic palettes.
+//
+// Kernels are selected at run time: AVX2 (8 lanes), SSE2 or NEON
+// (4 lanes of fp32) or portable scalar code. All of them produce
+// identical results (test/test4.c --bench: Mpixels/s of each kernel
+// and microseconds per colormap).
+
+enum ui_colormap_space {
+    ui_colormap_srgb   = 0, // channel bytes as is
+    ui_colormap_linear = 1, // linear light (perceptually smoother)
+    ui_colormap_hsv    = 2  // hue, saturation, value
+};
+
+struct ui_colormap_if {
+    void (*rgb_to_hsi)(const uint32_t* rgba, fp32_t* h, fp32_t* s,
+                       fp32_t* i, int64_t n);
+    void (*rgb_to_hsv)(const uint32_t* rgba, fp32_t* h, fp32_t* s,
+                       fp32_t* v, int64_t n);
+    // hsi_to_rgb() alpha of all d[] is `a`
+    void (*hsi_to_rgb)(uint32_t* d, const fp32_t* h, const fp32_t* s,
+                       const fp32_t* i, uint8_t a, int64_t n);
+    void (*color_to_hsi)(fp64_t r, fp64_t g, fp64_t b,
+                         fp64_t* h, fp64_t* s, fp64_t* i);
+    // hsi_to_color() returns (uint32_t)ui_color_rgba(r, g, b, a)
+    uint32_t (*hsi_to_color)(fp64_t h, fp64_t s, fp64_t i, uint8_t a);
+    void (*to_linear)(fp32_t* d, const uint8_t* s, int64_t n);
+    void (*to_srgb)(uint8_t* d, const fp32_t* s, int64_t n);
+    // interpolate() d[k] = ui_colors.interpolate(c0[k], c1[k], t[k])
+    void (*interpolate)(uint32_t* d, const uint32_t* c0, const uint32_t* c1,
+                        const fp32_t* t, int64_t n);
+    // multiply() ui_colors.multiply_brightness() and multiply_saturation()
+    // together: d[k] = s[k] with i *= brightness, s *= saturation
+    void (*multiply)(uint32_t* d, const uint32_t* s, fp32_t brightness,
+                     fp32_t saturation, int64_t n);
+    void (*gradient)(uint32_t* lut, int32_t entries, const uint32_t* stops,
+                     const fp32_t* positions, int32_t count, int32_t space);
+    // kernels of enum ui_pixels_isa (see ui_pixels.h)
+    int32_t (*isa)(void);      // selected kernels
+    bool (*use)(int32_t isa);  // false if not supported by cpu
+    void (*test)(void);
+};
+
+extern struct ui_colormap_if ui_colormap;
+
+posix_end_c
@@ -44,6 +44,16 @@ struct ui_margins { // in partial "em"s
     fp32_t bottom;
 };
 
+// values of ui.infinity and ui.align for platform independent code
+// that does not link with ui_core.c (e.g. ui_layout.c)
+
+#define ui_infinity     INT32_MAX
+#define ui_align_center 0x00
+#define ui_align_left   0x01
+#define ui_align_top    0x02
+#define ui_align_right  0x10
+#define ui_align_bottom 0x20
+
 struct ui_if {
     bool (*point_in_rect)(const struct ui_point* p, const struct ui_rect* r);
     // intersect_rect(null, r0, r1) and intersect_rect(r0, r0, r1) supported.
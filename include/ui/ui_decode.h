@@ -0,0 +1,90 @@
+#pragma once
+/* Copyright (c) Dmitry "Leo" Kuznetsov 2021-24 see LICENSE for details */
+#include "posix/posix.h"
+
+posix_begin_c
+
+// Asynchronous image decoding on a pool of worker threads.
+//
+// Decoding itself is done by .codec (e.g. stb_image, see samples and
+// test/test4.c) so the ui library does not depend on any decoder.
+// Multiple images are decoded concurrently (one per worker) while the
+// total size of decoded pixels that are being decoded or delivered
+// and not yet released stays within .budget bytes. An image bigger
+// than the budget is decoded alone.
+//
+// When encoded image carries a low resolution preview (JPEG with
+// Exif thumbnail) the preview is decoded and delivered first via
+// .preview posix_work, decoded image follows via .done posix_work.
+// Work items are posted with .post (e.g. ui_app.post to be called
+// on UI thread) or called directly on the worker thread if .post is
+// null. Pixels are in the codec order (RGB[A] for stb_image) with
+// stride = w * bpp, e.g. suitable for ui_draw.bitmap_init().
+// Caller must call release() after consuming pixels of both preview
+// and image to return their bytes to the budget:
+//
+//     static struct ui_decode_image di = { .filename = "image.jpg" };
+//     di.preview.work = show_preview; // optional
+//     di.done.work = show_image;
+//     di.post = ui_app.post;
+//     ui_decode.decode(&di);
+//     ...
+//     static void show_image(struct posix_work* w) {
+//         if (di.error == 0) {
+//             ui_draw.bitmap_init(&bitmap, di.image.w, di.image.h,
+//                                 di.image.bpp, di.image.pixels);
+//         }
+//         ui_decode.release(&di);
+//     }
+//
+// Headless, tested with test/test4.c (--bench decodes 1000 files).
+
+struct ui_decode_codec {
+    // info() returns false if format is not supported or data is corrupt
+    bool (*info)(const void* data, int64_t bytes,
+                 int32_t* w, int32_t* h, int32_t* bpp);
+    // decode() returns null on failure, bpp: 0 keep or 1, 3, 4 convert to
+    void* (*decode)(const void* data, int64_t bytes,
+                    int32_t* w, int32_t* h, int32_t* bpp, int32_t preferred);
+    void (*dispose)(void* pixels); // of decode()
+};
+
+struct ui_bitmap;
+
+struct ui_decode_image {
+    const char* filename; // mapped read only or if null:
+    const void* data;     // encoded image in memory
+    int64_t     bytes;
+    int32_t     bpp;      // 0: as encoded or 1, 3, 4
+    void (*post)(struct posix_work* w); // null: call on worker thread
+    struct posix_work preview; // .work == null: skip preview
+    struct posix_work done;
+    // results:
+    struct ui_bitmap thumbnail; // .pixels == null no preview
+    struct ui_bitmap image;     // .pixels == null on error
+    int32_t error;   // 0 or errno
+    int64_t reserved; // bytes of budget
+    struct ui_decode_image* next; // in the queue
+};
+
+struct ui_decode_if {
+    struct ui_decode_codec codec; // must be set before decode()
+    int64_t budget;  // bytes of decoded pixels in flight
+    int32_t threads; // workers, 0: ui_parallel.cores()
+    // decode() queues request, `di` must stay valid until release()
+    void (*decode)(struct ui_decode_image* di);
+    void (*release)(struct ui_decode_image* di);
+    // thumbnail() locates Exif thumbnail of JPEG: data[offset..+length]
+    bool (*thumbnail)(const void* data, int64_t bytes,
+                      int64_t* offset, int64_t* length);
+    bool (*idle)(void);     // nothing queued or decoding
+    int64_t (*bytes)(void); // reserved by not released images
+    int64_t (*peak)(void);  // maximum of bytes() since start
+    // dispose() drops queued requests and stops worker threads
+    void (*dispose)(void);
+    void (*test)(void);
+};
+
+extern struct ui_decode_if ui_decode;
+
+posix_end_c
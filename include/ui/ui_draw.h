@@ -88,6 +88,8 @@ struct ui_draw_if {
     } const ta;
     void (*init)(void);
     void (*fini)(void);
+    // begin() of 4 bytes per pixel bitmap w/o .texture (DIB section)
+    // paints with ui_raster software rasterizer (icon() is not drawn)
     void (*begin)(struct ui_bitmap* bitmap_or_null);
     // all paint must be done in between
     void (*end)(void);
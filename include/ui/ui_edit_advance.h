@@ -0,0 +1,64 @@
+#pragma once
+/* Copyright (c) Dmitry "Leo" Kuznetsov 2021-24 see LICENSE for details */
+#include "posix/posix.h"
+#include "ui/ui_edit_doc.h"
+
+posix_begin_c
+
+// Glyph advance cache.
+//
+// Measuring text with GDI/DirectWrite costs ~100-500us per call
+// regardless of the text length. Word wrap used to measure the same
+// prefix of a paragraph several times per run. Instead each glyph
+// cluster is measured once per font and the width of any text is a
+// sum of cached advances. Word break and x -> glyph mapping become
+// prefix sum scans.
+//
+// Cluster is a code point followed by combining marks, variation
+// selectors, emoji modifiers and zero width joiner sequences.
+// Cluster advance is attributed to its first code point, the rest
+// of code points in the cluster have zero advance and fit() never
+// splits a cluster.
+//
+// Kerning between clusters is not accounted for.
+//
+// measure() is a metrics provider (e.g. ui_draw.text(measure: true)
+// on Windows or a stub in headless tests).
+
+struct ui_edit_advance_entry;
+
+struct ui_edit_advance {
+    const void* font; // key: opaque font handle of the metrics provider
+    void* that;       // measure() context
+    // measure() width in pixels of a single glyph cluster
+    int32_t (*measure)(void* that, const char* utf8, int32_t bytes);
+    int32_t ascii[128]; // -1 not yet measured
+    struct ui_edit_advance_entry* table; // table[capacity] other clusters
+    int32_t capacity; // power of 2
+    int32_t count;
+    int64_t hits;     // stats
+    int64_t misses;   // number of measure() calls
+};
+
+struct ui_edit_advance_if {
+    void    (*init)(struct ui_edit_advance* a, const void* font,
+                    int32_t (*measure)(void* that, const char* utf8, int32_t bytes),
+                    void* that);
+    // cluster() number of bytes in glyph cluster at the start of utf8
+    int32_t (*cluster)(const char* utf8, int32_t bytes);
+    // glyph() advance in pixels of a single cluster utf8[bytes]
+    int32_t (*glyph)(struct ui_edit_advance* a, const char* utf8, int32_t bytes);
+    // width() of utf8[bytes] as a sum of cluster advances
+    int32_t (*width)(struct ui_edit_advance* a, const char* utf8, int32_t bytes);
+    // fit() number of glyphs (code points) from the start of utf8[bytes]
+    // which width is strictly less than `width`. *pixels (if not null)
+    // is set to width of fitted glyphs.
+    int32_t (*fit)(struct ui_edit_advance* a, const char* utf8, int32_t bytes,
+                   int32_t width, int32_t* pixels);
+    void    (*dispose)(struct ui_edit_advance* a);
+    void    (*test)(void);
+};
+
+extern struct ui_edit_advance_if ui_edit_advance;
+
+posix_end_c
@@ -1,7 +1,6 @@
 #pragma once
 /* Copyright (c) Dmitry "Leo" Kuznetsov 2021-24 see LICENSE for details */
 #include "posix/posix.h"
-#include "ui/ui.h"
 
 posix_begin_c
 
@@ -34,7 +33,7 @@ struct ui_edit_notify_info {
     const struct ui_edit_doc*   const d;
     const union ui_edit_range* const r; // range to be replaced
     const union ui_edit_range* const x; // extended range (replacement)
-    const struct ui_edit_text*  const t; // replacement text
+    const struct ui_edit_text*  const t; // replacement text (or null)
     // d->text.np number of paragraphs may change after replace
     // before/after: [pnf..pnt] is inside [0..d->text.np-1]
     int32_t const pnf; // paragraph number from
@@ -64,14 +63,29 @@ struct ui_edit_listener {
 struct ui_edit_to_do { // undo/redo action
     union ui_edit_range  range;
     struct ui_edit_text   text;
-    struct ui_edit_to_do* next; // inside undo or redo list
+};
+
+struct ui_edit_journal_spill;
+
+struct ui_edit_journal { // undo or redo stack of serialized actions
+    uint8_t* data;     // append only records data[0..bytes - 1]
+    int64_t  bytes;    // number of bytes in use
+    int64_t  capacity; // number of bytes allocated
+    int32_t  count;    // number of records (in memory and spilled)
+    int32_t  pn;       // top record range.from.pn (delta encoding base)
+    struct ui_edit_journal_spill* spill; // oldest records on disk or null
 };
 
 struct ui_edit_doc {
     struct ui_edit_text   text;
-    struct ui_edit_to_do* undo; // undo stack
-    struct ui_edit_to_do* redo; // redo stack
+    struct ui_edit_journal undo; // undo stack
+    struct ui_edit_journal redo; // redo stack
     struct ui_edit_listener* listeners;
+    // init() sets limit to 16MB and spill to true. When in memory
+    // journal grows past `limit` bytes the oldest half of records
+    // is moved to a temporary file (spill: true) or discarded.
+    int64_t limit; // 0 is unlimited
+    bool    spill;
 };
 
 struct ui_edit_doc_if {
@@ -81,13 +95,28 @@ struct ui_edit_doc_if {
                     int32_t bytes, bool heap);
     bool    (*replace)(struct ui_edit_doc* d, const union ui_edit_range* r,
                 const char* utf8, int32_t bytes);
+    // replace_batch() replaces n non-overlapping ranges[i] with utf8[i]
+    // as a single undoable edit with single before/after notification
+    // (notify_info.t is null). bytes[] may be null or contain -1 for
+    // zero terminated strings. utf8[i] may be null only for deletion
+    // (bytes[i] <= 0), n < 0 is rejected.
+    bool    (*replace_batch)(struct ui_edit_doc* d, const union ui_edit_range ranges[],
+                const char* const utf8[], const int32_t bytes[], int32_t n);
     int32_t (*bytes)(const struct ui_edit_doc* d, const union ui_edit_range* range);
-    bool    (*copy_text)(struct ui_edit_doc* d, const union ui_edit_range* range,
+    bool    (*copy_text)(const struct ui_edit_doc* d, const union ui_edit_range* range,
                 struct ui_edit_text* text); // retrieves range into string
     int32_t (*utf8bytes)(const struct ui_edit_doc* d, const union ui_edit_range* range);
     // utf8 must be at least ui_edit_doc.utf8bytes()
-    void    (*copy)(struct ui_edit_doc* d, const union ui_edit_range* range,
+    void    (*copy)(const struct ui_edit_doc* d, const union ui_edit_range* range,
                 char* utf8, int32_t bytes);
+    // write() streams utf8 of the range (null: whole document) into `s`
+    // in batches without materializing it. Paragraphs are separated
+    // by "\n", no 0x00 terminator is written. Returns 0 or error.
+    int     (*write)(const struct ui_edit_doc* d, const union ui_edit_range* range,
+                struct posix_stream_if* s);
+    // save() writes whole document into "<filename>.tmp" and then
+    // atomically replaces `filename` with it. Returns 0 or error.
+    int     (*save)(const struct ui_edit_doc* d, const char* filename);
     // undo() and push reverse into redo stack
     bool (*undo)(struct ui_edit_doc* d); // false if there is nothing to redo
     // redo() and push reverse into undo stack
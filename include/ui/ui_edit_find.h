@@ -0,0 +1,56 @@
+#pragma once
+/* Copyright (c) Dmitry "Leo" Kuznetsov 2021-24 see LICENSE for details */
+#include "posix/posix.h"
+#include "ui/ui_edit_doc.h"
+
+posix_begin_c
+
+// Substring search over ui_edit_doc text.
+//
+// Pattern may contain "\n" and then matches across paragraphs.
+// ignore_case: true folds ASCII letters only (bytes >= 0x80 of
+// UTF-8 sequences are compared exactly).
+//
+// Optional index keeps 255 bit trigram signature per paragraph.
+// Paragraphs which signature does not contain all trigrams of
+// the pattern are skipped without scanning their bytes.
+// Index is updated incrementally through ui_edit_notify: modified
+// paragraphs lose their signatures and signatures are recomputed
+// lazily by find or in budgeted steps by index() called from
+// idle time (e.g. ui_app timer) without a background thread.
+
+struct ui_edit_find_sig;
+
+struct ui_edit_find {
+    struct ui_edit_notify notify; // must be first: subscribed to `d`
+    struct ui_edit_doc* d;
+    struct ui_edit_find_sig* sig; // sig[np] null if index is not used
+    int32_t np;       // number of paragraphs in sig[]
+    int32_t capacity; // allocated sig[capacity]
+    int32_t missing;  // number of paragraphs without signature
+    int32_t pn;       // next paragraph to be checked by index()
+};
+
+struct ui_edit_find_if {
+    bool    (*init)(struct ui_edit_find* f, struct ui_edit_doc* d, bool index);
+    // all() stores up to `n` non-overlapping hits into hits[]
+    // and returns total number of hits in document
+    int32_t (*all)(struct ui_edit_find* f, const char* utf8, int32_t bytes,
+                   bool ignore_case, union ui_edit_range hits[], int32_t n);
+    // next() first hit starting at or after `from`, false if none
+    bool    (*next)(struct ui_edit_find* f, const struct ui_edit_pg from,
+                    const char* utf8, int32_t bytes, bool ignore_case,
+                    union ui_edit_range* hit);
+    // index() computes up to `budget` missing signatures,
+    // returns number of paragraphs still missing signatures
+    int32_t (*index)(struct ui_edit_find* f, int32_t budget);
+    // memmem() byte offset of first occurrence of p[m] in s[n] or -1
+    int32_t (*memmem)(const char* s, int32_t n, const char* p, int32_t m,
+                      bool ignore_case);
+    void    (*dispose)(struct ui_edit_find* f);
+    void    (*test)(void);
+};
+
+extern struct ui_edit_find_if ui_edit_find;
+
+posix_end_c
@@ -0,0 +1,44 @@
+#pragma once
+/* Copyright (c) Dmitry "Leo" Kuznetsov 2021-24 see LICENSE for details */
+#include "posix/posix.h"
+
+posix_begin_c
+
+// Visual lines index.
+//
+// Each paragraph of the edit view is wrapped into one or more runs
+// (visual lines). Mapping scroll position (line number from the top
+// of the text) to paragraph/run and back needs prefix sums of the
+// number of runs per paragraph. Summing them in a loop is O(n) and
+// takes milliseconds on a document with a million paragraphs.
+//
+// ui_edit_lines is a Fenwick (binary indexed) tree of counts:
+// add(), sum() and find() are O(log n), init() is O(n).
+// Inserting or deleting items shifts indices and requires init().
+
+struct ui_edit_lines {
+    int32_t* t;        // t[n + 1] partial sums, t[0] is not used
+    int32_t  n;        // number of items, 0: empty or cleared
+    int32_t  capacity; // allocated t[capacity + 1]
+    int32_t  top;      // highest power of 2 <= n
+};
+
+struct ui_edit_lines_if {
+    // init() (re)builds index of n items with counts count(that, i)
+    bool    (*init)(struct ui_edit_lines* x, int32_t n,
+                    int32_t (*count)(void* that, int32_t i), void* that);
+    // clear() sets n to zero but keeps memory for next init()
+    void    (*clear)(struct ui_edit_lines* x);
+    void    (*add)(struct ui_edit_lines* x, int32_t i, int32_t delta);
+    // sum() of counts of items [0..i[ exclusive, sum(x, x->n) is total
+    int32_t (*sum)(const struct ui_edit_lines* x, int32_t i);
+    // find() item i such that sum(i) <= k < sum(i + 1) and sets
+    // *rem = k - sum(i). Returns n if k >= total.
+    int32_t (*find)(const struct ui_edit_lines* x, int32_t k, int32_t* rem);
+    void    (*dispose)(struct ui_edit_lines* x);
+    void    (*test)(void);
+};
+
+extern struct ui_edit_lines_if ui_edit_lines;
+
+posix_end_c
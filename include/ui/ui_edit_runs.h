@@ -0,0 +1,78 @@
+#pragma once
+/* Copyright (c) Dmitry "Leo" Kuznetsov 2021-24 see LICENSE for details */
+#include "posix/posix.h"
+#include "ui/ui_edit_doc.h"
+
+posix_begin_c
+
+// Compact storage of paragraph runs (word wrapped visual lines).
+//
+// Run start and length in glyphs and bytes are derived from glyph
+// counts of the preceding runs and str->g2b[]. Only glyph counts of
+// all but the last run are stored as varints (7 bits per byte) in a
+// single pool shared by all paragraphs of the view. Paragraph that
+// fits into a single run (most of them) takes no pool space at all.
+//
+// Freed runs become garbage inside the pool. When the pool needs to
+// grow and at least half of it is garbage it is compacted instead.
+
+struct ui_edit_run { // decoded
+    int32_t bp;     // position in bytes  since start of the paragraph
+    int32_t gp;     // position in glyphs since start of the paragraph
+    int32_t bytes;  // number of bytes in this `run`
+    int32_t glyphs; // number of glyphs in this `run`
+};
+
+struct ui_edit_paragraph { // "paragraph" view consists of wrapped runs
+    int32_t runs; // number of runs in this paragraph, 0: not yet wrapped
+    int32_t ofs;  // runs > 1: glyph counts at ui_edit_runs.data[ofs]
+};
+
+struct ui_edit_runs { // pool
+    uint8_t* data;
+    int32_t  bytes;    // in use, including garbage
+    int32_t  capacity;
+    int32_t  garbage;  // bytes of freed runs
+    int32_t  start;    // begin() position of paragraph being stored
+    int32_t  last;     // position of the last add() glyph count
+    int64_t  allocations; // stats: number of heap alloc/realloc calls
+};
+
+struct ui_edit_run_it { // sequential decoder
+    struct ui_edit_run run; // run[rn] valid when rn < runs
+    int32_t rn;
+    int32_t runs;
+    int32_t pos; // next glyph count position relative to p->ofs
+    const struct ui_edit_paragraph* p;
+    const struct ui_edit_str* str;
+};
+
+struct ui_edit_runs_if {
+    // begin() storing runs of a paragraph: reserves pool space for
+    // `estimate` runs, may compact pool and change para[0..np-1].ofs
+    void (*begin)(struct ui_edit_runs* rs, struct ui_edit_paragraph para[],
+                  int32_t np, int32_t estimate);
+    void (*add)(struct ui_edit_runs* rs, int32_t glyphs); // next run
+    void (*end)(struct ui_edit_runs* rs, struct ui_edit_paragraph* p,
+                int32_t runs);
+    // free() paragraph runs, p->runs becomes 0
+    void (*free)(struct ui_edit_runs* rs, struct ui_edit_paragraph* p);
+    // reset() empties pool when all paragraphs are freed
+    void (*reset)(struct ui_edit_runs* rs);
+    // run() decodes run[rn] in O(rn)
+    struct ui_edit_run (*run)(const struct ui_edit_runs* rs,
+        const struct ui_edit_paragraph* p, const struct ui_edit_str* str,
+        int32_t rn);
+    // seek() decoder to run[rn] in O(rn) and next() run in O(1).
+    // Iteration is done when it->rn >= it->runs.
+    void (*seek)(const struct ui_edit_runs* rs, const struct ui_edit_paragraph* p,
+                 const struct ui_edit_str* str, int32_t rn,
+                 struct ui_edit_run_it* it);
+    void (*next)(const struct ui_edit_runs* rs, struct ui_edit_run_it* it);
+    void (*dispose)(struct ui_edit_runs* rs);
+    void (*test)(void);
+};
+
+extern struct ui_edit_runs_if ui_edit_runs;
+
+posix_end_c
@@ -23,23 +23,6 @@ struct ui_edit_pr { // page/run coordinates
     int32_t rn; // run number inside paragraph
 };
 
-struct ui_edit_run {
-    int32_t bp;     // position in bytes  since start of the paragraph
-    int32_t gp;     // position in glyphs since start of the paragraph
-    int32_t bytes;  // number of bytes in this `run`
-    int32_t glyphs; // number of glyphs in this `run`
-    int32_t pixels; // width in pixels
-};
-
-// struct ui_edit_paragraph.initially text will point to readonly memory
-// with .allocated == 0; as text is modified it is copied to
-// heap and reallocated there.
-
-struct ui_edit_paragraph { // "paragraph" view consists of wrapped runs
-    int32_t runs;       // number of runs in this paragraph
-    struct ui_edit_run* run; // heap allocated array[runs]
-};
-
 struct ui_edit_notify_view {
     struct ui_edit_notify notify;
     void*            that; // specific for listener
@@ -74,16 +57,35 @@ struct ui_edit_view {
     int32_t shown;    // debug: caret show/hide counter 0|1
     // paragraphs memory:
     struct ui_edit_paragraph* para; // para[e->doc->text.np]
+    struct ui_edit_runs pool; // runs of all wrapped paragraphs
+    struct { // incremental word wrap (see notes below)
+        int32_t pn;      // next paragraph to be checked by wrap()
+        int32_t wrapped; // number of paragraphs broken into runs
+        int64_t runs;    // sum of runs in wrapped paragraphs
+    } wrap;
+    struct ui_edit_lines lines; // runs per paragraph index (see notes below)
 };
 
 struct ui_edit_view_if {
     void (*init)(struct ui_edit_view* e, struct ui_edit_doc* d);
     void (*set_font)(struct ui_edit_view* e, struct ui_fm* fm); // see notes below (*)
     void (*move)(struct ui_edit_view* e, struct ui_edit_pg pg); // move caret clear selection
+    // wrap() breaks not yet wrapped paragraphs into runs for up to
+    // `budget` seconds, returns number of paragraphs still not wrapped
+    int32_t (*wrap)(struct ui_edit_view* e, fp64_t budget);
+    // runs() total number of runs (visual lines) in the document;
+    // estimated from already wrapped paragraphs until *exact is true
+    int64_t (*runs)(struct ui_edit_view* e, bool *exact);
+    // line() zero based visual line (run) number of `pg` from the start
+    // of the text, y = line * line height. scroll_to() scrolls `line`
+    // to the top of the view (scroll bar, go to line).
+    int32_t (*line)(struct ui_edit_view* e, struct ui_edit_pg pg);
+    void    (*scroll_to)(struct ui_edit_view* e, int32_t line);
     // replace selected text. If bytes < 0 text is treated as zero terminated
     void (*replace)(struct ui_edit_view* e, const char* text, int32_t bytes);
     // call save(e, null, &bytes) to retrieve number of utf8
     // bytes required to save whole text including 0x00 terminating bytes
+    // use ui_edit_doc.save(e->doc, filename) to save big text to file
     errno_t (*save)(struct ui_edit_view* e, char* text, int32_t* bytes);
     void (*copy)(struct ui_edit_view* e);  // to clipboard
     void (*cut)(struct ui_edit_view* e);   // to clipboard
@@ -131,6 +133,21 @@ extern struct ui_edit_view_if ui_edit_view;
         wordbreak this attribute was removed as poor UX human experience
         along with single line scroll editing. See note below about .sle.
 
+    wrap()
+        Only visible paragraphs are broken into runs when text is
+        modified or edit view is resized. The rest of the document is
+        wrapped in ~8ms slices from every_100ms(). Until it is done
+        runs() * line height is an estimate of the total text height
+        suitable for a scroll bar.
+
+    .lines
+        prefix sums of runs per paragraph that make line() and
+        scroll_to() O(log n). Not yet wrapped paragraphs are counted
+        as a single run thus line numbers are estimates until wrap()
+        is done. The index is updated when paragraph runs are computed
+        or invalidated and is rebuilt on the next use after edits that
+        insert or delete paragraphs.
+
     .sle
         single line edit control.
         Edit UI element does NOT support horizontal scroll and breaking
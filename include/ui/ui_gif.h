@@ -0,0 +1,55 @@
+#pragma once
+/* Copyright (c) Dmitry "Leo" Kuznetsov 2021-24 see LICENSE for details */
+#include "posix/posix.h"
+
+posix_begin_c
+
+// Streaming animated GIF decoder.
+//
+// next() decodes one frame at a time into a single w x h RGBA .canvas
+// (same byte order as stb_image): disposal of the previous frame is
+// applied to its rectangle only (2: cleared to transparent, 3: restored
+// from a copy of the rectangle) and the new frame is drawn into its
+// own (delta) rectangle. After the last frame next() starts over from
+// the first frame with cleared canvas and .frames set.
+//
+// Memory is the canvas, the saved rectangle for disposal 3 and LZW
+// tables (~14KB) independently of number of frames. Encoded data is
+// not copied and must outlive the decoder.
+//
+// Headless, tested with test/test4.c (--bench: samples/*.gif).
+
+struct ui_gif {
+    const uint8_t* data;
+    int64_t  bytes;
+    int32_t  w; // logical screen
+    int32_t  h;
+    uint32_t* canvas; // w * h RGBA
+    int32_t  index;   // of decoded frame, -1 before first next()
+    int32_t  frames;  // 0 until all frames have been decoded once
+    int32_t  delay;   // milliseconds to show decoded frame
+    int32_t  disposal; // of decoded frame 0..3
+    struct { int32_t x; int32_t y; int32_t w; int32_t h; } rect; // of frame
+    // internal:
+    uint32_t* saved;  // .rect pixels before the frame for disposal 3
+    int64_t  capacity; // of .saved in pixels
+    int64_t  start;   // offset of the first block after the header
+    int64_t  next;    // offset of the next block to decode
+    uint32_t palette[256]; // global color table
+    uint16_t prefix[4096]; // LZW dictionary
+    uint8_t  suffix[4096];
+    uint8_t  stack[4097];
+};
+
+struct ui_gif_if {
+    // init() returns 0 or errno, data must outlive the decoder
+    int (*init)(struct ui_gif* g, const void* data, int64_t bytes);
+    int (*next)(struct ui_gif* g); // 0 or errno (EINVAL corrupt data)
+    int64_t (*memory)(const struct ui_gif* g); // bytes allocated
+    void (*dispose)(struct ui_gif* g);
+    void (*test)(void);
+};
+
+extern struct ui_gif_if ui_gif;
+
+posix_end_c
@@ -14,6 +14,16 @@ posix_begin_c
 // device otherwise ui_draw.rgbx() call is used and alpha
 // is ignored.
 
+// Zoomed images (scale() != 1) are resampled in software
+// (see ui_resample.h) with .filter. Resampled visible part of
+// the image (plus margin for panning) is cached and reused
+// while scale, filter and .image stay the same.
+// Very large images zoomed out to 1:2 and below are painted
+// from tiles of a mip-map pyramid (see ui_mipmap.h) built in
+// the background. Missing tiles are painted from coarser ones.
+// Call ui_image.dispose() to release the cache and the pyramid
+// and after .image pixels were modified in place.
+
 struct ui_image;
 
 struct ui_image {
@@ -28,6 +38,8 @@ struct ui_image {
     // 0=16:1 1=8:1 2=4:1 3=2:1 4=1:1 5=1:2 6=1:4 7=1:8 8=1:16
     int32_t zn; // zoom nominator (1, 2, 3, ...)
     int32_t zd; // zoom denominator (1, 2, 3, ...)
+    fp64_t  zs; // > 0 arbitrary zoom scale (see zoom()) overrides zn:zd
+    int32_t filter; // ui_resample_* default: ui_resample_lanczos3
     fp64_t  sx; // shift x [0..1.0] in view coordinates
     fp64_t  sy; // shift y [0..1.0]
     struct { // only visible when focused
@@ -47,6 +59,17 @@ struct ui_image {
     bool fill;   // fill entire view
     // fit and fill cannot be true at the same time
     // when fit: false and fill: false the zoom ratio is in effect
+    struct { // resampled part of the image
+        struct ui_bitmap bitmap; // .pixels heap allocated
+        const void* pixels; // of .image that was resampled
+        int32_t w;          // .image.w
+        int32_t h;          // .image.h
+        int32_t x;          // bitmap origin in zoomed image coordinates
+        int32_t y;
+        fp64_t  scale;
+        int32_t filter;
+    } cache;
+    struct ui_mipmap mipmap; // .levels == 0 until used
 };
 
 struct ui_image_if {
@@ -57,8 +80,11 @@ struct ui_image_if {
     // ration can only be: 16:1 8:1 4:1 2:1 1:1 1:2 1:4 1:8 1:16
     // but ignored if .fit or .fill is true
     void      (*ratio)(struct ui_image* iv, int32_t nominator, int32_t denominator);
+    // zoom() to any scale > 0 (e.g. 1.5 or 0.3), resets .fit and .fill
+    void      (*zoom)(struct ui_image* iv, fp64_t scale);
     fp64_t    (*scale)(struct ui_image* iv); // 2 ^ (zn - 1) / 2 ^ (zd - 1)
     struct ui_rect (*position)(struct ui_image* iv);
+    void      (*dispose)(struct ui_image* iv); // releases .cache .mipmap
 };
 
 extern struct ui_image_if ui_image;
@@ -0,0 +1,66 @@
+#pragma once
+/* Copyright (c) Dmitry "Leo" Kuznetsov 2021-24 see LICENSE for details */
+#include "posix/posix.h"
+
+posix_begin_c
+
+// Platform independent measure() and layout() of ui_view trees
+// including ui_span, ui_list and ui_stack containers.
+//
+// Depends only on posix and ui_core.h, ui_colors.h, ui_draw.h and
+// ui_view.h declarations (not implementations) and can be built and
+// tested without a window on any platform (see test/test4.c).
+//
+// Text metrics and default font metrics are pluggable. Defaults are
+// fixed pitch: each glyph is fm->average_char_width (or fm->em.w)
+// wide and each line is fm->height tall. ui_app plugs in ui_draw
+// text metrics and ui_app.fm.prop.normal on start.
+//
+// ui_view.measure() layout() margins() inbox() outbox() etc. are
+// thin wrappers around ui_layout.
+
+struct ui_layout_if {
+    // pluggable:
+    // text_metrics() of utf8 zero terminated `s`: multiline text
+    // is broken into lines at "\n" and wrapped at `w` pixels if w > 0
+    struct ui_wh (*text_metrics)(const struct ui_fm* fm, bool multiline,
+                                 int32_t w, const char* s);
+    const struct ui_fm* fm; // for views with .fm == null
+    // views that are not descendants of root are orphans and
+    // are not measured or laid out (see ui_layout.is_hidden())
+    const struct ui_view* root;
+    // nodes of root tree (see ui_nodes.h) updated by measure() and
+    // layout(). Call ui_nodes.changed() after adding or removing views
+    // (ui_view.add() and remove() do).
+    struct ui_nodes* nodes;
+    // layout core:
+    void (*init)(struct ui_view* v); // measure() layout() of containers
+    struct ui_ltrb (*margins)(const struct ui_view* v, const struct ui_margins* g);
+    void (*inbox)(const struct ui_view* v, struct ui_rect* r, struct ui_ltrb* insets);
+    void (*outbox)(const struct ui_view* v, struct ui_rect* r, struct ui_ltrb* padding);
+    bool (*is_orphan)(const struct ui_view* v);
+    bool (*is_hidden)(const struct ui_view* v);
+    const char* (*string)(struct ui_view* v); // localized text
+    void (*text_measure)(struct ui_view* v, const char* s,
+                         struct ui_view_text_metrics* tm);
+    void (*text_align)(struct ui_view* v, struct ui_view_text_metrics* tm);
+    void (*measure_control)(struct ui_view* v);
+    void (*measure_children)(struct ui_view* v);
+    void (*layout_children)(struct ui_view* v);
+    void (*measure)(struct ui_view* v);
+    void (*layout)(struct ui_view* v);
+    void (*dirty)(struct ui_view* v);
+    void (*dirty_all)(void);
+    // containers:
+    void (*span_measure)(struct ui_view* v);
+    void (*span_layout)(struct ui_view* v);
+    void (*list_measure)(struct ui_view* v);
+    void (*list_layout)(struct ui_view* v);
+    void (*stack_measure)(struct ui_view* v);
+    void (*stack_layout)(struct ui_view* v);
+    void (*test)(void);
+};
+
+extern struct ui_layout_if ui_layout;
+
+posix_end_c
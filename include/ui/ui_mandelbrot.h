@@ -0,0 +1,128 @@
+#pragma once
+/* Copyright (c) Dmitry "Leo" Kuznetsov 2021-24 see LICENSE for details */
+#include "posix/posix.h"
+
+posix_begin_c
+
+// Mandelbrot set escape time renderer.
+//
+// render() computes number of iterations of z = z^2 + c until |z| > 2
+// (or .iterations) for every pixel c = (x + i * dx, y + j * dy) and
+// stores it into .counts[j * .stride + i]. Points inside of the main
+// cardioid and the period 2 bulb are not iterated. Orbits that repeat
+// exactly (periodicity check at powers of 2 iterations) are inside
+// too. Both checks do not change results: counts are identical to
+// plain iteration of all pixels.
+//
+// Image is split into ui_mandelbrot_tile x ui_mandelbrot_tile tiles
+// rendered in parallel on ui_parallel worker threads. .tile() (if not
+// null) is called on the worker thread as soon as a tile is finished
+// so the caller can colorize and show it (progressive rendering).
+// Setting .stop abandons rendering after the tiles in flight.
+//
+// Scanline kernels are selected at run time: AVX2 (4 lanes), SSE2 or
+// NEON (2 lanes of fp64) or portable scalar code. All of them produce
+// the same counts (test/test4.c --bench: megapixels/s at several zoom
+// depths). fp64 precision limits zoom to pixel size ~1e-13.
+//
+// Deep zoom (perturbation theory):
+//
+// deep() renders pixel sizes down to ~1e-120. The center of the image
+// .deep.cx, .deep.cy is a fixed point number and only its orbit Z (the
+// reference) is iterated in fixed point. Every pixel iterates its fp64
+// difference from the reference: dz' = 2 * Z * dz + dz^2 + dc.
+// Series approximation dz = A * dc + B * dc^2 + C * dc^3 skips the
+// first iterations (.deep.skip) shared by all pixels of the image. When
+// |Z + dz| < |dz| or the reference escaped, the pixel restarts from
+// the beginning of the reference orbit with dz = Z + dz (rebasing), so
+// a single reference serves all pixels without "glitches". Per pixel
+// iterations are scalar fp64 code (test/test4.c --bench: milliseconds
+// per frame down to pixel size 1e-120).
+//
+// Incremental rendering:
+//
+// update() renders the view centered at .deep.cx, .deep.cy with render()
+// kernels while pixel size > 1e-12 and with deep() perturbation below
+// (render() is ~6 times faster but miscounts 8% of pixels at 1e-13,
+// see ui_mandelbrot_update()).
+// Counts of the previous update() are kept in .cache keyed by complex
+// plane coordinates: pixels of the new view that fall exactly on pixels
+// of the previous one are copied instead of iterated. Panning by whole
+// pixels computes only the newly exposed strips. Zooming in or out by a
+// power of 2 reuses 1/4 of the pixels and the rest of .counts starts as
+// the upscaled (nearest) previous view refined tile by tile (.tile()
+// callbacks). Escaped counts stay valid when .iterations change.
+// .cache.computed and .cache.reused count pixels of the last update().
+
+enum {
+    ui_mandelbrot_tile  = 64,
+    ui_mandelbrot_limbs = 16 // 32 bit limbs: 1 integer + 480 bits fraction
+};
+
+struct ui_mandelbrot_fixed { // two's complement, [0] integer part
+    uint32_t limb[ui_mandelbrot_limbs];
+};
+
+struct ui_mandelbrot {
+    fp64_t  x;  // complex plane coordinates of pixel (0, 0)
+    fp64_t  y;
+    fp64_t  dx; // pixel size
+    fp64_t  dy;
+    int32_t w;
+    int32_t h;
+    int32_t iterations; // maximum
+    int32_t* counts;    // [h * stride] output
+    int32_t stride;     // in counts (int32_t) not bytes
+    void (*tile)(struct ui_mandelbrot* m, int32_t x, int32_t y,
+                 int32_t w, int32_t h);
+    void* that;
+    volatile int32_t stop;
+    struct { // deep():
+        struct ui_mandelbrot_fixed cx; // center: pixel (w / 2, h / 2)
+        struct ui_mandelbrot_fixed cy;
+        fp64_t* orbit; // [(iterations + 1) * 2] reference x, y
+        int64_t capacity; // of .orbit in fp64_t
+        int32_t n;     // reference orbit escaped at .n or .n == iterations
+        int32_t skip;  // iterations skipped by series approximation
+        fp64_t  r;     // radius: max |dc| of the image
+        fp64_t  series[6]; // A * r, B * r^2, C * r^3 (x, y) at .skip
+    } deep;
+    struct { // update():
+        int32_t* counts;   // [w * h] of the view below
+        uint8_t* known;    // [w * h] pixels reused by update() in progress
+        int64_t  capacity; // of .counts and .known in pixels
+        struct ui_mandelbrot_fixed cx;
+        struct ui_mandelbrot_fixed cy;
+        fp64_t   dx;
+        fp64_t   dy;
+        int32_t  w; // 0 if nothing is cached
+        int32_t  h;
+        int32_t  iterations;
+        int64_t  computed; // pixels iterated by the last update()
+        int64_t  reused;   // pixels copied from the previous view
+    } cache;
+};
+
+struct ui_mandelbrot_if {
+    void (*render)(struct ui_mandelbrot* m);
+    // deep() like render() but .x, .y are ignored and the image is
+    // centered at .deep.cx, .deep.cy. Returns 0 or ENOMEM
+    int  (*deep)(struct ui_mandelbrot* m);
+    // update() like deep() but reuses .cache. Returns 0 or ENOMEM
+    int  (*update)(struct ui_mandelbrot* m);
+    void (*dispose)(struct ui_mandelbrot* m); // frees .deep.orbit, .cache
+    // fixed point: fixed(f, v) f = v, add(f, v) f += v (to 2^-480)
+    void   (*fixed)(struct ui_mandelbrot_fixed* f, fp64_t v);
+    void   (*add)(struct ui_mandelbrot_fixed* f, fp64_t v);
+    fp64_t (*fp64)(const struct ui_mandelbrot_fixed* f);
+    // escape() number of iterations for a single point (reference)
+    int32_t (*escape)(fp64_t x, fp64_t y, int32_t iterations);
+    // kernels of enum ui_pixels_isa (see ui_pixels.h)
+    int32_t (*isa)(void);      // selected kernels
+    bool (*use)(int32_t isa);  // false if not supported by cpu
+    void (*test)(void);
+};
+
+extern struct ui_mandelbrot_if ui_mandelbrot;
+
+posix_end_c
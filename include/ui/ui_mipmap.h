@@ -0,0 +1,94 @@
+#pragma once
+/* Copyright (c) Dmitry "Leo" Kuznetsov 2021-24 see LICENSE for details */
+#include "posix/posix.h"
+
+posix_begin_c
+
+// Tiled multi-resolution pyramid of a very large image.
+//
+// Level 0 is the image itself (not copied), level L is 2^L times
+// smaller: each pixel is the box filtered average of 2x2 pixels of
+// level L - 1 (see ui_resample.h). Levels are split into tiles of
+// ui_mipmap_tile x ui_mipmap_tile pixels. The last level fits into
+// a single tile.
+//
+// Tiles of levels above 0 are built lazily by a background thread
+// from the tiles of the level below (built recursively if missing)
+// and kept in an LRU cache limited by .budget bytes. Tiles in use by
+// the builder are pinned and may temporarily exceed the budget.
+//
+// Painting a frame:
+//     ui_mipmap.lock(m); // drops build requests of previous frame
+//     L = ui_mipmap.level(m, scale);
+//     for visible tiles (tx, ty) of level L:
+//         b = ui_mipmap.tile(m, L, tx, ty); // requests build if missing
+//         if (b.pixels == null) { draw part of ui_mipmap.cached()
+//                                 tile of a coarser level instead }
+//     ui_mipmap.unlock(m);
+// Tile pixels stay valid until unlock(). Background thread calls
+// .ready(m) after each built tile (e.g. to request redraw).
+//
+// Headless, tested with test/test4.c (--bench: 20000x20000 image).
+
+enum { ui_mipmap_tile = 256, ui_mipmap_max_levels = 24 };
+
+struct ui_bitmap;
+struct ui_mipmap_entry;
+
+struct ui_mipmap {
+    struct ui_bitmap image; // level 0, not owned
+    int32_t levels;
+    int32_t w[ui_mipmap_max_levels];  // level width and height in pixels
+    int32_t h[ui_mipmap_max_levels];
+    int32_t nx[ui_mipmap_max_levels]; // level width and height in tiles
+    int32_t ny[ui_mipmap_max_levels];
+    int32_t offset[ui_mipmap_max_levels]; // of level tiles in .slot[]
+    int32_t* slot;     // entry index or -1 for each tile of levels > 0
+    uint8_t* queued;   // slot is in .queue
+    int32_t  slots;
+    struct ui_mipmap_entry* entry;
+    int32_t  entries;  // allocated
+    int32_t  lru;      // most recently used entry or -1
+    int32_t  free;     // list of free entries or -1
+    int32_t* queue;    // build requests, last in first out
+    int32_t  queue_n;
+    int32_t  queue_capacity;
+    int64_t  budget;   // bytes
+    int64_t  bytes;    // of cached tiles
+    struct posix_mutex mutex;
+    posix_event_t wake;
+    posix_thread_t thread;
+    volatile int32_t quit;
+    volatile int32_t building;
+    void (*ready)(struct ui_mipmap* m); // called on background thread
+    void* that;
+    struct {
+        int64_t hits;
+        int64_t misses;
+        int64_t built;
+        int64_t evicted;
+    } stats;
+};
+
+struct ui_mipmap_if {
+    // init() image must outlive mip-map, budget in bytes for cached tiles
+    void (*init)(struct ui_mipmap* m, const struct ui_bitmap* image,
+                 int64_t budget);
+    // level() with scale in [2^-L / 2 .. 2^-L] or 0 for scale > 1/2
+    int32_t (*level)(const struct ui_mipmap* m, fp64_t scale);
+    void (*lock)(struct ui_mipmap* m);
+    // tile() must be called between lock() and unlock()
+    struct ui_bitmap (*tile)(struct ui_mipmap* m, int32_t level,
+                             int32_t tx, int32_t ty);
+    // cached() same as tile() but does not request building
+    struct ui_bitmap (*cached)(struct ui_mipmap* m, int32_t level,
+                               int32_t tx, int32_t ty);
+    void (*unlock)(struct ui_mipmap* m);
+    bool (*idle)(struct ui_mipmap* m); // no pending or in progress builds
+    void (*dispose)(struct ui_mipmap* m);
+    void (*test)(void);
+};
+
+extern struct ui_mipmap_if ui_mipmap;
+
+posix_end_c
@@ -0,0 +1,77 @@
+#pragma once
+/* Copyright (c) Dmitry "Leo" Kuznetsov 2021-24 see LICENSE for details */
+#include "posix/posix.h"
+
+posix_begin_c
+
+// Flat structure of arrays of the view tree for traversal heavy
+// passes.
+//
+// struct ui_view is large (inline text, hint, callbacks) and children
+// are circular doubly linked lists thus recursive traversals chase
+// pointers across cold memory. Nodes are compact arrays indexed in
+// pre-order: descendants of node `i` are nodes (i .. end[i]).
+//
+// ui_view.add() remove() and ui_vlist call changed(). Nodes are
+// rebuilt lazily by the next update() O(n). Until then index_of()
+// returns -1 and callers fall back to walking the views.
+// Nodes are not patched in place on add/remove: inserting into
+// pre-order arrays shifts and renumbers O(n) nodes anyway, and a
+// single rebuild per frame is cheaper than one per add() when many
+// views are added at once (e.g. ui_vlist relinking rows).
+//
+// ui_layout keeps nodes of ui_layout.root (ui_layout.nodes) and uses
+// them to memoize is_hidden() during measure() and layout(), to walk
+// children in layout() and to record laid out geometry.
+// ui_view.timer() every_100ms() every_sec() iterate nodes instead of
+// recursion.
+//
+// Depends only on ui_view.h declarations and is tested headless
+// (see test/test4.c).
+
+enum {
+    ui_node_hidden = 0x01 // view or any of its ancestors is hidden
+};
+
+struct ui_nodes {
+    const struct ui_view* root;
+    struct ui_view** view; // pre-order, view[0] == root
+    int32_t* parent;       // -1 for the root
+    int32_t* child;        // first child or -1
+    int32_t* next;         // next sibling or -1
+    int32_t* end;          // descendants of i are (i .. end[i])
+    struct ui_rect* rc;    // .x .y .w .h of the last layout()
+    uint8_t*  flags;       // ui_node_* valid for pass[i] (see is_hidden())
+    uint32_t* pass;
+    int32_t n;
+    int32_t capacity;
+    int32_t busy;          // for_each() in progress: update() is deferred
+    bool valid;            // false after changed() until update()
+    struct {
+        int64_t builds;
+        int64_t changes; // number of changed() calls
+    } stats;
+};
+
+struct ui_nodes_if {
+    void (*changed)(struct ui_nodes* ns); // views were added or removed
+    // update() rebuilds nodes of `root` tree if changed() O(n) else O(1)
+    void (*update)(struct ui_nodes* ns, const struct ui_view* root);
+    // index_of() view in nodes or -1
+    int32_t (*index_of)(const struct ui_nodes* ns, const struct ui_view* v);
+    // is_hidden() memoized for `pass`: caller guarantees no .state.hidden
+    // changes within the same pass (pass 0 is never valid)
+    bool (*is_hidden)(struct ui_nodes* ns, int32_t ix, uint32_t pass);
+    // for_each() calls visit() for `v` and its descendants in pre-order.
+    // Views removed (and possibly freed) by visit() are skipped, views
+    // added by visit() are not visited. Falls back to recursion if `v`
+    // is not in nodes.
+    void (*for_each)(struct ui_nodes* ns, struct ui_view* v,
+                     void (*visit)(struct ui_view* v, void* that), void* that);
+    void (*dispose)(struct ui_nodes* ns);
+    void (*test)(void);
+};
+
+extern struct ui_nodes_if ui_nodes;
+
+posix_end_c
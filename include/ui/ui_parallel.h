@@ -0,0 +1,35 @@
+#pragma once
+/* Copyright (c) Dmitry "Leo" Kuznetsov 2021-24 see LICENSE for details */
+#include "posix/posix.h"
+
+posix_begin_c
+
+// Data parallel loop over a small pool of worker threads.
+//
+// for_each() calls task(that, i) for every i in [0..n) and returns
+// when all calls returned. Iterations are handed out one at a time
+// from an atomic counter, the calling thread participates, thus
+// tasks should be coarse (e.g. a band of scanlines) and independent.
+// Order of calls is unspecified.
+//
+// Workers (threads() - 1 of them) are started on the first use and
+// sleep on events between calls. Nested or concurrent for_each()
+// calls do not wait for the pool: they run all iterations inline on
+// the calling thread.
+//
+// limit(1) makes for_each() single threaded (benchmarks, debugging)
+// limit(0) restores the default: all active cores.
+
+struct ui_parallel_if {
+    int32_t (*cores)(void);   // active logical processors
+    int32_t (*threads)(void); // used by for_each() including caller
+    void (*limit)(int32_t threads);
+    void (*for_each)(int32_t n, void (*task)(void* that, int32_t i),
+                     void* that);
+    void (*dispose)(void);    // joins workers, next for_each() restarts
+    void (*test)(void);
+};
+
+extern struct ui_parallel_if ui_parallel;
+
+posix_end_c
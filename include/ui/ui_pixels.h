@@ -0,0 +1,52 @@
+#pragma once
+/* Copyright (c) Dmitry "Leo" Kuznetsov 2021-24 see LICENSE for details */
+#include "posix/posix.h"
+
+posix_begin_c
+
+// Pixel format conversion of scanlines.
+//
+// Win32 DIB sections (ui_draw.bitmap_init()) are BGR, BGRx or
+// premultiplied BGRA while decoded images are usually RGB or RGBA.
+// Kernels convert `n` pixels from `s` to `d`. `d` may be equal to `s`
+// for conversions with the same number of bytes per pixel (in place)
+// otherwise buffers must not overlap. No alignment is required.
+//
+// premultiply() computes c * a / 255 rounded down exactly as the
+// scalar code it replaced. unpremultiply() computes c * 255 / a
+// rounded to nearest (via reciprocal table) and saturated at 0xFF,
+// a == 0 results in zero color.
+//
+// Kernels are selected at run time: AVX2 (x64 with cpu support),
+// SSE2 (x86/x64), NEON (ARM64) or portable scalar code which is the
+// reference all other kernels are tested against for exact match
+// (see test/test4.c for the GB/s benchmark).
+
+enum ui_pixels_isa {
+    ui_pixels_scalar = 0,
+    ui_pixels_sse2   = 1,
+    ui_pixels_avx2   = 2,
+    ui_pixels_neon   = 3
+};
+
+struct ui_pixels_if {
+    // rgb() RGB -> BGR (or BGR -> RGB) 3 bytes per pixel
+    void (*rgb)(uint8_t* d, const uint8_t* s, int64_t n);
+    // rgbx() RGBx -> BGRA with A = 0xFF, swap: false for BGRx -> BGRA
+    void (*rgbx)(uint8_t* d, const uint8_t* s, int64_t n, bool swap);
+    // premultiply() RGBA -> premultiplied BGRA, swap: false for BGRA
+    void (*premultiply)(uint8_t* d, const uint8_t* s, int64_t n, bool swap);
+    // gray() 1 byte per pixel -> BGRA with A = 0xFF
+    void (*gray)(uint8_t* d, const uint8_t* s, int64_t n);
+    // unpremultiply() premultiplied BGRA -> BGRA (e.g. clipboard export)
+    void (*unpremultiply)(uint8_t* d, const uint8_t* s, int64_t n);
+    int32_t (*isa)(void);          // selected kernels
+    bool (*use)(int32_t isa);      // false if not supported by cpu
+    bool (*supported)(int32_t isa); // by cpu, does not select kernels
+    const char* (*name)(int32_t isa);
+    void (*test)(void);
+};
+
+extern struct ui_pixels_if ui_pixels;
+
+posix_end_c
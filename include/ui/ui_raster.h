@@ -0,0 +1,113 @@
+#pragma once
+/* Copyright (c) Dmitry "Leo" Kuznetsov 2021-24 see LICENSE for details */
+#include "posix/posix.h"
+#include "ui/ui_core.h"
+#include "ui/ui_colors.h"
+
+posix_begin_c
+
+// Software rasterizer of ui_draw primitives.
+//
+// Target is struct ui_bitmap with 4 bytes per pixel premultiplied BGRA
+// (the pixels of DIB sections and Direct2D targets) allocated by the
+// caller. Does not depend on GDI or Direct2D and runs headless (see
+// test/test4.c). ui_draw.begin() of a bitmap without .texture paints
+// with ui_raster instead of dxd.cpp.
+//
+// Primitives in between begin() and end() are recorded into a display
+// list (.commands). end() renders it: the bitmap is split into
+// ui_raster_tile x ui_raster_tile tiles rendered in parallel on
+// ui_parallel worker threads. Each tile replays the commands that touch
+// it in order clipped to the tile, thus results do not depend on the
+// number of threads. render() replays the list again.
+//
+// Geometry:
+// fill(), gradient(), image() and mask() cover pixels [x..x + w) x
+// [y..y + h). Borders of frame(), rect() and rounded() are 1 pixel
+// wide inside of the same rectangle (GDI FrameRect(), Direct2D strokes
+// straddle the edges of the pixels). rounded() and circle() are
+// anti-aliased by distance to the outline, circle(x, y, r) is 2 * r + 1
+// pixels across. line() and poly() stroke 1 pixel wide anti-aliased
+// lines in between pixel centers including both ends. polygon() fills
+// the outline through pixel corners with exact area coverage (non-zero
+// winding rule of simple polygons).
+//
+// Colors are ui_color_t with alpha 0 treated as opaque (as dxd.cpp
+// does) and ui_colors.transparent is not drawn. Gradients interpolate
+// sRGB bytes (Direct2D D2D1_GAMMA_2_2). Scaled image() samples nearest
+// pixels (see ui_resample for filtered scaling).
+//
+// Span kernels (fill, blend, blend by coverage and blit of
+// premultiplied pixels) are selected at run time: AVX2, SSE2, NEON or
+// portable scalar code. All of them produce identical results
+// (test/test4.c --bench: replay of a paint of samples/layout.c).
+
+enum { ui_raster_tile = 64 };
+
+struct ui_raster_command; // see ui_raster.c
+
+struct ui_raster {
+    struct ui_bitmap* bitmap; // 4 bytes per pixel premultiplied BGRA
+    struct ui_rect clip; // set_clip(), .w == 0 whole bitmap
+    struct ui_raster_command* commands; // display list
+    int32_t  count;      // of .commands
+    int32_t  capacity;
+    uint8_t* data;       // edges and coverage of .commands
+    int64_t  bytes;      // used in .data
+    int64_t  allocated;
+    int      error;      // ENOMEM if commands were dropped
+};
+
+struct ui_raster_if {
+    void (*begin)(struct ui_raster* r, struct ui_bitmap* bitmap);
+    int  (*end)(struct ui_raster* r);    // render() returns .error
+    void (*render)(struct ui_raster* r); // recorded commands
+    void (*dispose)(struct ui_raster* r);
+    // set_clip(r, 0, 0, 0, 0) clears clip rectangle
+    void (*set_clip)(struct ui_raster* r, int32_t x, int32_t y,
+                     int32_t w, int32_t h);
+    void (*pixel)(struct ui_raster* r, int32_t x, int32_t y, ui_color_t c);
+    void (*line)(struct ui_raster* r, int32_t x0, int32_t y0,
+                 int32_t x1, int32_t y1, ui_color_t c);
+    void (*frame)(struct ui_raster* r, int32_t x, int32_t y,
+                  int32_t w, int32_t h, ui_color_t c);
+    void (*rect)(struct ui_raster* r, int32_t x, int32_t y,
+                 int32_t w, int32_t h, ui_color_t border, ui_color_t fill);
+    void (*fill)(struct ui_raster* r, int32_t x, int32_t y,
+                 int32_t w, int32_t h, ui_color_t c);
+    // poly() polyline as ui_draw.poly(), polygon() filled
+    void (*poly)(struct ui_raster* r, const struct ui_point* points,
+                 int32_t count, ui_color_t c);
+    void (*polygon)(struct ui_raster* r, const struct ui_point* points,
+                    int32_t count, ui_color_t c);
+    void (*circle)(struct ui_raster* r, int32_t x, int32_t y, int32_t radius,
+                   ui_color_t border, ui_color_t fill);
+    void (*rounded)(struct ui_raster* r, int32_t x, int32_t y,
+                    int32_t w, int32_t h, int32_t radius,
+                    ui_color_t border, ui_color_t fill);
+    void (*gradient)(struct ui_raster* r, int32_t x, int32_t y,
+                     int32_t w, int32_t h, ui_color_t from, ui_color_t to,
+                     bool vertical);
+    // image() dx, dy, dw, dh destination, ix, iy, iw, ih rectangle inside
+    // pixels[height][stride] of 1 (grey), 3 (BGR) or 4 (BGRA) bytes per
+    // pixel, alpha of BGRA is ignored unless premultiplied.
+    // `pixels` must stay valid until end()
+    void (*image)(struct ui_raster* r, int32_t dx, int32_t dy,
+                  int32_t dw, int32_t dh, int32_t ix, int32_t iy,
+                  int32_t iw, int32_t ih, int32_t width, int32_t height,
+                  int32_t stride, int32_t bpp, const uint8_t* pixels,
+                  fp64_t alpha, bool premultiplied);
+    // mask() blends color `c` by 8 bit coverage[h][stride] (e.g. glyphs
+    // rendered by font engine). Coverage is copied
+    void (*mask)(struct ui_raster* r, int32_t x, int32_t y,
+                 int32_t w, int32_t h, const uint8_t* coverage,
+                 int32_t stride, ui_color_t c);
+    // kernels of enum ui_pixels_isa (see ui_pixels.h)
+    int32_t (*isa)(void);      // selected kernels
+    bool (*use)(int32_t isa);  // false if not supported by cpu
+    void (*test)(void);
+};
+
+extern struct ui_raster_if ui_raster;
+
+posix_end_c
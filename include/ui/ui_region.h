@@ -0,0 +1,41 @@
+#pragma once
+/* Copyright (c) Dmitry "Leo" Kuznetsov 2021-24 see LICENSE for details */
+#include "posix/posix.h"
+
+posix_begin_c
+
+// Dirty region: small set of disjoint rectangles that need repaint.
+//
+// add() coalesces rectangles. Overlapping rectangles are always merged
+// (thus area() is exact number of pixels). Nearby rectangles are
+// merged when their bounding box wastes no more pixels than the two
+// rectangles cover together. When there are more than
+// ui_region_max_rects the pair with the least waste is merged.
+//
+// ui_app accumulates ui_view.invalidate() rectangles between paints
+// and ui_view.paint() skips views outside of ui_app.dirty.
+//
+// Depends only on ui_core.h and is tested headless (see test/test4.c).
+
+enum { ui_region_max_rects = 16 };
+
+struct ui_region {
+    struct ui_rect r[ui_region_max_rects]; // disjoint, not empty
+    int32_t count;
+};
+
+struct ui_region_if {
+    void (*add)(struct ui_region* rg, const struct ui_rect* r);
+    // clip() region to rectangle (e.g. client area)
+    void (*clip)(struct ui_region* rg, const struct ui_rect* r);
+    bool (*intersects)(const struct ui_region* rg, const struct ui_rect* r);
+    bool (*contains)(const struct ui_region* rg, const struct ui_point* pt);
+    struct ui_rect (*bounds)(const struct ui_region* rg);
+    int64_t (*area)(const struct ui_region* rg); // pixels
+    void (*reset)(struct ui_region* rg);
+    void (*test)(void);
+};
+
+extern struct ui_region_if ui_region;
+
+posix_end_c
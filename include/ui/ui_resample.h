@@ -0,0 +1,55 @@
+#pragma once
+/* Copyright (c) Dmitry "Leo" Kuznetsov 2021-24 see LICENSE for details */
+#include "posix/posix.h"
+
+posix_begin_c
+
+// Software image resampling with box, bilinear (triangle) and
+// Lanczos-3 filters at arbitrary (fractional) scale.
+//
+// Filtering is separable: each source scanline is filtered
+// horizontally once into a small ring of rows that is then filtered
+// vertically into the destination. Filter footprint widens by 1/scale
+// when downscaling so minification averages instead of aliasing.
+// Weights are 16 bit fixed point normalized to exactly 1.0 so uniform
+// areas stay uniform; intermediate rows are 8 bit (like Pillow).
+//
+// Destination rows are split into bands processed in parallel on
+// ui_parallel worker threads. Working set of a band is the ring of
+// horizontally filtered rows (filter taps * destination row) that
+// stays in cache.
+//
+// Kernels are selected at run time: AVX2 (two output pixels per
+// horizontal step, 32 bytes per vertical step), SSE2 or portable
+// scalar code. All of them produce identical results (see
+// test/test4.c for the benchmark).
+//
+// Works with 1 (greyscale), 3 (BGR) and 4 (BGRA or premultiplied
+// BGRA) bytes per pixel. Channels are filtered independently.
+
+enum {
+    ui_resample_box      = 0,
+    ui_resample_bilinear = 1,
+    ui_resample_lanczos3 = 2
+};
+
+struct ui_bitmap;
+
+struct ui_resample_if {
+    // scale() fills all d->w x d->h pixels of `d` (allocated by caller,
+    // d->bpp == s->bpp) with the part of `s` scaled by `scale` whose
+    // top left corner is at (x, y) in scaled image coordinates:
+    // d(i, j) samples s at ((x + i + 0.5) / scale, (y + j + 0.5) / scale)
+    // Samples outside of `s` repeat its edge pixels.
+    void (*scale)(struct ui_bitmap* d, const struct ui_bitmap* s,
+                  int32_t x, int32_t y, fp64_t scale, int32_t filter);
+    const char* (*name)(int32_t filter);
+    // kernels of enum ui_pixels_isa (see ui_pixels.h)
+    int32_t (*isa)(void);      // selected kernels
+    bool (*use)(int32_t isa);  // false if not supported by cpu
+    void (*test)(void);
+};
+
+extern struct ui_resample_if ui_resample;
+
+posix_end_c
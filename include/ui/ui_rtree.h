@@ -0,0 +1,78 @@
+#pragma once
+/* Copyright (c) Dmitry "Leo" Kuznetsov 2021-24 see LICENSE for details */
+#include "posix/posix.h"
+
+posix_begin_c
+
+// Spatial index of laid out view rectangles for mouse dispatch.
+//
+// Packed bounding volume hierarchy (binary R-tree) of all not hidden
+// views of the tree. Point queries visit O(log n) nodes instead of
+// every child rectangle of the tree.
+//
+// update() is called after layout(). When the set of visible views
+// did not change (scrolling, resizing, text changes) it only refits
+// rectangles of the nodes in place O(n). Otherwise the hierarchy is
+// rebuilt O(n log n). Positions of views modified outside of layout()
+// are not seen until next update().
+//
+// Depends only on ui_view.h declarations and is tested headless
+// (see test/test4.c). ui_view.hit_test() mouse_move() mouse_hover()
+// use it for ui_app.root tree.
+
+struct ui_rtree_item {
+    struct ui_ltrb  r;  // right and bottom are exclusive
+    struct ui_view* v;
+    int32_t order;      // pre-order index of the view in the tree
+};
+
+struct ui_rtree_node {
+    struct ui_ltrb box; // bounds of all items in the subtree
+    // leaf: count > 0 items starting at first
+    // inner: count == 0 left child is next node, right child is first
+    int32_t first;
+    int32_t count;
+};
+
+struct ui_rtree {
+    const struct ui_view* root; // indexed tree
+    struct ui_rtree_item* items;
+    struct ui_rtree_node* nodes;
+    struct ui_view** views;     // visible views in pre-order
+    struct ui_view** next;      // scratch for update()
+    struct ui_view** listeners; // mouse_move() or mouse_hover() != null
+    struct ui_view** hovered;   // views with state.hover
+    int32_t n;         // number of items and views
+    int32_t count;     // number of nodes
+    int32_t listening; // number of listeners
+    int32_t hovering;  // number of hovered
+    // capacity of all arrays above (nodes: 2 * capacity) is at least
+    // n + hovering thus hovered[] can hold all views with state.hover
+    int32_t capacity;
+    struct {
+        int64_t builds;
+        int64_t refits;
+    } stats;
+};
+
+struct ui_rtree_if {
+    // update() index of visible views of `root` tree after layout()
+    void (*update)(struct ui_rtree* t, const struct ui_view* root);
+    // query() items containing the point in pre-order (parents
+    // before children). Returns total number of items found which
+    // may be greater than `count` of first items stored into found[]
+    int32_t (*query)(const struct ui_rtree* t, struct ui_point pt,
+                     const struct ui_rtree_item* found[], int32_t count);
+    // hit_test() same as recursive ui_view.hit_test() of descendants
+    // of `v` with the point (v->hit_test() itself is not called).
+    // Returns 0 (ui.hit_test.nowhere) if none of the hit_test()
+    // callbacks claimed the point.
+    int64_t (*hit_test)(const struct ui_rtree* t, const struct ui_view* v,
+                        struct ui_point pt);
+    void (*dispose)(struct ui_rtree* t);
+    void (*test)(void);
+};
+
+extern struct ui_rtree_if ui_rtree;
+
+posix_end_c
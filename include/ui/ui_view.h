@@ -15,17 +15,43 @@ enum ui_view_type_t {
     ui_view_span      = 'vwhs',
     ui_view_list      = 'vwvs',
     ui_view_spacer    = 'vwsp',
-    ui_view_scroll    = 'vwsc'
+    ui_view_scroll    = 'vwsc',
+    ui_view_vlist     = 'vwvl'
 };
 
 struct ui_view;
 
+struct ui_view_measure_key { // view attributes measure() depends on
+    const struct ui_fm* fm;
+    struct ui_wh em;
+    struct ui_margins insets;
+    struct ui_margins padding;
+    fp32_t  min_w_em;
+    fp32_t  min_h_em;
+    int32_t max_w;
+    int32_t max_h;
+    int32_t text_align;
+    ui_icon_t icon;
+};
+
 struct ui_view_private { // do not access directly
     char text[1024]; // utf8 zero terminated
     int32_t strid;    // 0 for not yet localized, -1 no localization
     fp64_t armed_until; // posix_clock.seconds() - when to release
     fp64_t hover_when;  // time in seconds when to call hovered()
     // use: ui_view.string(v) and ui_view.set_string()
+    // incremental measure() and layout() see ui_view.dirty():
+    void (*measure)(struct ui_view* v); // known to depend only on
+    void (*layout)(struct ui_view* v);  // attributes and children
+    bool dirty;    // view or any of descendants need measure()
+    bool pure;     // measure() and layout() of subtree can be cached
+    bool relayout; // measured since last layout()
+    int32_t generation; // of cached values, see ui_view.dirty_all()
+    struct ui_view_measure_key key; // measure() inputs for:
+    struct ui_wh   measured; // .w .h result of measure()
+    struct ui_wh   sized;    // .w .h after parent measure() before layout()
+    struct ui_rect laid;     // .x .y .w .h layout() was called with
+    int32_t node; // index in ui_layout.nodes (see ui_nodes.h)
 };
 
 struct ui_view_text_metrics { // ui_view.measure_text() fills these attributes:
@@ -162,9 +188,10 @@ struct ui_view_if {
     void (*outbox)(const struct ui_view* v, struct ui_rect* r, struct ui_ltrb* padding);
     void (*set_text)(struct ui_view* v, const char* format, ...);
     void (*set_text_va)(struct ui_view* v, const char* format, va_list va);
-    // ui_view.invalidate() prone to 30ms delays don't use in r/t video code
-    // ui_view.invalidate(v, ui_app.crc) invalidates whole client rect but
-    // ui_view.redraw() (fast non blocking) is much better instead
+    // ui_view.invalidate() adds rectangle to the dirty region (see
+    // ui_region.h) that is repainted on the next paint. Only views
+    // intersecting dirty region are painted. For whole client area
+    // ui_app.request_redraw() is better
     void (*invalidate)(const struct ui_view* v, const struct ui_rect* rect_or_null);
     bool (*is_orphan)(const struct ui_view* v);   // view parent chain has null
     bool (*is_hidden)(const struct ui_view* v);   // view or any parent is hidden
@@ -189,6 +216,10 @@ struct ui_view_if {
     void (*mouse_hover)(struct ui_view* v); // hover over
     void (*mouse_move)(struct ui_view* v);
     void (*mouse_scroll)(struct ui_view* v, struct ui_point dx_dy); // touchpad scroll
+    // index() spatial index of `root` tree (see ui_rtree.h) used by
+    // hit_test() mouse_move() mouse_hover() after layout() instead of
+    // visiting all views. index(null) drops it until the next layout()
+    void (*index)(struct ui_view* root_or_null);
     struct ui_wh (*text_metrics_va)(int32_t x, int32_t y, bool multiline, int32_t w,
         const struct ui_fm* fm, const char* format, va_list va);
     struct ui_wh (*text_metrics)(int32_t x, int32_t y, bool multiline, int32_t w,
@@ -203,6 +234,15 @@ struct ui_view_if {
     void (*layout_children)(struct ui_view* v);
     void (*measure)(struct ui_view* v);
     void (*layout)(struct ui_view* v);
+    // dirty() view needs measure(): marks it and all ancestors.
+    // Clean subtrees with pure (prepare/measured/composed == null,
+    // default or container measure/layout) views are not measured
+    // or laid out again unless their attributes or position change.
+    // ui_view.set_text() add() remove() call it implicitly.
+    void (*dirty)(struct ui_view* v);
+    // dirty_all() invalidates all cached measurements (e.g. fonts
+    // or dpi changed), called by ui_app.request_layout()
+    void (*dirty_all)(void);
     void (*hover_changed)(struct ui_view* v);
     bool (*is_shortcut_key)(struct ui_view* v, int64_t key);
     bool (*context_menu)(struct ui_view* v);
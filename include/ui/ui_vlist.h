@@ -0,0 +1,96 @@
+#pragma once
+/* Copyright (c) Dmitry "Leo" Kuznetsov 2021-24 see LICENSE for details */
+#include "posix/posix.h"
+
+posix_begin_c
+
+// Virtualized list of `count` items (log viewers, file lists).
+//
+// Only rows of the visible window plus `overscan` rows above and
+// below it are materialized as children views. row() factory binds
+// a view to an item. Rows scrolled out of the window are recycled:
+// they are passed back to row() to be rebound to another item.
+// Rows that stay inside the window keep their binding and are not
+// measured again. Cost of a frame depends on the window size and
+// not on the number of items.
+//
+// Row height is fixed (row_h > 0) or measured per row. Scroll
+// position is the item at the top of the window and number of
+// pixels it is scrolled above the top edge thus variable height
+// rows never need to be measured all. Height of rows outside of
+// the window is estimated by average measured height.
+//
+// Usage:
+//
+// static struct ui_view* row(struct ui_vlist* vl, struct ui_view* r,
+//         int64_t ix) {
+//     if (r == null) { r = new label view }
+//     ui_view.set_text(r, "item %lld", ix);
+//     return r;
+// }
+//
+// static struct ui_vlist list = ui_vlist(1000 * 1000, 0, row);
+// ui_view.add(ui_app.content, &list.view, null);
+//
+// ui_vlist.c does not depend on ui_app and can be tested headless
+// (see test/test4.c). Painting, mouse and keyboard are implemented
+// by ui_view_init_vlist() in ui_containers.c.
+
+struct ui_vlist;
+
+struct ui_vlist {
+    struct ui_view view; // rows are children of the view
+    int64_t count;    // number of items
+    int32_t row_h;    // > 0 fixed row height in pixels including padding
+    int32_t overscan; // number of rows materialized above and below
+    // row() returns view bound to item `ix`. `r` is either null
+    // (create new view) or recycled row previously returned by row()
+    // for another item which must be rebound and returned.
+    struct ui_view* (*row)(struct ui_vlist* vl, struct ui_view* r, int64_t ix);
+    // recycle() may dispose row that is no longer needed (may be null)
+    void (*recycle)(struct ui_vlist* vl, struct ui_view* r);
+    int64_t top;    // item at the top of the window
+    int32_t offset; // pixels `top` row is scrolled above the window
+    struct { // private: materialized window
+        struct ui_view** rows;  // rows[i] bound to item first + i
+        struct ui_view** next;  // rows of the next window
+        struct ui_view** spare; // unbound rows
+        int32_t n;        // number of bound rows
+        int32_t spares;   // number of spare rows
+        int32_t capacity; // of rows[] next[] spare[]
+        int64_t first;    // item bound to rows[0]
+        int32_t estimate; // average height of measured rows
+        int64_t bound;    // stats: number of row() calls
+    } w;
+};
+
+void ui_view_init_vlist(struct ui_view* v); // see ui_containers.c
+
+#define ui_vlist(items, row_height, factory) {  \
+    .view = {                                   \
+        .type = ui_view_vlist,                  \
+        .init = ui_view_init_vlist,             \
+        .fm   = &ui_app.fm.prop.normal,         \
+        .color = ui_color_transparent,          \
+        .color_id = 0                           \
+    },                                          \
+    .count = items, .row_h = row_height,        \
+    .overscan = 2, .row = factory               \
+}
+
+struct ui_vlist_if {
+    void (*init)(struct ui_vlist* vl); // measure() and layout()
+    // scroll() by `dy` pixels: dy > 0 towards the end of the list
+    void (*scroll)(struct ui_vlist* vl, int32_t dy);
+    void (*scroll_to)(struct ui_vlist* vl, int64_t ix); // ix at the top
+    // reload() all rows after `count` or items content changed
+    void (*reload)(struct ui_vlist* vl);
+    // row_of() bound row of the item or null if not materialized
+    struct ui_view* (*row_of)(struct ui_vlist* vl, int64_t ix);
+    void (*dispose)(struct ui_vlist* vl); // recycles all rows
+    void (*test)(void);
+};
+
+extern struct ui_vlist_if ui_vlist;
+
+posix_end_c
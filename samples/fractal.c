@@ -11,9 +11,10 @@ static posix_event_t wake;
 static posix_event_t quit;
 
 static volatile bool rendering;
-static volatile bool stop;
 static volatile fp64_t render_time;
 
+static struct ui_mandelbrot fractal; // .stop abandons rendering
+
 static void toggle_full_screen(ui_button_t* b) {
     b->state.pressed = !b->state.pressed;
     ui_app.full_screen(b->state.pressed);
@@ -51,8 +52,8 @@ static void request_rendering(void) {
 
 static void stop_rendering(void) {
     if (rendering) {
-        stop = true;
-        while (rendering || stop) { posix_thread.sleep_for(0.01); }
+        fractal.stop = true;
+        while (rendering || fractal.stop) { posix_thread.sleep_for(0.01); }
         ui_app.set_cursor(ui_app.cursors.arrow);
     }
 }
@@ -143,44 +144,50 @@ struct ui_app ui_app = {
     }
 };
 
-static fp64_t scale(int32_t x, int32_t n, fp64_t low, fp64_t hi) {
-    return x / (fp64_t)(n - 1) * (hi - low) + low;
-}
-
-static void mandelbrot(struct ui_bitmap* im) {
-    fp64_t time = posix_clock.seconds();
-    for (int32_t r = 0; r < im->h && !stop; r++) {
-        fp64_t y0 = scale(r, im->h, -1.12, 1.12);
-        for (int32_t c = 0; c < im->w && !stop; c++) {
-            fp64_t x0 = scale(c, im->w, -2.00, 0.47);
-            fp64_t x = 0;
-            fp64_t y = 0;
-            int32_t iteration = 0;
-            enum { max_iteration = 100 };
-            while (x* x + y * y <= 2 * 2 && iteration < max_iteration && !stop) {
-                fp64_t t = x * x - y * y + x0;
-                y = 2 * x * y + y0;
-                x = t;
-                iteration++;
-            }
-            static ui_color_t palette[16] = {
-                ui_color_rgb( 66,  30,  15),  ui_color_rgb( 25,   7,  26),
-                ui_color_rgb(  9,   1,  47),  ui_color_rgb(  4,   4,  73),
-                ui_color_rgb(  0,   7, 100),  ui_color_rgb( 12,  44, 138),
-                ui_color_rgb( 24,  82, 177),  ui_color_rgb( 57, 125, 209),
-                ui_color_rgb(134, 181, 229),  ui_color_rgb(211, 236, 248),
-                ui_color_rgb(241, 233, 191),  ui_color_rgb(248, 201,  95),
-                ui_color_rgb(255, 170,   0),  ui_color_rgb(204, 128,   0),
-                ui_color_rgb(153,  87,   0),  ui_color_rgb(106,  52,   3)
-            };
-            ui_color_t color = palette[iteration % posix_countof(palette)];
-            uint8_t* px = &((uint8_t*)im->pixels)[r * im->w * 4 + c * 4];
+static void colorize(struct ui_mandelbrot* m, int32_t x, int32_t y,
+        int32_t w, int32_t h) {
+    // called on ui_parallel worker thread as soon as a tile is rendered
+    static ui_color_t palette[16] = {
+        ui_color_rgb( 66,  30,  15),  ui_color_rgb( 25,   7,  26),
+        ui_color_rgb(  9,   1,  47),  ui_color_rgb(  4,   4,  73),
+        ui_color_rgb(  0,   7, 100),  ui_color_rgb( 12,  44, 138),
+        ui_color_rgb( 24,  82, 177),  ui_color_rgb( 57, 125, 209),
+        ui_color_rgb(134, 181, 229),  ui_color_rgb(211, 236, 248),
+        ui_color_rgb(241, 233, 191),  ui_color_rgb(248, 201,  95),
+        ui_color_rgb(255, 170,   0),  ui_color_rgb(204, 128,   0),
+        ui_color_rgb(153,  87,   0),  ui_color_rgb(106,  52,   3)
+    };
+    for (int32_t r = y; r < y + h; r++) {
+        int32_t* counts = m->counts + r * m->stride;
+        for (int32_t c = x; c < x + w; c++) {
+            // iteration count is replaced by the color of the pixel
+            ui_color_t color = palette[counts[c] % posix_countof(palette)];
+            uint8_t* px = (uint8_t*)&counts[c];
             px[3] = 0xFF;
             px[0] = (color >> 16) & 0xFF;
             px[1] = (color >>  8) & 0xFF;
             px[2] = (color >>  0) & 0xFF;
         }
     }
+    ui_app.request_redraw(); // show tiles as soon as they are ready
+}
+
+static void mandelbrot(struct ui_bitmap* im) {
+    fp64_t time = posix_clock.seconds();
+    // [-2.00..0.47] x [-1.12..1.12] iteration counts are rendered
+    // in place of 4 bytes per pixel and colorized tile by tile
+    memset(im->pixels, 0x00, (size_t)(im->h * im->stride));
+    fractal.x  = -2.00;
+    fractal.y  = -1.12;
+    fractal.dx = 2.47 / (im->w - 1);
+    fractal.dy = 2.24 / (im->h - 1);
+    fractal.w  = im->w;
+    fractal.h  = im->h;
+    fractal.iterations = 100;
+    fractal.counts = (int32_t*)im->pixels;
+    fractal.stride = im->stride / 4;
+    fractal.tile   = colorize;
+    ui_mandelbrot.render(&fractal);
     render_time = posix_clock.seconds() - time;
 }
 
@@ -193,9 +200,10 @@ static void renderer(void* unused) {
         int32_t ix = posix_event.wait_any(posix_countof(es), es);
         if (ix != 0) { break; }
         int32_t k = !index;
+        index = k; // paint() shows tiles as soon as they are rendered
         mandelbrot(&image[k]);
-        if (!stop) { index = !index; ui_app.request_redraw(); }
-        stop = false;
+        ui_app.request_redraw();
+        fractal.stop = false;
         rendering = false;
     }
 }
@@ -3,7 +3,8 @@
 #include "ui/ui.h"
 #include "stb/stb_image.h"
 
-// Code in this sample illustrates how to load animated gifs
+// Code in this sample illustrates how to play animated gifs
+// (decoded frame by frame by ui_animation into a small ring of frames)
 // and use them as a movie backdrop and sprites.
 // Sample coed uses ui_app.post() to execute animation steps on the
 // dispatch thread.
@@ -13,20 +14,10 @@
 
 const char* title = "I am Groot";
 
-typedef struct animated_gif_s {
-    int32_t bpp; // bytes per pixel
-    int32_t w;
-    int32_t h;
-    int32_t  frames;
-    int32_t* delays; // delays[frames];
-    uint8_t* pixels;
-} animated_gif_t;
-
 enum { max_speed = 3 };
 
 typedef struct animation_s {
-    animated_gif_t* gif;
-    int32_t  index; // animated_groot index 0..groot.frames - 1
+    struct ui_animation* gif;
     uint32_t seed; // for posix_num.random32()
     int32_t  x;
     int32_t  y;
@@ -36,13 +27,11 @@ typedef struct animation_s {
     int32_t  speed_y;
 } animation_t;
 
-static animated_gif_t groot;
-static animation_t    animated_groot = { .gif = &groot };
-
-static animated_gif_t movie;
-static animation_t    animated_movie = { .gif = &movie };
+static struct ui_animation groot;
+static animation_t animated_groot = { .gif = &groot };
 
-static posix_thread_t thread; // animated gifs loader thread
+static struct ui_animation movie;
+static animation_t animated_movie = { .gif = &movie };
 
 static bool   muted;
 static fp64_t volume; // be mute
@@ -51,27 +40,30 @@ static struct ui_midi midi;
 
 static struct ui_bitmap background;
 
+static struct ui_decode_image background_png; // decoded asynchronously
+
 static void init(void);
 static void fini(void);
 static void character(struct ui_view* view, const char* utf8);
 static void stop_and_close(void);
 static void open_and_play(void);
 
-static void* load_image(const uint8_t* data, int64_t bytes, int32_t* w, int32_t* h,
+static bool image_info(const void* data, int64_t bytes,
+    int32_t* w, int32_t* h, int32_t* bpp);
+
+static void* load_image(const void* data, int64_t bytes, int32_t* w, int32_t* h,
     int32_t* bpp, int32_t preferred_bytes_per_pixel);
 
-static void* load_animated_gif(const uint8_t* data, int64_t bytes,
-    int32_t** delays, int32_t* w, int32_t* h, int32_t* frames, int32_t* bpp,
-    int32_t preferred_bytes_per_pixel);
+static void free_image(void* pixels);
 
 static const char* midi_file(void);
 
 static void paint_groot(animation_t* a) {
-    const animated_gif_t* g = a->gif;
-    const uint8_t* p = g->pixels + g->w * g->h * g->bpp * a->index;
+    const struct ui_animation* g = a->gif;
+    const uint8_t* p = ui_animation.frame(g)->pixels;
     struct ui_bitmap frame = { 0 };
     // alpha blend needs GPu allocated bitmap
-    ui_draw.bitmap_init(&frame, g->w, g->h, g->bpp, p);
+    ui_draw.bitmap_init(&frame, g->w, g->h, 4, p);
     const int32_t x = a->x - a->w / 2;
     const int32_t y = a->y - a->h / 2;
     ui_draw.alpha(x, y, a->w, a->h, 0, 0, frame.w, frame.h, &frame, 1.0);
@@ -80,10 +72,10 @@ static void paint_groot(animation_t* a) {
 
 static void paint_movie(animation_t* a) {
     ui_draw.fill(0, 0, ui_app.crc.w, ui_app.crc.h, ui_colors.black);
-    const animated_gif_t* g = a->gif;
-    const uint8_t* p = g->pixels + g->w * g->h * g->bpp * a->index;
+    const struct ui_animation* g = a->gif;
+    const uint8_t* p = ui_animation.frame(g)->pixels;
     ui_draw.pixels(a->x, a->y, a->w, a->h, 0, 0, g->w, g->h,
-                g->w, g->h, g->w * g->bpp, g->bpp, p);
+                g->w, g->h, g->w * 4, 4, p);
 }
 
 static void paint_mute_unmute(struct ui_view* v) {
@@ -107,9 +99,12 @@ static void paint(struct ui_view* v) {
     const int32_t h = v->h < background.h ? v->h : background.h;
     const int32_t x = (v->w - w) / 2;
     const int32_t y = (v->h - h) / 2;
-    ui_draw.bitmap(x, y, w, h, 0, 0, background.w, background.h, &background);
-    if (animated_movie.gif->pixels != null) { paint_movie(&animated_movie); }
-    if (animated_groot.gif->pixels != null) { paint_groot(&animated_groot); }
+    if (background.pixels != null) {
+        ui_draw.bitmap(x, y, w, h, 0, 0, background.w, background.h,
+                       &background);
+    }
+    if (ui_animation.frame(&movie) != null) { paint_movie(&animated_movie); }
+    if (ui_animation.frame(&groot) != null) { paint_groot(&animated_groot); }
     paint_mute_unmute(v);
 }
 
@@ -189,42 +184,26 @@ static void delete_midi_file(void) {
     posix_fatal_if_error(posix_files.unlink(midi_file()));
 }
 
-static void load_gif(animated_gif_t* g, const char* name) {
+static void load_gif(struct ui_animation* g, const char* name) {
     void* data = null;
     int64_t bytes = 0;
     errno_t r = posix_mem.map_resource(name, &data, &bytes);
     posix_fatal_if_error(r);
-    // load_animated_gif() calls realloc(delays) w/o first alloc()
-    r = posix_heap.allocate(null, (void**)&g->delays, sizeof(int32_t), false);
-    posix_swear(r == 0 && g->delays != null);
-    g->pixels = load_animated_gif(data, bytes, &g->delays,
-        &g->w, &g->h, &g->frames, &g->bpp, 4);
+    // frames are decoded on ui_animation thread 2 frames ahead of paint():
+    r = ui_animation.init(g, data, bytes, 3);
+    posix_fatal_if_error(r);
     // resources cannot be unmapped do not call posix_mem.unmap()
 }
 
-static void load_gifs(void) {
-    load_gif(&movie, "gotg_gif");
-    posix_swear(movie.pixels != null &&
-             movie.bpp == 4 &&  movie.frames >= 1,
-             "%s", stbi_failure_reason());
-    load_gif(&groot, "groot_gif");
-    posix_swear(groot.pixels != null && groot.bpp == 4 && groot.frames >= 1,
-             "%s", stbi_failure_reason());
-}
-
-static void schedule_next_animation(struct posix_work* work) {
+static bool next_frame(struct posix_work* work) {
+    // returns true if animation switched to the next frame
     animation_t* a = (animation_t*)work->data;
-    posix_swear(0 <= a->index && a->index < a->gif->frames);
-    // milliseconds to seconds:
-    fp64_t ds = a->gif->delays[a->index] * 0.001; // delay in seconds
-    work->when = posix_clock.seconds() + ds;
-    ui_app.post(work);
+    const struct ui_animation_frame* f = ui_animation.frame(a->gif);
+    work->when = ui_animation.advance(a->gif, posix_clock.seconds());
+    return ui_animation.frame(a->gif) != f;
 }
 
-static void dancing_step(struct posix_work* work) {
-    posix_swear(posix_thread.id() == ui_app.tid);
-    animation_t* a = (animation_t*)work->data;
-    animated_gif_t* g = (animated_gif_t*)a->gif;
+static void dance(animation_t* a, const struct ui_animation* g) {
     int32_t multiplier = 1;
     while (g->w * multiplier < ui_app.crc.w / 2 &&
            g->h * multiplier < ui_app.crc.h / 2) {
@@ -239,7 +218,6 @@ static void dancing_step(struct posix_work* work) {
 //  posix_println("%d %d speed: %d %d", a->x, a->y,
 //                                   a->speed_x,
 //                                   a->speed_y);
-    a->index = (a->index + 1) % g->frames;
     while (a->speed_x == 0) {
         const uint32_t r = posix_num.random32(&a->seed);
         a->speed_x = r % (max_speed * 2 + 1) - max_speed;
@@ -274,33 +252,43 @@ static void dancing_step(struct posix_work* work) {
             a->speed_y += inc;
         }
     }
-    ui_app.request_redraw();
-    schedule_next_animation(work);
+}
+
+static void dancing_step(struct posix_work* work) {
+    posix_swear(posix_thread.id() == ui_app.tid);
+    animation_t* a = (animation_t*)work->data;
+    const struct ui_animation* g = a->gif;
+    if (next_frame(work)) {
+        dance(a, g);
+        ui_app.request_redraw();
+    }
+    ui_app.post(work);
 }
 
 static void movie_step(struct posix_work* work) {
     posix_swear(posix_thread.id() == ui_app.tid);
     animation_t* a = (animation_t*)work->data;
-    animated_gif_t* g = (animated_gif_t*)a->gif;
-    int32_t multiplier = 1;
-    while (g->w * multiplier < ui_app.crc.w &&
-           g->h * multiplier < ui_app.crc.h) {
-        multiplier++;
+    const struct ui_animation* g = a->gif;
+    if (next_frame(work)) {
+        int32_t multiplier = 1;
+        while (g->w * multiplier < ui_app.crc.w &&
+               g->h * multiplier < ui_app.crc.h) {
+            multiplier++;
+        }
+        a->w = g->w * multiplier;
+        a->h = g->h * multiplier;
+        a->x = (ui_app.crc.w - a->w) / 2;
+        a->y = (ui_app.crc.h - a->h) / 2;
+        ui_app.request_redraw();
     }
-    a->w = g->w * multiplier;
-    a->h = g->h * multiplier;
-    a->x = (ui_app.crc.w - a->w) / 2;
-    a->y = (ui_app.crc.h - a->h) / 2;
-    a->index = (a->index + 1) % g->frames;
-    ui_app.request_redraw();
-    schedule_next_animation(work);
+    ui_app.post(work);
 }
 
-static void animated_gifs_loader(void* posix_unused(unused)) {
-    ui_cursor_t cursor = ui_app.cursor;
-    ui_app.set_cursor(ui_app.cursors.wait);
-    load_gifs();
-    ui_app.set_cursor(cursor);
+static void play_gifs(void) {
+    // no need to wait for all frames to be decoded: playback starts
+    // as soon as ui_animation decoded the first frame
+    load_gif(&movie, "gotg_gif");
+    load_gif(&groot, "groot_gif");
     static struct posix_work dancing = { .work = dancing_step,
                                  .data = &animated_groot };
     ui_app.post(&dancing);
@@ -309,20 +297,29 @@ static void animated_gifs_loader(void* posix_unused(unused)) {
     ui_app.post(&cinema);
 }
 
-static void load_png(void) { // from resources
+static void png_decoded(struct posix_work* posix_unused(w)) {
+    posix_swear(posix_thread.id() == ui_app.tid);
+    const struct ui_bitmap* b = &background_png.image;
+    posix_swear(background_png.error == 0 && b->pixels != null);
+    ui_draw.bitmap_init(&background, b->w, b->h, b->bpp, b->pixels);
+    ui_decode.release(&background_png);
+    ui_app.request_redraw();
+}
+
+static void load_png(void) { // from resources on ui_decode worker thread
     void* data = null;
     int64_t bytes = 0;
     posix_fatal_if_error(posix_mem.map_resource("sample_png", &data, &bytes));
-    int w = 0;
-    int h = 0;
-    int bpp = 0; // bytes (!) per pixel
-    void* pixels = load_image(data, bytes, &w, &h, &bpp, 0);
-    if (pixels == null) {
-        posix_println("%s", stbi_failure_reason());
-    }
-    posix_not_null(pixels);
-    ui_draw.bitmap_init(&background, w, h, bpp, pixels);
-    stbi_image_free(pixels);
+    ui_decode.codec = (struct ui_decode_codec){
+        .info    = image_info,
+        .decode  = load_image,
+        .dispose = free_image
+    };
+    background_png.data  = data;
+    background_png.bytes = bytes;
+    background_png.post  = ui_app.post;
+    background_png.done.work = png_decoded;
+    ui_decode.decode(&background_png);
 }
 
 static void start_music(struct posix_work* posix_unused(w)) {
@@ -334,7 +331,7 @@ static void opened(void) {
     animated_groot.x = -1;
     animated_groot.y = -1;
     animated_groot.gif = &groot;
-    thread = posix_thread.start(animated_gifs_loader, null);
+    play_gifs();
     // start music after first paint() call:
     static struct posix_work music = { .work = start_music };
     music.when = posix_clock.seconds() + 0.125;
@@ -342,7 +339,6 @@ static void opened(void) {
 }
 
 static void closed(void) {
-    posix_thread.join(thread, -1);
     if (ui_midi.is_open(&midi)) {
         // restore pre-muted volume:
         posix_fatal_if_error(ui_midi.set_volume(&midi,
@@ -362,30 +358,28 @@ static void init(void) {
 }
 
 static void fini(void) {
-    ui_draw.bitmap_dispose(&background);
-    stbi_image_free(groot.pixels);
-    stbi_image_free(groot.delays);
-    stbi_image_free(movie.pixels);
-    stbi_image_free(movie.delays);
+    ui_decode.dispose();
+    if (background.pixels != null) { ui_draw.bitmap_dispose(&background); }
+    ui_animation.dispose(&groot);
+    ui_animation.dispose(&movie);
     delete_midi_file();
 }
 
-static void* load_image(const uint8_t* data, int64_t bytes,
-        int32_t* w, int32_t* h, int32_t* bpp, int32_t preferred_bpp) {
-    void* pixels = stbi_load_from_memory(data, (int32_t)bytes, w, h,
-        bpp, preferred_bpp);
-    return pixels;
+static bool image_info(const void* data, int64_t bytes,
+        int32_t* w, int32_t* h, int32_t* bpp) {
+    return stbi_info_from_memory((const stbi_uc*)data, (int32_t)bytes,
+        w, h, bpp) != 0;
 }
 
-static void* load_animated_gif(const uint8_t* data, int64_t bytes,
-        int32_t** delays,
-        int32_t* w, int32_t* h, int32_t* frames, int32_t* bpp,
-        int32_t preferred_bpp) {
-    stbi_uc* pixels = stbi_load_gif_from_memory(data, (int32_t)bytes,
-        delays, w, h, frames, bpp, preferred_bpp);
+static void* load_image(const void* data, int64_t bytes,
+        int32_t* w, int32_t* h, int32_t* bpp, int32_t preferred_bpp) {
+    void* pixels = stbi_load_from_memory((const stbi_uc*)data, (int32_t)bytes,
+        w, h, bpp, preferred_bpp);
     return pixels;
 }
 
+static void free_image(void* pixels) { stbi_image_free(pixels); }
+
 static const char* midi_file(void) {
     // resource -> temporary file unpacking because ancient MIDI Win32 API
     //             does not support memory buffers (or I didn't find it)
@@ -25,12 +25,13 @@ static int32_t frame_border = 1;
 static struct ui_bitmap image;
 static uint32_t pixels[1024][1024];
 
-static fp64_t zoom = 0.5;
-static fp64_t sx = 0.25; // [0..1]
-static fp64_t sy = 0.25; // [0..1]
+// view of [-2.00..0.47] x [-1.12..1.12] scaled by zoom = 1 / (2^level)
+// centered at fixed point .deep.cx, .deep.cy (see ui_mandelbrot.h)
+
+enum { max_level = 390 }; // pixel size ~1e-120
 
-static struct { fp64_t x; fp64_t y; } stack[52];
-static int top = 1; // because it is already zoomed in once above
+static struct ui_mandelbrot fractal;
+static fp64_t zoom = 0.5;
 
 static struct ui_slider zoomer;
 
@@ -262,11 +263,14 @@ static void right_paint(struct ui_view* v) {
     println(&x, &y, "%s %d %d", posix_nls.str("Mouse"),
             ui_app.mouse.x, ui_app.mouse.y);
     println(&x, &y, "%d x paint()", ui_app.paint_count);
+    println(&x, &y, "%s %.1f%%", posix_nls.str("computed pixels"),
+            fractal.cache.computed * 100.0 /
+            posix_max(1, fractal.cache.computed + fractal.cache.reused));
     println(&x, &y, "%.1fms (%s %.1f %s %.1f)",
             ui_app.paint_time * 1000.0,
             posix_nls.str("max"), ui_app.paint_max * 1000.0,
             posix_nls.str("avg"), ui_app.paint_avg * 1000.0);
-    after(&zoomer.view, "%.16f", zoom);
+    after(&zoomer.view, "%.3e", zoom);
     after(&scroll, "%s", scroll.state.pressed ?
         posix_nls.str("Natural") : posix_nls.str("Reverse"));
     ta = restore;
@@ -316,22 +320,21 @@ static void layout(struct ui_view* posix_unused(view)) {
 
 static void refresh(void);
 
-static void zoom_out(void) {
-    posix_assert(top > 0);
-    top--;
-    sx = stack[top].x;
-    sy = stack[top].y;
+static void pan(fp64_t x, fp64_t y) { // in pixels
+    ui_mandelbrot.add(&fractal.deep.cx, x * zoom * 2.47 / image.w);
+    ui_mandelbrot.add(&fractal.deep.cy, y * zoom * 2.24 / image.h);
+}
+
+// zoom_in() and zoom_out() keep complex point under pixel x, y in place
+
+static void zoom_out(int x, int y) {
+    pan(-(x - image.w / 2), -(y - image.h / 2));
     zoom *= 2;
 }
 
 static void zoom_in(int x, int y) {
-    posix_assert(top < posix_countof(stack));
-    stack[top].x = sx;
-    stack[top].y = sy;
-    top++;
+    pan((x - image.w / 2) / 2.0, (y - image.h / 2) / 2.0);
     zoom /= 2;
-    sx += zoom * x / image.w;
-    sy += zoom * y / image.h;
 }
 
 static bool tap(struct ui_view* posix_unused(v), int32_t ix, bool pressed) {
@@ -341,9 +344,9 @@ static bool tap(struct ui_view* posix_unused(v), int32_t ix, bool pressed) {
         int y = ui_app.mouse.y - (panel_center.h - image.h) / 2 - panel_center.y;
         if (0 <= x && x < image.w && 0 <= y && y < image.h) {
             if (pressed && ix == 2) {
-                if (zoom < 1) { zoom_out(); refresh(); }
+                if (zoom < 1) { zoom_out(x, y); refresh(); }
             } else if (pressed && ix == 0) {
-                if (top < posix_countof(stack)) { zoom_in(x, y); refresh(); }
+                if (zoomer.value < max_level) { zoom_in(x, y); refresh(); }
             }
         }
         ui_app.request_redraw();
@@ -361,7 +364,7 @@ static void zoomer_callback(struct ui_view* v) {
     fp64_t z = 1;
     for (int i = 0; i < slider->value; i++) { z /= 2; }
     while (zoom > z) { zoom_in(image.w / 2, image.h / 2); }
-    while (zoom < z) { zoom_out(); }
+    while (zoom < z) { zoom_out(image.w / 2, image.h / 2); }
     refresh();
 }
 
@@ -369,8 +372,7 @@ static void mouse_scroll(struct ui_view* unused, struct ui_point dx_dy) {
     (void)unused;
     if (!scroll.state.pressed) { dx_dy.y = -dx_dy.y; }
     if (!scroll.state.pressed) { dx_dy.x = -dx_dy.x; }
-    sx = sx + zoom * dx_dy.x / image.w;
-    sy = sy + zoom * dx_dy.y / image.h;
+    pan(dx_dy.x, dx_dy.y);
     refresh();
 }
 
@@ -381,7 +383,7 @@ static void character(struct ui_view* view, const char* utf8) {
     } else if (ch == 033 && ui_app.is_full_screen) {
         flip_full_clicked(&button_full_screen);
     } else if (ch == '+' || ch == '=') {
-        zoom /= 2; refresh();
+        if (zoomer.value < max_level) { zoom /= 2; refresh(); }
     } else if (ch == '-' || ch == '_') {
         zoom = zoom * 2 < 1.0 ? zoom * 2 : 1.0; refresh();
     } else if (ch == '<' || ch == ',') {
@@ -447,10 +449,10 @@ static void opened(void) {
     button_locale.shortcut = 'l';
     button_full_screen.shortcut = 'f';
 #ifdef SAMPLE9_USE_STATIC_UI_VIEW_MACROS
-    ui_slider_init(&zoomer, "Zoom: 1 / (2^%d)", 7.0, 0, posix_countof(stack) - 1,
+    ui_slider_init(&zoomer, "Zoom: 1 / (2^%d)", 7.0, 0, max_level,
         zoomer_callback);
 #else
-    zoomer = (struct ui_slider)ui_slider("Zoom: 1 / (2^%d)", 7.0, 0, posix_countof(stack) - 1,
+    zoomer = (struct ui_slider)ui_slider("Zoom: 1 / (2^%d)", 7.0, 0, max_level,
         slider_format, zoomer_callback);
 #endif
     posix_str_printf(button_mbx.hint, "Show Yes/No message box");
@@ -473,64 +475,75 @@ static void opened(void) {
         &panel_right,
         &panel_bottom,
         null);
+    ui_mandelbrot.fixed(&fractal.deep.cx, -0.765);
+    ui_mandelbrot.fixed(&fractal.deep.cy, 0.0);
     refresh();
 }
 
+static void closed(void) {
+    ui_mandelbrot.dispose(&fractal); // reference orbit and cached counts
+}
+
 static void init(void) {
     ui_app.title = TITLE;
     ui_app.opened = opened;
-}
-
-static fp64_t scale0to1(int v, int range, fp64_t sh, fp64_t zm) {
-    return sh + zm * v / range;
-}
-
-static fp64_t into(fp64_t v, fp64_t lo, fp64_t hi) {
-    posix_assert(0 <= v && v <= 1);
-    return v * (hi - lo) + lo;
+    ui_app.closed = closed;
 }
 
 static void mandelbrot(struct ui_bitmap* im) {
+    // iteration counts are rendered in place of 4 bytes per pixel
+    struct ui_mandelbrot* m = &fractal;
+    m->dx = zoom * 2.47 / im->w;
+    m->dy = zoom * 2.24 / im->h;
+    m->w  = im->w;
+    m->h  = im->h;
+    m->iterations = 100 + zoomer.value * 20; // deeper views need more
+    m->counts = (int32_t*)im->pixels;
+    m->stride = im->stride / 4;
+    // pixels of the previous view are reused (see .cache)
+    posix_fatal_if(ui_mandelbrot.update(m) != 0);
+    // 16 colors palette as cyclic gradient in linear light (entry 256
+    // is entry 0): every other iteration count is a palette color and
+    // the rest are halfway between them
+    static uint32_t palette[257];
+    if (palette[0] == 0) {
+        static const uint32_t stops[17] = {
+            ui_color_rgb( 66,  30,  15),  ui_color_rgb( 25,   7,  26),
+            ui_color_rgb(  9,   1,  47),  ui_color_rgb(  4,   4,  73),
+            ui_color_rgb(  0,   7, 100),  ui_color_rgb( 12,  44, 138),
+            ui_color_rgb( 24,  82, 177),  ui_color_rgb( 57, 125, 209),
+            ui_color_rgb(134, 181, 229),  ui_color_rgb(211, 236, 248),
+            ui_color_rgb(241, 233, 191),  ui_color_rgb(248, 201,  95),
+            ui_color_rgb(255, 170,   0),  ui_color_rgb(204, 128,   0),
+            ui_color_rgb(153,  87,   0),  ui_color_rgb(106,  52,   3),
+            ui_color_rgb( 66,  30,  15)
+        };
+        ui_colormap.gradient(palette, posix_countof(palette), stops, null,
+                             posix_countof(stops), ui_colormap_linear);
+        ui_pixels.rgbx((uint8_t*)palette, (uint8_t*)palette,
+                       posix_countof(palette), true); // BGRA
+    }
     for (int r = 0; r < im->h; r++) {
-        fp64_t y0 = into(scale0to1(r, im->h, sy, zoom), -1.12, 1.12);
+        int32_t* counts = m->counts + r * m->stride;
         for (int c = 0; c < im->w; c++) {
-            fp64_t x0 = into(scale0to1(c, im->w, sx, zoom), -2.00, 0.47);
-            fp64_t x = 0;
-            fp64_t y = 0;
-            int iteration = 0;
-            enum { max_iteration = 100 };
-            while (x* x + y * y <= 2 * 2 && iteration < max_iteration) {
-                fp64_t t = x * x - y * y + x0;
-                y = 2 * x * y + y0;
-                x = t;
-                iteration++;
-            }
-            static ui_color_t palette[16] = {
-                ui_color_rgb( 66,  30,  15),  ui_color_rgb( 25,   7,  26),
-                ui_color_rgb(  9,   1,  47),  ui_color_rgb(  4,   4,  73),
-                ui_color_rgb(  0,   7, 100),  ui_color_rgb( 12,  44, 138),
-                ui_color_rgb( 24,  82, 177),  ui_color_rgb( 57, 125, 209),
-                ui_color_rgb(134, 181, 229),  ui_color_rgb(211, 236, 248),
-                ui_color_rgb(241, 233, 191),  ui_color_rgb(248, 201,  95),
-                ui_color_rgb(255, 170,   0),  ui_color_rgb(204, 128,   0),
-                ui_color_rgb(153,  87,   0),  ui_color_rgb(106,  52,   3)
-            };
-            ui_color_t color = palette[iteration % posix_countof(palette)];
-            uint8_t* px = &((uint8_t*)im->pixels)[r * im->w * 4 + c * 4];
-            px[3] = 0xFF;
-            px[0] = (color >> 16) & 0xFF;
-            px[1] = (color >>  8) & 0xFF;
-            px[2] = (color >>  0) & 0xFF;
+            counts[c] = (int32_t)palette[(counts[c] * 8) % 256];
         }
     }
 }
 
 static void refresh(void) {
-    if (sx < 0) { sx = 0; }
-    if (sx > 1 - zoom) { sx = 1 - zoom; }
-    if (sy < 0) { sy = 0; }
-    if (sy > 1 - zoom) { sy = 1 - zoom; }
-    if (zoom == 1) { sx = 0; sy = 0; }
+    // keep center inside of [-2.00..0.47] x [-1.12..1.12]
+    const fp64_t x = ui_mandelbrot.fp64(&fractal.deep.cx);
+    const fp64_t y = ui_mandelbrot.fp64(&fractal.deep.cy);
+    if (x < -2.00) { ui_mandelbrot.fixed(&fractal.deep.cx, -2.00); }
+    if (x >  0.47) { ui_mandelbrot.fixed(&fractal.deep.cx,  0.47); }
+    if (y < -1.12) { ui_mandelbrot.fixed(&fractal.deep.cy, -1.12); }
+    if (y >  1.12) { ui_mandelbrot.fixed(&fractal.deep.cy,  1.12); }
+    if (zoom >= 1) {
+        zoom = 1;
+        ui_mandelbrot.fixed(&fractal.deep.cx, -0.765);
+        ui_mandelbrot.fixed(&fractal.deep.cy,  0.0);
+    }
     zoomer.value = 0;
     fp64_t z = 1;
     while (z != zoom) { zoomer.value++; z /= 2; }
@@ -3187,8 +3187,8 @@ static int posix_files_flush(struct posix_file* file) {
     return posix_b2e(FlushFileBuffers((HANDLE)file));
 }
 
-static void posix_files_close(struct posix_file* file) {
-    posix_win32_close_handle((HANDLE)file);
+static int posix_files_close(struct posix_file* file) {
+    return posix_b2e(CloseHandle((HANDLE)file));
 }
 
 static int posix_files_write_fully(const char* filename, const void* data,
@@ -3570,9 +3570,9 @@ static int posix_files_flush(struct posix_file* file) {
     return fsync(fd) == 0 ? 0 : errno;
 }
 
-static void posix_files_close(struct posix_file* file) {
+static int posix_files_close(struct posix_file* file) {
     int fd = (int)(intptr_t)file;
-    if (fd >= 0) { close(fd); }
+    return fd < 0 || close(fd) == 0 ? 0 : errno;
 }
 
 static int posix_files_write_fully(const char* filename, const void* data, int64_t bytes, int64_t *transferred) {
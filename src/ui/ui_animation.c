@@ -0,0 +1,211 @@
+/* Copyright (c) Dmitry "Leo" Kuznetsov 2021-24 see LICENSE for details */
+#include "posix/posix.h"
+#include "ui/ui_gif.h"
+#include "ui/ui_animation.h"
+
+#undef UI_ANIMATION_TEST
+
+#if 0 // flip to 1 to run tests
+
+#define UI_ANIMATION_TEST
+
+#endif
+
+static void ui_animation_decoder(void* p) {
+    struct ui_animation* a = (struct ui_animation*)p;
+    posix_thread.name("ui_animation");
+    const int64_t frame_bytes = (int64_t)a->w * a->h * 4;
+    for (;;) {
+        while (posix_atomics.load32(&a->ready) >= a->ring_frames - 1 &&
+               posix_atomics.load32(&a->quit) == 0) {
+            posix_event.wait(a->wake);
+        }
+        if (posix_atomics.load32(&a->quit) != 0) { break; }
+        fp64_t time = posix_clock.seconds();
+        const int r = ui_gif.next(&a->gif);
+        if (r != 0) {
+            posix_atomics.exchange_int32(&a->error, r);
+            break;
+        }
+        struct ui_animation_frame* f = &a->ring[a->tail];
+        memcpy(f->pixels, a->gif.canvas, (size_t)frame_bytes);
+        f->index = a->gif.index;
+        f->delay = a->gif.delay;
+        a->stats.decode += posix_clock.seconds() - time;
+        a->stats.played += f->delay / 1000.0;
+        a->stats.decoded++;
+        posix_atomics.exchange_int64(&a->bytes,
+            ui_gif.memory(&a->gif) + frame_bytes * a->ring_frames);
+        a->tail = (a->tail + 1) % a->ring_frames;
+        posix_atomics.increment_int32(&a->ready); // publishes the frame
+    }
+}
+
+static int ui_animation_init(struct ui_animation* a, const void* data,
+        int64_t bytes, int32_t ring_frames) {
+    posix_swear(2 <= ring_frames && ring_frames <= ui_animation_max_ring);
+    memset(a, 0x00, sizeof(*a));
+    int r = ui_gif.init(&a->gif, data, bytes);
+    if (r == 0) {
+        a->w = a->gif.w;
+        a->h = a->gif.h;
+        a->ring_frames = ring_frames;
+        a->current = -1;
+        const int64_t frame_bytes = (int64_t)a->w * a->h * 4;
+        for (int32_t i = 0; i < ring_frames && r == 0; i++) {
+            r = posix_heap.alloc_zero((void**)&a->ring[i].pixels, frame_bytes);
+        }
+        a->bytes = ui_gif.memory(&a->gif) + frame_bytes * a->ring_frames;
+    }
+    if (r == 0) {
+        a->wake = posix_event.create();
+        a->thread = posix_thread.start(ui_animation_decoder, a);
+    } else {
+        ui_animation.dispose(a);
+    }
+    return r;
+}
+
+static const struct ui_animation_frame* ui_animation_frame(
+        const struct ui_animation* a) {
+    return a->current >= 0 ? &a->ring[a->current] : null;
+}
+
+static fp64_t ui_animation_advance(struct ui_animation* a, fp64_t now) {
+    fp64_t next = a->due;
+    if (a->current < 0 || now >= a->due) {
+        if (posix_atomics.load32(&a->ready) > 0) {
+            const bool first = a->current < 0;
+            a->current = (a->current + 1) % a->ring_frames;
+            posix_atomics.decrement_int32(&a->ready);
+            posix_event.set(a->wake); // frame is free for the decoder
+            const fp64_t delay = a->ring[a->current].delay / 1000.0;
+            // more than a frame behind schedule: restart from `now`
+            a->due = first || now - a->due > delay ? now + delay : a->due + delay;
+            next = a->due;
+        } else {
+            if (a->current >= 0 && posix_atomics.load32(&a->error) == 0) {
+                a->stats.late++;
+            }
+            next = now + 0.001; // decoder is behind or failed
+        }
+    }
+    return next;
+}
+
+static int64_t ui_animation_memory(const struct ui_animation* a) {
+    return posix_atomics.load64((volatile int64_t*)&a->bytes);
+}
+
+static void ui_animation_dispose(struct ui_animation* a) {
+    if (a->thread != null) {
+        posix_atomics.exchange_int32(&a->quit, 1);
+        posix_event.set(a->wake);
+        posix_fatal_if(posix_thread.join(a->thread, -1) != 0);
+        a->thread = null;
+    }
+    if (a->wake != null) {
+        posix_event.dispose(a->wake);
+        a->wake = null;
+    }
+    for (int32_t i = 0; i < ui_animation_max_ring; i++) {
+        if (a->ring[i].pixels != null) { posix_heap.free(a->ring[i].pixels); }
+        a->ring[i].pixels = null;
+    }
+    ui_gif.dispose(&a->gif);
+    a->current = -1;
+    a->ready = 0;
+}
+
+// Test animation: 3 x 1 canvas, 1 x 1 frames moving left to right,
+// frame k color index k % 4 and delay (k + 2) centiseconds
+
+enum { ui_animation_test_frames = 5 };
+
+static int32_t ui_animation_test_gif(uint8_t* d) {
+    int32_t n = 0;
+    static const uint8_t header[] = {
+        'G', 'I', 'F', '8', '9', 'a', 3, 0, 1, 0, 0x81, 0, 0,
+        0x10, 0x20, 0x30, 0x40, 0x50, 0x60, 0x70, 0x80, 0x90, 0xA0, 0xB0, 0xC0
+    };
+    memcpy(d, header, sizeof(header));
+    n += (int32_t)sizeof(header);
+    for (int32_t k = 0; k < ui_animation_test_frames; k++) {
+        const uint8_t gce[] = { 0x21, 0xF9, 4, 1 << 2, (uint8_t)(k + 2), 0, 0, 0 };
+        memcpy(d + n, gce, sizeof(gce));
+        n += (int32_t)sizeof(gce);
+        // LZW 3 bit codes: clear (4), color index, end of information (5)
+        const int32_t v = 4 | (k % 4) << 3 | 5 << 6;
+        const uint8_t image[] = { 0x2C, (uint8_t)(k % 3), 0, 0, 0, 1, 0, 1, 0, 0,
+                                  2, 2, (uint8_t)v, (uint8_t)(v >> 8), 0 };
+        memcpy(d + n, image, sizeof(image));
+        n += (int32_t)sizeof(image);
+    }
+    d[n++] = 0x3B;
+    return n;
+}
+
+static void ui_animation_test_wait(struct ui_animation* a, int32_t ready) {
+    while (posix_atomics.load32(&a->ready) < ready) {
+        posix_thread.sleep_for(0.0001);
+    }
+}
+
+static void ui_animation_test(void) {
+    static uint8_t data[256];
+    const int32_t bytes = ui_animation_test_gif(data);
+    posix_swear(bytes <= posix_countof(data));
+    struct ui_animation a = {0};
+    posix_swear(ui_animation.init(&a, data, bytes, 3) == 0);
+    posix_swear(a.w == 3 && a.h == 1 && ui_animation.frame(&a) == null);
+    posix_swear(ui_animation.memory(&a) >= 4 * 3 * 4);
+    // first advance() shows first frame as soon as it is decoded:
+    ui_animation_test_wait(&a, 1);
+    fp64_t now = 100.0;
+    fp64_t due = ui_animation.advance(&a, now);
+    posix_swear(due == now + 0.020);
+    posix_swear(ui_animation.frame(&a)->index == 0);
+    // not yet due:
+    posix_swear(ui_animation.advance(&a, due - 0.001) == due);
+    posix_swear(ui_animation.frame(&a)->index == 0);
+    for (int32_t i = 1; i < ui_animation_test_frames * 3; i++) {
+        const int32_t k = i % ui_animation_test_frames;
+        ui_animation_test_wait(&a, 1);
+        now = due + 0.0005; // called late, next due is not affected
+        const fp64_t next = ui_animation.advance(&a, now);
+        const struct ui_animation_frame* f = ui_animation.frame(&a);
+        posix_swear(f->index == k && f->delay == (k + 2) * 10);
+        posix_swear(next == due + f->delay / 1000.0);
+        const uint8_t* rgba = f->pixels + (k % 3) * 4;
+        posix_swear(rgba[0] == 0x10 + (k % 4) * 0x30 && rgba[3] == 0xFF);
+        due = next;
+    }
+    // more than a frame behind: schedule restarts from now
+    ui_animation_test_wait(&a, 1);
+    now = due + 10.0;
+    due = ui_animation.advance(&a, now);
+    posix_swear(due == now + ui_animation.frame(&a)->delay / 1000.0);
+    // decoder never runs more than ring_frames - 1 ahead:
+    ui_animation_test_wait(&a, 2);
+    posix_thread.sleep_for(0.01);
+    posix_swear(posix_atomics.load32(&a.ready) == 2);
+    ui_animation.dispose(&a);
+    posix_swear(a.error == 0 && a.stats.decoded >= ui_animation_test_frames * 3);
+    posix_swear(ui_animation.init(&a, data, 10, 2) == EINVAL);
+    if (posix_debug.verbosity.level > posix_debug.verbosity.quiet) {
+        posix_println("done");
+    }
+}
+
+struct ui_animation_if ui_animation = {
+    .init    = ui_animation_init,
+    .frame   = ui_animation_frame,
+    .advance = ui_animation_advance,
+    .memory  = ui_animation_memory,
+    .dispose = ui_animation_dispose,
+    .test    = ui_animation_test
+};
+
+#ifdef UI_ANIMATION_TEST
+    posix_static_init(ui_animation) { ui_animation.test(); }
+#endif
@@ -17,6 +17,10 @@ static MONITORINFO ui_app_mi = {sizeof(MONITORINFO)};
 
 static posix_event_t ui_app_event_quit;
 static posix_event_t ui_app_event_invalidate;
+// invalidated rectangles accumulated until redraw thread picks them up:
+static struct ui_region ui_app_invalid;
+static struct posix_mutex ui_app_invalid_lock;
+static volatile int32_t ui_app_redraw_all; // request_redraw() from any thread
 static posix_event_t ui_app_wt; // waitable timer;
 
 static struct posix_work_queue ui_app_queue;
@@ -101,6 +105,8 @@ static void ui_app_alarm_thread(void* posix_unused(p)) {
 // which is unacceptable for video drawing at monitor
 // refresh rate
 
+static RECT ui_app_ui2rect(const struct ui_rect* u);
+
 static void ui_app_redraw_thread(void* posix_unused(p)) {
     posix_thread.realtime();
     posix_thread.name("ui_app.redraw");
@@ -108,8 +114,20 @@ static void ui_app_redraw_thread(void* posix_unused(p)) {
         posix_event_t es[] = { ui_app_event_invalidate, ui_app_event_quit };
         int32_t ix = posix_event.wait_any(posix_countof(es), es);
         if (ix == 0) {
-            if (ui_app_window() != null) {
+            posix_mutex.lock(&ui_app_invalid_lock);
+            const struct ui_region rg = ui_app_invalid;
+            ui_region.reset(&ui_app_invalid);
+            posix_mutex.unlock(&ui_app_invalid_lock);
+            const bool all = posix_atomics.exchange_int32(&ui_app_redraw_all, 0) != 0;
+            if (ui_app_window() == null) {
+                // nothing to invalidate
+            } else if (all) {
                 InvalidateRect(ui_app_window(), null, false);
+            } else {
+                for (int32_t i = 0; i < rg.count; i++) {
+                    RECT rc = ui_app_ui2rect(&rg.r[i]);
+                    InvalidateRect(ui_app_window(), &rc, false);
+                }
             }
         } else {
             break;
@@ -737,6 +755,7 @@ static void ui_app_measure_and_layout(struct ui_view* view) {
     if (ui_app.crc.w > 0 && ui_app.crc.h > 0 && ui_app_window() != null) {
         ui_view.measure(view);
         ui_view.layout(view);
+        if (view == ui_app.root) { ui_view.index(view); }
         ui_app_layout_dirty = false;
     }
 }
@@ -1131,6 +1150,13 @@ static void ui_app_view_active_frame_paint(void) {
 
 static void ui_app_paint_stats(void) {
     if (ui_app.paint_count % 128 == 0) { ui_app.paint_max = 0; }
+    ui_app.paint_pixels = ui_region.area(&ui_app.dirty);
+    if (ui_app.paint_pixels_avg == 0) {
+        ui_app.paint_pixels_avg = (fp64_t)ui_app.paint_pixels;
+    } else { // EMA over 32 paint() calls
+        ui_app.paint_pixels_avg = ui_app.paint_pixels_avg * (1.0 - 1.0 / 32.0) +
+                                  (fp64_t)ui_app.paint_pixels / 32.0;
+    }
     ui_app.paint_time = posix_clock.seconds() - ui_app.now;
     ui_app.paint_max = ui_app.paint_time > ui_app.paint_max ? ui_app.paint_time : ui_app.paint_max;
     if (ui_app.paint_avg == 0) {
@@ -1184,13 +1210,43 @@ static void ui_app_paint_on_canvas(HDC hdc) {
     ui_app_paint_stats();
 }
 
+static void ui_app_update_region(void) {
+    // update region of the window (exposed by the system and
+    // invalidated by the app) coalesced into a few rectangles
+    ui_region.reset(&ui_app.dirty);
+    HRGN rgn = CreateRectRgn(0, 0, 0, 0);
+    if (rgn != null) {
+        const int type = GetUpdateRgn(ui_app_window(), rgn, false);
+        if (type == SIMPLEREGION || type == COMPLEXREGION) {
+            struct { RGNDATAHEADER h; RECT r[64]; } stack;
+            RGNDATA* d = (RGNDATA*)&stack;
+            const DWORD bytes = GetRegionData(rgn, 0, null);
+            if (bytes > sizeof(stack)) {
+                posix_swear(posix_heap.alloc((void**)&d, bytes) == 0);
+            }
+            if (bytes > 0 && GetRegionData(rgn, bytes, d) != 0) {
+                const RECT* rc = (const RECT*)d->Buffer;
+                for (DWORD i = 0; i < d->rdh.nCount; i++) {
+                    const struct ui_rect r = ui_app_rect2ui(&rc[i]);
+                    ui_region.add(&ui_app.dirty, &r);
+                }
+            }
+            if (d != (RGNDATA*)&stack) { posix_heap.free(d); }
+        }
+        posix_fatal_win32err(DeleteObject(rgn));
+    }
+}
+
 static void ui_app_wm_paint(void) {
     // it is possible to receive WM_PAINT when window is not closed
     if (ui_app.window != null) {
+        ui_app_update_region(); // before BeginPaint() validates it
         PAINTSTRUCT ps = {0};
         HDC hdc = BeginPaint(ui_app_window(), &ps);
         if (hdc != null) {
             ui_app.prc = ui_app_rect2ui(&ps.rcPaint);
+            if (ui_app.dirty.count == 0) { ui_region.add(&ui_app.dirty, &ui_app.prc); }
+            ui_region.clip(&ui_app.dirty, &ui_app.crc);
             ui_app_paint_on_canvas(hdc);
             EndPaint(ui_app_window(), &ps);
         }
@@ -1774,6 +1830,8 @@ static LRESULT CALLBACK ui_app_window_proc(HWND window, UINT message,
             ui_app_wm_char(ui_app.root, (const uint16_t*)&wp);
             break;
         case WM_PRINTCLIENT  :
+            ui_region.reset(&ui_app.dirty);
+            ui_region.add(&ui_app.dirty, &ui_app.crc);
             ui_app_paint_on_canvas((HDC)wp);
             break;
         case WM_SETFOCUS     :
@@ -2070,6 +2128,8 @@ static void ui_app_full_screen(bool on) {
 static bool ui_app_set_focus(struct ui_view* posix_unused(v)) { return false; }
 
 static void ui_app_request_redraw(void) {  // < 2us
+    // same memory model as exchange_int32() in the redraw thread:
+    (void)posix_atomics.exchange_int32(&ui_app_redraw_all, 1);
     SetEvent(ui_app_event_invalidate);
 }
 
@@ -2079,8 +2139,11 @@ static void ui_app_draw(void) {
 }
 
 static void ui_app_invalidate_rect(const struct ui_rect* r) {
-    RECT rc = ui_app_ui2rect(r);
-    InvalidateRect(ui_app_window(), &rc, false);
+    // InvalidateRect() is called on redraw thread (see above)
+    posix_mutex.lock(&ui_app_invalid_lock);
+    ui_region.add(&ui_app_invalid, r);
+    posix_mutex.unlock(&ui_app_invalid_lock);
+    SetEvent(ui_app_event_invalidate);
 //  posix_backtrace_here();
 }
 
@@ -2104,6 +2167,7 @@ static void ui_app_dispose(void) {
     ui_app_dispose_fonts();
     posix_event.dispose(ui_app_event_invalidate);
     ui_app_event_invalidate = null;
+    posix_mutex.dispose(&ui_app_invalid_lock);
     ui_app_last_next_due_at = 0;
 }
 
@@ -2491,6 +2555,15 @@ static int32_t ui_app_in2px(fp32_t inches) {
 }
 
 static void ui_app_request_layout(void) {
+    ui_view.dirty_all();
+    ui_view.index(null); // until next layout()
+    ui_app_layout_dirty = true;
+    ui_app.request_redraw();
+}
+
+static void ui_app_request_relayout(struct ui_view* v) {
+    ui_view.dirty(v);
+    ui_view.index(null); // views may be added or removed
     ui_app_layout_dirty = true;
     ui_app.request_redraw();
 }
@@ -2571,6 +2644,43 @@ static const char* ui_app_open_file(const char* folder,
 
 // TODO: use clipboard instead?
 
+static HGLOBAL ui_app_clipboard_dibv5(struct ui_bitmap* im) {
+    // CF_BITMAP loses alpha channel. Premultiplied BGRA bitmaps are
+    // also exported as CF_DIBV5 with straight (not premultiplied) alpha
+    const size_t bytes = (size_t)im->w * 4;
+    HGLOBAL global = GlobalAlloc(GMEM_MOVEABLE,
+        sizeof(BITMAPV5HEADER) + bytes * (size_t)im->h);
+    uint8_t* data = global != null ? (uint8_t*)GlobalLock(global) : null;
+    if (data != null) {
+        BITMAPV5HEADER* bh = (BITMAPV5HEADER*)data;
+        memset(bh, 0x00, sizeof(*bh));
+        bh->bV5Size        = sizeof(BITMAPV5HEADER);
+        bh->bV5Width       = im->w;
+        bh->bV5Height      = im->h; // bottom up
+        bh->bV5Planes      = 1;
+        bh->bV5BitCount    = 32;
+        bh->bV5Compression = BI_BITFIELDS;
+        bh->bV5SizeImage   = (DWORD)(bytes * (size_t)im->h);
+        bh->bV5RedMask     = 0x00FF0000;
+        bh->bV5GreenMask   = 0x0000FF00;
+        bh->bV5BlueMask    = 0x000000FF;
+        bh->bV5AlphaMask   = 0xFF000000;
+        bh->bV5CSType      = LCS_sRGB;
+        bh->bV5Intent      = LCS_GM_IMAGES;
+        uint8_t* d = data + sizeof(BITMAPV5HEADER);
+        for (int32_t y = im->h - 1; y >= 0; y--) {
+            const uint8_t* s = (const uint8_t*)im->pixels + (size_t)y * im->stride;
+            ui_pixels.unpremultiply(d, s, im->w);
+            d += bytes;
+        }
+        GlobalUnlock(global);
+    } else if (global != null) {
+        GlobalFree(global);
+        global = null;
+    }
+    return global;
+}
+
 static errno_t ui_app_clipboard_put_image(struct ui_bitmap* im) {
     HDC canvas = GetDC(null);
     posix_not_null(canvas);
@@ -2598,6 +2708,14 @@ static errno_t ui_app_clipboard_put_image(struct ui_bitmap* im) {
             posix_println("SetClipboardData() failed %s", posix_strerr(r));
         }
     }
+    if (r == 0 && im->bpp == 4 && im->pixels != null) {
+        HGLOBAL dib = ui_app_clipboard_dibv5(im);
+        if (dib != null && SetClipboardData(CF_DIBV5, dib) == null) {
+            posix_println("SetClipboardData(CF_DIBV5) failed %s",
+                          posix_strerr(posix_core.err()));
+            GlobalFree(dib);
+        }
+    }
     if (r == 0) {
         r = posix_b2e(CloseClipboard());
         if (r != 0) {
@@ -2643,9 +2761,15 @@ static void ui_app_request_focus(void) {
     window_request_focus(ui_app.window);
 }
 
+static struct ui_wh ui_app_text_metrics(const struct ui_fm* fm,
+        bool multiline, int32_t w, const char* s) {
+    return ui_view.text_metrics(0, 0, multiline, w, fm, "%s", s);
+}
+
 static void ui_app_init(void) {
     ui_app_event_quit           = posix_event.create_manual();
     ui_app_event_invalidate     = posix_event.create();
+    posix_mutex.init(&ui_app_invalid_lock);
     ui_app.request_redraw       = ui_app_request_redraw;
     ui_app.post                 = ui_app_post;
     ui_app.draw                 = ui_app_draw;
@@ -2665,6 +2789,7 @@ static void ui_app_init(void) {
     ui_app.make_topmost         = ui_app_make_topmost;
     ui_app.bring_to_front       = ui_app_bring_to_front;
     ui_app.request_layout       = ui_app_request_layout;
+    ui_app.request_relayout     = ui_app_request_relayout;
     ui_app.invalidate           = ui_app_invalidate_rect;
     ui_app.full_screen          = ui_app_full_screen;
     ui_app.set_cursor           = ui_app_cursor_set;
@@ -2695,6 +2820,9 @@ static void ui_app_init(void) {
     ui_app.root    = &ui_app_view;
     ui_app.content = &ui_app_content;
     ui_app.caption = &ui_caption.view;
+    ui_layout.text_metrics = ui_app_text_metrics;
+    ui_layout.fm   = &ui_app.fm.prop.normal;
+    ui_layout.root = ui_app.root;
     ui_app.root->hit_test = ui_app_root_hit_test;
     ui_view.add(ui_app.root, ui_app.caption, ui_app.content, null);
     ui_view_call_init(ui_app.root); // to get done with container_init()
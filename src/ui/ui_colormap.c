@@ -0,0 +1,976 @@
+/* Copyright (c) Dmitry "Leo" Kuznetsov 2021-24 see LICENSE for details */
+#include "posix/posix.h"
+#include "ui/ui_pixels.h"
+#include "ui/ui_colormap.h"
+#include <math.h>
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__SSE2__)
+#include <emmintrin.h>
+#define ui_colormap_has_sse2
+#if defined(_M_X64) || defined(__x86_64__)
+#include <immintrin.h>
+#define ui_colormap_has_avx2
+#if defined(_MSC_VER)
+#pragma warning(disable: 4752) // AVX instructions w/o /arch:AVX (run time dispatch)
+#define ui_colormap_avx2_target
+#else
+#define ui_colormap_avx2_target __attribute__((target("avx2")))
+#endif
+#endif
+#elif defined(_M_ARM64) || defined(__aarch64__)
+#include <arm_neon.h>
+#define ui_colormap_has_neon
+#endif
+
+// Identical results of all kernels require no contraction to FMA:
+#if defined(_MSC_VER)
+#pragma fp_contract(off)
+#elif defined(__clang__)
+#pragma clang fp contract(off)
+#elif defined(__GNUC__)
+#pragma GCC optimize("fp-contract=off")
+#endif
+
+#undef UI_COLORMAP_TEST
+
+#if 0 // flip to 1 to run tests
+
+#define UI_COLORMAP_TEST
+
+#endif
+
+enum {
+    ui_colormap_chunk   = 256, // colors converted at a time on stack
+    ui_colormap_buckets = 4096 // to_srgb() table of linear [0..1]
+};
+
+struct ui_colormap_kernels {
+    // rgb_to_hsx() hsv: false HSI, true HSV (x is intensity or value)
+    void (*rgb_to_hsx)(const uint32_t* c, fp32_t* h, fp32_t* s, fp32_t* x,
+                       int64_t n, bool hsv);
+    void (*hsi_to_rgb)(uint32_t* d, const fp32_t* h, const fp32_t* s,
+                       const fp32_t* i, uint8_t a, int64_t n);
+    // to_linear() and to_srgb() null: scalar kernels
+    void (*to_linear)(fp32_t* d, const uint8_t* s, int64_t n);
+    void (*to_srgb)(uint8_t* d, const fp32_t* s, int64_t n);
+};
+
+// to_linear() is ui_colormap_decoded[c]. to_srgb() of x in
+// [b / 4096..(b + 1) / 4096) is ui_colormap_bucket[b] or one more if
+// x >= ui_colormap_threshold[ui_colormap_bucket[b]] (at most one
+// threshold per bucket, see ui_colormap_init())
+
+static fp32_t  ui_colormap_decoded[256];
+static fp32_t  ui_colormap_threshold[256]; // [255] is never reached
+static int32_t ui_colormap_bucket[ui_colormap_buckets + 1];
+
+static fp64_t ui_colormap_decode(fp64_t v) { // sRGB [0..1] -> linear
+    return v <= 0.04045 ? v / 12.92 : pow((v + 0.055) / 1.055, 2.4);
+}
+
+static void ui_colormap_init(void) {
+    for (int32_t c = 0; c < 256; c++) {
+        ui_colormap_decoded[c] = (fp32_t)ui_colormap_decode(c / 255.0);
+        // midpoint between c and c + 1 rounds up to c + 1:
+        ui_colormap_threshold[c] = c < 255 ?
+            (fp32_t)ui_colormap_decode((c + 0.5) / 255.0) : 2.0f;
+    }
+    int32_t k = 0;
+    for (int32_t b = 0; b <= ui_colormap_buckets; b++) {
+        const fp32_t x = (fp32_t)b / ui_colormap_buckets;
+        while (ui_colormap_threshold[k] <= x) { k++; }
+        ui_colormap_bucket[b] = k;
+        if (b > 0) { // thresholds are further apart than buckets
+            posix_assert(k - ui_colormap_bucket[b - 1] <= 1);
+        }
+    }
+    posix_assert(ui_colormap_bucket[ui_colormap_buckets] == 255);
+}
+
+// min() and max() are the same as SSE/AVX minps and maxps:
+// the second operand is returned for NaN
+
+static inline fp32_t ui_colormap_min(fp32_t x, fp32_t y) { return x < y ? x : y; }
+
+static inline fp32_t ui_colormap_max(fp32_t x, fp32_t y) { return x > y ? x : y; }
+
+// color_to_hsi() and hsi_to_color() are fp64 single color math behind
+// ui_colors.rgb_to_hsi() and hsi_to_rgb() and the reference of test()
+
+static inline fp64_t ui_colormap_fp64_min(fp64_t x, fp64_t y) { return x < y ? x : y; }
+
+static inline fp64_t ui_colormap_fp64_max(fp64_t x, fp64_t y) { return x > y ? x : y; }
+
+static void ui_colormap_color_to_hsi(fp64_t r, fp64_t g, fp64_t b,
+        fp64_t* h, fp64_t* s, fp64_t* i) {
+    r /= 255.0;
+    g /= 255.0;
+    b /= 255.0;
+    const fp64_t max = ui_colormap_fp64_max(r, ui_colormap_fp64_max(g, b));
+    const fp64_t min = ui_colormap_fp64_min(r, ui_colormap_fp64_min(g, b));
+    const fp64_t chroma = max - min;
+    *i = (r + g + b) / 3;
+    if (chroma == 0) {
+        *h = 0;
+        *s = 0;
+    } else {
+        *s = chroma / (*i * 3); // chroma > 0 implies i > 0
+        if (r == max) {
+            *h = (g - b) / chroma + (g < b ? 6 : 0);
+        } else if (g == max) {
+            *h = (b - r) / chroma + 2;
+        } else {
+            *h = (r - g) / chroma + 4;
+        }
+        *h *= 60;
+    }
+}
+
+static uint32_t ui_colormap_hsi_to_color(fp64_t h, fp64_t s, fp64_t i,
+        uint8_t a) {
+    h /= 60.0;
+    const fp64_t f = h - (int32_t)h;
+    const fp64_t p = i * (1 - s);
+    const fp64_t q = i * (1 - s * f);
+    const fp64_t t = i * (1 - s * (1 - f));
+    fp64_t r = 0, g = 0, b = 0;
+    // h is in [0,6) by construction, but float rounding can produce
+    // exactly 6.0 from h == 360.0 * (1 - eps) input. Treat the default
+    // case as a black pixel (intensity 0) rather than aborting.
+    switch ((int32_t)h) {
+        case 0:
+        case 6: r = i * 255; g = t * 255; b = p * 255; break;
+        case 1: r = q * 255; g = i * 255; b = p * 255; break;
+        case 2: r = p * 255; g = i * 255; b = t * 255; break;
+        case 3: r = p * 255; g = q * 255; b = i * 255; break;
+        case 4: r = t * 255; g = p * 255; b = i * 255; break;
+        case 5: r = i * 255; g = p * 255; b = q * 255; break;
+        default: r = 0; g = 0; b = 0; break;
+    }
+    posix_assert(0 <= r && r <= 255);
+    posix_assert(0 <= g && g <= 255);
+    posix_assert(0 <= b && b <= 255);
+    return (uint32_t)(uint8_t)r | (uint32_t)(uint8_t)g << 8 |
+           (uint32_t)(uint8_t)b << 16 | (uint32_t)a << 24;
+}
+
+// scalar reference kernels:
+
+static void ui_colormap_rgb_to_hsx_scalar(const uint32_t* c, fp32_t* h,
+        fp32_t* s, fp32_t* x, int64_t n, bool hsv) {
+    for (int64_t k = 0; k < n; k++) {
+        const fp32_t r = (fp32_t)((c[k] >>  0) & 0xFF) / 255.0f;
+        const fp32_t g = (fp32_t)((c[k] >>  8) & 0xFF) / 255.0f;
+        const fp32_t b = (fp32_t)((c[k] >> 16) & 0xFF) / 255.0f;
+        const fp32_t max = ui_colormap_max(r, ui_colormap_max(g, b));
+        const fp32_t min = ui_colormap_min(r, ui_colormap_min(g, b));
+        const fp32_t chroma = max - min;
+        x[k] = hsv ? max : (r + g + b) / 3.0f;
+        if (chroma > 0) {
+            s[k] = chroma / (hsv ? max : x[k] * 3.0f);
+            fp32_t hue;
+            if (r == max) {
+                hue = (g - b) / chroma + (g < b ? 6.0f : 0.0f);
+            } else if (g == max) {
+                hue = (b - r) / chroma + 2.0f;
+            } else {
+                hue = (r - g) / chroma + 4.0f;
+            }
+            h[k] = hue * 60.0f;
+        } else {
+            h[k] = 0;
+            s[k] = 0;
+        }
+    }
+}
+
+// hsi_to_rgb() is branchless form of ui_colors.hsi_to_rgb() sectors:
+// channel = i * (1 - s * w) where w is 0, f, 1 or 1 - f depending on
+// position k = (n + h / 60) mod 6 of the channel n: 5 (r), 3 (g), 1 (b)
+
+static inline uint32_t ui_colormap_channel(fp32_t h6, fp32_t s, fp32_t i,
+        fp32_t n) {
+    fp32_t k = n + h6;
+    k = k >= 6.0f ? k - 6.0f : k;
+    const fp32_t w = ui_colormap_max(ui_colormap_min(
+        ui_colormap_min(k, 4.0f - k), 1.0f), 0.0f);
+    fp32_t v = i * (1.0f - s * w) * 255.0f + 0.5f;
+    v = ui_colormap_min(ui_colormap_max(v, 0.0f), 255.0f);
+    return (uint32_t)v;
+}
+
+static void ui_colormap_hsi_to_rgb_scalar(uint32_t* d, const fp32_t* h,
+        const fp32_t* s, const fp32_t* i, uint8_t a, int64_t n) {
+    for (int64_t k = 0; k < n; k++) {
+        const fp32_t h6 = h[k] / 60.0f;
+        d[k] = ui_colormap_channel(h6, s[k], i[k], 5.0f) <<  0 |
+               ui_colormap_channel(h6, s[k], i[k], 3.0f) <<  8 |
+               ui_colormap_channel(h6, s[k], i[k], 1.0f) << 16 |
+               (uint32_t)a << 24;
+    }
+}
+
+static void ui_colormap_to_linear_scalar(fp32_t* d, const uint8_t* s,
+        int64_t n) {
+    for (int64_t k = 0; k < n; k++) { d[k] = ui_colormap_decoded[s[k]]; }
+}
+
+static void ui_colormap_to_srgb_scalar(uint8_t* d, const fp32_t* s,
+        int64_t n) {
+    for (int64_t k = 0; k < n; k++) {
+        fp32_t x = ui_colormap_max(s[k], 0.0f); // NaN -> 0
+        x = ui_colormap_min(x, 1.0f);
+        int32_t c = ui_colormap_bucket[(int32_t)(x * ui_colormap_buckets)];
+        c += x >= ui_colormap_threshold[c];
+        d[k] = (uint8_t)c;
+    }
+}
+
+static const struct ui_colormap_kernels ui_colormap_scalar_kernels = {
+    .rgb_to_hsx = ui_colormap_rgb_to_hsx_scalar,
+    .hsi_to_rgb = ui_colormap_hsi_to_rgb_scalar,
+    .to_linear  = ui_colormap_to_linear_scalar,
+    .to_srgb    = ui_colormap_to_srgb_scalar
+};
+
+#if defined(ui_colormap_has_sse2)
+
+// SSE2 has no blend: select() is and/andnot/or. Masked out lanes may
+// divide by zero chroma (exceptions are masked). No to_linear() and
+// to_srgb() kernels: without gathers they are no faster than scalar.
+
+static inline __m128 ui_colormap_select_sse2(__m128 m, __m128 x, __m128 y) {
+    return _mm_or_ps(_mm_and_ps(m, x), _mm_andnot_ps(m, y));
+}
+
+static inline __m128 ui_colormap_byte_sse2(__m128i c, int32_t shift) {
+    const __m128i ff = _mm_set1_epi32(0xFF);
+    const __m128 v = _mm_cvtepi32_ps(_mm_and_si128(_mm_srli_epi32(c, shift), ff));
+    return _mm_div_ps(v, _mm_set1_ps(255.0f));
+}
+
+static void ui_colormap_rgb_to_hsx_sse2(const uint32_t* c, fp32_t* h,
+        fp32_t* s, fp32_t* x, int64_t n, bool hsv) {
+    const __m128 zero  = _mm_setzero_ps();
+    const __m128 two   = _mm_set1_ps(2.0f);
+    const __m128 three = _mm_set1_ps(3.0f);
+    const __m128 four  = _mm_set1_ps(4.0f);
+    const __m128 six   = _mm_set1_ps(6.0f);
+    const __m128 sixty = _mm_set1_ps(60.0f);
+    int64_t k = 0;
+    for (; k + 4 <= n; k += 4) {
+        const __m128i v = _mm_loadu_si128((const __m128i*)(c + k));
+        const __m128 r = ui_colormap_byte_sse2(v, 0);
+        const __m128 g = ui_colormap_byte_sse2(v, 8);
+        const __m128 b = ui_colormap_byte_sse2(v, 16);
+        const __m128 max = _mm_max_ps(r, _mm_max_ps(g, b));
+        const __m128 min = _mm_min_ps(r, _mm_min_ps(g, b));
+        const __m128 chroma = _mm_sub_ps(max, min);
+        const __m128 i = hsv ? max :
+            _mm_div_ps(_mm_add_ps(_mm_add_ps(r, g), b), three);
+        const __m128 colored = _mm_cmpgt_ps(chroma, zero);
+        const __m128 sat = _mm_div_ps(chroma, hsv ? max : _mm_mul_ps(i, three));
+        const __m128 hr = _mm_add_ps(_mm_div_ps(_mm_sub_ps(g, b), chroma),
+                                     _mm_and_ps(_mm_cmplt_ps(g, b), six));
+        const __m128 hg = _mm_add_ps(_mm_div_ps(_mm_sub_ps(b, r), chroma), two);
+        const __m128 hb = _mm_add_ps(_mm_div_ps(_mm_sub_ps(r, g), chroma), four);
+        __m128 hue = ui_colormap_select_sse2(_mm_cmpeq_ps(g, max), hg, hb);
+        hue = ui_colormap_select_sse2(_mm_cmpeq_ps(r, max), hr, hue);
+        _mm_storeu_ps(h + k, _mm_and_ps(colored, _mm_mul_ps(hue, sixty)));
+        _mm_storeu_ps(s + k, _mm_and_ps(colored, sat));
+        _mm_storeu_ps(x + k, i);
+    }
+    ui_colormap_rgb_to_hsx_scalar(c + k, h + k, s + k, x + k, n - k, hsv);
+}
+
+static inline __m128i ui_colormap_channel_sse2(__m128 h6, __m128 s, __m128 i,
+        fp32_t n) {
+    const __m128 zero = _mm_setzero_ps();
+    const __m128 one  = _mm_set1_ps(1.0f);
+    const __m128 six  = _mm_set1_ps(6.0f);
+    __m128 k = _mm_add_ps(_mm_set1_ps(n), h6);
+    k = _mm_sub_ps(k, _mm_and_ps(_mm_cmpge_ps(k, six), six));
+    const __m128 w = _mm_max_ps(_mm_min_ps(
+        _mm_min_ps(k, _mm_sub_ps(_mm_set1_ps(4.0f), k)), one), zero);
+    __m128 v = _mm_mul_ps(_mm_mul_ps(i, _mm_sub_ps(one, _mm_mul_ps(s, w))),
+                          _mm_set1_ps(255.0f));
+    v = _mm_add_ps(v, _mm_set1_ps(0.5f));
+    v = _mm_min_ps(_mm_max_ps(v, zero), _mm_set1_ps(255.0f));
+    return _mm_cvttps_epi32(v);
+}
+
+static void ui_colormap_hsi_to_rgb_sse2(uint32_t* d, const fp32_t* h,
+        const fp32_t* s, const fp32_t* i, uint8_t a, int64_t n) {
+    const __m128i alpha = _mm_set1_epi32((int32_t)((uint32_t)a << 24));
+    int64_t k = 0;
+    for (; k + 4 <= n; k += 4) {
+        const __m128 h6 = _mm_div_ps(_mm_loadu_ps(h + k), _mm_set1_ps(60.0f));
+        const __m128 sk = _mm_loadu_ps(s + k);
+        const __m128 ik = _mm_loadu_ps(i + k);
+        const __m128i r = ui_colormap_channel_sse2(h6, sk, ik, 5.0f);
+        const __m128i g = ui_colormap_channel_sse2(h6, sk, ik, 3.0f);
+        const __m128i b = ui_colormap_channel_sse2(h6, sk, ik, 1.0f);
+        const __m128i c = _mm_or_si128(_mm_or_si128(r, _mm_slli_epi32(g, 8)),
+                          _mm_or_si128(_mm_slli_epi32(b, 16), alpha));
+        _mm_storeu_si128((__m128i*)(d + k), c);
+    }
+    ui_colormap_hsi_to_rgb_scalar(d + k, h + k, s + k, i + k, a, n - k);
+}
+
+static const struct ui_colormap_kernels ui_colormap_sse2_kernels = {
+    .rgb_to_hsx = ui_colormap_rgb_to_hsx_sse2,
+    .hsi_to_rgb = ui_colormap_hsi_to_rgb_sse2
+};
+
+#endif // ui_colormap_has_sse2
+
+#if defined(ui_colormap_has_avx2)
+
+// AVX2 gathers table entries for to_linear() and to_srgb().
+
+ui_colormap_avx2_target
+static inline __m256 ui_colormap_byte_avx2(__m256i c, int32_t shift) {
+    const __m256i ff = _mm256_set1_epi32(0xFF);
+    const __m256i b = _mm256_and_si256(_mm256_srlv_epi32(c,
+                          _mm256_set1_epi32(shift)), ff);
+    return _mm256_div_ps(_mm256_cvtepi32_ps(b), _mm256_set1_ps(255.0f));
+}
+
+ui_colormap_avx2_target
+static void ui_colormap_rgb_to_hsx_avx2(const uint32_t* c, fp32_t* h,
+        fp32_t* s, fp32_t* x, int64_t n, bool hsv) {
+    const __m256 zero  = _mm256_setzero_ps();
+    const __m256 two   = _mm256_set1_ps(2.0f);
+    const __m256 three = _mm256_set1_ps(3.0f);
+    const __m256 four  = _mm256_set1_ps(4.0f);
+    const __m256 six   = _mm256_set1_ps(6.0f);
+    const __m256 sixty = _mm256_set1_ps(60.0f);
+    int64_t k = 0;
+    for (; k + 8 <= n; k += 8) {
+        const __m256i v = _mm256_loadu_si256((const __m256i*)(c + k));
+        const __m256 r = ui_colormap_byte_avx2(v, 0);
+        const __m256 g = ui_colormap_byte_avx2(v, 8);
+        const __m256 b = ui_colormap_byte_avx2(v, 16);
+        const __m256 max = _mm256_max_ps(r, _mm256_max_ps(g, b));
+        const __m256 min = _mm256_min_ps(r, _mm256_min_ps(g, b));
+        const __m256 chroma = _mm256_sub_ps(max, min);
+        const __m256 i = hsv ? max :
+            _mm256_div_ps(_mm256_add_ps(_mm256_add_ps(r, g), b), three);
+        const __m256 colored = _mm256_cmp_ps(chroma, zero, _CMP_GT_OQ);
+        const __m256 sat = _mm256_div_ps(chroma,
+                               hsv ? max : _mm256_mul_ps(i, three));
+        const __m256 hr = _mm256_add_ps(
+            _mm256_div_ps(_mm256_sub_ps(g, b), chroma),
+            _mm256_and_ps(_mm256_cmp_ps(g, b, _CMP_LT_OQ), six));
+        const __m256 hg = _mm256_add_ps(
+            _mm256_div_ps(_mm256_sub_ps(b, r), chroma), two);
+        const __m256 hb = _mm256_add_ps(
+            _mm256_div_ps(_mm256_sub_ps(r, g), chroma), four);
+        __m256 hue = _mm256_blendv_ps(hb, hg, _mm256_cmp_ps(g, max, _CMP_EQ_OQ));
+        hue = _mm256_blendv_ps(hue, hr, _mm256_cmp_ps(r, max, _CMP_EQ_OQ));
+        _mm256_storeu_ps(h + k, _mm256_and_ps(colored, _mm256_mul_ps(hue, sixty)));
+        _mm256_storeu_ps(s + k, _mm256_and_ps(colored, sat));
+        _mm256_storeu_ps(x + k, i);
+    }
+    ui_colormap_rgb_to_hsx_scalar(c + k, h + k, s + k, x + k, n - k, hsv);
+}
+
+ui_colormap_avx2_target
+static inline __m256i ui_colormap_channel_avx2(__m256 h6, __m256 s, __m256 i,
+        fp32_t n) {
+    const __m256 zero = _mm256_setzero_ps();
+    const __m256 one  = _mm256_set1_ps(1.0f);
+    const __m256 six  = _mm256_set1_ps(6.0f);
+    __m256 k = _mm256_add_ps(_mm256_set1_ps(n), h6);
+    k = _mm256_sub_ps(k, _mm256_and_ps(_mm256_cmp_ps(k, six, _CMP_GE_OQ), six));
+    const __m256 w = _mm256_max_ps(_mm256_min_ps(
+        _mm256_min_ps(k, _mm256_sub_ps(_mm256_set1_ps(4.0f), k)), one), zero);
+    __m256 v = _mm256_mul_ps(
+        _mm256_mul_ps(i, _mm256_sub_ps(one, _mm256_mul_ps(s, w))),
+        _mm256_set1_ps(255.0f));
+    v = _mm256_add_ps(v, _mm256_set1_ps(0.5f));
+    v = _mm256_min_ps(_mm256_max_ps(v, zero), _mm256_set1_ps(255.0f));
+    return _mm256_cvttps_epi32(v);
+}
+
+ui_colormap_avx2_target
+static void ui_colormap_hsi_to_rgb_avx2(uint32_t* d, const fp32_t* h,
+        const fp32_t* s, const fp32_t* i, uint8_t a, int64_t n) {
+    const __m256i alpha = _mm256_set1_epi32((int32_t)((uint32_t)a << 24));
+    int64_t k = 0;
+    for (; k + 8 <= n; k += 8) {
+        const __m256 h6 = _mm256_div_ps(_mm256_loadu_ps(h + k),
+                                        _mm256_set1_ps(60.0f));
+        const __m256 sk = _mm256_loadu_ps(s + k);
+        const __m256 ik = _mm256_loadu_ps(i + k);
+        const __m256i r = ui_colormap_channel_avx2(h6, sk, ik, 5.0f);
+        const __m256i g = ui_colormap_channel_avx2(h6, sk, ik, 3.0f);
+        const __m256i b = ui_colormap_channel_avx2(h6, sk, ik, 1.0f);
+        const __m256i c = _mm256_or_si256(
+            _mm256_or_si256(r, _mm256_slli_epi32(g, 8)),
+            _mm256_or_si256(_mm256_slli_epi32(b, 16), alpha));
+        _mm256_storeu_si256((__m256i*)(d + k), c);
+    }
+    ui_colormap_hsi_to_rgb_scalar(d + k, h + k, s + k, i + k, a, n - k);
+}
+
+ui_colormap_avx2_target
+static void ui_colormap_to_linear_avx2(fp32_t* d, const uint8_t* s,
+        int64_t n) {
+    int64_t k = 0;
+    for (; k + 8 <= n; k += 8) {
+        const __m256i c = _mm256_cvtepu8_epi32(
+            _mm_loadl_epi64((const __m128i*)(s + k)));
+        _mm256_storeu_ps(d + k, _mm256_i32gather_ps(ui_colormap_decoded, c, 4));
+    }
+    ui_colormap_to_linear_scalar(d + k, s + k, n - k);
+}
+
+ui_colormap_avx2_target
+static void ui_colormap_to_srgb_avx2(uint8_t* d, const fp32_t* s,
+        int64_t n) {
+    const __m256 buckets = _mm256_set1_ps((fp32_t)ui_colormap_buckets);
+    int64_t k = 0;
+    for (; k + 8 <= n; k += 8) {
+        __m256 x = _mm256_max_ps(_mm256_loadu_ps(s + k), _mm256_setzero_ps());
+        x = _mm256_min_ps(x, _mm256_set1_ps(1.0f));
+        const __m256i b = _mm256_cvttps_epi32(_mm256_mul_ps(x, buckets));
+        __m256i c = _mm256_i32gather_epi32(ui_colormap_bucket, b, 4);
+        const __m256 t = _mm256_i32gather_ps(ui_colormap_threshold, c, 4);
+        // c - (-1) where x >= threshold
+        c = _mm256_sub_epi32(c, _mm256_castps_si256(
+                _mm256_cmp_ps(x, t, _CMP_GE_OQ)));
+        const __m128i w = _mm_packs_epi32(_mm256_castsi256_si128(c),
+                                          _mm256_extracti128_si256(c, 1));
+        _mm_storel_epi64((__m128i*)(d + k), _mm_packus_epi16(w, w));
+    }
+    ui_colormap_to_srgb_scalar(d + k, s + k, n - k);
+}
+
+static const struct ui_colormap_kernels ui_colormap_avx2_kernels = {
+    .rgb_to_hsx = ui_colormap_rgb_to_hsx_avx2,
+    .hsi_to_rgb = ui_colormap_hsi_to_rgb_avx2,
+    .to_linear  = ui_colormap_to_linear_avx2,
+    .to_srgb    = ui_colormap_to_srgb_avx2
+};
+
+#endif // ui_colormap_has_avx2
+
+#if defined(ui_colormap_has_neon)
+
+// No to_linear() and to_srgb() kernels (no gathers, see SSE2).
+
+static inline float32x4_t ui_colormap_byte_neon(uint32x4_t c, int32_t shift) {
+    const uint32x4_t b = vandq_u32(vshlq_u32(c, vdupq_n_s32(-shift)),
+                                   vdupq_n_u32(0xFF));
+    return vdivq_f32(vcvtq_f32_u32(b), vdupq_n_f32(255.0f));
+}
+
+static inline float32x4_t ui_colormap_and_neon(uint32x4_t m, float32x4_t v) {
+    return vreinterpretq_f32_u32(vandq_u32(m, vreinterpretq_u32_f32(v)));
+}
+
+static void ui_colormap_rgb_to_hsx_neon(const uint32_t* c, fp32_t* h,
+        fp32_t* s, fp32_t* x, int64_t n, bool hsv) {
+    const float32x4_t zero  = vdupq_n_f32(0.0f);
+    const float32x4_t two   = vdupq_n_f32(2.0f);
+    const float32x4_t three = vdupq_n_f32(3.0f);
+    const float32x4_t four  = vdupq_n_f32(4.0f);
+    const float32x4_t six   = vdupq_n_f32(6.0f);
+    const float32x4_t sixty = vdupq_n_f32(60.0f);
+    int64_t k = 0;
+    for (; k + 4 <= n; k += 4) {
+        const uint32x4_t v = vld1q_u32(c + k);
+        const float32x4_t r = ui_colormap_byte_neon(v, 0);
+        const float32x4_t g = ui_colormap_byte_neon(v, 8);
+        const float32x4_t b = ui_colormap_byte_neon(v, 16);
+        const float32x4_t max = vmaxq_f32(r, vmaxq_f32(g, b));
+        const float32x4_t min = vminq_f32(r, vminq_f32(g, b));
+        const float32x4_t chroma = vsubq_f32(max, min);
+        const float32x4_t i = hsv ? max :
+            vdivq_f32(vaddq_f32(vaddq_f32(r, g), b), three);
+        const uint32x4_t colored = vcgtq_f32(chroma, zero);
+        const float32x4_t sat = vdivq_f32(chroma, hsv ? max : vmulq_f32(i, three));
+        const float32x4_t hr = vaddq_f32(vdivq_f32(vsubq_f32(g, b), chroma),
+                                         ui_colormap_and_neon(vcltq_f32(g, b), six));
+        const float32x4_t hg = vaddq_f32(vdivq_f32(vsubq_f32(b, r), chroma), two);
+        const float32x4_t hb = vaddq_f32(vdivq_f32(vsubq_f32(r, g), chroma), four);
+        float32x4_t hue = vbslq_f32(vceqq_f32(g, max), hg, hb);
+        hue = vbslq_f32(vceqq_f32(r, max), hr, hue);
+        vst1q_f32(h + k, ui_colormap_and_neon(colored, vmulq_f32(hue, sixty)));
+        vst1q_f32(s + k, ui_colormap_and_neon(colored, sat));
+        vst1q_f32(x + k, i);
+    }
+    ui_colormap_rgb_to_hsx_scalar(c + k, h + k, s + k, x + k, n - k, hsv);
+}
+
+static inline uint32x4_t ui_colormap_channel_neon(float32x4_t h6,
+        float32x4_t s, float32x4_t i, fp32_t n) {
+    const float32x4_t zero = vdupq_n_f32(0.0f);
+    const float32x4_t one  = vdupq_n_f32(1.0f);
+    const float32x4_t six  = vdupq_n_f32(6.0f);
+    float32x4_t k = vaddq_f32(vdupq_n_f32(n), h6);
+    k = vsubq_f32(k, ui_colormap_and_neon(vcgeq_f32(k, six), six));
+    const float32x4_t w = vmaxq_f32(vminq_f32(
+        vminq_f32(k, vsubq_f32(vdupq_n_f32(4.0f), k)), one), zero);
+    float32x4_t v = vmulq_f32(vmulq_f32(i, vsubq_f32(one, vmulq_f32(s, w))),
+                              vdupq_n_f32(255.0f));
+    v = vaddq_f32(v, vdupq_n_f32(0.5f));
+    v = vminq_f32(vmaxq_f32(v, zero), vdupq_n_f32(255.0f));
+    return vcvtq_u32_f32(v);
+}
+
+static void ui_colormap_hsi_to_rgb_neon(uint32_t* d, const fp32_t* h,
+        const fp32_t* s, const fp32_t* i, uint8_t a, int64_t n) {
+    const uint32x4_t alpha = vdupq_n_u32((uint32_t)a << 24);
+    int64_t k = 0;
+    for (; k + 4 <= n; k += 4) {
+        const float32x4_t h6 = vdivq_f32(vld1q_f32(h + k), vdupq_n_f32(60.0f));
+        const float32x4_t sk = vld1q_f32(s + k);
+        const float32x4_t ik = vld1q_f32(i + k);
+        const uint32x4_t r = ui_colormap_channel_neon(h6, sk, ik, 5.0f);
+        const uint32x4_t g = ui_colormap_channel_neon(h6, sk, ik, 3.0f);
+        const uint32x4_t b = ui_colormap_channel_neon(h6, sk, ik, 1.0f);
+        const uint32x4_t c = vorrq_u32(vorrq_u32(r, vshlq_n_u32(g, 8)),
+                                       vorrq_u32(vshlq_n_u32(b, 16), alpha));
+        vst1q_u32(d + k, c);
+    }
+    ui_colormap_hsi_to_rgb_scalar(d + k, h + k, s + k, i + k, a, n - k);
+}
+
+static const struct ui_colormap_kernels ui_colormap_neon_kernels = {
+    .rgb_to_hsx = ui_colormap_rgb_to_hsx_neon,
+    .hsi_to_rgb = ui_colormap_hsi_to_rgb_neon
+};
+
+#endif // ui_colormap_has_neon
+
+static const struct ui_colormap_kernels* ui_colormap_k; // selected kernels
+static int32_t ui_colormap_selected;
+
+static const struct ui_colormap_kernels* ui_colormap_of(int32_t isa) {
+    const struct ui_colormap_kernels* k = null;
+    if (ui_pixels.supported(isa)) {
+        switch (isa) {
+            case ui_pixels_scalar: k = &ui_colormap_scalar_kernels; break;
+            #if defined(ui_colormap_has_sse2)
+            case ui_pixels_sse2: k = &ui_colormap_sse2_kernels; break;
+            #endif
+            #if defined(ui_colormap_has_avx2)
+            case ui_pixels_avx2: k = &ui_colormap_avx2_kernels; break;
+            #endif
+            #if defined(ui_colormap_has_neon)
+            case ui_pixels_neon: k = &ui_colormap_neon_kernels; break;
+            #endif
+            default: break;
+        }
+    }
+    return k;
+}
+
+static bool ui_colormap_use(int32_t isa) {
+    const struct ui_colormap_kernels* k = ui_colormap_of(isa);
+    if (k != null) {
+        if (ui_colormap_bucket[ui_colormap_buckets] == 0) { ui_colormap_init(); }
+        ui_colormap_selected = isa;
+        ui_colormap_k = k;
+    }
+    return k != null;
+}
+
+static const struct ui_colormap_kernels* ui_colormap_kernels(void) {
+    if (ui_colormap_k == null) {
+        // best available, races are benign: same result on all threads
+        const int32_t isa[] = { ui_pixels_avx2, ui_pixels_sse2, ui_pixels_neon };
+        bool found = false;
+        for (int32_t i = 0; i < posix_countof(isa) && !found; i++) {
+            found = ui_colormap_use(isa[i]);
+        }
+        if (!found) { ui_colormap_use(ui_pixels_scalar); }
+    }
+    return ui_colormap_k;
+}
+
+static int32_t ui_colormap_isa(void) {
+    (void)ui_colormap_kernels();
+    return ui_colormap_selected;
+}
+
+static void ui_colormap_rgb_to_hsi(const uint32_t* rgba, fp32_t* h, fp32_t* s,
+        fp32_t* i, int64_t n) {
+    ui_colormap_kernels()->rgb_to_hsx(rgba, h, s, i, n, false);
+}
+
+static void ui_colormap_rgb_to_hsv(const uint32_t* rgba, fp32_t* h, fp32_t* s,
+        fp32_t* v, int64_t n) {
+    ui_colormap_kernels()->rgb_to_hsx(rgba, h, s, v, n, true);
+}
+
+static void ui_colormap_hsi_to_rgb(uint32_t* d, const fp32_t* h,
+        const fp32_t* s, const fp32_t* i, uint8_t a, int64_t n) {
+    ui_colormap_kernels()->hsi_to_rgb(d, h, s, i, a, n);
+}
+
+static void ui_colormap_to_linear(fp32_t* d, const uint8_t* s, int64_t n) {
+    const struct ui_colormap_kernels* k = ui_colormap_kernels();
+    if (k->to_linear != null) {
+        k->to_linear(d, s, n);
+    } else {
+        ui_colormap_to_linear_scalar(d, s, n);
+    }
+}
+
+static void ui_colormap_to_srgb(uint8_t* d, const fp32_t* s, int64_t n) {
+    const struct ui_colormap_kernels* k = ui_colormap_kernels();
+    if (k->to_srgb != null) {
+        k->to_srgb(d, s, n);
+    } else {
+        ui_colormap_to_srgb_scalar(d, s, n);
+    }
+}
+
+static void ui_colormap_alpha(uint32_t* d, const uint32_t* c0,
+        const uint32_t* c1, const fp32_t* t, int32_t n) {
+    // as ui_colors.interpolate(): interpolate alphas only if differ
+    for (int32_t k = 0; k < n; k++) {
+        const int32_t a0 = (int32_t)(c0[k] >> 24);
+        const int32_t a1 = (int32_t)(c1[k] >> 24);
+        const uint32_t a = a0 == a1 ? (uint32_t)a0 :
+            (uint32_t)ui_colormap_min(ui_colormap_max(
+                (fp32_t)a0 + (fp32_t)(a1 - a0) * t[k], 0.0f), 255.0f);
+        d[k] = (d[k] & 0x00FFFFFFu) | a << 24;
+    }
+}
+
+static void ui_colormap_blend(uint32_t* d, const uint32_t* c0,
+        const uint32_t* c1, const fp32_t* t, int32_t n, bool hsv) {
+    // hue, saturation and intensity (or value) interpolation of
+    // n <= ui_colormap_chunk colors
+    fp32_t h0[ui_colormap_chunk], s0[ui_colormap_chunk], i0[ui_colormap_chunk];
+    fp32_t h1[ui_colormap_chunk], s1[ui_colormap_chunk], i1[ui_colormap_chunk];
+    const struct ui_colormap_kernels* kernels = ui_colormap_kernels();
+    kernels->rgb_to_hsx(c0, h0, s0, i0, n, hsv);
+    kernels->rgb_to_hsx(c1, h1, s1, i1, n, hsv);
+    for (int32_t k = 0; k < n; k++) {
+        h0[k] = h0[k] + (h1[k] - h0[k]) * t[k];
+        s0[k] = s0[k] + (s1[k] - s0[k]) * t[k];
+        i0[k] = i0[k] + (i1[k] - i0[k]) * t[k];
+    }
+    kernels->hsi_to_rgb(d, h0, s0, i0, 0, n);
+    ui_colormap_alpha(d, c0, c1, t, n);
+}
+
+static void ui_colormap_interpolate(uint32_t* d, const uint32_t* c0,
+        const uint32_t* c1, const fp32_t* t, int64_t n) {
+    for (int64_t k = 0; k < n; k += ui_colormap_chunk) {
+        const int32_t m = (int32_t)posix_min(n - k, (int64_t)ui_colormap_chunk);
+        ui_colormap_blend(d + k, c0 + k, c1 + k, t + k, m, false);
+    }
+}
+
+static void ui_colormap_multiply(uint32_t* d, const uint32_t* s,
+        fp32_t brightness, fp32_t saturation, int64_t n) {
+    fp32_t h[ui_colormap_chunk], sat[ui_colormap_chunk], i[ui_colormap_chunk];
+    const struct ui_colormap_kernels* kernels = ui_colormap_kernels();
+    for (int64_t k = 0; k < n; k += ui_colormap_chunk) {
+        const int32_t m = (int32_t)posix_min(n - k, (int64_t)ui_colormap_chunk);
+        kernels->rgb_to_hsx(s + k, h, sat, i, m, false);
+        for (int32_t j = 0; j < m; j++) {
+            i[j]   = ui_colormap_min(ui_colormap_max(i[j] * brightness, 0), 1);
+            sat[j] = ui_colormap_min(ui_colormap_max(sat[j] * saturation, 0), 1);
+        }
+        kernels->hsi_to_rgb(d + k, h, sat, i, 0, m);
+        for (int32_t j = 0; j < m; j++) {
+            d[k + j] = (d[k + j] & 0x00FFFFFFu) | (s[k + j] & 0xFF000000u);
+        }
+    }
+}
+
+static fp32_t ui_colormap_position(const fp32_t* positions, int32_t count,
+        int32_t k) {
+    return positions != null ? positions[k] :
+        (count > 1 ? (fp32_t)k / (fp32_t)(count - 1) : 0);
+}
+
+static void ui_colormap_mix(uint32_t* d, const uint32_t* c0,
+        const uint32_t* c1, const fp32_t* t, int32_t n, bool linear) {
+    // sRGB bytes or linear light interpolation of n <= ui_colormap_chunk
+    if (linear) {
+        fp32_t l0[ui_colormap_chunk * 4];
+        fp32_t l1[ui_colormap_chunk * 4];
+        ui_colormap_to_linear(l0, (const uint8_t*)c0, n * 4);
+        ui_colormap_to_linear(l1, (const uint8_t*)c1, n * 4);
+        for (int32_t k = 0; k < n * 4; k++) {
+            l0[k] = l0[k] + (l1[k] - l0[k]) * t[k / 4];
+        }
+        ui_colormap_to_srgb((uint8_t*)d, l0, n * 4); // alpha is replaced below
+    } else {
+        const uint8_t* b0 = (const uint8_t*)c0;
+        const uint8_t* b1 = (const uint8_t*)c1;
+        uint8_t* b = (uint8_t*)d;
+        for (int32_t k = 0; k < n * 4; k++) {
+            const fp32_t v = b0[k] + (fp32_t)(b1[k] - b0[k]) * t[k / 4];
+            b[k] = (uint8_t)(v + 0.5f);
+        }
+    }
+    ui_colormap_alpha(d, c0, c1, t, n);
+}
+
+static void ui_colormap_gradient(uint32_t* lut, int32_t entries,
+        const uint32_t* stops, const fp32_t* positions, int32_t count,
+        int32_t space) {
+    posix_swear(entries > 0 && count > 0);
+    posix_swear(ui_colormap_srgb <= space && space <= ui_colormap_hsv);
+    uint32_t c0[ui_colormap_chunk];
+    uint32_t c1[ui_colormap_chunk];
+    fp32_t   t[ui_colormap_chunk];
+    int32_t j = 0; // segment [j..j + 1] of stops
+    for (int32_t e = 0; e < entries; e += ui_colormap_chunk) {
+        const int32_t n = posix_min(entries - e, (int32_t)ui_colormap_chunk);
+        for (int32_t k = 0; k < n; k++) {
+            const fp32_t x = entries > 1 ?
+                (fp32_t)(e + k) / (fp32_t)(entries - 1) : 0;
+            while (j < count - 2 &&
+                   ui_colormap_position(positions, count, j + 1) < x) {
+                j++;
+            }
+            const int32_t j1 = posix_min(j + 1, count - 1);
+            const fp32_t p0 = ui_colormap_position(positions, count, j);
+            const fp32_t p1 = ui_colormap_position(positions, count, j1);
+            const fp32_t f = p1 > p0 ? (x - p0) / (p1 - p0) : 0;
+            c0[k] = stops[j];
+            c1[k] = stops[j1];
+            t[k]  = ui_colormap_min(ui_colormap_max(f, 0), 1);
+        }
+        if (space == ui_colormap_hsv) {
+            ui_colormap_blend(lut + e, c0, c1, t, n, true);
+        } else {
+            ui_colormap_mix(lut + e, c0, c1, t, n, space == ui_colormap_linear);
+        }
+    }
+}
+
+static void ui_colormap_test_rgb_to_hsi(uint32_t c, fp64_t* h, fp64_t* s,
+        fp64_t* i) {
+    ui_colormap_color_to_hsi(c & 0xFF, (c >> 8) & 0xFF, (c >> 16) & 0xFF,
+                             h, s, i);
+}
+
+static uint32_t ui_colormap_test_hsi_to_rgb(fp64_t h, fp64_t s, fp64_t i) {
+    return ui_colormap_hsi_to_color(h, s, i, 0);
+}
+
+static void ui_colormap_test_near(uint32_t c0, uint32_t c1, int32_t delta) {
+    for (int32_t k = 0; k < 32; k += 8) {
+        const int32_t b0 = (int32_t)((c0 >> k) & 0xFF);
+        const int32_t b1 = (int32_t)((c1 >> k) & 0xFF);
+        posix_swear(abs(b0 - b1) <= delta, "0x%08X 0x%08X", c0, c1);
+    }
+}
+
+enum { ui_colormap_test_max = 1024 + 31 };
+
+static void ui_colormap_test_kernels(int32_t isa, uint32_t* seed) {
+    // every kernel of `isa` against scalar kernels for exact match for
+    // all lengths up to SIMD width and misaligned arrays
+    static uint32_t c[ui_colormap_test_max + 8];
+    static fp32_t   h[2][ui_colormap_test_max + 8];
+    static fp32_t   s[2][ui_colormap_test_max + 8];
+    static fp32_t   x[2][ui_colormap_test_max + 8];
+    static uint32_t d[2][ui_colormap_test_max + 8];
+    static uint8_t  b[2][ui_colormap_test_max + 8];
+    const struct ui_colormap_kernels* k = ui_colormap_of(isa);
+    for (int32_t pass = 0; pass < 200; pass++) {
+        const int64_t n = pass < 64 ? pass :
+            (int64_t)(posix_num.random32(seed) % ui_colormap_test_max);
+        const int32_t o = (int32_t)(posix_num.random32(seed) % 8);
+        for (int32_t i = 0; i < posix_countof(c); i++) {
+            c[i] = posix_num.random32(seed);
+            // grays and saturated colors have ties of max channel:
+            if (i % 7 == 0) { c[i] = (c[i] & 0xFF) * 0x010101u; }
+            if (i % 11 == 0) { c[i] &= 0xFF00FF; }
+        }
+        for (int32_t hsv = 0; hsv < 2; hsv++) {
+            ui_colormap_scalar_kernels.rgb_to_hsx(c + o, h[0], s[0], x[0], n, hsv);
+            k->rgb_to_hsx(c + o, h[1] + o, s[1] + o, x[1] + o, n, hsv);
+            posix_swear(memcmp(h[0], h[1] + o, (size_t)n * 4) == 0);
+            posix_swear(memcmp(s[0], s[1] + o, (size_t)n * 4) == 0);
+            posix_swear(memcmp(x[0], x[1] + o, (size_t)n * 4) == 0);
+        }
+        for (int32_t i = 0; i < n; i++) { // out of range and NaN too
+            h[0][i] = (fp32_t)(posix_num.random32(seed) % 36001) / 100.0f;
+            s[0][i] = (fp32_t)(posix_num.random32(seed) % 1001) / 1000.0f;
+            x[0][i] = (fp32_t)(posix_num.random32(seed) % 1201) / 1000.0f - 0.1f;
+            if (i % 13 == 0) { x[0][i] = (fp32_t)nan(""); }
+        }
+        memset(d, 0x5A, sizeof(d));
+        ui_colormap_scalar_kernels.hsi_to_rgb(d[0], h[0], s[0], x[0], 0x80, n);
+        k->hsi_to_rgb(d[1] + o, h[0], s[0], x[0], 0x80, n);
+        posix_swear(memcmp(d[0], d[1] + o, (size_t)n * 4) == 0);
+        posix_swear(d[1][o + n] == 0x5A5A5A5A); // no overrun
+        if (k->to_srgb != null) {
+            ui_colormap_scalar_kernels.to_srgb(b[0], x[0], n);
+            k->to_srgb(b[1] + o, x[0], n);
+            posix_swear(memcmp(b[0], b[1] + o, (size_t)n) == 0);
+        }
+        if (k->to_linear != null) {
+            ui_colormap_scalar_kernels.to_linear(x[0], (const uint8_t*)c, n);
+            k->to_linear(x[1] + o, (const uint8_t*)c, n);
+            posix_swear(memcmp(x[0], x[1] + o, (size_t)n * 4) == 0);
+        }
+    }
+}
+
+static void ui_colormap_test_accuracy(uint32_t* seed) {
+    // against fp64 per color ui_colors math
+    enum { n = 4096 };
+    static uint32_t c[n];
+    static uint32_t d[n];
+    static fp32_t h[n], s[n], i[n];
+    for (int32_t k = 0; k < n; k++) {
+        c[k] = posix_num.random32(seed) | 0xFF000000u;
+        if (k % 7 == 0) { c[k] = (c[k] & 0xFF) * 0x010101u | 0xFF000000u; }
+    }
+    ui_colormap.rgb_to_hsi(c, h, s, i, n);
+    for (int32_t k = 0; k < n; k++) {
+        fp64_t rh, rs, ri;
+        ui_colormap_test_rgb_to_hsi(c[k], &rh, &rs, &ri);
+        posix_swear(fabs(h[k] - rh) < 1e-3 && fabs(s[k] - rs) < 1e-6 &&
+                    fabs(i[k] - ri) < 1e-6);
+    }
+    ui_colormap.hsi_to_rgb(d, h, s, i, 0xFF, n);
+    for (int32_t k = 0; k < n; k++) {
+        const uint32_t e = ui_colormap_test_hsi_to_rgb(h[k], s[k], i[k]);
+        // ui_colors.hsi_to_rgb() truncates, hsi_to_rgb() rounds:
+        ui_colormap_test_near(d[k], e | 0xFF000000u, 1);
+    }
+    // HSV round trip is exact:
+    ui_colormap.rgb_to_hsv(c, h, s, i, n);
+    ui_colormap.hsi_to_rgb(d, h, s, i, 0xFF, n);
+    posix_swear(memcmp(c, d, sizeof(c)) == 0);
+    // sRGB round trip is exact, to_srgb() is rounded to nearest:
+    static uint8_t b[256];
+    static fp32_t  l[256];
+    for (int32_t k = 0; k < 256; k++) { b[k] = (uint8_t)k; }
+    ui_colormap.to_linear(l, b, 256);
+    for (int32_t k = 0; k < 256; k++) {
+        posix_swear(fabs(l[k] - ui_colormap_decode(k / 255.0)) < 1e-7);
+    }
+    ui_colormap.to_srgb(b, l, 256);
+    for (int32_t k = 0; k < 256; k++) { posix_swear(b[k] == k); }
+    for (int32_t side = -1; side <= 1; side += 2) { // k -+ 0.49 -> k
+        for (int32_t k = 0; k < 256; k++) {
+            l[k] = (fp32_t)ui_colormap_decode((k + side * 0.49) / 255.0);
+        }
+        ui_colormap.to_srgb(b, l, 256);
+        for (int32_t k = 0; k < 256; k++) { posix_swear(b[k] == k); }
+    }
+    const fp32_t edge[] = { -1.0f, 2.0f, (fp32_t)nan(""), 1.0f, 0.0f };
+    ui_colormap.to_srgb(b, edge, posix_countof(edge));
+    posix_swear(b[0] == 0 && b[1] == 255 && b[2] == 0 && b[3] == 255 && b[4] == 0);
+    // interpolate() and multiply() against ui_colors.interpolate() and
+    // multiply_brightness() math:
+    static fp32_t t[n];
+    for (int32_t k = 0; k < n; k++) {
+        d[k] = posix_num.random32(seed);
+        t[k] = (fp32_t)(1 + posix_num.random32(seed) % 999) / 1000.0f;
+    }
+    static uint32_t m[n];
+    ui_colormap.interpolate(m, c, d, t, n);
+    for (int32_t k = 0; k < n; k++) {
+        fp64_t h0, s0, i0, h1, s1, i1;
+        ui_colormap_test_rgb_to_hsi(c[k], &h0, &s0, &i0);
+        ui_colormap_test_rgb_to_hsi(d[k], &h1, &s1, &i1);
+        const uint32_t e = ui_colormap_test_hsi_to_rgb(h0 + (h1 - h0) * t[k],
+            s0 + (s1 - s0) * t[k], i0 + (i1 - i0) * t[k]);
+        const fp64_t a0 = c[k] >> 24;
+        const fp64_t a1 = d[k] >> 24;
+        const uint32_t a = (uint32_t)(a0 + (a1 - a0) * t[k]);
+        ui_colormap_test_near(m[k], e | a << 24, 1);
+    }
+    ui_colormap.multiply(m, d, 0.5f, 1.5f, n);
+    for (int32_t k = 0; k < n; k++) {
+        fp64_t h0, s0, i0;
+        ui_colormap_test_rgb_to_hsi(d[k], &h0, &s0, &i0);
+        const uint32_t e = ui_colormap_test_hsi_to_rgb(h0,
+            fmin(1, s0 * 1.5), i0 * 0.5);
+        ui_colormap_test_near(m[k], e | (d[k] & 0xFF000000u), 1);
+    }
+}
+
+static void ui_colormap_test_gradient(void) {
+    const uint32_t stops[] = { 0xFF0000FFu, 0x80FF0000u, 0xFF00FF00u, 0xFF0000FFu };
+    static uint32_t lut[4096];
+    for (int32_t space = ui_colormap_srgb; space <= ui_colormap_hsv; space++) {
+        for (int32_t entries = 1; entries <= 4096; entries *= 4) {
+            ui_colormap.gradient(lut, entries, stops, null, 4, space);
+            posix_swear(lut[0] == stops[0]);
+            if (entries > 1) {
+                posix_swear(lut[entries - 1] == stops[3]);
+            }
+            if (entries >= 16) { // stops at 1/3 and 2/3 of entries - 1
+                const int32_t k = (entries - 1) / 3;
+                if (k * 3 == entries - 1) {
+                    posix_swear(lut[k] == stops[1] && lut[k * 2] == stops[2]);
+                }
+            }
+        }
+        // positions, alpha, entries between stops:
+        const fp32_t positions[] = { 0.0f, 0.25f, 0.5f, 1.0f };
+        ui_colormap.gradient(lut, 257, stops, positions, 4, space);
+        posix_swear(lut[64] == stops[1] && lut[128] == stops[2]);
+        const uint32_t mid = lut[32];
+        posix_swear(mid >> 24 == 0xBF);
+        if (space == ui_colormap_srgb) {
+            posix_swear((mid & 0xFFFFFF) == 0x800080);
+        } else if (space == ui_colormap_linear) {
+            posix_swear((mid & 0xFFFFFF) == 0xBC00BC); // brighter
+        } else { // hue of red (0) and blue (240) midpoint is green (120):
+            posix_swear((mid & 0xFFFFFF) == 0x00FF00);
+        }
+    }
+    // single stop, stops outside of [0..1] positions:
+    ui_colormap.gradient(lut, 16, stops + 1, null, 1, ui_colormap_linear);
+    for (int32_t k = 0; k < 16; k++) { posix_swear(lut[k] == stops[1]); }
+    const fp32_t inside[] = { 0.5f, 0.75f };
+    ui_colormap.gradient(lut, 5, stops, inside, 2, ui_colormap_srgb);
+    posix_swear(lut[0] == stops[0] && lut[2] == stops[0] && lut[4] == stops[1]);
+}
+
+static void ui_colormap_test(void) {
+    const int32_t saved = ui_colormap.isa();
+    uint32_t seed = 1;
+    for (int32_t isa = ui_pixels_sse2; isa <= ui_pixels_neon; isa++) {
+        if (ui_colormap_of(isa) != null) { ui_colormap_test_kernels(isa, &seed); }
+    }
+    for (int32_t isa = ui_pixels_scalar; isa <= ui_pixels_neon; isa++) {
+        if (ui_colormap.use(isa)) {
+            ui_colormap_test_accuracy(&seed);
+            ui_colormap_test_gradient();
+        }
+    }
+    posix_swear(ui_colormap.use(saved));
+    if (posix_debug.verbosity.level > posix_debug.verbosity.quiet) {
+        posix_println("done %s", ui_pixels.name(ui_colormap.isa()));
+    }
+}
+
+struct ui_colormap_if ui_colormap = {
+    .rgb_to_hsi  = ui_colormap_rgb_to_hsi,
+    .rgb_to_hsv  = ui_colormap_rgb_to_hsv,
+    .hsi_to_rgb  = ui_colormap_hsi_to_rgb,
+    .color_to_hsi = ui_colormap_color_to_hsi,
+    .hsi_to_color = ui_colormap_hsi_to_color,
+    .to_linear   = ui_colormap_to_linear,
+    .to_srgb     = ui_colormap_to_srgb,
+    .interpolate = ui_colormap_interpolate,
+    .multiply    = ui_colormap_multiply,
+    .gradient    = ui_colormap_gradient,
+    .isa         = ui_colormap_isa,
+    .use         = ui_colormap_use,
+    .test        = ui_colormap_test
+};
+
+#ifdef UI_COLORMAP_TEST
+    posix_static_init(ui_colormap) { ui_colormap.test(); }
+#endif
@@ -9,54 +9,14 @@ static inline fp64_t ui_color_fp64_min(fp64_t x, fp64_t y) { return x < y ? x :
 
 static inline fp64_t ui_color_fp64_max(fp64_t x, fp64_t y) { return x > y ? x : y; }
 
+// fp64 math of a single color is shared with ui_colormap (see its test)
+
 static void ui_color_rgb_to_hsi(fp64_t r, fp64_t g, fp64_t b, fp64_t *h, fp64_t *s, fp64_t *i) {
-    r /= 255.0;
-    g /= 255.0;
-    b /= 255.0;
-    fp64_t min_val = ui_color_fp64_min(r, ui_color_fp64_min(g, b));
-    *i = (r + g + b) / 3;
-    fp64_t chroma = ui_color_fp64_max(r, ui_color_fp64_max(g, b)) - min_val;
-    if (chroma == 0) {
-        *h = 0;
-        *s = 0;
-    } else {
-        *s = 1 - min_val / *i;
-        if (*i > 0) { *s = chroma / (*i * 3); }
-        if (r == ui_color_fp64_max(r, ui_color_fp64_max(g, b))) {
-            *h = (g - b) / chroma + (g < b ? 6 : 0);
-        } else if (g == ui_color_fp64_max(r, ui_color_fp64_max(g, b))) {
-            *h = (b - r) / chroma + 2;
-        } else {
-            *h = (r - g) / chroma + 4;
-        }
-        *h *= 60;
-    }
+    ui_colormap.color_to_hsi(r, g, b, h, s, i);
 }
 
 static ui_color_t ui_color_hsi_to_rgb(fp64_t h, fp64_t s, fp64_t i, uint8_t a) {
-    h /= 60.0;
-    fp64_t f = h - (int32_t)h;
-    fp64_t p = i * (1 - s);
-    fp64_t q = i * (1 - s * f);
-    fp64_t t = i * (1 - s * (1 - f));
-    fp64_t r = 0, g = 0, b = 0;
-    // h is in [0,6) by construction, but float rounding can produce
-    // exactly 6.0 from h == 360.0 * (1 - eps) input. Treat the default
-    // case as a black pixel (intensity 0) rather than aborting.
-    switch ((int32_t)h) {
-        case 0:
-        case 6: r = i * 255; g = t * 255; b = p * 255; break;
-        case 1: r = q * 255; g = i * 255; b = p * 255; break;
-        case 2: r = p * 255; g = i * 255; b = t * 255; break;
-        case 3: r = p * 255; g = q * 255; b = i * 255; break;
-        case 4: r = t * 255; g = p * 255; b = i * 255; break;
-        case 5: r = i * 255; g = p * 255; b = q * 255; break;
-        default: r = 0; g = 0; b = 0; break;
-    }
-    posix_assert(0 <= r && r <= 255);
-    posix_assert(0 <= g && g <= 255);
-    posix_assert(0 <= b && b <= 255);
-    return ui_color_rgba((uint8_t)r, (uint8_t)g, (uint8_t)b, a);
+    return (ui_color_t)ui_colormap.hsi_to_color(h, s, i, a);
 }
 
 static ui_color_t ui_color_brightness(ui_color_t c, fp32_t multiplier) {
@@ -49,13 +49,13 @@ struct ui_if ui = {
     .point_in_rect  = ui_point_in_rect,
     .intersect_rect = ui_intersect_rect,
     .combine_rect   = ui_combine_rect,
-    .infinity = INT32_MAX,
+    .infinity = ui_infinity,
     .align = {
-        .center = 0,
-        .left   = 0x01,
-        .top    = 0x02,
-        .right  = 0x10,
-        .bottom = 0x20
+        .center = ui_align_center,
+        .left   = ui_align_left,
+        .top    = ui_align_top,
+        .right  = ui_align_right,
+        .bottom = ui_align_bottom
     },
     .visibility = { // window visibility see ShowWindow link below
         .hide      = SW_HIDE,
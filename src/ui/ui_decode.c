@@ -0,0 +1,592 @@
+/* Copyright (c) Dmitry "Leo" Kuznetsov 2021-24 see LICENSE for details */
+#include "posix/posix.h"
+#include "ui/ui_core.h"
+#include "ui/ui_parallel.h"
+#include "ui/ui_decode.h"
+
+#undef UI_DECODE_TEST
+
+#if 0 // flip to 1 to run tests
+
+#define UI_DECODE_TEST
+
+#endif
+
+enum { ui_decode_max_workers = 16 };
+
+static struct {
+    posix_thread_t thread[ui_decode_max_workers];
+    int32_t workers;
+    struct posix_mutex mutex; // queue, counters and bytes
+    struct posix_mutex admit; // one worker at a time waits for budget
+    posix_event_t wake;       // request queued
+    posix_event_t released;   // bytes returned to budget
+    struct ui_decode_image* head; // first in first out
+    struct ui_decode_image* tail;
+    int32_t queued;
+    int32_t busy;  // requests taken by workers
+    int64_t bytes; // reserved
+    int64_t peak;
+    volatile int32_t quit;
+} ui_decode_pool;
+
+static uint32_t ui_decode_uint(const uint8_t* p, int32_t n, bool be) {
+    uint32_t v = 0;
+    for (int32_t i = 0; i < n; i++) {
+        v = (v << 8) | p[be ? i : n - 1 - i];
+    }
+    return v;
+}
+
+static bool ui_decode_ifd1(const uint8_t* t, int64_t n,
+        int64_t* offset, int64_t* length) {
+    // t: TIFF header of Exif, thumbnail offset and length are
+    // JPEGInterchangeFormat[Length] tags of IFD1 (second IFD)
+    bool found = false;
+    const bool le = n >= 8 && t[0] == 'I' && t[1] == 'I';
+    const bool be = n >= 8 && t[0] == 'M' && t[1] == 'M';
+    if ((le || be) && ui_decode_uint(t + 2, 2, be) == 42) {
+        const int64_t ifd0 = ui_decode_uint(t + 4, 4, be);
+        const int64_t next = ifd0 + 2 +
+            (ifd0 + 2 <= n ? ui_decode_uint(t + ifd0, 2, be) * 12LL : 0);
+        const int64_t ifd1 = next + 4 <= n ? ui_decode_uint(t + next, 4, be) : 0;
+        if (ifd0 >= 8 && ifd1 >= 8 && ifd1 + 2 <= n) {
+            const int32_t count = (int32_t)ui_decode_uint(t + ifd1, 2, be);
+            int64_t o = 0;
+            int64_t l = 0;
+            for (int32_t i = 0; i < count && ifd1 + 2 + (i + 1) * 12 <= n; i++) {
+                const uint8_t* e = t + ifd1 + 2 + i * 12;
+                const uint32_t tag  = ui_decode_uint(e, 2, be);
+                const uint32_t type = ui_decode_uint(e + 2, 2, be);
+                const int64_t v = type == 3 ? // SHORT or LONG
+                    ui_decode_uint(e + 8, 2, be) : ui_decode_uint(e + 8, 4, be);
+                if (tag == 0x0201) {
+                    o = v;
+                } else if (tag == 0x0202) {
+                    l = v;
+                }
+            }
+            found = o >= 8 && l > 0 && o + l <= n;
+            if (found) { *offset = o; *length = l; }
+        }
+    }
+    return found;
+}
+
+static bool ui_decode_thumbnail(const void* data, int64_t bytes,
+        int64_t* offset, int64_t* length) {
+    // JPEG segments: FF xx (big endian length including itself) up to
+    // the start of scan (FF DA) look for APP1 (FF E1) "Exif\0\0"
+    const uint8_t* p = (const uint8_t*)data;
+    bool found = false;
+    bool jpeg = bytes > 4 && p[0] == 0xFF && p[1] == 0xD8;
+    int64_t i = 2;
+    while (jpeg && !found && i + 4 <= bytes && p[i] == 0xFF) {
+        const uint8_t marker = p[i + 1];
+        const int64_t n = (int64_t)ui_decode_uint(p + i + 2, 2, true);
+        if (marker == 0xDA || marker == 0xD9 || n < 2 || i + 2 + n > bytes) {
+            jpeg = false;
+        } else {
+            if (marker == 0xE1 && n >= 8 + 8 &&
+                memcmp(p + i + 4, "Exif\0\0", 6) == 0) {
+                const int64_t tiff = i + 10;
+                found = ui_decode_ifd1(p + tiff, i + 2 + n - tiff,
+                                       offset, length);
+                if (found) { *offset += tiff; }
+            }
+            i += 2 + n;
+        }
+    }
+    return found;
+}
+
+static void ui_decode_post(struct ui_decode_image* di, struct posix_work* w) {
+    if (di->post != null) {
+        di->post(w);
+    } else {
+        w->work(w);
+    }
+}
+
+static int64_t ui_decode_estimate(const void* data, int64_t bytes,
+        int32_t preferred) {
+    int32_t w = 0;
+    int32_t h = 0;
+    int32_t bpp = 0;
+    int64_t estimate = 0;
+    if (ui_decode.codec.info != null &&
+        ui_decode.codec.info(data, bytes, &w, &h, &bpp)) {
+        estimate = (int64_t)w * h * (preferred != 0 ? preferred : bpp);
+    }
+    return estimate;
+}
+
+static void ui_decode_reserve(struct ui_decode_image* di, int64_t bytes) {
+    // waits until `bytes` fit into the budget unless nothing else is
+    // reserved (so an image bigger than the budget is decoded alone)
+    posix_mutex.lock(&ui_decode_pool.admit);
+    posix_mutex.lock(&ui_decode_pool.mutex);
+    while (ui_decode_pool.bytes > 0 &&
+           ui_decode_pool.bytes + bytes > ui_decode.budget &&
+           posix_atomics.load32(&ui_decode_pool.quit) == 0) {
+        posix_mutex.unlock(&ui_decode_pool.mutex);
+        posix_event.wait(ui_decode_pool.released);
+        posix_mutex.lock(&ui_decode_pool.mutex);
+    }
+    ui_decode_pool.bytes += bytes;
+    ui_decode_pool.peak = posix_max(ui_decode_pool.peak, ui_decode_pool.bytes);
+    di->reserved = bytes;
+    posix_mutex.unlock(&ui_decode_pool.mutex);
+    posix_mutex.unlock(&ui_decode_pool.admit);
+}
+
+static void ui_decode_adjust(struct ui_decode_image* di, int64_t bytes) {
+    // decoded size may differ from info() estimate
+    const bool released = bytes < di->reserved;
+    posix_mutex.lock(&ui_decode_pool.mutex);
+    ui_decode_pool.bytes += bytes - di->reserved;
+    ui_decode_pool.peak = posix_max(ui_decode_pool.peak, ui_decode_pool.bytes);
+    di->reserved = bytes;
+    posix_mutex.unlock(&ui_decode_pool.mutex);
+    if (released) { posix_event.set(ui_decode_pool.released); }
+}
+
+static void ui_decode_bitmap(struct ui_bitmap* b, void* pixels,
+        int32_t w, int32_t h, int32_t bpp) {
+    memset(b, 0x00, sizeof(*b));
+    if (pixels != null) {
+        b->pixels = pixels;
+        b->w = w;
+        b->h = h;
+        b->bpp = bpp;
+        b->stride = w * bpp;
+    }
+}
+
+static void ui_decode_one(struct ui_decode_image* di,
+        const void* data, int64_t bytes) {
+    int64_t offset = 0;
+    int64_t length = 0;
+    const bool preview = di->preview.work != null &&
+        ui_decode_thumbnail(data, bytes, &offset, &length);
+    const uint8_t* thumbnail = (const uint8_t*)data + offset;
+    int64_t estimate = ui_decode_estimate(data, bytes, di->bpp);
+    if (preview) {
+        estimate += ui_decode_estimate(thumbnail, length, di->bpp);
+    }
+    ui_decode_reserve(di, estimate);
+    if (posix_atomics.load32(&ui_decode_pool.quit) != 0) {
+        di->error = ECANCELED;
+    } else {
+        int32_t w = 0;
+        int32_t h = 0;
+        int32_t bpp = 0;
+        int64_t decoded = 0;
+        if (preview) {
+            void* p = ui_decode.codec.decode(thumbnail, length,
+                                             &w, &h, &bpp, di->bpp);
+            if (p != null) {
+                if (di->bpp != 0) { bpp = di->bpp; }
+                ui_decode_bitmap(&di->thumbnail, p, w, h, bpp);
+                decoded += (int64_t)w * h * bpp;
+                ui_decode_post(di, &di->preview);
+            }
+        }
+        void* p = ui_decode.codec.decode(data, bytes, &w, &h, &bpp, di->bpp);
+        if (p != null) {
+            if (di->bpp != 0) { bpp = di->bpp; }
+            ui_decode_bitmap(&di->image, p, w, h, bpp);
+            decoded += (int64_t)w * h * bpp;
+        } else {
+            di->error = EINVAL;
+        }
+        ui_decode_adjust(di, decoded);
+    }
+}
+
+static void ui_decode_worker(void* posix_unused(p)) {
+    posix_thread.name("ui_decode");
+    for (;;) {
+        posix_event.wait(ui_decode_pool.wake);
+        struct ui_decode_image* di = null;
+        do {
+            posix_mutex.lock(&ui_decode_pool.mutex);
+            di = posix_atomics.load32(&ui_decode_pool.quit) != 0 ?
+                 null : ui_decode_pool.head;
+            if (di != null) {
+                ui_decode_pool.head = di->next;
+                if (ui_decode_pool.head == null) { ui_decode_pool.tail = null; }
+                di->next = null;
+                ui_decode_pool.queued--;
+                ui_decode_pool.busy++;
+            }
+            const bool more = ui_decode_pool.head != null;
+            posix_mutex.unlock(&ui_decode_pool.mutex);
+            // auto-reset event wakes one worker, pass the wake on:
+            if (more) { posix_event.set(ui_decode_pool.wake); }
+            if (di != null) {
+                void* data = (void*)di->data;
+                int64_t bytes = di->bytes;
+                di->error = di->filename == null ? 0 :
+                            posix_mem.map_ro(di->filename, &data, &bytes);
+                if (di->error == 0) {
+                    ui_decode_one(di, data, bytes);
+                    if (di->filename != null) { posix_mem.unmap(data, bytes); }
+                }
+                const bool canceled = di->error == ECANCELED;
+                if (!canceled) { ui_decode_post(di, &di->done); }
+                // `di` may be already released and reused by now
+                posix_mutex.lock(&ui_decode_pool.mutex);
+                ui_decode_pool.busy--;
+                posix_mutex.unlock(&ui_decode_pool.mutex);
+            }
+        } while (di != null);
+        if (posix_atomics.load32(&ui_decode_pool.quit) != 0) {
+            posix_event.set(ui_decode_pool.wake); // wake next worker to quit
+            break;
+        }
+    }
+}
+
+static void ui_decode_start(void) {
+    if (ui_decode_pool.wake == null) {
+        posix_mutex.init(&ui_decode_pool.mutex);
+        posix_mutex.init(&ui_decode_pool.admit);
+        ui_decode_pool.wake = posix_event.create();
+        ui_decode_pool.released = posix_event.create();
+        const int32_t n = ui_decode.threads > 0 ?
+                          ui_decode.threads : ui_parallel.cores();
+        ui_decode_pool.workers = posix_max(1, posix_min(n, ui_decode_max_workers));
+        for (int32_t i = 0; i < ui_decode_pool.workers; i++) {
+            ui_decode_pool.thread[i] = posix_thread.start(ui_decode_worker, null);
+        }
+    }
+}
+
+static void ui_decode_decode(struct ui_decode_image* di) {
+    posix_swear(ui_decode.codec.decode != null && ui_decode.codec.dispose != null,
+                "ui_decode.codec is not set");
+    posix_swear(di->done.work != null);
+    posix_swear(di->filename != null || (di->data != null && di->bytes > 0));
+    posix_swear(di->bpp == 0 || di->bpp == 1 || di->bpp == 3 || di->bpp == 4);
+    ui_decode_start();
+    ui_decode_bitmap(&di->thumbnail, null, 0, 0, 0);
+    ui_decode_bitmap(&di->image, null, 0, 0, 0);
+    di->error = 0;
+    di->reserved = 0;
+    di->next = null;
+    posix_mutex.lock(&ui_decode_pool.mutex);
+    if (ui_decode_pool.tail == null) {
+        ui_decode_pool.head = di;
+    } else {
+        ui_decode_pool.tail->next = di;
+    }
+    ui_decode_pool.tail = di;
+    ui_decode_pool.queued++;
+    posix_mutex.unlock(&ui_decode_pool.mutex);
+    posix_event.set(ui_decode_pool.wake);
+}
+
+static void ui_decode_release(struct ui_decode_image* di) {
+    if (di->thumbnail.pixels != null) {
+        ui_decode.codec.dispose(di->thumbnail.pixels);
+    }
+    if (di->image.pixels != null) {
+        ui_decode.codec.dispose(di->image.pixels);
+    }
+    ui_decode_bitmap(&di->thumbnail, null, 0, 0, 0);
+    ui_decode_bitmap(&di->image, null, 0, 0, 0);
+    posix_mutex.lock(&ui_decode_pool.mutex);
+    ui_decode_pool.bytes -= di->reserved;
+    posix_assert(ui_decode_pool.bytes >= 0);
+    di->reserved = 0;
+    posix_mutex.unlock(&ui_decode_pool.mutex);
+    posix_event.set(ui_decode_pool.released);
+}
+
+static bool ui_decode_idle(void) {
+    bool idle = true;
+    if (ui_decode_pool.wake != null) {
+        posix_mutex.lock(&ui_decode_pool.mutex);
+        idle = ui_decode_pool.queued == 0 && ui_decode_pool.busy == 0;
+        posix_mutex.unlock(&ui_decode_pool.mutex);
+    }
+    return idle;
+}
+
+static int64_t ui_decode_bytes(void) {
+    int64_t bytes = 0;
+    if (ui_decode_pool.wake != null) {
+        posix_mutex.lock(&ui_decode_pool.mutex);
+        bytes = ui_decode_pool.bytes;
+        posix_mutex.unlock(&ui_decode_pool.mutex);
+    }
+    return bytes;
+}
+
+static int64_t ui_decode_peak(void) {
+    int64_t peak = 0;
+    if (ui_decode_pool.wake != null) {
+        posix_mutex.lock(&ui_decode_pool.mutex);
+        peak = ui_decode_pool.peak;
+        posix_mutex.unlock(&ui_decode_pool.mutex);
+    }
+    return peak;
+}
+
+static void ui_decode_dispose(void) {
+    if (ui_decode_pool.wake != null) {
+        posix_atomics.exchange_int32(&ui_decode_pool.quit, 1);
+        posix_event.set(ui_decode_pool.released);
+        posix_event.set(ui_decode_pool.wake);
+        for (int32_t i = 0; i < ui_decode_pool.workers; i++) {
+            // worker waiting for budget passes `released` on:
+            posix_event.set(ui_decode_pool.released);
+            posix_fatal_if(posix_thread.join(ui_decode_pool.thread[i], -1) != 0);
+            ui_decode_pool.thread[i] = null;
+        }
+        posix_event.dispose(ui_decode_pool.wake);
+        posix_event.dispose(ui_decode_pool.released);
+        posix_mutex.dispose(&ui_decode_pool.mutex);
+        posix_mutex.dispose(&ui_decode_pool.admit);
+        memset(&ui_decode_pool, 0x00, sizeof(ui_decode_pool));
+    }
+}
+
+// Test codec: "TEST" w h bpp (little endian uint16_t) value (uint8_t)
+// decodes into w * h * bpp bytes of `value`. JPEG with Exif thumbnail
+// wrapper is FF D8, APP1 with "TEST" thumbnail and "TEST" image after.
+
+enum { ui_decode_test_header = 11 };
+
+static const uint8_t* ui_decode_test_image(const void* data, int64_t* bytes) {
+    const uint8_t* p = (const uint8_t*)data;
+    if (*bytes > 6 && p[0] == 0xFF && p[1] == 0xD8 && p[2] == 0xFF &&
+        p[3] == 0xE1) {
+        const int64_t skip = 4 + ui_decode_uint(p + 4, 2, true);
+        p = skip < *bytes ? p + skip : null;
+        *bytes -= skip;
+    }
+    return p != null && *bytes >= ui_decode_test_header &&
+           memcmp(p, "TEST", 4) == 0 ? p : null;
+}
+
+static bool ui_decode_test_info(const void* data, int64_t bytes,
+        int32_t* w, int32_t* h, int32_t* bpp) {
+    const uint8_t* p = ui_decode_test_image(data, &bytes);
+    if (p != null) {
+        *w   = (int32_t)ui_decode_uint(p + 4, 2, false);
+        *h   = (int32_t)ui_decode_uint(p + 6, 2, false);
+        *bpp = (int32_t)ui_decode_uint(p + 8, 2, false);
+    }
+    return p != null;
+}
+
+static void* ui_decode_test_decode(const void* data, int64_t bytes,
+        int32_t* w, int32_t* h, int32_t* bpp, int32_t preferred) {
+    void* pixels = null;
+    const uint8_t* p = ui_decode_test_image(data, &bytes);
+    if (p != null && ui_decode_test_info(p, bytes, w, h, bpp)) {
+        const int32_t n = preferred != 0 ? preferred : *bpp;
+        const int64_t size = (int64_t)*w * *h * n;
+        posix_fatal_if(posix_heap.alloc(&pixels, posix_max(1, size)) != 0);
+        memset(pixels, p[10], (size_t)size);
+    }
+    return pixels;
+}
+
+static void ui_decode_test_dispose(void* pixels) {
+    posix_heap.free(pixels);
+}
+
+static int32_t ui_decode_test_put(uint8_t* d, int32_t w, int32_t h,
+        int32_t bpp, uint8_t value) {
+    memcpy(d, "TEST", 4);
+    d[4] = (uint8_t)w; d[5] = (uint8_t)(w >> 8);
+    d[6] = (uint8_t)h; d[7] = (uint8_t)(h >> 8);
+    d[8] = (uint8_t)bpp; d[9] = 0;
+    d[10] = value;
+    return ui_decode_test_header;
+}
+
+static int32_t ui_decode_test_jpeg(uint8_t* d, int32_t w, int32_t h,
+        int32_t bpp, uint8_t value) {
+    // FF D8 | FF E1 length "Exif\0\0" | TIFF: "II" 42 IFD0 offset 8
+    // IFD0: 0 entries next 14 | IFD1: 2 entries next 0 | thumbnail
+    // then the image follows APP1 segment
+    static const uint8_t tiff[] = {
+        'I', 'I', 42, 0, 8, 0, 0, 0,
+        0, 0, 14, 0, 0, 0,
+        2, 0,
+        0x01, 0x02, 4, 0, 1, 0, 0, 0, 44, 0, 0, 0,
+        0x02, 0x02, 4, 0, 1, 0, 0, 0, ui_decode_test_header, 0, 0, 0,
+        0, 0, 0, 0
+    };
+    int32_t n = 0;
+    d[n++] = 0xFF; d[n++] = 0xD8; d[n++] = 0xFF; d[n++] = 0xE1;
+    const int32_t length = 2 + 6 + (int32_t)sizeof(tiff) + ui_decode_test_header;
+    d[n++] = (uint8_t)(length >> 8); d[n++] = (uint8_t)length;
+    memcpy(d + n, "Exif\0\0", 6); n += 6;
+    memcpy(d + n, tiff, sizeof(tiff)); n += (int32_t)sizeof(tiff);
+    n += ui_decode_test_put(d + n, posix_max(1, w / 8), posix_max(1, h / 8),
+                            bpp, (uint8_t)~value);
+    n += ui_decode_test_put(d + n, w, h, bpp, value);
+    return n;
+}
+
+enum { ui_decode_test_images = 64 };
+
+static struct {
+    struct ui_decode_image di[ui_decode_test_images];
+    uint8_t data[ui_decode_test_images][128];
+    uint8_t value[ui_decode_test_images];
+    bool    exif[ui_decode_test_images];
+    bool    previewed[ui_decode_test_images];
+    volatile int32_t previews;
+    volatile int32_t done;
+    struct posix_work_queue queue;
+} ui_decode_test_state;
+
+static void ui_decode_test_post(struct posix_work* w) {
+    w->queue = &ui_decode_test_state.queue;
+    posix_work_queue.post(w);
+}
+
+static void ui_decode_test_check(const struct ui_bitmap* b, uint8_t value) {
+    const uint8_t* p = (const uint8_t*)b->pixels;
+    posix_swear(p != null && b->stride == b->w * b->bpp);
+    for (int32_t i = 0; i < b->h * b->stride; i++) {
+        posix_swear(p[i] == value);
+    }
+}
+
+static void ui_decode_test_preview(struct posix_work* w) {
+    const int32_t i = (int32_t)(uintptr_t)w->data;
+    struct ui_decode_image* di = &ui_decode_test_state.di[i];
+    posix_swear(ui_decode_test_state.exif[i] && !ui_decode_test_state.previewed[i]);
+    ui_decode_test_check(&di->thumbnail, (uint8_t)~ui_decode_test_state.value[i]);
+    ui_decode_test_state.previewed[i] = true;
+    posix_atomics.increment_int32(&ui_decode_test_state.previews);
+}
+
+static void ui_decode_test_done(struct posix_work* w) {
+    const int32_t i = (int32_t)(uintptr_t)w->data;
+    struct ui_decode_image* di = &ui_decode_test_state.di[i];
+    // preview (if any) is delivered before the image:
+    posix_swear(ui_decode_test_state.exif[i] == ui_decode_test_state.previewed[i]);
+    posix_swear(ui_decode_test_state.exif[i] == (di->thumbnail.pixels != null));
+    if (i % 13 == 7) { // corrupt
+        posix_swear(di->error != 0 && di->image.pixels == null);
+    } else {
+        posix_swear(di->error == 0);
+        ui_decode_test_check(&di->image, ui_decode_test_state.value[i]);
+    }
+    posix_swear(ui_decode.bytes() <= ui_decode.budget ||
+                di->reserved > ui_decode.budget);
+    ui_decode.release(di);
+    posix_atomics.increment_int32(&ui_decode_test_state.done);
+}
+
+static void ui_decode_test_thumbnail(void) {
+    uint8_t jpeg[128];
+    const int32_t n = ui_decode_test_jpeg(jpeg, 64, 48, 3, 0x5A);
+    int64_t offset = 0;
+    int64_t length = 0;
+    posix_swear(ui_decode.thumbnail(jpeg, n, &offset, &length));
+    posix_swear(length == ui_decode_test_header);
+    posix_swear(memcmp(jpeg + offset, "TEST", 4) == 0 &&
+                jpeg[offset + 10] == (uint8_t)~0x5A);
+    for (int32_t i = 0; i < n - ui_decode_test_header; i++) {
+        // truncated APP1 segment
+        posix_swear(!ui_decode.thumbnail(jpeg, i, &offset, &length));
+    }
+    jpeg[12 + 1] = 'M'; // "IM" is neither little nor big endian
+    posix_swear(!ui_decode.thumbnail(jpeg, n, &offset, &length));
+    uint8_t plain[16];
+    ui_decode_test_put(plain, 4, 4, 4, 0);
+    posix_swear(!ui_decode.thumbnail(plain, ui_decode_test_header,
+                                     &offset, &length));
+}
+
+static void ui_decode_test_run(int32_t threads, int64_t budget, bool post) {
+    ui_decode.threads = threads;
+    ui_decode.budget = budget;
+    ui_decode_test_state.previews = 0;
+    ui_decode_test_state.done = 0;
+    int32_t exifs = 0;
+    for (int32_t i = 0; i < ui_decode_test_images; i++) {
+        struct ui_decode_image* di = &ui_decode_test_state.di[i];
+        memset(di, 0x00, sizeof(*di));
+        const int32_t w = 16 + i * 7 % 64;
+        const int32_t h = 8 + i * 5 % 32;
+        const int32_t bpp = i % 3 == 0 ? 1 : (i % 3 == 1 ? 3 : 4);
+        const uint8_t value = (uint8_t)(i * 37 + 1);
+        ui_decode_test_state.value[i] = value;
+        ui_decode_test_state.exif[i] = i % 2 == 0 && i % 13 != 7;
+        ui_decode_test_state.previewed[i] = false;
+        di->data = ui_decode_test_state.data[i];
+        di->bytes = i % 2 == 0 ?
+            ui_decode_test_jpeg(ui_decode_test_state.data[i], w, h, bpp, value) :
+            ui_decode_test_put(ui_decode_test_state.data[i], w, h, bpp, value);
+        if (i % 13 == 7) { di->bytes = 3; } // corrupt
+        di->post = post ? ui_decode_test_post : null;
+        di->preview.work = ui_decode_test_preview;
+        di->preview.data = (void*)(uintptr_t)i;
+        di->done.work = ui_decode_test_done;
+        di->done.data = (void*)(uintptr_t)i;
+        exifs += ui_decode_test_state.exif[i];
+    }
+    for (int32_t i = 0; i < ui_decode_test_images; i++) {
+        ui_decode.decode(&ui_decode_test_state.di[i]);
+    }
+    while (posix_atomics.load32(&ui_decode_test_state.done) <
+           ui_decode_test_images) {
+        posix_work_queue.dispatch(&ui_decode_test_state.queue);
+        posix_thread.sleep_for(0.0001);
+    }
+    posix_swear(ui_decode_test_state.previews == exifs);
+    while (!ui_decode.idle()) { posix_thread.sleep_for(0.0001); }
+    posix_swear(ui_decode.bytes() == 0);
+    posix_swear(ui_decode.peak() <= budget, "peak: %lld budget: %lld",
+                ui_decode.peak(), budget);
+    ui_decode.dispose();
+}
+
+static void ui_decode_test(void) {
+    ui_decode_test_thumbnail();
+    const struct ui_decode_codec codec = ui_decode.codec;
+    const int64_t budget = ui_decode.budget;
+    const int32_t threads = ui_decode.threads;
+    ui_decode.codec = (struct ui_decode_codec){
+        .info    = ui_decode_test_info,
+        .decode  = ui_decode_test_decode,
+        .dispose = ui_decode_test_dispose
+    };
+    // largest image: 79 x 39 x 4 + thumbnail 9 x 4 x 4
+    ui_decode_test_run(0, 16 * 1024, true);
+    ui_decode_test_run(3, 16 * 1024, false);
+    ui_decode_test_run(4, 13 * 1024, true); // mostly one at a time
+    ui_decode_test_run(1, 1024 * 1024, true);
+    ui_decode.codec = codec;
+    ui_decode.budget = budget;
+    ui_decode.threads = threads;
+    if (posix_debug.verbosity.level > posix_debug.verbosity.quiet) {
+        posix_println("done");
+    }
+}
+
+struct ui_decode_if ui_decode = {
+    .budget    = 256LL * 1024 * 1024,
+    .decode    = ui_decode_decode,
+    .release   = ui_decode_release,
+    .thumbnail = ui_decode_thumbnail,
+    .idle      = ui_decode_idle,
+    .bytes     = ui_decode_bytes,
+    .peak      = ui_decode_peak,
+    .dispose   = ui_decode_dispose,
+    .test      = ui_decode_test
+};
+
+#ifdef UI_DECODE_TEST
+    posix_static_init(ui_decode) { ui_decode.test(); }
+#endif
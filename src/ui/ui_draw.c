@@ -21,17 +21,22 @@ struct ui_draw_context {
     ui_brush_t brush;
     HBITMAP texture;
     dxd_context_t dxd; // Direct2D draw context for this begin()/end() frame
+    struct ui_raster* raster; // software rendering of image w/o .texture
 };
 
 static struct ui_draw_context ui_draw_context;
 
+static struct ui_raster ui_draw_rasterizer; // display list reused by frames
+
 #define ui_draw_hdc() (ui_draw_context.hdc)
+#define ui_draw_raster() (ui_draw_context.raster)
 
 static void ui_draw_init(void) {
     dxd_init();
 }
 
 static void ui_draw_fini(void) {
+    ui_raster.dispose(&ui_draw_rasterizer);
     dxd_fini();
 }
 
@@ -64,29 +69,40 @@ static ui_font_t ui_draw_set_font(ui_font_t f) {
 }
 
 static void ui_draw_begin(struct ui_bitmap* image) {
-    posix_swear(ui_draw_context.hdc == null, "no nested begin()/end()");
-    if (image != null) {
-        posix_swear(image->texture != null);
-        ui_draw_context.hdc = CreateCompatibleDC((HDC)ui_app.canvas);
-        ui_draw_context.texture = SelectBitmap(ui_draw_hdc(),
-                                             (HBITMAP)image->texture);
+    posix_swear(ui_draw_hdc() == null && ui_draw_raster() == null,
+                "no nested begin()/end()");
+    if (image != null && image->texture == null) {
+        // 4 bytes per pixel premultiplied BGRA w/o DIB section (e.g.
+        // offscreen or headless): painted by ui_raster w/o GDI and D2D
+        ui_draw_context.raster = &ui_draw_rasterizer;
+        ui_raster.begin(ui_draw_raster(), image);
     } else {
-        ui_draw_context.hdc = (HDC)ui_app.canvas;
-        posix_swear(ui_draw_context.texture == null);
+        if (image != null) {
+            ui_draw_context.hdc = CreateCompatibleDC((HDC)ui_app.canvas);
+            ui_draw_context.texture = SelectBitmap(ui_draw_hdc(),
+                                                 (HBITMAP)image->texture);
+        } else {
+            ui_draw_context.hdc = (HDC)ui_app.canvas;
+            posix_swear(ui_draw_context.texture == null);
+        }
+        struct ui_rect rc = image != null ?
+            (struct ui_rect){ 0, 0, image->w, image->h } :
+            (struct ui_rect){ 0, 0, ui_app.crc.w, ui_app.crc.h };
+        ui_draw_context.dxd = dxd_begin(ui_draw_context.hdc, &rc);
     }
     ui_draw_context.text_color = ui_colors.get_color(ui_color_id_window_text);
-    struct ui_rect rc = image != null ?
-        (struct ui_rect){ 0, 0, image->w, image->h } :
-        (struct ui_rect){ 0, 0, ui_app.crc.w, ui_app.crc.h };
-    ui_draw_context.dxd = dxd_begin(ui_draw_context.hdc, &rc);
 }
 
 static void ui_draw_end(void) {
+    if (ui_draw_raster() != null) {
+        const int r = ui_raster.end(ui_draw_raster());
+        if (r != 0) { posix_println("ui_raster.end() %s", posix_strerr(r)); }
+    }
     if (ui_draw_context.dxd != null) {
         dxd_end(ui_draw_context.dxd);
         ui_draw_context.dxd = null;
     }
-    if (ui_draw_context.hdc != (HDC)ui_app.canvas) {
+    if (ui_draw_hdc() != null && ui_draw_hdc() != (HDC)ui_app.canvas) {
         posix_swear(ui_draw_context.texture != null); // 1x1 bitmap
         SelectBitmap(ui_draw_context.hdc, (HBITMAP)ui_draw_context.texture);
         posix_fatal_win32err(DeleteDC(ui_draw_context.hdc));
@@ -124,44 +140,78 @@ static ui_color_t ui_draw_set_brush_color(ui_color_t c) {
 }
 
 static void ui_draw_set_clip(int32_t x, int32_t y, int32_t w, int32_t h) {
-    dxd_set_clip(ui_draw_context.dxd, x, y, w, h);
+    if (ui_draw_raster() != null) {
+        ui_raster.set_clip(ui_draw_raster(), x, y, w, h);
+    } else {
+        dxd_set_clip(ui_draw_context.dxd, x, y, w, h);
+    }
 }
 
 static void ui_draw_pixel(int32_t x, int32_t y, ui_color_t c) {
-    dxd_pixel(ui_draw_context.dxd, x, y, c);
+    if (ui_draw_raster() != null) {
+        ui_raster.pixel(ui_draw_raster(), x, y, c);
+    } else {
+        dxd_pixel(ui_draw_context.dxd, x, y, c);
+    }
 }
 
 static void ui_draw_rectangle(int32_t x, int32_t y, int32_t w, int32_t h) {
-    posix_fatal_win32err(Rectangle(ui_draw_hdc(), x, y, x + w, y + h));
+    if (ui_draw_hdc() != null) { // GDI pen and brush, no-op for ui_raster
+        posix_fatal_win32err(Rectangle(ui_draw_hdc(), x, y, x + w, y + h));
+    }
 }
 
 static void ui_draw_line(int32_t x0, int32_t y0, int32_t x1, int32_t y1,
         ui_color_t c) {
-    dxd_line(ui_draw_context.dxd, x0, y0, x1, y1, c);
+    if (ui_draw_raster() != null) {
+        ui_raster.line(ui_draw_raster(), x0, y0, x1, y1, c);
+    } else {
+        dxd_line(ui_draw_context.dxd, x0, y0, x1, y1, c);
+    }
 }
 
 static void ui_draw_frame(int32_t x, int32_t y, int32_t w, int32_t h,
         ui_color_t c) {
-    dxd_frame(ui_draw_context.dxd, x, y, w, h, c);
+    if (ui_draw_raster() != null) {
+        ui_raster.frame(ui_draw_raster(), x, y, w, h, c);
+    } else {
+        dxd_frame(ui_draw_context.dxd, x, y, w, h, c);
+    }
 }
 
 static void ui_draw_rect(int32_t x, int32_t y, int32_t w, int32_t h,
         ui_color_t border, ui_color_t fill) {
-    dxd_rect(ui_draw_context.dxd, x, y, w, h, border, fill);
+    if (ui_draw_raster() != null) {
+        ui_raster.rect(ui_draw_raster(), x, y, w, h, border, fill);
+    } else {
+        dxd_rect(ui_draw_context.dxd, x, y, w, h, border, fill);
+    }
 }
 
 static void ui_draw_fill(int32_t x, int32_t y, int32_t w, int32_t h,
         ui_color_t c) {
-    dxd_fill(ui_draw_context.dxd, x, y, w, h, c);
+    if (ui_draw_raster() != null) {
+        ui_raster.fill(ui_draw_raster(), x, y, w, h, c);
+    } else {
+        dxd_fill(ui_draw_context.dxd, x, y, w, h, c);
+    }
 }
 
 static void ui_draw_poly(struct ui_point* points, int32_t count, ui_color_t c) {
-    dxd_poly(ui_draw_context.dxd, points, count, c);
+    if (ui_draw_raster() != null) {
+        ui_raster.poly(ui_draw_raster(), points, count, c);
+    } else {
+        dxd_poly(ui_draw_context.dxd, points, count, c);
+    }
 }
 
 static void ui_draw_circle(int32_t x, int32_t y, int32_t radius,
         ui_color_t border, ui_color_t fill) {
-    dxd_circle(ui_draw_context.dxd, x, y, radius, border, fill);
+    if (ui_draw_raster() != null) {
+        ui_raster.circle(ui_draw_raster(), x, y, radius, border, fill);
+    } else {
+        dxd_circle(ui_draw_context.dxd, x, y, radius, border, fill);
+    }
 }
 
 static void ui_draw_fill_rounded(int32_t x, int32_t y, int32_t w, int32_t h,
@@ -206,12 +256,22 @@ static void ui_draw_rounded_border(int32_t x, int32_t y, int32_t w, int32_t h,
 
 static void ui_draw_rounded(int32_t x, int32_t y, int32_t w, int32_t h,
         int32_t radius, ui_color_t border, ui_color_t fill) {
-    dxd_rounded(ui_draw_context.dxd, x, y, w, h, radius, border, fill);
+    if (ui_draw_raster() != null) {
+        ui_raster.rounded(ui_draw_raster(), x, y, w, h, radius, border, fill);
+    } else {
+        dxd_rounded(ui_draw_context.dxd, x, y, w, h, radius, border, fill);
+    }
 }
 
 static void ui_draw_gradient(int32_t x, int32_t y, int32_t w, int32_t h,
         ui_color_t rgba_from, ui_color_t rgba_to, bool vertical) {
-    dxd_gradient(ui_draw_context.dxd, x, y, w, h, rgba_from, rgba_to, vertical);
+    if (ui_draw_raster() != null) {
+        ui_raster.gradient(ui_draw_raster(), x, y, w, h, rgba_from, rgba_to,
+                           vertical);
+    } else {
+        dxd_gradient(ui_draw_context.dxd, x, y, w, h, rgba_from, rgba_to,
+                     vertical);
+    }
 }
 
 static BITMAPINFO* ui_draw_greyscale_bitmap_info(void) {
@@ -256,8 +316,13 @@ static void ui_draw_pixels(int32_t dx, int32_t dy, int32_t dw, int32_t dh,
 static void ui_draw_greyscale(int32_t dx, int32_t dy, int32_t dw, int32_t dh,
         int32_t ix, int32_t iy, int32_t iw, int32_t ih,
         int32_t width, int32_t height, int32_t stride, const uint8_t* pixels) {
-    dxd_image(ui_draw_context.dxd, dx, dy, dw, dh, ix, iy, iw, ih,
-              width, height, stride, 1, pixels, 1.0, false);
+    if (ui_draw_raster() != null) {
+        ui_raster.image(ui_draw_raster(), dx, dy, dw, dh, ix, iy, iw, ih,
+                        width, height, stride, 1, pixels, 1.0, false);
+    } else {
+        dxd_image(ui_draw_context.dxd, dx, dy, dw, dh, ix, iy, iw, ih,
+                  width, height, stride, 1, pixels, 1.0, false);
+    }
 }
 
 static BITMAPINFOHEADER ui_draw_bgrx_init_bi(int32_t w, int32_t h, int32_t bpp) {
@@ -284,16 +349,26 @@ static void ui_draw_bgr(int32_t dx, int32_t dy, int32_t dw, int32_t dh,
         int32_t ix, int32_t iy, int32_t iw, int32_t ih,
         int32_t width, int32_t height, int32_t stride,
         const uint8_t* pixels) {
-    dxd_image(ui_draw_context.dxd, dx, dy, dw, dh, ix, iy, iw, ih,
-              width, height, stride, 3, pixels, 1.0, false);
+    if (ui_draw_raster() != null) {
+        ui_raster.image(ui_draw_raster(), dx, dy, dw, dh, ix, iy, iw, ih,
+                        width, height, stride, 3, pixels, 1.0, false);
+    } else {
+        dxd_image(ui_draw_context.dxd, dx, dy, dw, dh, ix, iy, iw, ih,
+                  width, height, stride, 3, pixels, 1.0, false);
+    }
 }
 
 static void ui_draw_bgrx(int32_t dx, int32_t dy, int32_t dw, int32_t dh,
         int32_t ix, int32_t iy, int32_t iw, int32_t ih,
         int32_t width, int32_t height, int32_t stride,
         const uint8_t* pixels) {
-    dxd_image(ui_draw_context.dxd, dx, dy, dw, dh, ix, iy, iw, ih,
-              width, height, stride, 4, pixels, 1.0, false);
+    if (ui_draw_raster() != null) {
+        ui_raster.image(ui_draw_raster(), dx, dy, dw, dh, ix, iy, iw, ih,
+                        width, height, stride, 4, pixels, 1.0, false);
+    } else {
+        dxd_image(ui_draw_context.dxd, dx, dy, dw, dh, ix, iy, iw, ih,
+                  width, height, stride, 4, pixels, 1.0, false);
+    }
 }
 
 static BITMAPINFO* ui_draw_init_bitmap_info(int32_t w, int32_t h, int32_t bpp,
@@ -333,35 +408,10 @@ static void ui_draw_bitmap_init_rgbx(struct ui_bitmap* image, int32_t w, int32_t
     ui_draw_create_dib_section(image, w, h, bpp);
     const int32_t stride = (w * bpp + 3) & ~0x3;
     uint8_t* scanline = image->pixels;
-    const uint8_t* rgbx = pixels;
-    if (!swapped) {
-        for (int32_t y = 0; y < h; y++) {
-            uint8_t* bgra = scanline;
-            for (int32_t x = 0; x < w; x++) {
-                bgra[0] = rgbx[2];
-                bgra[1] = rgbx[1];
-                bgra[2] = rgbx[0];
-                bgra[3] = 0xFF;
-                bgra += 4;
-                rgbx += 4;
-            }
-            pixels += w * 4;
-            scanline += stride;
-        }
-    } else {
-        for (int32_t y = 0; y < h; y++) {
-            uint8_t* bgra = scanline;
-            for (int32_t x = 0; x < w; x++) {
-                bgra[0] = rgbx[0];
-                bgra[1] = rgbx[1];
-                bgra[2] = rgbx[2];
-                bgra[3] = 0xFF;
-                bgra += 4;
-                rgbx += 4;
-            }
-            pixels += w * 4;
-            scanline += stride;
-        }
+    for (int32_t y = 0; y < h; y++) {
+        ui_pixels.rgbx(scanline, pixels, w, !swapped);
+        pixels += w * 4;
+        scanline += stride;
     }
     image->w = w;
     image->h = h;
@@ -378,76 +428,18 @@ static void ui_draw_bitmap_init(struct ui_bitmap* image, int32_t w, int32_t h, i
     // Win32 bitmaps stride is rounded up to 4 bytes
     const int32_t stride = (w * bpp + 3) & ~0x3;
     uint8_t* scanline = image->pixels;
-    if (bpp == 1) {
-        for (int32_t y = 0; y < h; y++) {
-            memcpy(scanline, pixels, (size_t)w);
-            pixels += w;
-            scanline += stride;
-        }
-    } else if (bpp == 3 && !swapped) {
-        const uint8_t* rgb = pixels;
-        for (int32_t y = 0; y < h; y++) {
-            uint8_t* bgr = scanline;
-            for (int32_t x = 0; x < w; x++) {
-                bgr[0] = rgb[2];
-                bgr[1] = rgb[1];
-                bgr[2] = rgb[0];
-                bgr += 3;
-                rgb += 3;
-            }
-            pixels += w * bpp;
-            scanline += stride;
-        }
-    } else if (bpp == 3 && swapped) {
-        const uint8_t* rgb = pixels;
-        for (int32_t y = 0; y < h; y++) {
-            uint8_t* bgr = scanline;
-            for (int32_t x = 0; x < w; x++) {
-                bgr[0] = rgb[0];
-                bgr[1] = rgb[1];
-                bgr[2] = rgb[2];
-                bgr += 3;
-                rgb += 3;
-            }
-            pixels += w * bpp;
-            scanline += stride;
-        }
-    } else if (bpp == 4 && !swapped) {
-        // premultiply alpha, see:
-        // https://stackoverflow.com/questions/24595717/alphablend-generating-incorrect-colors
-        const uint8_t* rgba = pixels;
-        for (int32_t y = 0; y < h; y++) {
-            uint8_t* bgra = scanline;
-            for (int32_t x = 0; x < w; x++) {
-                int32_t alpha = rgba[3];
-                bgra[0] = (uint8_t)(rgba[2] * alpha / 255);
-                bgra[1] = (uint8_t)(rgba[1] * alpha / 255);
-                bgra[2] = (uint8_t)(rgba[0] * alpha / 255);
-                bgra[3] = rgba[3];
-                bgra += 4;
-                rgba += 4;
-            }
-            pixels += w * 4;
-            scanline += stride;
-        }
-    } else if (bpp == 4 && swapped) {
-        // premultiply alpha, see:
-        // https://stackoverflow.com/questions/24595717/alphablend-generating-incorrect-colors
-        const uint8_t* rgba = pixels;
-        for (int32_t y = 0; y < h; y++) {
-            uint8_t* bgra = scanline;
-            for (int32_t x = 0; x < w; x++) {
-                int32_t alpha = rgba[3];
-                bgra[0] = (uint8_t)(rgba[0] * alpha / 255);
-                bgra[1] = (uint8_t)(rgba[1] * alpha / 255);
-                bgra[2] = (uint8_t)(rgba[2] * alpha / 255);
-                bgra[3] = rgba[3];
-                bgra += 4;
-                rgba += 4;
-            }
-            pixels += w * 4;
-            scanline += stride;
+    for (int32_t y = 0; y < h; y++) {
+        if (bpp == 1 || (bpp == 3 && swapped)) {
+            memcpy(scanline, pixels, (size_t)(w * bpp));
+        } else if (bpp == 3) {
+            ui_pixels.rgb(scanline, pixels, w);
+        } else {
+            // premultiply alpha, see:
+            // https://stackoverflow.com/questions/24595717/alphablend-generating-incorrect-colors
+            ui_pixels.premultiply(scanline, pixels, w, !swapped);
         }
+        pixels += w * bpp;
+        scanline += stride;
     }
     image->w = w;
     image->h = h;
@@ -460,23 +452,37 @@ static void ui_draw_alpha(int32_t dx, int32_t dy, int32_t dw, int32_t dh,
         struct ui_bitmap* image, fp64_t alpha) {
     posix_assert(image->bpp > 0);
     posix_assert(0 <= alpha && alpha <= 1);
-    dxd_image_cached(ui_draw_context.dxd, &image->dxd, dx, dy, dw, dh,
-              ix, iy, iw, ih, image->w, image->h, image->stride, image->bpp,
-              (const uint8_t*)image->pixels, alpha, true);
+    if (ui_draw_raster() != null) {
+        ui_raster.image(ui_draw_raster(), dx, dy, dw, dh, ix, iy, iw, ih,
+            image->w, image->h, image->stride, image->bpp,
+            (const uint8_t*)image->pixels, alpha, true);
+    } else {
+        dxd_image_cached(ui_draw_context.dxd, &image->dxd, dx, dy, dw, dh,
+                  ix, iy, iw, ih, image->w, image->h, image->stride, image->bpp,
+                  (const uint8_t*)image->pixels, alpha, true);
+    }
 }
 
 static void ui_draw_bitmap(int32_t dx, int32_t dy, int32_t dw, int32_t dh,
         int32_t ix, int32_t iy, int32_t iw, int32_t ih,
         struct ui_bitmap* image) {
     posix_assert(image->bpp == 1 || image->bpp == 3 || image->bpp == 4);
-    dxd_image_cached(ui_draw_context.dxd, &image->dxd, dx, dy, dw, dh,
-              ix, iy, iw, ih, image->w, image->h, image->stride, image->bpp,
-              (const uint8_t*)image->pixels, 1.0, false);
+    if (ui_draw_raster() != null) {
+        ui_raster.image(ui_draw_raster(), dx, dy, dw, dh, ix, iy, iw, ih,
+            image->w, image->h, image->stride, image->bpp,
+            (const uint8_t*)image->pixels, 1.0, false);
+    } else {
+        dxd_image_cached(ui_draw_context.dxd, &image->dxd, dx, dy, dw, dh,
+                  ix, iy, iw, ih, image->w, image->h, image->stride, image->bpp,
+                  (const uint8_t*)image->pixels, 1.0, false);
+    }
 }
 
 static void ui_draw_icon(int32_t x, int32_t y, int32_t w, int32_t h,
         ui_icon_t icon) {
-    DrawIconEx(ui_draw_hdc(), x, y, (HICON)icon, w, h, 0, NULL, DI_NORMAL | DI_COMPAT);
+    if (ui_draw_hdc() != null) { // GDI only, not drawn by ui_raster
+        DrawIconEx(ui_draw_hdc(), x, y, (HICON)icon, w, h, 0, NULL, DI_NORMAL | DI_COMPAT);
+    }
 }
 
 static void ui_draw_cleartype(bool on) {
@@ -773,6 +779,44 @@ struct ui_draw_dtp { // draw text parameters
     // DT_SINGLELINE versus multiline
 };
 
+static void ui_draw_raster_text(struct ui_draw_dtp* p, const char* text,
+        int32_t w, int32_t h) {
+    // GDI draws white text on black DIB section, green channel is
+    // used as coverage of the text color by ui_raster.mask()
+    const int32_t n = posix_str.utf16_chars(text, -1);
+    uint16_t* ws = null;
+    uint8_t* coverage = null;
+    posix_fatal_if(posix_heap.alloc((void**)&ws, n * (int64_t)sizeof(uint16_t)) != 0);
+    posix_fatal_if(posix_heap.alloc((void**)&coverage, (int64_t)w * h) != 0);
+    posix_str.utf8to16(ws, n, text, -1);
+    BITMAPINFOHEADER bi = ui_draw_bgrx_init_bi(w, h, 4);
+    uint32_t* pixels = null;
+    HDC hdc = CreateCompatibleDC(null);
+    posix_not_null(hdc);
+    HBITMAP dib = CreateDIBSection(hdc, (BITMAPINFO*)&bi, DIB_RGB_COLORS,
+                                   (void**)&pixels, null, 0);
+    posix_fatal_if(dib == null || pixels == null);
+    memset(pixels, 0x00, (size_t)w * h * 4);
+    HBITMAP saved_bitmap = SelectBitmap(hdc, dib);
+    HFONT saved_font = SelectFont(hdc, (HFONT)p->fm->font);
+    SetBkMode(hdc, TRANSPARENT);
+    SetTextColor(hdc, RGB(0xFF, 0xFF, 0xFF));
+    RECT rc = { .left = 0, .top = 0, .right = w, .bottom = h };
+    DrawTextW(hdc, ws, n - 1, &rc, p->flags & ~DT_CALCRECT);
+    GdiFlush();
+    for (int32_t i = 0; i < w * h; i++) {
+        coverage[i] = (uint8_t)(pixels[i] >> 8);
+    }
+    ui_raster.mask(ui_draw_raster(), p->rc.left, p->rc.top, w, h,
+                   coverage, w, p->color);
+    SelectFont(hdc, saved_font);
+    SelectBitmap(hdc, saved_bitmap);
+    posix_fatal_win32err(DeleteBitmap(dib));
+    posix_fatal_win32err(DeleteDC(hdc));
+    posix_heap.free(coverage);
+    posix_heap.free(ws);
+}
+
 static void ui_draw_text_draw(struct ui_draw_dtp* p) {
     posix_not_null(p);
     char text[4096]; // expected to be enough for single text draw
@@ -786,9 +830,15 @@ static void ui_draw_text_draw(struct ui_draw_dtp* p) {
         const bool multiline = (p->flags & DT_SINGLELINE) == 0;
         const bool mnemonic = (p->flags & DT_NOPREFIX) == 0;
         const int32_t w = p->rc.right - p->rc.left;
-        struct ui_wh wh = dxd_text(ui_draw_context.dxd, p->fm->font,
-                              p->rc.left, p->rc.top, w, p->color,
-                              text, k, measure_only, multiline, mnemonic);
+        // ui_raster measures with DirectWrite and draws with GDI:
+        const bool raster = ui_draw_raster() != null;
+        struct ui_wh wh = dxd_text(raster ? null : ui_draw_context.dxd,
+                              p->fm->font, p->rc.left, p->rc.top, w, p->color,
+                              text, k, measure_only || raster, multiline,
+                              mnemonic);
+        if (raster && !measure_only && wh.w > 0 && wh.h > 0) {
+            ui_draw_raster_text(p, text, wh.w, wh.h);
+        }
         p->rc.right = p->rc.left + wh.w;
         p->rc.bottom = p->rc.top + wh.h;
     } else {
@@ -0,0 +1,427 @@
+/* Copyright (c) Dmitry "Leo" Kuznetsov 2021-24 see LICENSE for details */
+#include "posix/posix.h"
+#include "ui/ui_edit_advance.h"
+
+#undef UI_EDIT_ADVANCE_TEST
+#undef UI_EDIT_ADVANCE_TEST_BENCHMARK
+
+#if 0 // flip to 1 to run tests
+
+#define UI_EDIT_ADVANCE_TEST
+
+#if 0 // flip to 1 to run lengthy benchmark
+#define UI_EDIT_ADVANCE_TEST_BENCHMARK
+#endif
+
+#endif
+
+enum {
+    ui_edit_advance_max_key = 32, // longer clusters are not cached
+    ui_edit_advance_min_capacity = 256
+};
+
+struct ui_edit_advance_entry {
+    uint64_t hash; // 0 for empty entry
+    int32_t  advance;
+    int32_t  bytes;
+    char     utf8[ui_edit_advance_max_key];
+};
+
+static bool ui_edit_advance_is_regional_indicator(uint32_t cp) {
+    return 0x1F1E6 <= cp && cp <= 0x1F1FF;
+}
+
+static bool ui_edit_advance_extends(uint32_t prev, uint32_t cp,
+        int32_t regional_indicators) {
+    return ui_edit_str.is_combining(cp) ||
+           ui_edit_str.is_zwj(cp) || ui_edit_str.is_zwj(prev) ||
+           (0xFE00  <= cp && cp <= 0xFE0F)  || // variation selectors
+           (0xE0100 <= cp && cp <= 0xE01EF) || // variation selectors supplement
+           (0x1F3FB <= cp && cp <= 0x1F3FF) || // emoji skin tone modifiers
+           (0xE0020 <= cp && cp <= 0xE007F) || // tags (subdivision flags)
+           (regional_indicators == 1 && // flags are pairs of indicators
+            ui_edit_advance_is_regional_indicator(prev) &&
+            ui_edit_advance_is_regional_indicator(cp));
+}
+
+static int32_t ui_edit_advance_cluster(const char* utf8, int32_t bytes) {
+    int32_t i = 0;
+    uint32_t prev = 0;
+    int32_t ri = 0; // number of regional indicators in the cluster
+    while (i < bytes) {
+        int32_t b = posix_str.utf8bytes(utf8 + i, bytes - i);
+        if (b <= 0) { b = 1; } // invalid utf8 byte is a cluster on its own
+        const uint32_t cp = posix_str.utf32(utf8 + i, b);
+        if (i > 0 && !ui_edit_advance_extends(prev, cp, ri)) { break; }
+        if (ui_edit_advance_is_regional_indicator(cp)) { ri++; }
+        prev = cp;
+        i += b;
+    }
+    return i;
+}
+
+static int32_t ui_edit_advance_code_points(const char* utf8, int32_t bytes) {
+    int32_t n = 0;
+    for (int32_t i = 0; i < bytes; i++) {
+        if (((uint8_t)utf8[i] & 0xC0) != 0x80) { n++; }
+    }
+    return n;
+}
+
+static uint64_t ui_edit_advance_hash(const char* utf8, int32_t bytes) {
+    uint64_t h = 0xCBF29CE484222325uLL; // FNV-1a
+    for (int32_t i = 0; i < bytes; i++) {
+        h = (h ^ (uint8_t)utf8[i]) * 0x100000001B3uLL;
+    }
+    return h | 1; // never 0
+}
+
+static void ui_edit_advance_init(struct ui_edit_advance* a, const void* font,
+        int32_t (*measure)(void* that, const char* utf8, int32_t bytes),
+        void* that) {
+    memset(a, 0x00, sizeof(*a));
+    a->font = font;
+    a->measure = measure;
+    a->that = that;
+    for (int32_t i = 0; i < posix_countof(a->ascii); i++) { a->ascii[i] = -1; }
+}
+
+static bool ui_edit_advance_grow(struct ui_edit_advance* a) {
+    const int32_t c = a->capacity == 0 ?
+        ui_edit_advance_min_capacity : a->capacity * 2;
+    struct ui_edit_advance_entry* t = null;
+    bool ok = posix_heap.alloc_zero((void**)&t,
+                  (int64_t)c * (int64_t)sizeof(t[0])) == 0;
+    if (ok) {
+        for (int32_t i = 0; i < a->capacity; i++) {
+            const struct ui_edit_advance_entry* e = &a->table[i];
+            if (e->hash != 0) {
+                int32_t k = (int32_t)(e->hash & (uint64_t)(c - 1));
+                while (t[k].hash != 0) { k = (k + 1) & (c - 1); }
+                t[k] = *e;
+            }
+        }
+        if (a->table != null) { posix_heap.free(a->table); }
+        a->table = t;
+        a->capacity = c;
+    }
+    return ok;
+}
+
+static int32_t ui_edit_advance_glyph(struct ui_edit_advance* a,
+        const char* utf8, int32_t bytes) {
+    posix_assert(bytes > 0);
+    const uint8_t c = (uint8_t)utf8[0];
+    int32_t advance = 0;
+    if (bytes == 1 && c < 0x80) {
+        if (a->ascii[c] < 0) {
+            a->ascii[c] = a->measure(a->that, utf8, 1);
+            a->misses++;
+        } else {
+            a->hits++;
+        }
+        advance = a->ascii[c];
+    } else if (bytes > ui_edit_advance_max_key) {
+        advance = a->measure(a->that, utf8, bytes);
+        a->misses++;
+    } else {
+        const uint64_t h = ui_edit_advance_hash(utf8, bytes);
+        int32_t k = -1; // index of found or empty entry
+        if (a->capacity > 0) {
+            k = (int32_t)(h & (uint64_t)(a->capacity - 1));
+            while (a->table[k].hash != 0 && !(a->table[k].hash == h &&
+                   a->table[k].bytes == bytes &&
+                   memcmp(a->table[k].utf8, utf8, (size_t)bytes) == 0)) {
+                k = (k + 1) & (a->capacity - 1);
+            }
+        }
+        if (k >= 0 && a->table[k].hash != 0) {
+            advance = a->table[k].advance;
+            a->hits++;
+        } else {
+            advance = a->measure(a->that, utf8, bytes);
+            a->misses++;
+            // keep load factor below 3/4:
+            bool ok = (a->count + 1) * 4 < a->capacity * 3 ||
+                      ui_edit_advance_grow(a);
+            if (ok) {
+                k = (int32_t)(h & (uint64_t)(a->capacity - 1));
+                while (a->table[k].hash != 0) { k = (k + 1) & (a->capacity - 1); }
+                struct ui_edit_advance_entry* e = &a->table[k];
+                e->hash = h;
+                e->advance = advance;
+                e->bytes = bytes;
+                memcpy(e->utf8, utf8, (size_t)bytes);
+                a->count++;
+            }
+        }
+    }
+    return advance;
+}
+
+static int32_t ui_edit_advance_fit(struct ui_edit_advance* a,
+        const char* utf8, int32_t bytes, int32_t width, int32_t* pixels) {
+    int32_t i = 0; // bytes
+    int32_t g = 0; // glyphs
+    int64_t x = 0; // pixels
+    while (i < bytes) {
+        const uint8_t c = (uint8_t)utf8[i];
+        int32_t b = 1; // bytes in cluster
+        int32_t n = 1; // code points in cluster
+        // fast path: ASCII followed by ASCII is a cluster on its own
+        if (c >= 0x80 || (i + 1 < bytes && (uint8_t)utf8[i + 1] >= 0x80)) {
+            b = ui_edit_advance_cluster(utf8 + i, bytes - i);
+            n = ui_edit_advance_code_points(utf8 + i, b);
+        }
+        const int32_t advance = ui_edit_advance_glyph(a, utf8 + i, b);
+        if (x + advance >= width) { break; }
+        x += advance;
+        i += b;
+        g += n;
+    }
+    if (pixels != null) { *pixels = (int32_t)x; }
+    return g;
+}
+
+static int32_t ui_edit_advance_width(struct ui_edit_advance* a,
+        const char* utf8, int32_t bytes) {
+    int32_t pixels = 0;
+    (void)ui_edit_advance_fit(a, utf8, bytes, INT32_MAX, &pixels);
+    return pixels;
+}
+
+static void ui_edit_advance_dispose(struct ui_edit_advance* a) {
+    if (a->table != null) { posix_heap.free(a->table); }
+    memset(a, 0x00, sizeof(*a));
+}
+
+// ____________________________________ test __________________________________
+
+struct ui_edit_advance_test_stub {
+    int64_t calls;
+    int64_t bytes;
+};
+
+static int32_t ui_edit_advance_test_measure(void* that, const char* utf8,
+        int32_t bytes) {
+    // stub metrics provider: narrow "il", wide "mw", CJK/emoji 16
+    struct ui_edit_advance_test_stub* stub = (struct ui_edit_advance_test_stub*)that;
+    stub->calls++;
+    stub->bytes += bytes;
+    int32_t w = 0;
+    int32_t i = 0;
+    while (i < bytes) {
+        const int32_t b = ui_edit_advance_cluster(utf8 + i, bytes - i);
+        const char c = utf8[i];
+        w += (uint8_t)c >= 0x80 ? 16 :
+             c == 'i' || c == 'l' ? 4 : c == 'm' || c == 'w' ? 12 : 8;
+        i += b;
+    }
+    return w;
+}
+
+static void ui_edit_advance_test_clusters(void) {
+    static const struct { const char* s; int32_t bytes; int32_t glyphs; } t[] = {
+        { "ab", 1, 1 },
+        { "e\xCC\x81x", 3, 2 },                      // e + combining acute
+        { "\xF0\x9F\x91\x8D\xF0\x9F\x8F\xBD!", 8, 2 }, // thumbs up + skin tone
+        { "\xF0\x9F\x87\xBA\xF0\x9F\x87\xB8"          // flag: US
+          "\xF0\x9F\x87\xAC\xF0\x9F\x87\xA7", 8, 2 },  // flag: GB
+        { "\xF0\x9F\x91\xA8\xE2\x80\x8D\xF0\x9F\x91\xA9" // family: man ZWJ
+          "\xE2\x80\x8D\xF0\x9F\x91\xA7 ", 18, 5 },      // woman ZWJ girl
+        { "\xE2\x9D\xA4\xEF\xB8\x8F.", 6, 2 },          // heart + VS16
+    };
+    for (int32_t i = 0; i < posix_countof(t); i++) {
+        const int32_t n = (int32_t)strlen(t[i].s);
+        const int32_t b = ui_edit_advance_cluster(t[i].s, n);
+        posix_swear(b == t[i].bytes, "[%d] %d != %d", i, b, t[i].bytes);
+        const int32_t g = ui_edit_advance_code_points(t[i].s, b);
+        posix_swear(g == t[i].glyphs, "[%d] %d != %d", i, g, t[i].glyphs);
+    }
+}
+
+static void ui_edit_advance_test_fit(void) {
+    struct ui_edit_advance_test_stub stub = {0};
+    struct ui_edit_advance a = {0};
+    ui_edit_advance.init(&a, &stub, ui_edit_advance_test_measure, &stub);
+    const char* s = "hello world";
+    const int32_t n = (int32_t)strlen(s);
+    const int32_t w = ui_edit_advance.width(&a, s, n);
+    posix_swear(w == ui_edit_advance_test_measure(&stub, s, n));
+    const int64_t calls = stub.calls;
+    posix_swear(ui_edit_advance.width(&a, s, n) == w);
+    posix_swear(stub.calls == calls); // all glyphs are cached
+    const int32_t hello = ui_edit_advance.width(&a, s, 5);
+    int32_t px = 0;
+    posix_swear(ui_edit_advance.fit(&a, s, n, hello + 1, &px) == 5 && px == hello);
+    posix_swear(ui_edit_advance.fit(&a, s, n, hello, &px) == 4);   // strict
+    posix_swear(ui_edit_advance.fit(&a, s, n, w + 1, null) == 11); // all
+    posix_swear(ui_edit_advance.fit(&a, s, n, 0, &px) == 0 && px == 0);
+    // cluster is never split:
+    const char* e = "e\xCC\x81" "e\xCC\x81";
+    posix_swear(ui_edit_advance.width(&a, e, 6) == 16);
+    posix_swear(ui_edit_advance.fit(&a, e, 6, 9, null) == 2);
+    posix_swear(ui_edit_advance.fit(&a, e, 6, 8, null) == 0);
+    // many distinct clusters grow hash table and measured only once:
+    char u[4];
+    stub.calls = 0;
+    for (int32_t pass = 0; pass < 2; pass++) {
+        for (uint32_t cp = 0x0100; cp < 0x0800; cp++) {
+            u[0] = (char)(0xC0 | (cp >> 6));
+            u[1] = (char)(0x80 | (cp & 0x3F));
+            posix_swear(ui_edit_advance.glyph(&a, u, 2) == 16);
+        }
+    }
+    posix_swear(stub.calls == 0x0800 - 0x0100);
+    posix_swear(a.count >= 0x0800 - 0x0100 && a.count * 4 < a.capacity * 3);
+    // fit() and width() agree on random strings:
+    static const char* pieces[] = {
+        "a", "i", "m", " ", "\xC2\xA3", "e\xCC\x81", "\xE2\x82\xAC",
+        "\xF0\x9F\x91\x8D\xF0\x9F\x8F\xBD", "\xE4\xB8\xAD"
+    };
+    uint32_t seed = 0x1;
+    char text[256];
+    for (int32_t iteration = 0; iteration < 1000; iteration++) {
+        int32_t k = 0;
+        for (;;) {
+            const char* p = pieces[posix_num.random32(&seed) % posix_countof(pieces)];
+            const int32_t b = (int32_t)strlen(p);
+            if (k + b > (int32_t)sizeof(text)) { break; }
+            memcpy(text + k, p, (size_t)b);
+            k += b;
+        }
+        const int32_t width = 1 + (int32_t)(posix_num.random32(&seed) % 600);
+        const int32_t g = ui_edit_advance.fit(&a, text, k, width, &px);
+        int32_t b = 0; // bytes in first `g` code points
+        for (int32_t i = 0; i < g; i++) {
+            b += posix_str.utf8bytes(text + b, k - b);
+        }
+        posix_swear(ui_edit_advance.width(&a, text, b) == px && px < width);
+        if (b < k) {
+            const int32_t c = ui_edit_advance_cluster(text + b, k - b);
+            posix_swear(px + ui_edit_advance.glyph(&a, text + b, c) >= width);
+        }
+    }
+    ui_edit_advance.dispose(&a);
+}
+
+static int32_t ui_edit_advance_test_break(struct ui_edit_advance_test_stub* stub,
+        const struct ui_edit_str* s, int32_t gp, int32_t width) {
+    // previous word break: exponential and binary search over
+    // measurements of the whole prefix (4 measurements on average)
+    const int32_t glyphs = s->g - gp;
+    const int32_t* g2b = &s->g2b[gp];
+    const int32_t bp = g2b[0];
+    const char* text = s->u + bp;
+    int32_t gc = 4 < glyphs ? 4 : glyphs;
+    int32_t w = ui_edit_advance_test_measure(stub, text, g2b[gc] - bp);
+    while (gc < glyphs && w < width) {
+        gc = gc * 4 < glyphs ? gc * 4 : glyphs;
+        w = ui_edit_advance_test_measure(stub, text, g2b[gc] - bp);
+    }
+    int32_t k = gc;
+    if (w >= width) {
+        int32_t i = 0;
+        int32_t j = gc;
+        k = (i + j) / 2;
+        while (i < j) {
+            const int32_t px = ui_edit_advance_test_measure(stub, text, g2b[k + 1] - bp);
+            if (px == width) { break; }
+            if (px < width) { i = k + 1; } else { j = k; }
+            if ((i + j) / 2 == 0) { break; }
+            k = (i + j) / 2;
+        }
+    }
+    return k < 1 ? 1 : k;
+}
+
+static void ui_edit_advance_test_benchmark(void) {
+    // word wrap of 250,000 lines into runs of 600 pixels
+    enum { n = 250 * 1000, width = 600 };
+    static const char* words[] = {
+        "lorem", "ipsum", "dolor", "sit", "amet", "consectetur",
+        "adipiscing", "elit", "sed", "do", "eiusmod", "tempor",
+        "incididunt", "ut", "labore", "et", "dolore", "magna", "aliqua",
+        "\xC2\xA3", "\xE2\x82\xAC", "\xF0\x9F\x91\x8D\xF0\x9F\x8F\xBD"
+    };
+    char* text = null;
+    const int64_t bytes = (int64_t)n * 160;
+    posix_swear(posix_heap.alloc((void**)&text, bytes + 1) == 0);
+    uint32_t seed = 0x1;
+    int64_t k = 0;
+    for (int32_t i = 0; i < n; i++) {
+        // lines of 10..150 bytes
+        const int32_t length = 10 + (int32_t)(posix_num.random32(&seed) % 140);
+        int32_t b = 0;
+        while (b < length) {
+            const char* w = words[posix_num.random32(&seed) % posix_countof(words)];
+            const int32_t wb = (int32_t)strlen(w);
+            memcpy(text + k, w, (size_t)wb);
+            k += wb;
+            text[k++] = ' ';
+            b += wb + 1;
+        }
+        text[k - 1] = '\n';
+    }
+    struct ui_edit_doc doc = {0};
+    posix_swear(ui_edit_doc.init(&doc, text, (int32_t)k - 1, false));
+    const struct ui_edit_text* t = &doc.text;
+    for (int32_t pass = 0; pass < 2; pass++) {
+        struct ui_edit_advance_test_stub stub = {0};
+        struct ui_edit_advance a = {0};
+        ui_edit_advance.init(&a, &stub, ui_edit_advance_test_measure, &stub);
+        int64_t runs = 0;
+        fp64_t time = posix_clock.seconds();
+        for (int32_t pn = 0; pn < t->np; pn++) {
+            const struct ui_edit_str* s = &t->ps[pn];
+            int32_t gp = 0;
+            while (gp < s->g) {
+                const int32_t bp = s->g2b[gp];
+                int32_t glyphs = 0;
+                if (pass == 0) {
+                    glyphs = ui_edit_advance_test_break(&stub, s, gp, width);
+                } else {
+                    glyphs = ui_edit_advance.fit(&a, s->u + bp,
+                        s->b - bp, width, null);
+                    if (glyphs == 0) { glyphs = 1; }
+                }
+                gp += glyphs;
+                runs++;
+            }
+        }
+        time = posix_clock.seconds() - time;
+        // ~250us per GDI measure() call
+        posix_println("%s: %d paragraphs %lld runs %.3f ms "
+            "measure() calls: %lld bytes: %lld (~%.1f seconds with GDI)",
+            pass == 0 ? "prefix measure" : "advance cache",
+            t->np, runs, time * 1000.0, stub.calls, stub.bytes,
+            (fp64_t)stub.calls * 250e-6);
+        ui_edit_advance.dispose(&a);
+    }
+    ui_edit_doc.dispose(&doc);
+    posix_heap.free(text);
+}
+
+static void ui_edit_advance_test(void) {
+    ui_edit_advance_test_clusters();
+    ui_edit_advance_test_fit();
+    #ifdef UI_EDIT_ADVANCE_TEST_BENCHMARK
+        ui_edit_advance_test_benchmark();
+    #else
+        (void)(void*)ui_edit_advance_test_benchmark; // unused
+    #endif
+}
+
+struct ui_edit_advance_if ui_edit_advance = {
+    .init    = ui_edit_advance_init,
+    .cluster = ui_edit_advance_cluster,
+    .glyph   = ui_edit_advance_glyph,
+    .width   = ui_edit_advance_width,
+    .fit     = ui_edit_advance_fit,
+    .dispose = ui_edit_advance_dispose,
+    .test    = ui_edit_advance_test
+};
+
+#ifdef UI_EDIT_ADVANCE_TEST
+    posix_static_init(ui_edit_advance) { ui_edit_advance.test(); }
+#endif
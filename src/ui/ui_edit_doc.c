@@ -1,11 +1,12 @@
 /* Copyright (c) Dmitry "Leo" Kuznetsov 2021-24 see LICENSE for details */
 #include "posix/posix.h"
-#include "ui/ui.h"
+#include "ui/ui_edit_doc.h"
 
 #undef UI_EDIT_STR_TEST
 #undef UI_EDIT_DOC_TEST
 #undef UI_STR_TEST_REPLACE_ALL_PERMUTATIONS
 #undef UI_EDIT_DOC_TEST_PARAGRAPHS
+#undef UI_EDIT_DOC_TEST_BENCHMARKS
 
 #if 0 // flip to 1 to run tests
 
@@ -15,6 +16,7 @@
 #if 0 // flip to 1 to run exhausting lengthy tests
 #define UI_STR_TEST_REPLACE_ALL_PERMUTATIONS
 #define UI_EDIT_DOC_TEST_PARAGRAPHS
+#define UI_EDIT_DOC_TEST_BENCHMARKS
 #endif
 
 #endif
@@ -162,8 +164,8 @@ static bool ui_edit_range_inside_text(const struct ui_edit_text* t,
         const union ui_edit_range r) {
     return ui_edit_range.is_valid(r) &&
             0 <= r.from.pn && r.from.pn <= r.to.pn && r.to.pn < t->np &&
-            0 <= r.from.gp && r.from.gp <= r.to.gp &&
-            r.to.gp <= t->ps[r.to.pn - 1].g;
+            r.from.gp <= t->ps[r.from.pn].g &&
+            r.to.gp <= t->ps[r.to.pn].g;
 }
 
 static union ui_edit_range ui_edit_range_intersect(const union ui_edit_range r1,
@@ -214,6 +216,13 @@ static bool ui_edit_doc_realloc_ps_no_init(struct ui_edit_str* *ps,
         *ps = null;
     } else {
         ok = posix_heap.realloc_zero((void**)ps, new_np * sizeof(struct ui_edit_str)) == 0;
+        // realloc_zero() zeroes from the usable size of the old block
+        // (not from old_np) on some heaps: shrink then grow would
+        // resurrect stale paragraphs
+        if (ok && new_np > old_np) {
+            memset(&(*ps)[old_np], 0x00,
+                   (size_t)(new_np - old_np) * sizeof(struct ui_edit_str));
+        }
     }
     return ok;
 }
@@ -478,6 +487,117 @@ static void ui_edit_doc_copy(const struct ui_edit_doc* d,
     *to++ = 0x00;
 }
 
+// ui_edit_doc.write() gathers short paragraphs into batch[] and writes
+// it when full. Paragraphs longer than half of the batch are written
+// straight from document memory. Peak memory is a single batch
+// independent of document size.
+
+enum { ui_edit_doc_write_batch = 64 * 1024 };
+
+struct ui_edit_doc_writer {
+    struct posix_stream_if* s;
+    char*   batch; // batch[ui_edit_doc_write_batch]
+    int32_t bytes; // used bytes in batch[]
+};
+
+static int ui_edit_doc_write_fully(struct posix_stream_if* s,
+        const char* data, int64_t bytes) {
+    int r = 0;
+    while (r == 0 && bytes > 0) {
+        int64_t transferred = 0;
+        r = s->write(s, data, bytes, &transferred);
+        if (r == 0 && transferred == 0) { r = posix_core.error.io_error; }
+        data  += transferred;
+        bytes -= transferred;
+    }
+    return r;
+}
+
+static int ui_edit_doc_writer_flush(struct ui_edit_doc_writer* w) {
+    int r = ui_edit_doc_write_fully(w->s, w->batch, w->bytes);
+    w->bytes = 0;
+    return r;
+}
+
+static int ui_edit_doc_writer_append(struct ui_edit_doc_writer* w,
+        const char* u, int32_t bytes) {
+    int r = 0;
+    if (bytes > ui_edit_doc_write_batch / 2) {
+        r = ui_edit_doc_writer_flush(w);
+        if (r == 0) { r = ui_edit_doc_write_fully(w->s, u, bytes); }
+    } else {
+        if (w->bytes + bytes > ui_edit_doc_write_batch) {
+            r = ui_edit_doc_writer_flush(w);
+        }
+        if (r == 0 && bytes > 0) {
+            memcpy(w->batch + w->bytes, u, (size_t)bytes);
+            w->bytes += bytes;
+        }
+    }
+    return r;
+}
+
+static int ui_edit_doc_write(const struct ui_edit_doc* d,
+        const union ui_edit_range* range, struct posix_stream_if* s) {
+    const union ui_edit_range r = ui_edit_text.ordered(&d->text, range);
+    ui_edit_check_range_inside_text(&d->text, &r);
+    struct ui_edit_doc_writer w = { .s = s, .batch = null, .bytes = 0 };
+    int e = posix_heap.alloc((void**)&w.batch, ui_edit_doc_write_batch);
+    for (int32_t pn = r.from.pn; e == 0 && pn <= r.to.pn; pn++) {
+        const struct ui_edit_str* p = &d->text.ps[pn];
+        const int32_t from = pn == r.from.pn ? p->g2b[r.from.gp] : 0;
+        const int32_t to   = pn == r.to.pn   ? p->g2b[r.to.gp]   : p->b;
+        e = ui_edit_doc_writer_append(&w, p->u + from, to - from);
+        if (e == 0 && pn < r.to.pn) {
+            e = ui_edit_doc_writer_append(&w, "\n", 1);
+        }
+    }
+    if (w.batch != null) {
+        if (e == 0) { e = ui_edit_doc_writer_flush(&w); }
+        posix_heap.free(w.batch);
+    }
+    return e;
+}
+
+struct ui_edit_doc_file_stream {
+    struct posix_stream_if stream; // must be first
+    struct posix_file* file;
+};
+
+static int ui_edit_doc_file_write(struct posix_stream_if* s,
+        const void* data, int64_t bytes, int64_t *transferred) {
+    struct ui_edit_doc_file_stream* fs = (struct ui_edit_doc_file_stream*)s;
+    return posix_files.write(fs->file, data, bytes, transferred);
+}
+
+static int ui_edit_doc_save(const struct ui_edit_doc* d, const char* filename) {
+    char tmp[posix_files_max_path];
+    struct ui_edit_doc_file_stream fs = {
+        .stream = { .write = ui_edit_doc_file_write },
+        .file = posix_files.invalid
+    };
+    const int32_t flags = posix_files.o_wr | posix_files.o_create |
+                          posix_files.o_trunc;
+    // format() truncates silently: truncated "%s.tmp" may name other file
+    int r = (int64_t)strlen(filename) + 5 <= posix_countof(tmp) ?
+        0 : posix_core.error.name_too_long;
+    if (r == 0) {
+        posix_str.format(tmp, posix_countof(tmp), "%s.tmp", filename);
+        r = posix_files.open(&fs.file, tmp, flags);
+        if (r == 0) {
+            r = ui_edit_doc_write(d, null, &fs.stream);
+            if (r == 0) { r = posix_files.flush(fs.file); }
+            // close() may report deferred write errors
+            const int c = posix_files.close(fs.file);
+            if (r == 0) { r = c; }
+            // tmp is in the same folder as `filename` thus move() is rename
+            if (r == 0) { r = posix_files.move(tmp, filename); }
+            if (r != 0) { posix_files.unlink(tmp); }
+        }
+    }
+    return r;
+}
+
 static bool ui_edit_text_insert_2_or_more(struct ui_edit_text* t, int32_t pn,
         const struct ui_edit_str* s, const struct ui_edit_text* insert,
         const struct ui_edit_str* e) {
@@ -607,15 +727,14 @@ static bool ui_edit_text_insert_remove(struct ui_edit_text* t,
     const int32_t o = e->g2b[r.to.gp];
     const int32_t b = e->b - o;
     const char* u = b == 0 ? null : e->u + o;
-    ok = ui_edit_substr_append(&merge, s, r.from.gp, &i->ps[i->np - 1]) &&
+    // merge = s[0:from.gp] + e[to.gp:] replaces paragraphs [from.pn..to.pn]
+    ok = ui_edit_substr_append(&merge, s, r.from.gp, ui_edit_str.empty) &&
          ui_edit_str.replace(&merge, merge.g, merge.g, u, b);
     if (ok) {
+        ok = ui_edit_text_remove_lines(t, &merge, r.from.pn, r.to.pn);
         const bool empty_text = i->np == 1 && i->ps[0].g == 0;
-        if (!empty_text) {
-            ok = ui_edit_text_insert(t, r.to, i);
-        }
-        if (ok) {
-            ok = ui_edit_text_remove_lines(t, &merge, r.from.pn, r.to.pn);
+        if (ok && !empty_text) {
+            ok = ui_edit_text_insert(t, r.from, i);
         }
     }
     if (merge.c > 0 || merge.g > 0) { ui_edit_str.free(&merge); }
@@ -711,7 +830,7 @@ static bool ui_edit_text_replace(struct ui_edit_text* t,
                     r.from.gp, r.to.gp, i->ps[0].u, i->ps[0].b);
         } else {
             x.to.pn = r.from.pn + i->np - 1;
-            x.to.gp = i->np == 1 ? r.from.gp + i->ps[0].g : i->ps[0].g;
+            x.to.gp = i->np == 1 ? r.from.gp + i->ps[0].g : i->ps[i->np - 1].g;
             ok = ui_edit_text_insert_remove(t, r, i);
         }
     }
@@ -763,15 +882,10 @@ static bool ui_edit_text_equal(const struct ui_edit_text* t1,
 }
 
 static void ui_edit_doc_before_replace_text(struct ui_edit_doc* d,
-        const union ui_edit_range r, const struct ui_edit_text* t) {
+        const union ui_edit_range r,
+        const union ui_edit_range x,
+        const struct ui_edit_text* t) {
     ui_edit_check_range_inside_text(&d->text, &r);
-    union ui_edit_range x = r;
-    x.to.pn = r.from.pn + t->np - 1;
-    if (r.from.pn == r.to.pn && t->np == 1) {
-        x.to.gp = r.from.gp + t->ps[0].g;
-    } else {
-        x.to.gp = t->ps[t->np - 1].g;
-    }
     const struct ui_edit_notify_info ni_before = {
         .ok = true, .d = d, .r = &r, .x = &x, .t = t,
         .pnf = r.from.pn, .pnt = r.to.pn,
@@ -789,36 +903,315 @@ static void ui_edit_doc_after_replace_text(struct ui_edit_doc* d,
         .ok = ok, .d = d, .r = &r, .x = &x, .t = t,
         .pnf = r.from.pn, .pnt = x.to.pn,
         .deleted = r.to.pn - r.from.pn,
-        .inserted = t->np - 1
+        .inserted = x.to.pn - x.from.pn
     };
     ui_edit_notify_after(d, &ni_after);
 }
 
+// Undo/redo journal keeps each action as a compact binary record
+// appended to a single growing array instead of heap allocated
+// ui_edit_to_do + ui_edit_text + ui_edit_str per keystroke:
+//
+//     varint  zigzag(range.from.pn - range.from.pn of previous record)
+//     varint  range.from.gp
+//     varint  range.to.pn - range.from.pn
+//     varint  range.to.gp
+//     varint  bytes
+//     utf8[bytes] paragraphs separated by "\n"
+//     uint32_t size of the whole record (to walk the stack backwards)
+//
+// Typing a single letter costs ~10 bytes of journal.
+
+struct ui_edit_journal_spill { // oldest records moved to temporary file
+    struct posix_file* file;
+    int64_t  offset;   // bytes in use in the file
+    int64_t* chunks;   // chunks[n] sizes of spilled chunks
+    int32_t  n;
+    int32_t  capacity; // of chunks[]
+    char     name[posix_files_max_path];
+};
+
+struct ui_edit_journal_record {
+    union ui_edit_range range;
+    const char* utf8;  // inside journal data (not zero terminated)
+    int32_t     bytes;
+    int32_t     delta; // range.from.pn - range.from.pn of previous record
+    int64_t     size;  // of the whole record in journal
+};
+
+enum {
+    ui_edit_journal_trailer = (int32_t)sizeof(uint32_t),
+    ui_edit_journal_header  = 5 * 10, // 5 x varint(uint64_t) maximum
+    ui_edit_journal_min_capacity = 4 * 1024
+};
+
+static uint8_t* ui_edit_journal_put(uint8_t* p, uint64_t v) {
+    while (v >= 0x80) { *p++ = (uint8_t)(v | 0x80); v >>= 7; }
+    *p++ = (uint8_t)v;
+    return p;
+}
+
+static const uint8_t* ui_edit_journal_get(const uint8_t* p, uint64_t *v) {
+    uint64_t r = 0;
+    int32_t  s = 0;
+    while (*p & 0x80) { r |= (uint64_t)(*p++ & 0x7F) << s; s += 7; }
+    r |= (uint64_t)*p++ << s;
+    *v = r;
+    return p;
+}
+
+static uint64_t ui_edit_journal_zigzag(int64_t v) {
+    return ((uint64_t)v << 1) ^ (uint64_t)(v >> 63);
+}
+
+static int64_t ui_edit_journal_unzigzag(uint64_t v) {
+    return (int64_t)(v >> 1) ^ -(int64_t)(v & 1);
+}
+
+static bool ui_edit_journal_reserve(struct ui_edit_journal* j, int64_t bytes) {
+    bool ok = true;
+    if (j->bytes + bytes > j->capacity) {
+        int64_t c = posix_max(j->capacity * 2, j->bytes + bytes);
+        c = posix_max(c, (int64_t)ui_edit_journal_min_capacity);
+        ok = posix_heap.realloc((void**)&j->data, c) == 0;
+        if (ok) { j->capacity = c; }
+    }
+    return ok;
+}
+
+static const uint8_t* ui_edit_journal_parse(const uint8_t* p,
+        int32_t pn, struct ui_edit_journal_record* rec) {
+    uint64_t v[5];
+    for (int32_t i = 0; i < posix_countof(v); i++) {
+        p = ui_edit_journal_get(p, &v[i]);
+    }
+    rec->delta = (int32_t)ui_edit_journal_unzigzag(v[0]);
+    rec->range.from.pn = pn;
+    rec->range.from.gp = (int32_t)v[1];
+    rec->range.to.pn   = pn + (int32_t)v[2];
+    rec->range.to.gp   = (int32_t)v[3];
+    rec->bytes = (int32_t)v[4];
+    rec->utf8  = (const char*)p;
+    return p + rec->bytes + ui_edit_journal_trailer;
+}
+
+static bool ui_edit_journal_push(struct ui_edit_journal* j,
+        const union ui_edit_range* x, const struct ui_edit_text* t,
+        const union ui_edit_range* r) {
+    // record: replace `x` with text of `t` in range `r`
+    posix_assert(ui_edit_range.compare(x->from, x->to) <= 0);
+    const int32_t b = ui_edit_text.bytes(t, r) + r->to.pn - r->from.pn;
+    // + 1 for 0x00 appended by ui_edit_text.copy() overwritten by trailer
+    const int64_t n = ui_edit_journal_header + b + 1 + ui_edit_journal_trailer;
+    bool ok = ui_edit_journal_reserve(j, n);
+    if (ok) {
+        uint8_t* s = j->data + j->bytes;
+        uint8_t* p = s;
+        p = ui_edit_journal_put(p, ui_edit_journal_zigzag(x->from.pn - j->pn));
+        p = ui_edit_journal_put(p, (uint64_t)x->from.gp);
+        p = ui_edit_journal_put(p, (uint64_t)(x->to.pn - x->from.pn));
+        p = ui_edit_journal_put(p, (uint64_t)x->to.gp);
+        p = ui_edit_journal_put(p, (uint64_t)b);
+        ui_edit_text.copy(t, r, (char*)p, b + 1);
+        p += b;
+        const uint32_t size = (uint32_t)(p - s) + ui_edit_journal_trailer;
+        memcpy(p, &size, sizeof(size));
+        j->bytes += size;
+        j->pn = x->from.pn;
+        j->count++;
+    }
+    return ok;
+}
+
+static void ui_edit_journal_clear(struct ui_edit_journal* j) {
+    j->bytes = 0;
+    j->count = 0;
+    j->pn    = 0;
+    if (j->spill != null) {
+        j->spill->n = 0;
+        j->spill->offset = 0;
+    }
+}
+
+static bool ui_edit_journal_spill_out(struct ui_edit_journal* j, int64_t bytes) {
+    struct ui_edit_journal_spill* s = j->spill;
+    bool ok = true;
+    if (s == null) {
+        ok = posix_heap.alloc_zero((void**)&s, sizeof(*s)) == 0;
+        if (ok) {
+            s->file = posix_files.invalid;
+            ok = posix_files.create_tmp(s->name, posix_countof(s->name)) == 0;
+            if (ok) {
+                ok = posix_files.open(&s->file, s->name, posix_files.o_rw) == 0;
+                if (!ok) { posix_files.unlink(s->name); }
+            }
+            if (ok) { j->spill = s; } else { posix_heap.free(s); s = null; }
+        }
+    }
+    if (ok && s->n == s->capacity) {
+        const int32_t c = s->capacity * 2 > 16 ? s->capacity * 2 : 16;
+        ok = posix_heap.realloc((void**)&s->chunks, c * sizeof(s->chunks[0])) == 0;
+        if (ok) { s->capacity = c; }
+    }
+    if (ok) {
+        int64_t position = s->offset;
+        int64_t written = 0;
+        ok = posix_files.seek(s->file, &position, posix_files.seek_set) == 0 &&
+             posix_files.write(s->file, j->data, bytes, &written) == 0 &&
+             written == bytes;
+        if (ok) {
+            s->chunks[s->n++] = bytes;
+            s->offset += bytes;
+        }
+    }
+    return ok;
+}
+
+static bool ui_edit_journal_spill_in(struct ui_edit_journal* j) {
+    posix_assert(j->bytes == 0);
+    struct ui_edit_journal_spill* s = j->spill;
+    bool ok = s != null && s->n > 0;
+    if (ok) {
+        const int64_t bytes = s->chunks[s->n - 1];
+        int64_t position = s->offset - bytes;
+        int64_t transferred = 0;
+        ok = ui_edit_journal_reserve(j, bytes) &&
+             posix_files.seek(s->file, &position, posix_files.seek_set) == 0 &&
+             posix_files.read(s->file, j->data, bytes, &transferred) == 0 &&
+             transferred == bytes;
+        if (ok) {
+            j->bytes = bytes;
+            s->offset -= bytes;
+            s->n--;
+        }
+    }
+    return ok;
+}
+
+static void ui_edit_journal_trim(struct ui_edit_journal* j, int64_t limit,
+        bool spill) {
+    // moves oldest records that occupy about half of the journal
+    // memory to the spill file or discards them
+    if (limit > 0 && j->bytes > limit) {
+        const uint8_t* p = j->data;
+        const uint8_t* e = j->data + j->bytes;
+        int64_t cut = 0;
+        int32_t n = 0;
+        while (cut < j->bytes / 2) {
+            struct ui_edit_journal_record rec = {0};
+            p = ui_edit_journal_parse(p, 0, &rec);
+            if (p >= e) { break; } // always keep the most recent record
+            cut = p - j->data;
+            n++;
+        }
+        if (cut > 0) {
+            if (!spill || !ui_edit_journal_spill_out(j, cut)) {
+                j->count -= n;
+            }
+            memmove(j->data, j->data + cut, (size_t)(j->bytes - cut));
+            j->bytes -= cut;
+        }
+    }
+}
+
+static bool ui_edit_journal_top(struct ui_edit_journal* j,
+        struct ui_edit_journal_record* rec) {
+    if (j->bytes == 0 && j->count > 0 && !ui_edit_journal_spill_in(j)) {
+        ui_edit_journal_clear(j); // spilled records are lost
+    }
+    bool ok = j->bytes > 0;
+    if (ok) {
+        uint32_t size = 0;
+        memcpy(&size, j->data + j->bytes - ui_edit_journal_trailer, sizeof(size));
+        posix_assert(0 < size && size <= j->bytes);
+        ui_edit_journal_parse(j->data + j->bytes - size, j->pn, rec);
+        rec->size = size;
+    }
+    return ok;
+}
+
+static void ui_edit_journal_pop(struct ui_edit_journal* j,
+        const struct ui_edit_journal_record* rec) {
+    posix_assert(j->count > 0 && rec->size <= j->bytes);
+    j->bytes -= rec->size;
+    j->pn -= rec->delta;
+    j->count--;
+    if (j->count == 0) { ui_edit_journal_clear(j); }
+}
+
+static bool ui_edit_journal_text(const struct ui_edit_journal_record* rec,
+        struct ui_edit_text* t) {
+    // unlike ui_edit_text.init() only "\n" separates paragraphs
+    // and trailing "\r" is preserved
+    const char* u = rec->utf8;
+    const int32_t b = rec->bytes;
+    int32_t np = 1;
+    for (int32_t i = 0; i < b; i++) { np += u[i] == '\n'; }
+    ui_edit_check_zeros(t, sizeof(*t));
+    bool ok = ui_edit_doc_realloc_ps(&t->ps, 0, np);
+    if (ok) {
+        t->np = np;
+        int32_t i = 0;
+        for (int32_t pn = 0; ok && pn < np; pn++) {
+            int32_t k = i;
+            while (k < b && u[k] != '\n') { k++; }
+            if (k > i) {
+                ui_edit_str.free(&t->ps[pn]);
+                ok = ui_edit_str.init(&t->ps[pn], u + i, k - i, false);
+            }
+            i = k + 1;
+        }
+        if (!ok) { ui_edit_text.dispose(t); }
+    }
+    return ok;
+}
+
+static void ui_edit_journal_dispose(struct ui_edit_journal* j) {
+    struct ui_edit_journal_spill* s = j->spill;
+    if (s != null) {
+        posix_files.close(s->file);
+        posix_files.unlink(s->name);
+        if (s->chunks != null) { posix_heap.free(s->chunks); }
+        posix_heap.free(s);
+    }
+    if (j->data != null) { posix_heap.free(j->data); }
+    memset(j, 0x00, sizeof(*j));
+}
+
+static union ui_edit_range ui_edit_doc_extent(const union ui_edit_range r,
+        const struct ui_edit_text* i) {
+    // range occupied by text `i` after it replaces range `r`
+    union ui_edit_range x = r;
+    x.to.pn = r.from.pn + i->np - 1;
+    x.to.gp = i->np == 1 ? r.from.gp + i->ps[0].g : i->ps[i->np - 1].g;
+    return x;
+}
+
 static bool ui_edit_doc_replace_text(struct ui_edit_doc* d,
-        const union ui_edit_range* range, const struct ui_edit_text* i,
-        struct ui_edit_to_do* undo) {
+        const union ui_edit_range* range, const struct ui_edit_text* i) {
     struct ui_edit_text* t = &d->text;
     const union ui_edit_range r = ui_edit_text.ordered(t, range);
-    ui_edit_doc_before_replace_text(d, r, i);
-    bool ok = ui_edit_text.replace(t, &r, i, undo);
-    ui_edit_doc_after_replace_text(d, ok, r, undo->range, i);
+    const union ui_edit_range x = ui_edit_doc_extent(r, i);
+    ui_edit_doc_before_replace_text(d, r, x, i);
+    bool ok = ui_edit_text.replace(t, &r, i, null);
+    ui_edit_doc_after_replace_text(d, ok, r, x, i);
     return ok;
 }
 
 static bool ui_edit_doc_replace_undoable(struct ui_edit_doc* d,
-        const union ui_edit_range* r, const struct ui_edit_text* t,
-        struct ui_edit_to_do* undo) {
-    bool ok = ui_edit_doc_replace_text(d, r, t, undo);
-    if (ok && undo != null) {
-        undo->next = d->undo;
-        d->undo = undo;
-        // redo stack is not valid after new replace, empty it:
-        while (d->redo != null) {
-            struct ui_edit_to_do* next = d->redo->next;
-            d->redo->next = null;
-            ui_edit_doc.dispose_to_do(d->redo);
-            posix_heap.free(d->redo);
-            d->redo = next;
+        const union ui_edit_range r, const struct ui_edit_text* i) {
+    const union ui_edit_range x = ui_edit_doc_extent(r, i);
+    bool ok = ui_edit_journal_push(&d->undo, &x, &d->text, &r);
+    if (ok) {
+        ok = ui_edit_doc_replace_text(d, &r, i);
+        if (ok) {
+            // redo stack is not valid after new replace, empty it:
+            ui_edit_journal_clear(&d->redo);
+            ui_edit_journal_trim(&d->undo, d->limit, d->spill);
+        } else {
+            struct ui_edit_journal_record rec = {0};
+            posix_swear(ui_edit_journal_top(&d->undo, &rec));
+            ui_edit_journal_pop(&d->undo, &rec);
         }
     }
     return ok;
@@ -830,122 +1223,299 @@ static bool ui_edit_utf8_to_heap_text(const char* u, int32_t b,
     return ui_edit_text.init(it, b != 0 ? u : null, b, true);
 }
 
-
-static bool ui_edit_doc_coalesce_undo(struct ui_edit_doc* d, struct ui_edit_text* i) {
-    struct ui_edit_to_do* undo = d->undo;
-    struct ui_edit_to_do* next = undo->next;
-//  posix_println("i: %.*s", i->ps[0].b, i->ps[0].u);
-//  if (i->np == 1 && i->ps[0].g == 1) {
-//      posix_println("an: %d", ui_edit_str.is_letter(posix_str.utf32(i->ps[0].u, i->ps[0].b)));
-//  }
-    bool coalesced = false;
-    const bool alpha_numeric = i->np == 1 && i->ps[0].g == 1 &&
-        ui_edit_str.is_letter(posix_str.utf32(i->ps[0].u, i->ps[0].b));
-    if (alpha_numeric && next != null) {
-        const union ui_edit_range ur = undo->range;
-        const struct ui_edit_text* ut = &undo->text;
-        const union ui_edit_range nr = next->range;
-        const struct ui_edit_text* nt = &next->text;
-//      posix_println("next: \"%.*s\" %d:%d..%d:%d undo: \"%.*s\" %d:%d..%d:%d",
-//          nt->ps[0].b, nt->ps[0].u, nr.from.pn, nr.from.gp, nr.to.pn, nr.to.gp,
-//          ut->ps[0].b, ut->ps[0].u, ur.from.pn, ur.from.gp, ur.to.pn, ur.to.gp);
-        const bool c =
-            nr.from.pn == nr.to.pn && ur.from.pn == ur.to.pn &&
-            nr.from.pn == ur.from.pn &&
-            ut->np == 1 && ut->ps[0].g == 0 &&
-            nt->np == 1 && nt->ps[0].g == 0 &&
-            nr.to.gp == ur.from.gp && nr.to.gp > 0;
-        if (c) {
+static bool ui_edit_doc_coalesce_undo(struct ui_edit_doc* d,
+        const union ui_edit_range r, const struct ui_edit_text* i) {
+    // Inserting letter right after the letter inserted by the most
+    // recent undo record extends that record instead of adding new one:
+    struct ui_edit_journal_record rec = {0};
+    bool coalesce = ui_edit_range.is_empty(r) &&
+        i->np == 1 && i->ps[0].g == 1 &&
+        ui_edit_str.is_letter(posix_str.utf32(i->ps[0].u, i->ps[0].b)) &&
+        ui_edit_journal_top(&d->undo, &rec);
+    if (coalesce) {
+        const union ui_edit_range nr = rec.range;
+        coalesce = rec.bytes == 0 &&
+            nr.from.pn == nr.to.pn && nr.from.pn == r.from.pn &&
+            nr.to.gp == r.from.gp && nr.to.gp > 0;
+        if (coalesce) {
             const struct ui_edit_str* str = &d->text.ps[nr.from.pn];
             const int32_t* g2b = str->g2b;
             const char* utf8 = str->u + g2b[nr.to.gp - 1];
             uint32_t utf32 = posix_str.utf32(utf8, g2b[nr.to.gp] - g2b[nr.to.gp - 1]);
-            coalesced = ui_edit_str.is_letter(utf32);
+            // reserve room so re-pushing the record below cannot fail:
+            coalesce = ui_edit_str.is_letter(utf32) &&
+                ui_edit_journal_reserve(&d->undo, ui_edit_journal_header +
+                                        1 + ui_edit_journal_trailer);
         }
-        if (coalesced) {
-//          posix_println("coalesced");
-            next->range.to.gp++;
-            d->undo = next;
-            undo->next = null;
-            coalesced = true;
+    }
+    if (coalesce) {
+        coalesce = ui_edit_doc_replace_text(d, &r, i);
+        if (coalesce) {
+            // re-push previous record with range extended by one glyph
+            union ui_edit_range x = rec.range;
+            x.to.gp++;
+            const union ui_edit_range empty = { .from = r.from, .to = r.from };
+            ui_edit_journal_pop(&d->undo, &rec);
+            posix_swear(ui_edit_journal_push(&d->undo, &x, &d->text, &empty));
+            ui_edit_journal_clear(&d->redo);
         }
     }
-    return coalesced;
+    return coalesce;
 }
 
 static bool ui_edit_doc_replace(struct ui_edit_doc* d,
         const union ui_edit_range* range, const char* u, int32_t b) {
     struct ui_edit_text* t = &d->text;
     const union ui_edit_range r = ui_edit_text.ordered(t, range);
-    struct ui_edit_to_do* undo = null;
-    bool ok = posix_heap.alloc_zero((void**)&undo, sizeof(struct ui_edit_to_do)) == 0;
+    struct ui_edit_text i = {0};
+    bool ok = ui_edit_utf8_to_heap_text(u, b, &i);
     if (ok) {
-        struct ui_edit_text i = {0};
-        ok = ui_edit_utf8_to_heap_text(u, b, &i);
-        if (ok) {
-            ok = ui_edit_doc_replace_undoable(d, &r, &i, undo);
-            if (ok) {
-                if (ui_edit_doc_coalesce_undo(d, &i)) {
-                    ui_edit_doc.dispose_to_do(undo);
-                    posix_heap.free(undo);
-                    undo = null;
-                }
+        if (!ui_edit_doc_coalesce_undo(d, r, &i)) {
+            ok = ui_edit_doc_replace_undoable(d, r, &i);
+        }
+        ui_edit_text.dispose(&i);
+    }
+    return ok;
+}
+
+struct ui_edit_doc_batch_item {
+    union ui_edit_range r;
+    struct ui_edit_text i;
+    int32_t ix; // index in caller's arrays (makes sort stable)
+    int32_t moved; // ps[] index of untouched paragraphs in front of .r
+};
+
+struct ui_edit_doc_batch_line { // paragraph under construction
+    char*   u;
+    int32_t b;
+    int32_t c; // capacity of u[]
+};
+
+static bool ui_edit_doc_batch_append(struct ui_edit_doc_batch_line* l,
+        const struct ui_edit_str* p, int32_t from, int32_t to) {
+    // l += p[from..to) glyphs
+    const int32_t o = p->g2b[from];
+    const int32_t b = p->g2b[to] - o;
+    bool ok = true;
+    if (l->b + b > l->c) {
+        const int32_t c = posix_max(l->c * 2, posix_max(l->b + b, 256));
+        ok = posix_heap.realloc((void**)&l->u, c) == 0;
+        if (ok) { l->c = c; }
+    }
+    if (ok && b > 0) {
+        memcpy(l->u + l->b, p->u + o, (size_t)b);
+        l->b += b;
+    }
+    return ok;
+}
+
+static bool ui_edit_doc_batch_emit(struct ui_edit_doc_batch_line* l,
+        struct ui_edit_str* s) {
+    posix_assert(s->u == null && s->g2b == null); // zero initialized
+    const bool ok = ui_edit_str.init(s, l->b == 0 ? null : l->u, l->b, true);
+    l->b = 0;
+    return ok;
+}
+
+static bool ui_edit_doc_batch_splice(struct ui_edit_text* t,
+        struct ui_edit_doc_batch_item* b, int32_t n, int32_t np) {
+    // Builds new ps[np] in a single pass over sorted ranges b[0..n-1]:
+    // paragraphs touched by ranges are concatenated from kept glyphs
+    // and replacement texts, all other paragraphs are moved as is.
+    // All or nothing: `t` is not modified on failure.
+    const int32_t first = b[0].r.from.pn;
+    const int32_t last  = b[n - 1].r.to.pn;
+    struct ui_edit_str* ps = null; // ps[np]
+    bool ok = posix_heap.alloc_zero((void**)&ps,
+                                    np * (int64_t)sizeof(ps[0])) == 0;
+    struct ui_edit_doc_batch_line l = {0};
+    int32_t k = first; // next ps[] paragraph
+    struct ui_edit_pg at = { .pn = first, .gp = 0 }; // kept glyphs of `t`
+    for (int32_t j = 0; ok && j < n; j++) {
+        const union ui_edit_range* r = &b[j].r;
+        const struct ui_edit_text* i = &b[j].i;
+        if (at.pn < r->from.pn) { // tail of `at` paragraph
+            const struct ui_edit_str* p = &t->ps[at.pn];
+            ok = ui_edit_doc_batch_append(&l, p, at.gp, p->g) &&
+                 ui_edit_doc_batch_emit(&l, &ps[k++]);
+            b[j].moved = k; // placeholders for paragraphs in between:
+            k += r->from.pn - at.pn - 1;
+            at = (struct ui_edit_pg){ .pn = r->from.pn, .gp = 0 };
+        } else {
+            b[j].moved = k;
+        }
+        ok = ok && ui_edit_doc_batch_append(&l, &t->ps[at.pn], at.gp,
+                                            r->from.gp) &&
+                   ui_edit_doc_batch_append(&l, &i->ps[0], 0, i->ps[0].g);
+        for (int32_t m = 1; ok && m < i->np; m++) {
+            ok = ui_edit_doc_batch_emit(&l, &ps[k++]) &&
+                 ui_edit_doc_batch_append(&l, &i->ps[m], 0, i->ps[m].g);
+        }
+        at = r->to;
+    }
+    if (ok) {
+        const struct ui_edit_str* p = &t->ps[at.pn];
+        ok = ui_edit_doc_batch_append(&l, p, at.gp, p->g) &&
+             ui_edit_doc_batch_emit(&l, &ps[k++]);
+    }
+    posix_assert(!ok || k - first + t->np - last - 1 == np - first);
+    if (ok) {
+        memcpy(ps, t->ps, (size_t)first * sizeof(ps[0]));
+        memcpy(ps + k, t->ps + last + 1,
+               (size_t)(t->np - last - 1) * sizeof(ps[0]));
+        int32_t freed = -1; // last freed paragraph of `t`
+        for (int32_t j = 0; j < n; j++) {
+            const union ui_edit_range* r = &b[j].r;
+            const int32_t from = j == 0 ? first : b[j - 1].r.to.pn + 1;
+            memcpy(ps + b[j].moved, t->ps + from,
+                   (size_t)posix_max(r->from.pn - from, 0) * sizeof(ps[0]));
+            for (int32_t pn = posix_max(r->from.pn, freed + 1);
+                         pn <= r->to.pn; pn++) {
+                ui_edit_str.free(&t->ps[pn]);
+                freed = pn;
             }
-            ui_edit_text.dispose(&i);
         }
-        if (!ok) {
-            ui_edit_doc.dispose_to_do(undo);
-            posix_heap.free(undo);
-            undo = null;
+        posix_heap.free(t->ps);
+        t->ps = ps;
+        t->np = np;
+    } else if (ps != null) {
+        for (int32_t pn = first; pn < k; pn++) {
+            if (ps[pn].g2b != null) { ui_edit_str.free(&ps[pn]); }
         }
+        posix_heap.free(ps);
     }
+    if (l.u != null) { posix_heap.free(l.u); }
     return ok;
 }
 
-static bool ui_edit_doc_do(struct ui_edit_doc* d, struct ui_edit_to_do* to_do,
-        struct ui_edit_to_do* *stack) {
-    const union ui_edit_range* r = &to_do->range;
-    struct ui_edit_to_do* redo = null;
-    bool ok = posix_heap.alloc_zero((void**)&redo, sizeof(struct ui_edit_to_do)) == 0;
+static int ui_edit_doc_batch_compare(const void* p1, const void* p2) {
+    const struct ui_edit_doc_batch_item* b1 = (const struct ui_edit_doc_batch_item*)p1;
+    const struct ui_edit_doc_batch_item* b2 = (const struct ui_edit_doc_batch_item*)p2;
+    const int c = ui_edit_range.compare(b1->r.from, b2->r.from);
+    return c != 0 ? c : (b1->ix > b2->ix) - (b1->ix < b2->ix);
+}
+
+static bool ui_edit_doc_replace_batch(struct ui_edit_doc* d,
+        const union ui_edit_range ranges[], const char* const utf8[],
+        const int32_t bytes[], int32_t n) {
+    // All edits are applied in a single pass over paragraphs as a
+    // single replacement of enclosing range
+    // [ranges[first].from..ranges[last].to] with single undo record
+    // and single before()/after() notification.
+    // ranges[] must not overlap. bytes[] may be null for zero
+    // terminated utf8[] strings. utf8[i] may be null for deletion.
+    bool valid = n >= 0;
+    for (int32_t k = 0; valid && k < n; k++) {
+        valid = utf8[k] != null || bytes == null || bytes[k] <= 0;
+    }
+    if (!valid || n == 0) { return valid; }
+    struct ui_edit_text* t = &d->text;
+    struct ui_edit_doc_batch_item* b = null; // b[n]
+    bool ok = posix_heap.alloc_zero((void**)&b,
+                            n * (int64_t)sizeof(b[0])) == 0;
+    int32_t k = 0; // number of initialized b[].i texts
+    bool sorted = true;
+    while (ok && k < n) {
+        b[k].r  = ui_edit_text.ordered(t, &ranges[k]);
+        b[k].ix = k;
+        ok = ui_edit_range.inside(t, b[k].r);
+        if (ok) {
+            const char* u = utf8[k];
+            const int32_t c = bytes == null || bytes[k] < 0 ?
+                (u == null ? 0 : (int32_t)strlen(u)) : bytes[k];
+            // validates utf8 before document is modified
+            // (no heap copy: utf8[] outlives this call)
+            ok = ui_edit_text.init(&b[k].i, c == 0 ? null : u, c, false);
+            if (ok) { k++; }
+        }
+        if (ok && k > 1) {
+            sorted = sorted && ui_edit_doc_batch_compare(&b[k - 2], &b[k - 1]) <= 0;
+        }
+    }
+    if (ok && !sorted) {
+        qsort(b, (size_t)n, sizeof(b[0]), ui_edit_doc_batch_compare);
+    }
+    for (int32_t j = 1; ok && j < n; j++) { // reject overlapping ranges
+        ok = ui_edit_range.compare(b[j - 1].r.to, b[j].r.from) <= 0;
+    }
     if (ok) {
-        ok = ui_edit_doc_replace_text(d, r, &to_do->text, redo);
+        // enclosing range `e` and its extent `x` after all replacements
+        union ui_edit_range e = { .from = b[0].r.from, .to = b[n - 1].r.to };
+        union ui_edit_range x = { .from = e.from, .to = e.from };
+        struct ui_edit_pg to = e.from; // end of previous range
+        for (int32_t j = 0; j < n; j++) {
+            const union ui_edit_range* r = &b[j].r;
+            union ui_edit_range f = { .from = r->from }; // final position
+            f.from.pn = x.to.pn + r->from.pn - to.pn;
+            if (r->from.pn == to.pn) { f.from.gp = x.to.gp + r->from.gp - to.gp; }
+            f.to = f.from;
+            x.to = ui_edit_doc_extent(f, &b[j].i).to;
+            to = r->to;
+        }
+        const int32_t tail = t->ps[e.to.pn].g - e.to.gp; // glyphs after `e`
+        int32_t np = t->np; // after all replacements
+        for (int32_t j = 0; j < n; j++) {
+            np += b[j].i.np - 1 - (b[j].r.to.pn - b[j].r.from.pn);
+        }
+        ok = ui_edit_journal_push(&d->undo, &x, t, &e);
         if (ok) {
-            ui_edit_doc.dispose_to_do(to_do);
-            posix_heap.free(to_do);
+            ui_edit_doc_before_replace_text(d, e, x, null);
+            ok = ui_edit_doc_batch_splice(t, b, n, np);
+            if (ok) {
+                posix_assert(x.to.gp == t->ps[x.to.pn].g - tail);
+                (void)tail; // unused in release
+                ui_edit_journal_clear(&d->redo);
+                ui_edit_journal_trim(&d->undo, d->limit, d->spill);
+            } else { // text is not modified
+                struct ui_edit_journal_record rec = {0};
+                posix_swear(ui_edit_journal_top(&d->undo, &rec));
+                ui_edit_journal_pop(&d->undo, &rec);
+                x = e;
+            }
+            ui_edit_doc_after_replace_text(d, ok, e, x, null);
         }
+    }
+    for (int32_t j = 0; j < n && b != null; j++) {
+        if (b[j].i.np > 0) { ui_edit_text.dispose(&b[j].i); }
+    }
+    if (b != null) { posix_heap.free(b); }
+    return ok;
+}
+
+static bool ui_edit_doc_do(struct ui_edit_doc* d,
+        struct ui_edit_journal* from, struct ui_edit_journal* to) {
+    struct ui_edit_journal_record rec = {0};
+    bool ok = ui_edit_journal_top(from, &rec);
+    if (ok) {
+        struct ui_edit_text i = {0};
+        ok = ui_edit_journal_text(&rec, &i);
         if (ok) {
-            redo->next = *stack;
-            *stack = redo;
-        } else {
-            if (redo != null) {
-                ui_edit_doc.dispose_to_do(redo);
-                posix_heap.free(redo);
+            const union ui_edit_range r = rec.range;
+            const union ui_edit_range x = ui_edit_doc_extent(r, &i);
+            ok = ui_edit_journal_push(to, &x, &d->text, &r);
+            if (ok) {
+                ok = ui_edit_doc_replace_text(d, &r, &i);
+                if (ok) {
+                    ui_edit_journal_pop(from, &rec);
+                    ui_edit_journal_trim(to, d->limit, d->spill);
+                } else {
+                    struct ui_edit_journal_record top = {0};
+                    posix_swear(ui_edit_journal_top(to, &top));
+                    ui_edit_journal_pop(to, &top);
+                }
             }
+            ui_edit_text.dispose(&i);
         }
     }
     return ok;
 }
 
 static bool ui_edit_doc_redo(struct ui_edit_doc* d) {
-    struct ui_edit_to_do* to_do = d->redo;
-    if (to_do == null) {
-        return false;
-    } else {
-        d->redo = d->redo->next;
-        to_do->next = null;
-        return ui_edit_doc_do(d, to_do, &d->undo);
-    }
+    return ui_edit_doc_do(d, &d->redo, &d->undo);
 }
 
 static bool ui_edit_doc_undo(struct ui_edit_doc* d) {
-    struct ui_edit_to_do* to_do = d->undo;
-    if (to_do == null) {
-        return false;
-    } else {
-        d->undo = d->undo->next;
-        to_do->next = null;
-        return ui_edit_doc_do(d, to_do, &d->redo);
-    }
+    return ui_edit_doc_do(d, &d->undo, &d->redo);
 }
 
 static bool ui_edit_doc_init(struct ui_edit_doc* d, const char* utf8,
@@ -959,6 +1529,8 @@ static bool ui_edit_doc_init(struct ui_edit_doc* d, const char* utf8,
         bytes = (int32_t)n;
     }
     posix_assert((utf8 == null) == (bytes == 0));
+    d->limit = 16 * 1024 * 1024;
+    d->spill = true;
     if (ok) {
         if (bytes == 0) { // empty string
             ok = posix_heap.alloc_zero((void**)&d->text.ps, sizeof(struct ui_edit_str)) == 0;
@@ -982,20 +1554,10 @@ static void ui_edit_doc_dispose(struct ui_edit_doc* d) {
         d->text.ps = null;
     }
     d->text.np  = 0;
-    while (d->undo != null) {
-        struct ui_edit_to_do* next = d->undo->next;
-        d->undo->next = null;
-        ui_edit_doc.dispose_to_do(d->undo);
-        posix_heap.free(d->undo);
-        d->undo = next;
-    }
-    while (d->redo != null) {
-        struct ui_edit_to_do* next = d->redo->next;
-        d->redo->next = null;
-        ui_edit_doc.dispose_to_do(d->redo);
-        posix_heap.free(d->redo);
-        d->redo = next;
-    }
+    ui_edit_journal_dispose(&d->undo);
+    ui_edit_journal_dispose(&d->redo);
+    d->limit = 0;
+    d->spill = false;
     posix_assert(d->listeners == null, "unsubscribe listeners?");
     while (d->listeners != null) {
         struct ui_edit_listener* next = d->listeners->next;
@@ -1387,7 +1949,17 @@ static bool ui_edit_str_replace(struct ui_edit_str* s,
             if (ok) {
                 if (!all_ascii) {
                     ui_edit_str_move_g2b_to_heap(s);
+                    // number of glyphs may grow while number of bytes
+                    // shrinks and vice versa (e.g. "ab" <-> "\xE2\x82\xAC")
+                    if (glyphs_to_insert > glyphs_to_remove) {
+                        const int32_t g = s->g + glyphs_to_insert -
+                                                 glyphs_to_remove;
+                        ok = posix_heap.realloc(&s->g2b,
+                                             (size_t)(g + 1) * _4_bytes) == 0;
+                    }
                 }
+            }
+            if (ok) {
                 // insert struct ui_edit_str "ins" at glyph position "f"
                 // reusing ins.u[0..ins.b-1] and ins.g2b[0..ins.g]
                 // moving memory using memmove() left to right:
@@ -1405,31 +1977,17 @@ static bool ui_edit_str_replace(struct ui_edit_str* s,
                     }
                     memmove(s->u + s->g2b[f], ins.u, (size_t)ins.b);
                 } else {
-                    if (all_ascii) {
-                        posix_assert(s->g2b == ui_edit_str_g2b_ascii);
-                    } else {
-                        posix_assert(s->g2b != ui_edit_str_g2b_ascii);
-                        const int32_t g = s->g + glyphs_to_insert -
-                                                 glyphs_to_remove;
-                        posix_assert(g > s->g);
-                        ok = posix_heap.realloc(&s->g2b,
-                                             (size_t)(g + 1) * _4_bytes) == 0;
-                    }
+                    posix_assert(all_ascii == (s->g2b == ui_edit_str_g2b_ascii));
                     // need to shift bytes staring with s.g2b[t] toward the end
-                    if (ok) {
-                        memmove(s->u + s->g2b[f] + bytes_to_insert,
-                                s->u + s->g2b[f] + bytes_to_remove,
-                                (size_t)(s->b - s->g2b[f] - bytes_to_remove));
-                        if (all_ascii) {
-                            posix_assert(s->g2b == ui_edit_str_g2b_ascii);
-                        } else {
-                            posix_assert(s->g2b != ui_edit_str_g2b_ascii);
-                            memmove(s->g2b + f + glyphs_to_insert,
-                                    s->g2b + f + glyphs_to_remove,
-                                    (size_t)(s->g - t + 1) * _4_bytes);
-                        }
-                        memmove(s->u + s->g2b[f], ins.u, (size_t)ins.b);
+                    memmove(s->u + s->g2b[f] + bytes_to_insert,
+                            s->u + s->g2b[f] + bytes_to_remove,
+                            (size_t)(s->b - s->g2b[f] - bytes_to_remove));
+                    if (!all_ascii) {
+                        memmove(s->g2b + f + glyphs_to_insert,
+                                s->g2b + f + glyphs_to_remove,
+                                (size_t)(s->g - t + 1) * _4_bytes);
                     }
+                    memmove(s->u + s->g2b[f], ins.u, (size_t)ins.b);
                 }
                 if (ok) {
                     if (!all_ascii) {
@@ -1981,6 +2539,21 @@ static struct {
 } ui_edit_doc_test_notify;
 
 
+static void ui_edit_doc_test_random_pg(struct ui_edit_doc* d, uint32_t *seed,
+        struct ui_edit_pg* pg) {
+    pg->pn = (int32_t)(posix_num.random32(seed) % (uint32_t)d->text.np);
+    const int32_t g = d->text.ps[pg->pn].g;
+    pg->gp = (int32_t)(posix_num.random32(seed) % (uint32_t)(g + 1));
+}
+
+static char* ui_edit_doc_test_utf8(struct ui_edit_doc* d) {
+    const int32_t bytes = ui_edit_doc.utf8bytes(d, null);
+    char* s = null;
+    posix_swear(posix_heap.alloc((void**)&s, bytes) == 0);
+    ui_edit_doc.copy(d, null, s, bytes);
+    return s;
+}
+
 static void ui_edit_doc_test_0(void) {
     struct ui_edit_doc edit_doc = {0};
     struct ui_edit_doc* d = &edit_doc;
@@ -2066,6 +2639,8 @@ static void ui_edit_doc_test_2(void) {
         struct ui_edit_doc edit_doc = {0};
         struct ui_edit_doc* d = &edit_doc;
         const char* ins[] = { "X\nY", "X\n", "\nY", "\n", "X\nY\nZ" };
+        const char* res[] = { "GoodbyeX\nYUniverse", "GoodbyeX\nUniverse",
+            "Goodbye\nYUniverse", "Goodbye\nUniverse", "GoodbyeX\nY\nZUniverse" };
         for (int32_t i = 0; i < posix_countof(ins); i++) {
             posix_swear(ui_edit_doc.init(d, null, 0, false));
             const char* s = "GoodbyeCruelUniverse";
@@ -2076,6 +2651,9 @@ static void ui_edit_doc_test_2(void) {
             ui_edit_text.init(&ins_text, ins[i], -1, false);
             struct ui_edit_to_do undo = {0};
             posix_swear(ui_edit_text.replace(&d->text, &r, &ins_text, &undo));
+            char* p = ui_edit_doc_test_utf8(d);
+            posix_swear(strcmp(p, res[i]) == 0, "\"%s\"", p);
+            posix_heap.free(p);
             struct ui_edit_to_do redo = {0};
             posix_swear(ui_edit_text.replace(&d->text, &undo.range, &undo.text, &redo));
             ui_edit_doc.dispose_to_do(&undo);
@@ -2175,6 +2753,304 @@ static void ui_edit_doc_test_4(void) {
     }
 }
 
+static void ui_edit_doc_test_journal(int64_t limit, bool spill) {
+    // random edits, undo all of them, redo all of them
+    static const char* texts[] = { "a", "b", " ", "\n", "ab\ncd", "\xC2\xA3\r\n", null };
+    struct ui_edit_doc edit_doc = {0};
+    struct ui_edit_doc* d = &edit_doc;
+    posix_swear(ui_edit_doc.init(d, null, 0, false));
+    d->limit = limit;
+    d->spill = spill;
+    uint32_t seed = 0x1;
+    enum { n = 2000 };
+    for (int32_t i = 0; i < n; i++) {
+        union ui_edit_range r = {0};
+        ui_edit_doc_test_random_pg(d, &seed, &r.from);
+        r.to = r.from;
+        const int32_t k = (int32_t)(posix_num.random32(&seed) % posix_countof(texts));
+        if (texts[k] == null) { // delete
+            ui_edit_doc_test_random_pg(d, &seed, &r.to);
+            posix_swear(ui_edit_doc.replace(d, &r, null, 0));
+        } else {
+            posix_swear(ui_edit_doc.replace(d, &r, texts[k], -1));
+        }
+    }
+    char* done = ui_edit_doc_test_utf8(d);
+    const bool complete = limit == 0 || spill;
+    posix_swear(limit == 0 || d->undo.bytes <= limit * 2);
+    posix_swear((d->undo.spill != null) == (limit > 0 && spill));
+    int32_t undone = 0;
+    while (ui_edit_doc.undo(d)) { undone++; }
+    posix_swear(d->undo.count == 0 && d->redo.count == undone);
+    posix_swear(!complete || ui_edit_doc.bytes(d, null) == 0);
+    while (ui_edit_doc.redo(d)) { undone--; }
+    posix_swear(undone == 0 && d->redo.count == 0);
+    char* redone = ui_edit_doc_test_utf8(d);
+    posix_swear(strcmp(done, redone) == 0);
+    posix_heap.free(redone);
+    // new edit after undo discards redo stack:
+    posix_swear(ui_edit_doc.undo(d) && d->redo.count == 1);
+    posix_swear(ui_edit_doc.replace(d, null, "x", -1));
+    posix_swear(d->redo.count == 0 && !ui_edit_doc.redo(d));
+    posix_heap.free(done);
+    ui_edit_doc.dispose(d);
+}
+
+static void ui_edit_doc_test_journal_benchmark(void) {
+    // typing 1M characters: words of letters, spaces and line breaks
+    enum { n = 1000 * 1000 };
+    struct ui_edit_doc edit_doc = {0};
+    struct ui_edit_doc* d = &edit_doc;
+    posix_swear(ui_edit_doc.init(d, null, 0, false));
+    d->limit = 0;
+    uint32_t seed = 0x1;
+    int32_t column = 0;
+    fp64_t time = posix_clock.seconds();
+    for (int32_t i = 0; i < n; i++) {
+        const uint32_t rnd = posix_num.random32(&seed);
+        char c[2] = { (char)('a' + rnd % 26), 0x00 };
+        if (rnd % 7 == 0) { c[0] = column > 60 ? '\n' : ' '; }
+        column = c[0] == '\n' ? 0 : column + 1;
+        union ui_edit_range r = ui_edit_text.end_range(&d->text);
+        r.from = r.to;
+        posix_swear(ui_edit_doc.replace(d, &r, c, 1));
+    }
+    time = posix_clock.seconds() - time;
+    posix_println("%d keystrokes: %.3f us per replace() "
+        "journal: %lld bytes %d records %.1f bytes/keystroke", n,
+        time * 1000000.0 / n, d->undo.bytes, d->undo.count,
+        (fp64_t)d->undo.bytes / n);
+    const int32_t count = d->undo.count;
+    time = posix_clock.seconds();
+    while (ui_edit_doc.undo(d)) { }
+    time = posix_clock.seconds() - time;
+    posix_println("undo: %.3f us", time * 1000000.0 / count);
+    time = posix_clock.seconds();
+    while (ui_edit_doc.redo(d)) { }
+    time = posix_clock.seconds() - time;
+    posix_println("redo: %.3f us", time * 1000000.0 / count);
+    ui_edit_doc.dispose(d);
+}
+
+static void ui_edit_doc_test_batch(void) {
+    struct ui_edit_doc edit_doc = {0};
+    struct ui_edit_doc* d = &edit_doc;
+    const char* s = "Hello World\nGoodbye Cruel World\nWorld";
+    posix_swear(ui_edit_doc.init(d, s, -1, false));
+    struct ui_edit_doc_test_notify before_and_after = {0};
+    before_and_after.notify.before = ui_edit_doc_test_before;
+    before_and_after.notify.after  = ui_edit_doc_test_after;
+    posix_swear(ui_edit_doc.subscribe(d, &before_and_after.notify));
+    // intentionally not sorted:
+    const union ui_edit_range ranges[] = {
+        { .from = {2,  0}, .to = {2,  5} }, // "World"
+        { .from = {0,  0}, .to = {0,  1} }, // "H"
+        { .from = {0,  6}, .to = {1,  7} }, // "World\nGoodbye"
+        { .from = {1, 14}, .to = {1, 14} }, // insertion
+        { .from = {1, 14}, .to = {1, 19} }, // "World"
+    };
+    const char* const texts[] = { "Universe", "J", "W\nG", "!", null };
+    posix_swear(ui_edit_doc.replace_batch(d, ranges, texts, null,
+                                          posix_countof(ranges)));
+    posix_swear(before_and_after.count_before == 1);
+    posix_swear(before_and_after.count_after  == 1);
+    const char* expected = "Jello W\nG Cruel !\nUniverse";
+    char* p = ui_edit_doc_test_utf8(d);
+    posix_swear(strcmp(p, expected) == 0, "\"%s\"", p);
+    posix_heap.free(p);
+    posix_swear(d->undo.count == 1);
+    posix_swear(ui_edit_doc.undo(d));
+    p = ui_edit_doc_test_utf8(d);
+    posix_swear(strcmp(p, s) == 0, "\"%s\"", p);
+    posix_heap.free(p);
+    posix_swear(ui_edit_doc.redo(d));
+    p = ui_edit_doc_test_utf8(d);
+    posix_swear(strcmp(p, expected) == 0, "\"%s\"", p);
+    posix_heap.free(p);
+    // overlapping ranges are rejected and document is not modified:
+    const union ui_edit_range overlap[] = {
+        { .from = {0, 0}, .to = {0, 3} },
+        { .from = {0, 2}, .to = {0, 4} },
+    };
+    const char* const two[] = { "a", "b" };
+    posix_swear(!ui_edit_doc.replace_batch(d, overlap, two, null, 2));
+    // null text of positive length and negative count are rejected:
+    const char* const none[] = { null };
+    const int32_t three[] = { 3 };
+    posix_swear(!ui_edit_doc.replace_batch(d, overlap, none, three, 1));
+    posix_swear(!ui_edit_doc.replace_batch(d, overlap, two, null, -1));
+    posix_swear(before_and_after.count_before == 3);
+    ui_edit_doc.unsubscribe(d, &before_and_after.notify);
+    ui_edit_doc.dispose(d);
+}
+
+static void ui_edit_doc_test_batch_random(void) {
+    // replace_batch() == replace() of each range from the end backwards
+    static const char* texts[] = { null, "", "x", "\n", "ab\ncd", "\n\n",
+        "\xC2\xA3\n\xE2\x82\xAC", "Universe" };
+    const char* s = "Hello World\nGoodbye Cruel World\n\nWorld\n"
+                    "\xC2\xA3 and \xE2\x82\xAC\nthe end";
+    uint32_t seed = 0x1;
+    for (int32_t pass = 0; pass < 1000; pass++) {
+        struct ui_edit_doc batch = {0};
+        struct ui_edit_doc plain = {0};
+        posix_swear(ui_edit_doc.init(&batch, s, -1, false));
+        posix_swear(ui_edit_doc.init(&plain, s, -1, false));
+        const struct ui_edit_text* t = &batch.text;
+        // non-overlapping ranges at random positions in document order:
+        union ui_edit_range ranges[8];
+        const char* utf8[posix_countof(ranges)];
+        int32_t n = 0;
+        struct ui_edit_pg pg = { .pn = 0, .gp = 0 };
+        while (n < posix_countof(ranges) && pg.pn < t->np) {
+            const uint32_t rnd = posix_num.random32(&seed);
+            const int32_t pn = pg.pn + (int32_t)(rnd % 2);
+            if (pn < t->np) {
+                const int32_t g = t->ps[pn].g;
+                union ui_edit_range* r = &ranges[n];
+                r->from.pn = pn;
+                r->from.gp = pn == pg.pn ? pg.gp + (int32_t)((rnd >> 8) %
+                    (uint32_t)(g - pg.gp + 1)) : (int32_t)((rnd >> 8) % (uint32_t)(g + 1));
+                r->to = r->from;
+                if (rnd % 3 == 0 && r->to.pn + 1 < t->np) { // multi paragraph
+                    r->to.pn++;
+                    r->to.gp = (int32_t)((rnd >> 16) %
+                               (uint32_t)(t->ps[r->to.pn].g + 1));
+                } else {
+                    r->to.gp += (int32_t)((rnd >> 16) %
+                                (uint32_t)(g - r->from.gp + 1));
+                }
+                utf8[n] = texts[(rnd >> 24) % posix_countof(texts)];
+                pg = r->to;
+                n++;
+            } else {
+                pg.pn = pn;
+            }
+        }
+        posix_swear(ui_edit_doc.replace_batch(&batch, ranges, utf8, null, n));
+        for (int32_t i = n - 1; i >= 0; i--) {
+            const int32_t bytes = utf8[i] == null ? 0 : (int32_t)strlen(utf8[i]);
+            posix_swear(ui_edit_doc.replace(&plain, &ranges[i], utf8[i], bytes));
+        }
+        char* b = ui_edit_doc_test_utf8(&batch);
+        char* p = ui_edit_doc_test_utf8(&plain);
+        posix_swear(strcmp(b, p) == 0, "\"%s\" != \"%s\"", b, p);
+        posix_heap.free(p);
+        posix_heap.free(b);
+        posix_swear(ui_edit_doc.undo(&batch));
+        b = ui_edit_doc_test_utf8(&batch);
+        posix_swear(strcmp(b, s) == 0, "\"%s\"", b);
+        posix_heap.free(b);
+        ui_edit_doc.dispose(&plain);
+        ui_edit_doc.dispose(&batch);
+    }
+}
+
+static void ui_edit_doc_test_write(void) {
+    // short paragraphs are batched, 100KB paragraph is written directly
+    enum { lines = 10 * 1000, long_line = 100 * 1024 };
+    const int64_t n = lines * 8 + long_line + 1;
+    char* text = null;
+    posix_swear(posix_heap.alloc((void**)&text, n + 1) == 0);
+    char* s = text;
+    for (int32_t i = 0; i < lines; i++) {
+        posix_str.format(s, 9, "%07d\n", i);
+        s += 8;
+    }
+    memset(s, 'x', long_line);
+    s += long_line;
+    *s++ = '\n'; // last paragraph is empty
+    *s = 0x00;
+    struct ui_edit_doc edit_doc = {0};
+    struct ui_edit_doc* d = &edit_doc;
+    posix_swear(ui_edit_doc.init(d, text, (int32_t)n, false));
+    char* expected = ui_edit_doc_test_utf8(d);
+    posix_swear(strcmp(expected, text) == 0);
+    const union ui_edit_range ranges[] = {
+        { .from = {0,     0}, .to = {lines + 1, 0} }, // whole document
+        { .from = {3,     2}, .to = {3,         5} }, // within paragraph
+        { .from = {lines - 1, 4}, .to = {lines, long_line - 7} },
+        { .from = {5,     5}, .to = {5,         5} }, // empty
+    };
+    char* utf8 = null;
+    posix_swear(posix_heap.alloc((void**)&utf8, n + 1) == 0);
+    for (int32_t i = 0; i < posix_countof(ranges); i++) {
+        const int32_t bytes = ui_edit_doc.utf8bytes(d, &ranges[i]);
+        ui_edit_doc.copy(d, &ranges[i], expected, bytes);
+        struct posix_stream_memory_if ms = {0};
+        posix_streams.write_only(&ms, utf8, n + 1);
+        posix_swear(ui_edit_doc.write(d, &ranges[i], &ms.stream) == 0);
+        posix_swear(ms.pos_write == bytes - 1);
+        posix_swear(memcmp(utf8, expected, (size_t)bytes - 1) == 0);
+    }
+    // stream overflow is reported:
+    struct posix_stream_memory_if ms = {0};
+    posix_streams.write_only(&ms, utf8, n / 2);
+    posix_swear(ui_edit_doc.write(d, null, &ms.stream) != 0);
+    posix_heap.free(utf8);
+    // save() atomically replaces existing file:
+    char fn[posix_files_max_path];
+    posix_swear(posix_files.create_tmp(fn, posix_countof(fn)) == 0);
+    posix_swear(ui_edit_doc.save(d, fn) == 0);
+    void* data = null;
+    int64_t bytes = 0;
+    posix_swear(posix_mem.map_ro(fn, &data, &bytes) == 0);
+    posix_swear(bytes == n && memcmp(data, text, (size_t)n) == 0);
+    posix_mem.unmap(data, bytes);
+    posix_swear(posix_files.unlink(fn) == 0);
+    // "%s.tmp" of too long filename is not truncated to some other file:
+    memset(fn, 'a', sizeof(fn) - 1);
+    fn[posix_countof(fn) - 1] = 0x00;
+    posix_swear(ui_edit_doc.save(d, fn) == posix_core.error.name_too_long);
+    posix_heap.free(expected);
+    ui_edit_doc.dispose(d);
+    posix_heap.free(text);
+}
+
+static void ui_edit_doc_test_batch_benchmark(void) {
+    // replace 100,000 occurrences of "World" in 100,000 lines
+    enum { n = 100 * 1000 };
+    const char* line = "Hello World of big text files\n";
+    const int32_t k = (int32_t)strlen(line);
+    char* text = null;
+    posix_swear(posix_heap.alloc((void**)&text, (int64_t)n * k + 1) == 0);
+    for (int32_t i = 0; i < n; i++) { memcpy(text + i * k, line, (size_t)k); }
+    text[n * k] = 0x00;
+    union ui_edit_range* ranges = null;
+    const char* * texts = null;
+    posix_swear(posix_heap.alloc((void**)&ranges, n * (int64_t)sizeof(ranges[0])) == 0);
+    posix_swear(posix_heap.alloc((void**)&texts,  n * (int64_t)sizeof(texts[0])) == 0);
+    for (int32_t i = 0; i < n; i++) {
+        ranges[i] = (union ui_edit_range){ .from = {i, 6}, .to = {i, 11} };
+        texts[i] = "Universe";
+    }
+    struct ui_edit_doc edit_doc = {0};
+    struct ui_edit_doc* d = &edit_doc;
+    posix_swear(ui_edit_doc.init(d, text, n * k, false));
+    fp64_t time = posix_clock.seconds();
+    for (int32_t i = 0; i < n; i++) {
+        posix_swear(ui_edit_doc.replace(d, &ranges[i], texts[i], -1));
+    }
+    time = posix_clock.seconds() - time;
+    posix_println("%d x replace(): %.3f ms undo records: %d",
+                  n, time * 1000.0, d->undo.count);
+    ui_edit_doc.dispose(d);
+    posix_swear(ui_edit_doc.init(d, text, n * k, false));
+    time = posix_clock.seconds();
+    posix_swear(ui_edit_doc.replace_batch(d, ranges, texts, null, n));
+    time = posix_clock.seconds() - time;
+    posix_println("replace_batch(%d): %.3f ms undo records: %d",
+                  n, time * 1000.0, d->undo.count);
+    time = posix_clock.seconds();
+    posix_swear(ui_edit_doc.undo(d));
+    time = posix_clock.seconds() - time;
+    posix_println("undo: %.3f ms", time * 1000.0);
+    ui_edit_doc.dispose(d);
+    posix_heap.free(texts);
+    posix_heap.free(ranges);
+    posix_heap.free(text);
+}
+
 static void ui_edit_doc_test(void) {
     {
         union ui_edit_range r = { .from = {0,0}, .to = {0,0} };
@@ -2196,6 +3072,19 @@ static void ui_edit_doc_test(void) {
         ui_edit_doc_test_3();
         ui_edit_doc_test_4();
     }
+    ui_edit_doc_test_journal(0, false);
+    ui_edit_doc_test_journal(256, false); // discard oldest records
+    ui_edit_doc_test_journal(256, true);  // spill to temporary file
+    ui_edit_doc_test_batch();
+    ui_edit_doc_test_batch_random();
+    ui_edit_doc_test_write();
+    #ifdef UI_EDIT_DOC_TEST_BENCHMARKS
+        ui_edit_doc_test_journal_benchmark();
+        ui_edit_doc_test_batch_benchmark();
+    #else
+        (void)(void*)ui_edit_doc_test_journal_benchmark; // unused
+        (void)(void*)ui_edit_doc_test_batch_benchmark;   // unused
+    #endif
 }
 
 static const union ui_edit_range ui_edit_invalid_range = {
@@ -2234,10 +3123,13 @@ struct ui_edit_text_if ui_edit_text = {
 struct ui_edit_doc_if ui_edit_doc = {
     .init               = ui_edit_doc_init,
     .replace            = ui_edit_doc_replace,
+    .replace_batch      = ui_edit_doc_replace_batch,
     .bytes              = ui_edit_doc_bytes,
     .copy_text          = ui_edit_doc_copy_text,
     .utf8bytes          = ui_edit_doc_utf8bytes,
     .copy               = ui_edit_doc_copy,
+    .write              = ui_edit_doc_write,
+    .save               = ui_edit_doc_save,
     .redo               = ui_edit_doc_redo,
     .undo               = ui_edit_doc_undo,
     .subscribe          = ui_edit_doc_subscribe,
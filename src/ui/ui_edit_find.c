@@ -0,0 +1,645 @@
+/* Copyright (c) Dmitry "Leo" Kuznetsov 2021-24 see LICENSE for details */
+#include "posix/posix.h"
+#include "ui/ui_edit_find.h"
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__SSE2__)
+#include <emmintrin.h>
+#define ui_edit_find_sse2
+#elif defined(_M_ARM64) || defined(__aarch64__)
+#include <arm_neon.h>
+#define ui_edit_find_neon
+#endif
+
+#undef UI_EDIT_FIND_TEST
+#undef UI_EDIT_FIND_TEST_BENCHMARK
+
+#if 0 // flip to 1 to run tests
+
+#define UI_EDIT_FIND_TEST
+
+#if 0 // flip to 1 to run lengthy benchmark
+#define UI_EDIT_FIND_TEST_BENCHMARK
+#endif
+
+#endif
+
+struct ui_edit_find_sig {
+    // bit 0 of bits[0] is set when signature is computed
+    uint64_t bits[4];
+};
+
+enum {
+    ui_edit_find_saturated = 1024 // longer paragraphs have all bits set
+};
+
+static inline uint8_t ui_edit_find_lower(uint8_t c) {
+    return (uint8_t)('A' <= c && c <= 'Z' ? c + 0x20 : c);
+}
+
+static inline bool ui_edit_find_is_letter(uint8_t c) {
+    return ('a' <= c && c <= 'z') || ('A' <= c && c <= 'Z');
+}
+
+static inline int32_t ui_edit_find_ctz(uint32_t x) {
+    #if defined(_MSC_VER)
+        unsigned long i = 0; _BitScanForward(&i, x); return (int32_t)i;
+    #else
+        return (int32_t)__builtin_ctz(x);
+    #endif
+}
+
+static bool ui_edit_find_equal(const uint8_t* s, const uint8_t* p, int32_t m,
+        bool ignore_case) {
+    if (!ignore_case) {
+        return memcmp(s, p, (size_t)m) == 0;
+    } else {
+        int32_t i = 0;
+        while (i < m && ui_edit_find_lower(s[i]) == ui_edit_find_lower(p[i])) { i++; }
+        return i == m;
+    }
+}
+
+static int32_t ui_edit_find_scalar(const uint8_t* s, int32_t n,
+        const uint8_t* p, int32_t m, bool ignore_case) {
+    if (!ignore_case) {
+        const uint8_t* e = s + n - m + 1; // last possible start + 1
+        const uint8_t* c = s;
+        while (c < e) {
+            c = (const uint8_t*)memchr(c, p[0], (size_t)(e - c));
+            if (c == null) { break; }
+            if (memcmp(c, p, (size_t)m) == 0) { return (int32_t)(c - s); }
+            c++;
+        }
+    } else {
+        const uint8_t f = ui_edit_find_lower(p[0]);
+        for (int32_t i = 0; i + m <= n; i++) {
+            if (ui_edit_find_lower(s[i]) == f &&
+                ui_edit_find_equal(s + i, p, m, true)) {
+                return i;
+            }
+        }
+    }
+    return -1;
+}
+
+// Vectorized search compares the first and the last byte of the
+// pattern against 16 consecutive candidate positions at once and
+// verifies candidates with ui_edit_find_equal(). ASCII letters are
+// folded to lower case by OR 0x20 (harmless only for letters, thus
+// the fold mask is 0x00 for other bytes).
+
+#if defined(ui_edit_find_sse2)
+
+static int32_t ui_edit_find_simd(const uint8_t* s, int32_t n,
+        const uint8_t* p, int32_t m, bool ignore_case) {
+    const uint8_t f = p[0];
+    const uint8_t l = p[m - 1];
+    const uint8_t fo = ignore_case && ui_edit_find_is_letter(f) ? 0x20 : 0x00;
+    const uint8_t lo = ignore_case && ui_edit_find_is_letter(l) ? 0x20 : 0x00;
+    const __m128i vf  = _mm_set1_epi8((char)(f | fo));
+    const __m128i vl  = _mm_set1_epi8((char)(l | lo));
+    const __m128i vfo = _mm_set1_epi8((char)fo);
+    const __m128i vlo = _mm_set1_epi8((char)lo);
+    int32_t i = 0;
+    while (i + m - 1 + 16 <= n) {
+        const __m128i a = _mm_loadu_si128((const __m128i*)(s + i));
+        const __m128i b = _mm_loadu_si128((const __m128i*)(s + i + m - 1));
+        const __m128i eq = _mm_and_si128(
+            _mm_cmpeq_epi8(_mm_or_si128(a, vfo), vf),
+            _mm_cmpeq_epi8(_mm_or_si128(b, vlo), vl));
+        uint32_t mask = (uint32_t)_mm_movemask_epi8(eq);
+        while (mask != 0) {
+            const int32_t k = ui_edit_find_ctz(mask);
+            if (ui_edit_find_equal(s + i + k, p, m, ignore_case)) { return i + k; }
+            mask &= mask - 1;
+        }
+        i += 16;
+    }
+    const int32_t r = ui_edit_find_scalar(s + i, n - i, p, m, ignore_case);
+    return r < 0 ? -1 : i + r;
+}
+
+#elif defined(ui_edit_find_neon)
+
+static int32_t ui_edit_find_simd(const uint8_t* s, int32_t n,
+        const uint8_t* p, int32_t m, bool ignore_case) {
+    const uint8_t f = p[0];
+    const uint8_t l = p[m - 1];
+    const uint8_t fo = ignore_case && ui_edit_find_is_letter(f) ? 0x20 : 0x00;
+    const uint8_t lo = ignore_case && ui_edit_find_is_letter(l) ? 0x20 : 0x00;
+    const uint8x16_t vf  = vdupq_n_u8((uint8_t)(f | fo));
+    const uint8x16_t vl  = vdupq_n_u8((uint8_t)(l | lo));
+    const uint8x16_t vfo = vdupq_n_u8(fo);
+    const uint8x16_t vlo = vdupq_n_u8(lo);
+    int32_t i = 0;
+    while (i + m - 1 + 16 <= n) {
+        const uint8x16_t a = vld1q_u8(s + i);
+        const uint8x16_t b = vld1q_u8(s + i + m - 1);
+        const uint8x16_t eq = vandq_u8(
+            vceqq_u8(vorrq_u8(a, vfo), vf),
+            vceqq_u8(vorrq_u8(b, vlo), vl));
+        if (vmaxvq_u8(eq) != 0) {
+            uint8_t lanes[16];
+            vst1q_u8(lanes, eq);
+            for (int32_t k = 0; k < 16; k++) {
+                if (lanes[k] != 0 &&
+                    ui_edit_find_equal(s + i + k, p, m, ignore_case)) {
+                    return i + k;
+                }
+            }
+        }
+        i += 16;
+    }
+    const int32_t r = ui_edit_find_scalar(s + i, n - i, p, m, ignore_case);
+    return r < 0 ? -1 : i + r;
+}
+
+#else
+
+static int32_t ui_edit_find_simd(const uint8_t* s, int32_t n,
+        const uint8_t* p, int32_t m, bool ignore_case) {
+    return ui_edit_find_scalar(s, n, p, m, ignore_case);
+}
+
+#endif
+
+static int32_t ui_edit_find_memmem(const char* s, int32_t n,
+        const char* p, int32_t m, bool ignore_case) {
+    if (m == 0) { return 0; }
+    if (m > n)  { return -1; }
+    return ui_edit_find_simd((const uint8_t*)s, n, (const uint8_t*)p, m,
+                             ignore_case);
+}
+
+static void ui_edit_find_trigrams(const uint8_t* u, int32_t b,
+        struct ui_edit_find_sig* sig) {
+    memset(sig, 0x00, sizeof(*sig));
+    if (b > ui_edit_find_saturated) {
+        memset(sig, 0xFF, sizeof(*sig));
+    } else if (b >= 3) {
+        uint32_t h = ((uint32_t)ui_edit_find_lower(u[0]) << 8) |
+                      (uint32_t)ui_edit_find_lower(u[1]);
+        for (int32_t i = 2; i < b; i++) {
+            h = ((h << 8) | ui_edit_find_lower(u[i])) & 0xFFFFFF;
+            uint32_t bit = (h * 0x9E3779B1u) >> 24; // [0..255]
+            bit = bit == 0 ? 1 : bit; // bit 0 is "computed" flag
+            sig->bits[bit >> 6] |= 1ULL << (bit & 63);
+        }
+    }
+    sig->bits[0] |= 1;
+}
+
+static bool ui_edit_find_candidate(struct ui_edit_find* f, int32_t pn,
+        const struct ui_edit_find_sig* q) {
+    bool candidate = true;
+    if (f->sig != null && q != null) {
+        struct ui_edit_find_sig* s = &f->sig[pn];
+        if ((s->bits[0] & 1) == 0) {
+            const struct ui_edit_str* str = &f->d->text.ps[pn];
+            ui_edit_find_trigrams((const uint8_t*)str->u, str->b, s);
+            f->missing--;
+        }
+        for (int32_t i = 0; candidate && i < posix_countof(s->bits); i++) {
+            candidate = (s->bits[i] & q->bits[i]) == q->bits[i];
+        }
+    }
+    return candidate;
+}
+
+static int32_t ui_edit_find_b2g(const struct ui_edit_str* s, int32_t bp) {
+    // glyph position of byte position `bp` (binary search in g2b[])
+    if (s->g == s->b) { return bp; } // ASCII
+    int32_t lo = 0;
+    int32_t hi = s->g;
+    while (lo < hi) {
+        const int32_t mid = (lo + hi) / 2;
+        if (s->g2b[mid] < bp) { lo = mid + 1; } else { hi = mid; }
+    }
+    posix_assert(s->g2b[lo] == bp);
+    return lo;
+}
+
+struct ui_edit_find_pattern {
+    const char* u;
+    int32_t     b;
+    int32_t     lines;   // number of "\n" in pattern
+    int32_t     first;   // bytes in the first line
+    int32_t     last;    // bytes in the last line
+    bool        ignore_case;
+    struct ui_edit_find_sig sig;
+    bool        indexed; // sig is usable to filter paragraphs
+};
+
+static void ui_edit_find_pattern_init(struct ui_edit_find_pattern* p,
+        const char* u, int32_t b, bool ignore_case) {
+    memset(p, 0x00, sizeof(*p));
+    p->u = u;
+    p->b = b < 0 ? (int32_t)strlen(u) : b;
+    p->ignore_case = ignore_case;
+    int32_t i = 0;
+    while (i < p->b && u[i] != '\n') { i++; }
+    p->first = i;
+    int32_t k = p->b;
+    while (k > 0 && u[k - 1] != '\n') { k--; }
+    p->last = p->b - k;
+    for (int32_t j = 0; j < p->b; j++) { p->lines += u[j] == '\n'; }
+    p->indexed = p->lines == 0 && p->b >= 3;
+    if (p->indexed) {
+        ui_edit_find_trigrams((const uint8_t*)u, p->b, &p->sig);
+        p->indexed = p->b <= ui_edit_find_saturated;
+    }
+}
+
+static bool ui_edit_find_multiline(struct ui_edit_find* f,
+        const struct ui_edit_find_pattern* p, int32_t pn) {
+    // pattern with "\n": suffix of ps[pn], whole middle paragraphs,
+    // prefix of ps[pn + lines]
+    const struct ui_edit_text* t = &f->d->text;
+    bool match = pn + p->lines < t->np;
+    const char* u = p->u;
+    for (int32_t i = 0; match && i <= p->lines; i++) {
+        const struct ui_edit_str* s = &t->ps[pn + i];
+        const char* e = u;
+        while (e < p->u + p->b && *e != '\n') { e++; }
+        const int32_t b = (int32_t)(e - u);
+        if (i == 0) {
+            match = s->b >= b && ui_edit_find_equal(
+                (const uint8_t*)s->u + s->b - b, (const uint8_t*)u, b,
+                p->ignore_case);
+        } else if (i == p->lines) {
+            match = s->b >= b && ui_edit_find_equal(
+                (const uint8_t*)s->u, (const uint8_t*)u, b, p->ignore_case);
+        } else {
+            match = s->b == b && ui_edit_find_equal(
+                (const uint8_t*)s->u, (const uint8_t*)u, b, p->ignore_case);
+        }
+        u = e + 1;
+    }
+    return match;
+}
+
+static int32_t ui_edit_find_scan(struct ui_edit_find* f,
+        const struct ui_edit_find_pattern* p, const struct ui_edit_pg from,
+        union ui_edit_range hits[], int32_t n, bool first) {
+    // returns number of hits at or after `from` (stops after the
+    // first hit when `first` is true)
+    const struct ui_edit_text* t = &f->d->text;
+    const struct ui_edit_find_sig* q = p->indexed ? &p->sig : null;
+    int32_t count = 0;
+    int32_t pn = from.pn;
+    // first byte of ps[pn] to search from (hits do not overlap)
+    int32_t bp = pn < t->np ? t->ps[pn].g2b[from.gp] : 0;
+    while (pn < t->np && !(first && count > 0)) {
+        const struct ui_edit_str* s = &t->ps[pn];
+        if (p->b == 0) {
+            break;
+        } else if (p->lines > 0) {
+            const bool after = s->b - p->first >= bp;
+            if (after && ui_edit_find_multiline(f, p, pn)) {
+                if (count < n) {
+                    union ui_edit_range* r = &hits[count];
+                    r->from.pn = pn;
+                    r->from.gp = ui_edit_find_b2g(s, s->b - p->first);
+                    r->to.pn = pn + p->lines;
+                    r->to.gp = ui_edit_find_b2g(&t->ps[r->to.pn], p->last);
+                }
+                count++;
+                pn += p->lines;
+                bp = p->last; // continue after the hit in its last paragraph
+            } else {
+                pn++;
+                bp = 0;
+            }
+        } else {
+            if (s->b - bp >= p->b && ui_edit_find_candidate(f, pn, q)) {
+                int32_t o = bp;
+                for (;;) {
+                    const int32_t k = ui_edit_find_memmem(s->u + o, s->b - o,
+                                                p->u, p->b, p->ignore_case);
+                    if (k < 0) { break; }
+                    if (count < n) {
+                        union ui_edit_range* r = &hits[count];
+                        r->from.pn = pn;
+                        r->from.gp = ui_edit_find_b2g(s, o + k);
+                        r->to.pn = pn;
+                        r->to.gp = ui_edit_find_b2g(s, o + k + p->b);
+                    }
+                    count++;
+                    if (first) { break; }
+                    o += k + p->b;
+                }
+            }
+            pn++;
+            bp = 0;
+        }
+    }
+    return count;
+}
+
+static int32_t ui_edit_find_all(struct ui_edit_find* f,
+        const char* utf8, int32_t bytes, bool ignore_case,
+        union ui_edit_range hits[], int32_t n) {
+    struct ui_edit_find_pattern p;
+    ui_edit_find_pattern_init(&p, utf8, bytes, ignore_case);
+    const struct ui_edit_pg from = { .pn = 0, .gp = 0 };
+    return ui_edit_find_scan(f, &p, from, hits, n, false);
+}
+
+static bool ui_edit_find_next(struct ui_edit_find* f,
+        const struct ui_edit_pg from, const char* utf8, int32_t bytes,
+        bool ignore_case, union ui_edit_range* hit) {
+    struct ui_edit_find_pattern p;
+    ui_edit_find_pattern_init(&p, utf8, bytes, ignore_case);
+    return ui_edit_find_scan(f, &p, from, hit, 1, true) > 0;
+}
+
+static int32_t ui_edit_find_index(struct ui_edit_find* f, int32_t budget) {
+    const struct ui_edit_text* t = &f->d->text;
+    int32_t checked = 0;
+    while (f->sig != null && f->missing > 0 && budget > 0 && checked < f->np) {
+        if (f->pn >= f->np) { f->pn = 0; }
+        struct ui_edit_find_sig* s = &f->sig[f->pn];
+        if ((s->bits[0] & 1) == 0) {
+            const struct ui_edit_str* str = &t->ps[f->pn];
+            ui_edit_find_trigrams((const uint8_t*)str->u, str->b, s);
+            f->missing--;
+            budget--;
+        }
+        f->pn++;
+        checked++;
+    }
+    return f->missing;
+}
+
+static bool ui_edit_find_reset(struct ui_edit_find* f) {
+    // drops all signatures (e.g. after failed replace)
+    const int32_t np = f->d->text.np;
+    bool ok = true;
+    if (np > f->capacity) {
+        ok = posix_heap.realloc((void**)&f->sig,
+                np * (int64_t)sizeof(f->sig[0])) == 0;
+        if (ok) { f->capacity = np; }
+    }
+    if (ok) {
+        memset(f->sig, 0x00, (size_t)np * sizeof(f->sig[0]));
+        f->np = np;
+        f->missing = np;
+        f->pn = 0;
+    } else {
+        if (f->sig != null) { posix_heap.free(f->sig); }
+        f->sig = null;
+        f->np = 0;
+        f->capacity = 0;
+        f->missing = 0;
+    }
+    return ok;
+}
+
+static void ui_edit_find_after(struct ui_edit_notify* notify,
+        const struct ui_edit_notify_info* ni) {
+    struct ui_edit_find* f = (struct ui_edit_find*)notify;
+    if (f->sig == null) { return; }
+    const int32_t np = f->np - ni->deleted + ni->inserted;
+    if (!ni->ok || np != f->d->text.np) {
+        ui_edit_find_reset(f);
+    } else {
+        // sig[pnf..pnf + deleted] replaced by sig[pnf..pnf + inserted]
+        if (np > f->capacity) {
+            const int32_t c = np * 3 / 2 + 16;
+            bool ok = posix_heap.realloc((void**)&f->sig,
+                    c * (int64_t)sizeof(f->sig[0])) == 0;
+            if (ok) { f->capacity = c; } else { ui_edit_find_reset(f); return; }
+        }
+        const int32_t pnf = ni->pnf;
+        for (int32_t pn = pnf; pn <= pnf + ni->deleted; pn++) {
+            f->missing -= (f->sig[pn].bits[0] & 1) == 0;
+        }
+        const int32_t tail = f->np - (pnf + ni->deleted + 1);
+        memmove(&f->sig[pnf + ni->inserted + 1], &f->sig[pnf + ni->deleted + 1],
+                (size_t)tail * sizeof(f->sig[0]));
+        memset(&f->sig[pnf], 0x00, (size_t)(ni->inserted + 1) * sizeof(f->sig[0]));
+        f->missing += ni->inserted + 1;
+        f->np = np;
+    }
+}
+
+static bool ui_edit_find_init(struct ui_edit_find* f, struct ui_edit_doc* d,
+        bool index) {
+    memset(f, 0x00, sizeof(*f));
+    f->d = d;
+    bool ok = true;
+    if (index) {
+        f->notify.after = ui_edit_find_after;
+        ok = ui_edit_find_reset(f) && ui_edit_doc.subscribe(d, &f->notify);
+        if (!ok && f->sig != null) {
+            posix_heap.free(f->sig);
+            f->sig = null;
+        }
+    }
+    return ok;
+}
+
+static void ui_edit_find_dispose(struct ui_edit_find* f) {
+    if (f->notify.after != null) {
+        ui_edit_doc.unsubscribe(f->d, &f->notify);
+    }
+    if (f->sig != null) { posix_heap.free(f->sig); }
+    memset(f, 0x00, sizeof(*f));
+}
+
+// tests:
+
+static void ui_edit_find_test_memmem(void) {
+    // SIMD and scalar implementations must agree exactly
+    uint32_t seed = 0x1;
+    char s[300];
+    char p[20];
+    for (int32_t i = 0; i < 10000; i++) {
+        const int32_t n = (int32_t)(posix_num.random32(&seed) % posix_countof(s));
+        const int32_t m = (int32_t)(posix_num.random32(&seed) % posix_countof(p)) + 1;
+        // small alphabet makes matches likely
+        for (int32_t k = 0; k < n; k++) {
+            s[k] = "abAB\xC3\xA9"[posix_num.random32(&seed) % 6];
+        }
+        for (int32_t k = 0; k < m; k++) {
+            p[k] = "abAB\xC3\xA9"[posix_num.random32(&seed) % 6];
+        }
+        if (n >= m && posix_num.random32(&seed) % 2 == 0) { // plant a match
+            memcpy(s + posix_num.random32(&seed) % (uint32_t)(n - m + 1), p, (size_t)m);
+        }
+        for (int32_t ic = 0; ic < 2; ic++) {
+            const int32_t r0 = m > n ? -1 :
+                ui_edit_find_scalar((const uint8_t*)s, n, (const uint8_t*)p, m, ic);
+            const int32_t r1 = ui_edit_find.memmem(s, n, p, m, ic);
+            posix_swear(r0 == r1, "n: %d m: %d ic: %d %d != %d", n, m, ic, r0, r1);
+        }
+    }
+    posix_swear(ui_edit_find.memmem("Hello World", 11, "WORLD", 5, true) == 6);
+    posix_swear(ui_edit_find.memmem("Hello World", 11, "WORLD", 5, false) == -1);
+}
+
+static void ui_edit_find_test_doc(void) {
+    struct ui_edit_doc edit_doc = {0};
+    struct ui_edit_doc* d = &edit_doc;
+    const char* s = "Hello World\n"
+                    "\xC2\xA3 world of worlds\n"
+                    "WORLD";
+    posix_swear(ui_edit_doc.init(d, s, -1, false));
+    for (int32_t index = 0; index < 2; index++) {
+        struct ui_edit_find find = {0};
+        struct ui_edit_find* f = &find;
+        posix_swear(ui_edit_find.init(f, d, index));
+        union ui_edit_range hits[8];
+        posix_swear(ui_edit_find.all(f, "world", -1, false, hits, 8) == 2);
+        posix_swear(hits[0].from.pn == 1 && hits[0].from.gp == 2 &&
+                    hits[0].to.pn == 1 && hits[0].to.gp == 7);
+        posix_swear(hits[1].from.pn == 1 && hits[1].from.gp == 11);
+        posix_swear(ui_edit_find.all(f, "world", -1, true, hits, 8) == 4);
+        posix_swear(hits[3].from.pn == 2 && hits[3].to.gp == 5);
+        posix_swear(ui_edit_find.all(f, "worlds\nworld", -1, true, hits, 8) == 1);
+        posix_swear(hits[0].from.pn == 1 && hits[0].from.gp == 11 &&
+                    hits[0].to.pn == 2 && hits[0].to.gp == 5);
+        union ui_edit_range hit = {0};
+        const struct ui_edit_pg from = { .pn = 1, .gp = 3 };
+        posix_swear(ui_edit_find.next(f, from, "world", -1, false, &hit));
+        posix_swear(hit.from.pn == 1 && hit.from.gp == 11);
+        posix_swear(!ui_edit_find.next(f, from, "galaxy", -1, true, &hit));
+        // index follows document modifications:
+        union ui_edit_range r = { .from = {0, 6}, .to = {1, 0} };
+        posix_swear(ui_edit_doc.replace(d, &r, "galaxy\n", -1));
+        posix_swear(ui_edit_find.all(f, "galaxy", -1, false, hits, 8) == 1);
+        posix_swear(hits[0].from.pn == 0 && hits[0].from.gp == 6);
+        posix_swear(ui_edit_doc.undo(d));
+        posix_swear(ui_edit_find.all(f, "galaxy", -1, false, hits, 8) == 0);
+        posix_swear(ui_edit_find.all(f, "World", -1, false, hits, 8) == 1);
+        posix_swear(ui_edit_find.index(f, INT32_MAX) == 0);
+        posix_swear(f->np == (index ? d->text.np : 0));
+        ui_edit_find.dispose(f);
+    }
+    ui_edit_doc.dispose(d);
+}
+
+static void ui_edit_find_test_multiline(void) {
+    // multiline hits must not overlap: scan continues after the hit
+    // inside its last paragraph
+    struct ui_edit_doc edit_doc = {0};
+    struct ui_edit_doc* d = &edit_doc;
+    posix_swear(ui_edit_doc.init(d, "a\na\na\na", -1, false));
+    struct ui_edit_find find = {0};
+    struct ui_edit_find* f = &find;
+    posix_swear(ui_edit_find.init(f, d, false));
+    union ui_edit_range hits[8];
+    posix_swear(ui_edit_find.all(f, "a\na", -1, false, hits, 8) == 2);
+    posix_swear(hits[0].from.pn == 0 && hits[0].from.gp == 0 &&
+                hits[0].to.pn == 1 && hits[0].to.gp == 1);
+    posix_swear(hits[1].from.pn == 2 && hits[1].from.gp == 0 &&
+                hits[1].to.pn == 3 && hits[1].to.gp == 1);
+    posix_swear(ui_edit_find.all(f, "\n", -1, false, hits, 8) == 3);
+    posix_swear(hits[1].from.pn == 1 && hits[1].from.gp == 1 &&
+                hits[1].to.pn == 2 && hits[1].to.gp == 0);
+    posix_swear(ui_edit_find.all(f, "a\na\na", -1, false, hits, 8) == 1);
+    const struct ui_edit_pg from = { .pn = 0, .gp = 1 };
+    union ui_edit_range hit = {0};
+    posix_swear(ui_edit_find.next(f, from, "a\na", -1, false, &hit));
+    posix_swear(hit.from.pn == 1 && hit.to.pn == 2);
+    ui_edit_find.dispose(f);
+    ui_edit_doc.dispose(d);
+}
+
+static void ui_edit_find_test_benchmark(void) {
+    // find-all in 250,000 lines of lorem ipsum like text
+    enum { n = 250 * 1000 };
+    static const char* words[] = {
+        "lorem", "ipsum", "dolor", "sit", "amet", "consectetur",
+        "adipiscing", "elit", "sed", "do", "eiusmod", "tempor",
+        "incididunt", "ut", "labore", "et", "dolore", "magna", "aliqua"
+    };
+    char* text = null;
+    const int64_t bytes = (int64_t)n * 80;
+    posix_swear(posix_heap.alloc((void**)&text, bytes) == 0);
+    uint32_t seed = 0x1;
+    int64_t k = 0;
+    for (int32_t i = 0; i < n; i++) {
+        int32_t column = 0;
+        while (column < 60) {
+            const char* w = words[posix_num.random32(&seed) % posix_countof(words)];
+            const int32_t b = (int32_t)strlen(w);
+            memcpy(text + k, w, (size_t)b);
+            text[k + b] = ' ';
+            k += b + 1;
+            column += b + 1;
+        }
+        if (i % 1000 == 0) { memcpy(text + k - 7, "Needle", 6); }
+        text[k - 1] = '\n';
+    }
+    struct ui_edit_doc edit_doc = {0};
+    struct ui_edit_doc* d = &edit_doc;
+    posix_swear(ui_edit_doc.init(d, text, (int32_t)k - 1, false));
+    struct ui_edit_find find = {0};
+    struct ui_edit_find* f = &find;
+    for (int32_t index = 0; index < 2; index++) {
+        posix_swear(ui_edit_find.init(f, d, index));
+        if (index) {
+            fp64_t time = posix_clock.seconds();
+            ui_edit_find.index(f, INT32_MAX);
+            time = posix_clock.seconds() - time;
+            posix_println("index(%d paragraphs): %.3f ms", n, time * 1000.0);
+        }
+        const char* patterns[] = { "needle", "dolore magna", "tempor" };
+        for (int32_t i = 0; i < posix_countof(patterns); i++) {
+            for (int32_t ic = 0; ic < 2; ic++) {
+                fp64_t time = posix_clock.seconds();
+                int32_t c = ui_edit_find.all(f, patterns[i], -1, ic, null, 0);
+                time = posix_clock.seconds() - time;
+                posix_println("%-7s %-12s ignore_case: %d hits: %6d %.3f ms",
+                    index ? "index" : "scan", patterns[i], ic, c, time * 1000.0);
+            }
+        }
+        ui_edit_find.dispose(f);
+    }
+    {   // reference: scalar scan of the same paragraphs
+        fp64_t time = posix_clock.seconds();
+        int32_t c = 0;
+        for (int32_t pn = 0; pn < d->text.np; pn++) {
+            const struct ui_edit_str* s = &d->text.ps[pn];
+            int32_t o = 0;
+            for (;;) {
+                const int32_t r = ui_edit_find_scalar((const uint8_t*)s->u + o,
+                    s->b - o, (const uint8_t*)"tempor", 6, true);
+                if (r < 0) { break; }
+                c++;
+                o += r + 6;
+            }
+        }
+        time = posix_clock.seconds() - time;
+        posix_println("scalar  tempor       ignore_case: 1 hits: %6d %.3f ms",
+                      c, time * 1000.0);
+    }
+    ui_edit_doc.dispose(d);
+    posix_heap.free(text);
+}
+
+static void ui_edit_find_test(void) {
+    ui_edit_find_test_memmem();
+    ui_edit_find_test_doc();
+    ui_edit_find_test_multiline();
+    #ifdef UI_EDIT_FIND_TEST_BENCHMARK
+        ui_edit_find_test_benchmark();
+    #else
+        (void)(void*)ui_edit_find_test_benchmark; // unused
+    #endif
+}
+
+struct ui_edit_find_if ui_edit_find = {
+    .init    = ui_edit_find_init,
+    .all     = ui_edit_find_all,
+    .next    = ui_edit_find_next,
+    .index   = ui_edit_find_index,
+    .memmem  = ui_edit_find_memmem,
+    .dispose = ui_edit_find_dispose,
+    .test    = ui_edit_find_test
+};
+
+#ifdef UI_EDIT_FIND_TEST
+    posix_static_init(ui_edit_find) { ui_edit_find.test(); }
+#endif
@@ -0,0 +1,135 @@
+/* Copyright (c) Dmitry "Leo" Kuznetsov 2021-24 see LICENSE for details */
+#include "posix/posix.h"
+#include "ui/ui_edit_lines.h"
+
+#undef UI_EDIT_LINES_TEST
+
+#if 0 // flip to 1 to run tests
+
+#define UI_EDIT_LINES_TEST
+
+#endif
+
+static bool ui_edit_lines_init(struct ui_edit_lines* x, int32_t n,
+        int32_t (*count)(void* that, int32_t i), void* that) {
+    posix_assert(n >= 0);
+    bool ok = true;
+    if (x->t == null || x->capacity < n) {
+        ok = posix_heap.realloc((void**)&x->t,
+                                ((size_t)n + 1) * sizeof(x->t[0])) == 0;
+        if (ok) { x->capacity = n; }
+    }
+    if (ok) {
+        x->n = n;
+        x->t[0] = 0;
+        for (int32_t i = 1; i <= n; i++) { x->t[i] = count(that, i - 1); }
+        // each node adds itself to its parent: O(n) instead of n * add()
+        for (int32_t i = 1; i <= n; i++) {
+            const int32_t j = i + (i & -i);
+            if (j <= n) { x->t[j] += x->t[i]; }
+        }
+        x->top = 1;
+        while (x->top * 2 <= n) { x->top *= 2; }
+    } else {
+        x->n = 0;
+    }
+    return ok;
+}
+
+static void ui_edit_lines_clear(struct ui_edit_lines* x) {
+    x->n = 0;
+}
+
+static void ui_edit_lines_add(struct ui_edit_lines* x, int32_t i, int32_t delta) {
+    posix_assert(0 <= i && i < x->n);
+    for (int32_t j = i + 1; j <= x->n; j += j & -j) { x->t[j] += delta; }
+}
+
+static int32_t ui_edit_lines_sum(const struct ui_edit_lines* x, int32_t i) {
+    posix_assert(0 <= i && i <= x->n);
+    int32_t s = 0;
+    for (int32_t j = i; j > 0; j -= j & -j) { s += x->t[j]; }
+    return s;
+}
+
+static int32_t ui_edit_lines_find(const struct ui_edit_lines* x, int32_t k,
+        int32_t* rem) {
+    // binary descent: counts are non negative thus prefix sums are monotonic
+    int32_t i = 0;
+    if (x->n > 0) {
+        for (int32_t step = x->top; step > 0; step /= 2) {
+            if (i + step <= x->n && x->t[i + step] <= k) {
+                i += step;
+                k -= x->t[i];
+            }
+        }
+    }
+    if (rem != null) { *rem = k; }
+    return i;
+}
+
+static void ui_edit_lines_dispose(struct ui_edit_lines* x) {
+    if (x->t != null) { posix_heap.free(x->t); }
+    memset(x, 0, sizeof(*x));
+}
+
+static int32_t ui_edit_lines_test_count(void* that, int32_t i) {
+    return ((const int32_t*)that)[i];
+}
+
+static void ui_edit_lines_test_random(void) {
+    enum { n = 1000 };
+    int32_t* counts = null;
+    posix_swear(posix_heap.alloc((void**)&counts, n * sizeof(counts[0])) == 0);
+    uint32_t seed = 0x1;
+    struct ui_edit_lines x = {0};
+    for (int32_t size = 0; size <= n; size = size * 2 + 1) {
+        for (int32_t i = 0; i < size; i++) {
+            // empty items are allowed and must be skipped by find()
+            counts[i] = (int32_t)(posix_num.random32(&seed) % 4);
+        }
+        posix_swear(ui_edit_lines.init(&x, size, ui_edit_lines_test_count, counts));
+        for (int32_t pass = 0; pass < 2; pass++) {
+            int32_t total = 0;
+            for (int32_t i = 0; i < size; i++) {
+                posix_swear(ui_edit_lines.sum(&x, i) == total);
+                for (int32_t k = total; k < total + counts[i]; k++) {
+                    int32_t rem = -1;
+                    posix_swear(ui_edit_lines.find(&x, k, &rem) == i);
+                    posix_swear(rem == k - total);
+                }
+                total += counts[i];
+            }
+            posix_swear(ui_edit_lines.sum(&x, size) == total);
+            posix_swear(ui_edit_lines.find(&x, total, null) == size);
+            // random updates must keep index in sync with counts[]
+            for (int32_t i = 0; i < size; i++) {
+                const int32_t c = (int32_t)(posix_num.random32(&seed) % 4);
+                ui_edit_lines.add(&x, i, c - counts[i]);
+                counts[i] = c;
+            }
+        }
+        ui_edit_lines.clear(&x);
+        posix_swear(x.n == 0 && ui_edit_lines.find(&x, 0, null) == 0);
+    }
+    ui_edit_lines.dispose(&x);
+    posix_heap.free(counts);
+}
+
+static void ui_edit_lines_test(void) {
+    ui_edit_lines_test_random(); // benchmark: test3 --bench
+}
+
+struct ui_edit_lines_if ui_edit_lines = {
+    .init    = ui_edit_lines_init,
+    .clear   = ui_edit_lines_clear,
+    .add     = ui_edit_lines_add,
+    .sum     = ui_edit_lines_sum,
+    .find    = ui_edit_lines_find,
+    .dispose = ui_edit_lines_dispose,
+    .test    = ui_edit_lines_test
+};
+
+#ifdef UI_EDIT_LINES_TEST
+    posix_static_init(ui_edit_lines) { ui_edit_lines.test(); }
+#endif
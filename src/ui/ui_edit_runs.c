@@ -0,0 +1,300 @@
+/* Copyright (c) Dmitry "Leo" Kuznetsov 2021-24 see LICENSE for details */
+#include "posix/posix.h"
+#include "ui/ui_edit_runs.h"
+
+#undef UI_EDIT_RUNS_TEST
+
+#if 0 // flip to 1 to run tests
+#define UI_EDIT_RUNS_TEST
+#endif
+
+enum {
+    ui_edit_runs_min_capacity = 4 * 1024,
+    ui_edit_runs_max_varint   = 5 // bytes for int32_t
+};
+
+static void ui_edit_runs_grow(struct ui_edit_runs* rs, int32_t capacity) {
+    bool ok = posix_heap.realloc((void**)&rs->data, (size_t)capacity) == 0;
+    posix_swear(ok, "out of memory - cannot continue");
+    rs->capacity = capacity;
+    rs->allocations++;
+}
+
+static int32_t ui_edit_runs_size(const struct ui_edit_runs* rs,
+        const struct ui_edit_paragraph* p) {
+    // number of bytes in varints of all but the last run
+    int32_t n = 0;
+    if (p->runs > 1) {
+        const uint8_t* d = rs->data + p->ofs;
+        int32_t counts = p->runs - 1;
+        while (counts > 0) {
+            if ((d[n] & 0x80) == 0) { counts--; }
+            n++;
+        }
+    }
+    return n;
+}
+
+static void ui_edit_runs_compact(struct ui_edit_runs* rs,
+        struct ui_edit_paragraph para[], int32_t np, int32_t capacity) {
+    uint8_t* data = null;
+    bool ok = posix_heap.alloc((void**)&data, (size_t)capacity) == 0;
+    posix_swear(ok, "out of memory - cannot continue");
+    rs->allocations++;
+    int32_t k = 0;
+    for (int32_t i = 0; i < np; i++) {
+        const int32_t n = ui_edit_runs_size(rs, &para[i]);
+        if (n > 0) {
+            posix_assert(k + n <= capacity);
+            memcpy(data + k, rs->data + para[i].ofs, (size_t)n);
+            para[i].ofs = k;
+            k += n;
+        }
+    }
+    posix_assert(k == rs->bytes - rs->garbage);
+    posix_heap.free(rs->data);
+    rs->data = data;
+    rs->capacity = capacity;
+    rs->bytes = k;
+    rs->garbage = 0;
+}
+
+static void ui_edit_runs_begin(struct ui_edit_runs* rs,
+        struct ui_edit_paragraph para[], int32_t np, int32_t estimate) {
+    // glyph count of a run is less than 16384 and takes 1 or 2 bytes
+    const int32_t need = (estimate > 1 ? estimate : 1) * 2;
+    if (rs->bytes + need > rs->capacity) {
+        const int32_t live = rs->bytes - rs->garbage;
+        int32_t capacity = rs->capacity * 2 > live + need ?
+                           rs->capacity * 2 : (live + need) * 2;
+        if (capacity < ui_edit_runs_min_capacity) {
+            capacity = ui_edit_runs_min_capacity;
+        }
+        if (rs->garbage > 0 && rs->garbage >= rs->bytes / 2) {
+            // at least half is garbage: compacted pool has room to grow
+            ui_edit_runs_compact(rs, para, np, rs->capacity > live + need * 2 ?
+                                 rs->capacity : capacity);
+        } else {
+            ui_edit_runs_grow(rs, capacity);
+        }
+    }
+    rs->start = rs->bytes;
+    rs->last  = rs->bytes;
+}
+
+static void ui_edit_runs_add(struct ui_edit_runs* rs, int32_t glyphs) {
+    posix_assert(glyphs >= 0);
+    if (rs->bytes + ui_edit_runs_max_varint > rs->capacity) {
+        // estimate was too low, must not compact in the middle of paragraph
+        ui_edit_runs_grow(rs, rs->capacity > 0 ?
+                          rs->capacity * 2 : ui_edit_runs_min_capacity);
+    }
+    rs->last = rs->bytes;
+    uint32_t v = (uint32_t)glyphs;
+    while (v >= 0x80) {
+        rs->data[rs->bytes++] = (uint8_t)(v | 0x80);
+        v >>= 7;
+    }
+    rs->data[rs->bytes++] = (uint8_t)v;
+}
+
+static void ui_edit_runs_end(struct ui_edit_runs* rs, struct ui_edit_paragraph* p,
+        int32_t runs) {
+    posix_assert(p->runs == 0 && runs > 0);
+    p->runs = runs;
+    if (runs > 1) { // glyph count of the last run is implied by str->g
+        rs->bytes = rs->last;
+        p->ofs = rs->start;
+    } else {
+        rs->bytes = rs->start;
+        p->ofs = 0;
+    }
+}
+
+static void ui_edit_runs_free(struct ui_edit_runs* rs, struct ui_edit_paragraph* p) {
+    rs->garbage += ui_edit_runs_size(rs, p);
+    posix_assert(rs->garbage <= rs->bytes);
+    p->runs = 0;
+    p->ofs = 0;
+}
+
+static void ui_edit_runs_reset(struct ui_edit_runs* rs) {
+    rs->bytes = 0;
+    rs->garbage = 0;
+}
+
+static void ui_edit_runs_decode(const struct ui_edit_runs* rs, struct ui_edit_run_it* it) {
+    const struct ui_edit_str* str = it->str;
+    struct ui_edit_run* r = &it->run;
+    if (it->rn == it->runs - 1) {
+        r->glyphs = str->g - r->gp;
+    } else {
+        const uint8_t* d = rs->data + it->p->ofs;
+        uint32_t v = 0;
+        int32_t shift = 0;
+        while (d[it->pos] & 0x80) {
+            v |= (uint32_t)(d[it->pos++] & 0x7F) << shift;
+            shift += 7;
+        }
+        v |= (uint32_t)d[it->pos++] << shift;
+        r->glyphs = (int32_t)v;
+    }
+    posix_assert(0 <= r->gp && r->gp + r->glyphs <= str->g);
+    r->bp = str->g2b[r->gp];
+    r->bytes = str->g2b[r->gp + r->glyphs] - r->bp;
+}
+
+static void ui_edit_runs_next(const struct ui_edit_runs* rs, struct ui_edit_run_it* it) {
+    if (it->rn < it->runs) {
+        it->run.gp += it->run.glyphs;
+        it->rn++;
+        if (it->rn < it->runs) { ui_edit_runs_decode(rs, it); }
+    }
+}
+
+static void ui_edit_runs_seek(const struct ui_edit_runs* rs,
+        const struct ui_edit_paragraph* p, const struct ui_edit_str* str,
+        int32_t rn, struct ui_edit_run_it* it) {
+    memset(it, 0, sizeof(*it));
+    it->p = p;
+    it->str = str;
+    it->runs = p->runs;
+    if (it->runs > 0) { ui_edit_runs_decode(rs, it); }
+    while (it->rn < rn && it->rn < it->runs) { ui_edit_runs_next(rs, it); }
+}
+
+static struct ui_edit_run ui_edit_runs_run(const struct ui_edit_runs* rs,
+        const struct ui_edit_paragraph* p, const struct ui_edit_str* str,
+        int32_t rn) {
+    posix_assert(0 <= rn && rn < p->runs);
+    struct ui_edit_run_it it;
+    ui_edit_runs_seek(rs, p, str, rn, &it);
+    return it.run;
+}
+
+static void ui_edit_runs_dispose(struct ui_edit_runs* rs) {
+    if (rs->data != null) { posix_heap.free(rs->data); }
+    memset(rs, 0, sizeof(*rs));
+}
+
+static int32_t ui_edit_runs_test_count(uint32_t* seed, int32_t left) {
+    // mostly short runs, sometimes longer than 1 and 2 byte varints
+    const uint32_t r = posix_num.random32(seed);
+    const int32_t n = r % 16 == 0 ? 1 + (int32_t)(r % 20000) : 1 + (int32_t)(r % 100);
+    return n < left ? n : left;
+}
+
+static void ui_edit_runs_test_store(struct ui_edit_runs* rs,
+        struct ui_edit_paragraph para[], const struct ui_edit_text* t,
+        int32_t pn, uint32_t seed) {
+    const int32_t g = t->ps[pn].g;
+    ui_edit_runs.begin(rs, para, t->np, 1 + g / 64);
+    int32_t runs = 0;
+    int32_t gp = 0;
+    do {
+        const int32_t n = ui_edit_runs_test_count(&seed, g - gp);
+        ui_edit_runs.add(rs, n);
+        gp += n;
+        runs++;
+    } while (gp < g);
+    ui_edit_runs.end(rs, &para[pn], runs);
+}
+
+static void ui_edit_runs_test_verify(struct ui_edit_runs* rs,
+        struct ui_edit_paragraph para[], const struct ui_edit_text* t,
+        int32_t pn, uint32_t seed) {
+    const struct ui_edit_str* str = &t->ps[pn];
+    struct ui_edit_run_it it;
+    ui_edit_runs.seek(rs, &para[pn], str, 0, &it);
+    int32_t gp = 0;
+    while (it.rn < it.runs) {
+        const int32_t n = ui_edit_runs_test_count(&seed, str->g - gp);
+        posix_swear(it.run.gp == gp && it.run.glyphs == n);
+        posix_swear(it.run.bp == str->g2b[gp]);
+        posix_swear(it.run.bytes == str->g2b[gp + n] - str->g2b[gp]);
+        const struct ui_edit_run r = ui_edit_runs.run(rs, &para[pn], str, it.rn);
+        posix_swear(memcmp(&r, &it.run, sizeof(r)) == 0);
+        gp += n;
+        ui_edit_runs.next(rs, &it);
+    }
+    posix_swear(gp == str->g || (gp == 0 && str->g == 0));
+}
+
+static void ui_edit_runs_test(void) {
+    enum { np = 1000 };
+    // paragraphs of 0..40,000 glyphs: ASCII and 2, 3, 4 bytes utf8
+    static const char* glyphs[] = { "a", "\xC2\xA3", "\xE2\x82\xAC", "\xF0\x9F\x92\xB0" };
+    uint32_t seed = 0x1;
+    int32_t length[np];
+    int32_t bytes = 0;
+    for (int32_t i = 0; i < np; i++) {
+        const uint32_t r = posix_num.random32(&seed);
+        length[i] = r % 8 == 0 ? (int32_t)(r % 40000) : (int32_t)(r % 300);
+        bytes += length[i] * 4 + 1;
+    }
+    char* text = null;
+    posix_swear(posix_heap.alloc((void**)&text, bytes) == 0);
+    bytes = 0;
+    for (int32_t i = 0; i < np; i++) {
+        for (int32_t k = 0; k < length[i]; k++) {
+            const char* s = glyphs[posix_num.random32(&seed) % posix_countof(glyphs)];
+            const int32_t b = (int32_t)strlen(s);
+            memcpy(text + bytes, s, (size_t)b);
+            bytes += b;
+        }
+        if (i < np - 1) { text[bytes++] = '\n'; }
+    }
+    struct ui_edit_text t = {0};
+    posix_swear(ui_edit_text.init(&t, text, bytes, false));
+    posix_swear(t.np == np);
+    struct ui_edit_paragraph* para = null;
+    posix_swear(posix_heap.alloc_zero((void**)&para, np * sizeof(para[0])) == 0);
+    uint32_t seeds[np];
+    struct ui_edit_runs rs = {0};
+    for (int32_t pass = 0; pass < 8; pass++) {
+        // wrap, rewrap and free paragraphs in random order
+        // (triggers pool growth and compaction)
+        for (int32_t i = 0; i < np; i++) {
+            const int32_t pn = (int32_t)(posix_num.random32(&seed) % np);
+            if (para[pn].runs > 0) { ui_edit_runs.free(&rs, &para[pn]); }
+            // odd passes mostly free runs and leave garbage in the pool
+            const uint32_t r = posix_num.random32(&seed) % 4;
+            if (pass % 2 == 0 ? r != 0 : r == 0) {
+                seeds[pn] = posix_num.random32(&seed) | 1;
+                ui_edit_runs_test_store(&rs, para, &t, pn, seeds[pn]);
+            }
+        }
+        for (int32_t pn = 0; pn < np; pn++) {
+            if (para[pn].runs > 0) {
+                ui_edit_runs_test_verify(&rs, para, &t, pn, seeds[pn]);
+            }
+        }
+        posix_swear(rs.garbage <= rs.bytes && rs.bytes <= rs.capacity);
+    }
+    for (int32_t pn = 0; pn < np; pn++) {
+        if (para[pn].runs > 0) { ui_edit_runs.free(&rs, &para[pn]); }
+    }
+    posix_swear(rs.garbage == rs.bytes);
+    ui_edit_runs.reset(&rs);
+    ui_edit_runs.dispose(&rs);
+    posix_heap.free(para);
+    ui_edit_text.dispose(&t);
+    posix_heap.free(text);
+}
+
+struct ui_edit_runs_if ui_edit_runs = {
+    .begin   = ui_edit_runs_begin,
+    .add     = ui_edit_runs_add,
+    .end     = ui_edit_runs_end,
+    .free    = ui_edit_runs_free,
+    .reset   = ui_edit_runs_reset,
+    .run     = ui_edit_runs_run,
+    .seek    = ui_edit_runs_seek,
+    .next    = ui_edit_runs_next,
+    .dispose = ui_edit_runs_dispose,
+    .test    = ui_edit_runs_test
+};
+
+#ifdef UI_EDIT_RUNS_TEST
+    posix_static_init(ui_edit_runs) { ui_edit_runs.test(); }
+#endif
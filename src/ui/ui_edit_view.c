@@ -2,6 +2,7 @@
 #include "posix/posix.h"
 #include "ui/ui.h"
 #include "ui/ui_edit_doc.h"
+#include "ui/ui_edit_advance.h"
 
 // TODO: find all "== dt->np" it is wrong pn < dt->np fix them all
 // TODO: undo/redo coalescing
@@ -73,6 +74,20 @@ static int32_t ui_edit_line_height(struct ui_edit_view* e) {
     return e->fm->height + e->fm->line_gap;
 }
 
+static void ui_edit_invalidate_paragraph(struct ui_edit_view* e, int32_t pn,
+        int32_t runs) {
+    // typing inside a paragraph that keeps its height repaints
+    // only lines of the paragraph instead of the whole view
+    const struct ui_ltrb i = ui_view.margins(&e->view, &e->insets);
+    const struct ui_point pt = ui_edit_pg_to_xy(e, (struct ui_edit_pg){ .pn = pn, .gp = 0 });
+    if (pt.x < 0) { // first line of paragraph is not visible
+        ui_edit_invalidate_view(e);
+    } else {
+        ui_edit_invalidate_rect(e, (struct ui_rect){ .x = 0, .y = i.top + pt.y,
+            .w = e->w, .h = runs * ui_edit_line_height(e) });
+    }
+}
+
 static struct ui_rect ui_edit_selection_rect(struct ui_edit_view* e) {
     const union ui_edit_range r = ui_edit_range.order(e->selection);
     const struct ui_ltrb i = ui_view.margins(&e->view, &e->insets);
@@ -104,102 +119,105 @@ static void ui_edit_text_width_gp(struct ui_edit_view* e, const char* utf8, int3
 }
 #endif
 
+// Average GDI measure_text() performance per call:
+// "ui_app.fm.mono"        ~500us (microseconds)
+// "ui_app.fm.prop.normal" ~250us (microseconds) DirectWrite ~100us
+// Each glyph cluster is measured once per font and text width
+// is a sum of cached advances (see ui_edit_advance.h).
+
+// Cache entries are keyed by font handle, metrics pointer and the
+// metrics themselves: ui_app re-creates fonts in place (same ui_fm)
+// on DPI or scale change and a font handle value may be reused.
+
+static struct ui_edit_advance ui_edit_advances[8]; // shared by all views
+static struct ui_edit_advance_key {
+    const struct ui_fm* fm;
+    int32_t height;
+    struct ui_wh em;
+} ui_edit_advances_key[posix_countof(ui_edit_advances)];
+static int32_t ui_edit_advances_next; // round robin replacement
+
+static void ui_edit_view_dispose_advances(const struct ui_fm* fm) {
+    for (int32_t i = 0; i < posix_countof(ui_edit_advances); i++) {
+        if (ui_edit_advances_key[i].fm == fm &&
+            ui_edit_advances[i].measure != null) {
+            ui_edit_advance.dispose(&ui_edit_advances[i]);
+            memset(&ui_edit_advances_key[i], 0x00,
+                   sizeof(ui_edit_advances_key[i]));
+        }
+    }
+}
+
+static int32_t ui_edit_measure_glyph(void* that, const char* utf8, int32_t bytes) {
+    const struct ui_ta ta = { .fm = (struct ui_fm*)that, .measure = true };
+    return ui_draw.text(&ta, 0, 0, "%.*s", bytes, utf8).w;
+}
+
+static struct ui_edit_advance* ui_edit_view_advance(struct ui_edit_view* e) {
+    const void* font = (const void*)e->fm->font;
+    const struct ui_edit_advance_key key = {
+        .fm = e->fm, .height = e->fm->height, .em = e->fm->em
+    };
+    struct ui_edit_advance* a = null;
+    for (int32_t i = 0; i < posix_countof(ui_edit_advances) && a == null; i++) {
+        const struct ui_edit_advance_key* k = &ui_edit_advances_key[i];
+        if (ui_edit_advances[i].measure != null &&
+            ui_edit_advances[i].font == font && k->fm == key.fm &&
+            k->height == key.height &&
+            k->em.w == key.em.w && k->em.h == key.em.h) {
+            a = &ui_edit_advances[i];
+        }
+    }
+    if (a == null) {
+        const int32_t i = ui_edit_advances_next;
+        a = &ui_edit_advances[i];
+        ui_edit_advances_next = (i + 1) % posix_countof(ui_edit_advances);
+        if (a->measure != null) { ui_edit_advance.dispose(a); }
+        ui_edit_advance.init(a, font, ui_edit_measure_glyph, (void*)e->fm);
+        ui_edit_advances_key[i] = key;
+    }
+    return a;
+}
+
 static int32_t ui_edit_text_width(struct ui_edit_view* e, const char* s, int32_t n) {
-//  fp64_t time = posix_clock.seconds();
-    // average GDI measure_text() performance per character:
-    // "ui_app.fm.mono"    ~500us (microseconds)
-    // "ui_app.fm.prop.normal" ~250us (microseconds) DirectWrite ~100us
-    const struct ui_ta ta = { .fm = e->fm, .color = e->color,
-                             .measure = true };
-    int32_t x = n == 0 ? 0 : ui_draw.text(&ta, 0, 0, "%.*s", n, s).w;
-//  time = (posix_clock.seconds() - time) * 1000.0;
-//  static fp64_t time_sum;
-//  static fp64_t length_sum;
-//  time_sum += time;
-//  length_sum += n;
-//  posix_println("avg=%.6fms per char total %.3fms", time_sum / length_sum, time_sum);
-    return x;
-}
-
-static int32_t ui_edit_word_break_at(struct ui_edit_view* e, int32_t pn, int32_t rn,
+    return n == 0 ? 0 : ui_edit_advance.width(ui_edit_view_advance(e), s, n);
+}
+
+static int32_t ui_edit_word_break_at(struct ui_edit_view* e, int32_t pn, int32_t gp,
         const int32_t width, bool allow_zero) {
-    // TODO: in sqlite.c 257,674 lines it takes 11 seconds to get all runs()
-    //       on average ui_edit_word_break_at() takes 4 x ui_edit_text_width()
-    //       measurements and they are slow. If we can reduce this amount
-    //       (not clear how) at least 2 times it will be a win.
-    //       Another way is background thread runs() processing but this is
-    //       involving a lot of complexity.
-    //       MSVC devenv.exe edits sqlite3.c w/o any visible delays
-    int32_t count = 0; // stats logging
-    int32_t chars = 0;
     struct ui_edit_text* dt = &e->doc->text; // document text
     posix_assert(0 <= pn && pn < dt->np);
-    struct ui_edit_paragraph* p = &e->para[pn];
     const struct ui_edit_str* str = &dt->ps[pn];
+    posix_assert(0 <= gp && gp <= str->g);
     int32_t k = 1; // at least 1 glyph
-    // offsets inside a run in glyphs and bytes from start of the paragraph;
-    // guard against p->run not yet allocated (transient state during after()
-    // structural updates) — rn must be 0 in that case
-    int32_t gp = 0;
-    int32_t bp = 0;
-    if (p->run != null) {
-        gp = p->run[rn].gp;
-        bp = p->run[rn].bp;
-    } else {
-        posix_assert(rn == 0);
-    }
+    // gp: start of the run in glyphs from start of the paragraph
+    const int32_t bp = str->g2b[gp];
     if (gp < str->g - 1) {
         const char* text = str->u + bp;
-        const int32_t glyphs_in_this_run = str->g - gp;
-        int32_t* g2b = &str->g2b[gp];
-        // 4 is maximum number of bytes in a UTF-8 sequence
-        int32_t gc = 4 < glyphs_in_this_run ? 4 : glyphs_in_this_run;
-        int32_t w = ui_edit_text_width(e, text, g2b[gc] - bp);
-        count++;
-        chars += g2b[gc] - bp;
-        while (gc < glyphs_in_this_run && w < width) {
-            gc = gc * 4 < glyphs_in_this_run ? gc * 4 : glyphs_in_this_run;
-            w = ui_edit_text_width(e, text, g2b[gc] - bp);
-            count++;
-            chars += g2b[gc] - bp;
-        }
-        if (w < width) {
-            k = gc;
-            posix_assert(1 <= k && k <= str->g - gp);
-        } else {
-            int32_t i = 0;
-            int32_t j = gc;
-            k = (i + j) / 2;
-            while (i < j) {
-                posix_assert(allow_zero || 1 <= k && k < gc + 1);
-                const int32_t n = g2b[k + 1] - bp;
-                int32_t px = ui_edit_text_width(e, text, n);
-                count++;
-                chars += n;
-                if (px == width) { break; }
-                if (px < width) { i = k + 1; } else { j = k; }
-                if (!allow_zero && (i + j) / 2 == 0) { break; }
-                k = (i + j) / 2;
-                posix_assert(allow_zero || 1 <= k && k <= str->g - gp);
-            }
+        // prefix sum of cached glyph advances:
+        k = ui_edit_advance.fit(ui_edit_view_advance(e), text, str->b - bp,
+                                width, null);
+        if (k == 0 && !allow_zero) { // first cluster is wider than `width`
+            const int32_t b = ui_edit_advance.cluster(text, str->b - bp);
+            k = posix_str.glyphs(text, b);
         }
     }
     posix_assert(allow_zero || 1 <= k && k <= str->g - gp);
     return k;
 }
 
-static int32_t ui_edit_word_break(struct ui_edit_view* e, int32_t pn, int32_t rn) {
-    return ui_edit_word_break_at(e, pn, rn, e->edit.w, false);
+static int32_t ui_edit_word_break(struct ui_edit_view* e, int32_t pn, int32_t gp) {
+    return ui_edit_word_break_at(e, pn, gp, e->edit.w, false);
 }
 
-static int32_t ui_edit_glyph_at_x(struct ui_edit_view* e, int32_t pn, int32_t rn,
+static int32_t ui_edit_glyph_at_x(struct ui_edit_view* e, int32_t pn, int32_t gp,
         int32_t x) {
     struct ui_edit_text* dt = &e->doc->text; // document text
     posix_assert(0 <= pn && pn < dt->np);
     if (x == 0 || dt->ps[pn].b == 0) {
         return 0;
     } else {
-        return ui_edit_word_break_at(e, pn, rn, x + 1, true);
+        return ui_edit_word_break_at(e, pn, gp, x + 1, true);
     }
 }
 
@@ -220,81 +238,64 @@ static struct ui_edit_glyph ui_edit_glyph_at(struct ui_edit_view* e, struct ui_e
 }
 
 // paragraph_runs() breaks paragraph into `runs` according to `width`
+// and returns number of runs. Runs are kept in e->pool (see ui_edit_runs.h)
 
-static const struct ui_edit_run* ui_edit_paragraph_runs(struct ui_edit_view* e, int32_t pn,
-        int32_t* runs) {
+static int32_t ui_edit_paragraph_runs(struct ui_edit_view* e, int32_t pn) {
 //  fp64_t time = posix_clock.seconds();
     posix_assert(e->w > 0);
     struct ui_edit_text* dt = &e->doc->text; // document text
     posix_assert(0 <= pn && pn < dt->np);
-    const struct ui_edit_run* r = null;
-    if (e->para[pn].run != null) {
-        *runs = e->para[pn].runs;
-        r = e->para[pn].run;
-    } else {
-        posix_assert(0 <= pn && pn < dt->np);
-        struct ui_edit_paragraph* p = &e->para[pn];
+    struct ui_edit_paragraph* p = &e->para[pn];
+    if (p->runs == 0) {
         const struct ui_edit_str* str = &dt->ps[pn];
-        if (p->run == null) {
-            posix_assert(p->runs == 0 && p->run == null);
-            const int32_t max_runs = str->b + 1;
-            bool ok = posix_heap.alloc((void**)&p->run, max_runs *
-                                    sizeof(struct ui_edit_run)) == 0;
-            posix_swear(ok);
-            struct ui_edit_run* run = p->run;
-            run[0].bp = 0;
-            run[0].gp = 0;
-            int32_t gc = str->b == 0 ? 0 : ui_edit_word_break(e, pn, 0);
-            if (gc == str->g) { // whole paragraph fits into width
-                p->runs = 1;
-                run[0].bytes  = str->b;
-                run[0].glyphs = str->g;
-                int32_t pixels = ui_edit_text_width(e, str->u, str->g2b[gc]);
-                run[0].pixels = pixels;
-            } else {
-                posix_assert(gc < str->g);
-                int32_t rc = 0; // runs count
-                int32_t ix = 0; // glyph index from to start of paragraph
-                const char* text = str->u;
-                int32_t bytes = str->b;
-                while (bytes > 0) {
-                    posix_assert(rc < max_runs);
-                    run[rc].bp = (int32_t)(text - str->u);
-                    run[rc].gp = ix;
-                    int32_t glyphs = ui_edit_word_break(e, pn, rc);
-                    int32_t utf8bytes = str->g2b[ix + glyphs] - run[rc].bp;
-                    int32_t pixels = ui_edit_text_width(e, text, utf8bytes);
-                    if (glyphs > 1 && utf8bytes < bytes && text[utf8bytes - 1] != 0x20) {
-                        // try to find word break SPACE character. utf8 space is 0x20
-                        int32_t i = utf8bytes;
-                        while (i > 0 && text[i - 1] != 0x20) { i--; }
-                        if (i > 0 && i != utf8bytes) {
-                            utf8bytes = i;
-                            glyphs = posix_str.glyphs(text, utf8bytes);
-                            posix_assert(glyphs >= 0);
-                            pixels = ui_edit_text_width(e, text, utf8bytes);
-                        }
+        int32_t gc = str->b == 0 ? 0 : ui_edit_word_break(e, pn, 0);
+        if (gc == str->g) { // whole paragraph fits into width
+            ui_edit_runs.begin(&e->pool, e->para, dt->np, 1);
+            ui_edit_runs.end(&e->pool, p, 1);
+        } else {
+            posix_assert(gc < str->g);
+            // upfront estimate of number of runs to reserve pool space:
+            const int32_t cw = e->fm->average_char_width > 0 ?
+                               e->fm->average_char_width : e->fm->em.w;
+            const int64_t w = e->edit.w > 0 ? e->edit.w : 1;
+            const int64_t estimate = 1 + (int64_t)str->g * cw / w;
+            ui_edit_runs.begin(&e->pool, e->para, dt->np,
+                (int32_t)(estimate < str->g ? estimate : str->g));
+            int32_t rc = 0; // runs count
+            int32_t ix = 0; // glyph index from to start of paragraph
+            const char* text = str->u;
+            int32_t bytes = str->b;
+            while (bytes > 0) {
+                int32_t glyphs = ui_edit_word_break(e, pn, ix);
+                int32_t utf8bytes = str->g2b[ix + glyphs] - str->g2b[ix];
+                if (glyphs > 1 && utf8bytes < bytes && text[utf8bytes - 1] != 0x20) {
+                    // try to find word break SPACE character. utf8 space is 0x20
+                    int32_t i = utf8bytes;
+                    while (i > 0 && text[i - 1] != 0x20) { i--; }
+                    if (i > 0 && i != utf8bytes) {
+                        utf8bytes = i;
+                        glyphs = posix_str.glyphs(text, utf8bytes);
+                        posix_assert(glyphs >= 0);
                     }
-                    run[rc].bytes  = utf8bytes;
-                    run[rc].glyphs = glyphs;
-                    run[rc].pixels = pixels;
-                    rc++;
-                    text += utf8bytes;
-                    posix_assert(0 <= utf8bytes && utf8bytes <= bytes);
-                    bytes -= utf8bytes;
-                    ix += glyphs;
                 }
-                posix_assert(rc > 0);
-                p->runs = rc; // truncate heap capacity array:
-                ok = posix_heap.realloc((void**)&p->run, rc * sizeof(struct ui_edit_run)) == 0;
-                posix_swear(ok);
+                ui_edit_runs.add(&e->pool, glyphs);
+                rc++;
+                text += utf8bytes;
+                posix_assert(0 <= utf8bytes && utf8bytes <= bytes);
+                bytes -= utf8bytes;
+                ix += glyphs;
             }
+            posix_assert(rc > 0);
+            ui_edit_runs.end(&e->pool, p, rc);
+        }
+        e->wrap.wrapped++;
+        e->wrap.runs += p->runs;
+        if (e->lines.n == dt->np) { // not yet wrapped counted as 1 run
+            ui_edit_lines.add(&e->lines, pn, p->runs - 1);
         }
-        *runs = p->runs;
-        r = p->run;
     }
-    posix_assert(r != null && *runs >= 1);
-    return r;
+    posix_assert(p->runs >= 1);
+    return p->runs;
 }
 
 static int32_t ui_edit_paragraph_run_count(struct ui_edit_view* e, int32_t pn) {
@@ -302,11 +303,27 @@ static int32_t ui_edit_paragraph_run_count(struct ui_edit_view* e, int32_t pn) {
     struct ui_edit_text* dt = &e->doc->text; // document text
     int32_t runs = 0;
     if (e->w > 0 && 0 <= pn && pn < dt->np) {
-        (void)ui_edit_paragraph_runs(e, pn, &runs);
+        runs = ui_edit_paragraph_runs(e, pn);
     }
     return runs;
 }
 
+// seek_run() wraps paragraph if necessary and positions `it` at run[rn]
+
+static void ui_edit_seek_run(struct ui_edit_view* e, int32_t pn, int32_t rn,
+        struct ui_edit_run_it* it) {
+    (void)ui_edit_paragraph_runs(e, pn);
+    ui_edit_runs.seek(&e->pool, &e->para[pn], &e->doc->text.ps[pn], rn, it);
+}
+
+static struct ui_edit_run ui_edit_paragraph_run(struct ui_edit_view* e,
+        int32_t pn, int32_t rn) {
+    struct ui_edit_run_it it;
+    ui_edit_seek_run(e, pn, rn, &it);
+    posix_assert(0 <= rn && rn < it.runs);
+    return it.run;
+}
+
 static int32_t ui_edit_glyphs_in_paragraph(struct ui_edit_view* e, int32_t pn) {
     struct ui_edit_text* dt = &e->doc->text; // document text
     posix_assert(0 <= pn && pn < dt->np);
@@ -314,6 +331,53 @@ static int32_t ui_edit_glyphs_in_paragraph(struct ui_edit_view* e, int32_t pn) {
     return dt->ps[pn].g;
 }
 
+// Visible paragraphs are broken into runs on demand by layout and
+// paint. The rest of the document is wrapped incrementally from
+// every_100ms() in small time slices on the UI thread: runs depend
+// on glyph measurements that are not thread safe and on the document
+// that may be modified at any keystroke.
+
+static int32_t ui_edit_view_wrap(struct ui_edit_view* e, fp64_t budget) {
+    const struct ui_edit_text* dt = &e->doc->text; // document text
+    if (e->w > 0 && e->para != null && e->wrap.wrapped < dt->np) {
+        const fp64_t deadline = posix_clock.seconds() + budget;
+        int32_t pn = e->wrap.pn < dt->np ? e->wrap.pn : 0;
+        int32_t checked = 0;
+        bool expired = false;
+        while (!expired && checked < dt->np && e->wrap.wrapped < dt->np) {
+            if (e->para[pn].runs == 0) {
+                (void)ui_edit_paragraph_run_count(e, pn);
+                expired = posix_clock.seconds() >= deadline;
+            }
+            pn = pn + 1 < dt->np ? pn + 1 : 0;
+            checked++;
+        }
+        e->wrap.pn = pn;
+    }
+    return dt->np - e->wrap.wrapped;
+}
+
+static int64_t ui_edit_view_runs(struct ui_edit_view* e, bool *exact) {
+    const int32_t np = e->doc->text.np;
+    const int32_t unwrapped = np - e->wrap.wrapped;
+    int64_t runs = e->wrap.runs;
+    if (unwrapped > 0) { // average runs per wrapped paragraph
+        const fp64_t average = e->wrap.wrapped == 0 ? 1.0 :
+                (fp64_t)e->wrap.runs / (fp64_t)e->wrap.wrapped;
+        runs += (int64_t)((fp64_t)unwrapped * average + 0.5);
+    }
+    if (exact != null) { *exact = unwrapped == 0; }
+    return runs;
+}
+
+static void ui_edit_every_100ms(struct ui_view* v) {
+    struct ui_edit_view* e = (struct ui_edit_view*)v;
+    if (!e->sle && !ui_view.is_hidden(v)) {
+        // ~8ms out of every 100ms keeps UI responsive
+        (void)ui_edit_view_wrap(e, 0.008);
+    }
+}
+
 static void ui_edit_create_caret(struct ui_edit_view* e) {
     posix_fatal_if(e->focused);
     posix_assert(ui_app.is_active());
@@ -370,13 +434,13 @@ static void ui_edit_allocate_runs(struct ui_edit_view* e) {
 }
 
 static void ui_edit_invalidate_run(struct ui_edit_view* e, int32_t i) {
-    if (e->para[i].run != null) {
-        posix_assert(e->para[i].runs > 0);
-        posix_heap.free(e->para[i].run);
-        e->para[i].run = null;
-        e->para[i].runs = 0;
-    } else {
-        posix_assert(e->para[i].runs == 0);
+    if (e->para[i].runs > 0) {
+        e->wrap.wrapped--;
+        e->wrap.runs -= e->para[i].runs;
+        if (e->lines.n == e->doc->text.np) {
+            ui_edit_lines.add(&e->lines, i, 1 - e->para[i].runs);
+        }
+        ui_edit_runs.free(&e->pool, &e->para[i]);
     }
 }
 
@@ -388,12 +452,16 @@ static void ui_edit_invalidate_runs(struct ui_edit_view* e, int32_t f, int32_t t
 
 static void ui_edit_invalidate_all_runs(struct ui_edit_view* e) {
     struct ui_edit_text* dt = &e->doc->text; // document text
+    ui_edit_lines.clear(&e->lines); // cheaper to rebuild than to update
     ui_edit_invalidate_runs(e, 0, dt->np - 1, dt->np);
+    ui_edit_runs.reset(&e->pool); // all of it is garbage now
 }
 
 static void ui_edit_dispose_runs(struct ui_edit_view* e, int32_t np) {
     posix_assert(e->para != null);
+    ui_edit_lines.clear(&e->lines);
     ui_edit_invalidate_runs(e, 0, np - 1, np);
+    ui_edit_runs.dispose(&e->pool);
     posix_heap.free(e->para);
     e->para = null;
 }
@@ -418,6 +486,7 @@ static void ui_edit_if_sle_layout(struct ui_edit_view* e) {
 }
 
 static void ui_edit_view_set_font(struct ui_edit_view* e, struct ui_fm* f) {
+    ui_edit_view_dispose_advances(f); // font may have been re-created
     ui_edit_invalidate_all_runs(e);
     e->scroll.rn = 0;
     e->fm = f;
@@ -437,19 +506,21 @@ static struct ui_edit_pr ui_edit_pg_to_pr(struct ui_edit_view* e, const struct u
         pr.rn = 0;
     } else {
         posix_assert(0 <= pg.pn && pg.pn < dt->np);
-        int32_t runs = 0;
-        const struct ui_edit_run* run = ui_edit_paragraph_runs(e, pg.pn, &runs);
+        struct ui_edit_run_it it;
+        ui_edit_seek_run(e, pg.pn, 0, &it);
+        const int32_t runs = it.runs;
         if (pg.gp == str->g + 1) {
             pr.rn = runs - 1; // TODO: past last glyph ??? is this correct?
         } else {
             posix_assert(0 <= pg.gp && pg.gp <= str->g);
-            for (int32_t j = 0; j < runs && pr.rn < 0; j++) {
-                const int32_t last_run = j == runs - 1;
-                const int32_t start = run[j].gp;
-                const int32_t end = run[j].gp + run[j].glyphs + last_run;
+            while (it.rn < runs && pr.rn < 0) {
+                const int32_t last_run = it.rn == runs - 1;
+                const int32_t start = it.run.gp;
+                const int32_t end = it.run.gp + it.run.glyphs + last_run;
                 if (start <= pg.gp && pg.gp < end) {
-                    pr.rn = j;
+                    pr.rn = it.rn;
                 }
+                ui_edit_runs.next(&e->pool, &it);
             }
             posix_assert(pr.rn >= 0);
         }
@@ -457,15 +528,56 @@ static struct ui_edit_pr ui_edit_pg_to_pr(struct ui_edit_view* e, const struct u
     return pr;
 }
 
+// lines index counts not yet wrapped paragraphs as a single run,
+// it is exact only when all paragraphs are wrapped.
+
+static int32_t ui_edit_lines_count(void* that, int32_t pn) {
+    const struct ui_edit_view* e = (const struct ui_edit_view*)that;
+    return e->para[pn].runs > 0 ? e->para[pn].runs : 1;
+}
+
+static void ui_edit_lines_rebuild(struct ui_edit_view* e) {
+    const struct ui_edit_text* dt = &e->doc->text; // document text
+    if (e->lines.n != dt->np) {
+        bool ok = ui_edit_lines.init(&e->lines, dt->np, ui_edit_lines_count, e);
+        posix_swear(ok, "out of memory - cannot continue");
+    }
+}
+
+static int32_t ui_edit_view_line(struct ui_edit_view* e, const struct ui_edit_pg pg) {
+    posix_assert(0 <= pg.pn && pg.pn < e->doc->text.np);
+    const int32_t rn = ui_edit_pg_to_pr(e, pg).rn; // wraps pg.pn
+    ui_edit_lines_rebuild(e);
+    return ui_edit_lines.sum(&e->lines, pg.pn) + rn;
+}
+
+static struct ui_edit_pr ui_edit_line_to_pr(struct ui_edit_view* e, int32_t line) {
+    const struct ui_edit_text* dt = &e->doc->text; // document text
+    ui_edit_lines_rebuild(e);
+    struct ui_edit_pr pr = {0};
+    pr.pn = ui_edit_lines.find(&e->lines, line > 0 ? line : 0, &pr.rn);
+    if (pr.pn >= dt->np) { // past the end of the text
+        pr.pn = dt->np - 1;
+        pr.rn = INT32_MAX;
+    }
+    // wrapping may change number of runs of an estimated paragraph:
+    const int32_t runs = ui_edit_paragraph_run_count(e, pr.pn);
+    if (pr.rn >= runs) { pr.rn = runs - 1; }
+    return pr;
+}
+
 static int32_t ui_edit_runs_between(struct ui_edit_view* e, const struct ui_edit_pg pg0,
         const struct ui_edit_pg pg1) {
     posix_assert(ui_edit_range.uint64(pg0) <= ui_edit_range.uint64(pg1));
+    const struct ui_edit_text* dt = &e->doc->text; // document text
     int32_t rn0 = ui_edit_pg_to_pr(e, pg0).rn;
     int32_t rn1 = ui_edit_pg_to_pr(e, pg1).rn;
     int32_t rc = 0;
     if (pg0.pn == pg1.pn) {
         posix_assert(rn0 <= rn1);
         rc = rn1 - rn0;
+    } else if (pg1.pn - pg0.pn > e->visible_runs && e->wrap.wrapped == dt->np) {
+        rc = ui_edit_view_line(e, pg1) - ui_edit_view_line(e, pg0);
     } else {
         posix_assert(pg0.pn < pg1.pn);
         for (int32_t i = pg0.pn; i < pg1.pn; i++) {
@@ -482,13 +594,13 @@ static int32_t ui_edit_runs_between(struct ui_edit_view* e, const struct ui_edit
 }
 
 static struct ui_edit_pg ui_edit_scroll_pg(struct ui_edit_view* e) {
-    int32_t runs = 0;
-    const struct ui_edit_run* run = ui_edit_paragraph_runs(e, e->scroll.pn, &runs);
+    const int32_t runs = ui_edit_paragraph_runs(e, e->scroll.pn);
     // layout may decrease number of runs when view is growing:
     if (e->scroll.rn >= runs) { e->scroll.rn = runs - 1; }
     posix_assert(0 <= e->scroll.rn && e->scroll.rn < runs,
             "e->scroll.rn: %d runs: %d", e->scroll.rn, runs);
-    return (struct ui_edit_pg) { .pn = e->scroll.pn, .gp = run[e->scroll.rn].gp };
+    const struct ui_edit_run r = ui_edit_paragraph_run(e, e->scroll.pn, e->scroll.rn);
+    return (struct ui_edit_pg) { .pn = e->scroll.pn, .gp = r.gp };
 }
 
 static int32_t ui_edit_first_visible_run(struct ui_edit_view* e, int32_t pn) {
@@ -507,17 +619,18 @@ static struct ui_point ui_edit_pg_to_xy(struct ui_edit_view* e, const struct ui_
     for (int32_t i = e->scroll.pn; i <= pn && pt.x < 0; i++) {
         posix_assert(0 <= i && i < dt->np);
         const struct ui_edit_str* str = &dt->ps[i];
-        int32_t runs = 0;
-        const struct ui_edit_run* run = ui_edit_paragraph_runs(e, i, &runs);
-        for (int32_t j = ui_edit_first_visible_run(e, i); j < runs; j++) {
-            const int32_t last_run = j == runs - 1;
-            const int32_t gc = run[j].glyphs; // glyphs count
+        struct ui_edit_run_it it;
+        ui_edit_seek_run(e, i, ui_edit_first_visible_run(e, i), &it);
+        for (; it.rn < it.runs; ui_edit_runs.next(&e->pool, &it)) {
+            const struct ui_edit_run* r = &it.run;
+            const int32_t last_run = it.rn == it.runs - 1;
+            const int32_t gc = r->glyphs; // glyphs count
             if (i == pg.pn) {
                 // in the last `run` of a paragraph x after last glyph is OK
-                if (run[j].gp <= pg.gp && pg.gp < run[j].gp + gc + last_run) {
-                    const char* s = str->u + run[j].bp;
-                    const uint32_t bp2e = str->b - run[j].bp; // to end of str
-                    int32_t ofs = ui_edit_str.gp_to_bp(s, bp2e, pg.gp - run[j].gp);
+                if (r->gp <= pg.gp && pg.gp < r->gp + gc + last_run) {
+                    const char* s = str->u + r->bp;
+                    const uint32_t bp2e = str->b - r->bp; // to end of str
+                    int32_t ofs = ui_edit_str.gp_to_bp(s, bp2e, pg.gp - r->gp);
                     posix_swear(ofs >= 0);
                     pt.x = ui_edit_text_width(e, s, ofs);
                     break;
@@ -567,18 +680,18 @@ static struct ui_edit_pg ui_edit_xy_to_pg(struct ui_edit_view* e, int32_t x, int
     for (int32_t i = e->scroll.pn; i < dt->np && pg.pn < 0; i++) {
         posix_assert(0 <= i && i < dt->np);
         const struct ui_edit_str* str = &dt->ps[i];
-        int32_t runs = 0;
-        const struct ui_edit_run* run = ui_edit_paragraph_runs(e, i, &runs);
-        for (int32_t j = ui_edit_first_visible_run(e, i); j < runs && pg.pn < 0; j++) {
-            const struct ui_edit_run* r = &run[j];
-            const char* s = str->u + run[j].bp;
+        struct ui_edit_run_it it;
+        ui_edit_seek_run(e, i, ui_edit_first_visible_run(e, i), &it);
+        for (; it.rn < it.runs && pg.pn < 0; ui_edit_runs.next(&e->pool, &it)) {
+            const struct ui_edit_run* r = &it.run;
+            const char* s = str->u + r->bp;
             if (py <= y && y < py + ui_edit_line_height(e)) {
                 int32_t w = ui_edit_text_width(e, s, r->bytes);
                 pg.pn = i;
                 if (x >= w) {
                     pg.gp = r->gp + r->glyphs;
                 } else {
-                    pg.gp = r->gp + ui_edit_glyph_at_x(e, i, j, x);
+                    pg.gp = r->gp + ui_edit_glyph_at_x(e, i, r->gp, x);
                     if (pg.gp < r->glyphs - 1) {
                         struct ui_edit_pg right = {pg.pn, pg.gp + 1};
                         int32_t x0 = ui_edit_pg_to_xy(e, pg).x;
@@ -617,26 +730,52 @@ static struct ui_edit_pg ui_edit_view_end_of_text(struct ui_edit_view* e) {
     return (struct ui_edit_pg){ .pn = dt->np - 1, .gp = dt->ps[dt->np - 1].g };
 }
 
+// lines index is exact once all paragraphs are wrapped, until then
+// scrolling walks runs one by one wrapping paragraphs on the way
+
+static bool ui_edit_lines_exact(struct ui_edit_view* e) {
+    return e->wrap.wrapped == e->doc->text.np;
+}
+
+static int32_t ui_edit_scroll_line(struct ui_edit_view* e) {
+    (void)ui_edit_scroll_pg(e); // clamps e->scroll.rn
+    ui_edit_lines_rebuild(e);
+    return ui_edit_lines.sum(&e->lines, e->scroll.pn) + e->scroll.rn;
+}
+
 static struct ui_edit_pg ui_edit_view_last_fully_visible(struct ui_edit_view* e) {
     struct ui_edit_text* dt = &e->doc->text; // document text
     struct ui_edit_pg pg = ui_edit_scroll_pg(e);
     int32_t visible_runs = e->visible_runs;
-    while (visible_runs > 0) {
-        int32_t runs = 0;
-        const struct ui_edit_run* run = ui_edit_paragraph_runs(e, pg.pn, &runs);
-        int32_t i = 0;
-        pg.gp = 0;
-        while (visible_runs > 0 && i < runs) {
-            pg.gp += run[i].glyphs;
-            visible_runs--;
-            i++;
+    if (visible_runs > 0 && ui_edit_lines_exact(e)) {
+        const int32_t line = ui_edit_scroll_line(e) + visible_runs - 1;
+        int32_t rn = 0;
+        const int32_t pn = ui_edit_lines.find(&e->lines, line, &rn);
+        if (pn < dt->np) {
+            const struct ui_edit_run r = ui_edit_paragraph_run(e, pn, rn);
+            pg = (struct ui_edit_pg){ .pn = pn, .gp = r.gp + r.glyphs };
+        } else {
+            pg = ui_edit_view_end_of_text(e);
         }
-        if (visible_runs > 0) {
-            if (pg.pn < dt->np - 1) {
-                pg.pn++;
-                pg.gp = 0;
-            } else {
-                visible_runs = 0; // reached end of text
+    } else {
+        int32_t rn = e->scroll.rn; // first visible run
+        while (visible_runs > 0) {
+            struct ui_edit_run_it it;
+            ui_edit_seek_run(e, pg.pn, rn, &it);
+            pg.gp = it.run.gp;
+            while (visible_runs > 0 && it.rn < it.runs) {
+                pg.gp += it.run.glyphs;
+                visible_runs--;
+                ui_edit_runs.next(&e->pool, &it);
+            }
+            if (visible_runs > 0) {
+                if (pg.pn < dt->np - 1) {
+                    pg.pn++;
+                    pg.gp = 0;
+                    rn = 0;
+                } else {
+                    visible_runs = 0; // reached end of text
+                }
             }
         }
     }
@@ -649,26 +788,32 @@ static struct ui_edit_pg ui_edit_view_last_fully_visible(struct ui_edit_view* e)
 static void ui_edit_scroll_up(struct ui_edit_view* e, int32_t run_count) {
     struct ui_edit_text* dt = &e->doc->text; // document text
     posix_assert(0 < run_count, "does it make sense to have 0 scroll?");
-    struct ui_edit_pg eot  = ui_edit_view_end_of_text(e);
-    while (run_count > 0) {
-        struct ui_edit_pg lfv = ui_edit_view_last_fully_visible(e);
-        posix_println("eot: %d:%d lfv: %d:%d", eot.pn, eot.gp, lfv.pn, lfv.gp);
-        if (ui_edit_range.compare(lfv, eot) == 0) {
-            run_count = 0;
-        } else {
-            const int32_t runs = ui_edit_paragraph_run_count(e, e->scroll.pn);
-            if (e->scroll.rn < runs - 1) {
-                e->scroll.rn++;
-                run_count--;
-            } else if (e->scroll.pn < dt->np - 1) {
-                e->scroll.pn++;
-                e->scroll.rn = 0;
-                run_count--;
+    if (ui_edit_lines_exact(e)) {
+        const int32_t line = ui_edit_scroll_line(e);
+        const int32_t total = ui_edit_lines.sum(&e->lines, e->lines.n);
+        // last line of the text stays at the bottom of the view:
+        const int32_t last = posix_max(line, total - e->visible_runs);
+        e->scroll = ui_edit_line_to_pr(e, posix_min(line + run_count, last));
+    } else {
+        struct ui_edit_pg eot = ui_edit_view_end_of_text(e);
+        while (run_count > 0) {
+            struct ui_edit_pg lfv = ui_edit_view_last_fully_visible(e);
+            if (ui_edit_range.compare(lfv, eot) == 0) {
+                run_count = 0;
             } else {
-                posix_println("???");
-                run_count = 0; // enough
+                const int32_t runs = ui_edit_paragraph_run_count(e, e->scroll.pn);
+                if (e->scroll.rn < runs - 1) {
+                    e->scroll.rn++;
+                    run_count--;
+                } else if (e->scroll.pn < dt->np - 1) {
+                    e->scroll.pn++;
+                    e->scroll.rn = 0;
+                    run_count--;
+                } else {
+                    run_count = 0; // enough
+                }
+                posix_assert(e->scroll.pn >= 0 && e->scroll.rn >= 0);
             }
-            posix_assert(e->scroll.pn >= 0 && e->scroll.rn >= 0);
         }
     }
     ui_edit_if_sle_layout(e);
@@ -680,24 +825,38 @@ static void ui_edit_scroll_up(struct ui_edit_view* e, int32_t run_count) {
 
 static void ui_edit_scroll_down(struct ui_edit_view* e, int32_t run_count) {
     posix_assert(0 < run_count, "does it make sense to have 0 scroll?");
-    while (run_count > 0 && (e->scroll.pn > 0 || e->scroll.rn > 0)) {
-        int32_t runs = ui_edit_paragraph_run_count(e, e->scroll.pn);
-        e->scroll.rn = e->scroll.rn < runs - 1 ? e->scroll.rn : runs - 1;
-        if (e->scroll.rn == 0 && e->scroll.pn > 0) {
-            e->scroll.pn--;
-            e->scroll.rn = ui_edit_paragraph_run_count(e, e->scroll.pn) - 1;
-        } else if (e->scroll.rn > 0) {
-            e->scroll.rn--;
+    if (ui_edit_lines_exact(e)) {
+        const int32_t line = ui_edit_scroll_line(e);
+        e->scroll = ui_edit_line_to_pr(e, posix_max(line - run_count, 0));
+    } else {
+        while (run_count > 0 && (e->scroll.pn > 0 || e->scroll.rn > 0)) {
+            int32_t runs = ui_edit_paragraph_run_count(e, e->scroll.pn);
+            e->scroll.rn = e->scroll.rn < runs - 1 ? e->scroll.rn : runs - 1;
+            if (e->scroll.rn == 0 && e->scroll.pn > 0) {
+                e->scroll.pn--;
+                e->scroll.rn = ui_edit_paragraph_run_count(e, e->scroll.pn) - 1;
+            } else if (e->scroll.rn > 0) {
+                e->scroll.rn--;
+            }
+            posix_assert(e->scroll.pn >= 0 && e->scroll.rn >= 0);
+            posix_assert(0 <= e->scroll.rn &&
+                        e->scroll.rn < ui_edit_paragraph_run_count(e, e->scroll.pn));
+            run_count--;
         }
-        posix_assert(e->scroll.pn >= 0 && e->scroll.rn >= 0);
-        posix_assert(0 <= e->scroll.rn &&
-                    e->scroll.rn < ui_edit_paragraph_run_count(e, e->scroll.pn));
-        run_count--;
     }
     ui_edit_if_sle_layout(e);
     ui_edit_invalidate_view(e);
 }
 
+// scroll_to() O(log n) jump for scroll bar and "go to line"
+
+static void ui_edit_view_scroll_to(struct ui_edit_view* e, int32_t line) {
+    if (e->w > 0 && !e->sle) {
+        e->scroll = ui_edit_line_to_pr(e, line);
+        ui_edit_invalidate_view(e);
+    }
+}
+
 static void ui_edit_scroll_into_view(struct ui_edit_view* e, const struct ui_edit_pg pg) {
     struct ui_edit_text* dt = &e->doc->text; // document text
     posix_assert(0 <= pg.pn && pg.pn < dt->np && dt->np > 0);
@@ -956,9 +1115,9 @@ static void ui_edit_ctrl_left(struct ui_edit_view* e) {
     if (to.gp == 0) {
         if (to.pn > 0) {
             to.pn--;
-            int32_t runs = 0;
-            const struct ui_edit_run* run = ui_edit_paragraph_runs(e, to.pn, &runs);
-            to.gp = run[runs - 1].gp + run[runs - 1].glyphs;
+            const int32_t runs = ui_edit_paragraph_runs(e, to.pn);
+            const struct ui_edit_run r = ui_edit_paragraph_run(e, to.pn, runs - 1);
+            to.gp = r.gp + r.glyphs;
         }
     } else {
         to.gp--;
@@ -1088,9 +1247,7 @@ static void ui_edit_view_key_up(struct ui_edit_view* e) {
             int32_t rn1 = ui_edit_pg_to_pr(e, to).rn;
             if (rn1 > 0 && rn0 == rn1) { // same run
                 posix_assert(to.gp > 0, "word break must not break on zero gp");
-                int32_t runs = 0;
-                const struct ui_edit_run* run = ui_edit_paragraph_runs(e, to.pn, &runs);
-                to.gp = run[rn1].gp;
+                to.gp = ui_edit_paragraph_run(e, to.pn, rn1).gp;
             }
         }
     }
@@ -1127,13 +1284,12 @@ static void ui_edit_view_key_home(struct ui_edit_view* e) {
     }
     const int32_t pn = e->selection.a[1].pn;
     int32_t runs = ui_edit_paragraph_run_count(e, pn);
-    const struct ui_edit_paragraph* para = &e->para[pn];
     if (runs <= 1) {
         e->selection.a[1].gp = 0;
     } else {
         int32_t rn = ui_edit_pg_to_pr(e, e->selection.a[1]).rn;
         posix_assert(0 <= rn && rn < runs);
-        const int32_t gp = para->run[rn].gp;
+        const int32_t gp = ui_edit_paragraph_run(e, pn, rn).gp;
         if (e->selection.a[1].gp != gp) {
             // first Home keystroke moves caret to start of run
             e->selection.a[1].gp = gp;
@@ -1159,16 +1315,16 @@ static void ui_edit_view_key_eol(struct ui_edit_view* e) {
     int32_t gp = e->selection.a[1].gp;
     posix_assert(0 <= pn && pn < dt->np);
     const struct ui_edit_str* str = &dt->ps[pn];
-    int32_t runs = 0;
-    const struct ui_edit_run* run = ui_edit_paragraph_runs(e, pn, &runs);
+    const int32_t runs = ui_edit_paragraph_runs(e, pn);
     int32_t rn = ui_edit_pg_to_pr(e, e->selection.a[1]).rn;
     posix_assert(0 <= rn && rn < runs);
+    const struct ui_edit_run run = ui_edit_paragraph_run(e, pn, rn);
     if (rn == runs - 1) {
         e->selection.a[1].gp = str->g;
     } else if (e->selection.a[1].gp == str->g) {
         // at the end of paragraph do nothing (or move caret to EOF?)
-    } else if (str->g > 0 && gp != run[rn].glyphs - 1) {
-        e->selection.a[1].gp = run[rn].gp + run[rn].glyphs - 1;
+    } else if (str->g > 0 && gp != run.glyphs - 1) {
+        e->selection.a[1].gp = run.gp + run.glyphs - 1;
     } else {
         e->selection.a[1].gp = str->g;
     }
@@ -1317,14 +1473,14 @@ static bool ui_edit_view_key_pressed(struct ui_view* v, int64_t key) {
 }
 
 static void ui_edit_undo(struct ui_edit_view* e) {
-    if (e->doc->undo != null) {
+    if (e->doc->undo.count > 0) {
         ui_edit_doc.undo(e->doc);
     } else {
         ui_app.beep(ui.beep.error);
     }
 }
 static void ui_edit_redo(struct ui_edit_view* e) {
-    if (e->doc->redo != null) {
+    if (e->doc->redo.count > 0) {
         ui_edit_doc.redo(e->doc);
     } else {
         ui_app.beep(ui.beep.error);
@@ -1573,8 +1729,12 @@ static int32_t ui_edit_view_save(struct ui_edit_view* e, char* text, int32_t* by
     } else if (*bytes < utf8bytes) {
         r = posix_core.error.insufficient_buffer;
     } else {
-        ui_edit_doc.copy(e->doc, null, text, utf8bytes);
-        posix_assert(text[utf8bytes - 1] == 0x00);
+        // same batched writer as ui_edit_doc.save() into caller's buffer
+        struct posix_stream_memory_if ms = {0};
+        posix_streams.write_only(&ms, text, utf8bytes - 1);
+        r = ui_edit_doc.write(e->doc, null, &ms.stream);
+        posix_assert(r != 0 || ms.pos_write == utf8bytes - 1);
+        text[r == 0 ? utf8bytes - 1 : 0] = 0x00;
     }
     return r;
 }
@@ -1722,10 +1882,11 @@ static void ui_edit_layout(struct ui_view* v) { // top down
         e->selection.a[0].pn = 0; // only has single paragraph
         e->selection.a[1].pn = 0;
         // scroll line on top of current cursor position into view
-        const struct ui_edit_run* run = ui_edit_paragraph_runs(e, 0, &runs);
+        runs = ui_edit_paragraph_runs(e, 0);
         if (runs <= 2 && e->scroll.rn == 1) {
             struct ui_edit_pg top = scroll;
-            const int32_t g = top.gp - run[e->scroll.rn].glyphs - 1;
+            const int32_t g = top.gp -
+                ui_edit_paragraph_run(e, 0, e->scroll.rn).glyphs - 1;
             top.gp = 0 > g ? 0 : g;
             ui_edit_scroll_into_view(e, top);
         }
@@ -1790,17 +1951,18 @@ static int32_t ui_edit_paint_paragraph(struct ui_edit_view* e,
     struct ui_edit_text* dt = &e->doc->text; // document text
     posix_assert(0 <= pn && pn < dt->np);
     const struct ui_edit_str* str = &dt->ps[pn];
-    int32_t runs = 0;
-    const struct ui_edit_run* run = ui_edit_paragraph_runs(e, pn, &runs);
-    for (int32_t j = ui_edit_first_visible_run(e, pn);
-                 j < runs && y < e->y + e->inside.bottom; j++) {
-//      posix_println("[%d.%d] @%d,%d bytes: %d", pn, j, x, y, run[j].bytes);
+    struct ui_edit_run_it it;
+    ui_edit_seek_run(e, pn, ui_edit_first_visible_run(e, pn), &it);
+    for (; it.rn < it.runs && y < e->y + e->inside.bottom;
+           ui_edit_runs.next(&e->pool, &it)) {
+        const struct ui_edit_run* r = &it.run;
+//      posix_println("[%d.%d] @%d,%d bytes: %d", pn, it.rn, x, y, r->bytes);
         if (rc.y - ui_edit_line_height(e) <= y && y < rc.y + rc.h) {
-            const char* text = str->u + run[j].bp;
-            ui_edit_paint_selection(e, y, &run[j], text, pn,
-                                    run[j].gp, run[j].gp + run[j].glyphs);
-            ui_draw.text(ta, x, y, "%.*s", run[j].bytes, text);
-            if (j < runs - 1 && !e->hide_word_wrap) {
+            const char* text = str->u + r->bp;
+            ui_edit_paint_selection(e, y, r, text, pn,
+                                    r->gp, r->gp + r->glyphs);
+            ui_draw.text(ta, x, y, "%.*s", r->bytes, text);
+            if (it.rn < it.runs - 1 && !e->hide_word_wrap) {
                 ui_draw.text(ta, x + e->edit.w, y, "%s", ww);
             }
         }
@@ -1874,6 +2036,7 @@ static bool ui_edit_reallocate_runs(struct ui_edit_view* e, int32_t p,
         ui_edit_invalidate_run(e, p + i);
     }
     if (old_np != new_np) {
+        ui_edit_lines.clear(&e->lines); // indices shifted, rebuilt on use
         int32_t move_src = p + deleted + 1;
         int32_t move_dst = p + inserted + 1;
         int32_t move_count = old_np - move_src;
@@ -1899,8 +2062,8 @@ static bool ui_edit_reallocate_runs(struct ui_edit_view* e, int32_t p,
     // Initialize the newly inserted paragraphs to "no run cache yet".
     if (ok) {
         for (int32_t i = 1; i <= inserted; i++) {
-            e->para[p + i].run = null;
             e->para[p + i].runs = 0;
+            e->para[p + i].ofs  = 0;
         }
     }
     return ok;
@@ -1939,7 +2102,9 @@ static void ui_edit_after(struct ui_edit_notify* notify,
     // scheduling stays inside the (w>0, h>0) gate.
     const int32_t np = (int32_t)n->data;
     posix_swear(dt->np == np - ni->deleted + ni->inserted);
-    ui_edit_reallocate_runs(e, ni->r->from.pn, ni->deleted, ni->inserted);
+    const int32_t pn = ni->r->from.pn;
+    const int32_t runs = e->para[pn].runs; // before edit, 0 if not wrapped
+    ui_edit_reallocate_runs(e, pn, ni->deleted, ni->inserted);
     e->selection = *ni->x;
     struct ui_edit_pg* pg = e->selection.a;
     for (int32_t i = 0; i < posix_countof(e->selection.a); i++) {
@@ -1955,6 +2120,9 @@ static void ui_edit_after(struct ui_edit_notify* notify,
             ni->x->from.pn != ni->x->to.pn &&
             ni->r->from.pn == ni->x->from.pn) {
             ui_edit_invalidate_rect(e, ui_edit_selection_rect(e));
+        } else if (ni->deleted == 0 && ni->inserted == 0 && runs > 0 &&
+                   runs == ui_edit_paragraph_run_count(e, pn)) {
+            ui_edit_invalidate_paragraph(e, pn, runs);
         } else {
             ui_edit_invalidate_view(e);
         }
@@ -1998,6 +2166,7 @@ static void ui_edit_view_init(struct ui_edit_view* e, struct ui_edit_doc* d) {
     e->focus_lost   = ui_edit_focus_lost;
     e->key_pressed  = ui_edit_view_key_pressed;
     e->mouse_scroll = ui_edit_mouse_scroll;
+    e->every_100ms  = ui_edit_every_100ms;
     ui_edit_allocate_runs(e);
     if (e->debug.id == null) { e->debug.id = "#edit"; }
 }
@@ -2005,6 +2174,7 @@ static void ui_edit_view_init(struct ui_edit_view* e, struct ui_edit_doc* d) {
 static void ui_edit_view_dispose(struct ui_edit_view* e) {
     ui_edit_doc.unsubscribe(e->doc, &e->listener.notify);
     ui_edit_dispose_all_runs(e);
+    ui_edit_lines.dispose(&e->lines);
     memset(e, 0, sizeof(*e));
 }
 
@@ -2012,6 +2182,10 @@ struct ui_edit_view_if ui_edit_view = {
     .init                 = ui_edit_view_init,
     .set_font             = ui_edit_view_set_font,
     .move                 = ui_edit_view_move,
+    .wrap                 = ui_edit_view_wrap,
+    .runs                 = ui_edit_view_runs,
+    .line                 = ui_edit_view_line,
+    .scroll_to            = ui_edit_view_scroll_to,
     .replace              = ui_edit_view_replace,
     .save                 = ui_edit_view_save,
     .erase                = ui_edit_view_erase,
@@ -0,0 +1,629 @@
+/* Copyright (c) Dmitry "Leo" Kuznetsov 2021-24 see LICENSE for details */
+#include "posix/posix.h"
+#include "ui/ui_gif.h"
+
+#undef UI_GIF_TEST
+
+#if 0 // flip to 1 to run tests
+
+#define UI_GIF_TEST
+
+#endif
+
+static uint32_t ui_gif_uint16(const uint8_t* p) {
+    return (uint32_t)p[0] | ((uint32_t)p[1] << 8);
+}
+
+static void ui_gif_palette(uint32_t* palette, const uint8_t* rgb, int32_t n) {
+    for (int32_t i = 0; i < n; i++) {
+        palette[i] = 0xFF000000u | (uint32_t)rgb[i * 3 + 2] << 16 |
+                     (uint32_t)rgb[i * 3 + 1] << 8 | rgb[i * 3 + 0];
+    }
+    for (int32_t i = n; i < 256; i++) { palette[i] = 0xFF000000u; }
+}
+
+static int ui_gif_init(struct ui_gif* g, const void* data, int64_t bytes) {
+    memset(g, 0x00, sizeof(*g));
+    const uint8_t* p = (const uint8_t*)data;
+    int r = 0;
+    if (bytes < 13 || (memcmp(p, "GIF87a", 6) != 0 &&
+                       memcmp(p, "GIF89a", 6) != 0)) {
+        r = EINVAL;
+    } else {
+        g->data = p;
+        g->bytes = bytes;
+        g->w = (int32_t)ui_gif_uint16(p + 6);
+        g->h = (int32_t)ui_gif_uint16(p + 8);
+        g->start = 13;
+        const uint8_t flags = p[10];
+        if (flags & 0x80) { // global color table
+            const int32_t n = 2 << (flags & 0x7);
+            g->start += n * 3;
+            if (g->start <= bytes) { ui_gif_palette(g->palette, p + 13, n); }
+        }
+        if (g->w == 0 || g->h == 0 || g->start > bytes) {
+            r = EINVAL;
+        } else {
+            r = posix_heap.alloc_zero((void**)&g->canvas,
+                                      (int64_t)g->w * g->h * 4);
+        }
+        g->next = g->start;
+        g->index = -1;
+    }
+    if (r != 0) { ui_gif.dispose(g); }
+    return r;
+}
+
+struct ui_gif_bits { // LSB first bit stream of data sub-blocks
+    const uint8_t* p;
+    int64_t  i;
+    int64_t  end;
+    int32_t  left; // bytes left in current sub-block
+    uint32_t bits;
+    int32_t  count;
+    bool     terminated; // zero length sub-block has been read
+};
+
+static int32_t ui_gif_code(struct ui_gif_bits* b, int32_t size) {
+    int32_t code = -1;
+    while (b->count < size && !b->terminated && b->i < b->end) {
+        if (b->left == 0) {
+            b->left = b->p[b->i++];
+            b->terminated = b->left == 0;
+        } else {
+            b->bits |= (uint32_t)b->p[b->i++] << b->count;
+            b->count += 8;
+            b->left--;
+        }
+    }
+    if (b->count >= size) {
+        code = (int32_t)(b->bits & ((1u << size) - 1));
+        b->bits >>= size;
+        b->count -= size;
+    }
+    return code;
+}
+
+struct ui_gif_raster { // frame pixels in interlaced or sequential order
+    uint32_t* canvas;
+    int32_t stride; // canvas width
+    int32_t x;      // frame rectangle clipped by canvas
+    int32_t y;
+    int32_t w;
+    int32_t h;
+    int32_t cw;     // visible part of the rectangle
+    int32_t ch;
+    int32_t col;
+    int32_t row;
+    int32_t pass;   // interlace pass 0..3 or -1
+    int32_t transparent; // index or -1
+    const uint32_t* palette;
+};
+
+static void ui_gif_row(struct ui_gif_raster* r) {
+    static const int32_t start[4] = { 0, 4, 2, 1 };
+    static const int32_t step[4]  = { 8, 8, 4, 2 };
+    r->col = 0;
+    if (r->pass < 0) {
+        r->row++;
+    } else {
+        r->row += step[r->pass];
+        while (r->row >= r->h && r->pass < 3) {
+            r->pass++;
+            r->row = start[r->pass];
+        }
+    }
+}
+
+static void ui_gif_put(struct ui_gif_raster* r, const uint8_t* s, int32_t n) {
+    // `s` reversed string of color indices (LZW stack)
+    while (n > 0 && r->row < r->h) {
+        const int32_t k = posix_min(n, r->w - r->col);
+        if (r->row < r->ch) {
+            uint32_t* d = r->canvas + (int64_t)(r->y + r->row) * r->stride +
+                          r->x + r->col;
+            const int32_t visible = posix_max(0, posix_min(k, r->cw - r->col));
+            for (int32_t i = 0; i < visible; i++) {
+                const uint8_t ix = s[n - 1 - i];
+                if (ix != r->transparent) { d[i] = r->palette[ix]; }
+            }
+        }
+        n -= k;
+        r->col += k;
+        if (r->col == r->w) { ui_gif_row(r); }
+    }
+}
+
+static int ui_gif_lzw(struct ui_gif* g, struct ui_gif_bits* b,
+        int32_t min_size, struct ui_gif_raster* r) {
+    int e = 0;
+    const int32_t clear = 1 << min_size;
+    const int32_t eoi = clear + 1;
+    int32_t size = min_size + 1;
+    int32_t next = clear + 2;
+    int32_t old = -1;
+    uint8_t first = 0;
+    for (int32_t i = 0; i < clear; i++) { g->prefix[i] = 0; g->suffix[i] = (uint8_t)i; }
+    bool done = false;
+    while (!done && e == 0) {
+        int32_t code = ui_gif_code(b, size);
+        if (code < 0 || code == eoi) {
+            done = true; // truncated raster is tolerated
+        } else if (code == clear) {
+            size = min_size + 1;
+            next = clear + 2;
+            old = -1;
+        } else if (old < 0) {
+            if (code > clear) {
+                e = EINVAL;
+            } else {
+                first = (uint8_t)code;
+                g->stack[0] = first;
+                ui_gif_put(r, g->stack, 1);
+                old = code;
+            }
+        } else if (code > next) {
+            e = EINVAL;
+        } else {
+            const int32_t in = code;
+            int32_t n = 0;
+            if (code == next) { // string not yet in dictionary: old + first
+                g->stack[n++] = first;
+                code = old;
+            }
+            while (code >= clear) {
+                g->stack[n++] = g->suffix[code];
+                code = g->prefix[code];
+            }
+            first = (uint8_t)code;
+            g->stack[n++] = first;
+            ui_gif_put(r, g->stack, n);
+            if (next < 4096) {
+                g->prefix[next] = (uint16_t)old;
+                g->suffix[next] = first;
+                next++;
+                if (next == (1 << size) && size < 12) { size++; }
+            }
+            old = in;
+        }
+        done = done || r->row >= r->h;
+    }
+    return e;
+}
+
+static void ui_gif_skip(const uint8_t* p, int64_t bytes, int64_t* i) {
+    // data sub-blocks up to and including zero length terminator,
+    // truncated data ends like the trailer
+    while (*i < bytes && p[*i] != 0) { *i += p[*i] + 1; }
+    *i = posix_min(*i + 1, bytes);
+}
+
+static void ui_gif_dispose_frame(struct ui_gif* g) {
+    const int32_t x = g->rect.x;
+    const int32_t y = g->rect.y;
+    const int32_t w = g->rect.w;
+    for (int32_t j = 0; j < g->rect.h && w > 0; j++) {
+        uint32_t* d = g->canvas + (int64_t)(y + j) * g->w + x;
+        if (g->disposal == 2) {
+            memset(d, 0x00, (size_t)w * 4);
+        } else if (g->disposal == 3) {
+            memcpy(d, g->saved + (int64_t)j * w, (size_t)w * 4);
+        }
+    }
+}
+
+static int ui_gif_save(struct ui_gif* g) {
+    int r = 0;
+    const int64_t n = (int64_t)g->rect.w * g->rect.h;
+    if (n > g->capacity) {
+        r = posix_heap.realloc((void**)&g->saved, n * 4);
+        if (r == 0) { g->capacity = n; }
+    }
+    for (int32_t j = 0; j < g->rect.h && n > 0 && r == 0; j++) {
+        memcpy(g->saved + (int64_t)j * g->rect.w,
+               g->canvas + (int64_t)(g->rect.y + j) * g->w + g->rect.x,
+               (size_t)g->rect.w * 4);
+    }
+    return r;
+}
+
+static int ui_gif_image(struct ui_gif* g, int64_t* i, int32_t disposal,
+        int32_t delay, int32_t transparent) {
+    const uint8_t* p = g->data;
+    int r = *i + 9 <= g->bytes ? 0 : EINVAL;
+    if (r == 0) {
+        const int32_t x = (int32_t)ui_gif_uint16(p + *i + 0);
+        const int32_t y = (int32_t)ui_gif_uint16(p + *i + 2);
+        const int32_t w = (int32_t)ui_gif_uint16(p + *i + 4);
+        const int32_t h = (int32_t)ui_gif_uint16(p + *i + 6);
+        const uint8_t flags = p[*i + 8];
+        *i += 9;
+        uint32_t local[256];
+        const uint32_t* palette = g->palette;
+        if (flags & 0x80) {
+            const int32_t n = 2 << (flags & 0x7);
+            if (*i + n * 3 > g->bytes) {
+                r = EINVAL;
+            } else {
+                ui_gif_palette(local, p + *i, n);
+                palette = local;
+                *i += n * 3;
+            }
+        }
+        const int32_t min_size = r == 0 && *i < g->bytes ? p[(*i)++] : 0;
+        if (r == 0 && (min_size < 2 || min_size > 11)) { r = EINVAL; }
+        if (r == 0) {
+            // frame rectangle clipped by logical screen:
+            g->rect.x = posix_min(x, g->w);
+            g->rect.y = posix_min(y, g->h);
+            g->rect.w = posix_min(w, g->w - g->rect.x);
+            g->rect.h = posix_min(h, g->h - g->rect.y);
+            g->disposal = disposal;
+            g->delay = delay;
+            if (disposal == 3) { r = ui_gif_save(g); }
+        }
+        if (r == 0) {
+            struct ui_gif_raster raster = {
+                .canvas = g->canvas, .stride = g->w,
+                .x = g->rect.x, .y = g->rect.y, .w = w, .h = h,
+                .cw = g->rect.w, .ch = g->rect.h,
+                .pass = (flags & 0x40) ? 0 : -1,
+                .transparent = transparent, .palette = palette
+            };
+            struct ui_gif_bits bits = { .p = p, .i = *i, .end = g->bytes };
+            if (w > 0 && h > 0) { r = ui_gif_lzw(g, &bits, min_size, &raster); }
+            *i = bits.i;
+            if (r == 0 && !bits.terminated) {
+                *i = posix_min(*i + bits.left, g->bytes);
+                ui_gif_skip(p, g->bytes, i);
+            }
+        }
+    }
+    return r;
+}
+
+static int ui_gif_next(struct ui_gif* g) {
+    const uint8_t* p = g->data;
+    if (g->index >= 0) { ui_gif_dispose_frame(g); }
+    int32_t disposal = 0;
+    int32_t delay = 0;
+    int32_t transparent = -1;
+    int r = 0;
+    bool decoded = false;
+    bool rewound = false;
+    int64_t i = g->next;
+    while (!decoded && r == 0) {
+        const int32_t block = i < g->bytes ? p[i++] : 0x3B;
+        if (block == 0x21 && i < g->bytes) { // extension
+            const uint8_t label = p[i++];
+            if (label == 0xF9 && i + 5 <= g->bytes && p[i] == 4) {
+                // graphic control extension
+                disposal = (p[i + 1] >> 2) & 0x7;
+                if (disposal > 3) { disposal = 0; }
+                delay = (int32_t)ui_gif_uint16(p + i + 2) * 10;
+                transparent = (p[i + 1] & 1) ? p[i + 4] : -1;
+            }
+            ui_gif_skip(p, g->bytes, &i);
+        } else if (block == 0x2C) { // image descriptor
+            // browsers show frames with delay <= 10ms for 100ms:
+            r = ui_gif_image(g, &i, disposal, delay <= 10 ? 100 : delay,
+                             transparent);
+            decoded = r == 0;
+        } else if (block == 0x3B && g->index >= 0 && !rewound) {
+            // trailer (or end of truncated data): start over
+            if (g->frames == 0) { g->frames = g->index + 1; }
+            memset(g->canvas, 0x00, (size_t)g->w * g->h * 4);
+            g->index = -1;
+            g->disposal = 0;
+            i = g->start;
+            rewound = true;
+        } else {
+            r = EINVAL;
+        }
+    }
+    if (r == 0) {
+        g->index++;
+        g->next = i;
+    }
+    return r;
+}
+
+static int64_t ui_gif_memory(const struct ui_gif* g) {
+    return (int64_t)sizeof(*g) + (int64_t)g->w * g->h * 4 + g->capacity * 4;
+}
+
+static void ui_gif_dispose(struct ui_gif* g) {
+    if (g->canvas != null) { posix_heap.free(g->canvas); }
+    if (g->saved != null)  { posix_heap.free(g->saved); }
+    g->canvas = null;
+    g->saved = null;
+    g->capacity = 0;
+}
+
+// Test GIF encoder: real LZW compression (linear dictionary search)
+// and a straightforward reference compositor to compare frames with.
+
+enum { ui_gif_test_w = 13, ui_gif_test_h = 11 };
+
+struct ui_gif_test_frame {
+    int32_t x;
+    int32_t y;
+    int32_t w;
+    int32_t h;
+    int32_t disposal;
+    int32_t delay; // centiseconds
+    int32_t transparent; // -1 none
+    int32_t colors; // of local color table or 0
+    bool    interlaced;
+    uint8_t ix[64 * 64]; // w * h color indices
+};
+
+struct ui_gif_test_writer {
+    uint8_t* d;
+    int32_t n;
+    int32_t block; // position of current sub-block length byte
+    uint32_t bits;
+    int32_t count;
+};
+
+static void ui_gif_test_byte(struct ui_gif_test_writer* w, uint8_t b) {
+    if (w->d[w->block] == 255) {
+        w->block = w->n++;
+        w->d[w->block] = 0;
+    }
+    w->d[w->n++] = b;
+    w->d[w->block]++;
+}
+
+static void ui_gif_test_emit(struct ui_gif_test_writer* w, int32_t code,
+        int32_t size) {
+    w->bits |= (uint32_t)code << w->count;
+    w->count += size;
+    while (w->count >= 8) {
+        ui_gif_test_byte(w, (uint8_t)w->bits);
+        w->bits >>= 8;
+        w->count -= 8;
+    }
+}
+
+static void ui_gif_test_lzw(struct ui_gif_test_writer* w, const uint8_t* ix,
+        int32_t n, int32_t min_size) {
+    static uint16_t prefix[4096];
+    static uint8_t  suffix[4096];
+    const int32_t clear = 1 << min_size;
+    int32_t size = min_size + 1;
+    int32_t next = clear + 2;
+    w->d[w->n++] = (uint8_t)min_size;
+    w->block = w->n++;
+    w->d[w->block] = 0;
+    ui_gif_test_emit(w, clear, size);
+    posix_assert(n > 0);
+    int32_t s = ix[0];
+    for (int32_t i = 1; i < n; i++) {
+        int32_t found = -1;
+        for (int32_t k = clear + 2; k < next && found < 0; k++) {
+            if (prefix[k] == s && suffix[k] == ix[i]) { found = k; }
+        }
+        if (found >= 0) {
+            s = found;
+        } else {
+            ui_gif_test_emit(w, s, size);
+            if (next == 4096) {
+                ui_gif_test_emit(w, clear, size);
+                size = min_size + 1;
+                next = clear + 2;
+            } else {
+                prefix[next] = (uint16_t)s;
+                suffix[next] = ix[i];
+                next++;
+                // decoder adds entries one code later:
+                if (next > (1 << size) && size < 12) { size++; }
+            }
+            s = ix[i];
+        }
+    }
+    ui_gif_test_emit(w, s, size);
+    ui_gif_test_emit(w, clear + 1, size);
+    if (w->count > 0) { ui_gif_test_byte(w, (uint8_t)w->bits); }
+    w->d[w->n++] = 0; // terminator
+    w->bits = 0;
+    w->count = 0;
+}
+
+static void ui_gif_test_rgb(uint8_t* d, int32_t i, int32_t salt) {
+    d[0] = (uint8_t)(i * 37 + salt);
+    d[1] = (uint8_t)(i * 91 + salt * 3);
+    d[2] = (uint8_t)(i * 13 + 7);
+}
+
+static int32_t ui_gif_test_encode(uint8_t* d, int32_t gw, int32_t gh,
+        const struct ui_gif_test_frame* f, int32_t frames) {
+    struct ui_gif_test_writer w = { .d = d };
+    memcpy(d, "GIF89a", 6);
+    w.n = 6;
+    d[w.n++] = (uint8_t)gw; d[w.n++] = (uint8_t)(gw >> 8);
+    d[w.n++] = (uint8_t)gh; d[w.n++] = (uint8_t)(gh >> 8);
+    d[w.n++] = 0x80 | 0x3; // global color table of 16 colors
+    d[w.n++] = 0;
+    d[w.n++] = 0;
+    for (int32_t i = 0; i < 16; i++) { ui_gif_test_rgb(d + w.n + i * 3, i, 0); }
+    w.n += 16 * 3;
+    static const uint8_t comment[] = { 0x21, 0xFE, 3, 'a', 'b', 'c', 0 };
+    memcpy(d + w.n, comment, sizeof(comment));
+    w.n += (int32_t)sizeof(comment);
+    for (int32_t k = 0; k < frames; k++) {
+        d[w.n++] = 0x21; d[w.n++] = 0xF9; d[w.n++] = 4;
+        d[w.n++] = (uint8_t)(f[k].disposal << 2 | (f[k].transparent >= 0));
+        d[w.n++] = (uint8_t)f[k].delay; d[w.n++] = (uint8_t)(f[k].delay >> 8);
+        d[w.n++] = (uint8_t)(f[k].transparent >= 0 ? f[k].transparent : 0);
+        d[w.n++] = 0;
+        d[w.n++] = 0x2C;
+        const int32_t v[4] = { f[k].x, f[k].y, f[k].w, f[k].h };
+        for (int32_t i = 0; i < 4; i++) {
+            d[w.n++] = (uint8_t)v[i]; d[w.n++] = (uint8_t)(v[i] >> 8);
+        }
+        int32_t bits = 4;
+        uint8_t flags = f[k].interlaced ? 0x40 : 0x00;
+        if (f[k].colors > 0) {
+            bits = 1;
+            while ((1 << bits) < f[k].colors) { bits++; }
+            flags |= (uint8_t)(0x80 | (bits - 1));
+        }
+        d[w.n++] = flags;
+        for (int32_t i = 0; i < (f[k].colors > 0 ? 1 << bits : 0); i++) {
+            ui_gif_test_rgb(d + w.n, i, k + 1);
+            w.n += 3;
+        }
+        uint8_t ix[64 * 64] = {0}; // in stream order
+        int32_t n = 0;
+        static const int32_t start[4] = { 0, 4, 2, 1 };
+        static const int32_t step[4]  = { 8, 8, 4, 2 };
+        for (int32_t pass = 0; pass < (f[k].interlaced ? 4 : 1); pass++) {
+            const int32_t s0 = f[k].interlaced ? start[pass] : 0;
+            const int32_t s1 = f[k].interlaced ? step[pass] : 1;
+            for (int32_t y = s0; y < f[k].h; y += s1) {
+                memcpy(ix + n, f[k].ix + y * f[k].w, (size_t)f[k].w);
+                n += f[k].w;
+            }
+        }
+        ui_gif_test_lzw(&w, ix, n, posix_max(2, bits));
+    }
+    d[w.n++] = 0x3B;
+    return w.n;
+}
+
+static void ui_gif_test_compose(uint32_t* canvas, uint32_t* saved, int32_t gw,
+        const struct ui_gif_test_frame* f, int32_t k) {
+    // reference: previous frame disposal then draw frame `k`
+    if (k > 0) {
+        const struct ui_gif_test_frame* p = &f[k - 1];
+        for (int32_t y = p->y; y < p->y + p->h; y++) {
+            for (int32_t x = p->x; x < p->x + p->w; x++) {
+                if (p->disposal == 2) { canvas[y * gw + x] = 0; }
+                if (p->disposal == 3) { canvas[y * gw + x] = saved[y * gw + x]; }
+            }
+        }
+    }
+    memcpy(saved, canvas, (size_t)gw * ui_gif_test_h * 4);
+    for (int32_t y = 0; y < f[k].h; y++) {
+        for (int32_t x = 0; x < f[k].w; x++) {
+            const uint8_t ix = f[k].ix[y * f[k].w + x];
+            if (ix != f[k].transparent) {
+                uint8_t rgb[3];
+                ui_gif_test_rgb(rgb, ix, f[k].colors > 0 ? k + 1 : 0);
+                canvas[(f[k].y + y) * gw + f[k].x + x] = 0xFF000000u |
+                    (uint32_t)rgb[2] << 16 | (uint32_t)rgb[1] << 8 | rgb[0];
+            }
+        }
+    }
+}
+
+static void ui_gif_test_frames(void) {
+    static struct ui_gif_test_frame f[5] = {
+        { 0, 0, ui_gif_test_w, ui_gif_test_h, 1, 5, -1, 0, false },
+        { 2, 1, 5, 4, 2, 0, 3, 0, false }, // cleared, 100ms default
+        { 1, 2, 9, 9, 3, 7, 5, 8, true },  // restored, interlaced, local
+        { 4, 3, 6, 5, 0, 300, 1, 0, true },
+        { 0, 0, 1, 1, 1, 1, -1, 2, false } // single pixel, 10ms -> 100ms
+    };
+    uint32_t seed = 1;
+    for (int32_t k = 0; k < posix_countof(f); k++) {
+        const int32_t colors = f[k].colors > 0 ? f[k].colors : 16;
+        for (int32_t i = 0; i < f[k].w * f[k].h; i++) {
+            // runs of the same index exercise LZW strings:
+            const uint32_t r = posix_num.random32(&seed);
+            f[k].ix[i] = i > 0 && r % 3 == 0 ? f[k].ix[i - 1] :
+                         (uint8_t)(r % (uint32_t)colors);
+        }
+    }
+    static uint8_t data[16 * 1024];
+    const int32_t bytes = ui_gif_test_encode(data, ui_gif_test_w,
+        ui_gif_test_h, f, posix_countof(f));
+    posix_swear(bytes <= posix_countof(data));
+    struct ui_gif g = {0};
+    posix_swear(ui_gif.init(&g, data, bytes) == 0);
+    posix_swear(g.w == ui_gif_test_w && g.h == ui_gif_test_h && g.index == -1);
+    enum { n = ui_gif_test_w * ui_gif_test_h };
+    static uint32_t canvas[n];
+    static uint32_t saved[n];
+    for (int32_t loop = 0; loop < 2; loop++) {
+        memset(canvas, 0x00, sizeof(canvas));
+        for (int32_t k = 0; k < posix_countof(f); k++) {
+            posix_swear(ui_gif.next(&g) == 0);
+            ui_gif_test_compose(canvas, saved, ui_gif_test_w, f, k);
+            posix_swear(g.index == k);
+            posix_swear(g.frames == (loop == 0 ? 0 : posix_countof(f)));
+            posix_swear(g.delay == (f[k].delay <= 1 ? 100 : f[k].delay * 10));
+            posix_swear(g.rect.x == f[k].x && g.rect.y == f[k].y &&
+                        g.rect.w == f[k].w && g.rect.h == f[k].h);
+            for (int32_t i = 0; i < n; i++) {
+                posix_swear(g.canvas[i] == canvas[i], "frame %d pixel %d: "
+                    "0x%08X != 0x%08X", k, i, g.canvas[i], canvas[i]);
+            }
+        }
+    }
+    posix_swear(ui_gif.memory(&g) >= (int64_t)sizeof(g) + n * 4);
+    ui_gif.dispose(&g);
+    // truncated or corrupt data fails or is tolerated but never crashes:
+    for (int32_t i = 0; i < bytes; i += i < 100 ? 1 : 7) {
+        const int r = ui_gif.init(&g, data, i);
+        for (int32_t k = 0; k < 7 && r == 0 && ui_gif.next(&g) == 0; k++) { }
+        ui_gif.dispose(&g);
+    }
+    for (int32_t i = 0; i < 256; i++) {
+        uint8_t copy[sizeof(data)];
+        memcpy(copy, data, (size_t)bytes);
+        copy[posix_num.random32(&seed) % (uint32_t)bytes] ^=
+            (uint8_t)(1 + posix_num.random32(&seed) % 255);
+        if (ui_gif.init(&g, copy, bytes) == 0) {
+            for (int32_t k = 0; k < 7 && ui_gif.next(&g) == 0; k++) { }
+        }
+        ui_gif.dispose(&g);
+    }
+    posix_swear(ui_gif.init(&g, "GIF", 3) == EINVAL);
+}
+
+static void ui_gif_test_dictionary(void) {
+    // 64 x 64 noise overflows 4096 entries of LZW dictionary
+    static struct ui_gif_test_frame f[1] = {
+        { 0, 0, 64, 64, 0, 10, -1, 0, false }
+    };
+    uint32_t seed = 2;
+    for (int32_t i = 0; i < 64 * 64; i++) {
+        f[0].ix[i] = (uint8_t)(posix_num.random32(&seed) % 16);
+    }
+    static uint8_t data[16 * 1024];
+    const int32_t bytes = ui_gif_test_encode(data, 64, 64, f, 1);
+    posix_swear(bytes <= posix_countof(data));
+    struct ui_gif g = {0};
+    posix_swear(ui_gif.init(&g, data, bytes) == 0);
+    posix_swear(ui_gif.next(&g) == 0);
+    for (int32_t i = 0; i < 64 * 64; i++) {
+        uint8_t rgb[3];
+        ui_gif_test_rgb(rgb, f[0].ix[i], 0);
+        posix_swear(g.canvas[i] == (0xFF000000u | (uint32_t)rgb[2] << 16 |
+                                    (uint32_t)rgb[1] << 8 | rgb[0]));
+    }
+    posix_swear(ui_gif.next(&g) == 0 && g.index == 0 && g.frames == 1);
+    ui_gif.dispose(&g);
+}
+
+static void ui_gif_test(void) {
+    ui_gif_test_frames();
+    ui_gif_test_dictionary();
+    if (posix_debug.verbosity.level > posix_debug.verbosity.quiet) {
+        posix_println("done");
+    }
+}
+
+struct ui_gif_if ui_gif = {
+    .init    = ui_gif_init,
+    .next    = ui_gif_next,
+    .memory  = ui_gif_memory,
+    .dispose = ui_gif_dispose,
+    .test    = ui_gif_test
+};
+
+#ifdef UI_GIF_TEST
+    posix_static_init(ui_gif) { ui_gif.test(); }
+#endif
@@ -14,6 +14,8 @@ static fp64_t ui_image_scale(struct ui_image* iv) {
     } else if (iv->fill && iv->w > 0 && iv->h > 0) {
         return (fp64_t)iv->w / iv->image.w > (fp64_t)iv->h / iv->image.h ?
                 (fp64_t)iv->w / iv->image.w : (fp64_t)iv->h / iv->image.h;
+    } else if (iv->zs > 0) {
+        return iv->zs;
     } else {
         return ui_image_scale_of(iv->zn, iv->zd);
     }
@@ -36,49 +38,194 @@ static struct ui_rect ui_image_position(struct ui_image* iv) {
     return rc;
 }
 
+static void ui_image_premultiplied_clamp(struct ui_bitmap* b) {
+    // Lanczos ringing may produce color > alpha for premultiplied
+    // pixels which would be blended as brighter than opaque
+    for (int32_t y = 0; y < b->h; y++) {
+        uint8_t* p = (uint8_t*)b->pixels + (int64_t)y * b->stride;
+        for (int32_t x = 0; x < b->w; x++) {
+            const uint8_t a = p[3];
+            if (p[0] > a) { p[0] = a; }
+            if (p[1] > a) { p[1] = a; }
+            if (p[2] > a) { p[2] = a; }
+            p += 4;
+        }
+    }
+}
+
+static void ui_image_resample(struct ui_image* iv, fp64_t s,
+        struct ui_rect rc, struct ui_rect vis) {
+    // vis: visible part of the zoomed image rc in zoomed image coordinates
+    struct ui_bitmap* b = &iv->cache.bitmap;
+    const bool hit = iv->cache.pixels == iv->image.pixels &&
+        iv->cache.w == iv->image.w && iv->cache.h == iv->image.h &&
+        iv->cache.scale == s && iv->cache.filter == iv->filter &&
+        b->bpp == iv->image.bpp && b->pixels != null &&
+        iv->cache.x <= vis.x && vis.x + vis.w <= iv->cache.x + b->w &&
+        iv->cache.y <= vis.y && vis.y + vis.h <= iv->cache.y + b->h;
+    if (!hit) {
+        // margin of 1/4 of the visible part on each side for panning
+        const int32_t mx = vis.w / 4;
+        const int32_t my = vis.h / 4;
+        const int32_t x0 = posix_max(0, vis.x - mx);
+        const int32_t y0 = posix_max(0, vis.y - my);
+        const int32_t x1 = posix_min(rc.w, vis.x + vis.w + mx);
+        const int32_t y1 = posix_min(rc.h, vis.y + vis.h + my);
+        const int32_t bpp = iv->image.bpp;
+        const int32_t stride = ((x1 - x0) * bpp + 3) & ~3;
+        const int64_t bytes = (int64_t)stride * (y1 - y0);
+        if (b->pixels == null || bytes != (int64_t)b->stride * b->h) {
+            posix_fatal_if(posix_heap.realloc(&b->pixels, bytes) != 0);
+        }
+        b->w = x1 - x0;
+        b->h = y1 - y0;
+        b->bpp = bpp;
+        b->stride = stride;
+        ui_resample.scale(b, &iv->image, x0, y0, s, iv->filter);
+        if (iv->image.texture != null && bpp == 4) {
+            ui_image_premultiplied_clamp(b);
+        }
+        dxd_bitmap_dispose(&b->dxd); // pixels changed
+        iv->cache.pixels = iv->image.pixels;
+        iv->cache.w = iv->image.w;
+        iv->cache.h = iv->image.h;
+        iv->cache.x = x0;
+        iv->cache.y = y0;
+        iv->cache.scale = s;
+        iv->cache.filter = iv->filter;
+    }
+}
+
+static void ui_image_draw(struct ui_image* iv, struct ui_rect rc,
+        int32_t ix, int32_t iy, int32_t iw, int32_t ih,
+        struct ui_bitmap* image, bool texture) {
+    // draws (ix, iy, iw, ih) part of the image into rc
+    if (image->bpp == 1) {
+        ui_draw.greyscale(rc.x, rc.y, rc.w, rc.h, ix, iy, iw, ih,
+            image->w, image->h, image->stride, image->pixels);
+    } else if (image->bpp == 3) {
+        ui_draw.bgr(rc.x, rc.y, rc.w, rc.h, ix, iy, iw, ih,
+            image->w, image->h, image->stride, image->pixels);
+    } else if (image->bpp == 4) {
+        if (!texture) {
+            ui_draw.bgrx(rc.x, rc.y, rc.w, rc.h, ix, iy, iw, ih,
+                image->w, image->h, image->stride, image->pixels);
+        } else {
+            ui_draw.alpha(rc.x, rc.y, rc.w, rc.h, ix, iy, iw, ih,
+                          image, iv->alpha);
+        }
+    } else {
+        // Unsupported bpp -- log once and skip painting the image
+        // rather than crashing the whole UI.
+        static bool warned;
+        if (!warned) {
+            posix_println("ui_image: unsupported bpp=%d", image->bpp);
+            warned = true;
+        }
+    }
+}
+
+enum { ui_image_mipmap_pixels = 16 * 1024 * 1024 }; // 4K and above
+
+static const int64_t ui_image_mipmap_budget = 256LL * 1024 * 1024;
+
+static void ui_image_mipmap_ready(struct ui_mipmap* posix_unused(m)) {
+    ui_app.request_redraw(); // called on background thread
+}
+
+static bool ui_image_mipmapped(struct ui_image* iv, fp64_t s) {
+    return s <= 0.5 && iv->image.bpp != 2 && iv->image.bpp <= 4 &&
+           (int64_t)iv->image.w * iv->image.h >= ui_image_mipmap_pixels;
+}
+
+static void ui_image_draw_tile(struct ui_image* iv, struct ui_rect rc,
+        int32_t ix, int32_t iy, int32_t iw, int32_t ih,
+        struct ui_bitmap* b, bool texture) {
+    ui_image_draw(iv, rc, ix, iy, iw, ih, b, texture);
+    if (b->dxd != null) { dxd_bitmap_dispose(&b->dxd); }
+}
+
+static void ui_image_paint_tiles(struct ui_image* iv, fp64_t s,
+        struct ui_rect rc, struct ui_rect vis) {
+    // vis: visible part of the zoomed image rc in zoomed image coordinates
+    struct ui_mipmap* m = &iv->mipmap;
+    if (m->levels == 0 || m->image.pixels != iv->image.pixels ||
+        m->image.w != iv->image.w || m->image.h != iv->image.h) {
+        if (m->levels > 0) { ui_mipmap.dispose(m); }
+        ui_mipmap.init(m, &iv->image, ui_image_mipmap_budget);
+        m->ready = ui_image_mipmap_ready;
+        m->that  = iv;
+    }
+    const bool texture = iv->image.texture != null;
+    const int32_t n = ui_mipmap_tile;
+    const int32_t l = ui_mipmap.level(m, s);
+    const fp64_t k = s * (fp64_t)(1LL << l); // level pixel -> zoomed pixels
+    const int32_t x0 = (int32_t)(vis.x / k);
+    const int32_t y0 = (int32_t)(vis.y / k);
+    const int32_t x1 = posix_min(m->w[l], (int32_t)((vis.x + vis.w) / k) + 1);
+    const int32_t y1 = posix_min(m->h[l], (int32_t)((vis.y + vis.h) / k) + 1);
+    ui_mipmap.lock(m);
+    for (int32_t ty = y0 / n; ty <= (y1 - 1) / n; ty++) {
+        for (int32_t tx = x0 / n; tx <= (x1 - 1) / n; tx++) {
+            // tile edges rounded in zoomed coordinates: no seams
+            const int32_t tw = posix_min(n, m->w[l] - tx * n);
+            const int32_t th = posix_min(n, m->h[l] - ty * n);
+            const int32_t dx = (int32_t)(tx * n * k + 0.5);
+            const int32_t dy = (int32_t)(ty * n * k + 0.5);
+            const struct ui_rect d = { rc.x + dx, rc.y + dy,
+                (int32_t)((tx * n + tw) * k + 0.5) - dx,
+                (int32_t)((ty * n + th) * k + 0.5) - dy };
+            struct ui_bitmap b = ui_mipmap.tile(m, l, tx, ty);
+            if (b.pixels != null) {
+                ui_image_draw_tile(iv, d, 0, 0, b.w, b.h, &b, texture);
+            } else {
+                // part of the nearest coarser tile built so far
+                for (int32_t a = l + 1; a < m->levels; a++) {
+                    const int32_t sh = a - l;
+                    b = ui_mipmap.cached(m, a, tx >> sh, ty >> sh);
+                    if (b.pixels != null) {
+                        const int32_t ix = ((tx * n) >> sh) - (tx >> sh) * n;
+                        const int32_t iy = ((ty * n) >> sh) - (ty >> sh) * n;
+                        const int32_t iw = posix_max(1, posix_min(tw >> sh, b.w - ix));
+                        const int32_t ih = posix_max(1, posix_min(th >> sh, b.h - iy));
+                        ui_image_draw_tile(iv, d, ix, iy, iw, ih, &b, texture);
+                        break;
+                    }
+                }
+            }
+        }
+    }
+    ui_mipmap.unlock(m);
+}
+
 static void ui_image_paint(struct ui_view* v) {
     struct ui_image* iv = (struct ui_image*)v;
 //  ui_draw.fill(v->x, v->y, v->w, v->h, ui_colors.black);
     if (iv->image.pixels != null) {
         ui_draw.set_clip(v->x, v->y, v->w, v->h);
         posix_swear(!iv->fit || !iv->fill, "make up your mind");
-        posix_swear(0 < iv->zn && iv->zn <= 16);
-        posix_swear(0 < iv->zd && iv->zd <= 16);
-        // only 1:2 and 2:1 etc are supported:
-        if (iv->zn != 1) { posix_swear(iv->zd == 1); }
-        if (iv->zd != 1) { posix_swear(iv->zn == 1); }
         const int32_t iw = iv->image.w;
         const int32_t ih = iv->image.h;
+        const bool texture = iv->image.texture != null;
+        const fp64_t s = ui_image.scale(iv);
         struct ui_rect rc = ui_image_position(iv);
-        if (iv->image.bpp == 1) {
-            ui_draw.greyscale(rc.x, rc.y, rc.w, rc.h,
-                0, 0, iw, ih,
-                iw, ih, iv->image.stride,
-                iv->image.pixels);
-        } else if (iv->image.bpp == 3) {
-            ui_draw.bgr(rc.x, rc.y, rc.w, rc.h,
-                         0, 0, iw, ih,
-                         iw, ih, iv->image.stride,
-                         iv->image.pixels);
-        } else if (iv->image.bpp == 4) {
-            if (iv->image.texture == null) {
-                ui_draw.bgrx(rc.x, rc.y, rc.w, rc.h,
-                              0, 0, iw, ih,
-                              iw, ih, iv->image.stride,
-                              iv->image.pixels);
-            } else {
-                ui_draw.alpha(rc.x, rc.y, rc.w, rc.h,
-                              0, 0, iw, ih,
-                              &iv->image, iv->alpha);
-            }
-        } else {
-            // Unsupported bpp -- log once and skip painting the image
-            // rather than crashing the whole UI.
-            static bool warned;
-            if (!warned) {
-                posix_println("ui_image: unsupported bpp=%d", iv->image.bpp);
-                warned = true;
-            }
+        // visible part of zoomed image in view coordinates:
+        const int32_t x0 = posix_max(v->x, rc.x);
+        const int32_t y0 = posix_max(v->y, rc.y);
+        const int32_t x1 = posix_min(v->x + v->w, rc.x + rc.w);
+        const int32_t y1 = posix_min(v->y + v->h, rc.y + rc.h);
+        if (s == 1.0 || iv->image.bpp == 2 || iv->image.bpp > 4) {
+            ui_image_draw(iv, rc, 0, 0, iw, ih, &iv->image, texture);
+        } else if (x0 < x1 && y0 < y1 && ui_image_mipmapped(iv, s)) {
+            const struct ui_rect vis = { x0 - rc.x, y0 - rc.y, x1 - x0, y1 - y0 };
+            ui_image_paint_tiles(iv, s, rc, vis);
+        } else if (x0 < x1 && y0 < y1) {
+            const struct ui_rect vis = { x0 - rc.x, y0 - rc.y, x1 - x0, y1 - y0 };
+            ui_image_resample(iv, s, rc, vis);
+            const int32_t cx = vis.x - iv->cache.x;
+            const int32_t cy = vis.y - iv->cache.y;
+            ui_image_draw(iv, (struct ui_rect){ x0, y0, vis.w, vis.h },
+                          cx, cy, vis.w, vis.h, &iv->cache.bitmap, texture);
         }
         if (ui_view.has_focus(v)) {
             ui_color_t highlight = ui_colors.get_color(ui_color_id_highlight);
@@ -169,6 +316,7 @@ static void ui_image_focus_gained(struct ui_view* v) {
 static void ui_image_zoomed(struct ui_image* iv) {
     iv->fill = false;
     iv->fit  = false;
+    iv->zs   = 0;
     // 0=16:1 1=8:1 2=4:1 3=2:1 4=1:1 5=1:2 6=1:4 7=1:8 8=1:16
     int32_t n  = iv->zoom - 4;
     int32_t zn = iv->zn;
@@ -484,6 +632,7 @@ void ui_image_init(struct ui_image* iv) {
     iv->zoom = 4;
     iv->zn = 1;
     iv->zd = 1;
+    iv->filter = ui_resample_lanczos3;
     iv->sx = 0.5;
     iv->sy = 0.5;
     iv->drag_start = (struct ui_point){-1, -1};
@@ -509,15 +658,39 @@ static void ui_image_ratio(struct ui_image* iv, int32_t zn, int32_t zd) {
     if (zd != 1) { posix_swear(zn == 1); }
     iv->zn = zn;
     iv->zd = zd;
+    iv->zs = 0;
+    iv->fit  = false;
+    iv->fill = false;
+}
+
+static void ui_image_zoom(struct ui_image* iv, fp64_t scale) {
+    posix_swear(scale > 0);
+    iv->zs = scale;
     iv->fit  = false;
     iv->fill = false;
+    if (scale > 1) {
+        ui_view.set_text(&iv->tool.ratio, "1:%.3f", scale);
+    } else {
+        ui_view.set_text(&iv->tool.ratio, "%.3f:1", 1.0 / scale);
+    }
+    ui_view.invalidate(&iv->view, null);
+}
+
+static void ui_image_dispose(struct ui_image* iv) {
+    struct ui_bitmap* b = &iv->cache.bitmap;
+    dxd_bitmap_dispose(&b->dxd);
+    if (b->pixels != null) { posix_heap.free(b->pixels); }
+    memset(&iv->cache, 0x00, sizeof(iv->cache));
+    if (iv->mipmap.levels > 0) { ui_mipmap.dispose(&iv->mipmap); }
 }
 
 struct ui_image_if ui_image = {
     .init      = ui_image_init,
     .init_with = ui_image_init_with,
     .ratio     = ui_image_ratio,
+    .zoom      = ui_image_zoom,
     .scale     = ui_image_scale,
-    .position  = ui_image_position
+    .position  = ui_image_position,
+    .dispose   = ui_image_dispose
 };
 
@@ -0,0 +1,1262 @@
+/* Copyright (c) Dmitry "Leo" Kuznetsov 2021-24 see LICENSE for details */
+#include "posix/posix.h"
+#include "ui/ui_glyphs.h"
+#include "ui/ui_core.h"
+#include "ui/ui_colors.h"
+#include "ui/ui_draw.h"
+#include "ui/ui_view.h"
+#include "ui/ui_nodes.h"
+#include "ui/ui_layout.h"
+
+#undef UI_LAYOUT_TEST
+
+#if 0 // flip to 1 to run tests
+#define UI_LAYOUT_TEST
+#endif
+
+static bool ui_layout_debug;
+
+#pragma push_macro("debugln")
+#pragma push_macro("ui_layout_dump")
+#pragma push_macro("ui_layout_enter")
+#pragma push_macro("ui_layout_exit")
+
+// Usage of: ui_view_for_each_begin(p, c) { ... } ui_view_for_each_end(p, c)
+// makes code inside iterator debugger friendly and ensures correct __LINE__
+
+#define debugln(...) do {                                   \
+    if (ui_layout_debug) {  posix_println(__VA_ARGS__); }  \
+} while (0)
+
+static int32_t ui_layout_nesting;
+
+#define ui_layout_enter(v) do {                                         \
+    struct ui_ltrb i_ = ui_layout_margins(v, &v->insets);                    \
+    struct ui_ltrb p_ = ui_layout_margins(v, &v->padding);                   \
+    debugln("%*c> %4d,%-4d %4dx%-4d p: %d %d %d %d i: %d %d %d %d %s",  \
+            ui_layout_nesting, 0x20,                                    \
+            v->x, v->y, v->w, v->h,                                     \
+            p_.left, p_.top, p_.right, p_.bottom,                       \
+            i_.left, i_.top, i_.right, i_.bottom,                       \
+            ui_view_debug_id(v));                                       \
+    ui_layout_nesting += 4;                                             \
+} while (0)
+
+#define ui_layout_exit(v) do {                                          \
+    ui_layout_nesting -= 4;                                             \
+    debugln("%*c< %4d,%-4d %4dx%-4d %s",                                \
+            ui_layout_nesting, 0x20,                                    \
+            v->x, v->y, v->w, v->h, ui_view_debug_id(v));               \
+} while (0)
+
+#define ui_layout_clild(v) do {                                         \
+    debugln("%*c %4d,%-4d %4dx%-4d %s", ui_layout_nesting, 0x20,        \
+            c->x, c->y, c->w, c->h, ui_view_debug_id(v));               \
+} while (0)
+
+static const char* ui_stack_finite_int(int32_t v, char* text, int32_t count) {
+    posix_swear(v >= 0);
+    if (v == ui_infinity) {
+        posix_str.format(text, count, "%s", ui_glyph_infinity);
+    } else {
+        posix_str.format(text, count, "%d", v);
+    }
+    return text;
+}
+
+#define ui_layout_dump(v) do {                                                \
+    char maxw[32];                                                            \
+    char maxh[32];                                                            \
+    debugln("%s[%4.4s] %4d,%-4d %4dx%-4d, max[%sx%s] "                        \
+        "padding { %.3f %.3f %.3f %.3f } "                                    \
+        "insets { %.3f %.3f %.3f %.3f } align: 0x%02X",                       \
+        ui_view_debug_id(v),                                                  \
+        &v->type, v->x, v->y, v->w, v->h,                                     \
+        ui_stack_finite_int(v->max_w, maxw, posix_countof(maxw)),                \
+        ui_stack_finite_int(v->max_h, maxh, posix_countof(maxh)),                \
+        v->padding.left, v->padding.top, v->padding.right, v->padding.bottom, \
+        v->insets.left, v->insets.top, v->insets.right, v->insets.bottom,     \
+        v->align);                                                            \
+} while (0)
+
+// default pluggable fixed pitch text and font metrics:
+
+static struct ui_fm ui_layout_fixed_fm = { // 8x16 pixels cell
+    .em = { .w = 8, .h = 16 },
+    .height = 16, .baseline = 13, .ascent = 13, .descent = 3,
+    .x_height = 7, .cap_em_height = 10,
+    .average_char_width = 8, .max_char_width = 8,
+    .mono = true
+};
+
+static int32_t ui_layout_fixed_lines(int32_t glyphs, int32_t cw, int32_t w,
+        int32_t *width) {
+    int32_t lines = 1;
+    *width = glyphs * cw;
+    if (w > 0 && *width > w) { // wrap at glyph boundaries
+        const int32_t per_line = w / cw > 0 ? w / cw : 1;
+        lines  = (glyphs + per_line - 1) / per_line;
+        *width = per_line * cw;
+    }
+    return lines;
+}
+
+static struct ui_wh ui_layout_fixed_text_metrics(const struct ui_fm* fm,
+        bool multiline, int32_t w, const char* s) {
+    const int32_t cw = fm->average_char_width > 0 ?
+                       fm->average_char_width : fm->em.w;
+    struct ui_wh wh = { .w = 0, .h = 0 };
+    const char* line = s;
+    for (;;) {
+        const char* eol = multiline ? strchr(line, '\n') : null;
+        const int32_t bytes = eol != null ?
+            (int32_t)(eol - line) : (int32_t)strlen(line);
+        int32_t glyphs = posix_str.glyphs(line, bytes);
+        if (glyphs < 0) { glyphs = bytes; } // invalid utf8
+        int32_t width = 0;
+        wh.h += ui_layout_fixed_lines(glyphs, cw, w, &width) * fm->height;
+        wh.w  = wh.w > width ? wh.w : width;
+        if (eol == null) { break; }
+        line = eol + 1;
+    }
+    return wh;
+}
+
+static const char* ui_layout_string(struct ui_view* v) {
+    if (v->p.strid == 0) {
+        int32_t id = posix_nls.strid(v->p.text);
+        v->p.strid = id > 0 ? id : -1;
+    }
+    return v->p.strid < 0 ? v->p.text : // not localized
+        posix_nls.string(v->p.strid, v->p.text);
+}
+
+static bool ui_layout_is_orphan(const struct ui_view* v) {
+    while (v != ui_layout.root && v != null) { v = v->parent; }
+    return v == null;
+}
+
+// Inside of measure() and layout() passes hidden state of ancestors
+// is memoized in ui_layout.nodes instead of walking up to the root
+// for each view (quadratic for deep trees). .state.hidden of the view
+// itself is always read. Hooks (prepare, measured, composed and
+// measure() layout() of views with children) may hide or show
+// descendants thus memoized state is discarded after they return.
+
+static struct ui_nodes ui_layout_nodes;
+
+static uint32_t ui_layout_pass = 1;  // of memoized hidden, 0 is never valid
+static int32_t  ui_layout_depth;     // nesting of measure() and layout()
+
+static void ui_layout_hooked(void) {
+    ui_layout_pass++;
+    if (ui_layout_pass == 0) { ui_layout_pass = 1; } // overflow
+}
+
+static void ui_layout_begin(void) {
+    if (ui_layout_depth == 0) {
+        ui_nodes.update(&ui_layout_nodes, ui_layout.root);
+        ui_layout_hooked();
+    }
+    ui_layout_depth++;
+}
+
+static void ui_layout_end(void) {
+    posix_assert(ui_layout_depth > 0);
+    ui_layout_depth--;
+}
+
+static bool ui_layout_is_hidden(const struct ui_view* v) {
+    const int32_t ix = ui_layout_depth > 0 ?
+        ui_nodes.index_of(&ui_layout_nodes, v) : -1;
+    if (ix >= 0) {
+        const int32_t p = ui_layout_nodes.parent[ix];
+        return v->state.hidden ||
+            (p >= 0 && ui_nodes.is_hidden(&ui_layout_nodes, p, ui_layout_pass));
+    }
+    // single walk up: hidden if any ancestor is hidden or v is an orphan
+    bool hidden = false;
+    bool orphan = true;
+    while (v != null && !hidden) {
+        hidden = v->state.hidden;
+        if (v == ui_layout.root) { orphan = false; }
+        v = v->parent;
+    }
+    return hidden || orphan;
+}
+
+static struct ui_ltrb ui_layout_margins(const struct ui_view* v, const struct ui_margins* m) {
+    const fp64_t gw = (fp64_t)m->left + (fp64_t)m->right;
+    const fp64_t gh = (fp64_t)m->top  + (fp64_t)m->bottom;
+    const struct ui_fm* fm = v->fm != null ? v->fm : ui_layout.fm;
+    const struct ui_wh* em = &fm->em;
+    const int32_t em_w = (int32_t)(em->w * gw + 0.5);
+    const int32_t em_h = (int32_t)(em->h * gh + 0.5);
+    const int32_t left = (int32_t)((fp64_t)em->w * (fp64_t)m->left + 0.5);
+    const int32_t top  = (int32_t)((fp64_t)em->h * (fp64_t)m->top  + 0.5);
+    return (struct ui_ltrb) {
+        .left   = left,         .top    = top,
+        .right  = em_w - left,  .bottom = em_h - top
+    };
+}
+
+static void ui_layout_inbox(const struct ui_view* v, struct ui_rect* r, struct ui_ltrb* insets) {
+    posix_swear(r != null || insets != null);
+    posix_swear(v->max_w >= 0 && v->max_h >= 0);
+    const struct ui_ltrb i = ui_layout_margins(v, &v->insets);
+    if (insets != null) { *insets = i; }
+    if (r != null) {
+        *r = (struct ui_rect) {
+            .x = v->x + i.left,
+            .y = v->y + i.top,
+            .w = v->w - i.left - i.right,
+            .h = v->h - i.top  - i.bottom,
+        };
+    }
+}
+
+static void ui_layout_outbox(const struct ui_view* v, struct ui_rect* r, struct ui_ltrb* padding) {
+    posix_swear(r != null || padding != null);
+    posix_swear(v->max_w >= 0 && v->max_h >= 0);
+    const struct ui_ltrb p = ui_layout_margins(v, &v->padding);
+    if (padding != null) { *padding = p; }
+    if (r != null) {
+//      posix_println("%s %d,%d %dx%d %.1f %.1f %.1f %.1f", v->p.text,
+//          v->x, v->y, v->w, v->h,
+//          v->padding.left, v->padding.top, v->padding.right, v->padding.bottom);
+        *r = (struct ui_rect) {
+            .x = v->x - p.left,
+            .y = v->y - p.top,
+            .w = v->w + p.left + p.right,
+            .h = v->h + p.top  + p.bottom,
+        };
+//      posix_println("%s %d,%d %dx%d", v->p.text,
+//          r->x, r->y, r->w, r->h);
+    }
+}
+
+static void ui_layout_text_measure(struct ui_view* v, const char* s,
+        struct ui_view_text_metrics* tm) {
+    const struct ui_fm* fm = v->fm;
+    tm->wh = (struct ui_wh){ .w = 0, .h = fm->height };
+    if (s[0] == 0) {
+        tm->multiline = false;
+    } else {
+        tm->multiline = strchr(s, '\n') != null;
+        if (v->type == ui_view_label && tm->multiline) {
+            int32_t w = (int32_t)((fp64_t)v->min_w_em * (fp64_t)fm->em.w + 0.5);
+            tm->wh = ui_layout.text_metrics(fm, true,  w, s);
+        } else {
+            tm->wh = ui_layout.text_metrics(fm, false, 0, s);
+        }
+    }
+}
+
+static void ui_layout_text_align(struct ui_view* v, struct ui_view_text_metrics* tm) {
+    tm->xy = (struct ui_point){ .x = -1, .y = -1 };
+    const struct ui_ltrb i = ui_layout_margins(v, &v->insets);
+    // i_wh the inside insets w x h:
+    const struct ui_wh i_wh = { .w = v->w - i.left - i.right,
+                           .h = v->h - i.top - i.bottom };
+    const int32_t h_align = v->text_align & ~(ui_align_top|ui_align_bottom);
+    const int32_t v_align = v->text_align & ~(ui_align_left|ui_align_right);
+    tm->xy.x = i.left + (i_wh.w - tm->wh.w + 1) / 2;
+    if (h_align & ui_align_left) {
+        tm->xy.x = i.left;
+    } else if (h_align & ui_align_right) {
+        tm->xy.x = i_wh.w - tm->wh.w - i.right;
+    }
+    // vertical centering is trickier.
+    // mt.h is height of all measured lines of text
+    tm->xy.y = i.top + (i_wh.h - tm->wh.h + 1) / 2;
+    if (v_align & ui_align_top) {
+        tm->xy.y = i.top;
+    } else if (v_align & ui_align_bottom) {
+        tm->xy.y = i_wh.h - tm->wh.h - i.bottom;
+    } else if (!tm->multiline) {
+#if 0 // TODO: doesn't look good or right:
+        // UI controls should have x-height line in the dead center
+        // of the control to be visually balanced.
+        // y offset of "x-line" of the glyph:
+        const struct ui_fm* fm = v->fm;
+        const int32_t y_of_x_line = fm->baseline - fm->x_height;
+        // `dy` offset of the center to x-line (middle of glyph cell)
+        const int32_t dy = tm->wh.h / 2 - y_of_x_line;
+        tm->xy.y += dy / 2;
+        if (v->debug.trace.mt) {
+            posix_println(" x-line: %d mt.h: %d mt.h / 2 - x_line: %d",
+                      y_of_x_line, tm->wh.h, dy);
+        }
+#endif
+    }
+}
+
+static void ui_layout_measure_control(struct ui_view* v) {
+    v->p.strid = 0;
+    const char* s = ui_layout_string(v);
+    const struct ui_fm* fm = v->fm;
+    const struct ui_ltrb i = ui_layout_margins(v, &v->insets);
+    v->w = (int32_t)((fp64_t)fm->em.w * (fp64_t)v->min_w_em + 0.5);
+    v->h = (int32_t)((fp64_t)fm->em.h * (fp64_t)v->min_h_em + 0.5);
+    if (v->debug.trace.mt) {
+        const struct ui_ltrb p = ui_layout_margins(v, &v->padding);
+        posix_println(">%dx%d em: %dx%d min: %.3fx%.3f "
+                "i: %d %d %d %d p: %d %d %d %d %s \"%.*s\"",
+            v->w, v->h, fm->em.w, fm->em.h, v->min_w_em, v->min_h_em,
+            i.left, i.top, i.right, i.bottom,
+            p.left, p.top, p.right, p.bottom,
+            ui_view_debug_id(v),
+            (64 < strlen(s) ? 64 : strlen(s)), s);
+        const struct ui_margins in = v->insets;
+        const struct ui_margins pd = v->padding;
+        posix_println(" i: %.3f %.3f %.3f %.3f l+r: %.3f t+b: %.3f"
+                " p: %.3f %.3f %.3f %.3f l+r: %.3f t+b: %.3f",
+            in.left, in.top, in.right, in.bottom,
+            in.left + in.right, in.top + in.bottom,
+            pd.left, pd.top, pd.right, pd.bottom,
+            pd.left + pd.right, pd.top + pd.bottom);
+    }
+    ui_layout_text_measure(v, s, &v->text);
+    if (v->debug.trace.mt) {
+        posix_println(" mt: %d %d", v->text.wh.w, v->text.wh.h);
+    }
+    v->w = v->w > i.left + v->text.wh.w + i.right ? v->w : i.left + v->text.wh.w + i.right;
+    v->h = v->h > i.top  + v->text.wh.h + i.bottom ? v->h : i.top  + v->text.wh.h + i.bottom;
+    ui_layout_text_align(v, &v->text);
+    if (v->debug.trace.mt) {
+        posix_println("<%dx%d text_align x,y: %d,%d %s",
+                v->w, v->h, v->text.xy.x, v->text.xy.y,
+                ui_view_debug_id(v));
+    }
+}
+
+static void ui_layout_measure(struct ui_view* v);
+static void ui_layout_layout(struct ui_view* v);
+
+static void ui_layout_measure_children(struct ui_view* v) {
+    if (!ui_layout_is_hidden(v)) {
+        ui_view_for_each(v, c, { ui_layout_measure(c); });
+    }
+}
+
+// Incremental measure() and layout():
+// measured size of a view is a function of its attributes (key),
+// text and measured sizes of its children. Views that are changed
+// via ui_view API (set_text(), add(), remove()) are marked dirty()
+// together with all their ancestors. measure() of a clean pure
+// subtree with unchanged key restores cached .w .h in O(1) and
+// layout() of it is skipped when it is laid out at the same rect.
+// Text change of a single label in a large tree costs measure()
+// of the label and its ancestors chain (plus their siblings that
+// are restored from cache) instead of the whole tree.
+// Anything else (fonts, dpi, theme, direct changes to .state.hidden
+// of a descendant) is covered by ui_app.request_layout() that calls
+// ui_view.dirty_all().
+
+static int32_t ui_layout_generation = 1; // 0 is never valid
+
+static void ui_layout_dirty(struct ui_view* v) {
+    while (v != null) { v->p.dirty = true; v = v->parent; }
+}
+
+static void ui_layout_dirty_all(void) {
+    ui_layout_generation++;
+    if (ui_layout_generation <= 0) { ui_layout_generation = 1; } // overflow
+}
+
+static bool ui_layout_is_pure(const struct ui_view* v) {
+    return v->prepare == null && v->measured == null &&
+           v->composed == null &&
+          (v->measure == null || v->measure == ui_layout_measure ||
+           v->measure == v->p.measure) &&
+          (v->layout  == null || v->layout  == ui_layout_layout  ||
+           v->layout  == v->p.layout);
+}
+
+static void ui_layout_measure_key(const struct ui_view* v,
+        struct ui_view_measure_key* k) {
+    memset(k, 0x00, sizeof(*k)); // memcmp() compares padding too
+    k->fm         = v->fm;
+    k->em         = v->fm != null ? v->fm->em : (struct ui_wh){0};
+    k->insets     = v->insets;
+    k->padding    = v->padding;
+    k->min_w_em   = v->min_w_em;
+    k->min_h_em   = v->min_h_em;
+    k->max_w      = v->max_w;
+    k->max_h      = v->max_h;
+    k->text_align = v->text_align;
+    k->icon       = v->icon;
+}
+
+static void ui_layout_measure(struct ui_view* v) {
+    ui_layout_begin();
+    if (!ui_layout_is_hidden(v)) {
+        struct ui_view_measure_key key;
+        ui_layout_measure_key(v, &key);
+        if (v->p.pure && !v->p.dirty &&
+            v->p.generation == ui_layout_generation &&
+            memcmp(&v->p.key, &key, sizeof(key)) == 0) {
+            v->w = v->p.measured.w;
+            v->h = v->p.measured.h;
+        } else {
+            ui_layout_measure_children(v);
+            if (v->prepare != null) { v->prepare(v); ui_layout_hooked(); }
+            if (v->measure != null && v->measure != ui_layout_measure) {
+                v->measure(v);
+                if (v->child != null && v->measure != v->p.measure) {
+                    ui_layout_hooked();
+                }
+            } else {
+                ui_layout_measure_control(v);
+            }
+            if (v->measured != null) { v->measured(v); ui_layout_hooked(); }
+            bool pure = ui_layout_is_pure(v);
+            ui_view_for_each(v, c, {
+                // parent measure() may adjust children (e.g. spacers)
+                c->p.sized = (struct ui_wh){ .w = c->w, .h = c->h };
+                if (!c->state.hidden) { pure = pure && c->p.pure; }
+            });
+            v->p.key = key;
+            v->p.measured = (struct ui_wh){ .w = v->w, .h = v->h };
+            v->p.pure = pure;
+            v->p.dirty = false;
+            v->p.relayout = true;
+            v->p.generation = ui_layout_generation;
+        }
+    }
+    ui_layout_end();
+}
+
+static void ui_layout_default(struct ui_view* posix_unused(v)) {
+//  struct ui_ltrb i = ui_layout_margins(v, &v->insets);
+//  struct ui_ltrb p = ui_layout_margins(v, &v->padding);
+//  posix_println(">%s %d,%d %dx%d p: %d %d %d %d  i: %d %d %d %d",
+//               v->p.text, v->x, v->y, v->w, v->h,
+//               p.left, p.top, p.right, p.bottom,
+//               i.left, i.top, i.right, i.bottom);
+//  posix_println("<%s %d,%d %dx%d", v->p.text, v->x, v->y, v->w, v->h);
+}
+
+static void ui_layout_layout_children(struct ui_view* v) {
+    if (!ui_layout_is_hidden(v)) {
+        const struct ui_nodes* ns = &ui_layout_nodes;
+        const int32_t ix = ui_nodes.index_of(ns, v);
+        if (ix >= 0) {
+            // children follow first child and next sibling indices;
+            // if layout() of a child added or removed views the rest
+            // of the children is walked via the linked list
+            int32_t k = ns->child[ix];
+            struct ui_view* c = null;
+            while (k >= 0 && ns->valid) {
+                c = ns->view[k];
+                ui_layout_layout(c);
+                k = ns->next[k];
+            }
+            if (k >= 0) { // !ns->valid
+                c = c->next;
+                while (c != v->child) {
+                    ui_layout_layout(c);
+                    c = c->next;
+                }
+            }
+        } else {
+            ui_view_for_each(v, c, { ui_layout_layout(c); });
+        }
+    }
+}
+
+static void ui_layout_layout(struct ui_view* v) {
+//  posix_println(">%s %d,%d %dx%d", v->p.text, v->x, v->y, v->w, v->h);
+    ui_layout_begin();
+    if (!ui_layout_is_hidden(v)) {
+        const struct ui_rect r = { .x = v->x, .y = v->y, .w = v->w, .h = v->h };
+        const bool same = r.x == v->p.laid.x && r.y == v->p.laid.y &&
+                          r.w == v->p.laid.w && r.h == v->p.laid.h;
+        if (v->p.pure && !v->p.relayout && same) {
+            // clean subtree already laid out at the same rect
+        } else {
+            if (v->p.pure && !v->p.relayout) {
+                // measure() was restored from cache: children hold
+                // sizes from previous layout() instead of measured
+                ui_view_for_each(v, c, {
+                    c->w = c->p.sized.w;
+                    c->h = c->p.sized.h;
+                });
+            }
+            if (v->layout != null && v->layout != ui_layout_layout) {
+                v->layout(v);
+                if (v->child != null && v->layout != v->p.layout) {
+                    ui_layout_hooked();
+                }
+            } else {
+                ui_layout_default(v);
+            }
+            if (v->composed != null) { v->composed(v); ui_layout_hooked(); }
+            ui_layout_layout_children(v);
+            v->p.laid = r;
+            v->p.relayout = false;
+        }
+        const int32_t ix = ui_nodes.index_of(&ui_layout_nodes, v);
+        if (ix >= 0) {
+            ui_layout_nodes.rc[ix] = (struct ui_rect){ v->x, v->y, v->w, v->h };
+        }
+    }
+    ui_layout_end();
+//  posix_println("<%s %d,%d %dx%d", v->p.text, v->x, v->y, v->w, v->h);
+}
+
+static void ui_span_measure(struct ui_view* p) {
+    ui_layout_enter(p);
+    posix_swear(p->type == ui_view_span, "type %4.4s 0x%08X", &p->type, p->type);
+    struct ui_ltrb insets;
+    ui_layout_inbox(p, null, &insets);
+    int32_t w = insets.left;
+    int32_t h = 0;
+    int32_t max_w = w;
+    ui_view_for_each_begin(p, c) {
+        posix_swear(c->max_w == 0 || c->max_w >= c->w,
+              "max_w: %d w: %d", c->max_w, c->w);
+        if (ui_layout_is_hidden(c)) {
+            // nothing
+        } else if (c->type == ui_view_spacer) {
+            c->padding = (struct ui_margins){ 0, 0, 0, 0 };
+            c->w = 0; // layout will distribute excess here
+            c->h = 0; // starts with zero
+            max_w = ui_infinity; // spacer make width greedy
+        } else {
+            struct ui_rect cbx; // child "out" box expanded by padding
+            struct ui_ltrb padding;
+            ui_layout_outbox(c, &cbx, &padding);
+            h = h > cbx.h ? h : cbx.h;
+            if (c->max_w == ui_infinity) {
+                max_w = ui_infinity;
+            } else if (max_w < ui_infinity && c->max_w != 0) {
+                posix_swear(c->max_w >= c->w, "c->max_w %d < c->w %d ",
+                      c->max_w, c->w);
+                max_w += c->max_w;
+            } else if (max_w < ui_infinity) {
+                posix_swear(0 <= max_w + cbx.w &&
+                      (int64_t)max_w + (int64_t)cbx.w < (int64_t)ui_infinity,
+                      "max_w:%d + cbx.w:%d = %d", max_w, cbx.w, max_w + cbx.w);
+                max_w += cbx.w;
+            }
+            w += cbx.w;
+        }
+        ui_layout_clild(c);
+    } ui_view_for_each_end(p, c);
+    if (0 < max_w && max_w < ui_infinity) {
+        posix_swear(0 <= max_w + insets.right &&
+              (int64_t)max_w + (int64_t)insets.right < (int64_t)ui_infinity,
+             "max_w:%d + right:%d = %d", max_w, insets.right, max_w + insets.right);
+        max_w += insets.right;
+    }
+    posix_swear(max_w == 0 || max_w >= w, "max_w: %d w: %d", max_w, w);
+    if (ui_layout_is_hidden(p)) {
+        p->w = 0;
+        p->h = 0;
+    } else {
+        p->w = w + insets.right;
+        p->h = insets.top + h + insets.bottom;
+        posix_swear(p->max_w == 0 || p->max_w >= p->w,
+              "max_w: %d is less than actual width: %d", p->max_w, p->w);
+    }
+    ui_layout_exit(p);
+}
+
+// after measure of the subtree is concluded the parent ui_span
+// may adjust span_w wider number depending on it's own width
+// and ui_span.max_w agreement
+
+static int32_t ui_span_place_child(struct ui_view* c, struct ui_rect pbx, int32_t x) {
+    struct ui_ltrb padding = ui_layout_margins(c, &c->padding);
+    // setting child`s max_h to infinity means that child`s height is
+    // *always* fill vertical view size of the parent
+    // childs.h can exceed parent.h (vertical overflow) - is not
+    // encouraged but allowed
+    if (c->max_h == ui_infinity) {
+        // important c->h changed, cbx.h is no longer valid
+        const int32_t h = pbx.h - padding.top - padding.bottom;
+        c->h = c->h > h ? c->h : h;
+    }
+    int32_t min_y = pbx.y + padding.top;
+    if ((c->align & ui_align_top) != 0) {
+        posix_assert(c->align == ui_align_top);
+        c->y = min_y;
+    } else if ((c->align & ui_align_bottom) != 0) {
+        posix_assert(c->align == ui_align_bottom);
+        const int32_t y = pbx.y + pbx.h - c->h - padding.bottom;
+        c->y = min_y > y ? min_y : y;
+    } else { // effective height (c->h might have been changed)
+        posix_assert(c->align == ui_align_center,
+                  "only top, center, bottom alignment for span");
+        const int32_t ch = padding.top + c->h + padding.bottom;
+        const int32_t y = pbx.y + (pbx.h - ch) / 2 + padding.top;
+        c->y = min_y > y ? min_y : y;
+    }
+    c->x = x + padding.left;
+    return c->x + c->w + padding.right;
+}
+
+static void ui_span_layout(struct ui_view* p) {
+    ui_layout_enter(p);
+    posix_swear(p->type == ui_view_span, "type %4.4s 0x%08X", &p->type, p->type);
+    struct ui_rect pbx; // parent "in" box (sans insets)
+    struct ui_ltrb insets;
+    ui_layout_inbox(p, &pbx, &insets);
+    int32_t spacers = 0; // Number of spacers
+    int32_t max_w_count = 0;
+    int32_t x = p->x + insets.left;
+    ui_view_for_each_begin(p, c) {
+        if (!ui_layout_is_hidden(c)) {
+            if (c->type == ui_view_spacer) {
+                c->x = x;
+                c->y = pbx.y;
+                c->h = pbx.h;
+                c->w = 0;
+                spacers++;
+            } else {
+                x = ui_span_place_child(c, pbx, x);
+                posix_swear(c->max_w == 0 || c->max_w >= c->w,
+                      "max_w:%d < w:%d", c->max_w, c->w);
+                if (c->max_w > 0) {
+                    max_w_count++;
+                }
+            }
+            ui_layout_clild(c);
+        }
+    } ui_view_for_each_end(p, c);
+    int32_t xw = 0 > pbx.x + pbx.w - x ? 0 : pbx.x + pbx.w - x; // excess width
+    int32_t max_w_sum = 0;
+    if (xw > 0 && max_w_count > 0) {
+        ui_view_for_each_begin(p, c) {
+            if (!ui_layout_is_hidden(c) && c->type != ui_view_spacer &&
+                 c->max_w > 0) {
+                max_w_sum += (c->max_w < xw ? c->max_w : xw);
+                ui_layout_clild(c);
+            }
+        } ui_view_for_each_end(p, c);
+    }
+    if (xw > 0 && max_w_count > 0) {
+        debugln("%*c pass 2: fill parent", ui_layout_nesting, 0x20);
+        x = p->x + insets.left;
+        int32_t k = 0;
+        ui_view_for_each_begin(p, c) {
+            if (!ui_layout_is_hidden(c)) {
+                struct ui_rect cbx; // child "out" box expanded by padding
+                struct ui_ltrb padding;
+                ui_layout_outbox(c, &cbx, &padding);
+                if (c->type == ui_view_spacer) {
+                    posix_swear(padding.left == 0 && padding.right == 0);
+                } else if (c->max_w > 0) {
+                    const int32_t max_w = c->max_w < xw ? c->max_w : xw;
+                    int64_t proportional = (xw * (int64_t)max_w) / max_w_sum;
+                    posix_assert(proportional <= (int64_t)INT32_MAX);
+                    int32_t cw = (int32_t)proportional;
+                    c->w = c->max_w < c->w + cw ? c->max_w : c->w + cw;
+                    k++;
+                }
+                // TODO: take into account .align of a child and adjust x
+                //       depending on ui_align_left/right/center
+                //       distributing excess width on the left and right of a child
+                c->x = padding.left + x;
+                x = c->x + padding.left + c->w + padding.right;
+                ui_layout_clild(c);
+            }
+        } ui_view_for_each_end(p, c);
+        posix_swear(k == max_w_count);
+    }
+    // excess width after max_w of non-spacers taken into account
+    xw = 0 > pbx.x + pbx.w - x ? 0 : pbx.x + pbx.w - x;
+    if (xw > 0 && spacers > 0) {
+        // evenly distribute excess among spacers
+        debugln("%*c pass 3: expand spacers", ui_layout_nesting, 0x20);
+        int32_t partial = xw / spacers;
+        x = p->x + insets.left;
+        ui_view_for_each_begin(p, c) {
+            if (!ui_layout_is_hidden(c)) {
+                struct ui_rect cbx; // child "out" box expanded by padding
+                struct ui_ltrb padding;
+                ui_layout_outbox(c, &cbx, &padding);
+                if (c->type == ui_view_spacer) {
+                    c->y = pbx.y;
+                    c->w = partial;
+                    c->h = pbx.h;
+                    spacers--;
+                }
+                c->x = x + padding.left;
+                x = c->x + c->w + padding.right;
+                ui_layout_clild(c);
+            }
+        } ui_view_for_each_end(p, c);
+    }
+    ui_layout_exit(p);
+}
+
+static void ui_list_measure(struct ui_view* p) {
+    ui_layout_enter(p);
+    posix_swear(p->type == ui_view_list, "type %4.4s 0x%08X", &p->type, p->type);
+    struct ui_rect pbx; // parent "in" box (sans insets)
+    struct ui_ltrb insets;
+    ui_layout_inbox(p, &pbx, &insets);
+    int32_t max_h = insets.top;
+    int32_t h = insets.top;
+    int32_t w = 0;
+    ui_view_for_each_begin(p, c) {
+        posix_swear(c->max_h == 0 || c->max_h >= c->h, "max_h: %d h: %d",
+              c->max_h, c->h);
+        if (!ui_layout_is_hidden(c)) {
+            if (c->type == ui_view_spacer) {
+                c->padding = (struct ui_margins){ 0, 0, 0, 0 };
+                c->h = 0; // layout will distribute excess here
+                max_h = ui_infinity; // spacer make height greedy
+            } else {
+                struct ui_rect cbx; // child "out" box expanded by padding
+                struct ui_ltrb padding;
+                ui_layout_outbox(c, &cbx, &padding);
+                w = w > cbx.w ? w : cbx.w;
+                if (c->max_h == ui_infinity) {
+                    max_h = ui_infinity;
+                } else if (max_h < ui_infinity && c->max_h != 0) {
+                    posix_swear(c->max_h >= c->h, "c->max_h:%d < c->h: %d",
+                          c->max_h, c->h);
+                    max_h += c->max_h;
+                } else if (max_h < ui_infinity) {
+                    posix_swear(0 <= max_h + cbx.h &&
+                          (int64_t)max_h + (int64_t)cbx.h < (int64_t)ui_infinity,
+                          "max_h:%d + ch:%d = %d", max_h, cbx.h, max_h + cbx.h);
+                    max_h += cbx.h;
+                }
+                h += cbx.h;
+            }
+            ui_layout_clild(c);
+        }
+    } ui_view_for_each_end(p, c);
+    if (max_h < ui_infinity) {
+        posix_swear(0 <= max_h + insets.bottom &&
+              (int64_t)max_h + (int64_t)insets.bottom < (int64_t)ui_infinity,
+             "max_h:%d + bottom:%d = %d",
+              max_h, insets.bottom, max_h + insets.bottom);
+        max_h += insets.bottom;
+    }
+    if (ui_layout_is_hidden(p)) {
+        p->w = 0;
+        p->h = 0;
+    } else if (p == ui_layout.root) {
+        // ui_layout.root is special occupying whole window client rectangle
+        // sans borders and caption thus it should not be re-measured
+    } else {
+        p->h = h + insets.bottom;
+        p->w = insets.left + w + insets.right;
+    }
+    ui_layout_exit(p);
+}
+
+static int32_t ui_list_place_child(struct ui_view* c, struct ui_rect pbx, int32_t y) {
+    struct ui_ltrb padding = ui_layout_margins(c, &c->padding);
+    // setting child`s max_w to infinity means that child`s height is
+    // *always* fill vertical view size of the parent
+    // childs.w can exceed parent.w (horizontal overflow) - not encouraged but allowed
+    if (c->max_w == ui_infinity) {
+        const int32_t w = pbx.w - padding.left - padding.right;
+        c->w = c->w > w ? c->w : w;
+    }
+    int32_t min_x = pbx.x + padding.left;
+    if ((c->align & ui_align_left) != 0) {
+        posix_assert(c->align == ui_align_left);
+        c->x = min_x;
+    } else if ((c->align & ui_align_right) != 0) {
+        posix_assert(c->align == ui_align_right);
+        const int32_t x = pbx.x + pbx.w - c->w - padding.right;
+        c->x = min_x > x ? min_x : x;
+    } else {
+        posix_assert(c->align == ui_align_center,
+                  "only left, center, right, alignment for list");
+        const int32_t cw = padding.left + c->w + padding.right;
+        const int32_t x = pbx.x + (pbx.w - cw) / 2 + padding.left;
+        c->x = min_x > x ? min_x : x;
+    }
+    c->y = y + padding.top;
+    return c->y + c->h + padding.bottom;
+}
+
+static void ui_list_layout(struct ui_view* p) {
+    ui_layout_enter(p);
+    posix_swear(p->type == ui_view_list, "type %4.4s 0x%08X", &p->type, p->type);
+    struct ui_rect pbx; // parent "in" box (sans insets)
+    struct ui_ltrb insets;
+    ui_layout_inbox(p, &pbx, &insets);
+    int32_t spacers = 0; // Number of spacers
+    int32_t max_h_sum = 0;
+    int32_t max_h_count = 0;
+    int32_t y = pbx.y;
+    ui_view_for_each_begin(p, c) {
+        if (ui_layout_is_hidden(c)) {
+            // nothing
+        } else if (c->type == ui_view_spacer) {
+            c->x = pbx.x;
+            c->y = y;
+            c->w = pbx.w;
+            c->h = 0;
+            spacers++;
+        } else {
+            y = ui_list_place_child(c, pbx, y);
+            posix_swear(c->max_h == 0 || c->max_h >= c->h,
+                  "max_h:%d < h:%d", c->max_h, c->h);
+            if (c->max_h > 0) {
+                // clamp max_h to the effective parent height
+                max_h_count++;
+            }
+        }
+    } ui_view_for_each_end(p, c);
+    int32_t xh = 0 > pbx.y + pbx.h - y ? 0 : pbx.y + pbx.h - y; // excess height
+    if (xh > 0 && max_h_count > 0) {
+        ui_view_for_each_begin(p, c) {
+            if (!ui_layout_is_hidden(c) && c->type != ui_view_spacer &&
+                 c->max_h > 0) {
+                max_h_sum += (c->max_h < xh ? c->max_h : xh);
+            }
+        } ui_view_for_each_end(p, c);
+    }
+    if (xh > 0 && max_h_count > 0) {
+        debugln("%*c pass 2: fill parent", ui_layout_nesting, 0x20);
+        y = pbx.y;
+        int32_t k = 0;
+        ui_view_for_each_begin(p, c) {
+            if (!ui_layout_is_hidden(c)) {
+                struct ui_rect cbx; // child "out" box expanded by padding
+                struct ui_ltrb padding;
+                ui_layout_outbox(c, &cbx, &padding);
+                if (c->type != ui_view_spacer && c->max_h > 0) {
+                    const int32_t max_h = c->max_h < xh ? c->max_h : xh;
+                    int64_t proportional = (xh * (int64_t)max_h) / max_h_sum;
+                    posix_assert(proportional <= (int64_t)INT32_MAX);
+                    int32_t ch = (int32_t)proportional;
+                    c->h = c->max_h < c->h + ch ? c->max_h : c->h + ch;
+                    k++;
+                }
+                int32_t ch = padding.top + c->h + padding.bottom;
+                c->y = y + padding.top;
+                y += ch;
+                ui_layout_clild(c);
+            }
+        } ui_view_for_each_end(p, c);
+        posix_swear(k == max_h_count);
+    }
+    // excess height after max_h of non-spacers taken into account
+    xh = 0 > pbx.y + pbx.h - y ? 0 : pbx.y + pbx.h - y; // excess height
+    if (xh > 0 && spacers > 0) {
+        // evenly distribute excess among spacers
+        debugln("%*c pass 3: expand spacers", ui_layout_nesting, 0x20);
+        int32_t partial = xh / spacers;
+        y = pbx.y;
+        ui_view_for_each_begin(p, c) {
+            if (!ui_layout_is_hidden(c)) {
+                struct ui_rect cbx; // child "out" box expanded by padding
+                struct ui_ltrb padding;
+                ui_layout_outbox(c, &cbx, &padding);
+                if (c->type == ui_view_spacer) {
+                    c->x = pbx.x;
+                    c->w = pbx.x + pbx.w - pbx.x;
+                    c->h = partial; // TODO: last?
+                    spacers--;
+                }
+                int32_t ch = padding.top + c->h + padding.bottom;
+                c->y = y + padding.top;
+                y += ch;
+                ui_layout_clild(c);
+            }
+        } ui_view_for_each_end(p, c);
+    }
+    ui_layout_exit(p);
+}
+
+static void ui_stack_child_3x3(struct ui_view* c, int32_t *row, int32_t *col) {
+    *row = 0; *col = 0; // makes code analysis happier
+    if (c->align == (ui_align_left|ui_align_top)) {
+        *row = 0; *col = 0;
+    } else if (c->align == ui_align_top) {
+        *row = 0; *col = 1;
+    } else if (c->align == (ui_align_right|ui_align_top)) {
+        *row = 0; *col = 2;
+    } else if (c->align == ui_align_left) {
+        *row = 1; *col = 0;
+    } else if (c->align == ui_align_center) {
+        *row = 1; *col = 1;
+    } else if (c->align == ui_align_right) {
+        *row = 1; *col = 2;
+    } else if (c->align == (ui_align_left|ui_align_bottom)) {
+        *row = 2; *col = 0;
+    } else if (c->align == ui_align_bottom) {
+        *row = 2; *col = 1;
+    } else if (c->align == (ui_align_right|ui_align_bottom)) {
+        *row = 2; *col = 2;
+    } else {
+        // Unknown align bitset -- clamp to center (row=1, col=1) and
+        // continue layout. Reachable when callers assemble custom
+        // ui.align combinations.
+        *row = 1;
+        *col = 1;
+    }
+}
+
+static void ui_stack_measure(struct ui_view* p) {
+    ui_layout_enter(p);
+    posix_swear(p->type == ui_view_stack, "type %4.4s 0x%08X", &p->type, p->type);
+    struct ui_rect pbx; // parent "in" box (sans insets)
+    struct ui_ltrb insets;
+    ui_layout_inbox(p, &pbx, &insets);
+    struct ui_wh sides[3][3] = { {0, 0} };
+    ui_view_for_each_begin(p, c) {
+        if (!ui_layout_is_hidden(c)) {
+            struct ui_rect cbx; // child "out" box expanded by padding
+            struct ui_ltrb padding;
+            ui_layout_outbox(c, &cbx, &padding);
+            int32_t row = 0;
+            int32_t col = 0;
+            ui_stack_child_3x3(c, &row, &col);
+            sides[row][col].w = sides[row][col].w > cbx.w ? sides[row][col].w : cbx.w;
+            sides[row][col].h = sides[row][col].h > cbx.h ? sides[row][col].h : cbx.h;
+            ui_layout_clild(c);
+        }
+    } ui_view_for_each_end(p, c);
+    if (ui_layout_debug) {
+        for (int32_t r = 0; r < posix_countof(sides); r++) {
+            char text[1024];
+            text[0] = 0;
+            for (int32_t c = 0; c < posix_countof(sides[r]); c++) {
+                char line[128];
+                posix_str_printf(line, " %4dx%-4d", sides[r][c].w, sides[r][c].h);
+                strcat(text, line);
+            }
+            debugln("%*c sides[%d] %s", ui_layout_nesting, 0x20, r, text);
+        }
+    }
+    struct ui_wh wh = {0, 0};
+    for (int32_t r = 0; r < 3; r++) {
+        int32_t sum_w = 0;
+        for (int32_t c = 0; c < 3; c++) {
+            sum_w += sides[r][c].w;
+        }
+        wh.w = wh.w > sum_w ? wh.w : sum_w;
+    }
+    for (int32_t c = 0; c < 3; c++) {
+        int32_t sum_h = 0;
+        for (int32_t r = 0; r < 3; r++) {
+            sum_h += sides[r][c].h;
+        }
+        wh.h = wh.h > sum_h ? wh.h : sum_h;
+    }
+    debugln("%*c wh %4dx%-4d", ui_layout_nesting, 0x20, wh.w, wh.h);
+    p->w = insets.left + wh.w + insets.right;
+    p->h = insets.top  + wh.h + insets.bottom;
+    ui_layout_exit(p);
+}
+
+static void ui_stack_layout(struct ui_view* p) {
+    ui_layout_enter(p);
+    posix_swear(p->type == ui_view_stack, "type %4.4s 0x%08X", &p->type, p->type);
+    struct ui_rect pbx; // parent "in" box (sans insets)
+    struct ui_ltrb insets;
+    ui_layout_inbox(p, &pbx, &insets);
+    ui_view_for_each_begin(p, c) {
+        if (c->type != ui_view_spacer && !ui_layout_is_hidden(c)) {
+            struct ui_rect cbx; // child "out" box expanded by padding
+            struct ui_ltrb padding;
+            ui_layout_outbox(c, &cbx, &padding);
+            const int32_t pw = p->w - insets.left - insets.right - padding.left - padding.right;
+            const int32_t ph = p->h - insets.top - insets.bottom - padding.top - padding.bottom;
+            int32_t cw = c->max_w == ui_infinity ? pw : c->max_w;
+            if (cw > 0) {
+                c->w = cw < pw ? cw : pw;
+            }
+            int32_t ch = c->max_h == ui_infinity ? ph : c->max_h;
+            if (ch > 0) {
+                c->h = ch < ph ? ch : ph;
+            }
+            posix_swear((c->align & (ui_align_left|ui_align_right)) !=
+                               (ui_align_left|ui_align_right),
+                   "align: left|right 0x%02X", c->align);
+            posix_swear((c->align & (ui_align_top|ui_align_bottom)) !=
+                               (ui_align_top|ui_align_bottom),
+                   "align: top|bottom 0x%02X", c->align);
+            int32_t min_x = pbx.x + padding.left;
+            if ((c->align & ui_align_left) != 0) {
+                c->x = min_x;
+            } else if ((c->align & ui_align_right) != 0) {
+                const int32_t x = pbx.x + pbx.w - c->w - padding.right;
+                c->x = min_x > x ? min_x : x;
+            } else {
+                const int32_t x = min_x + (pbx.w - (padding.left + c->w + padding.right)) / 2;
+                c->x = min_x > x ? min_x : x;
+            }
+            int32_t min_y = pbx.y + padding.top;
+            if ((c->align & ui_align_top) != 0) {
+                c->y = min_y;
+            } else if ((c->align & ui_align_bottom) != 0) {
+                const int32_t y = pbx.y + pbx.h - c->h - padding.bottom;
+                c->y = min_y > y ? min_y : y;
+            } else {
+                const int32_t y = min_y + (pbx.h - (padding.top + c->h + padding.bottom)) / 2;
+                c->y = min_y > y ? min_y : y;
+            }
+            ui_layout_clild(c);
+        }
+    } ui_view_for_each_end(p, c);
+    ui_layout_exit(p);
+}
+
+
+static void ui_layout_init(struct ui_view* v) {
+    void (*measure)(struct ui_view* v) = null;
+    void (*layout)(struct ui_view* v) = null;
+    switch (v->type) {
+        case ui_view_span : measure = ui_span_measure;  layout = ui_span_layout;  break;
+        case ui_view_list : measure = ui_list_measure;  layout = ui_list_layout;  break;
+        case ui_view_stack: measure = ui_stack_measure; layout = ui_stack_layout; break;
+        default: posix_swear(false, "type %4.4s 0x%08X", &v->type, v->type);
+    }
+    if (v->measure == null) { v->measure = measure; }
+    if (v->layout  == null) { v->layout  = layout; }
+    v->p.measure = measure; // cacheable see ui_view.dirty()
+    v->p.layout  = layout;
+}
+
+// tests: trees are linked manually because ui_view.add() and
+// ui_view.remove() are not available without ui_view.c
+
+static void ui_layout_test_add(struct ui_view* p, struct ui_view* c) {
+    posix_swear(c->parent == null && c->prev == null && c->next == null);
+    c->parent = p;
+    if (p->child == null) {
+        c->prev = c;
+        c->next = c;
+        p->child = c;
+    } else {
+        c->prev = p->child->prev;
+        c->next = p->child;
+        c->prev->next = c;
+        c->next->prev = c;
+    }
+    ui_layout.dirty(p);
+    ui_nodes.changed(ui_layout.nodes);
+}
+
+static void ui_layout_test_remove(struct ui_view* c) {
+    struct ui_view* p = c->parent;
+    if (c->next == c) {
+        p->child = null;
+    } else {
+        c->prev->next = c->next;
+        c->next->prev = c->prev;
+        if (p->child == c) { p->child = c->next; }
+    }
+    c->parent = null;
+    c->prev = null;
+    c->next = null;
+    ui_layout.dirty(p);
+    ui_nodes.changed(ui_layout.nodes);
+}
+
+static void ui_layout_test_view(struct ui_view* v, enum ui_view_type_t type,
+        const char* text) {
+    memset(v, 0x00, sizeof(*v));
+    v->type = type;
+    v->fm = ui_layout.fm;
+    v->p.strid = -1; // not localized
+    posix_str.format(v->p.text, posix_countof(v->p.text), "%s", text);
+    if (type == ui_view_span || type == ui_view_list || type == ui_view_stack) {
+        ui_layout.init(v);
+    } else if (type == ui_view_spacer) {
+        v->max_w = ui_infinity;
+        v->max_h = ui_infinity;
+    }
+}
+
+static void ui_layout_test_pass(struct ui_view* root, int32_t w, int32_t h) {
+    const struct ui_view* saved = ui_layout.root;
+    ui_layout.root = root;
+    root->x = 0;
+    root->y = 0;
+    root->w = w;
+    root->h = h;
+    ui_layout.measure(root);
+    ui_layout.layout(root);
+    ui_layout.root = saved;
+}
+
+static void ui_layout_test_text_metrics(void) {
+    const struct ui_fm* fm = &ui_layout_fixed_fm;
+    struct ui_wh wh = ui_layout.text_metrics(fm, false, 0, "abc");
+    posix_swear(wh.w == 24 && wh.h == 16);
+    wh = ui_layout.text_metrics(fm, true, 0, "a\nbcd");
+    posix_swear(wh.w == 24 && wh.h == 32);
+    wh = ui_layout.text_metrics(fm, true, 16, "abcde"); // wraps: ab cd e
+    posix_swear(wh.w == 16 && wh.h == 48);
+    wh = ui_layout.text_metrics(fm, false, 0, "\xE2\x82\xAC"); // one glyph
+    posix_swear(wh.w == 8 && wh.h == 16);
+}
+
+static void ui_layout_test_geometry(void) {
+    enum { w = 200, h = 100 };
+    // root list: [span: [a spacer b]] spacer c
+    struct ui_view root, span, a, s0, b, s1, c;
+    ui_layout_test_view(&root, ui_view_list,   "root");
+    ui_layout_test_view(&span, ui_view_span,   "span");
+    ui_layout_test_view(&a,    ui_view_label,  "abc");
+    ui_layout_test_view(&s0,   ui_view_spacer, "");
+    ui_layout_test_view(&b,    ui_view_label,  "de");
+    ui_layout_test_view(&s1,   ui_view_spacer, "");
+    ui_layout_test_view(&c,    ui_view_label,  "xyz");
+    span.max_w = ui_infinity;
+    c.align = ui_align_right;
+    ui_layout_test_add(&span, &a);
+    ui_layout_test_add(&span, &s0);
+    ui_layout_test_add(&span, &b);
+    ui_layout_test_add(&root, &span);
+    ui_layout_test_add(&root, &s1);
+    ui_layout_test_add(&root, &c);
+    ui_layout_test_pass(&root, w, h);
+    posix_swear(a.x == 0 && a.y == 0 && a.w == 24 && a.h == 16);
+    posix_swear(b.x == w - 16 && b.w == 16);
+    posix_swear(s0.x == 24 && s0.w == w - 24 - 16);
+    posix_swear(span.x == 0 && span.w == w && span.h == 16);
+    posix_swear(c.x == w - 24 && c.y == h - 16);
+    posix_swear(s1.y == 16 && s1.h == h - 32);
+    // root list: [stack] children in the corners and center of the stack
+    struct ui_view list, stack, tl, br, cc;
+    ui_layout_test_view(&list,  ui_view_list,  "list");
+    ui_layout_test_view(&stack, ui_view_stack, "stack");
+    ui_layout_test_view(&tl, ui_view_label, "tl");
+    ui_layout_test_view(&br, ui_view_label, "br");
+    ui_layout_test_view(&cc, ui_view_label, "cc");
+    tl.align = ui_align_left  | ui_align_top;
+    br.align = ui_align_right | ui_align_bottom;
+    ui_layout_test_add(&stack, &tl);
+    ui_layout_test_add(&stack, &br);
+    ui_layout_test_add(&stack, &cc);
+    stack.max_w = ui_infinity;
+    stack.max_h = ui_infinity;
+    ui_layout_test_add(&list, &stack);
+    ui_layout_test_pass(&list, w, h);
+    posix_swear(stack.w == w && stack.h == h);
+    posix_swear(tl.x == 0 && tl.y == 0);
+    posix_swear(br.x == w - 16 && br.y == h - 16);
+    posix_swear(cc.x == (w - 16) / 2 && cc.y == (h - 16) / 2);
+}
+
+static struct ui_rect* ui_layout_test_rects(struct ui_view* views, int32_t n) {
+    struct ui_rect* r = null;
+    posix_swear(posix_heap.alloc((void**)&r, n * (int64_t)sizeof(r[0])) == 0);
+    for (int32_t i = 0; i < n; i++) {
+        const struct ui_view* v = &views[i];
+        r[i] = (struct ui_rect){ .x = v->x, .y = v->y, .w = v->w, .h = v->h };
+    }
+    return r;
+}
+
+static void ui_layout_test_incremental(void) {
+    // random deeply nested tree of containers and labels; after each
+    // random change incremental pass must match the full pass exactly
+    enum { n = 2000, changes = 200, w = 4096, h = 4096 };
+    static const enum ui_view_type_t containers[] = {
+        ui_view_span, ui_view_list, ui_view_stack
+    };
+    struct ui_view* views = null;
+    posix_swear(posix_heap.alloc_zero((void**)&views,
+                n * (int64_t)sizeof(views[0])) == 0);
+    uint32_t seed = 0x1;
+    ui_layout_test_view(&views[0], ui_view_list, "root");
+    int32_t measures = 0;
+    for (int32_t i = 1; i < n; i++) {
+        // containers are added to the random earlier container:
+        // depth grows with the tree
+        int32_t p = (int32_t)(posix_num.random32(&seed) % (uint32_t)i);
+        while (views[p].type == ui_view_label) { p = views[p].parent - views; }
+        if (posix_num.random32(&seed) % 4 == 0) {
+            const uint32_t k = posix_num.random32(&seed) % posix_countof(containers);
+            ui_layout_test_view(&views[i], containers[k], "c");
+        } else {
+            char text[16];
+            posix_str_printf(text, "%d", i);
+            ui_layout_test_view(&views[i], ui_view_label, text);
+            measures++;
+        }
+        ui_layout_test_add(&views[p], &views[i]);
+    }
+    ui_layout_test_pass(&views[0], w, h);
+    for (int32_t i = 0; i < changes; i++) {
+        struct ui_view* v = &views[1 + posix_num.random32(&seed) % (n - 1)];
+        const uint32_t action = posix_num.random32(&seed) % 3;
+        if (action == 0 && v->type == ui_view_label) {
+            char text[16];
+            posix_str_printf(text, "%*d", 1 + (int32_t)(posix_num.random32(&seed) % 8), i);
+            posix_str.format(v->p.text, posix_countof(v->p.text), "%s", text);
+            ui_layout.dirty(v);
+        } else if (action == 1 && v->type == ui_view_label) {
+            // move label to the other container
+            struct ui_view* p = &views[posix_num.random32(&seed) % n];
+            while (p->type == ui_view_label) { p = p->parent; }
+            ui_layout_test_remove(v);
+            ui_layout_test_add(p, v);
+        } else {
+            v->padding.left = (fp32_t)(posix_num.random32(&seed) % 4) / 4;
+            ui_layout.dirty(v);
+        }
+        ui_layout_test_pass(&views[0], w, h);
+        struct ui_rect* incremental = ui_layout_test_rects(views, n);
+        ui_layout.dirty_all();
+        ui_layout_test_pass(&views[0], w, h);
+        struct ui_rect* full = ui_layout_test_rects(views, n);
+        posix_swear(memcmp(incremental, full, n * sizeof(full[0])) == 0);
+        posix_heap.free(incremental);
+        posix_heap.free(full);
+    }
+    posix_swear(measures > 0);
+    posix_heap.free(views);
+}
+
+static void ui_layout_test(void) {
+    ui_layout_test_text_metrics();
+    ui_layout_test_geometry();
+    ui_layout_test_incremental();
+    if (posix_debug.verbosity.level > posix_debug.verbosity.quiet) { posix_println("done"); }
+}
+
+struct ui_layout_if ui_layout = {
+    .text_metrics     = ui_layout_fixed_text_metrics,
+    .fm               = &ui_layout_fixed_fm,
+    .root             = null,
+    .nodes            = &ui_layout_nodes,
+    .init             = ui_layout_init,
+    .margins          = ui_layout_margins,
+    .inbox            = ui_layout_inbox,
+    .outbox           = ui_layout_outbox,
+    .is_orphan        = ui_layout_is_orphan,
+    .is_hidden        = ui_layout_is_hidden,
+    .string           = ui_layout_string,
+    .text_measure     = ui_layout_text_measure,
+    .text_align       = ui_layout_text_align,
+    .measure_control  = ui_layout_measure_control,
+    .measure_children = ui_layout_measure_children,
+    .layout_children  = ui_layout_layout_children,
+    .measure          = ui_layout_measure,
+    .layout           = ui_layout_layout,
+    .dirty            = ui_layout_dirty,
+    .dirty_all        = ui_layout_dirty_all,
+    .span_measure     = ui_span_measure,
+    .span_layout      = ui_span_layout,
+    .list_measure     = ui_list_measure,
+    .list_layout      = ui_list_layout,
+    .stack_measure    = ui_stack_measure,
+    .stack_layout     = ui_stack_layout,
+    .test             = ui_layout_test
+};
+
+#ifdef UI_LAYOUT_TEST
+    posix_static_init(ui_layout) { ui_layout.test(); }
+#endif
+
+#pragma pop_macro("ui_layout_exit")
+#pragma pop_macro("ui_layout_enter")
+#pragma pop_macro("ui_layout_dump")
+#pragma pop_macro("debugln")
@@ -0,0 +1,1299 @@
+/* Copyright (c) Dmitry "Leo" Kuznetsov 2021-24 see LICENSE for details */
+#include "posix/posix.h"
+#include "ui/ui_parallel.h"
+#include "ui/ui_pixels.h"
+#include "ui/ui_mandelbrot.h"
+#include <math.h>
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__SSE2__)
+#include <emmintrin.h>
+#define ui_mandelbrot_has_sse2
+#if defined(_M_X64) || defined(__x86_64__)
+#include <immintrin.h>
+#define ui_mandelbrot_has_avx2
+#if defined(_MSC_VER)
+#pragma warning(disable: 4752) // AVX instructions w/o /arch:AVX (run time dispatch)
+#define ui_mandelbrot_avx2_target
+#else
+#define ui_mandelbrot_avx2_target __attribute__((target("avx2")))
+#endif
+#endif
+#elif defined(_M_ARM64) || defined(__aarch64__)
+#include <arm_neon.h>
+#define ui_mandelbrot_has_neon
+#endif
+
+// Fused multiply-add rounds differently from multiply and add.
+// Identical counts of all kernels require no contraction:
+#if defined(_MSC_VER)
+#pragma fp_contract(off)
+#elif defined(__clang__)
+#pragma clang fp contract(off)
+#elif defined(__GNUC__)
+#pragma GCC optimize("fp-contract=off")
+#endif
+
+#undef UI_MANDELBROT_TEST
+
+#if 0 // flip to 1 to run tests
+
+#define UI_MANDELBROT_TEST
+
+#endif
+
+// row(counts, c, n, x, dx, cy, iterations) computes counts[0..n) of
+// pixels with column indices c..c + n - 1 (cx = x + column * dx).
+// Column c may be fractional: every s-th pixel of a row is computed by
+// row(counts, i / s, n, x, dx * s, ...) with s power of 2 and the same
+// cx as (i + k * s) * dx because both products are rounded once from
+// the same exact value.
+
+typedef void (*ui_mandelbrot_row_t)(int32_t* counts, fp64_t c, int32_t n,
+    fp64_t x, fp64_t dx, fp64_t cy, int32_t iterations);
+
+enum { ui_mandelbrot_period = 8 }; // first periodicity check iteration
+
+static inline bool ui_mandelbrot_inside(fp64_t cx, fp64_t cy) {
+    // main cardioid or period 2 bulb
+    const fp64_t y2 = cy * cy;
+    const fp64_t xq = cx - 0.25;
+    const fp64_t q  = xq * xq + y2;
+    const fp64_t xb = cx + 1.0;
+    return q * (q + xq) <= 0.25 * y2 || xb * xb + y2 <= 0.0625;
+}
+
+static int32_t ui_mandelbrot_escape(fp64_t cx, fp64_t cy, int32_t iterations) {
+    fp64_t x = 0;
+    fp64_t y = 0;
+    int32_t i = 0;
+    while (x * x + y * y <= 4.0 && i < iterations) {
+        const fp64_t t = x * x - y * y + cx;
+        y = (x + x) * y + cy;
+        x = t;
+        i++;
+    }
+    return i;
+}
+
+static int32_t ui_mandelbrot_point(fp64_t cx, fp64_t cy, int32_t iterations) {
+    int32_t i = 0;
+    if (ui_mandelbrot_inside(cx, cy)) {
+        i = iterations;
+    } else {
+        fp64_t x = 0;
+        fp64_t y = 0;
+        fp64_t px = 0; // periodicity check reference point
+        fp64_t py = 0;
+        int32_t check = ui_mandelbrot_period;
+        bool escaped = false;
+        while (i < iterations && !escaped) {
+            const fp64_t xx = x * x;
+            const fp64_t yy = y * y;
+            escaped = xx + yy > 4.0;
+            if (!escaped) {
+                y = (x + x) * y + cy;
+                x = xx - yy + cx;
+                i++;
+                if (x == px && y == py) {
+                    i = iterations; // periodic orbit never escapes
+                } else if (i == check) {
+                    px = x;
+                    py = y;
+                    check += check;
+                }
+            }
+        }
+    }
+    return i;
+}
+
+static void ui_mandelbrot_row_scalar(int32_t* counts, fp64_t c, int32_t n,
+        fp64_t x, fp64_t dx, fp64_t cy, int32_t iterations) {
+    for (int32_t i = 0; i < n; i++) {
+        counts[i] = ui_mandelbrot_point(x + (c + i) * dx, cy, iterations);
+    }
+}
+
+// SIMD kernels iterate two vectors of pixels at a time (independent
+// dependency chains hide latency of multiplication and addition)
+// until all lanes escaped, became periodic or reached iterations.
+// Escaped lanes keep iterating but their counts do not change.
+
+#if defined(ui_mandelbrot_has_sse2)
+
+struct ui_mandelbrot_sse2 {
+    __m128d cx;
+    __m128d cy;
+    __m128d x;
+    __m128d y;
+    __m128d px;
+    __m128d py;
+    __m128d count;
+    __m128d active;
+    __m128d periodic;
+};
+
+static inline void ui_mandelbrot_init_sse2(struct ui_mandelbrot_sse2* v,
+        fp64_t c, fp64_t x, fp64_t dx, fp64_t cy) {
+    v->cx = _mm_add_pd(_mm_set1_pd(x),
+            _mm_mul_pd(_mm_setr_pd(c, c + 1), _mm_set1_pd(dx)));
+    v->cy = _mm_set1_pd(cy);
+    const __m128d y2 = _mm_mul_pd(v->cy, v->cy);
+    const __m128d xq = _mm_sub_pd(v->cx, _mm_set1_pd(0.25));
+    const __m128d q  = _mm_add_pd(_mm_mul_pd(xq, xq), y2);
+    const __m128d xb = _mm_add_pd(v->cx, _mm_set1_pd(1.0));
+    const __m128d cardioid = _mm_cmple_pd(_mm_mul_pd(q, _mm_add_pd(q, xq)),
+                                          _mm_mul_pd(_mm_set1_pd(0.25), y2));
+    const __m128d bulb = _mm_cmple_pd(_mm_add_pd(_mm_mul_pd(xb, xb), y2),
+                                      _mm_set1_pd(0.0625));
+    v->periodic = _mm_or_pd(cardioid, bulb);
+    v->active = _mm_andnot_pd(v->periodic, _mm_castsi128_pd(_mm_set1_epi32(-1)));
+    v->x = _mm_setzero_pd();
+    v->y = _mm_setzero_pd();
+    v->px = _mm_setzero_pd();
+    v->py = _mm_setzero_pd();
+    v->count = _mm_setzero_pd();
+}
+
+static inline void ui_mandelbrot_step_sse2(struct ui_mandelbrot_sse2* v,
+        bool check) {
+    const __m128d xx = _mm_mul_pd(v->x, v->x);
+    const __m128d yy = _mm_mul_pd(v->y, v->y);
+    v->active = _mm_and_pd(v->active,
+                _mm_cmple_pd(_mm_add_pd(xx, yy), _mm_set1_pd(4.0)));
+    v->y = _mm_add_pd(_mm_mul_pd(_mm_add_pd(v->x, v->x), v->y), v->cy);
+    v->x = _mm_add_pd(_mm_sub_pd(xx, yy), v->cx);
+    v->count = _mm_add_pd(v->count, _mm_and_pd(v->active, _mm_set1_pd(1.0)));
+    const __m128d same = _mm_and_pd(v->active,
+        _mm_and_pd(_mm_cmpeq_pd(v->x, v->px), _mm_cmpeq_pd(v->y, v->py)));
+    v->periodic = _mm_or_pd(v->periodic, same);
+    v->active = _mm_andnot_pd(same, v->active);
+    if (check) {
+        v->px = v->x;
+        v->py = v->y;
+    }
+}
+
+static inline void ui_mandelbrot_store_sse2(int32_t* counts,
+        const struct ui_mandelbrot_sse2* v, int32_t iterations) {
+    const __m128d n = _mm_or_pd(_mm_and_pd(v->periodic, _mm_set1_pd(iterations)),
+                                _mm_andnot_pd(v->periodic, v->count));
+    _mm_storel_epi64((__m128i*)counts, _mm_cvttpd_epi32(n));
+}
+
+static void ui_mandelbrot_row_sse2(int32_t* counts, fp64_t c, int32_t n,
+        fp64_t x, fp64_t dx, fp64_t cy, int32_t iterations) {
+    int32_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        struct ui_mandelbrot_sse2 v0;
+        struct ui_mandelbrot_sse2 v1;
+        ui_mandelbrot_init_sse2(&v0, c + i + 0, x, dx, cy);
+        ui_mandelbrot_init_sse2(&v1, c + i + 2, x, dx, cy);
+        int32_t k = 0;
+        int32_t check = ui_mandelbrot_period;
+        while (k < iterations &&
+               _mm_movemask_pd(_mm_or_pd(v0.active, v1.active)) != 0) {
+            k++;
+            ui_mandelbrot_step_sse2(&v0, k == check);
+            ui_mandelbrot_step_sse2(&v1, k == check);
+            if (k == check) { check += check; }
+        }
+        ui_mandelbrot_store_sse2(counts + i + 0, &v0, iterations);
+        ui_mandelbrot_store_sse2(counts + i + 2, &v1, iterations);
+    }
+    ui_mandelbrot_row_scalar(counts + i, c + i, n - i, x, dx, cy, iterations);
+}
+
+#endif // ui_mandelbrot_has_sse2
+
+#if defined(ui_mandelbrot_has_avx2)
+
+struct ui_mandelbrot_avx2 {
+    __m256d cx;
+    __m256d cy;
+    __m256d x;
+    __m256d y;
+    __m256d px;
+    __m256d py;
+    __m256d count;
+    __m256d active;
+    __m256d periodic;
+};
+
+ui_mandelbrot_avx2_target
+static inline void ui_mandelbrot_init_avx2(struct ui_mandelbrot_avx2* v,
+        fp64_t c, fp64_t x, fp64_t dx, fp64_t cy) {
+    v->cx = _mm256_add_pd(_mm256_set1_pd(x),
+            _mm256_mul_pd(_mm256_setr_pd(c, c + 1, c + 2, c + 3),
+                          _mm256_set1_pd(dx)));
+    v->cy = _mm256_set1_pd(cy);
+    const __m256d y2 = _mm256_mul_pd(v->cy, v->cy);
+    const __m256d xq = _mm256_sub_pd(v->cx, _mm256_set1_pd(0.25));
+    const __m256d q  = _mm256_add_pd(_mm256_mul_pd(xq, xq), y2);
+    const __m256d xb = _mm256_add_pd(v->cx, _mm256_set1_pd(1.0));
+    const __m256d cardioid = _mm256_cmp_pd(
+        _mm256_mul_pd(q, _mm256_add_pd(q, xq)),
+        _mm256_mul_pd(_mm256_set1_pd(0.25), y2), _CMP_LE_OQ);
+    const __m256d bulb = _mm256_cmp_pd(
+        _mm256_add_pd(_mm256_mul_pd(xb, xb), y2),
+        _mm256_set1_pd(0.0625), _CMP_LE_OQ);
+    v->periodic = _mm256_or_pd(cardioid, bulb);
+    v->active = _mm256_andnot_pd(v->periodic,
+                _mm256_castsi256_pd(_mm256_set1_epi32(-1)));
+    v->x = _mm256_setzero_pd();
+    v->y = _mm256_setzero_pd();
+    v->px = _mm256_setzero_pd();
+    v->py = _mm256_setzero_pd();
+    v->count = _mm256_setzero_pd();
+}
+
+ui_mandelbrot_avx2_target
+static inline void ui_mandelbrot_step_avx2(struct ui_mandelbrot_avx2* v,
+        bool check) {
+    const __m256d xx = _mm256_mul_pd(v->x, v->x);
+    const __m256d yy = _mm256_mul_pd(v->y, v->y);
+    v->active = _mm256_and_pd(v->active, _mm256_cmp_pd(
+        _mm256_add_pd(xx, yy), _mm256_set1_pd(4.0), _CMP_LE_OQ));
+    v->y = _mm256_add_pd(_mm256_mul_pd(_mm256_add_pd(v->x, v->x), v->y),
+                         v->cy);
+    v->x = _mm256_add_pd(_mm256_sub_pd(xx, yy), v->cx);
+    v->count = _mm256_add_pd(v->count,
+               _mm256_and_pd(v->active, _mm256_set1_pd(1.0)));
+    const __m256d same = _mm256_and_pd(v->active, _mm256_and_pd(
+        _mm256_cmp_pd(v->x, v->px, _CMP_EQ_OQ),
+        _mm256_cmp_pd(v->y, v->py, _CMP_EQ_OQ)));
+    v->periodic = _mm256_or_pd(v->periodic, same);
+    v->active = _mm256_andnot_pd(same, v->active);
+    if (check) {
+        v->px = v->x;
+        v->py = v->y;
+    }
+}
+
+ui_mandelbrot_avx2_target
+static inline void ui_mandelbrot_store_avx2(int32_t* counts,
+        const struct ui_mandelbrot_avx2* v, int32_t iterations) {
+    const __m256d n = _mm256_blendv_pd(v->count,
+                      _mm256_set1_pd(iterations), v->periodic);
+    _mm_storeu_si128((__m128i*)counts, _mm256_cvttpd_epi32(n));
+}
+
+ui_mandelbrot_avx2_target
+static void ui_mandelbrot_row_avx2(int32_t* counts, fp64_t c, int32_t n,
+        fp64_t x, fp64_t dx, fp64_t cy, int32_t iterations) {
+    int32_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        struct ui_mandelbrot_avx2 v0;
+        struct ui_mandelbrot_avx2 v1;
+        ui_mandelbrot_init_avx2(&v0, c + i + 0, x, dx, cy);
+        ui_mandelbrot_init_avx2(&v1, c + i + 4, x, dx, cy);
+        int32_t k = 0;
+        int32_t check = ui_mandelbrot_period;
+        while (k < iterations &&
+               _mm256_movemask_pd(_mm256_or_pd(v0.active, v1.active)) != 0) {
+            k++;
+            ui_mandelbrot_step_avx2(&v0, k == check);
+            ui_mandelbrot_step_avx2(&v1, k == check);
+            if (k == check) { check += check; }
+        }
+        ui_mandelbrot_store_avx2(counts + i + 0, &v0, iterations);
+        ui_mandelbrot_store_avx2(counts + i + 4, &v1, iterations);
+    }
+    #if defined(ui_mandelbrot_has_sse2)
+        ui_mandelbrot_row_sse2(counts + i, c + i, n - i, x, dx, cy, iterations);
+    #else
+        ui_mandelbrot_row_scalar(counts + i, c + i, n - i, x, dx, cy, iterations);
+    #endif
+}
+
+#endif // ui_mandelbrot_has_avx2
+
+#if defined(ui_mandelbrot_has_neon)
+
+struct ui_mandelbrot_neon {
+    float64x2_t cx;
+    float64x2_t cy;
+    float64x2_t x;
+    float64x2_t y;
+    float64x2_t px;
+    float64x2_t py;
+    float64x2_t count;
+    uint64x2_t  active;
+    uint64x2_t  periodic;
+};
+
+static inline void ui_mandelbrot_init_neon(struct ui_mandelbrot_neon* v,
+        fp64_t c, fp64_t x, fp64_t dx, fp64_t cy) {
+    const fp64_t columns[2] = { c, c + 1 };
+    v->cx = vaddq_f64(vdupq_n_f64(x), vmulq_f64(vld1q_f64(columns),
+                                                vdupq_n_f64(dx)));
+    v->cy = vdupq_n_f64(cy);
+    const float64x2_t y2 = vmulq_f64(v->cy, v->cy);
+    const float64x2_t xq = vsubq_f64(v->cx, vdupq_n_f64(0.25));
+    const float64x2_t q  = vaddq_f64(vmulq_f64(xq, xq), y2);
+    const float64x2_t xb = vaddq_f64(v->cx, vdupq_n_f64(1.0));
+    const uint64x2_t cardioid = vcleq_f64(vmulq_f64(q, vaddq_f64(q, xq)),
+                                          vmulq_f64(vdupq_n_f64(0.25), y2));
+    const uint64x2_t bulb = vcleq_f64(vaddq_f64(vmulq_f64(xb, xb), y2),
+                                      vdupq_n_f64(0.0625));
+    v->periodic = vorrq_u64(cardioid, bulb);
+    v->active = vbicq_u64(vdupq_n_u64(~0ULL), v->periodic);
+    v->x = vdupq_n_f64(0);
+    v->y = vdupq_n_f64(0);
+    v->px = vdupq_n_f64(0);
+    v->py = vdupq_n_f64(0);
+    v->count = vdupq_n_f64(0);
+}
+
+static inline void ui_mandelbrot_step_neon(struct ui_mandelbrot_neon* v,
+        bool check) {
+    const float64x2_t xx = vmulq_f64(v->x, v->x);
+    const float64x2_t yy = vmulq_f64(v->y, v->y);
+    v->active = vandq_u64(v->active,
+                vcleq_f64(vaddq_f64(xx, yy), vdupq_n_f64(4.0)));
+    v->y = vaddq_f64(vmulq_f64(vaddq_f64(v->x, v->x), v->y), v->cy);
+    v->x = vaddq_f64(vsubq_f64(xx, yy), v->cx);
+    const uint64x2_t one = vreinterpretq_u64_f64(vdupq_n_f64(1.0));
+    v->count = vaddq_f64(v->count,
+               vreinterpretq_f64_u64(vandq_u64(v->active, one)));
+    const uint64x2_t same = vandq_u64(v->active, vandq_u64(
+        vceqq_f64(v->x, v->px), vceqq_f64(v->y, v->py)));
+    v->periodic = vorrq_u64(v->periodic, same);
+    v->active = vbicq_u64(v->active, same);
+    if (check) {
+        v->px = v->x;
+        v->py = v->y;
+    }
+}
+
+static inline void ui_mandelbrot_store_neon(int32_t* counts,
+        const struct ui_mandelbrot_neon* v, int32_t iterations) {
+    const float64x2_t n = vbslq_f64(v->periodic,
+                          vdupq_n_f64(iterations), v->count);
+    vst1_s32(counts, vmovn_s64(vcvtq_s64_f64(n)));
+}
+
+static void ui_mandelbrot_row_neon(int32_t* counts, fp64_t c, int32_t n,
+        fp64_t x, fp64_t dx, fp64_t cy, int32_t iterations) {
+    int32_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        struct ui_mandelbrot_neon v0;
+        struct ui_mandelbrot_neon v1;
+        ui_mandelbrot_init_neon(&v0, c + i + 0, x, dx, cy);
+        ui_mandelbrot_init_neon(&v1, c + i + 2, x, dx, cy);
+        int32_t k = 0;
+        int32_t check = ui_mandelbrot_period;
+        while (k < iterations &&
+               vmaxvq_u32(vreinterpretq_u32_u64(
+                   vorrq_u64(v0.active, v1.active))) != 0) {
+            k++;
+            ui_mandelbrot_step_neon(&v0, k == check);
+            ui_mandelbrot_step_neon(&v1, k == check);
+            if (k == check) { check += check; }
+        }
+        ui_mandelbrot_store_neon(counts + i + 0, &v0, iterations);
+        ui_mandelbrot_store_neon(counts + i + 2, &v1, iterations);
+    }
+    ui_mandelbrot_row_scalar(counts + i, c + i, n - i, x, dx, cy, iterations);
+}
+
+#endif // ui_mandelbrot_has_neon
+
+static ui_mandelbrot_row_t ui_mandelbrot_row; // selected kernel
+static int32_t ui_mandelbrot_selected;
+
+static ui_mandelbrot_row_t ui_mandelbrot_of(int32_t isa) {
+    ui_mandelbrot_row_t row = null;
+    if (ui_pixels.supported(isa)) {
+        switch (isa) {
+            case ui_pixels_scalar: row = ui_mandelbrot_row_scalar; break;
+            #if defined(ui_mandelbrot_has_sse2)
+            case ui_pixels_sse2: row = ui_mandelbrot_row_sse2; break;
+            #endif
+            #if defined(ui_mandelbrot_has_avx2)
+            case ui_pixels_avx2: row = ui_mandelbrot_row_avx2; break;
+            #endif
+            #if defined(ui_mandelbrot_has_neon)
+            case ui_pixels_neon: row = ui_mandelbrot_row_neon; break;
+            #endif
+            default: break;
+        }
+    }
+    return row;
+}
+
+static bool ui_mandelbrot_use(int32_t isa) {
+    const ui_mandelbrot_row_t row = ui_mandelbrot_of(isa);
+    if (row != null) {
+        ui_mandelbrot_selected = isa;
+        ui_mandelbrot_row = row;
+    }
+    return row != null;
+}
+
+static ui_mandelbrot_row_t ui_mandelbrot_kernel(void) {
+    if (ui_mandelbrot_row == null) {
+        // best available, races are benign: same result on all threads
+        const int32_t isa[] = { ui_pixels_avx2, ui_pixels_sse2, ui_pixels_neon };
+        bool found = false;
+        for (int32_t i = 0; i < posix_countof(isa) && !found; i++) {
+            found = ui_mandelbrot_use(isa[i]);
+        }
+        if (!found) { ui_mandelbrot_use(ui_pixels_scalar); }
+    }
+    return ui_mandelbrot_row;
+}
+
+static int32_t ui_mandelbrot_isa(void) {
+    (void)ui_mandelbrot_kernel();
+    return ui_mandelbrot_selected;
+}
+
+// rows of a tile are rendered by render() or deep() scanline function:
+
+struct ui_mandelbrot_job {
+    struct ui_mandelbrot* m;
+    void (*row)(struct ui_mandelbrot* m, int32_t* counts, int32_t x,
+                int32_t w, int32_t j);
+    const uint8_t* known; // update(): [w * h] pixels not to iterate
+    int32_t* cache;       // update(): [w * h] copy of the counts
+    int32_t  stride;      // update(): known pixels are `stride` apart
+};
+
+static void ui_mandelbrot_strided(struct ui_mandelbrot* m, int32_t* counts,
+        int32_t i, int32_t n, int32_t s, int32_t j) {
+    // counts of n pixels i, i + s, ... i + (n - 1) * s of row j
+    int32_t temp[ui_mandelbrot_tile];
+    posix_assert(n <= ui_mandelbrot_tile);
+    ui_mandelbrot_kernel()(temp, (fp64_t)i / s, n, m->x, m->dx * s,
+                           m->y + (fp64_t)j * m->dy, m->iterations);
+    for (int32_t k = 0; k < n; k++) { counts[i + k * s] = temp[k]; }
+}
+
+static void ui_mandelbrot_runs(struct ui_mandelbrot_job* job,
+        int32_t* counts, int32_t x, int32_t w, int32_t j) {
+    // iterates runs of pixels that are not known in a row of a tile.
+    // Zoomed in fp64 views know every stride-th pixel: runs are
+    // collected along each of the stride columns residues so that
+    // SIMD kernels iterate unknown pixels only.
+    const uint8_t* known = job->known + (int64_t)j * job->m->w;
+    const int32_t s = job->stride;
+    bool all = true; // no known pixels in the row of the tile
+    for (int32_t i = x; i < x + w && all; i++) { all = !known[i]; }
+    if (all || s == 1) {
+        int32_t i = x;
+        while (i < x + w) {
+            if (known[i]) {
+                i++;
+            } else {
+                int32_t e = i + 1;
+                while (e < x + w && !known[e]) { e++; }
+                job->row(job->m, counts + i, i, e - i, j);
+                i = e;
+            }
+        }
+    } else {
+        for (int32_t i0 = x; i0 < x + s && i0 < x + w; i0++) {
+            int32_t i = i0;
+            while (i < x + w) {
+                if (known[i]) {
+                    i += s;
+                } else {
+                    int32_t e = i + s;
+                    while (e < x + w && !known[e]) { e += s; }
+                    ui_mandelbrot_strided(job->m, counts, i, (e - i) / s, s, j);
+                    i = e;
+                }
+            }
+        }
+    }
+}
+
+static void ui_mandelbrot_task(void* that, int32_t t) {
+    struct ui_mandelbrot_job* job = (struct ui_mandelbrot_job*)that;
+    struct ui_mandelbrot* m = job->m;
+    if (!m->stop) {
+        const int32_t n = (m->w + ui_mandelbrot_tile - 1) / ui_mandelbrot_tile;
+        const int32_t x = t % n * ui_mandelbrot_tile;
+        const int32_t y = t / n * ui_mandelbrot_tile;
+        const int32_t w = posix_min(ui_mandelbrot_tile, m->w - x);
+        const int32_t h = posix_min(ui_mandelbrot_tile, m->h - y);
+        for (int32_t j = y; j < y + h && !m->stop; j++) {
+            int32_t* counts = m->counts + (int64_t)j * m->stride;
+            if (job->known == null) {
+                job->row(m, counts + x, x, w, j);
+            } else {
+                ui_mandelbrot_runs(job, counts, x, w, j);
+            }
+            if (job->cache != null) {
+                memcpy(job->cache + (int64_t)j * m->w + x, counts + x,
+                       (size_t)w * sizeof(int32_t));
+            }
+        }
+        if (!m->stop && m->tile != null) { m->tile(m, x, y, w, h); }
+    }
+}
+
+static void ui_mandelbrot_tiles(struct ui_mandelbrot_job* job) {
+    struct ui_mandelbrot* m = job->m;
+    posix_assert(m->w > 0 && m->h > 0 && m->stride >= m->w);
+    posix_assert(m->iterations > 0 && m->counts != null);
+    const int32_t tw = (m->w + ui_mandelbrot_tile - 1) / ui_mandelbrot_tile;
+    const int32_t th = (m->h + ui_mandelbrot_tile - 1) / ui_mandelbrot_tile;
+    ui_parallel.for_each(tw * th, ui_mandelbrot_task, job);
+}
+
+static void ui_mandelbrot_row_fp64(struct ui_mandelbrot* m, int32_t* counts,
+        int32_t x, int32_t w, int32_t j) {
+    ui_mandelbrot_kernel()(counts, x, w, m->x, m->dx,
+                           m->y + (fp64_t)j * m->dy, m->iterations);
+}
+
+static void ui_mandelbrot_render(struct ui_mandelbrot* m) {
+    struct ui_mandelbrot_job job = { .m = m, .row = ui_mandelbrot_row_fp64 };
+    ui_mandelbrot_tiles(&job);
+}
+
+// Fixed point numbers: limbs are most significant first, value is
+// (int32_t)limb[0] + sum(limb[i] * 2^(-32 * i)). Orbits never leave
+// |z| <= 6 thus the integer part does not overflow.
+
+static bool ui_mandelbrot_negative(const struct ui_mandelbrot_fixed* f) {
+    return (int32_t)f->limb[0] < 0;
+}
+
+static void ui_mandelbrot_negate(struct ui_mandelbrot_fixed* f) {
+    uint64_t carry = 1;
+    for (int32_t i = ui_mandelbrot_limbs - 1; i >= 0; i--) {
+        const uint64_t s = (uint64_t)(uint32_t)~f->limb[i] + carry;
+        f->limb[i] = (uint32_t)s;
+        carry = s >> 32;
+    }
+}
+
+static void ui_mandelbrot_sum(struct ui_mandelbrot_fixed* r,
+        const struct ui_mandelbrot_fixed* a,
+        const struct ui_mandelbrot_fixed* b) {
+    uint64_t carry = 0;
+    for (int32_t i = ui_mandelbrot_limbs - 1; i >= 0; i--) {
+        const uint64_t s = (uint64_t)a->limb[i] + b->limb[i] + carry;
+        r->limb[i] = (uint32_t)s;
+        carry = s >> 32;
+    }
+}
+
+static void ui_mandelbrot_mul(struct ui_mandelbrot_fixed* r,
+        const struct ui_mandelbrot_fixed* a,
+        const struct ui_mandelbrot_fixed* b) {
+    // magnitudes are multiplied, product is truncated to the limbs
+    enum { n = ui_mandelbrot_limbs };
+    struct ui_mandelbrot_fixed x = *a;
+    struct ui_mandelbrot_fixed y = *b;
+    const bool negative = ui_mandelbrot_negative(&x) != ui_mandelbrot_negative(&y);
+    if (ui_mandelbrot_negative(&x)) { ui_mandelbrot_negate(&x); }
+    if (ui_mandelbrot_negative(&y)) { ui_mandelbrot_negate(&y); }
+    uint32_t t[n * 2] = {0}; // t[i + j + 1] += x[i] * y[j], t[0] overflow
+    for (int32_t i = n - 1; i >= 0; i--) {
+        uint64_t carry = 0;
+        for (int32_t j = n - 1; j >= 0; j--) {
+            const uint64_t p = (uint64_t)x.limb[i] * y.limb[j] +
+                               t[i + j + 1] + carry;
+            t[i + j + 1] = (uint32_t)p;
+            carry = p >> 32;
+        }
+        t[i] = (uint32_t)carry;
+    }
+    memcpy(r->limb, t + 1, sizeof(r->limb));
+    if (negative) { ui_mandelbrot_negate(r); }
+}
+
+static void ui_mandelbrot_fixed(struct ui_mandelbrot_fixed* f, fp64_t v) {
+    // all operations are exact: integer parts are subtracted and
+    // remainder is multiplied by power of 2
+    memset(f, 0x00, sizeof(*f));
+    fp64_t a = v < 0 ? -v : v;
+    posix_assert(a < 2147483648.0);
+    for (int32_t i = 0; i < ui_mandelbrot_limbs && a != 0; i++) {
+        f->limb[i] = (uint32_t)a;
+        a = (a - f->limb[i]) * 4294967296.0;
+    }
+    if (v < 0) { ui_mandelbrot_negate(f); }
+}
+
+static void ui_mandelbrot_add(struct ui_mandelbrot_fixed* f, fp64_t v) {
+    struct ui_mandelbrot_fixed t;
+    ui_mandelbrot_fixed(&t, v);
+    ui_mandelbrot_sum(f, f, &t);
+}
+
+static fp64_t ui_mandelbrot_fp64(const struct ui_mandelbrot_fixed* f) {
+    struct ui_mandelbrot_fixed a = *f;
+    const bool negative = ui_mandelbrot_negative(&a);
+    if (negative) { ui_mandelbrot_negate(&a); }
+    int32_t k = 0; // most significant limb, small values are precise too
+    while (k < ui_mandelbrot_limbs - 1 && a.limb[k] == 0) { k++; }
+    fp64_t v = 0; // 3 limbs (96 bits) are more than fp64 mantissa
+    for (int32_t i = posix_min(k + 2, ui_mandelbrot_limbs - 1); i >= k; i--) {
+        v = v / 4294967296.0 + a.limb[i];
+    }
+    v = ldexp(v, -32 * k);
+    return negative ? -v : v;
+}
+
+// Reference orbit and series approximation:
+
+static int ui_mandelbrot_reference(struct ui_mandelbrot* m) {
+    const int64_t count = ((int64_t)m->iterations + 1) * 2;
+    int r = 0;
+    if (m->deep.capacity < count) {
+        r = posix_heap.realloc((void**)&m->deep.orbit,
+                               count * (int64_t)sizeof(fp64_t));
+        if (r == 0) { m->deep.capacity = count; }
+    }
+    if (r == 0) {
+        fp64_t* z = m->deep.orbit;
+        struct ui_mandelbrot_fixed x = {0};
+        struct ui_mandelbrot_fixed y = {0};
+        struct ui_mandelbrot_fixed xx;
+        struct ui_mandelbrot_fixed yy;
+        struct ui_mandelbrot_fixed xy;
+        int32_t n = 0;
+        z[0] = 0;
+        z[1] = 0;
+        bool escaped = false;
+        while (n < m->iterations && !escaped) {
+            // x = x^2 - y^2 + cx, y = 2 * x * y + cy
+            ui_mandelbrot_mul(&xx, &x, &x);
+            ui_mandelbrot_mul(&yy, &y, &y);
+            ui_mandelbrot_mul(&xy, &x, &y);
+            ui_mandelbrot_negate(&yy);
+            ui_mandelbrot_sum(&x, &xx, &yy);
+            ui_mandelbrot_sum(&x, &x, &m->deep.cx);
+            ui_mandelbrot_sum(&y, &xy, &xy);
+            ui_mandelbrot_sum(&y, &y, &m->deep.cy);
+            n++;
+            z[n * 2 + 0] = ui_mandelbrot_fp64(&x);
+            z[n * 2 + 1] = ui_mandelbrot_fp64(&y);
+            escaped = z[n * 2] * z[n * 2] + z[n * 2 + 1] * z[n * 2 + 1] > 4.0;
+        }
+        m->deep.n = n;
+    }
+    return r;
+}
+
+static void ui_mandelbrot_series(struct ui_mandelbrot* m) {
+    // Coefficients are scaled by powers of radius r = max |dc| so they
+    // stay in fp64 range at any depth: dz = a * u + b * u^2 + c * u^3
+    // where u = dc / r and |u| <= 1. Approximation is used while the
+    // cubic term is negligible relative to the linear one.
+    const fp64_t hw = m->w / 2.0 * m->dx;
+    const fp64_t hh = m->h / 2.0 * m->dy;
+    const fp64_t r = sqrt(hw * hw + hh * hh);
+    const fp64_t epsilon = 1e-24; // |c|^2 / |a|^2, i.e. 1e-12 of |a|
+    const fp64_t* z = m->deep.orbit;
+    fp64_t ax = 0, ay = 0, bx = 0, by = 0, cx = 0, cy = 0;
+    int32_t k = 0;
+    bool valid = true;
+    while (k < m->deep.n - 1 && valid) {
+        const fp64_t zx = z[k * 2 + 0] * 2;
+        const fp64_t zy = z[k * 2 + 1] * 2;
+        // a' = 2 * Z * a + r, b' = 2 * Z * b + a^2, c' = 2 * Z * c + 2 * a * b
+        const fp64_t nax = zx * ax - zy * ay + r;
+        const fp64_t nay = zx * ay + zy * ax;
+        const fp64_t nbx = zx * bx - zy * by + ax * ax - ay * ay;
+        const fp64_t nby = zx * by + zy * bx + 2 * ax * ay;
+        const fp64_t ncx = zx * cx - zy * cy + 2 * (ax * bx - ay * by);
+        const fp64_t ncy = zx * cy + zy * cx + 2 * (ax * by + ay * bx);
+        valid = ncx * ncx + ncy * ncy <= epsilon * (nax * nax + nay * nay);
+        if (valid) {
+            ax = nax; ay = nay;
+            bx = nbx; by = nby;
+            cx = ncx; cy = ncy;
+            k++;
+        }
+    }
+    m->deep.skip = k;
+    m->deep.r = r;
+    const fp64_t series[6] = { ax, ay, bx, by, cx, cy };
+    memcpy(m->deep.series, series, sizeof(series));
+}
+
+static int32_t ui_mandelbrot_perturb(const struct ui_mandelbrot* m,
+        fp64_t dcx, fp64_t dcy) {
+    const fp64_t* z = m->deep.orbit;
+    const fp64_t* s = m->deep.series;
+    // dz at .skip from series: u = dc / r, dz = a * u + b * u^2 + c * u^3
+    const fp64_t ux = dcx / m->deep.r;
+    const fp64_t uy = dcy / m->deep.r;
+    const fp64_t u2x = ux * ux - uy * uy;
+    const fp64_t u2y = 2 * ux * uy;
+    const fp64_t u3x = u2x * ux - u2y * uy;
+    const fp64_t u3y = u2x * uy + u2y * ux;
+    fp64_t dx = s[0] * ux - s[1] * uy + s[2] * u2x - s[3] * u2y +
+                s[4] * u3x - s[5] * u3y;
+    fp64_t dy = s[0] * uy + s[1] * ux + s[2] * u2y + s[3] * u2x +
+                s[4] * u3y + s[5] * u3x;
+    int32_t n = m->deep.skip; // iteration
+    int32_t k = n;            // index into reference orbit
+    const fp64_t x = z[k * 2] + dx;
+    const fp64_t y = z[k * 2 + 1] + dy;
+    if (x * x + y * y > 4.0) { // escaped before .skip
+        dx = 0;
+        dy = 0;
+        n = 0;
+        k = 0;
+    }
+    bool escaped = false;
+    while (n < m->iterations && !escaped) {
+        const fp64_t zx = z[k * 2] + dx;
+        const fp64_t zy = z[k * 2 + 1] + dy;
+        const fp64_t r2 = zx * zx + zy * zy;
+        escaped = r2 > 4.0;
+        if (!escaped) {
+            if (r2 < dx * dx + dy * dy || k == m->deep.n) {
+                dx = zx; // rebase to the start of the reference orbit
+                dy = zy;
+                k = 0;
+            }
+            // dz' = (2 * Z + dz) * dz + dc
+            const fp64_t tx = 2 * z[k * 2] + dx;
+            const fp64_t ty = 2 * z[k * 2 + 1] + dy;
+            const fp64_t nx = tx * dx - ty * dy + dcx;
+            dy = tx * dy + ty * dx + dcy;
+            dx = nx;
+            k++;
+            n++;
+        }
+    }
+    return n;
+}
+
+static void ui_mandelbrot_row_deep(struct ui_mandelbrot* m, int32_t* counts,
+        int32_t x, int32_t w, int32_t j) {
+    const fp64_t dcy = (j - m->h / 2) * m->dy;
+    for (int32_t i = 0; i < w; i++) {
+        counts[i] = ui_mandelbrot_perturb(m, (x + i - m->w / 2) * m->dx, dcy);
+    }
+}
+
+static int ui_mandelbrot_deep(struct ui_mandelbrot* m) {
+    int r = ui_mandelbrot_reference(m);
+    if (r == 0) {
+        ui_mandelbrot_series(m);
+        struct ui_mandelbrot_job job = { .m = m, .row = ui_mandelbrot_row_deep };
+        ui_mandelbrot_tiles(&job);
+    }
+    return r;
+}
+
+// Incremental update() reuses counts of the previous view:
+
+static bool ui_mandelbrot_ratio(fp64_t was, fp64_t now, int32_t* p,
+        int32_t* q) {
+    // was / now = q / p where one of p, q is 1 and the other power of 2
+    // (multiplication by power of 2 is exact)
+    bool found = false;
+    for (int32_t k = 0; k <= 16 && !found; k++) {
+        if (now * (1 << k) == was) {
+            *p = 1;
+            *q = 1 << k;
+            found = true;
+        } else if (was * (1 << k) == now) {
+            *p = 1 << k;
+            *q = 1;
+            found = true;
+        }
+    }
+    return found;
+}
+
+static bool ui_mandelbrot_shift(const struct ui_mandelbrot_fixed* now,
+        const struct ui_mandelbrot_fixed* was, fp64_t unit, int64_t limit,
+        int64_t* shift) {
+    // (now - was) / unit if it is a whole number within +/- limit
+    struct ui_mandelbrot_fixed d = *was;
+    ui_mandelbrot_negate(&d);
+    ui_mandelbrot_sum(&d, &d, now);
+    const fp64_t v = ui_mandelbrot_fp64(&d) / unit;
+    const bool whole = fabs(v) <= (fp64_t)limit &&
+                       fabs(v - floor(v + 0.5)) < 1.0 / 1024;
+    *shift = whole ? (int64_t)floor(v + 0.5) : 0;
+    return whole;
+}
+
+static int32_t ui_mandelbrot_source(int64_t u, int32_t q, int32_t n,
+        bool* exact) {
+    // index of the nearest previous view pixel at u / q or -1 outside
+    int64_t k = (u + q / 2) / q;
+    if (k * q > u + q / 2) { k--; } // floor for negative u
+    *exact = k * q == u;
+    k += n / 2;
+    return 0 <= k && k < n ? (int32_t)k : -1;
+}
+
+static void ui_mandelbrot_merge(uint8_t* known, int32_t w, int32_t gap) {
+    // known runs shorter than gap between unknown pixels are iterated
+    // again: SIMD kernels compute 2..8 adjacent pixels at the same cost
+    int32_t i = 0;
+    while (i < w) {
+        int32_t e = i;
+        while (e < w && known[e]) { e++; }
+        if (0 < i && e < w && e - i < gap) {
+            memset(known + i, 0x00, (size_t)(e - i));
+        }
+        i = e + 1;
+    }
+}
+
+static int ui_mandelbrot_reuse(struct ui_mandelbrot* m, int32_t gap,
+        int32_t* stride) {
+    // Pixels of both views are on the grid of the finer pixel size
+    // unit = dx / p. Pixel i of the new view is at sx + (i - w / 2) * p
+    // units from the previous view center, its pixels are q units apart.
+    // When zoomed in by 2 or 4 known pixels are *stride = q apart and
+    // are not merged with the gaps between them (see runs()) unless
+    // less than 1/8 of the row is known.
+    int32_t px = 1, qx = 1, py = 1, qy = 1;
+    int64_t sx = 0, sy = 0;
+    const bool overlap = m->cache.w > 0 &&
+        ui_mandelbrot_ratio(m->cache.dx, m->dx, &px, &qx) &&
+        ui_mandelbrot_ratio(m->cache.dy, m->dy, &py, &qy) &&
+        ui_mandelbrot_shift(&m->deep.cx, &m->cache.cx, m->dx / px,
+            ((int64_t)m->w + m->cache.w) * px * qx, &sx) &&
+        ui_mandelbrot_shift(&m->deep.cy, &m->cache.cy, m->dy / py,
+            ((int64_t)m->h + m->cache.h) * py * qy, &sy);
+    *stride = overlap && gap > 1 && 1 < qx && qx <= 4 ? qx : 1;
+    if (*stride > 1) { gap = 1; }
+    int32_t* column = null; // source pixel * 2 + exact or -1
+    int r = posix_heap.alloc((void**)&column, m->w * (int64_t)sizeof(int32_t));
+    if (r == 0) {
+        for (int32_t i = 0; i < m->w; i++) {
+            bool exact = false;
+            const int32_t ix = overlap ? ui_mandelbrot_source(
+                sx + (int64_t)(i - m->w / 2) * px, qx, m->cache.w, &exact) : -1;
+            column[i] = ix >= 0 ? ix * 2 + exact : -1;
+        }
+        const int32_t* was = m->cache.counts;
+        int64_t computed = 0;
+        for (int32_t j = 0; j < m->h; j++) {
+            int32_t* counts = m->counts + (int64_t)j * m->stride;
+            uint8_t* known = m->cache.known + (int64_t)j * m->w;
+            bool ey = false;
+            const int32_t jy = overlap ? ui_mandelbrot_source(
+                sy + (int64_t)(j - m->h / 2) * py, qy, m->cache.h, &ey) : -1;
+            const int32_t* row = was + (int64_t)jy * m->cache.w;
+            for (int32_t i = 0; i < m->w; i++) {
+                known[i] = 0;
+                counts[i] = 0;
+                if (jy >= 0 && column[i] >= 0) {
+                    // escaped at c < .iterations is the same for any limit
+                    const int32_t c = row[column[i] / 2];
+                    counts[i] = posix_min(c, m->iterations);
+                    known[i] = ey && (column[i] & 1) &&
+                        (c < m->cache.iterations ||
+                         m->iterations <= m->cache.iterations);
+                }
+            }
+            if (gap > 1) { ui_mandelbrot_merge(known, m->w, gap); }
+            int32_t k = 0; // known pixels in the row
+            for (int32_t i = 0; i < m->w; i++) { k += known[i]; }
+            if (*stride > 1 && k < m->w / 8) {
+                // strided runs of a few gaps cost more than the row
+                memset(known, 0x00, (size_t)m->w);
+                k = 0;
+            }
+            computed += m->w - k;
+        }
+        m->cache.computed = computed;
+        m->cache.reused = (int64_t)m->w * m->h - computed;
+        posix_heap.free(column);
+    }
+    return r;
+}
+
+// render() kernels are ~6 times faster than deep() but fp64 pixel
+// coordinates lose precision below pixel size 1e-12: against long
+// double reference counts (off by more than 2 iterations) render() of
+// Seahorse valley (-0.743643887037151, 0.131825904205330) at 3000
+// iterations is wrong for 2% of pixels at 1e-12 (as at 1e-10), 8% at
+// 1e-13 and 20% at 1e-15 where deep() is wrong for 0.4%, 1.9% and
+// 3.7% (test/test4.c --bench: % of pixels where render() and deep()
+// differ).
+
+static bool ui_mandelbrot_is_deep(const struct ui_mandelbrot* m) {
+    return m->dx <= 1e-12 || m->dy <= 1e-12;
+}
+
+static int ui_mandelbrot_update(struct ui_mandelbrot* m) {
+    posix_assert(m->w > 0 && m->h > 0 && m->stride >= m->w);
+    const int64_t pixels = (int64_t)m->w * m->h;
+    int r = 0;
+    if (m->cache.capacity < pixels) {
+        // realloc() keeps the cached view for reuse below
+        r = posix_heap.realloc((void**)&m->cache.counts,
+                               pixels * (int64_t)sizeof(int32_t));
+        if (r == 0) {
+            r = posix_heap.realloc((void**)&m->cache.known, pixels);
+        }
+        if (r == 0) { m->cache.capacity = pixels; }
+    }
+    const bool deep = ui_mandelbrot_is_deep(m);
+    // deep() iterates pixel by pixel, render() kernels 8 pixels at most
+    int32_t stride = 1;
+    if (r == 0) { r = ui_mandelbrot_reuse(m, deep ? 1 : 8, &stride); }
+    if (r == 0) {
+        if (deep && m->cache.computed > 0) {
+            r = ui_mandelbrot_reference(m);
+            if (r == 0) { ui_mandelbrot_series(m); }
+        } else if (!deep) {
+            m->x = ui_mandelbrot_fp64(&m->deep.cx) - (m->w / 2) * m->dx;
+            m->y = ui_mandelbrot_fp64(&m->deep.cy) - (m->h / 2) * m->dy;
+        }
+    }
+    if (r == 0) {
+        struct ui_mandelbrot_job job = {
+            .m = m, .row = deep ? ui_mandelbrot_row_deep : ui_mandelbrot_row_fp64,
+            .known = m->cache.known, .cache = m->cache.counts,
+            .stride = stride
+        };
+        ui_mandelbrot_tiles(&job);
+        m->cache.cx = m->deep.cx;
+        m->cache.cy = m->deep.cy;
+        m->cache.dx = m->dx;
+        m->cache.dy = m->dy;
+        m->cache.iterations = m->iterations;
+        m->cache.h = m->h;
+        // abandoned (.stop) update leaves the cache incomplete
+        m->cache.w = m->stop ? 0 : m->w;
+    } else {
+        m->cache.w = 0;
+    }
+    return r;
+}
+
+static void ui_mandelbrot_dispose(struct ui_mandelbrot* m) {
+    if (m->deep.orbit != null) { posix_heap.free(m->deep.orbit); }
+    m->deep.orbit = null;
+    m->deep.capacity = 0;
+    if (m->cache.counts != null) { posix_heap.free(m->cache.counts); }
+    if (m->cache.known != null) { posix_heap.free(m->cache.known); }
+    m->cache.counts = null;
+    m->cache.known = null;
+    m->cache.capacity = 0;
+    m->cache.w = 0;
+}
+
+static void ui_mandelbrot_test_tile(struct ui_mandelbrot* m, int32_t x,
+        int32_t y, int32_t w, int32_t h) {
+    // counts tiles per pixel in m->that, tiles are disjoint
+    uint8_t* covered = (uint8_t*)m->that;
+    for (int32_t j = y; j < y + h; j++) {
+        for (int32_t i = x; i < x + w; i++) {
+            covered[j * m->w + i]++;
+        }
+    }
+}
+
+static void ui_mandelbrot_test_view(int32_t isa, fp64_t cx, fp64_t cy,
+        fp64_t size, int32_t w, int32_t h, int32_t iterations) {
+    // every kernel against plain escape() of every pixel
+    static int32_t counts[150 * 150];
+    static uint8_t covered[150 * 150];
+    posix_assert(w * h <= posix_countof(counts));
+    memset(covered, 0x00, sizeof(covered));
+    struct ui_mandelbrot m = {
+        .x = cx - size / 2, .y = cy - size / 2,
+        .dx = size / w, .dy = size / w, .w = w, .h = h,
+        .iterations = iterations, .counts = counts, .stride = w,
+        .tile = ui_mandelbrot_test_tile, .that = covered
+    };
+    posix_swear(ui_mandelbrot.use(isa));
+    ui_mandelbrot.render(&m);
+    for (int32_t j = 0; j < h; j++) {
+        for (int32_t i = 0; i < w; i++) {
+            const int32_t e = ui_mandelbrot.escape(m.x + (fp64_t)i * m.dx,
+                                  m.y + (fp64_t)j * m.dy, iterations);
+            posix_swear(counts[j * w + i] == e && covered[j * w + i] == 1,
+                        "isa: %d %d,%d %d != %d", isa, i, j,
+                        counts[j * w + i], e);
+        }
+    }
+}
+
+static int32_t ui_mandelbrot_test_fixed(const struct ui_mandelbrot_fixed* cx,
+        const struct ui_mandelbrot_fixed* cy, int32_t iterations) {
+    // plain iteration of a single point in fixed point (slow reference)
+    struct ui_mandelbrot_fixed x = {0};
+    struct ui_mandelbrot_fixed y = {0};
+    struct ui_mandelbrot_fixed xx;
+    struct ui_mandelbrot_fixed yy;
+    struct ui_mandelbrot_fixed xy;
+    int32_t n = 0;
+    bool escaped = false;
+    while (n < iterations && !escaped) {
+        ui_mandelbrot_mul(&xx, &x, &x);
+        ui_mandelbrot_mul(&yy, &y, &y);
+        ui_mandelbrot_mul(&xy, &x, &y);
+        ui_mandelbrot_negate(&yy);
+        ui_mandelbrot_sum(&x, &xx, &yy);
+        ui_mandelbrot_sum(&x, &x, cx);
+        ui_mandelbrot_sum(&y, &xy, &xy);
+        ui_mandelbrot_sum(&y, &y, cy);
+        n++;
+        const fp64_t fx = ui_mandelbrot_fp64(&x);
+        const fp64_t fy = ui_mandelbrot_fp64(&y);
+        escaped = fx * fx + fy * fy > 4.0;
+    }
+    return n;
+}
+
+static void ui_mandelbrot_test_deep(fp64_t cx, fp64_t cy, fp64_t ox,
+        fp64_t oy, fp64_t size, int32_t iterations) {
+    // deep() at center (cx, cy) + (ox, oy) * size against plain fixed
+    // point iteration of sampled pixels
+    enum { w = 48, h = 40 };
+    static int32_t counts[w * h];
+    struct ui_mandelbrot m = {
+        .dx = size / w, .dy = size / w, .w = w, .h = h,
+        .iterations = iterations, .counts = counts, .stride = w
+    };
+    ui_mandelbrot.fixed(&m.deep.cx, cx);
+    ui_mandelbrot.fixed(&m.deep.cy, cy);
+    ui_mandelbrot.add(&m.deep.cx, ox * size);
+    ui_mandelbrot.add(&m.deep.cy, oy * size);
+    posix_swear(ui_mandelbrot.deep(&m) == 0);
+    for (int32_t j = 1; j < h; j += 7) {
+        for (int32_t i = 0; i < w; i += 5) {
+            struct ui_mandelbrot_fixed x = m.deep.cx;
+            struct ui_mandelbrot_fixed y = m.deep.cy;
+            ui_mandelbrot.add(&x, (i - w / 2) * m.dx);
+            ui_mandelbrot.add(&y, (j - h / 2) * m.dy);
+            const int32_t e = ui_mandelbrot_test_fixed(&x, &y, iterations);
+            posix_swear(counts[j * w + i] == e, "size: %.1e %d,%d %d != %d",
+                        size, i, j, counts[j * w + i], e);
+        }
+    }
+    ui_mandelbrot.dispose(&m);
+    posix_swear(m.deep.orbit == null && m.deep.capacity == 0);
+}
+
+static void ui_mandelbrot_test_shallow(void) {
+    // deep() is the same as render() where fp64 is precise enough
+    enum { w = 64, h = 64 };
+    static int32_t deep[w * h];
+    static int32_t plain[w * h];
+    struct ui_mandelbrot m = {
+        .dx = 1e-6 / w, .dy = 1e-6 / w, .w = w, .h = h,
+        .iterations = 2000, .counts = deep, .stride = w
+    };
+    ui_mandelbrot.fixed(&m.deep.cx, -0.745);
+    ui_mandelbrot.fixed(&m.deep.cy, 0.113);
+    posix_swear(ui_mandelbrot.deep(&m) == 0);
+    m.x = ui_mandelbrot.fp64(&m.deep.cx) - (w / 2) * m.dx;
+    m.y = ui_mandelbrot.fp64(&m.deep.cy) - (h / 2) * m.dy;
+    m.counts = plain;
+    ui_mandelbrot.render(&m);
+    posix_swear(memcmp(deep, plain, sizeof(deep)) == 0);
+    ui_mandelbrot.dispose(&m);
+}
+
+static void ui_mandelbrot_test_arithmetic(void) {
+    struct ui_mandelbrot_fixed f;
+    const fp64_t values[] = { 0, 1, -1, 0.5, -0.75, 1.0 / 3, -2.1e-10, 5.25,
+                              1e-30, -3.7e-100 };
+    for (int32_t i = 0; i < posix_countof(values); i++) {
+        ui_mandelbrot.fixed(&f, values[i]);
+        posix_swear(ui_mandelbrot.fp64(&f) == values[i]);
+    }
+    // bits far below fp64 precision survive: (1 + 2^-300) - 1 = 2^-300
+    ui_mandelbrot.fixed(&f, 1.0);
+    ui_mandelbrot.add(&f, ldexp(1.0, -300));
+    ui_mandelbrot.add(&f, -1.0);
+    posix_swear(f.limb[10] == 1u << 20); // 2^20 * 2^(-32 * 10)
+    for (int32_t i = 0; i < ui_mandelbrot_limbs; i++) {
+        posix_swear(i == 10 || f.limb[i] == 0);
+    }
+    struct ui_mandelbrot_fixed a;
+    struct ui_mandelbrot_fixed b;
+    ui_mandelbrot.fixed(&a, -1.5);
+    ui_mandelbrot.fixed(&b, 0.25);
+    ui_mandelbrot_mul(&f, &a, &b);
+    posix_swear(ui_mandelbrot.fp64(&f) == -0.375);
+    ui_mandelbrot_mul(&f, &a, &a);
+    posix_swear(ui_mandelbrot.fp64(&f) == 2.25);
+}
+
+static void ui_mandelbrot_test_same(struct ui_mandelbrot* m) {
+    // update() with reuse against full update() of the same view
+    enum { w = 150, h = 100 };
+    static int32_t counts[w * h];
+    posix_assert(m->w == w && m->h == h && m->stride == w);
+    struct ui_mandelbrot full = *m;
+    memset(&full.deep, 0x00, sizeof(full.deep));
+    memset(&full.cache, 0x00, sizeof(full.cache));
+    full.deep.cx = m->deep.cx;
+    full.deep.cy = m->deep.cy;
+    full.counts = counts;
+    full.tile = null;
+    posix_swear(ui_mandelbrot.update(&full) == 0);
+    posix_swear(full.cache.computed == w * h && full.cache.reused == 0);
+    posix_swear(memcmp(m->counts, counts, sizeof(counts)) == 0);
+    ui_mandelbrot.dispose(&full);
+}
+
+static void ui_mandelbrot_test_zoom(struct ui_mandelbrot* m, int32_t x,
+        int32_t y, bool in) {
+    // zoom in or out keeping complex point of pixel x, y in place
+    const fp64_t f = in ? 0.5 : -1.0;
+    ui_mandelbrot.add(&m->deep.cx, (x - m->w / 2) * m->dx * f);
+    ui_mandelbrot.add(&m->deep.cy, (y - m->h / 2) * m->dy * f);
+    m->dx = in ? m->dx / 2 : m->dx * 2;
+    m->dy = in ? m->dy / 2 : m->dy * 2;
+    posix_swear(ui_mandelbrot.update(m) == 0);
+    ui_mandelbrot_test_same(m);
+}
+
+static void ui_mandelbrot_test_update(fp64_t cx, fp64_t cy, fp64_t size,
+        int32_t iterations) {
+    enum { w = 150, h = 100 };
+    static int32_t counts[w * h];
+    static uint8_t covered[w * h];
+    memset(covered, 0x00, sizeof(covered));
+    struct ui_mandelbrot m = {
+        .dx = size / 128, .dy = size / 128, .w = w, .h = h,
+        .iterations = iterations, .counts = counts, .stride = w,
+        .tile = ui_mandelbrot_test_tile, .that = covered
+    };
+    ui_mandelbrot.fixed(&m.deep.cx, cx);
+    ui_mandelbrot.fixed(&m.deep.cy, cy);
+    posix_swear(ui_mandelbrot.update(&m) == 0);
+    posix_swear(m.cache.computed == w * h && m.cache.reused == 0);
+    for (int32_t i = 0; i < w * h; i++) { posix_swear(covered[i] == 1); }
+    // same view again: nothing to compute, all tiles are reported
+    posix_swear(ui_mandelbrot.update(&m) == 0);
+    posix_swear(m.cache.computed == 0);
+    for (int32_t i = 0; i < w * h; i++) { posix_swear(covered[i] == 2); }
+    m.tile = null;
+    ui_mandelbrot_test_same(&m);
+    // pan: only exposed strips are computed
+    ui_mandelbrot.add(&m.deep.cx, 13 * m.dx);
+    ui_mandelbrot.add(&m.deep.cy, -7 * m.dy);
+    posix_swear(ui_mandelbrot.update(&m) == 0);
+    posix_swear(m.cache.computed == 13 * h + 7 * w - 13 * 7);
+    ui_mandelbrot_test_same(&m);
+    // zoom: every other pixel of every other row is reused (render()
+    // kernels iterate the gaps between them every other column)
+    const bool deep = ui_mandelbrot_is_deep(&m);
+    ui_mandelbrot_test_zoom(&m, 37, 20, true);
+    posix_swear(m.cache.reused == (w / 2) * (h / 2));
+    ui_mandelbrot_test_zoom(&m, 37, 20, false);
+    posix_swear(m.cache.reused == (w / 2) * (h / 2));
+    ui_mandelbrot_test_zoom(&m, 100, 61, false); // odd: half pixel shift
+    ui_mandelbrot_test_zoom(&m, 11, 98, true);
+    // more iterations: only pixels that did not escape are computed
+    int64_t inside = 0;
+    for (int32_t i = 0; i < w * h; i++) { inside += counts[i] == m.iterations; }
+    m.iterations *= 2;
+    posix_swear(ui_mandelbrot.update(&m) == 0);
+    posix_swear(deep ? m.cache.computed == inside : m.cache.computed >= inside);
+    ui_mandelbrot_test_same(&m);
+    m.iterations /= 2;
+    posix_swear(ui_mandelbrot.update(&m) == 0);
+    posix_swear(m.cache.computed == 0);
+    ui_mandelbrot_test_same(&m);
+    // pan by a fraction of a pixel or too far: nothing is reused
+    ui_mandelbrot.add(&m.deep.cx, m.dx / 3);
+    posix_swear(ui_mandelbrot.update(&m) == 0);
+    posix_swear(m.cache.reused == 0);
+    ui_mandelbrot.add(&m.deep.cy, m.dy * h);
+    posix_swear(ui_mandelbrot.update(&m) == 0);
+    posix_swear(m.cache.reused == 0);
+    // abandoned update() invalidates the cache
+    m.stop = 1;
+    posix_swear(ui_mandelbrot.update(&m) == 0);
+    m.stop = 0;
+    posix_swear(ui_mandelbrot.update(&m) == 0);
+    posix_swear(m.cache.reused == 0);
+    ui_mandelbrot.dispose(&m);
+    posix_swear(m.cache.counts == null && m.cache.known == null);
+}
+
+static void ui_mandelbrot_test(void) {
+    const int32_t saved = ui_mandelbrot.isa();
+    posix_swear(ui_mandelbrot.escape(0, 0, 100) == 100);
+    posix_swear(ui_mandelbrot.escape(2, 2, 100) == 1);
+    posix_swear(ui_mandelbrot.escape(-2, 0, 100) == 100);
+    posix_swear(ui_mandelbrot.escape(0.25 + 1e-6, 0, 100) == 100);
+    // inside of period 3 bulb only periodicity check stops iterations:
+    posix_swear(!ui_mandelbrot_inside(-0.12, 0.75));
+    posix_swear(ui_mandelbrot_point(-0.12, 0.75, 1000000) == 1000000);
+    uint32_t seed = 1;
+    for (int32_t isa = ui_pixels_scalar; isa <= ui_pixels_neon; isa++) {
+        if (ui_pixels.supported(isa)) {
+            // whole set, seahorse valley, deep zoom into the edge:
+            ui_mandelbrot_test_view(isa, -0.75, 0.0, 3.0, 150, 150, 256);
+            ui_mandelbrot_test_view(isa, -0.745, 0.113, 1e-2, 129, 65, 1000);
+            ui_mandelbrot_test_view(isa, -0.743643887037151,
+                0.131825904205330, 1e-11, 67, 70, 4000);
+            for (int32_t k = 0; k < 16; k++) { // odd sizes, random views
+                const int32_t w = 1 + posix_num.random32(&seed) % 150;
+                const int32_t h = 1 + posix_num.random32(&seed) % 10;
+                const fp64_t x = (posix_num.random32(&seed) % 1000) / 400.0 - 2;
+                const fp64_t y = (posix_num.random32(&seed) % 1000) / 800.0 - 0.5;
+                const fp64_t size = 1.0 / (1 + posix_num.random32(&seed) % 1000);
+                ui_mandelbrot_test_view(isa, x, y, size, w, h, 500);
+            }
+        }
+    }
+    // stop before render() leaves counts intact and calls no tile():
+    static int32_t counts[8 * 8];
+    static uint8_t covered[8 * 8];
+    struct ui_mandelbrot m = {
+        .x = -2, .y = -1, .dx = 0.25, .dy = 0.25, .w = 8, .h = 8,
+        .iterations = 100, .counts = counts, .stride = 8,
+        .tile = ui_mandelbrot_test_tile, .that = covered, .stop = 1
+    };
+    ui_mandelbrot.render(&m);
+    for (int32_t i = 0; i < posix_countof(counts); i++) {
+        posix_swear(counts[i] == 0 && covered[i] == 0);
+    }
+    posix_swear(ui_mandelbrot.use(saved));
+    // deep zoom: perturbation against fixed point iteration at c = i
+    // (reference escapes, pixels rebase when it does) and c = -2 (orbit
+    // 0, -2, 2, 2... never escapes). Both are Misiurewicz points with
+    // structure at any depth. Views of period 3 nuclei mix escaping
+    // pixels with inside ones:
+    ui_mandelbrot_test_arithmetic();
+    ui_mandelbrot_test_shallow();
+    ui_mandelbrot_test_deep(0.0, 1.0, 0.37, 0.21, 1e-20, 2000);
+    ui_mandelbrot_test_deep(0.0, 1.0, 0.37, 0.21, 1e-100, 2000);
+    ui_mandelbrot_test_deep(-2.0, 0.0, 1.5, 0.21, 1e-60, 2000);
+    ui_mandelbrot_test_deep(-0.1225611668766536, 0.7448617666197442,
+                            0, 0, 0.3, 2000);
+    ui_mandelbrot_test_deep(-1.754877666246693, 0.0, 0, 0, 0.05, 2000);
+    // incremental update() with render() and deep() pixels:
+    ui_mandelbrot_test_update(-0.75, 0.1, 2.0, 256);
+    ui_mandelbrot_test_update(-0.745, 0.113, 1.0 / 64, 1000);
+    ui_mandelbrot_test_update(3.7e-31, 1.0, 1e-30, 2000); // next to c = i
+    if (posix_debug.verbosity.level > posix_debug.verbosity.quiet) {
+        posix_println("done");
+    }
+}
+
+struct ui_mandelbrot_if ui_mandelbrot = {
+    .render  = ui_mandelbrot_render,
+    .deep    = ui_mandelbrot_deep,
+    .update  = ui_mandelbrot_update,
+    .dispose = ui_mandelbrot_dispose,
+    .fixed   = ui_mandelbrot_fixed,
+    .add     = ui_mandelbrot_add,
+    .fp64    = ui_mandelbrot_fp64,
+    .escape  = ui_mandelbrot_escape,
+    .isa     = ui_mandelbrot_isa,
+    .use     = ui_mandelbrot_use,
+    .test    = ui_mandelbrot_test
+};
+
+#ifdef UI_MANDELBROT_TEST
+    posix_static_init(ui_mandelbrot) { ui_mandelbrot.test(); }
+#endif
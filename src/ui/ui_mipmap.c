@@ -0,0 +1,495 @@
+/* Copyright (c) Dmitry "Leo" Kuznetsov 2021-24 see LICENSE for details */
+#include "posix/posix.h"
+#include "ui/ui_core.h"
+#include "ui/ui_parallel.h"
+#include "ui/ui_resample.h"
+#include "ui/ui_mipmap.h"
+
+#undef UI_MIPMAP_TEST
+
+#if 0 // flip to 1 to run tests
+
+#define UI_MIPMAP_TEST
+
+#endif
+
+struct ui_mipmap_entry {
+    struct ui_bitmap bitmap; // .pixels heap allocated
+    int32_t slot; // -1 for free entries
+    int32_t prev; // circular LRU list (or free list via .next)
+    int32_t next;
+    int32_t pins; // in use by the builder, cannot be evicted
+};
+
+enum { ui_mipmap_queue_capacity = 1024 };
+
+static void ui_mipmap_init(struct ui_mipmap* m, const struct ui_bitmap* image,
+        int64_t budget) {
+    posix_swear(image->w > 0 && image->h > 0 && image->pixels != null);
+    posix_swear(image->bpp == 1 || image->bpp == 3 || image->bpp == 4);
+    memset(m, 0x00, sizeof(*m));
+    m->image = *image;
+    m->image.texture = null;
+    m->image.dxd = null;
+    m->budget = budget;
+    m->lru  = -1;
+    m->free = -1;
+    int32_t w = image->w;
+    int32_t h = image->h;
+    for (;;) {
+        const int32_t l = m->levels++;
+        m->w[l] = w;
+        m->h[l] = h;
+        m->nx[l] = (w + ui_mipmap_tile - 1) / ui_mipmap_tile;
+        m->ny[l] = (h + ui_mipmap_tile - 1) / ui_mipmap_tile;
+        m->offset[l] = l == 0 ? -1 : m->slots;
+        if (l > 0) { m->slots += m->nx[l] * m->ny[l]; }
+        if ((w <= ui_mipmap_tile && h <= ui_mipmap_tile) ||
+             m->levels == ui_mipmap_max_levels) {
+            break;
+        }
+        w = (w + 1) / 2;
+        h = (h + 1) / 2;
+    }
+    const int32_t n = posix_max(1, m->slots);
+    posix_fatal_if(posix_heap.alloc((void**)&m->slot, n * (int64_t)sizeof(int32_t)) != 0);
+    posix_fatal_if(posix_heap.alloc_zero((void**)&m->queued, n) != 0);
+    m->queue_capacity = ui_mipmap_queue_capacity;
+    posix_fatal_if(posix_heap.alloc((void**)&m->queue,
+                   m->queue_capacity * (int64_t)sizeof(int32_t)) != 0);
+    for (int32_t i = 0; i < n; i++) { m->slot[i] = -1; }
+    posix_mutex.init(&m->mutex);
+    m->wake = posix_event.create();
+}
+
+static int32_t ui_mipmap_level(const struct ui_mipmap* m, fp64_t scale) {
+    posix_swear(scale > 0);
+    int32_t l = 0;
+    while (l + 1 < m->levels && scale <= 1.0 / (fp64_t)(1LL << (l + 1))) {
+        l++;
+    }
+    return l;
+}
+
+static int32_t ui_mipmap_slot_of(const struct ui_mipmap* m, int32_t level,
+        int32_t tx, int32_t ty) {
+    posix_swear(0 < level && level < m->levels);
+    posix_swear(0 <= tx && tx < m->nx[level] && 0 <= ty && ty < m->ny[level]);
+    return m->offset[level] + ty * m->nx[level] + tx;
+}
+
+static struct ui_bitmap ui_mipmap_source(const struct ui_mipmap* m,
+        int32_t tx, int32_t ty) {
+    // level 0 tile is a view into the image pixels
+    posix_swear(0 <= tx && tx < m->nx[0] && 0 <= ty && ty < m->ny[0]);
+    const int32_t x = tx * ui_mipmap_tile;
+    const int32_t y = ty * ui_mipmap_tile;
+    struct ui_bitmap b = {
+        .pixels = (uint8_t*)m->image.pixels + (int64_t)y * m->image.stride +
+                  (int64_t)x * m->image.bpp,
+        .w = posix_min(ui_mipmap_tile, m->w[0] - x),
+        .h = posix_min(ui_mipmap_tile, m->h[0] - y),
+        .bpp = m->image.bpp,
+        .stride = m->image.stride
+    };
+    return b;
+}
+
+static void ui_mipmap_lru_remove(struct ui_mipmap* m, int32_t e) {
+    struct ui_mipmap_entry* en = m->entry;
+    if (en[e].next == e) {
+        m->lru = -1;
+    } else {
+        en[en[e].prev].next = en[e].next;
+        en[en[e].next].prev = en[e].prev;
+        if (m->lru == e) { m->lru = en[e].next; }
+    }
+    en[e].prev = -1;
+    en[e].next = -1;
+}
+
+static void ui_mipmap_lru_push(struct ui_mipmap* m, int32_t e) {
+    // most recently used first: m->lru, least recently used: its .prev
+    struct ui_mipmap_entry* en = m->entry;
+    if (m->lru < 0) {
+        en[e].prev = e;
+        en[e].next = e;
+    } else {
+        const int32_t head = m->lru;
+        en[e].next = head;
+        en[e].prev = en[head].prev;
+        en[en[head].prev].next = e;
+        en[head].prev = e;
+    }
+    m->lru = e;
+}
+
+static void ui_mipmap_touch(struct ui_mipmap* m, int32_t e) {
+    if (m->lru != e) {
+        ui_mipmap_lru_remove(m, e);
+        ui_mipmap_lru_push(m, e);
+    }
+}
+
+static int64_t ui_mipmap_bytes(const struct ui_bitmap* b) {
+    return (int64_t)b->stride * b->h;
+}
+
+static void ui_mipmap_evict(struct ui_mipmap* m, int64_t bytes) {
+    // evicts least recently used unpinned tiles until `bytes` fit
+    if (m->lru >= 0) {
+        struct ui_mipmap_entry* en = m->entry;
+        int32_t e = en[m->lru].prev;
+        int32_t n = 0;
+        while (m->lru >= 0 && m->bytes + bytes > m->budget && n < m->entries) {
+            const int32_t prev = en[e].prev;
+            if (en[e].pins == 0) {
+                ui_mipmap_lru_remove(m, e);
+                m->bytes -= ui_mipmap_bytes(&en[e].bitmap);
+                posix_heap.free(en[e].bitmap.pixels);
+                m->slot[en[e].slot] = -1;
+                memset(&en[e], 0x00, sizeof(en[e]));
+                en[e].slot = -1;
+                en[e].next = m->free;
+                m->free = e;
+                m->stats.evicted++;
+            }
+            e = prev;
+            n++;
+        }
+    }
+}
+
+static int32_t ui_mipmap_entry_alloc(struct ui_mipmap* m) {
+    if (m->free < 0) {
+        const int32_t n = m->entries == 0 ? 64 : m->entries * 2;
+        posix_fatal_if(posix_heap.realloc((void**)&m->entry,
+                       n * (int64_t)sizeof(m->entry[0])) != 0);
+        for (int32_t i = n - 1; i >= m->entries; i--) {
+            memset(&m->entry[i], 0x00, sizeof(m->entry[i]));
+            m->entry[i].slot = -1;
+            m->entry[i].next = m->free;
+            m->free = i;
+        }
+        m->entries = n;
+    }
+    const int32_t e = m->free;
+    m->free = m->entry[e].next;
+    return e;
+}
+
+static int32_t ui_mipmap_build(struct ui_mipmap* m, int32_t level,
+        int32_t tx, int32_t ty);
+
+struct ui_mipmap_children {
+    struct ui_mipmap* m;
+    int32_t level;
+    int32_t n;
+    int32_t x[4];
+    int32_t y[4];
+    int32_t e[4]; // pinned entries
+};
+
+static void ui_mipmap_build_child(void* that, int32_t i) {
+    struct ui_mipmap_children* c = (struct ui_mipmap_children*)that;
+    c->e[i] = ui_mipmap_build(c->m, c->level, c->x[i], c->y[i]);
+}
+
+static int32_t ui_mipmap_build(struct ui_mipmap* m, int32_t level,
+        int32_t tx, int32_t ty) {
+    // returns pinned entry of the tile, builds missing tiles below
+    const int32_t s = ui_mipmap_slot_of(m, level, tx, ty);
+    posix_mutex.lock(&m->mutex);
+    int32_t e = m->slot[s];
+    if (e >= 0) { m->entry[e].pins++; }
+    posix_mutex.unlock(&m->mutex);
+    if (e < 0) {
+        struct ui_mipmap_children c = { .m = m, .level = level - 1 };
+        for (int32_t j = 0; j < 2; j++) {
+            for (int32_t i = 0; i < 2; i++) {
+                c.x[c.n] = tx * 2 + i;
+                c.y[c.n] = ty * 2 + j;
+                c.e[c.n] = -1;
+                if (c.x[c.n] < m->nx[level - 1] && c.y[c.n] < m->ny[level - 1]) {
+                    c.n++;
+                }
+            }
+        }
+        if (level > 1) {
+            ui_parallel.for_each(c.n, ui_mipmap_build_child, &c);
+        }
+        struct ui_bitmap child[4];
+        posix_mutex.lock(&m->mutex); // .entry[] may be reallocated
+        for (int32_t k = 0; k < c.n; k++) {
+            child[k] = level == 1 ? ui_mipmap_source(m, c.x[k], c.y[k]) :
+                                    m->entry[c.e[k]].bitmap;
+        }
+        posix_mutex.unlock(&m->mutex);
+        const int32_t bpp = m->image.bpp;
+        struct ui_bitmap b = {
+            .w = posix_min(ui_mipmap_tile, m->w[level] - tx * ui_mipmap_tile),
+            .h = posix_min(ui_mipmap_tile, m->h[level] - ty * ui_mipmap_tile),
+            .bpp = bpp
+        };
+        b.stride = (b.w * bpp + 3) & ~3;
+        posix_fatal_if(posix_heap.alloc(&b.pixels, ui_mipmap_bytes(&b)) != 0);
+        for (int32_t k = 0; k < c.n; k++) {
+            // children are box filtered 2:1 into their quadrant of the tile
+            const int32_t qx = (c.x[k] - tx * 2) * ui_mipmap_tile / 2;
+            const int32_t qy = (c.y[k] - ty * 2) * ui_mipmap_tile / 2;
+            struct ui_bitmap q = {
+                .pixels = (uint8_t*)b.pixels + (int64_t)qy * b.stride + qx * bpp,
+                .w = (child[k].w + 1) / 2,
+                .h = (child[k].h + 1) / 2,
+                .bpp = bpp,
+                .stride = b.stride
+            };
+            ui_resample.scale(&q, &child[k], 0, 0, 0.5, ui_resample_box);
+        }
+        posix_mutex.lock(&m->mutex);
+        for (int32_t k = 0; k < c.n; k++) {
+            if (c.e[k] >= 0) { m->entry[c.e[k]].pins--; }
+        }
+        ui_mipmap_evict(m, ui_mipmap_bytes(&b));
+        e = ui_mipmap_entry_alloc(m);
+        m->entry[e].bitmap = b;
+        m->entry[e].slot = s;
+        m->entry[e].pins = 1;
+        ui_mipmap_lru_push(m, e);
+        m->slot[s] = e;
+        m->bytes += ui_mipmap_bytes(&b);
+        m->stats.built++;
+        posix_mutex.unlock(&m->mutex);
+    }
+    return e;
+}
+
+static void ui_mipmap_thread(void* p) {
+    struct ui_mipmap* m = (struct ui_mipmap*)p;
+    posix_thread.name("ui_mipmap");
+    while (posix_atomics.load32(&m->quit) == 0) {
+        posix_event.wait(m->wake);
+        bool more = true;
+        while (more && posix_atomics.load32(&m->quit) == 0) {
+            int32_t s = -1;
+            posix_mutex.lock(&m->mutex);
+            more = m->queue_n > 0;
+            if (more) {
+                s = m->queue[--m->queue_n];
+                m->queued[s] = 0;
+                m->building = 1;
+            }
+            posix_mutex.unlock(&m->mutex);
+            if (more) {
+                int32_t l = m->levels - 1;
+                while (s < m->offset[l]) { l--; }
+                const int32_t tx = (s - m->offset[l]) % m->nx[l];
+                const int32_t ty = (s - m->offset[l]) / m->nx[l];
+                const int32_t e = ui_mipmap_build(m, l, tx, ty);
+                posix_mutex.lock(&m->mutex);
+                m->entry[e].pins--;
+                m->building = 0;
+                posix_mutex.unlock(&m->mutex);
+                if (m->ready != null) { m->ready(m); }
+            }
+        }
+    }
+}
+
+static void ui_mipmap_request(struct ui_mipmap* m, int32_t s) {
+    // caller holds the mutex
+    if (!m->queued[s]) {
+        if (m->queue_n == m->queue_capacity) { // drop the oldest request
+            m->queued[m->queue[0]] = 0;
+            memmove(m->queue, m->queue + 1,
+                    (size_t)(m->queue_n - 1) * sizeof(m->queue[0]));
+            m->queue_n--;
+        }
+        m->queue[m->queue_n++] = s;
+        m->queued[s] = 1;
+        if (m->thread == null) {
+            m->thread = posix_thread.start(ui_mipmap_thread, m);
+        }
+        posix_event.set(m->wake);
+    }
+}
+
+static struct ui_bitmap ui_mipmap_find(struct ui_mipmap* m, int32_t level,
+        int32_t tx, int32_t ty, bool request) {
+    struct ui_bitmap b = {0};
+    if (level == 0) {
+        b = ui_mipmap_source(m, tx, ty);
+        if (request) { m->stats.hits++; }
+    } else {
+        const int32_t s = ui_mipmap_slot_of(m, level, tx, ty);
+        const int32_t e = m->slot[s];
+        if (e >= 0) {
+            ui_mipmap_touch(m, e);
+            b = m->entry[e].bitmap;
+            b.dxd = null; // caller's copy
+            if (request) { m->stats.hits++; }
+        } else if (request) {
+            m->stats.misses++;
+            ui_mipmap_request(m, s);
+        }
+    }
+    return b;
+}
+
+static struct ui_bitmap ui_mipmap_tile_of(struct ui_mipmap* m, int32_t level,
+        int32_t tx, int32_t ty) {
+    return ui_mipmap_find(m, level, tx, ty, true);
+}
+
+static struct ui_bitmap ui_mipmap_cached(struct ui_mipmap* m, int32_t level,
+        int32_t tx, int32_t ty) {
+    return ui_mipmap_find(m, level, tx, ty, false);
+}
+
+static void ui_mipmap_lock(struct ui_mipmap* m) {
+    posix_mutex.lock(&m->mutex);
+    for (int32_t i = 0; i < m->queue_n; i++) { m->queued[m->queue[i]] = 0; }
+    m->queue_n = 0;
+}
+
+static void ui_mipmap_unlock(struct ui_mipmap* m) {
+    posix_mutex.unlock(&m->mutex);
+}
+
+static bool ui_mipmap_idle(struct ui_mipmap* m) {
+    posix_mutex.lock(&m->mutex);
+    const bool idle = m->queue_n == 0 && m->building == 0;
+    posix_mutex.unlock(&m->mutex);
+    return idle;
+}
+
+static void ui_mipmap_dispose(struct ui_mipmap* m) {
+    if (m->thread != null) {
+        posix_atomics.exchange_int32(&m->quit, 1);
+        posix_event.set(m->wake);
+        posix_fatal_if(posix_thread.join(m->thread, -1) != 0);
+    }
+    for (int32_t i = 0; i < m->entries; i++) {
+        if (m->entry[i].slot >= 0) { posix_heap.free(m->entry[i].bitmap.pixels); }
+    }
+    if (m->entry != null) { posix_heap.free(m->entry); }
+    if (m->slot != null) { posix_heap.free(m->slot); }
+    if (m->queued != null) { posix_heap.free(m->queued); }
+    if (m->queue != null) { posix_heap.free(m->queue); }
+    if (m->wake != null) {
+        posix_event.dispose(m->wake);
+        posix_mutex.dispose(&m->mutex);
+    }
+    memset(m, 0x00, sizeof(*m));
+}
+
+static void ui_mipmap_test_wait(struct ui_mipmap* m) {
+    while (!ui_mipmap.idle(m)) { posix_thread.sleep_for(0.001); }
+}
+
+static void ui_mipmap_test_level(struct ui_mipmap* m, int32_t level,
+        const struct ui_bitmap* expected) {
+    // all tiles of the level composed are the same as level built
+    // from the whole image by repeated 2:1 box filtering
+    ui_mipmap.lock(m);
+    for (int32_t ty = 0; ty < m->ny[level]; ty++) {
+        for (int32_t tx = 0; tx < m->nx[level]; tx++) {
+            (void)ui_mipmap.tile(m, level, tx, ty);
+        }
+    }
+    ui_mipmap.unlock(m);
+    ui_mipmap_test_wait(m);
+    ui_mipmap.lock(m);
+    for (int32_t ty = 0; ty < m->ny[level]; ty++) {
+        for (int32_t tx = 0; tx < m->nx[level]; tx++) {
+            const struct ui_bitmap b = ui_mipmap.cached(m, level, tx, ty);
+            // tiny budget may have evicted tile already
+            for (int32_t y = 0; y < b.h && b.pixels != null; y++) {
+                const uint8_t* e = (const uint8_t*)expected->pixels +
+                    (int64_t)(ty * ui_mipmap_tile + y) * expected->stride +
+                    (int64_t)tx * ui_mipmap_tile * b.bpp;
+                const uint8_t* p = (const uint8_t*)b.pixels + (int64_t)y * b.stride;
+                posix_swear(memcmp(p, e, (size_t)(b.w * b.bpp)) == 0,
+                            "level: %d tile: %d,%d y: %d", level, tx, ty, y);
+            }
+        }
+    }
+    ui_mipmap.unlock(m);
+}
+
+static void ui_mipmap_test_image(int32_t w, int32_t h, int32_t bpp,
+        int64_t budget) {
+    uint32_t seed = (uint32_t)(w * h * bpp);
+    struct ui_bitmap level[ui_mipmap_max_levels] = {0};
+    level[0] = (struct ui_bitmap){ .w = w, .h = h, .bpp = bpp,
+                                   .stride = (w * bpp + 3) & ~3 };
+    posix_fatal_if(posix_heap.alloc(&level[0].pixels,
+                   ui_mipmap_bytes(&level[0])) != 0);
+    uint8_t* p = (uint8_t*)level[0].pixels;
+    for (int64_t i = 0; i < ui_mipmap_bytes(&level[0]); i++) {
+        p[i] = (uint8_t)posix_num.random32(&seed);
+    }
+    struct ui_mipmap m = {0};
+    ui_mipmap.init(&m, &level[0], budget);
+    posix_swear(m.w[m.levels - 1] <= ui_mipmap_tile &&
+                m.h[m.levels - 1] <= ui_mipmap_tile);
+    posix_swear(ui_mipmap.level(&m, 1.0) == 0);
+    posix_swear(ui_mipmap.level(&m, 0.51) == 0);
+    posix_swear(ui_mipmap.level(&m, 0.5) == posix_min(1, m.levels - 1));
+    posix_swear(ui_mipmap.level(&m, 1e-9) == m.levels - 1);
+    for (int32_t l = 1; l < m.levels; l++) {
+        struct ui_bitmap* b = &level[l];
+        b->w = m.w[l];
+        b->h = m.h[l];
+        b->bpp = bpp;
+        b->stride = (b->w * bpp + 3) & ~3;
+        posix_swear(b->w == (level[l - 1].w + 1) / 2);
+        posix_fatal_if(posix_heap.alloc(&b->pixels, ui_mipmap_bytes(b)) != 0);
+        ui_resample.scale(b, &level[l - 1], 0, 0, 0.5, ui_resample_box);
+    }
+    // coarse to fine and back: builds, hits and evictions
+    for (int32_t l = m.levels - 1; l > 0; l--) {
+        ui_mipmap_test_level(&m, l, &level[l]);
+    }
+    for (int32_t l = 1; l < m.levels; l++) {
+        ui_mipmap_test_level(&m, l, &level[l]);
+    }
+    int64_t pinned = 0;
+    for (int32_t i = 0; i < m.entries; i++) { pinned += m.entry[i].pins; }
+    posix_swear(pinned == 0);
+    posix_swear(m.bytes <= posix_max(m.budget,
+        (int64_t)ui_mipmap_tile * ui_mipmap_tile * bpp * 4 * m.levels));
+    if (budget < m.slots * (int64_t)ui_mipmap_tile * ui_mipmap_tile * bpp) {
+        posix_swear(m.stats.evicted > 0);
+    }
+    ui_mipmap.dispose(&m);
+    for (int32_t l = 0; l < posix_countof(level); l++) {
+        if (level[l].pixels != null) { posix_heap.free(level[l].pixels); }
+    }
+}
+
+static void ui_mipmap_test(void) {
+    ui_mipmap_test_image(1, 1, 4, 1LL << 20);
+    ui_mipmap_test_image(257, 255, 1, 1LL << 20);
+    ui_mipmap_test_image(1500, 901, 4, 1LL << 30);
+    ui_mipmap_test_image(1500, 901, 3, ui_mipmap_tile * ui_mipmap_tile * 3 * 3);
+    if (posix_debug.verbosity.level > posix_debug.verbosity.quiet) {
+        posix_println("done");
+    }
+}
+
+struct ui_mipmap_if ui_mipmap = {
+    .init    = ui_mipmap_init,
+    .level   = ui_mipmap_level,
+    .lock    = ui_mipmap_lock,
+    .tile    = ui_mipmap_tile_of,
+    .cached  = ui_mipmap_cached,
+    .unlock  = ui_mipmap_unlock,
+    .idle    = ui_mipmap_idle,
+    .dispose = ui_mipmap_dispose,
+    .test    = ui_mipmap_test
+};
+
+#ifdef UI_MIPMAP_TEST
+    posix_static_init(ui_mipmap) { ui_mipmap.test(); }
+#endif
@@ -0,0 +1,391 @@
+/* Copyright (c) Dmitry "Leo" Kuznetsov 2021-24 see LICENSE for details */
+#include "posix/posix.h"
+#include "ui/ui_core.h"
+#include "ui/ui_colors.h"
+#include "ui/ui_draw.h"
+#include "ui/ui_view.h"
+#include "ui/ui_nodes.h"
+
+#undef UI_NODES_TEST
+
+#if 0 // flip to 1 to run tests
+
+#define UI_NODES_TEST
+
+#endif
+
+static void ui_nodes_reserve(struct ui_nodes* ns, int32_t n) {
+    if (n > ns->capacity) {
+        const int32_t c = n > ns->capacity * 2 ?
+            (n > 16 ? n : 16) : ns->capacity * 2;
+        const size_t ints = (size_t)c * sizeof(int32_t);
+        posix_swear(posix_heap.realloc((void**)&ns->view,
+                    (size_t)c * sizeof(ns->view[0])) == 0);
+        posix_swear(posix_heap.realloc((void**)&ns->parent, ints) == 0);
+        posix_swear(posix_heap.realloc((void**)&ns->child,  ints) == 0);
+        posix_swear(posix_heap.realloc((void**)&ns->next,   ints) == 0);
+        posix_swear(posix_heap.realloc((void**)&ns->end,    ints) == 0);
+        posix_swear(posix_heap.realloc((void**)&ns->rc,
+                    (size_t)c * sizeof(ns->rc[0])) == 0);
+        posix_swear(posix_heap.realloc((void**)&ns->flags,
+                    (size_t)c * sizeof(ns->flags[0])) == 0);
+        posix_swear(posix_heap.realloc((void**)&ns->pass,
+                    (size_t)c * sizeof(ns->pass[0])) == 0);
+        ns->capacity = c;
+    }
+}
+
+static int32_t ui_nodes_build(struct ui_nodes* ns, struct ui_view* v,
+        int32_t parent) {
+    ui_nodes_reserve(ns, ns->n + 1);
+    const int32_t ix = ns->n++;
+    ns->view[ix]   = v;
+    ns->parent[ix] = parent;
+    ns->child[ix]  = -1;
+    ns->next[ix]   = -1;
+    ns->rc[ix]     = (struct ui_rect){ v->x, v->y, v->w, v->h };
+    ns->flags[ix]  = 0;
+    ns->pass[ix]   = 0;
+    v->p.node = ix;
+    int32_t prev = -1;
+    ui_view_for_each(v, c, {
+        const int32_t k = ui_nodes_build(ns, c, ix);
+        if (prev < 0) { ns->child[ix] = k; } else { ns->next[prev] = k; }
+        prev = k;
+    });
+    ns->end[ix] = ns->n;
+    return ix;
+}
+
+static void ui_nodes_changed(struct ui_nodes* ns) {
+    ns->valid = false;
+    ns->stats.changes++;
+}
+
+static void ui_nodes_update(struct ui_nodes* ns, const struct ui_view* root) {
+    if (ns->busy > 0) {
+        // for_each() is iterating the arrays, rebuild is deferred
+        if (root != ns->root) { ns->valid = false; }
+    } else if (root == null) {
+        ns->root = null;
+        ns->n = 0;
+        ns->valid = false;
+    } else if (!ns->valid || root != ns->root) {
+        ns->root = root;
+        ns->n = 0;
+        ui_nodes_build(ns, (struct ui_view*)root, -1);
+        ns->valid = true;
+        ns->stats.builds++;
+    }
+}
+
+static int32_t ui_nodes_index_of(const struct ui_nodes* ns,
+        const struct ui_view* v) {
+    const int32_t ix = v->p.node;
+    return ns->valid && 0 <= ix && ix < ns->n && ns->view[ix] == v ? ix : -1;
+}
+
+static bool ui_nodes_is_hidden(struct ui_nodes* ns, int32_t ix, uint32_t pass) {
+    posix_assert(pass != 0 && 0 <= ix && ix < ns->n);
+    if (ns->pass[ix] != pass) {
+        const int32_t p = ns->parent[ix];
+        const bool hidden = ns->view[ix]->state.hidden ||
+                            (p >= 0 && ui_nodes_is_hidden(ns, p, pass));
+        ns->flags[ix] = hidden ? (uint8_t)(ns->flags[ix] |  ui_node_hidden) :
+                                 (uint8_t)(ns->flags[ix] & ~ui_node_hidden);
+        ns->pass[ix] = pass;
+    }
+    return (ns->flags[ix] & ui_node_hidden) != 0;
+}
+
+static bool ui_nodes_in_tree(const struct ui_view* v, const struct ui_view* u) {
+    while (u != null && u != v) { u = u->parent; }
+    return u == v;
+}
+
+static void ui_nodes_recurse(struct ui_view* v,
+        void (*visit)(struct ui_view* v, void* that), void* that) {
+    visit(v, that);
+    ui_view_for_each(v, c, { ui_nodes_recurse(c, visit, that); });
+}
+
+struct ui_nodes_live { // sorted views of the subtree after changed()
+    struct ui_view** view;
+    int32_t n;
+    int32_t capacity;
+    int64_t changes; // ns->stats.changes at the time of collect()
+};
+
+static void ui_nodes_live_collect(struct ui_nodes_live* l, struct ui_view* v) {
+    if (l->n == l->capacity) {
+        const int32_t c = l->capacity < 16 ? 16 : l->capacity * 2;
+        posix_swear(posix_heap.realloc((void**)&l->view,
+                    (size_t)c * sizeof(l->view[0])) == 0);
+        l->capacity = c;
+    }
+    l->view[l->n++] = v;
+    ui_view_for_each(v, c, { ui_nodes_live_collect(l, c); });
+}
+
+static int ui_nodes_live_compare(const void* p1, const void* p2) {
+    const uintptr_t a = (uintptr_t)*(struct ui_view* const*)p1;
+    const uintptr_t b = (uintptr_t)*(struct ui_view* const*)p2;
+    return (a > b) - (a < b);
+}
+
+static bool ui_nodes_live_has(struct ui_nodes* ns, struct ui_nodes_live* l,
+        struct ui_view* v, struct ui_view* u) {
+    // `u` may point to a view freed by visit() thus it is never
+    // dereferenced: it is looked up among views still reachable
+    // from `v` collected after the last changed()
+    if (l->changes != ns->stats.changes) {
+        l->n = 0;
+        ui_nodes_live_collect(l, v);
+        qsort(l->view, (size_t)l->n, sizeof(l->view[0]), ui_nodes_live_compare);
+        l->changes = ns->stats.changes;
+    }
+    return bsearch(&u, l->view, (size_t)l->n, sizeof(l->view[0]),
+                   ui_nodes_live_compare) != null;
+}
+
+static void ui_nodes_for_each(struct ui_nodes* ns, struct ui_view* v,
+        void (*visit)(struct ui_view* v, void* that), void* that) {
+    ui_nodes_update(ns, ns->root);
+    const int32_t ix = ui_nodes_index_of(ns, v);
+    if (ix < 0) {
+        ui_nodes_recurse(v, visit, that);
+    } else {
+        ns->busy++;
+        struct ui_nodes_live live = { .changes = ns->stats.changes };
+        const int32_t end = ns->end[ix];
+        for (int32_t i = ix; i < end; i++) {
+            // after visit() added or removed views arrays are kept
+            // as they were (see update()) but each view is checked
+            struct ui_view* u = ns->view[i];
+            if (ns->valid || ui_nodes_live_has(ns, &live, v, u)) {
+                visit(u, that);
+            }
+        }
+        if (live.view != null) { posix_heap.free(live.view); }
+        ns->busy--;
+    }
+}
+
+static void ui_nodes_dispose(struct ui_nodes* ns) {
+    posix_assert(ns->busy == 0);
+    posix_heap.free(ns->view);
+    posix_heap.free(ns->parent);
+    posix_heap.free(ns->child);
+    posix_heap.free(ns->next);
+    posix_heap.free(ns->end);
+    posix_heap.free(ns->rc);
+    posix_heap.free(ns->flags);
+    posix_heap.free(ns->pass);
+    memset(ns, 0x00, sizeof(*ns));
+}
+
+enum { ui_nodes_test_views = 2000 };
+
+static struct ui_view ui_nodes_test_view[ui_nodes_test_views];
+
+static struct ui_view* ui_nodes_test_order[ui_nodes_test_views];
+
+static int32_t ui_nodes_test_count;
+
+static struct ui_nodes* ui_nodes_test_ns;
+
+static void ui_nodes_test_link(struct ui_view* p, struct ui_view* c) {
+    c->parent = p;
+    if (p->child == null) {
+        c->prev = c;
+        c->next = c;
+        p->child = c;
+    } else {
+        c->prev = p->child->prev;
+        c->next = p->child;
+        c->prev->next = c;
+        c->next->prev = c;
+    }
+}
+
+static void ui_nodes_test_unlink(struct ui_view* c) {
+    struct ui_view* p = c->parent;
+    if (c->next == c) {
+        p->child = null;
+    } else {
+        c->prev->next = c->next;
+        c->next->prev = c->prev;
+        if (p->child == c) { p->child = c->next; }
+    }
+    c->parent = null;
+    c->prev = null;
+    c->next = null;
+}
+
+static bool ui_nodes_test_hidden(const struct ui_view* v) {
+    while (v != null && !v->state.hidden) { v = v->parent; }
+    return v != null;
+}
+
+static void ui_nodes_test_visit(struct ui_view* v, void* that) {
+    posix_swear(that == ui_nodes_test_order);
+    ui_nodes_test_order[ui_nodes_test_count++] = v;
+}
+
+static void ui_nodes_test_remove(struct ui_view* v, void* that) {
+    // removes next sibling subtree (if any) while being iterated
+    struct ui_view* r = (struct ui_view*)that;
+    ui_nodes_test_order[ui_nodes_test_count++] = v;
+    if (v == r->prev && r->parent != null) {
+        ui_nodes_test_unlink(r);
+        ui_nodes.changed(ui_nodes_test_ns);
+    }
+}
+
+static void ui_nodes_test_free(struct ui_view* v, void* that) {
+    // frees sibling subtree `that[0]` (heap allocated views) on first
+    // visit; following visits must not touch freed views
+    struct ui_view** r = (struct ui_view**)that;
+    ui_nodes_test_order[ui_nodes_test_count++] = v;
+    if (r[0] != null && v == r[0]->prev) {
+        ui_nodes_test_unlink(r[0]);
+        ui_nodes.changed(ui_nodes_test_ns);
+        for (int32_t i = 0; r[i] != null; i++) { posix_heap.free(r[i]); }
+        r[0] = null;
+    }
+}
+
+static void ui_nodes_test_freed(void) {
+    // root -> a, b -> c, d (b, c, d are on the heap and freed by visit(a))
+    struct ui_view root = {0};
+    struct ui_view a = {0};
+    struct ui_view* r[4] = {0};
+    for (int32_t i = 0; i < 3; i++) {
+        posix_swear(posix_heap.alloc_zero((void**)&r[i], sizeof(*r[i])) == 0);
+    }
+    ui_nodes_test_link(&root, &a);
+    ui_nodes_test_link(&root, r[0]);
+    ui_nodes_test_link(r[0], r[1]);
+    ui_nodes_test_link(r[0], r[2]);
+    struct ui_nodes ns = {0};
+    ui_nodes_test_ns = &ns;
+    ui_nodes.update(&ns, &root);
+    posix_swear(ns.n == 5);
+    ui_nodes_test_count = 0;
+    ui_nodes.for_each(&ns, &root, ui_nodes_test_free, r);
+    posix_swear(ui_nodes_test_count == 2 && r[0] == null);
+    posix_swear(ui_nodes_test_order[0] == &root && ui_nodes_test_order[1] == &a);
+    ui_nodes.update(&ns, &root);
+    posix_swear(ns.n == 2);
+    ui_nodes.dispose(&ns);
+}
+
+static void ui_nodes_test_verify(struct ui_nodes* ns, uint32_t pass) {
+    struct ui_view* root = &ui_nodes_test_view[0];
+    ui_nodes_test_count = 0;
+    ui_nodes_recurse(root, ui_nodes_test_visit, ui_nodes_test_order);
+    posix_swear(ns->valid && ns->n == ui_nodes_test_count);
+    for (int32_t i = 0; i < ns->n; i++) {
+        struct ui_view* v = ns->view[i];
+        posix_swear(v == ui_nodes_test_order[i]);
+        posix_swear(ui_nodes.index_of(ns, v) == i);
+        const int32_t p = ns->parent[i];
+        posix_swear(p < 0 ? v == root : ns->view[p] == v->parent);
+        posix_swear(ns->child[i] < 0 ? v->child == null :
+                    ns->view[ns->child[i]] == v->child);
+        posix_swear(ns->next[i] < 0 ? v->parent == null ||
+                    v->next == v->parent->child :
+                    ns->view[ns->next[i]] == v->next);
+        posix_swear(i < ns->end[i] && ns->end[i] <= ns->n);
+        for (int32_t j = i + 1; j < ns->end[i]; j++) {
+            posix_swear(ui_nodes_in_tree(v, ns->view[j]));
+        }
+        posix_swear(ui_nodes.is_hidden(ns, i, pass) == ui_nodes_test_hidden(v));
+    }
+    int32_t k = ui_nodes_test_count;
+    ui_nodes_test_count = 0;
+    ui_nodes.for_each(ns, root, ui_nodes_test_visit, ui_nodes_test_order);
+    posix_swear(ui_nodes_test_count == k);
+    for (int32_t i = 0; i < k; i++) {
+        posix_swear(ui_nodes_test_order[i] == ns->view[i]);
+    }
+}
+
+static void ui_nodes_test(void) {
+    uint32_t seed = 1;
+    struct ui_view* v = ui_nodes_test_view;
+    memset(v, 0x00, sizeof(ui_nodes_test_view));
+    for (int32_t i = 1; i < ui_nodes_test_views; i++) {
+        // parents are earlier views: random depth and fan out
+        const int32_t p = (int32_t)(posix_num.random32(&seed) % (uint32_t)i);
+        ui_nodes_test_link(&v[p], &v[i]);
+        v[i].x = (int32_t)(posix_num.random32(&seed) % 1000);
+        v[i].w = (int32_t)(posix_num.random32(&seed) % 300);
+        v[i].state.hidden = posix_num.random32(&seed) % 20 == 0;
+    }
+    struct ui_nodes ns = {0};
+    posix_swear(ui_nodes.index_of(&ns, &v[0]) < 0);
+    ui_nodes.update(&ns, &v[0]);
+    posix_swear(ns.stats.builds == 1 && ns.rc[0].w == 0);
+    ui_nodes_test_verify(&ns, 1);
+    ui_nodes.update(&ns, &v[0]); // in sync: no rebuild
+    posix_swear(ns.stats.builds == 1);
+    // memoized is_hidden() is recomputed for the next pass
+    for (int32_t i = 1; i < ui_nodes_test_views; i += 7) {
+        v[i].state.hidden = !v[i].state.hidden;
+    }
+    ui_nodes_test_verify(&ns, 2);
+    // moved subtrees: rebuilt by next update()
+    for (int32_t i = 0; i < 50; i++) {
+        const int32_t c = 1 + (int32_t)(posix_num.random32(&seed) %
+                                        (ui_nodes_test_views - 1));
+        const int32_t p = (int32_t)(posix_num.random32(&seed) % (uint32_t)c);
+        ui_nodes_test_unlink(&v[c]);
+        ui_nodes_test_link(&v[p], &v[c]);
+    }
+    ui_nodes.changed(&ns);
+    posix_swear(ui_nodes.index_of(&ns, &v[0]) < 0);
+    ui_nodes.update(&ns, &v[0]);
+    posix_swear(ns.stats.builds == 2);
+    ui_nodes_test_verify(&ns, 3);
+    // views removed by visit() are skipped and update() is deferred
+    struct ui_view* r = null;
+    for (int32_t i = 1; i < ui_nodes_test_views && r == null; i++) {
+        if (v[i].child != null && v[i].parent->child != &v[i]) { r = &v[i]; }
+    }
+    posix_swear(r != null);
+    ui_nodes_test_ns = &ns;
+    const int32_t n = ns.n;
+    const int32_t removed = ns.end[r->p.node] - r->p.node;
+    ui_nodes_test_count = 0;
+    ui_nodes.for_each(&ns, &v[0], ui_nodes_test_remove, r);
+    posix_swear(r->parent == null && !ns.valid && ns.n == n);
+    posix_swear(ui_nodes_test_count == n - removed);
+    for (int32_t i = 0; i < ui_nodes_test_count; i++) {
+        posix_swear(ui_nodes_in_tree(&v[0], ui_nodes_test_order[i]));
+    }
+    ui_nodes.update(&ns, &v[0]);
+    posix_swear(ns.stats.builds == 3 && ns.n == n - removed);
+    ui_nodes_test_verify(&ns, 4);
+    // views not in nodes are iterated recursively
+    ui_nodes_test_count = 0;
+    ui_nodes.for_each(&ns, r, ui_nodes_test_visit, ui_nodes_test_order);
+    posix_swear(ui_nodes_test_count == removed);
+    ui_nodes.dispose(&ns);
+    ui_nodes_test_freed();
+    if (posix_debug.verbosity.level > posix_debug.verbosity.quiet) { posix_println("done"); }
+}
+
+struct ui_nodes_if ui_nodes = {
+    .changed   = ui_nodes_changed,
+    .update    = ui_nodes_update,
+    .index_of  = ui_nodes_index_of,
+    .is_hidden = ui_nodes_is_hidden,
+    .for_each  = ui_nodes_for_each,
+    .dispose   = ui_nodes_dispose,
+    .test      = ui_nodes_test
+};
+
+#ifdef UI_NODES_TEST
+    posix_static_init(ui_nodes) { ui_nodes.test(); }
+#endif
@@ -0,0 +1,208 @@
+/* Copyright (c) Dmitry "Leo" Kuznetsov 2021-24 see LICENSE for details */
+#include "posix/posix.h"
+#include "ui/ui_parallel.h"
+#if defined(_WIN32)
+#include "ui/ui_win32.h"
+#else
+#include <unistd.h>
+#endif
+
+#undef UI_PARALLEL_TEST
+
+#if 0 // flip to 1 to run tests
+
+#define UI_PARALLEL_TEST
+
+#endif
+
+enum { ui_parallel_max_workers = 63 };
+
+static struct {
+    posix_thread_t thread[ui_parallel_max_workers];
+    posix_event_t  wake[ui_parallel_max_workers];
+    posix_event_t  done;
+    int32_t workers;          // started
+    int32_t limit;            // 0: all cores
+    int32_t cores;            // 0: not yet known
+    void (*task)(void* that, int32_t i);
+    void* that;
+    int32_t n;
+    volatile int32_t next;    // next iteration to hand out
+    volatile int32_t pending; // workers still running current job
+    volatile int32_t busy;    // for_each() in progress
+    volatile int32_t quit;
+} ui_parallel_pool;
+
+static int32_t ui_parallel_cores(void) {
+    if (ui_parallel_pool.cores == 0) {
+        #if defined(_WIN32)
+            int32_t n = (int32_t)GetActiveProcessorCount(ALL_PROCESSOR_GROUPS);
+        #else
+            int32_t n = (int32_t)sysconf(_SC_NPROCESSORS_ONLN);
+        #endif
+        ui_parallel_pool.cores = posix_max(1, posix_min(n,
+                                           ui_parallel_max_workers + 1));
+    }
+    return ui_parallel_pool.cores;
+}
+
+static int32_t ui_parallel_threads(void) {
+    const int32_t cores = ui_parallel_cores();
+    const int32_t limit = ui_parallel_pool.limit;
+    return limit > 0 ? posix_min(limit, cores) : cores;
+}
+
+static void ui_parallel_limit(int32_t threads) {
+    posix_swear(threads >= 0);
+    ui_parallel_pool.limit = threads;
+}
+
+static void ui_parallel_run(void) {
+    const int32_t n = ui_parallel_pool.n;
+    for (;;) {
+        const int32_t i = posix_atomics.increment_int32(
+                                &ui_parallel_pool.next) - 1;
+        if (i >= n) { break; }
+        ui_parallel_pool.task(ui_parallel_pool.that, i);
+    }
+}
+
+static void ui_parallel_worker(void* p) {
+    const int32_t ix = (int32_t)(uintptr_t)p;
+    posix_thread.name("ui_parallel");
+    for (;;) {
+        posix_event.wait(ui_parallel_pool.wake[ix]);
+        if (posix_atomics.load32(&ui_parallel_pool.quit) != 0) { break; }
+        ui_parallel_run();
+        if (posix_atomics.decrement_int32(&ui_parallel_pool.pending) == 0) {
+            posix_event.set(ui_parallel_pool.done);
+        }
+    }
+}
+
+static void ui_parallel_start(int32_t workers) {
+    if (ui_parallel_pool.done == null) {
+        ui_parallel_pool.done = posix_event.create();
+    }
+    while (ui_parallel_pool.workers < workers) {
+        const int32_t ix = ui_parallel_pool.workers;
+        ui_parallel_pool.wake[ix] = posix_event.create();
+        ui_parallel_pool.thread[ix] = posix_thread.start(ui_parallel_worker,
+                                                   (void*)(uintptr_t)ix);
+        ui_parallel_pool.workers++;
+    }
+}
+
+static void ui_parallel_for_each(int32_t n,
+        void (*task)(void* that, int32_t i), void* that) {
+    const int32_t workers = posix_min(ui_parallel_threads(), n) - 1;
+    if (workers <= 0 ||
+        !posix_atomics.compare_exchange_int32(&ui_parallel_pool.busy, 0, 1)) {
+        for (int32_t i = 0; i < n; i++) { task(that, i); }
+    } else {
+        ui_parallel_start(workers);
+        ui_parallel_pool.task = task;
+        ui_parallel_pool.that = that;
+        ui_parallel_pool.n = n;
+        ui_parallel_pool.next = 0;
+        ui_parallel_pool.pending = workers;
+        posix_atomics.memory_fence();
+        for (int32_t i = 0; i < workers; i++) {
+            posix_event.set(ui_parallel_pool.wake[i]);
+        }
+        ui_parallel_run();
+        posix_event.wait(ui_parallel_pool.done);
+        ui_parallel_pool.task = null;
+        ui_parallel_pool.that = null;
+        posix_atomics.exchange_int32(&ui_parallel_pool.busy, 0);
+    }
+}
+
+static void ui_parallel_dispose(void) {
+    posix_swear(ui_parallel_pool.busy == 0);
+    posix_atomics.exchange_int32(&ui_parallel_pool.quit, 1);
+    for (int32_t i = 0; i < ui_parallel_pool.workers; i++) {
+        posix_event.set(ui_parallel_pool.wake[i]);
+    }
+    for (int32_t i = 0; i < ui_parallel_pool.workers; i++) {
+        posix_fatal_if(posix_thread.join(ui_parallel_pool.thread[i], -1) != 0);
+        posix_event.dispose(ui_parallel_pool.wake[i]);
+        ui_parallel_pool.thread[i] = null;
+        ui_parallel_pool.wake[i] = null;
+    }
+    if (ui_parallel_pool.done != null) {
+        posix_event.dispose(ui_parallel_pool.done);
+        ui_parallel_pool.done = null;
+    }
+    ui_parallel_pool.workers = 0;
+    ui_parallel_pool.quit = 0;
+}
+
+static volatile int32_t ui_parallel_test_sum;
+static volatile int32_t ui_parallel_test_calls;
+
+static void ui_parallel_test_nested(void* that, int32_t i) {
+    int32_t* hits = (int32_t*)that;
+    posix_atomics.increment_int32(&hits[i]);
+    posix_atomics.add_int32(&ui_parallel_test_sum, i);
+}
+
+static void ui_parallel_test_task(void* that, int32_t i) {
+    int32_t* hits = (int32_t*)that;
+    posix_atomics.increment_int32(&hits[i]);
+    posix_atomics.increment_int32(&ui_parallel_test_calls);
+    if (i % 97 == 0) { // nested for_each() runs inline
+        int32_t inner[8] = {0};
+        ui_parallel.for_each(posix_countof(inner), ui_parallel_test_nested,
+                             inner);
+        for (int32_t k = 0; k < posix_countof(inner); k++) {
+            posix_swear(inner[k] == 1);
+        }
+    }
+}
+
+static void ui_parallel_test(void) {
+    static int32_t hits[1000];
+    posix_swear(ui_parallel.cores() >= 1);
+    for (int32_t limit = 0; limit <= 3; limit++) {
+        ui_parallel.limit(limit);
+        posix_swear(ui_parallel.threads() >= 1);
+        for (int32_t n = 0; n <= posix_countof(hits); n += n < 8 ? 1 : 331) {
+            memset(hits, 0x00, sizeof(hits));
+            ui_parallel_test_calls = 0;
+            ui_parallel_test_sum = 0;
+            ui_parallel.for_each(n, ui_parallel_test_task, hits);
+            posix_swear(ui_parallel_test_calls == n);
+            for (int32_t i = 0; i < posix_countof(hits); i++) {
+                posix_swear(hits[i] == (i < n ? 1 : 0), "hits[%d]: %d n: %d",
+                            i, hits[i], n);
+            }
+            const int32_t nested = (n + 96) / 97; // i % 97 == 0 for i < n
+            posix_swear(ui_parallel_test_sum == nested * 28);
+        }
+    }
+    ui_parallel.dispose();
+    ui_parallel.limit(0);
+    // restarts after dispose()
+    memset(hits, 0x00, sizeof(hits));
+    ui_parallel_test_calls = 0;
+    ui_parallel.for_each(100, ui_parallel_test_task, hits);
+    posix_swear(ui_parallel_test_calls == 100);
+    ui_parallel.dispose();
+    if (posix_debug.verbosity.level > posix_debug.verbosity.quiet) {
+        posix_println("done threads: %d", ui_parallel.threads());
+    }
+}
+
+struct ui_parallel_if ui_parallel = {
+    .cores    = ui_parallel_cores,
+    .threads  = ui_parallel_threads,
+    .limit    = ui_parallel_limit,
+    .for_each = ui_parallel_for_each,
+    .dispose  = ui_parallel_dispose,
+    .test     = ui_parallel_test
+};
+
+#ifdef UI_PARALLEL_TEST
+    posix_static_init(ui_parallel) { ui_parallel.test(); }
+#endif
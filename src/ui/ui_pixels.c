@@ -0,0 +1,651 @@
+/* Copyright (c) Dmitry "Leo" Kuznetsov 2021-24 see LICENSE for details */
+#include "posix/posix.h"
+#include "ui/ui_pixels.h"
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__SSE2__)
+#include <emmintrin.h>
+#define ui_pixels_has_sse2
+#if defined(_M_X64) || defined(__x86_64__)
+#include <immintrin.h>
+#define ui_pixels_has_avx2
+#if defined(_MSC_VER)
+#include <intrin.h>
+#pragma warning(disable: 4752) // AVX instructions w/o /arch:AVX (run time dispatch)
+#define ui_pixels_avx2_target
+#else
+#define ui_pixels_avx2_target __attribute__((target("avx2")))
+#endif
+#endif
+#elif defined(_M_ARM64) || defined(__aarch64__)
+#include <arm_neon.h>
+#define ui_pixels_has_neon
+#endif
+
+#undef UI_PIXELS_TEST
+
+#if 0 // flip to 1 to run tests
+
+#define UI_PIXELS_TEST
+
+#endif
+
+struct ui_pixels_kernels {
+    void (*rgb)(uint8_t* d, const uint8_t* s, int64_t n);
+    void (*rgbx)(uint8_t* d, const uint8_t* s, int64_t n, bool swap);
+    void (*premultiply)(uint8_t* d, const uint8_t* s, int64_t n, bool swap);
+    void (*gray)(uint8_t* d, const uint8_t* s, int64_t n);
+    void (*unpremultiply)(uint8_t* d, const uint8_t* s, int64_t n);
+};
+
+// reciprocal: c * 255 / a == (c * recip[a] + 0x8000) >> 16
+
+static uint32_t ui_pixels_recip[256];
+
+static void ui_pixels_init_recip(void) {
+    ui_pixels_recip[0] = 0;
+    for (uint32_t a = 1; a < 256; a++) {
+        ui_pixels_recip[a] = (255u * 65536u + a / 2) / a;
+    }
+}
+
+static inline uint8_t ui_pixels_div255(uint32_t t) {
+    // t / 255 rounded down for t <= 255 * 255
+    return (uint8_t)((t + 1 + (t >> 8)) >> 8);
+}
+
+static inline uint8_t ui_pixels_unmul(uint32_t c, uint32_t r) {
+    const uint32_t u = (c * r + 0x8000) >> 16;
+    return (uint8_t)(u < 0xFF ? u : 0xFF);
+}
+
+// scalar reference kernels:
+
+static void ui_pixels_rgb_scalar(uint8_t* d, const uint8_t* s, int64_t n) {
+    for (int64_t i = 0; i < n; i++) {
+        const uint8_t r = s[0];
+        const uint8_t g = s[1];
+        const uint8_t b = s[2];
+        d[0] = b;
+        d[1] = g;
+        d[2] = r;
+        d += 3;
+        s += 3;
+    }
+}
+
+static void ui_pixels_rgbx_scalar(uint8_t* d, const uint8_t* s, int64_t n,
+        bool swap) {
+    const int32_t r = swap ? 2 : 0;
+    const int32_t b = swap ? 0 : 2;
+    for (int64_t i = 0; i < n; i++) {
+        const uint8_t c0 = s[r];
+        const uint8_t c1 = s[1];
+        const uint8_t c2 = s[b];
+        d[0] = c0;
+        d[1] = c1;
+        d[2] = c2;
+        d[3] = 0xFF;
+        d += 4;
+        s += 4;
+    }
+}
+
+static void ui_pixels_premultiply_scalar(uint8_t* d, const uint8_t* s,
+        int64_t n, bool swap) {
+    const int32_t r = swap ? 2 : 0;
+    const int32_t b = swap ? 0 : 2;
+    for (int64_t i = 0; i < n; i++) {
+        const uint32_t a = s[3];
+        const uint8_t c0 = ui_pixels_div255(s[r] * a);
+        const uint8_t c1 = ui_pixels_div255(s[1] * a);
+        const uint8_t c2 = ui_pixels_div255(s[b] * a);
+        d[0] = c0;
+        d[1] = c1;
+        d[2] = c2;
+        d[3] = (uint8_t)a;
+        d += 4;
+        s += 4;
+    }
+}
+
+static void ui_pixels_gray_scalar(uint8_t* d, const uint8_t* s, int64_t n) {
+    for (int64_t i = 0; i < n; i++) {
+        d[0] = s[i];
+        d[1] = s[i];
+        d[2] = s[i];
+        d[3] = 0xFF;
+        d += 4;
+    }
+}
+
+static void ui_pixels_unpremultiply_scalar(uint8_t* d, const uint8_t* s,
+        int64_t n) {
+    for (int64_t i = 0; i < n; i++) {
+        const uint8_t a = s[3];
+        const uint32_t r = ui_pixels_recip[a];
+        const uint8_t c0 = ui_pixels_unmul(s[0], r);
+        const uint8_t c1 = ui_pixels_unmul(s[1], r);
+        const uint8_t c2 = ui_pixels_unmul(s[2], r);
+        d[0] = c0;
+        d[1] = c1;
+        d[2] = c2;
+        d[3] = a;
+        d += 4;
+        s += 4;
+    }
+}
+
+static const struct ui_pixels_kernels ui_pixels_scalar_kernels = {
+    .rgb           = ui_pixels_rgb_scalar,
+    .rgbx          = ui_pixels_rgbx_scalar,
+    .premultiply   = ui_pixels_premultiply_scalar,
+    .gray          = ui_pixels_gray_scalar,
+    .unpremultiply = ui_pixels_unpremultiply_scalar
+};
+
+#if defined(ui_pixels_has_sse2)
+
+// SSE2 has no byte shuffle: R and B are swapped inside 32 bit lanes
+// with shifts and masks. rgb() and unpremultiply() are scalar.
+
+static inline __m128i ui_pixels_swap_sse2(__m128i v) {
+    const __m128i ga = _mm_set1_epi32((int32_t)0xFF00FF00);
+    const __m128i lo = _mm_set1_epi32(0xFF);
+    return _mm_or_si128(_mm_and_si128(v, ga),
+           _mm_or_si128(_mm_and_si128(_mm_srli_epi32(v, 16), lo),
+                        _mm_slli_epi32(_mm_and_si128(v, lo), 16)));
+}
+
+static void ui_pixels_rgbx_sse2(uint8_t* d, const uint8_t* s, int64_t n,
+        bool swap) {
+    const __m128i alpha = _mm_set1_epi32((int32_t)0xFF000000);
+    int64_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        __m128i v = _mm_loadu_si128((const __m128i*)(s + i * 4));
+        if (swap) { v = ui_pixels_swap_sse2(v); }
+        _mm_storeu_si128((__m128i*)(d + i * 4), _mm_or_si128(v, alpha));
+    }
+    ui_pixels_rgbx_scalar(d + i * 4, s + i * 4, n - i, swap);
+}
+
+static inline __m128i ui_pixels_mul_sse2(__m128i c) {
+    // 2 pixels of 16 bit channels multiplied by their alpha / 255
+    const __m128i a255 = _mm_set_epi16(255, 0, 0, 0, 255, 0, 0, 0);
+    const __m128i rgb  = _mm_set_epi16(0, -1, -1, -1, 0, -1, -1, -1);
+    const __m128i one  = _mm_set1_epi16(1);
+    __m128i a = _mm_shufflehi_epi16(_mm_shufflelo_epi16(c, 0xFF), 0xFF);
+    a = _mm_or_si128(_mm_and_si128(a, rgb), a255); // alpha * 255 / 255
+    const __m128i t = _mm_mullo_epi16(c, a);
+    return _mm_srli_epi16(_mm_add_epi16(_mm_add_epi16(t, one),
+                          _mm_srli_epi16(t, 8)), 8);
+}
+
+static void ui_pixels_premultiply_sse2(uint8_t* d, const uint8_t* s,
+        int64_t n, bool swap) {
+    const __m128i zero = _mm_setzero_si128();
+    int64_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        const __m128i v = _mm_loadu_si128((const __m128i*)(s + i * 4));
+        const __m128i lo = ui_pixels_mul_sse2(_mm_unpacklo_epi8(v, zero));
+        const __m128i hi = ui_pixels_mul_sse2(_mm_unpackhi_epi8(v, zero));
+        __m128i p = _mm_packus_epi16(lo, hi);
+        if (swap) { p = ui_pixels_swap_sse2(p); }
+        _mm_storeu_si128((__m128i*)(d + i * 4), p);
+    }
+    ui_pixels_premultiply_scalar(d + i * 4, s + i * 4, n - i, swap);
+}
+
+static void ui_pixels_gray_sse2(uint8_t* d, const uint8_t* s, int64_t n) {
+    const __m128i alpha = _mm_set1_epi32((int32_t)0xFF000000);
+    int64_t i = 0;
+    for (; i + 16 <= n; i += 16) {
+        const __m128i g  = _mm_loadu_si128((const __m128i*)(s + i));
+        const __m128i lo = _mm_unpacklo_epi8(g, g);
+        const __m128i hi = _mm_unpackhi_epi8(g, g);
+        __m128i* o = (__m128i*)(d + i * 4);
+        _mm_storeu_si128(o + 0, _mm_or_si128(_mm_unpacklo_epi16(lo, lo), alpha));
+        _mm_storeu_si128(o + 1, _mm_or_si128(_mm_unpackhi_epi16(lo, lo), alpha));
+        _mm_storeu_si128(o + 2, _mm_or_si128(_mm_unpacklo_epi16(hi, hi), alpha));
+        _mm_storeu_si128(o + 3, _mm_or_si128(_mm_unpackhi_epi16(hi, hi), alpha));
+    }
+    ui_pixels_gray_scalar(d + i * 4, s + i, n - i);
+}
+
+static const struct ui_pixels_kernels ui_pixels_sse2_kernels = {
+    .rgb           = ui_pixels_rgb_scalar,
+    .rgbx          = ui_pixels_rgbx_sse2,
+    .premultiply   = ui_pixels_premultiply_sse2,
+    .gray          = ui_pixels_gray_sse2,
+    .unpremultiply = ui_pixels_unpremultiply_scalar
+};
+
+#endif // ui_pixels_has_sse2
+
+#if defined(ui_pixels_has_avx2)
+
+ui_pixels_avx2_target
+static void ui_pixels_rgb_avx2(uint8_t* d, const uint8_t* s, int64_t n) {
+    // 5 pixels (15 bytes) per 16 bytes shuffle, byte 15 is kept
+    // as it was thus in place conversion is possible
+    const __m128i k = _mm_setr_epi8(2, 1, 0, 5, 4, 3, 8, 7, 6,
+                                    11, 10, 9, 14, 13, 12, 15);
+    const int64_t bytes = n * 3;
+    int64_t i = 0;
+    for (; i + 16 <= bytes; i += 15) {
+        const __m128i v = _mm_loadu_si128((const __m128i*)(s + i));
+        _mm_storeu_si128((__m128i*)(d + i), _mm_shuffle_epi8(v, k));
+    }
+    ui_pixels_rgb_scalar(d + i, s + i, (bytes - i) / 3);
+}
+
+ui_pixels_avx2_target
+static inline __m256i ui_pixels_swap_avx2(__m256i v) {
+    const __m256i k = _mm256_setr_epi8(
+        2, 1, 0, 3, 6, 5, 4, 7, 10, 9, 8, 11, 14, 13, 12, 15,
+        2, 1, 0, 3, 6, 5, 4, 7, 10, 9, 8, 11, 14, 13, 12, 15);
+    return _mm256_shuffle_epi8(v, k);
+}
+
+ui_pixels_avx2_target
+static void ui_pixels_rgbx_avx2(uint8_t* d, const uint8_t* s, int64_t n,
+        bool swap) {
+    const __m256i alpha = _mm256_set1_epi32((int32_t)0xFF000000);
+    int64_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        __m256i v = _mm256_loadu_si256((const __m256i*)(s + i * 4));
+        if (swap) { v = ui_pixels_swap_avx2(v); }
+        _mm256_storeu_si256((__m256i*)(d + i * 4), _mm256_or_si256(v, alpha));
+    }
+    ui_pixels_rgbx_scalar(d + i * 4, s + i * 4, n - i, swap);
+}
+
+ui_pixels_avx2_target
+static inline __m256i ui_pixels_mul_avx2(__m256i c) {
+    const __m256i a255 = _mm256_set_epi16(255, 0, 0, 0, 255, 0, 0, 0,
+                                          255, 0, 0, 0, 255, 0, 0, 0);
+    const __m256i rgb  = _mm256_set_epi16(0, -1, -1, -1, 0, -1, -1, -1,
+                                          0, -1, -1, -1, 0, -1, -1, -1);
+    const __m256i one  = _mm256_set1_epi16(1);
+    __m256i a = _mm256_shufflehi_epi16(_mm256_shufflelo_epi16(c, 0xFF), 0xFF);
+    a = _mm256_or_si256(_mm256_and_si256(a, rgb), a255);
+    const __m256i t = _mm256_mullo_epi16(c, a);
+    return _mm256_srli_epi16(_mm256_add_epi16(_mm256_add_epi16(t, one),
+                             _mm256_srli_epi16(t, 8)), 8);
+}
+
+ui_pixels_avx2_target
+static void ui_pixels_premultiply_avx2(uint8_t* d, const uint8_t* s,
+        int64_t n, bool swap) {
+    // unpack and pack work inside 128 bit lanes thus order is kept
+    const __m256i zero = _mm256_setzero_si256();
+    int64_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        const __m256i v = _mm256_loadu_si256((const __m256i*)(s + i * 4));
+        const __m256i lo = ui_pixels_mul_avx2(_mm256_unpacklo_epi8(v, zero));
+        const __m256i hi = ui_pixels_mul_avx2(_mm256_unpackhi_epi8(v, zero));
+        __m256i p = _mm256_packus_epi16(lo, hi);
+        if (swap) { p = ui_pixels_swap_avx2(p); }
+        _mm256_storeu_si256((__m256i*)(d + i * 4), p);
+    }
+    ui_pixels_premultiply_scalar(d + i * 4, s + i * 4, n - i, swap);
+}
+
+ui_pixels_avx2_target
+static void ui_pixels_gray_avx2(uint8_t* d, const uint8_t* s, int64_t n) {
+    const __m256i alpha = _mm256_set1_epi32((int32_t)0xFF000000);
+    const __m256i ggg   = _mm256_set1_epi32(0x00010101);
+    int64_t i = 0;
+    for (; i + 16 <= n; i += 16) {
+        const __m128i g = _mm_loadu_si128((const __m128i*)(s + i));
+        const __m256i lo = _mm256_cvtepu8_epi32(g);
+        const __m256i hi = _mm256_cvtepu8_epi32(_mm_srli_si128(g, 8));
+        __m256i* o = (__m256i*)(d + i * 4);
+        _mm256_storeu_si256(o + 0,
+            _mm256_or_si256(_mm256_mullo_epi32(lo, ggg), alpha));
+        _mm256_storeu_si256(o + 1,
+            _mm256_or_si256(_mm256_mullo_epi32(hi, ggg), alpha));
+    }
+    ui_pixels_gray_scalar(d + i * 4, s + i, n - i);
+}
+
+ui_pixels_avx2_target
+static inline __m256i ui_pixels_unmul_avx2(__m256i c, __m256i r) {
+    const __m256i half = _mm256_set1_epi32(0x8000);
+    const __m256i ff   = _mm256_set1_epi32(0xFF);
+    const __m256i u = _mm256_srli_epi32(
+        _mm256_add_epi32(_mm256_mullo_epi32(c, r), half), 16);
+    return _mm256_min_epu32(u, ff);
+}
+
+ui_pixels_avx2_target
+static void ui_pixels_unpremultiply_avx2(uint8_t* d, const uint8_t* s,
+        int64_t n) {
+    const __m256i ff = _mm256_set1_epi32(0xFF);
+    const __m256i am = _mm256_set1_epi32((int32_t)0xFF000000);
+    int64_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        const __m256i v = _mm256_loadu_si256((const __m256i*)(s + i * 4));
+        const __m256i r = _mm256_i32gather_epi32(
+            (const int*)ui_pixels_recip, _mm256_srli_epi32(v, 24), 4);
+        const __m256i c0 = ui_pixels_unmul_avx2(_mm256_and_si256(v, ff), r);
+        const __m256i c1 = ui_pixels_unmul_avx2(
+            _mm256_and_si256(_mm256_srli_epi32(v, 8), ff), r);
+        const __m256i c2 = ui_pixels_unmul_avx2(
+            _mm256_and_si256(_mm256_srli_epi32(v, 16), ff), r);
+        const __m256i p = _mm256_or_si256(
+            _mm256_or_si256(c0, _mm256_slli_epi32(c1, 8)),
+            _mm256_or_si256(_mm256_slli_epi32(c2, 16), _mm256_and_si256(v, am)));
+        _mm256_storeu_si256((__m256i*)(d + i * 4), p);
+    }
+    ui_pixels_unpremultiply_scalar(d + i * 4, s + i * 4, n - i);
+}
+
+static const struct ui_pixels_kernels ui_pixels_avx2_kernels = {
+    .rgb           = ui_pixels_rgb_avx2,
+    .rgbx          = ui_pixels_rgbx_avx2,
+    .premultiply   = ui_pixels_premultiply_avx2,
+    .gray          = ui_pixels_gray_avx2,
+    .unpremultiply = ui_pixels_unpremultiply_avx2
+};
+
+static bool ui_pixels_cpu_avx2(void) {
+    #if defined(_MSC_VER)
+        int32_t r[4] = {0};
+        __cpuid(r, 0);
+        bool avx2 = r[0] >= 7;
+        if (avx2) {
+            __cpuid(r, 1);
+            // OSXSAVE and AVX and OS saves YMM registers:
+            avx2 = (r[2] & (1 << 27)) != 0 && (r[2] & (1 << 28)) != 0 &&
+                   (_xgetbv(0) & 0x6) == 0x6;
+        }
+        if (avx2) {
+            __cpuidex(r, 7, 0);
+            avx2 = (r[1] & (1 << 5)) != 0;
+        }
+        return avx2;
+    #else
+        __builtin_cpu_init();
+        return __builtin_cpu_supports("avx2");
+    #endif
+}
+
+#endif // ui_pixels_has_avx2
+
+#if defined(ui_pixels_has_neon)
+
+// NEON has interleaved loads and stores of 3 and 4 channels.
+// unpremultiply() is scalar (no gather of reciprocals).
+
+static void ui_pixels_rgb_neon(uint8_t* d, const uint8_t* s, int64_t n) {
+    int64_t i = 0;
+    for (; i + 16 <= n; i += 16) {
+        uint8x16x3_t v = vld3q_u8(s + i * 3);
+        const uint8x16_t r = v.val[0];
+        v.val[0] = v.val[2];
+        v.val[2] = r;
+        vst3q_u8(d + i * 3, v);
+    }
+    ui_pixels_rgb_scalar(d + i * 3, s + i * 3, n - i);
+}
+
+static void ui_pixels_rgbx_neon(uint8_t* d, const uint8_t* s, int64_t n,
+        bool swap) {
+    int64_t i = 0;
+    for (; i + 16 <= n; i += 16) {
+        uint8x16x4_t v = vld4q_u8(s + i * 4);
+        if (swap) {
+            const uint8x16_t r = v.val[0];
+            v.val[0] = v.val[2];
+            v.val[2] = r;
+        }
+        v.val[3] = vdupq_n_u8(0xFF);
+        vst4q_u8(d + i * 4, v);
+    }
+    ui_pixels_rgbx_scalar(d + i * 4, s + i * 4, n - i, swap);
+}
+
+static inline uint8x8_t ui_pixels_div255_neon(uint16x8_t t) {
+    const uint16x8_t one = vdupq_n_u16(1);
+    return vshrn_n_u16(vaddq_u16(vaddq_u16(t, one), vshrq_n_u16(t, 8)), 8);
+}
+
+static inline uint8x16_t ui_pixels_mul_neon(uint8x16_t c, uint8x16_t a) {
+    const uint16x8_t lo = vmull_u8(vget_low_u8(c),  vget_low_u8(a));
+    const uint16x8_t hi = vmull_u8(vget_high_u8(c), vget_high_u8(a));
+    return vcombine_u8(ui_pixels_div255_neon(lo), ui_pixels_div255_neon(hi));
+}
+
+static void ui_pixels_premultiply_neon(uint8_t* d, const uint8_t* s,
+        int64_t n, bool swap) {
+    int64_t i = 0;
+    for (; i + 16 <= n; i += 16) {
+        const uint8x16x4_t v = vld4q_u8(s + i * 4);
+        uint8x16x4_t p;
+        p.val[0] = ui_pixels_mul_neon(v.val[swap ? 2 : 0], v.val[3]);
+        p.val[1] = ui_pixels_mul_neon(v.val[1], v.val[3]);
+        p.val[2] = ui_pixels_mul_neon(v.val[swap ? 0 : 2], v.val[3]);
+        p.val[3] = v.val[3];
+        vst4q_u8(d + i * 4, p);
+    }
+    ui_pixels_premultiply_scalar(d + i * 4, s + i * 4, n - i, swap);
+}
+
+static void ui_pixels_gray_neon(uint8_t* d, const uint8_t* s, int64_t n) {
+    int64_t i = 0;
+    for (; i + 16 <= n; i += 16) {
+        const uint8x16_t g = vld1q_u8(s + i);
+        uint8x16x4_t v;
+        v.val[0] = g;
+        v.val[1] = g;
+        v.val[2] = g;
+        v.val[3] = vdupq_n_u8(0xFF);
+        vst4q_u8(d + i * 4, v);
+    }
+    ui_pixels_gray_scalar(d + i * 4, s + i, n - i);
+}
+
+static const struct ui_pixels_kernels ui_pixels_neon_kernels = {
+    .rgb           = ui_pixels_rgb_neon,
+    .rgbx          = ui_pixels_rgbx_neon,
+    .premultiply   = ui_pixels_premultiply_neon,
+    .gray          = ui_pixels_gray_neon,
+    .unpremultiply = ui_pixels_unpremultiply_scalar
+};
+
+#endif // ui_pixels_has_neon
+
+static const struct ui_pixels_kernels* ui_pixels_k; // selected kernels
+static int32_t ui_pixels_selected;
+
+static const struct ui_pixels_kernels* ui_pixels_of(int32_t isa) {
+    const struct ui_pixels_kernels* k = null;
+    switch (isa) {
+        case ui_pixels_scalar: k = &ui_pixels_scalar_kernels; break;
+        #if defined(ui_pixels_has_sse2)
+        case ui_pixels_sse2: k = &ui_pixels_sse2_kernels; break;
+        #endif
+        #if defined(ui_pixels_has_avx2)
+        case ui_pixels_avx2:
+            k = ui_pixels_cpu_avx2() ? &ui_pixels_avx2_kernels : null;
+            break;
+        #endif
+        #if defined(ui_pixels_has_neon)
+        case ui_pixels_neon: k = &ui_pixels_neon_kernels; break;
+        #endif
+        default: break;
+    }
+    return k;
+}
+
+static bool ui_pixels_use(int32_t isa) {
+    const struct ui_pixels_kernels* k = ui_pixels_of(isa);
+    if (k != null) {
+        if (ui_pixels_recip[255] == 0) { ui_pixels_init_recip(); }
+        ui_pixels_selected = isa;
+        ui_pixels_k = k;
+    }
+    return k != null;
+}
+
+static bool ui_pixels_supported(int32_t isa) {
+    return ui_pixels_of(isa) != null;
+}
+
+static const struct ui_pixels_kernels* ui_pixels_kernels(void) {
+    if (ui_pixels_k == null) {
+        // best available, races are benign: same result on all threads
+        const int32_t isa[] = { ui_pixels_avx2, ui_pixels_sse2, ui_pixels_neon };
+        bool found = false;
+        for (int32_t i = 0; i < posix_countof(isa) && !found; i++) {
+            found = ui_pixels_use(isa[i]);
+        }
+        if (!found) { ui_pixels_use(ui_pixels_scalar); }
+    }
+    return ui_pixels_k;
+}
+
+static void ui_pixels_rgb(uint8_t* d, const uint8_t* s, int64_t n) {
+    ui_pixels_kernels()->rgb(d, s, n);
+}
+
+static void ui_pixels_rgbx(uint8_t* d, const uint8_t* s, int64_t n, bool swap) {
+    ui_pixels_kernels()->rgbx(d, s, n, swap);
+}
+
+static void ui_pixels_premultiply(uint8_t* d, const uint8_t* s, int64_t n,
+        bool swap) {
+    ui_pixels_kernels()->premultiply(d, s, n, swap);
+}
+
+static void ui_pixels_gray(uint8_t* d, const uint8_t* s, int64_t n) {
+    ui_pixels_kernels()->gray(d, s, n);
+}
+
+static void ui_pixels_unpremultiply(uint8_t* d, const uint8_t* s, int64_t n) {
+    ui_pixels_kernels()->unpremultiply(d, s, n);
+}
+
+static int32_t ui_pixels_isa(void) {
+    (void)ui_pixels_kernels();
+    return ui_pixels_selected;
+}
+
+static const char* ui_pixels_name(int32_t isa) {
+    static const char* names[] = { "scalar", "sse2", "avx2", "neon" };
+    return 0 <= isa && isa < posix_countof(names) ? names[isa] : "???";
+}
+
+enum { ui_pixels_test_max = 1024 + 31 };
+
+static void ui_pixels_test_kernels(int32_t isa, uint32_t* seed) {
+    // every kernel of `isa` against scalar reference for all lengths
+    // up to SIMD width and misaligned source and destination
+    static uint8_t s[ui_pixels_test_max * 4 + 64];
+    static uint8_t e[ui_pixels_test_max * 4 + 64]; // expected
+    static uint8_t d[ui_pixels_test_max * 4 + 64];
+    const int32_t saved = ui_pixels.isa();
+    posix_swear(ui_pixels.use(isa));
+    for (int32_t pass = 0; pass < 200; pass++) {
+        const int64_t n = pass < 64 ? pass :
+            (int64_t)(posix_num.random32(seed) % ui_pixels_test_max);
+        const int32_t so = (int32_t)(posix_num.random32(seed) % 32);
+        const int32_t doff = (int32_t)(posix_num.random32(seed) % 32);
+        for (int32_t i = 0; i < posix_countof(s); i++) {
+            s[i] = (uint8_t)posix_num.random32(seed);
+        }
+        // premultiplied input for unpremultiply() has c <= a mostly
+        // but saturation is tested too
+        for (int32_t k = 0; k < 6; k++) {
+            const bool swap = (k & 1) != 0;
+            memset(e, 0x5A, sizeof(e));
+            memset(d, 0x5A, sizeof(d));
+            const uint8_t* src = s + so;
+            switch (k / 2) {
+                case 0:
+                    ui_pixels_scalar_kernels.rgbx(e, src, n, swap);
+                    ui_pixels.rgbx(d + doff, src, n, swap);
+                    break;
+                case 1:
+                    ui_pixels_scalar_kernels.premultiply(e, src, n, swap);
+                    ui_pixels.premultiply(d + doff, src, n, swap);
+                    break;
+                default:
+                    if (swap) {
+                        ui_pixels_scalar_kernels.rgb(e, src, n);
+                        ui_pixels.rgb(d + doff, src, n);
+                    } else {
+                        ui_pixels_scalar_kernels.gray(e, src, n);
+                        ui_pixels.gray(d + doff, src, n);
+                    }
+                    break;
+            }
+            const int32_t bytes = (int32_t)n * (k == 5 ? 3 : 4);
+            posix_swear(memcmp(d + doff, e, (size_t)bytes) == 0,
+                        "%s k: %d n: %lld", ui_pixels.name(isa), k, n);
+            posix_swear(d[doff + bytes] == 0x5A); // no overrun
+        }
+        ui_pixels_scalar_kernels.unpremultiply(e, s + so, n);
+        ui_pixels.unpremultiply(d + doff, s + so, n);
+        posix_swear(memcmp(d + doff, e, (size_t)n * 4) == 0);
+        // in place
+        memcpy(d, s + so, (size_t)n * 4);
+        ui_pixels.premultiply(d, d, n, true);
+        ui_pixels_scalar_kernels.premultiply(e, s + so, n, true);
+        posix_swear(memcmp(d, e, (size_t)n * 4) == 0);
+        memcpy(d, s + so, (size_t)n * 3);
+        ui_pixels.rgb(d, d, n);
+        ui_pixels_scalar_kernels.rgb(e, s + so, n);
+        posix_swear(memcmp(d, e, (size_t)n * 3) == 0);
+    }
+    posix_swear(ui_pixels.use(saved));
+}
+
+static void ui_pixels_test(void) {
+    uint8_t p[8] = { 10, 20, 30, 40, 255, 128, 0, 0 };
+    uint8_t q[8];
+    // premultiply() is the same as c * a / 255 rounded down
+    ui_pixels.premultiply(q, p, 2, true);
+    posix_swear(q[0] == 30 * 40 / 255 && q[1] == 20 * 40 / 255 &&
+                q[2] == 10 * 40 / 255 && q[3] == 40);
+    posix_swear(q[4] == 0 && q[5] == 0 && q[6] == 0 && q[7] == 0);
+    ui_pixels.unpremultiply(q, (const uint8_t[4]){ 64, 128, 255, 128 }, 1);
+    posix_swear(q[0] == 128 && q[1] == 255 && q[2] == 255 && q[3] == 128);
+    // premultiply() and unpremultiply() round trip within 255 / a
+    uint32_t seed = 1;
+    for (int32_t i = 0; i < 10000; i++) {
+        const uint8_t c[4] = {
+            (uint8_t)posix_num.random32(&seed), (uint8_t)posix_num.random32(&seed),
+            (uint8_t)posix_num.random32(&seed), (uint8_t)(posix_num.random32(&seed) | 1)
+        };
+        ui_pixels.premultiply(q, c, 1, false);
+        ui_pixels.unpremultiply(q, q, 1);
+        for (int32_t k = 0; k < 3; k++) {
+            posix_swear(abs(q[k] - c[k]) <= 255 / c[3] + 1, "%d %d a: %d",
+                        q[k], c[k], c[3]);
+        }
+    }
+    for (int32_t isa = ui_pixels_sse2; isa <= ui_pixels_neon; isa++) {
+        if (ui_pixels_of(isa) != null) { ui_pixels_test_kernels(isa, &seed); }
+    }
+    if (posix_debug.verbosity.level > posix_debug.verbosity.quiet) {
+        posix_println("done %s", ui_pixels.name(ui_pixels.isa()));
+    }
+}
+
+struct ui_pixels_if ui_pixels = {
+    .rgb           = ui_pixels_rgb,
+    .rgbx          = ui_pixels_rgbx,
+    .premultiply   = ui_pixels_premultiply,
+    .gray          = ui_pixels_gray,
+    .unpremultiply = ui_pixels_unpremultiply,
+    .isa           = ui_pixels_isa,
+    .use           = ui_pixels_use,
+    .supported     = ui_pixels_supported,
+    .name          = ui_pixels_name,
+    .test          = ui_pixels_test
+};
+
+#ifdef UI_PIXELS_TEST
+    posix_static_init(ui_pixels) { ui_pixels.test(); }
+#endif
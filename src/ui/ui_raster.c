@@ -0,0 +1,1435 @@
+/* Copyright (c) Dmitry "Leo" Kuznetsov 2021-24 see LICENSE for details */
+#include "posix/posix.h"
+#include "ui/ui_core.h"
+#include "ui/ui_colors.h"
+#include "ui/ui_parallel.h"
+#include "ui/ui_pixels.h"
+#include "ui/ui_raster.h"
+#include <math.h>
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__SSE2__)
+#include <emmintrin.h>
+#define ui_raster_has_sse2
+#if defined(_M_X64) || defined(__x86_64__)
+#include <immintrin.h>
+#define ui_raster_has_avx2
+#if defined(_MSC_VER)
+#pragma warning(disable: 4752) // AVX instructions w/o /arch:AVX (run time dispatch)
+#define ui_raster_avx2_target
+#else
+#define ui_raster_avx2_target __attribute__((target("avx2")))
+#endif
+#endif
+#elif defined(_M_ARM64) || defined(__aarch64__)
+#include <arm_neon.h>
+#define ui_raster_has_neon
+#endif
+
+#undef UI_RASTER_TEST
+
+#if 0 // flip to 1 to run tests
+
+#define UI_RASTER_TEST
+
+#endif
+
+enum {
+    ui_raster_op_fill     = 0, // .c0 premultiplied
+    ui_raster_op_gradient = 1, // .c0 to .c1 not premultiplied
+    ui_raster_op_rounded  = 2, // .c0 fill .c1 border .radius
+    ui_raster_op_path     = 3, // .count edges (x0, y0, x1, y1) at .offset
+    ui_raster_op_image    = 4,
+    ui_raster_op_mask     = 5  // coverage[.h][.w] at .offset
+};
+
+struct ui_raster_command {
+    int32_t op;
+    struct ui_rect bounds; // pixels touched inside of clip and bitmap
+    int32_t  x; // fill, gradient, rounded, image and mask rectangle
+    int32_t  y;
+    int32_t  w;
+    int32_t  h;
+    uint32_t c0; // BGRA colors
+    uint32_t c1;
+    fp32_t   radius;
+    bool     vertical;
+    int32_t  count;
+    int64_t  offset; // of .data
+    struct {
+        const uint8_t* pixels;
+        int32_t x; // source rectangle inside of pixels
+        int32_t y;
+        int32_t w;
+        int32_t h;
+        int32_t stride;
+        int32_t bpp;
+        uint8_t alpha;
+        bool    premultiplied;
+    } image;
+};
+
+// Span kernels, d[] and s[] are premultiplied BGRA, colors and coverage
+// are applied "source over": d = s + d * (255 - alpha(s)) / 255
+
+struct ui_raster_kernels {
+    void (*fill)(uint32_t* d, uint32_t c, int32_t n);  // d = c
+    void (*blend)(uint32_t* d, uint32_t c, int32_t n); // c over d
+    // mask() c * m[i] / 255 over d[i]
+    void (*mask)(uint32_t* d, uint32_t c, const uint8_t* m, int32_t n);
+    // blit() s[i] * alpha / 255 over d[i]
+    void (*blit)(uint32_t* d, const uint32_t* s, uint8_t alpha, int32_t n);
+};
+
+static inline uint32_t ui_raster_mul(uint32_t x, uint32_t y) {
+    const uint32_t t = x * y + 128; // round(x * y / 255) for x, y <= 255
+    return (t + (t >> 8)) >> 8;
+}
+
+static inline uint32_t ui_raster_scale(uint32_t c, uint32_t a) {
+    return ui_raster_mul(c & 0xFF, a) |
+           ui_raster_mul((c >>  8) & 0xFF, a) <<  8 |
+           ui_raster_mul((c >> 16) & 0xFF, a) << 16 |
+           ui_raster_mul((c >> 24) & 0xFF, a) << 24;
+}
+
+static inline uint32_t ui_raster_over(uint32_t d, uint32_t s) {
+    // saturated as SIMD kernels are (s is not necessary premultiplied)
+    const uint32_t ia = 255 - (s >> 24);
+    uint32_t r = 0;
+    for (int32_t k = 0; k < 32; k += 8) {
+        const uint32_t v = ((s >> k) & 0xFF) + ui_raster_mul((d >> k) & 0xFF, ia);
+        r |= (v > 0xFF ? 0xFF : v) << k;
+    }
+    return r;
+}
+
+static void ui_raster_fill_scalar(uint32_t* d, uint32_t c, int32_t n) {
+    for (int32_t i = 0; i < n; i++) { d[i] = c; }
+}
+
+static void ui_raster_blend_scalar(uint32_t* d, uint32_t c, int32_t n) {
+    for (int32_t i = 0; i < n; i++) { d[i] = ui_raster_over(d[i], c); }
+}
+
+static void ui_raster_mask_scalar(uint32_t* d, uint32_t c, const uint8_t* m,
+        int32_t n) {
+    for (int32_t i = 0; i < n; i++) {
+        d[i] = ui_raster_over(d[i], ui_raster_scale(c, m[i]));
+    }
+}
+
+static void ui_raster_blit_scalar(uint32_t* d, const uint32_t* s,
+        uint8_t alpha, int32_t n) {
+    for (int32_t i = 0; i < n; i++) {
+        d[i] = ui_raster_over(d[i], ui_raster_scale(s[i], alpha));
+    }
+}
+
+static const struct ui_raster_kernels ui_raster_scalar_kernels = {
+    .fill  = ui_raster_fill_scalar,
+    .blend = ui_raster_blend_scalar,
+    .mask  = ui_raster_mask_scalar,
+    .blit  = ui_raster_blit_scalar
+};
+
+#if defined(ui_raster_has_sse2)
+
+// Channels are widened to 16 bits: 2 pixels per __m128i. Alpha of
+// each pixel is broadcast to its 4 lanes by shufflelo/hi.
+
+static inline __m128i ui_raster_mul_sse2(__m128i x, __m128i y) {
+    const __m128i t = _mm_add_epi16(_mm_mullo_epi16(x, y), _mm_set1_epi16(128));
+    return _mm_srli_epi16(_mm_add_epi16(t, _mm_srli_epi16(t, 8)), 8);
+}
+
+static inline __m128i ui_raster_over_sse2(__m128i d, __m128i s) {
+    const __m128i a = _mm_shufflehi_epi16(_mm_shufflelo_epi16(s,
+                          _MM_SHUFFLE(3, 3, 3, 3)), _MM_SHUFFLE(3, 3, 3, 3));
+    const __m128i ia = _mm_sub_epi16(_mm_set1_epi16(255), a);
+    return _mm_add_epi16(s, ui_raster_mul_sse2(d, ia));
+}
+
+static void ui_raster_fill_sse2(uint32_t* d, uint32_t c, int32_t n) {
+    const __m128i v = _mm_set1_epi32((int32_t)c);
+    int32_t i = 0;
+    for (; i + 4 <= n; i += 4) { _mm_storeu_si128((__m128i*)(d + i), v); }
+    ui_raster_fill_scalar(d + i, c, n - i);
+}
+
+static void ui_raster_blend_sse2(uint32_t* d, uint32_t c, int32_t n) {
+    const __m128i z = _mm_setzero_si128();
+    const __m128i s = _mm_unpacklo_epi8(_mm_set1_epi32((int32_t)c), z);
+    int32_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        const __m128i v = _mm_loadu_si128((const __m128i*)(d + i));
+        const __m128i lo = ui_raster_over_sse2(_mm_unpacklo_epi8(v, z), s);
+        const __m128i hi = ui_raster_over_sse2(_mm_unpackhi_epi8(v, z), s);
+        _mm_storeu_si128((__m128i*)(d + i), _mm_packus_epi16(lo, hi));
+    }
+    ui_raster_blend_scalar(d + i, c, n - i);
+}
+
+static void ui_raster_mask_sse2(uint32_t* d, uint32_t c, const uint8_t* m,
+        int32_t n) {
+    const __m128i z = _mm_setzero_si128();
+    const __m128i s = _mm_unpacklo_epi8(_mm_set1_epi32((int32_t)c), z);
+    int32_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        int32_t m4 = 0;
+        memcpy(&m4, m + i, sizeof(m4));
+        __m128i mm = _mm_cvtsi32_si128(m4); // m0 m1 m2 m3
+        mm = _mm_unpacklo_epi8(mm, mm);     // m0 m0 m1 m1 ...
+        mm = _mm_unpacklo_epi16(mm, mm);    // m0 m0 m0 m0 m1 ...
+        const __m128i v = _mm_loadu_si128((const __m128i*)(d + i));
+        const __m128i lo = ui_raster_over_sse2(_mm_unpacklo_epi8(v, z),
+                ui_raster_mul_sse2(s, _mm_unpacklo_epi8(mm, z)));
+        const __m128i hi = ui_raster_over_sse2(_mm_unpackhi_epi8(v, z),
+                ui_raster_mul_sse2(s, _mm_unpackhi_epi8(mm, z)));
+        _mm_storeu_si128((__m128i*)(d + i), _mm_packus_epi16(lo, hi));
+    }
+    ui_raster_mask_scalar(d + i, c, m + i, n - i);
+}
+
+static void ui_raster_blit_sse2(uint32_t* d, const uint32_t* s,
+        uint8_t alpha, int32_t n) {
+    const __m128i z = _mm_setzero_si128();
+    const __m128i a = _mm_set1_epi16(alpha);
+    int32_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        const __m128i v = _mm_loadu_si128((const __m128i*)(d + i));
+        const __m128i p = _mm_loadu_si128((const __m128i*)(s + i));
+        const __m128i lo = ui_raster_over_sse2(_mm_unpacklo_epi8(v, z),
+                ui_raster_mul_sse2(_mm_unpacklo_epi8(p, z), a));
+        const __m128i hi = ui_raster_over_sse2(_mm_unpackhi_epi8(v, z),
+                ui_raster_mul_sse2(_mm_unpackhi_epi8(p, z), a));
+        _mm_storeu_si128((__m128i*)(d + i), _mm_packus_epi16(lo, hi));
+    }
+    ui_raster_blit_scalar(d + i, s + i, alpha, n - i);
+}
+
+static const struct ui_raster_kernels ui_raster_sse2_kernels = {
+    .fill  = ui_raster_fill_sse2,
+    .blend = ui_raster_blend_sse2,
+    .mask  = ui_raster_mask_sse2,
+    .blit  = ui_raster_blit_sse2
+};
+
+#endif // ui_raster_has_sse2
+
+#if defined(ui_raster_has_avx2)
+
+// Same as SSE2 on 8 pixels: unpack and pack work inside of 128 bit
+// lanes thus pixel order is preserved.
+
+ui_raster_avx2_target
+static inline __m256i ui_raster_mul_avx2(__m256i x, __m256i y) {
+    const __m256i t = _mm256_add_epi16(_mm256_mullo_epi16(x, y),
+                                       _mm256_set1_epi16(128));
+    return _mm256_srli_epi16(_mm256_add_epi16(t, _mm256_srli_epi16(t, 8)), 8);
+}
+
+ui_raster_avx2_target
+static inline __m256i ui_raster_over_avx2(__m256i d, __m256i s) {
+    const __m256i a = _mm256_shufflehi_epi16(_mm256_shufflelo_epi16(s,
+                          _MM_SHUFFLE(3, 3, 3, 3)), _MM_SHUFFLE(3, 3, 3, 3));
+    const __m256i ia = _mm256_sub_epi16(_mm256_set1_epi16(255), a);
+    return _mm256_add_epi16(s, ui_raster_mul_avx2(d, ia));
+}
+
+ui_raster_avx2_target
+static void ui_raster_fill_avx2(uint32_t* d, uint32_t c, int32_t n) {
+    const __m256i v = _mm256_set1_epi32((int32_t)c);
+    int32_t i = 0;
+    for (; i + 8 <= n; i += 8) { _mm256_storeu_si256((__m256i*)(d + i), v); }
+    ui_raster_fill_scalar(d + i, c, n - i);
+}
+
+ui_raster_avx2_target
+static void ui_raster_blend_avx2(uint32_t* d, uint32_t c, int32_t n) {
+    const __m256i z = _mm256_setzero_si256();
+    const __m256i s = _mm256_unpacklo_epi8(_mm256_set1_epi32((int32_t)c), z);
+    int32_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        const __m256i v = _mm256_loadu_si256((const __m256i*)(d + i));
+        const __m256i lo = ui_raster_over_avx2(_mm256_unpacklo_epi8(v, z), s);
+        const __m256i hi = ui_raster_over_avx2(_mm256_unpackhi_epi8(v, z), s);
+        _mm256_storeu_si256((__m256i*)(d + i), _mm256_packus_epi16(lo, hi));
+    }
+    ui_raster_blend_scalar(d + i, c, n - i);
+}
+
+ui_raster_avx2_target
+static void ui_raster_mask_avx2(uint32_t* d, uint32_t c, const uint8_t* m,
+        int32_t n) {
+    const __m256i z = _mm256_setzero_si256();
+    const __m256i s = _mm256_unpacklo_epi8(_mm256_set1_epi32((int32_t)c), z);
+    const __m256i bytes = _mm256_set1_epi32(0x01010101);
+    int32_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        const __m256i mm = _mm256_mullo_epi32(_mm256_cvtepu8_epi32(
+            _mm_loadl_epi64((const __m128i*)(m + i))), bytes);
+        const __m256i v = _mm256_loadu_si256((const __m256i*)(d + i));
+        const __m256i lo = ui_raster_over_avx2(_mm256_unpacklo_epi8(v, z),
+                ui_raster_mul_avx2(s, _mm256_unpacklo_epi8(mm, z)));
+        const __m256i hi = ui_raster_over_avx2(_mm256_unpackhi_epi8(v, z),
+                ui_raster_mul_avx2(s, _mm256_unpackhi_epi8(mm, z)));
+        _mm256_storeu_si256((__m256i*)(d + i), _mm256_packus_epi16(lo, hi));
+    }
+    ui_raster_mask_scalar(d + i, c, m + i, n - i);
+}
+
+ui_raster_avx2_target
+static void ui_raster_blit_avx2(uint32_t* d, const uint32_t* s,
+        uint8_t alpha, int32_t n) {
+    const __m256i z = _mm256_setzero_si256();
+    const __m256i a = _mm256_set1_epi16(alpha);
+    int32_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        const __m256i v = _mm256_loadu_si256((const __m256i*)(d + i));
+        const __m256i p = _mm256_loadu_si256((const __m256i*)(s + i));
+        const __m256i lo = ui_raster_over_avx2(_mm256_unpacklo_epi8(v, z),
+                ui_raster_mul_avx2(_mm256_unpacklo_epi8(p, z), a));
+        const __m256i hi = ui_raster_over_avx2(_mm256_unpackhi_epi8(v, z),
+                ui_raster_mul_avx2(_mm256_unpackhi_epi8(p, z), a));
+        _mm256_storeu_si256((__m256i*)(d + i), _mm256_packus_epi16(lo, hi));
+    }
+    ui_raster_blit_scalar(d + i, s + i, alpha, n - i);
+}
+
+static const struct ui_raster_kernels ui_raster_avx2_kernels = {
+    .fill  = ui_raster_fill_avx2,
+    .blend = ui_raster_blend_avx2,
+    .mask  = ui_raster_mask_avx2,
+    .blit  = ui_raster_blit_avx2
+};
+
+#endif // ui_raster_has_avx2
+
+#if defined(ui_raster_has_neon)
+
+// vld4q_u8() deinterleaves 16 pixels into b, g, r, a planes.
+// vraddhn_u16(p, vrshrq_n_u16(p, 8)) is (p + 128 + ((p + 128) >> 8)) >> 8
+// the same rounding as ui_raster_mul().
+
+static inline uint8x16_t ui_raster_mul_neon(uint8x16_t x, uint8x16_t y) {
+    const uint16x8_t lo = vmull_u8(vget_low_u8(x), vget_low_u8(y));
+    const uint16x8_t hi = vmull_u8(vget_high_u8(x), vget_high_u8(y));
+    return vcombine_u8(vraddhn_u16(lo, vrshrq_n_u16(lo, 8)),
+                       vraddhn_u16(hi, vrshrq_n_u16(hi, 8)));
+}
+
+static inline uint8x16x4_t ui_raster_over_neon(uint8x16x4_t d,
+        uint8x16x4_t s) {
+    const uint8x16_t ia = vsubq_u8(vdupq_n_u8(255), s.val[3]);
+    for (int32_t k = 0; k < 4; k++) {
+        d.val[k] = vqaddq_u8(s.val[k], ui_raster_mul_neon(d.val[k], ia));
+    }
+    return d;
+}
+
+static inline uint8x16x4_t ui_raster_color_neon(uint32_t c) {
+    uint8x16x4_t s;
+    for (int32_t k = 0; k < 4; k++) {
+        s.val[k] = vdupq_n_u8((uint8_t)(c >> (k * 8)));
+    }
+    return s;
+}
+
+static void ui_raster_fill_neon(uint32_t* d, uint32_t c, int32_t n) {
+    const uint32x4_t v = vdupq_n_u32(c);
+    int32_t i = 0;
+    for (; i + 4 <= n; i += 4) { vst1q_u32(d + i, v); }
+    ui_raster_fill_scalar(d + i, c, n - i);
+}
+
+static void ui_raster_blend_neon(uint32_t* d, uint32_t c, int32_t n) {
+    const uint8x16x4_t s = ui_raster_color_neon(c);
+    int32_t i = 0;
+    for (; i + 16 <= n; i += 16) {
+        uint8_t* p = (uint8_t*)(d + i);
+        vst4q_u8(p, ui_raster_over_neon(vld4q_u8(p), s));
+    }
+    ui_raster_blend_scalar(d + i, c, n - i);
+}
+
+static void ui_raster_mask_neon(uint32_t* d, uint32_t c, const uint8_t* m,
+        int32_t n) {
+    const uint8x16x4_t cc = ui_raster_color_neon(c);
+    int32_t i = 0;
+    for (; i + 16 <= n; i += 16) {
+        const uint8x16_t mm = vld1q_u8(m + i);
+        uint8x16x4_t s;
+        for (int32_t k = 0; k < 4; k++) {
+            s.val[k] = ui_raster_mul_neon(cc.val[k], mm);
+        }
+        uint8_t* p = (uint8_t*)(d + i);
+        vst4q_u8(p, ui_raster_over_neon(vld4q_u8(p), s));
+    }
+    ui_raster_mask_scalar(d + i, c, m + i, n - i);
+}
+
+static void ui_raster_blit_neon(uint32_t* d, const uint32_t* s,
+        uint8_t alpha, int32_t n) {
+    const uint8x16_t a = vdupq_n_u8(alpha);
+    int32_t i = 0;
+    for (; i + 16 <= n; i += 16) {
+        uint8x16x4_t v = vld4q_u8((const uint8_t*)(s + i));
+        for (int32_t k = 0; k < 4; k++) {
+            v.val[k] = ui_raster_mul_neon(v.val[k], a);
+        }
+        uint8_t* p = (uint8_t*)(d + i);
+        vst4q_u8(p, ui_raster_over_neon(vld4q_u8(p), v));
+    }
+    ui_raster_blit_scalar(d + i, s + i, alpha, n - i);
+}
+
+static const struct ui_raster_kernels ui_raster_neon_kernels = {
+    .fill  = ui_raster_fill_neon,
+    .blend = ui_raster_blend_neon,
+    .mask  = ui_raster_mask_neon,
+    .blit  = ui_raster_blit_neon
+};
+
+#endif // ui_raster_has_neon
+
+static const struct ui_raster_kernels* ui_raster_k; // selected kernels
+static int32_t ui_raster_selected;
+
+static const struct ui_raster_kernels* ui_raster_of(int32_t isa) {
+    const struct ui_raster_kernels* k = null;
+    if (ui_pixels.supported(isa)) {
+        switch (isa) {
+            case ui_pixels_scalar: k = &ui_raster_scalar_kernels; break;
+            #if defined(ui_raster_has_sse2)
+            case ui_pixels_sse2: k = &ui_raster_sse2_kernels; break;
+            #endif
+            #if defined(ui_raster_has_avx2)
+            case ui_pixels_avx2: k = &ui_raster_avx2_kernels; break;
+            #endif
+            #if defined(ui_raster_has_neon)
+            case ui_pixels_neon: k = &ui_raster_neon_kernels; break;
+            #endif
+            default: break;
+        }
+    }
+    return k;
+}
+
+static bool ui_raster_use(int32_t isa) {
+    const struct ui_raster_kernels* k = ui_raster_of(isa);
+    if (k != null) {
+        ui_raster_selected = isa;
+        ui_raster_k = k;
+    }
+    return k != null;
+}
+
+static const struct ui_raster_kernels* ui_raster_kernels(void) {
+    if (ui_raster_k == null) {
+        // best available, races are benign: same result on all threads
+        const int32_t isa[] = { ui_pixels_avx2, ui_pixels_sse2, ui_pixels_neon };
+        bool found = false;
+        for (int32_t i = 0; i < posix_countof(isa) && !found; i++) {
+            found = ui_raster_use(isa[i]);
+        }
+        if (!found) { ui_raster_use(ui_pixels_scalar); }
+    }
+    return ui_raster_k;
+}
+
+static int32_t ui_raster_isa(void) {
+    (void)ui_raster_kernels();
+    return ui_raster_selected;
+}
+
+// recording:
+
+static struct ui_rect ui_raster_intersect(struct ui_rect a, struct ui_rect b) {
+    const int32_t x0 = posix_max(a.x, b.x);
+    const int32_t y0 = posix_max(a.y, b.y);
+    const int32_t x1 = posix_min(a.x + a.w, b.x + b.w);
+    const int32_t y1 = posix_min(a.y + a.h, b.y + b.h);
+    return x0 < x1 && y0 < y1 ?
+        (struct ui_rect){ x0, y0, x1 - x0, y1 - y0 } :
+        (struct ui_rect){ 0, 0, 0, 0 };
+}
+
+static uint32_t ui_raster_straight(ui_color_t c) { // BGRA
+    // ui_color_rgb() leaves alpha 0 for opaque colors (see dxd.cpp)
+    const uint32_t a = ui_color_a(c) == 0 ? 0xFF : ui_color_a(c);
+    return ui_color_is_transparent(c) ? 0 :
+        (uint32_t)ui_color_b(c) | (uint32_t)ui_color_g(c) << 8 |
+        (uint32_t)ui_color_r(c) << 16 | a << 24;
+}
+
+static uint32_t ui_raster_premultiply(uint32_t s) {
+    const uint32_t a = s >> 24;
+    return ui_raster_mul(s & 0xFF, a) |
+           ui_raster_mul((s >> 8) & 0xFF, a) << 8 |
+           ui_raster_mul((s >> 16) & 0xFF, a) << 16 | a << 24;
+}
+
+static uint32_t ui_raster_color(ui_color_t c) { // premultiplied BGRA
+    return ui_raster_premultiply(ui_raster_straight(c));
+}
+
+static struct ui_raster_command* ui_raster_add(struct ui_raster* r,
+        int32_t op, struct ui_rect bounds) {
+    posix_assert(r->bitmap != null, "begin() not called");
+    struct ui_raster_command* c = null;
+    const struct ui_rect all = { 0, 0, r->bitmap->w, r->bitmap->h };
+    const struct ui_rect area = r->clip.w > 0 ?
+        ui_raster_intersect(r->clip, all) : all;
+    bounds = ui_raster_intersect(bounds, area);
+    if (bounds.w > 0) {
+        bool ok = true;
+        if (r->count == r->capacity) {
+            const int32_t n = posix_max(r->capacity * 2, 256);
+            ok = posix_heap.realloc((void**)&r->commands,
+                                    n * (int64_t)sizeof(r->commands[0])) == 0;
+            if (ok) { r->capacity = n; } else { r->error = ENOMEM; }
+        }
+        if (ok) {
+            c = &r->commands[r->count++];
+            memset(c, 0x00, sizeof(*c));
+            c->op = op;
+            c->bounds = bounds;
+        }
+    }
+    return c;
+}
+
+static void* ui_raster_data(struct ui_raster* r, struct ui_raster_command* c,
+        int64_t bytes) {
+    // reserves `bytes` of .data for the last added command `c`
+    // or drops the command
+    void* p = null;
+    const int64_t n = (bytes + 3) & ~(int64_t)3; // keeps edges fp32_t aligned
+    bool ok = true;
+    if (r->bytes + n > r->allocated) {
+        const int64_t a = posix_max(r->allocated * 2,
+                                    posix_max(r->bytes + n, (int64_t)64 * 1024));
+        ok = posix_heap.realloc((void**)&r->data, a) == 0;
+        if (ok) { r->allocated = a; } else { r->error = ENOMEM; }
+    }
+    if (ok) {
+        c->offset = r->bytes;
+        p = r->data + r->bytes;
+        r->bytes += n;
+    } else {
+        posix_assert(c == &r->commands[r->count - 1]);
+        r->count--;
+    }
+    return p;
+}
+
+static void ui_raster_rectangle(struct ui_raster* r, int32_t x, int32_t y,
+        int32_t w, int32_t h, uint32_t p) {
+    if (p != 0) {
+        struct ui_raster_command* c = ui_raster_add(r, ui_raster_op_fill,
+            (struct ui_rect){ x, y, w, h });
+        if (c != null) {
+            c->x = x; c->y = y; c->w = w; c->h = h;
+            c->c0 = p;
+        }
+    }
+}
+
+static void ui_raster_border(struct ui_raster* r, int32_t x, int32_t y,
+        int32_t w, int32_t h, uint32_t p) {
+    // 4 sides do not overlap: translucent corners are blended once
+    if (w > 0 && h > 0) {
+        ui_raster_rectangle(r, x, y, w, 1, p);
+        if (h > 1) { ui_raster_rectangle(r, x, y + h - 1, w, 1, p); }
+        if (h > 2) {
+            ui_raster_rectangle(r, x, y + 1, 1, h - 2, p);
+            if (w > 1) { ui_raster_rectangle(r, x + w - 1, y + 1, 1, h - 2, p); }
+        }
+    }
+}
+
+static void ui_raster_begin(struct ui_raster* r, struct ui_bitmap* bitmap) {
+    posix_assert(bitmap != null && bitmap->bpp == 4 && bitmap->pixels != null);
+    posix_assert(bitmap->stride >= bitmap->w * 4);
+    r->bitmap = bitmap;
+    r->clip = (struct ui_rect){ 0, 0, 0, 0 };
+    r->count = 0;
+    r->bytes = 0;
+    r->error = 0;
+}
+
+static void ui_raster_set_clip(struct ui_raster* r, int32_t x, int32_t y,
+        int32_t w, int32_t h) {
+    r->clip = w > 0 && h > 0 ?
+        (struct ui_rect){ x, y, w, h } : (struct ui_rect){ 0, 0, 0, 0 };
+}
+
+static void ui_raster_pixel(struct ui_raster* r, int32_t x, int32_t y,
+        ui_color_t c) {
+    ui_raster_rectangle(r, x, y, 1, 1, ui_raster_color(c));
+}
+
+static void ui_raster_fill(struct ui_raster* r, int32_t x, int32_t y,
+        int32_t w, int32_t h, ui_color_t c) {
+    ui_raster_rectangle(r, x, y, w, h, ui_raster_color(c));
+}
+
+static void ui_raster_frame(struct ui_raster* r, int32_t x, int32_t y,
+        int32_t w, int32_t h, ui_color_t c) {
+    ui_raster_border(r, x, y, w, h, ui_raster_color(c));
+}
+
+static void ui_raster_rect(struct ui_raster* r, int32_t x, int32_t y,
+        int32_t w, int32_t h, ui_color_t border, ui_color_t fill) {
+    ui_raster_rectangle(r, x, y, w, h, ui_raster_color(fill));
+    ui_raster_border(r, x, y, w, h, ui_raster_color(border));
+}
+
+static void ui_raster_segment(fp32_t* e, fp32_t x0, fp32_t y0,
+        fp32_t x1, fp32_t y1) {
+    // 4 edges of 1 pixel wide quad from x0, y0 to x1, y1 with square
+    // caps. All quads have the same orientation: where they overlap
+    // coverage adds up and is clamped to 1
+    const fp32_t dx = x1 - x0;
+    const fp32_t dy = y1 - y0;
+    const fp32_t d = sqrtf(dx * dx + dy * dy);
+    const fp32_t tx = d > 0 ? dx / d * 0.5f : 0.5f; // half tangent
+    const fp32_t ty = d > 0 ? dy / d * 0.5f : 0.0f;
+    const fp32_t p[4][2] = { // +/- normal (-ty, tx)
+        { x0 - tx - ty, y0 - ty + tx },
+        { x1 + tx - ty, y1 + ty + tx },
+        { x1 + tx + ty, y1 + ty - tx },
+        { x0 - tx + ty, y0 - ty - tx }
+    };
+    for (int32_t k = 0; k < 4; k++) {
+        e[k * 4 + 0] = p[k][0];
+        e[k * 4 + 1] = p[k][1];
+        e[k * 4 + 2] = p[(k + 1) % 4][0];
+        e[k * 4 + 3] = p[(k + 1) % 4][1];
+    }
+}
+
+static struct ui_rect ui_raster_extent(const struct ui_point* points,
+        int32_t count) {
+    int32_t x0 = points[0].x;
+    int32_t y0 = points[0].y;
+    int32_t x1 = x0;
+    int32_t y1 = y0;
+    for (int32_t i = 1; i < count; i++) {
+        x0 = posix_min(x0, points[i].x);
+        y0 = posix_min(y0, points[i].y);
+        x1 = posix_max(x1, points[i].x);
+        y1 = posix_max(y1, points[i].y);
+    }
+    return (struct ui_rect){ x0, y0, x1 - x0, y1 - y0 };
+}
+
+static void ui_raster_stroke(struct ui_raster* r,
+        const struct ui_point* points, int32_t count, uint32_t p) {
+    // corners of square caps stick out up to 0.71 pixel from centers
+    const struct ui_rect e = ui_raster_extent(points, count);
+    const struct ui_rect bounds = { e.x - 1, e.y - 1, e.w + 3, e.h + 3 };
+    struct ui_raster_command* c = p == 0 ? null :
+        ui_raster_add(r, ui_raster_op_path, bounds);
+    const int32_t segments = posix_max(count - 1, 1);
+    fp32_t* edges = c == null ? null :
+        (fp32_t*)ui_raster_data(r, c, segments * 16 * (int64_t)sizeof(fp32_t));
+    if (edges != null) {
+        c->c0 = p;
+        c->count = segments * 4;
+        for (int32_t i = 0; i < segments; i++) {
+            const struct ui_point* a = &points[i];
+            const struct ui_point* b = &points[posix_min(i + 1, count - 1)];
+            ui_raster_segment(edges + i * 16, a->x + 0.5f, a->y + 0.5f,
+                                              b->x + 0.5f, b->y + 0.5f);
+        }
+    }
+}
+
+static void ui_raster_line(struct ui_raster* r, int32_t x0, int32_t y0,
+        int32_t x1, int32_t y1, ui_color_t c) {
+    if (x0 == x1 || y0 == y1) { // exactly what stroke() covers:
+        ui_raster_rectangle(r, posix_min(x0, x1), posix_min(y0, y1),
+            abs(x1 - x0) + 1, abs(y1 - y0) + 1, ui_raster_color(c));
+    } else {
+        const struct ui_point points[2] = { { x0, y0 }, { x1, y1 } };
+        ui_raster_stroke(r, points, 2, ui_raster_color(c));
+    }
+}
+
+static void ui_raster_poly(struct ui_raster* r, const struct ui_point* points,
+        int32_t count, ui_color_t c) {
+    if (count > 0) { ui_raster_stroke(r, points, count, ui_raster_color(c)); }
+}
+
+static void ui_raster_polygon(struct ui_raster* r,
+        const struct ui_point* points, int32_t count, ui_color_t color) {
+    const uint32_t p = ui_raster_color(color);
+    struct ui_raster_command* c = p == 0 || count < 3 ? null :
+        ui_raster_add(r, ui_raster_op_path, ui_raster_extent(points, count));
+    fp32_t* e = c == null ? null :
+        (fp32_t*)ui_raster_data(r, c, count * 4 * (int64_t)sizeof(fp32_t));
+    if (e != null) {
+        c->c0 = p;
+        c->count = count;
+        for (int32_t i = 0; i < count; i++) {
+            const struct ui_point* b = &points[(i + 1) % count];
+            e[i * 4 + 0] = (fp32_t)points[i].x;
+            e[i * 4 + 1] = (fp32_t)points[i].y;
+            e[i * 4 + 2] = (fp32_t)b->x;
+            e[i * 4 + 3] = (fp32_t)b->y;
+        }
+    }
+}
+
+static void ui_raster_round_rect(struct ui_raster* r, int32_t x, int32_t y,
+        int32_t w, int32_t h, fp32_t radius, ui_color_t border,
+        ui_color_t fill) {
+    const uint32_t f = ui_raster_color(fill);
+    const uint32_t b = ui_raster_color(border);
+    struct ui_raster_command* c = f == 0 && b == 0 ? null :
+        ui_raster_add(r, ui_raster_op_rounded, (struct ui_rect){ x, y, w, h });
+    if (c != null) {
+        c->x = x; c->y = y; c->w = w; c->h = h;
+        c->radius = radius;
+        c->c0 = f;
+        c->c1 = b;
+    }
+}
+
+static void ui_raster_rounded(struct ui_raster* r, int32_t x, int32_t y,
+        int32_t w, int32_t h, int32_t radius, ui_color_t border,
+        ui_color_t fill) {
+    ui_raster_round_rect(r, x, y, w, h, (fp32_t)radius, border, fill);
+}
+
+static void ui_raster_circle(struct ui_raster* r, int32_t x, int32_t y,
+        int32_t radius, ui_color_t border, ui_color_t fill) {
+    ui_raster_round_rect(r, x - radius, y - radius, radius * 2 + 1,
+        radius * 2 + 1, radius + 0.5f, border, fill);
+}
+
+static void ui_raster_gradient(struct ui_raster* r, int32_t x, int32_t y,
+        int32_t w, int32_t h, ui_color_t from, ui_color_t to, bool vertical) {
+    const uint32_t c0 = ui_raster_straight(from);
+    const uint32_t c1 = ui_raster_straight(to);
+    struct ui_raster_command* c = c0 == 0 && c1 == 0 ? null :
+        ui_raster_add(r, ui_raster_op_gradient, (struct ui_rect){ x, y, w, h });
+    if (c != null) {
+        c->x = x; c->y = y; c->w = w; c->h = h;
+        c->c0 = c0;
+        c->c1 = c1;
+        c->vertical = vertical;
+    }
+}
+
+static void ui_raster_image(struct ui_raster* r, int32_t dx, int32_t dy,
+        int32_t dw, int32_t dh, int32_t ix, int32_t iy, int32_t iw,
+        int32_t ih, int32_t width, int32_t height, int32_t stride,
+        int32_t bpp, const uint8_t* pixels, fp64_t alpha,
+        bool premultiplied) {
+    posix_assert(bpp == 1 || bpp == 3 || bpp == 4, "bpp: %d", bpp);
+    posix_assert(0 <= ix && ix + iw <= width && 0 <= iy && iy + ih <= height);
+    posix_assert(0 <= alpha && alpha <= 1 && pixels != null);
+    (void)width; (void)height; // used by posix_assert() only
+    const uint8_t a = (uint8_t)(alpha * 255.0 + 0.5);
+    struct ui_raster_command* c = a == 0 || iw <= 0 || ih <= 0 ? null :
+        ui_raster_add(r, ui_raster_op_image, (struct ui_rect){ dx, dy, dw, dh });
+    if (c != null) {
+        c->x = dx; c->y = dy; c->w = dw; c->h = dh;
+        c->image.pixels = pixels;
+        c->image.x = ix;
+        c->image.y = iy;
+        c->image.w = iw;
+        c->image.h = ih;
+        c->image.stride = stride;
+        c->image.bpp = bpp;
+        c->image.alpha = a;
+        c->image.premultiplied = premultiplied;
+    }
+}
+
+static void ui_raster_mask(struct ui_raster* r, int32_t x, int32_t y,
+        int32_t w, int32_t h, const uint8_t* coverage, int32_t stride,
+        ui_color_t color) {
+    const uint32_t p = ui_raster_color(color);
+    struct ui_raster_command* c = p == 0 ? null :
+        ui_raster_add(r, ui_raster_op_mask, (struct ui_rect){ x, y, w, h });
+    uint8_t* m = c == null ? null :
+        (uint8_t*)ui_raster_data(r, c, (int64_t)w * h);
+    if (m != null) {
+        c->x = x; c->y = y; c->w = w; c->h = h;
+        c->c0 = p;
+        for (int32_t j = 0; j < h; j++) {
+            memcpy(m + (int64_t)j * w, coverage + (int64_t)j * stride, (size_t)w);
+        }
+    }
+}
+
+// rendering:
+
+struct ui_raster_job {
+    struct ui_raster* r;
+    const struct ui_raster_kernels* k;
+};
+
+struct ui_raster_scratch { // of a tile on the stack of a worker thread
+    fp32_t   acc[ui_raster_tile * (ui_raster_tile + 2)]; // path coverage
+    uint8_t  coverage[ui_raster_tile];
+    uint32_t span[ui_raster_tile];
+};
+
+static inline uint32_t* ui_raster_row(const struct ui_raster* r, int32_t y) {
+    return (uint32_t*)((uint8_t*)r->bitmap->pixels + (int64_t)y * r->bitmap->stride);
+}
+
+static inline uint8_t ui_raster_coverage(fp32_t v) {
+    return v <= 0 ? 0 : (v >= 1 ? 255 : (uint8_t)(v * 255.0f + 0.5f));
+}
+
+static void ui_raster_span(const struct ui_raster_kernels* k, uint32_t* d,
+        uint32_t p, int32_t n) {
+    if (p >> 24 == 0xFF) { k->fill(d, p, n); } else { k->blend(d, p, n); }
+}
+
+static void ui_raster_draw_fill(struct ui_raster_job* job,
+        const struct ui_raster_command* c, struct ui_rect rc) {
+    for (int32_t j = rc.y; j < rc.y + rc.h; j++) {
+        ui_raster_span(job->k, ui_raster_row(job->r, j) + rc.x, c->c0, rc.w);
+    }
+}
+
+static uint32_t ui_raster_lerp(uint32_t c0, uint32_t c1, fp32_t t) {
+    uint32_t s = 0;
+    for (int32_t k = 0; k < 32; k += 8) {
+        const fp32_t a = (fp32_t)((c0 >> k) & 0xFF);
+        const fp32_t b = (fp32_t)((c1 >> k) & 0xFF);
+        s |= (uint32_t)(a + (b - a) * t + 0.5f) << k;
+    }
+    return ui_raster_premultiply(s);
+}
+
+static void ui_raster_draw_gradient(struct ui_raster_job* job,
+        const struct ui_raster_command* c, struct ui_rect rc,
+        struct ui_raster_scratch* s) {
+    // t of pixel centers: Direct2D linear gradient from x, y to the
+    // x + w or y + h edge
+    if (c->vertical) {
+        for (int32_t j = rc.y; j < rc.y + rc.h; j++) {
+            const fp32_t t = ((fp32_t)(j - c->y) + 0.5f) / (fp32_t)c->h;
+            ui_raster_span(job->k, ui_raster_row(job->r, j) + rc.x,
+                           ui_raster_lerp(c->c0, c->c1, t), rc.w);
+        }
+    } else {
+        for (int32_t i = 0; i < rc.w; i++) {
+            const fp32_t t = ((fp32_t)(rc.x + i - c->x) + 0.5f) / (fp32_t)c->w;
+            s->span[i] = ui_raster_lerp(c->c0, c->c1, t);
+        }
+        for (int32_t j = rc.y; j < rc.y + rc.h; j++) {
+            job->k->blit(ui_raster_row(job->r, j) + rc.x, s->span, 0xFF, rc.w);
+        }
+    }
+}
+
+struct ui_raster_round { // rounded rectangle
+    fp32_t cx; // center
+    fp32_t cy;
+    fp32_t hx; // half size
+    fp32_t hy;
+    fp32_t radius;
+};
+
+static fp32_t ui_raster_distance(const struct ui_raster_round* g,
+        fp32_t x, fp32_t y) {
+    // signed distance from x, y to the outline (negative inside)
+    const fp32_t qx = fabsf(x - g->cx) - (g->hx - g->radius);
+    const fp32_t qy = fabsf(y - g->cy) - (g->hy - g->radius);
+    const fp32_t ox = qx > 0 ? qx : 0;
+    const fp32_t oy = qy > 0 ? qy : 0;
+    const fp32_t inside = qx > qy ? qx : qy;
+    return sqrtf(ox * ox + oy * oy) + (inside < 0 ? inside : 0) - g->radius;
+}
+
+static inline uint8_t ui_raster_rounded_coverage(fp32_t d, bool border) {
+    // fill: 1/2 pixel each side of the outline, border: 1 pixel inside
+    return border ? ui_raster_coverage(1.0f - fabsf(d + 0.5f)) :
+                    ui_raster_coverage(0.5f - d);
+}
+
+static void ui_raster_rounded_run(struct ui_raster_job* job,
+        const struct ui_raster_round* g, bool border, uint32_t p,
+        uint32_t* d, int32_t x0, int32_t x1, fp32_t y,
+        struct ui_raster_scratch* s) {
+    for (int32_t i = x0; i < x1; i++) {
+        const fp32_t distance = ui_raster_distance(g, (fp32_t)i + 0.5f, y);
+        s->coverage[i - x0] = ui_raster_rounded_coverage(distance, border);
+    }
+    job->k->mask(d + x0, p, s->coverage, x1 - x0);
+}
+
+static void ui_raster_draw_rounded(struct ui_raster_job* job,
+        const struct ui_raster_command* c, struct ui_rect rc,
+        struct ui_raster_scratch* s) {
+    struct ui_raster_round g = {
+        .cx = (fp32_t)c->x + (fp32_t)c->w * 0.5f,
+        .cy = (fp32_t)c->y + (fp32_t)c->h * 0.5f,
+        .hx = (fp32_t)c->w * 0.5f,
+        .hy = (fp32_t)c->h * 0.5f
+    };
+    g.radius = posix_max(0.0f, posix_min(c->radius, posix_min(g.hx, g.hy)));
+    // Pixels farther than radius + 2 from left and right edges are at
+    // the distance of the horizontal slab fabs(y - cy) - hy: coverage
+    // of the middle of the row is the same for all its pixels.
+    const int32_t e = (int32_t)ceilf(g.radius) + 2;
+    const int32_t m0 = posix_max(c->x + e, rc.x);
+    const int32_t m1 = posix_min(c->x + c->w - e, rc.x + rc.w);
+    const int32_t x1 = rc.x + rc.w;
+    for (int32_t pass = 0; pass < 2; pass++) {
+        const bool border = pass == 1;
+        const uint32_t p = border ? c->c1 : c->c0;
+        for (int32_t j = rc.y; j < rc.y + rc.h && p != 0; j++) {
+            const fp32_t y = (fp32_t)j + 0.5f;
+            uint32_t* d = ui_raster_row(job->r, j);
+            if (m0 < m1) {
+                if (rc.x < m0) { ui_raster_rounded_run(job, &g, border, p, d, rc.x, m0, y, s); }
+                const fp32_t slab = fabsf(y - g.cy) - g.hy;
+                const uint8_t v = ui_raster_rounded_coverage(slab, border);
+                if (v == 0xFF) {
+                    ui_raster_span(job->k, d + m0, p, m1 - m0);
+                } else if (v > 0) {
+                    job->k->blend(d + m0, ui_raster_scale(p, v), m1 - m0);
+                }
+                if (m1 < x1) { ui_raster_rounded_run(job, &g, border, p, d, m1, x1, y, s); }
+            } else {
+                ui_raster_rounded_run(job, &g, border, p, d, rc.x, x1, y, s);
+            }
+        }
+    }
+}
+
+// Paths are filled with signed area coverage accumulation (as font-rs
+// and stb_truetype do): each edge adds its signed area to the cells of
+// the rows it crosses and the running sum of a row is the coverage.
+
+static void ui_raster_accumulate(fp32_t* acc, int32_t w, int32_t h,
+        fp32_t x0, fp32_t y0, fp32_t x1, fp32_t y1) {
+    const int32_t stride = w + 2;
+    const fp32_t fw = (fp32_t)w;
+    if (y0 != y1) {
+        fp32_t direction = 1.0f;
+        if (y0 > y1) {
+            fp32_t t = x0; x0 = x1; x1 = t;
+            t = y0; y0 = y1; y1 = t;
+            direction = -1.0f;
+        }
+        const fp32_t dxdy = (x1 - x0) / (y1 - y0);
+        fp32_t x = y0 < 0 ? x0 - y0 * dxdy : x0;
+        const int32_t ys = posix_max(0, (int32_t)y0);
+        const int32_t ye = posix_min(h, (int32_t)ceilf(y1));
+        for (int32_t j = ys; j < ye; j++) {
+            fp32_t* a = acc + j * stride;
+            const fp32_t dy = posix_min((fp32_t)(j + 1), y1) -
+                              posix_max((fp32_t)j, y0);
+            const fp32_t xn = posix_max(0.0f, posix_min(fw, x + dxdy * dy));
+            const fp32_t d = dy * direction;
+            const fp32_t xa = x < xn ? x : xn;
+            const fp32_t xb = x < xn ? xn : x;
+            const fp32_t fa = floorf(xa);
+            const fp32_t cb = ceilf(xb);
+            const int32_t ia = (int32_t)fa;
+            const int32_t ib = (int32_t)cb;
+            if (ib <= ia + 1) { // inside of a single cell
+                const fp32_t xm = 0.5f * (x + xn) - fa;
+                a[ia]     += d - d * xm;
+                a[ia + 1] += d * xm;
+            } else {
+                const fp32_t s = 1.0f / (xb - xa);
+                const fp32_t xf = xa - fa;
+                const fp32_t a0 = 0.5f * s * (1.0f - xf) * (1.0f - xf);
+                const fp32_t xl = xb - cb + 1.0f;
+                const fp32_t am = 0.5f * s * xl * xl;
+                a[ia] += d * a0;
+                if (ib == ia + 2) {
+                    a[ia + 1] += d * (1.0f - a0 - am);
+                } else {
+                    const fp32_t a1 = s * (1.5f - xf);
+                    a[ia + 1] += d * (a1 - a0);
+                    for (int32_t i = ia + 2; i < ib - 1; i++) { a[i] += d * s; }
+                    const fp32_t a2 = a1 + (fp32_t)(ib - ia - 3) * s;
+                    a[ib - 1] += d * (1.0f - a2 - am);
+                }
+                a[ib] += d * am;
+            }
+            x = xn;
+        }
+    }
+}
+
+static void ui_raster_edge(fp32_t* acc, int32_t w, int32_t h,
+        fp32_t x0, fp32_t y0, fp32_t x1, fp32_t y1) {
+    // Parts of the edge left of 0 or right of w become vertical at 0 or w:
+    // coverage of pixels in between does not change (winding only).
+    const fp32_t fw = (fp32_t)w;
+    const fp32_t fh = (fp32_t)h;
+    const bool above = y0 <= 0 && y1 <= 0;
+    const bool below = y0 >= fh && y1 >= fh;
+    if (!above && !below && y0 != y1) {
+        fp32_t t[2];
+        int32_t n = 0;
+        if ((x0 < 0) != (x1 < 0))   { t[n++] = (0 - x0) / (x1 - x0); }
+        if ((x0 < fw) != (x1 < fw)) { t[n++] = (fw - x0) / (x1 - x0); }
+        if (n == 2 && t[0] > t[1]) { const fp32_t s = t[0]; t[0] = t[1]; t[1] = s; }
+        fp32_t px = x0;
+        fp32_t py = y0;
+        for (int32_t i = 0; i <= n; i++) {
+            const fp32_t qx = i < n ? x0 + (x1 - x0) * t[i] : x1;
+            const fp32_t qy = i < n ? y0 + (y1 - y0) * t[i] : y1;
+            ui_raster_accumulate(acc, w, h,
+                posix_max(0.0f, posix_min(fw, px)), py,
+                posix_max(0.0f, posix_min(fw, qx)), qy);
+            px = qx;
+            py = qy;
+        }
+    }
+}
+
+static void ui_raster_draw_path(struct ui_raster_job* job,
+        const struct ui_raster_command* c, struct ui_rect rc,
+        struct ui_raster_scratch* s) {
+    const int32_t stride = rc.w + 2;
+    memset(s->acc, 0x00, (size_t)(rc.h * stride) * sizeof(fp32_t));
+    const fp32_t* e = (const fp32_t*)(job->r->data + c->offset);
+    const fp32_t x = (fp32_t)rc.x;
+    const fp32_t y = (fp32_t)rc.y;
+    for (int32_t i = 0; i < c->count; i++) {
+        ui_raster_edge(s->acc, rc.w, rc.h, e[0] - x, e[1] - y, e[2] - x, e[3] - y);
+        e += 4;
+    }
+    for (int32_t j = 0; j < rc.h; j++) {
+        const fp32_t* a = s->acc + j * stride;
+        fp32_t sum = 0;
+        uint8_t any = 0;
+        for (int32_t i = 0; i < rc.w; i++) {
+            sum += a[i];
+            s->coverage[i] = ui_raster_coverage(fabsf(sum));
+            any |= s->coverage[i];
+        }
+        if (any != 0) {
+            job->k->mask(ui_raster_row(job->r, rc.y + j) + rc.x, c->c0,
+                         s->coverage, rc.w);
+        }
+    }
+}
+
+static inline uint32_t ui_raster_source(const uint8_t* p, int32_t bpp,
+        bool premultiplied) {
+    uint32_t v = 0;
+    if (bpp == 1) {
+        v = p[0] * 0x010101u | 0xFF000000u;
+    } else if (bpp == 3) {
+        v = p[0] | (uint32_t)p[1] << 8 | (uint32_t)p[2] << 16 | 0xFF000000u;
+    } else {
+        memcpy(&v, p, sizeof(v));
+        if (!premultiplied) { v |= 0xFF000000u; }
+    }
+    return v;
+}
+
+static void ui_raster_draw_image(struct ui_raster_job* job,
+        const struct ui_raster_command* c, struct ui_rect rc,
+        struct ui_raster_scratch* s) {
+    // nearest source pixel of destination pixel center
+    const bool direct = c->image.bpp == 4 && c->image.premultiplied &&
+                        c->w == c->image.w && c->h == c->image.h;
+    for (int32_t j = rc.y; j < rc.y + rc.h; j++) {
+        const int32_t sy = c->image.y + (int32_t)(
+            ((int64_t)(j - c->y) * 2 + 1) * c->image.h / ((int64_t)c->h * 2));
+        const uint8_t* line = c->image.pixels + (int64_t)sy * c->image.stride;
+        const uint32_t* src = s->span;
+        if (direct) {
+            src = (const uint32_t*)line + c->image.x + (rc.x - c->x);
+        } else {
+            for (int32_t i = 0; i < rc.w; i++) {
+                const int32_t sx = c->image.x + (int32_t)(
+                    ((int64_t)(rc.x + i - c->x) * 2 + 1) * c->image.w /
+                    ((int64_t)c->w * 2));
+                s->span[i] = ui_raster_source(line + (int64_t)sx * c->image.bpp,
+                                              c->image.bpp, c->image.premultiplied);
+            }
+        }
+        job->k->blit(ui_raster_row(job->r, j) + rc.x, src, c->image.alpha, rc.w);
+    }
+}
+
+static void ui_raster_draw_mask(struct ui_raster_job* job,
+        const struct ui_raster_command* c, struct ui_rect rc) {
+    const uint8_t* m = job->r->data + c->offset;
+    for (int32_t j = rc.y; j < rc.y + rc.h; j++) {
+        job->k->mask(ui_raster_row(job->r, j) + rc.x, c->c0,
+                     m + (int64_t)(j - c->y) * c->w + (rc.x - c->x), rc.w);
+    }
+}
+
+static void ui_raster_task(void* that, int32_t t) {
+    struct ui_raster_job* job = (struct ui_raster_job*)that;
+    const struct ui_raster* r = job->r;
+    const int32_t n = (r->bitmap->w + ui_raster_tile - 1) / ui_raster_tile;
+    const int32_t x = t % n * ui_raster_tile;
+    const int32_t y = t / n * ui_raster_tile;
+    const struct ui_rect tile = { x, y,
+        posix_min(ui_raster_tile, r->bitmap->w - x),
+        posix_min(ui_raster_tile, r->bitmap->h - y) };
+    struct ui_raster_scratch s;
+    for (int32_t i = 0; i < r->count; i++) {
+        const struct ui_raster_command* c = &r->commands[i];
+        const struct ui_rect rc = ui_raster_intersect(c->bounds, tile);
+        if (rc.w > 0) {
+            switch (c->op) {
+                case ui_raster_op_fill:     ui_raster_draw_fill(job, c, rc); break;
+                case ui_raster_op_gradient: ui_raster_draw_gradient(job, c, rc, &s); break;
+                case ui_raster_op_rounded:  ui_raster_draw_rounded(job, c, rc, &s); break;
+                case ui_raster_op_path:     ui_raster_draw_path(job, c, rc, &s); break;
+                case ui_raster_op_image:    ui_raster_draw_image(job, c, rc, &s); break;
+                case ui_raster_op_mask:     ui_raster_draw_mask(job, c, rc); break;
+                default: posix_assert(false, "op: %d", c->op); break;
+            }
+        }
+    }
+}
+
+static void ui_raster_render(struct ui_raster* r) {
+    const struct ui_bitmap* b = r->bitmap;
+    posix_assert(b != null && b->bpp == 4, "begin() not called");
+    if (r->count > 0) {
+        struct ui_raster_job job = { .r = r, .k = ui_raster_kernels() };
+        const int32_t tw = (b->w + ui_raster_tile - 1) / ui_raster_tile;
+        const int32_t th = (b->h + ui_raster_tile - 1) / ui_raster_tile;
+        ui_parallel.for_each(tw * th, ui_raster_task, &job);
+    }
+}
+
+static int ui_raster_end(struct ui_raster* r) {
+    ui_raster_render(r);
+    return r->error;
+}
+
+static void ui_raster_dispose(struct ui_raster* r) {
+    if (r->commands != null) { posix_heap.free(r->commands); }
+    if (r->data != null) { posix_heap.free(r->data); }
+    memset(r, 0x00, sizeof(*r));
+}
+
+// tests:
+
+enum { ui_raster_test_max = 1024 + 31 };
+
+static void ui_raster_test_kernels(int32_t isa, uint32_t* seed) {
+    // every kernel of `isa` against scalar kernels for exact match for
+    // all lengths up to SIMD width and misaligned arrays
+    static uint32_t d[2][ui_raster_test_max + 8];
+    static uint32_t s[ui_raster_test_max + 8];
+    static uint8_t  m[ui_raster_test_max + 8];
+    const struct ui_raster_kernels* k = ui_raster_of(isa);
+    for (int32_t pass = 0; pass < 200; pass++) {
+        const int32_t n = pass < 64 ? pass :
+            (int32_t)(posix_num.random32(seed) % ui_raster_test_max);
+        const int32_t o = (int32_t)(posix_num.random32(seed) % 8);
+        for (int32_t i = 0; i < posix_countof(s); i++) {
+            d[0][i] = posix_num.random32(seed);
+            // premultiplied, opaque, transparent and invalid (saturated)
+            uint32_t p = posix_num.random32(seed);
+            if (i % 3 == 0) { p = ui_raster_premultiply(p); }
+            if (i % 5 == 0) { p |= 0xFF000000u; }
+            if (i % 7 == 0) { p = 0; }
+            s[i] = p;
+            m[i] = (uint8_t)(i % 4 == 0 ? (i % 8 == 0 ? 0 : 0xFF) :
+                             posix_num.random32(seed));
+        }
+        const uint32_t c = pass % 2 == 0 ? ui_raster_premultiply(s[pass]) : s[pass];
+        const uint8_t a = (uint8_t)(pass % 3 == 0 ? 0xFF : posix_num.random32(seed));
+        for (int32_t kernel = 0; kernel < 4; kernel++) {
+            memcpy(d[1] + o, d[0], sizeof(d[0]) - 8 * sizeof(d[0][0]));
+            d[1][o + n] = 0x5A5A5A5A;
+            uint32_t* d0 = d[0];
+            uint32_t* d1 = d[1] + o;
+            const uint32_t saved = d0[n];
+            switch (kernel) {
+                case 0: ui_raster_scalar_kernels.fill(d0, c, n);     k->fill(d1, c, n);     break;
+                case 1: ui_raster_scalar_kernels.blend(d0, c, n);    k->blend(d1, c, n);    break;
+                case 2: ui_raster_scalar_kernels.mask(d0, c, m, n);  k->mask(d1, c, m, n);  break;
+                case 3: ui_raster_scalar_kernels.blit(d0, s, a, n);  k->blit(d1, s, a, n);  break;
+                default: break;
+            }
+            posix_swear(memcmp(d0, d1, (size_t)n * sizeof(d0[0])) == 0,
+                        "%s kernel: %d n: %d", ui_pixels.name(isa), kernel, n);
+            posix_swear(d[1][o + n] == 0x5A5A5A5A && d0[n] == saved); // no overrun
+        }
+    }
+}
+
+static void ui_raster_test_math(void) {
+    for (uint32_t x = 0; x < 256; x++) {
+        for (uint32_t y = 0; y < 256; y++) {
+            const uint32_t e = (uint32_t)(x * y / 255.0 + 0.5);
+            posix_swear(ui_raster_mul(x, y) == e, "%d * %d", x, y);
+        }
+    }
+    // 50% white over black, opaque over anything, transparent over anything
+    posix_swear(ui_raster_over(0xFF000000u, 0x80808080u) == 0xFF808080u);
+    posix_swear(ui_raster_over(0x12345678u, 0xFF010203u) == 0xFF010203u);
+    posix_swear(ui_raster_over(0x12345678u, 0) == 0x12345678u);
+    posix_swear(ui_raster_color(ui_color_rgb(0x10, 0x20, 0x30)) == 0xFF102030u);
+    posix_swear(ui_raster_color(ui_color_rgba(0xFF, 0, 0, 0x80)) == 0x80800000u);
+    posix_swear(ui_raster_color(ui_color_transparent) == 0);
+}
+
+enum { ui_raster_test_w = 300, ui_raster_test_h = 200 };
+
+static uint32_t ui_raster_test_pixels[2][ui_raster_test_w * ui_raster_test_h];
+
+static struct ui_bitmap ui_raster_test_bitmap(int32_t i, uint32_t background) {
+    struct ui_bitmap b = {
+        .pixels = ui_raster_test_pixels[i],
+        .w = ui_raster_test_w, .h = ui_raster_test_h,
+        .bpp = 4, .stride = ui_raster_test_w * 4
+    };
+    for (int32_t k = 0; k < ui_raster_test_w * ui_raster_test_h; k++) {
+        ui_raster_test_pixels[i][k] = background;
+    }
+    return b;
+}
+
+static uint32_t ui_raster_test_at(int32_t i, int32_t x, int32_t y) {
+    return ui_raster_test_pixels[i][y * ui_raster_test_w + x];
+}
+
+static fp64_t ui_raster_test_area(int32_t i) {
+    // sum of alpha of black background painted over by white
+    fp64_t area = 0;
+    for (int32_t k = 0; k < ui_raster_test_w * ui_raster_test_h; k++) {
+        area += (ui_raster_test_pixels[i][k] & 0xFF) / 255.0;
+    }
+    return area;
+}
+
+static bool ui_raster_test_same(void) {
+    return memcmp(ui_raster_test_pixels[0], ui_raster_test_pixels[1],
+                  sizeof(ui_raster_test_pixels[0])) == 0;
+}
+
+static void ui_raster_test_shapes(void) {
+    const ui_color_t white = ui_color_rgb(0xFF, 0xFF, 0xFF);
+    const ui_color_t red = ui_color_rgb(0xFF, 0x00, 0x00);
+    const uint32_t black = 0xFF000000u;
+    struct ui_raster r = {0};
+    struct ui_bitmap b0 = ui_raster_test_bitmap(0, black);
+    struct ui_bitmap b1 = ui_raster_test_bitmap(1, black);
+    // fill() clipped, frame() inside of the rectangle:
+    ui_raster.begin(&r, &b0);
+    ui_raster.set_clip(&r, 10, 10, 20, 20);
+    ui_raster.fill(&r, 0, 0, 100, 100, red);
+    ui_raster.set_clip(&r, 0, 0, 0, 0);
+    ui_raster.frame(&r, 100, 100, 10, 5, white);
+    posix_swear(ui_raster.end(&r) == 0);
+    for (int32_t y = 0; y < 100; y++) {
+        for (int32_t x = 0; x < 100; x++) {
+            const bool inside = 10 <= x && x < 30 && 10 <= y && y < 30;
+            posix_swear(ui_raster_test_at(0, x, y) == (inside ? 0xFFFF0000u : black));
+        }
+    }
+    for (int32_t y = 99; y <= 105; y++) {
+        for (int32_t x = 99; x <= 110; x++) {
+            const bool inside = 100 <= x && x < 110 && 100 <= y && y < 105;
+            const bool edge = x == 100 || x == 109 || y == 100 || y == 104;
+            posix_swear(ui_raster_test_at(0, x, y) ==
+                        (inside && edge ? 0xFFFFFFFFu : black));
+        }
+    }
+    // polygon() through pixel corners == fill(), rounded() radius 0 == rect():
+    b0 = ui_raster_test_bitmap(0, black);
+    b1 = ui_raster_test_bitmap(1, black);
+    const struct ui_point square[4] = { {5, 7}, {105, 7}, {105, 77}, {5, 77} };
+    ui_raster.begin(&r, &b0);
+    ui_raster.polygon(&r, square, 4, red);
+    ui_raster.rounded(&r, 150, 20, 100, 60, 0, white, red);
+    ui_raster.line(&r, 10, 150, 200, 150, white);
+    posix_swear(ui_raster.end(&r) == 0);
+    ui_raster.begin(&r, &b1);
+    ui_raster.fill(&r, 5, 7, 100, 70, red);
+    ui_raster.rect(&r, 150, 20, 100, 60, white, red);
+    ui_raster.fill(&r, 10, 150, 191, 1, white);
+    posix_swear(ui_raster.end(&r) == 0);
+    posix_swear(ui_raster_test_same());
+    // exact area coverage of polygon() and anti-aliased circle():
+    b0 = ui_raster_test_bitmap(0, black);
+    const struct ui_point triangle[3] = { {10, 10}, {110, 10}, {10, 110} };
+    ui_raster.begin(&r, &b0);
+    ui_raster.polygon(&r, triangle, 3, white);
+    posix_swear(ui_raster.end(&r) == 0);
+    posix_swear(fabs(ui_raster_test_area(0) - 5000.0) < 5.0);
+    b0 = ui_raster_test_bitmap(0, black);
+    ui_raster.begin(&r, &b0);
+    ui_raster.circle(&r, 150, 100, 40, ui_color_transparent, white);
+    posix_swear(ui_raster.end(&r) == 0);
+    const fp64_t disk = 3.14159265358979 * 40.5 * 40.5;
+    posix_swear(fabs(ui_raster_test_area(0) - disk) < disk * 0.002);
+    for (int32_t dy = -42; dy <= 42; dy++) { // symmetric
+        for (int32_t dx = -42; dx <= 42; dx++) {
+            const uint32_t p = ui_raster_test_at(0, 150 + dx, 100 + dy);
+            posix_swear(p == ui_raster_test_at(0, 150 - dx, 100 + dy));
+            posix_swear(p == ui_raster_test_at(0, 150 + dy, 100 + dx));
+        }
+    }
+    // diagonal line: 1 pixel wide, length + square caps
+    b0 = ui_raster_test_bitmap(0, black);
+    ui_raster.begin(&r, &b0);
+    ui_raster.line(&r, 10, 10, 110, 60, white);
+    posix_swear(ui_raster.end(&r) == 0);
+    const fp64_t length = sqrt(100.0 * 100.0 + 50.0 * 50.0) + 1.0;
+    posix_swear(fabs(ui_raster_test_area(0) - length) < length * 0.01);
+    posix_swear(ui_raster_test_at(0, 10, 10) != black &&
+                ui_raster_test_at(0, 110, 60) != black);
+    // gradient() from black to white, translucent mask() and image():
+    b0 = ui_raster_test_bitmap(0, 0);
+    ui_raster.begin(&r, &b0);
+    ui_raster.gradient(&r, 0, 0, 256, 10, ui_color_rgb(0, 0, 0), white, false);
+    ui_raster.gradient(&r, 0, 10, 10, 100, ui_color_rgb(0, 0, 0), white, true);
+    posix_swear(ui_raster.end(&r) == 0);
+    for (int32_t i = 0; i < 256; i++) {
+        const uint32_t v = (uint32_t)(255.0f * ((fp32_t)i + 0.5f) / 256.0f + 0.5f);
+        posix_swear(ui_raster_test_at(0, i, 5) == (0xFF000000u | v * 0x010101u));
+    }
+    for (int32_t j = 11; j < 110; j++) {
+        posix_swear(ui_raster_test_at(0, 0, j) > ui_raster_test_at(0, 0, j - 1));
+        posix_swear(ui_raster_test_at(0, 0, j) == ui_raster_test_at(0, 9, j));
+    }
+    static uint8_t coverage[4 * 3] = { 0, 0x80, 0xFF, 0, 0x40, 0, 0, 0, 0xFF };
+    static uint8_t bgr[2 * 6] = { 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12 };
+    b0 = ui_raster_test_bitmap(0, black);
+    ui_raster.begin(&r, &b0);
+    ui_raster.mask(&r, 10, 10, 3, 3, coverage, 4, white);
+    ui_raster.image(&r, 20, 20, 2, 2, 0, 0, 2, 2, 2, 2, 6, 3, bgr, 1.0, false);
+    ui_raster.image(&r, 30, 30, 4, 4, 0, 0, 2, 2, 2, 2, 6, 3, bgr, 1.0, false);
+    ui_raster.image(&r, 40, 40, 2, 2, 0, 0, 2, 2, 2, 2, 6, 3, bgr, 0.5, false);
+    posix_swear(ui_raster.end(&r) == 0);
+    posix_swear(ui_raster_test_at(0, 10, 10) == black);
+    posix_swear(ui_raster_test_at(0, 11, 10) == 0xFF808080u);
+    posix_swear(ui_raster_test_at(0, 12, 10) == 0xFFFFFFFFu);
+    posix_swear(ui_raster_test_at(0, 10, 11) == 0xFF404040u);
+    posix_swear(ui_raster_test_at(0, 20, 20) == 0xFF030201u);
+    posix_swear(ui_raster_test_at(0, 21, 21) == 0xFF0C0B0Au);
+    posix_swear(ui_raster_test_at(0, 31, 31) == 0xFF030201u);
+    posix_swear(ui_raster_test_at(0, 32, 33) == 0xFF0C0B0Au);
+    posix_swear(ui_raster_test_at(0, 40, 40) == 0xFF020101u);
+    ui_raster.dispose(&r);
+}
+
+static void ui_raster_test_scene(struct ui_raster* r, struct ui_bitmap* b,
+        uint32_t seed) {
+    // random primitives of all kinds across tile boundaries
+    static uint8_t coverage[37 * 23];
+    static uint32_t image[17 * 13];
+    for (int32_t i = 0; i < posix_countof(coverage); i++) {
+        coverage[i] = (uint8_t)posix_num.random32(&seed);
+    }
+    for (int32_t i = 0; i < posix_countof(image); i++) {
+        image[i] = ui_raster_premultiply(posix_num.random32(&seed));
+    }
+    ui_raster.begin(r, b);
+    for (int32_t i = 0; i < 400; i++) {
+        const uint32_t v = posix_num.random32(&seed);
+        const ui_color_t c0 = ui_color_rgba(v, v >> 8, v >> 16, v % 3 == 0 ? 0 : v >> 24);
+        const ui_color_t c1 = ui_color_rgba(v >> 24, v, v >> 8, v % 5 == 0 ? 0 : v >> 16);
+        const int32_t x = (int32_t)(posix_num.random32(&seed) % 340) - 20;
+        const int32_t y = (int32_t)(posix_num.random32(&seed) % 240) - 20;
+        const int32_t w = (int32_t)(posix_num.random32(&seed) % 120) + 1;
+        const int32_t h = (int32_t)(posix_num.random32(&seed) % 90) + 1;
+        const struct ui_point points[5] = {
+            { x, y }, { x + w, y + h / 3 }, { x + w / 2, y + h },
+            { x - w / 3, y + h / 2 }, { x + w / 4, y + h / 4 }
+        };
+        if (i % 37 == 0) { ui_raster.set_clip(r, x, y, w * 2, h * 2); }
+        if (i % 37 == 20) { ui_raster.set_clip(r, 0, 0, 0, 0); }
+        switch (i % 11) {
+            case  0: ui_raster.fill(r, x, y, w, h, c0); break;
+            case  1: ui_raster.rect(r, x, y, w, h, c0, c1); break;
+            case  2: ui_raster.rounded(r, x, y, w, h, (int32_t)(v % 15), c0, c1); break;
+            case  3: ui_raster.circle(r, x, y, (int32_t)(v % 50), c0, c1); break;
+            case  4: ui_raster.gradient(r, x, y, w, h, c0, c1, v % 2 == 0); break;
+            case  5: ui_raster.line(r, x, y, x + w, y + h - 45, c0); break;
+            case  6: ui_raster.poly(r, points, 5, c0); break;
+            case  7: ui_raster.polygon(r, points, 5, c1); break;
+            case  8: ui_raster.mask(r, x, y, 37, 23, coverage, 37, c0); break;
+            case  9: ui_raster.image(r, x, y, w, h, 0, 0, 17, 13, 17, 13,
+                                     17 * 4, 4, (const uint8_t*)image,
+                                     (v % 4) / 3.0, true); break;
+            case 10: ui_raster.frame(r, x, y, w, h, c1); break;
+            default: break;
+        }
+    }
+    posix_swear(ui_raster.end(r) == 0);
+}
+
+static void ui_raster_test_tiles(void) {
+    // results do not depend on threads and kernels
+    const int32_t saved = ui_raster.isa();
+    struct ui_raster r = {0};
+    struct ui_bitmap b0 = ui_raster_test_bitmap(0, 0xFF204060u);
+    ui_parallel.limit(1);
+    ui_raster.use(ui_pixels_scalar);
+    ui_raster_test_scene(&r, &b0, 1);
+    ui_parallel.limit(0);
+    for (int32_t isa = ui_pixels_scalar; isa <= ui_pixels_neon; isa++) {
+        if (ui_raster.use(isa)) {
+            struct ui_bitmap b1 = ui_raster_test_bitmap(1, 0xFF204060u);
+            ui_raster_test_scene(&r, &b1, 1);
+            posix_swear(ui_raster_test_same(), "%s", ui_pixels.name(isa));
+        }
+    }
+    posix_swear(ui_raster.use(saved));
+    ui_raster.dispose(&r);
+}
+
+static void ui_raster_test(void) {
+    const int32_t saved = ui_raster.isa();
+    uint32_t seed = 1;
+    for (int32_t isa = ui_pixels_sse2; isa <= ui_pixels_neon; isa++) {
+        if (ui_raster_of(isa) != null) { ui_raster_test_kernels(isa, &seed); }
+    }
+    ui_raster_test_math();
+    for (int32_t isa = ui_pixels_scalar; isa <= ui_pixels_neon; isa++) {
+        if (ui_raster.use(isa)) { ui_raster_test_shapes(); }
+    }
+    posix_swear(ui_raster.use(saved));
+    ui_raster_test_tiles();
+    if (posix_debug.verbosity.level > posix_debug.verbosity.quiet) {
+        posix_println("done %s", ui_pixels.name(ui_raster.isa()));
+    }
+}
+
+struct ui_raster_if ui_raster = {
+    .begin    = ui_raster_begin,
+    .end      = ui_raster_end,
+    .render   = ui_raster_render,
+    .dispose  = ui_raster_dispose,
+    .set_clip = ui_raster_set_clip,
+    .pixel    = ui_raster_pixel,
+    .line     = ui_raster_line,
+    .frame    = ui_raster_frame,
+    .rect     = ui_raster_rect,
+    .fill     = ui_raster_fill,
+    .poly     = ui_raster_poly,
+    .polygon  = ui_raster_polygon,
+    .circle   = ui_raster_circle,
+    .rounded  = ui_raster_rounded,
+    .gradient = ui_raster_gradient,
+    .image    = ui_raster_image,
+    .mask     = ui_raster_mask,
+    .isa      = ui_raster_isa,
+    .use      = ui_raster_use,
+    .test     = ui_raster_test
+};
+
+#ifdef UI_RASTER_TEST
+    posix_static_init(ui_raster) { ui_raster.test(); }
+#endif
@@ -0,0 +1,228 @@
+/* Copyright (c) Dmitry "Leo" Kuznetsov 2021-24 see LICENSE for details */
+#include "posix/posix.h"
+#include "ui/ui_core.h"
+#include "ui/ui_region.h"
+
+#undef UI_REGION_TEST
+
+#if 0 // flip to 1 to run tests
+
+#define UI_REGION_TEST
+
+#endif
+
+static int64_t ui_region_rect_area(const struct ui_rect* r) {
+    return (int64_t)r->w * (int64_t)r->h;
+}
+
+static bool ui_region_overlap(const struct ui_rect* a, const struct ui_rect* b) {
+    return a->x < b->x + b->w && b->x < a->x + a->w &&
+           a->y < b->y + b->h && b->y < a->y + a->h;
+}
+
+static bool ui_region_inside(const struct ui_rect* outer,
+        const struct ui_rect* r) {
+    return outer->x <= r->x && r->x + r->w <= outer->x + outer->w &&
+           outer->y <= r->y && r->y + r->h <= outer->y + outer->h;
+}
+
+static struct ui_rect ui_region_union(const struct ui_rect* a,
+        const struct ui_rect* b) {
+    const int32_t x = posix_min(a->x, b->x);
+    const int32_t y = posix_min(a->y, b->y);
+    return (struct ui_rect){
+        .x = x, .y = y,
+        .w = posix_max(a->x + a->w, b->x + b->w) - x,
+        .h = posix_max(a->y + a->h, b->y + b->h) - y
+    };
+}
+
+static int64_t ui_region_waste(const struct ui_rect* a, const struct ui_rect* b) {
+    // pixels repainted in vain if `a` and `b` are merged
+    const struct ui_rect u = ui_region_union(a, b);
+    return ui_region_rect_area(&u) - ui_region_rect_area(a) -
+           ui_region_rect_area(b);
+}
+
+static bool ui_region_mergeable(const struct ui_rect* a, const struct ui_rect* b) {
+    return ui_region_overlap(a, b) ||
+           ui_region_waste(a, b) <= ui_region_rect_area(a) +
+                                    ui_region_rect_area(b);
+}
+
+static void ui_region_add(struct ui_region* rg, const struct ui_rect* r) {
+    struct ui_rect a = *r;
+    bool merged = a.w > 0 && a.h > 0;
+    bool inside = false;
+    while (merged && !inside) {
+        merged = false;
+        for (int32_t i = 0; i < rg->count && !merged && !inside; i++) {
+            inside = ui_region_inside(&rg->r[i], &a);
+            if (!inside && ui_region_mergeable(&a, &rg->r[i])) {
+                a = ui_region_union(&a, &rg->r[i]);
+                rg->r[i] = rg->r[--rg->count];
+                merged = true; // union may overlap other rectangles
+            }
+        }
+    }
+    if (a.w <= 0 || a.h <= 0 || inside) {
+        // nothing to add
+    } else if (rg->count < ui_region_max_rects) {
+        rg->r[rg->count++] = a;
+    } else {
+        // merge pair with the least waste and add it back
+        struct ui_rect t[ui_region_max_rects + 1];
+        memcpy(t, rg->r, sizeof(rg->r));
+        t[ui_region_max_rects] = a;
+        const int32_t n = posix_countof(t);
+        int32_t bi = 0;
+        int32_t bj = 1;
+        int64_t best = INT64_MAX;
+        for (int32_t i = 0; i < n - 1; i++) {
+            for (int32_t j = i + 1; j < n; j++) {
+                const int64_t w = ui_region_waste(&t[i], &t[j]);
+                if (w < best) { best = w; bi = i; bj = j; }
+            }
+        }
+        const struct ui_rect u = ui_region_union(&t[bi], &t[bj]);
+        rg->count = 0;
+        for (int32_t i = 0; i < n; i++) {
+            if (i != bi && i != bj) { rg->r[rg->count++] = t[i]; }
+        }
+        ui_region_add(rg, &u);
+    }
+}
+
+static void ui_region_clip(struct ui_region* rg, const struct ui_rect* r) {
+    int32_t n = 0;
+    for (int32_t i = 0; i < rg->count; i++) {
+        const struct ui_rect* a = &rg->r[i];
+        const int32_t x0 = posix_max(a->x, r->x);
+        const int32_t y0 = posix_max(a->y, r->y);
+        const int32_t x1 = posix_min(a->x + a->w, r->x + r->w);
+        const int32_t y1 = posix_min(a->y + a->h, r->y + r->h);
+        if (x0 < x1 && y0 < y1) {
+            rg->r[n++] = (struct ui_rect){ x0, y0, x1 - x0, y1 - y0 };
+        }
+    }
+    rg->count = n;
+}
+
+static bool ui_region_intersects(const struct ui_region* rg,
+        const struct ui_rect* r) {
+    bool intersects = false;
+    for (int32_t i = 0; i < rg->count && !intersects; i++) {
+        intersects = ui_region_overlap(&rg->r[i], r);
+    }
+    return intersects;
+}
+
+static bool ui_region_contains(const struct ui_region* rg,
+        const struct ui_point* pt) {
+    const struct ui_rect p = { pt->x, pt->y, 1, 1 };
+    return ui_region_intersects(rg, &p);
+}
+
+static struct ui_rect ui_region_bounds(const struct ui_region* rg) {
+    struct ui_rect b = {0};
+    if (rg->count > 0) { b = rg->r[0]; }
+    for (int32_t i = 1; i < rg->count; i++) {
+        b = ui_region_union(&b, &rg->r[i]);
+    }
+    return b;
+}
+
+static int64_t ui_region_area(const struct ui_region* rg) {
+    int64_t a = 0;
+    for (int32_t i = 0; i < rg->count; i++) {
+        a += ui_region_rect_area(&rg->r[i]);
+    }
+    return a;
+}
+
+static void ui_region_reset(struct ui_region* rg) {
+    rg->count = 0;
+}
+
+static void ui_region_test_verify(const struct ui_region* rg,
+        const struct ui_rect added[], int32_t n, uint32_t* seed) {
+    posix_swear(0 <= rg->count && rg->count <= ui_region_max_rects);
+    for (int32_t i = 0; i < rg->count; i++) {
+        posix_swear(rg->r[i].w > 0 && rg->r[i].h > 0);
+        for (int32_t j = i + 1; j < rg->count; j++) {
+            posix_swear(!ui_region_overlap(&rg->r[i], &rg->r[j]));
+        }
+    }
+    // every pixel of added rectangles is covered
+    for (int32_t i = 0; i < n; i++) {
+        const struct ui_rect* r = &added[i];
+        if (r->w > 0 && r->h > 0) {
+            for (int32_t k = 0; k < 16; k++) {
+                const struct ui_point pt = {
+                    r->x + (int32_t)(posix_num.random32(seed) % (uint32_t)r->w),
+                    r->y + (int32_t)(posix_num.random32(seed) % (uint32_t)r->h)
+                };
+                posix_swear(ui_region.contains(rg, &pt));
+            }
+            posix_swear(ui_region.contains(rg, &(struct ui_point){ r->x, r->y }));
+            posix_swear(ui_region.contains(rg, &(struct ui_point){
+                r->x + r->w - 1, r->y + r->h - 1 }));
+        }
+    }
+}
+
+static void ui_region_test(void) {
+    struct ui_region rg = {0};
+    // adjacent rectangles are merged:
+    ui_region.add(&rg, &(struct ui_rect){ 0,  0, 10, 10 });
+    ui_region.add(&rg, &(struct ui_rect){ 10, 0, 10, 10 });
+    posix_swear(rg.count == 1 && rg.r[0].w == 20 && ui_region.area(&rg) == 200);
+    // contained rectangle changes nothing:
+    ui_region.add(&rg, &(struct ui_rect){ 5, 5, 2, 2 });
+    posix_swear(rg.count == 1 && ui_region.area(&rg) == 200);
+    // empty rectangles are ignored:
+    ui_region.add(&rg, &(struct ui_rect){ 500, 500, 0, 10 });
+    posix_swear(rg.count == 1);
+    // far apart rectangles are not merged:
+    ui_region.add(&rg, &(struct ui_rect){ 1000, 1000, 10, 10 });
+    posix_swear(rg.count == 2 && ui_region.area(&rg) == 300);
+    posix_swear(ui_region.intersects(&rg, &(struct ui_rect){ 995, 995, 6, 6 }));
+    posix_swear(!ui_region.intersects(&rg, &(struct ui_rect){ 20, 0, 10, 10 }));
+    const struct ui_rect b = ui_region.bounds(&rg);
+    posix_swear(b.x == 0 && b.y == 0 && b.w == 1010 && b.h == 1010);
+    ui_region.clip(&rg, &(struct ui_rect){ 0, 0, 15, 100 });
+    posix_swear(rg.count == 1 && ui_region.area(&rg) == 150);
+    // random rectangles: disjoint, covering, bounded count
+    uint32_t seed = 1;
+    struct ui_rect added[256];
+    for (int32_t pass = 0; pass < 64; pass++) {
+        ui_region.reset(&rg);
+        const int32_t n = 1 + (int32_t)(posix_num.random32(&seed) % posix_countof(added));
+        for (int32_t i = 0; i < n; i++) {
+            added[i] = (struct ui_rect){
+                .x = (int32_t)(posix_num.random32(&seed) % 1920),
+                .y = (int32_t)(posix_num.random32(&seed) % 1080),
+                .w = (int32_t)(posix_num.random32(&seed) % 200),
+                .h = (int32_t)(posix_num.random32(&seed) % 40)
+            };
+            ui_region.add(&rg, &added[i]);
+        }
+        ui_region_test_verify(&rg, added, n, &seed);
+    }
+    if (posix_debug.verbosity.level > posix_debug.verbosity.quiet) { posix_println("done"); }
+}
+
+struct ui_region_if ui_region = {
+    .add        = ui_region_add,
+    .clip       = ui_region_clip,
+    .intersects = ui_region_intersects,
+    .contains   = ui_region_contains,
+    .bounds     = ui_region_bounds,
+    .area       = ui_region_area,
+    .reset      = ui_region_reset,
+    .test       = ui_region_test
+};
+
+#ifdef UI_REGION_TEST
+    posix_static_init(ui_region) { ui_region.test(); }
+#endif
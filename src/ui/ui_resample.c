@@ -0,0 +1,718 @@
+/* Copyright (c) Dmitry "Leo" Kuznetsov 2021-24 see LICENSE for details */
+#include "posix/posix.h"
+#include "ui/ui_core.h"
+#include "ui/ui_parallel.h"
+#include "ui/ui_pixels.h"
+#include "ui/ui_resample.h"
+#include <math.h>
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__SSE2__)
+#include <emmintrin.h>
+#define ui_resample_has_sse2
+#if defined(_M_X64) || defined(__x86_64__)
+#include <immintrin.h>
+#define ui_resample_has_avx2
+#if defined(_MSC_VER)
+#pragma warning(disable: 4752) // AVX instructions w/o /arch:AVX (run time dispatch)
+#define ui_resample_avx2_target
+#else
+#define ui_resample_avx2_target __attribute__((target("avx2")))
+#endif
+#endif
+#endif
+
+#undef UI_RESAMPLE_TEST
+
+#if 0 // flip to 1 to run tests
+
+#define UI_RESAMPLE_TEST
+
+#endif
+
+// Fixed point weights: 1.0 == 1 << ui_resample_bits. Sum of absolute
+// weights of Lanczos-3 is < 1.3 thus 255 * sum fits into int32_t and
+// pairs of int16_t weights fit _mm_madd_epi16().
+
+enum { ui_resample_bits = 14 };
+
+struct ui_resample_axis {
+    int32_t* first; // [n] first source pixel of the output pixel
+    int16_t* w;     // [n * taps] weights, pairs for SIMD
+    int32_t  n;     // output pixels
+    int32_t  in;    // source pixels
+    int32_t  taps;  // same for all output pixels
+};
+
+typedef void (*ui_resample_h_kernel)(uint8_t* d, const uint8_t* s,
+    const struct ui_resample_axis* a, int32_t bpp);
+
+typedef void (*ui_resample_v_kernel)(uint8_t* d, const uint8_t** rows,
+    const int16_t* w, int32_t taps, int32_t bytes);
+
+struct ui_resample_kernels {
+    ui_resample_h_kernel h;
+    ui_resample_v_kernel v;
+};
+
+struct ui_resample_job {
+    struct ui_bitmap* d;
+    const struct ui_bitmap* s;
+    struct ui_resample_axis h; // horizontal
+    struct ui_resample_axis v; // vertical
+    const struct ui_resample_kernels* k;
+    int32_t band; // destination rows per task
+};
+
+static const fp64_t ui_resample_support[] = { 0.5, 1.0, 3.0 };
+
+static fp64_t ui_resample_sinc(fp64_t x) {
+    if (x == 0.0) { return 1.0; }
+    x *= 3.14159265358979323846;
+    return sin(x) / x;
+}
+
+static fp64_t ui_resample_filter(int32_t filter, fp64_t x) {
+    switch (filter) {
+        case ui_resample_box:
+            return -0.5 < x && x <= 0.5 ? 1.0 : 0.0;
+        case ui_resample_bilinear:
+            x = fabs(x);
+            return x < 1.0 ? 1.0 - x : 0.0;
+        default:
+            return -3.0 < x && x < 3.0 ?
+                ui_resample_sinc(x) * ui_resample_sinc(x / 3.0) : 0.0;
+    }
+}
+
+static inline uint8_t ui_resample_clamp(int32_t acc) {
+    const int32_t v = acc >> ui_resample_bits;
+    return (uint8_t)(v < 0 ? 0 : (v > 0xFF ? 0xFF : v));
+}
+
+static void ui_resample_axis_dispose(struct ui_resample_axis* a) {
+    if (a->first != null) { posix_heap.free(a->first); }
+    if (a->w != null) { posix_heap.free(a->w); }
+    memset(a, 0x00, sizeof(*a));
+}
+
+static int ui_resample_axis_init(struct ui_resample_axis* a,
+        int32_t origin, int32_t n, int32_t in, fp64_t scale, int32_t filter) {
+    memset(a, 0x00, sizeof(*a));
+    // footprint of the filter in source pixels grows when downscaling
+    const fp64_t fs = scale < 1.0 ? 1.0 / scale : 1.0;
+    const fp64_t support = ui_resample_support[filter] * fs;
+    int32_t taps = ((int32_t)ceil(support) * 2 + 1 + 1) & ~1; // even
+    taps = posix_min(taps, in);
+    a->n = n;
+    a->in = in;
+    a->taps = taps;
+    fp64_t* k = null;
+    int r = posix_heap.alloc((void**)&a->first, n * (int64_t)sizeof(int32_t));
+    if (r == 0) {
+        r = posix_heap.alloc_zero((void**)&a->w,
+                                  (int64_t)n * taps * (int64_t)sizeof(int16_t));
+    }
+    if (r == 0) {
+        r = posix_heap.alloc((void**)&k, taps * (int64_t)sizeof(fp64_t));
+    }
+    for (int32_t i = 0; i < n && r == 0; i++) {
+        const fp64_t center = (origin + i + 0.5) / scale;
+        int32_t x0 = posix_max(0, (int32_t)floor(center - support + 0.5));
+        int32_t x1 = posix_min(in, (int32_t)floor(center + support + 0.5));
+        fp64_t sum = 0;
+        for (int32_t x = x0; x < x1; x++) {
+            k[x - x0] = ui_resample_filter(filter, (x - center + 0.5) / fs);
+            sum += k[x - x0];
+        }
+        if (x1 <= x0 || sum == 0) { // outside of the source: edge pixel
+            x0 = center < in / 2.0 ? 0 : in - 1;
+            x1 = x0 + 1;
+            k[0] = 1.0;
+            sum = 1.0;
+        }
+        posix_assert(x1 - x0 <= taps);
+        const int32_t first = posix_min(x0, in - taps);
+        int16_t* w = a->w + (int64_t)i * taps;
+        int32_t total = 0;
+        int32_t max = x0 - first; // index of the largest weight
+        for (int32_t x = x0; x < x1; x++) {
+            const fp64_t v = k[x - x0] / sum * (1 << ui_resample_bits);
+            w[x - first] = (int16_t)floor(v + 0.5);
+            total += w[x - first];
+            if (w[x - first] > w[max]) { max = x - first; }
+        }
+        // exactly 1.0 so that uniform areas stay uniform:
+        w[max] = (int16_t)(w[max] + (1 << ui_resample_bits) - total);
+        a->first[i] = first;
+    }
+    if (k != null) { posix_heap.free(k); }
+    if (r != 0) { ui_resample_axis_dispose(a); }
+    return r;
+}
+
+// scalar reference kernels:
+
+static void ui_resample_h_scalar(uint8_t* d, const uint8_t* s,
+        const struct ui_resample_axis* a, int32_t bpp) {
+    const int32_t taps = a->taps;
+    for (int32_t i = 0; i < a->n; i++) {
+        const uint8_t* p = s + (int64_t)a->first[i] * bpp;
+        const int16_t* w = a->w + (int64_t)i * taps;
+        for (int32_t c = 0; c < bpp; c++) {
+            int32_t acc = 1 << (ui_resample_bits - 1);
+            for (int32_t k = 0; k < taps; k++) {
+                acc += w[k] * p[k * bpp + c];
+            }
+            d[c] = ui_resample_clamp(acc);
+        }
+        d += bpp;
+    }
+}
+
+static void ui_resample_v_span(uint8_t* d, const uint8_t** rows,
+        const int16_t* w, int32_t taps, int32_t x, int32_t bytes) {
+    for (; x < bytes; x++) {
+        int32_t acc = 1 << (ui_resample_bits - 1);
+        for (int32_t k = 0; k < taps; k++) {
+            acc += w[k] * rows[k][x];
+        }
+        d[x] = ui_resample_clamp(acc);
+    }
+}
+
+static void ui_resample_v_scalar(uint8_t* d, const uint8_t** rows,
+        const int16_t* w, int32_t taps, int32_t bytes) {
+    ui_resample_v_span(d, rows, w, taps, 0, bytes);
+}
+
+static const struct ui_resample_kernels ui_resample_scalar_kernels = {
+    .h = ui_resample_h_scalar,
+    .v = ui_resample_v_scalar
+};
+
+#ifdef ui_resample_has_sse2
+
+// BGR: 8 bytes load of 2 pixels must not read past the source row
+
+static inline bool ui_resample_overread(const struct ui_resample_axis* a,
+        int32_t i, int32_t bpp) {
+    return bpp == 3 && (a->first[i] + a->taps) * 3 + 2 > a->in * 3;
+}
+
+static void ui_resample_h_one(uint8_t* d, const uint8_t* s,
+        const struct ui_resample_axis* a, int32_t i, int32_t bpp) {
+    // scalar kernel for the output pixel i only
+    struct ui_resample_axis one = *a;
+    one.first += i;
+    one.w += (int64_t)i * a->taps;
+    one.n = 1;
+    ui_resample_h_scalar(d + (int64_t)i * bpp, s, &one, bpp);
+}
+
+static inline __m128i ui_resample_pair(const int16_t* w) {
+    int32_t pair; // w[0] in low 16 bits (little endian)
+    memcpy(&pair, w, sizeof(pair));
+    return _mm_set1_epi32(pair);
+}
+
+static inline __m128i ui_resample_shift(__m128i acc) {
+    return _mm_srai_epi32(acc, ui_resample_bits);
+}
+
+static void ui_resample_h1_sse2(uint8_t* d, const uint8_t* p,
+        const int16_t* w, int32_t taps, int32_t bpp) {
+    // each _mm_madd_epi16() applies a pair of taps to all channels
+    const __m128i zero = _mm_setzero_si128();
+    __m128i acc = _mm_set1_epi32(1 << (ui_resample_bits - 1));
+    int32_t k = 0;
+    if (bpp == 4) { // 4 pixels per load
+        __m128i odd = _mm_setzero_si128();
+        for (; k + 4 <= taps; k += 4) {
+            const __m128i px = _mm_loadu_si128((const __m128i*)(p + k * 4));
+            __m128i lo = _mm_unpacklo_epi8(px, zero);
+            __m128i hi = _mm_unpackhi_epi8(px, zero);
+            lo = _mm_unpacklo_epi16(lo, _mm_srli_si128(lo, 8));
+            hi = _mm_unpacklo_epi16(hi, _mm_srli_si128(hi, 8));
+            acc = _mm_add_epi32(acc,
+                    _mm_madd_epi16(lo, ui_resample_pair(w + k)));
+            odd = _mm_add_epi32(odd,
+                    _mm_madd_epi16(hi, ui_resample_pair(w + k + 2)));
+        }
+        acc = _mm_add_epi32(acc, odd);
+    }
+    for (; k < taps; k += 2) {
+        __m128i px = _mm_loadl_epi64((const __m128i*)(p + k * bpp));
+        px = _mm_unpacklo_epi8(px, zero);
+        // b0 g0 r0 [a0] b1 g1 r1 [a1] -> b0 b1 g0 g1 r0 r1 a0 a1
+        const __m128i p1 = bpp == 4 ?
+            _mm_srli_si128(px, 8) : _mm_srli_si128(px, 6);
+        px = _mm_unpacklo_epi16(px, p1);
+        acc = _mm_add_epi32(acc,
+                _mm_madd_epi16(px, ui_resample_pair(w + k)));
+    }
+    acc = ui_resample_shift(acc);
+    acc = _mm_packs_epi32(acc, acc);
+    const int32_t bgra = _mm_cvtsi128_si32(_mm_packus_epi16(acc, acc));
+    memcpy(d, &bgra, (size_t)bpp);
+}
+
+static void ui_resample_h_sse2(uint8_t* d, const uint8_t* s,
+        const struct ui_resample_axis* a, int32_t bpp) {
+    const int32_t taps = a->taps;
+    if (taps % 2 != 0 || bpp == 1) {
+        ui_resample_h_scalar(d, s, a, bpp);
+    } else {
+        for (int32_t i = 0; i < a->n; i++) {
+            if (ui_resample_overread(a, i, bpp)) {
+                ui_resample_h_one(d, s, a, i, bpp);
+            } else {
+                ui_resample_h1_sse2(d + (int64_t)i * bpp,
+                    s + (int64_t)a->first[i] * bpp,
+                    a->w + (int64_t)i * taps, taps, bpp);
+            }
+        }
+    }
+}
+
+static void ui_resample_v_sse2(uint8_t* d, const uint8_t** rows,
+        const int16_t* w, int32_t taps, int32_t bytes) {
+    // 16 bytes of a pair of rows interleaved -> 4 x 4 madd columns
+    int32_t x = 0;
+    if (taps % 2 == 0) {
+        const __m128i zero = _mm_setzero_si128();
+        const __m128i bias = _mm_set1_epi32(1 << (ui_resample_bits - 1));
+        for (; x + 16 <= bytes; x += 16) {
+            __m128i a0 = bias;
+            __m128i a1 = bias;
+            __m128i a2 = bias;
+            __m128i a3 = bias;
+            for (int32_t k = 0; k < taps; k += 2) {
+                const __m128i wk = ui_resample_pair(w + k);
+                const __m128i r0 = _mm_loadu_si128((const __m128i*)(rows[k] + x));
+                const __m128i r1 = _mm_loadu_si128((const __m128i*)(rows[k + 1] + x));
+                const __m128i lo = _mm_unpacklo_epi8(r0, r1);
+                const __m128i hi = _mm_unpackhi_epi8(r0, r1);
+                a0 = _mm_add_epi32(a0, _mm_madd_epi16(_mm_unpacklo_epi8(lo, zero), wk));
+                a1 = _mm_add_epi32(a1, _mm_madd_epi16(_mm_unpackhi_epi8(lo, zero), wk));
+                a2 = _mm_add_epi32(a2, _mm_madd_epi16(_mm_unpacklo_epi8(hi, zero), wk));
+                a3 = _mm_add_epi32(a3, _mm_madd_epi16(_mm_unpackhi_epi8(hi, zero), wk));
+            }
+            const __m128i l = _mm_packs_epi32(ui_resample_shift(a0), ui_resample_shift(a1));
+            const __m128i h = _mm_packs_epi32(ui_resample_shift(a2), ui_resample_shift(a3));
+            _mm_storeu_si128((__m128i*)(d + x), _mm_packus_epi16(l, h));
+        }
+    }
+    ui_resample_v_span(d, rows, w, taps, x, bytes); // tail
+}
+
+static const struct ui_resample_kernels ui_resample_sse2_kernels = {
+    .h = ui_resample_h_sse2,
+    .v = ui_resample_v_sse2
+};
+
+#endif // ui_resample_has_sse2
+
+#ifdef ui_resample_has_avx2
+
+// AVX2 unpack and madd work within 128 bit lanes: horizontal pass
+// computes two output pixels at a time (one per lane) with the same
+// math as SSE2, vertical pass 32 bytes of a row at a time.
+
+ui_resample_avx2_target
+static inline __m256i ui_resample_pairs_avx2(const int16_t* w0,
+        const int16_t* w1) {
+    int32_t p0;
+    int32_t p1;
+    memcpy(&p0, w0, sizeof(p0));
+    memcpy(&p1, w1, sizeof(p1));
+    return _mm256_setr_epi32(p0, p0, p0, p0, p1, p1, p1, p1);
+}
+
+ui_resample_avx2_target
+static inline __m256i ui_resample_load_avx2(const uint8_t* p0,
+        const uint8_t* p1) {
+    return _mm256_inserti128_si256(_mm256_castsi128_si256(
+        _mm_loadu_si128((const __m128i*)p0)),
+        _mm_loadu_si128((const __m128i*)p1), 1);
+}
+
+ui_resample_avx2_target
+static inline __m256i ui_resample_loadl_avx2(const uint8_t* p0,
+        const uint8_t* p1) {
+    return _mm256_inserti128_si256(_mm256_castsi128_si256(
+        _mm_loadl_epi64((const __m128i*)p0)),
+        _mm_loadl_epi64((const __m128i*)p1), 1);
+}
+
+ui_resample_avx2_target
+static inline __m256i ui_resample_shift_avx2(__m256i acc) {
+    return _mm256_srai_epi32(acc, ui_resample_bits);
+}
+
+ui_resample_avx2_target
+static void ui_resample_h2_avx2(uint8_t* d, const uint8_t* p0,
+        const uint8_t* p1, const int16_t* w0, const int16_t* w1,
+        int32_t taps, int32_t bpp) {
+    // output pixels d[0] from p0, w0 and d[1] from p1, w1
+    const __m256i zero = _mm256_setzero_si256();
+    __m256i acc = _mm256_set1_epi32(1 << (ui_resample_bits - 1));
+    int32_t k = 0;
+    if (bpp == 4) { // 4 pixels per lane load
+        __m256i odd = _mm256_setzero_si256();
+        for (; k + 4 <= taps; k += 4) {
+            const __m256i px = ui_resample_load_avx2(p0 + k * 4, p1 + k * 4);
+            __m256i lo = _mm256_unpacklo_epi8(px, zero);
+            __m256i hi = _mm256_unpackhi_epi8(px, zero);
+            lo = _mm256_unpacklo_epi16(lo, _mm256_srli_si256(lo, 8));
+            hi = _mm256_unpacklo_epi16(hi, _mm256_srli_si256(hi, 8));
+            acc = _mm256_add_epi32(acc, _mm256_madd_epi16(lo,
+                    ui_resample_pairs_avx2(w0 + k, w1 + k)));
+            odd = _mm256_add_epi32(odd, _mm256_madd_epi16(hi,
+                    ui_resample_pairs_avx2(w0 + k + 2, w1 + k + 2)));
+        }
+        acc = _mm256_add_epi32(acc, odd);
+    }
+    for (; k < taps; k += 2) {
+        __m256i px = ui_resample_loadl_avx2(p0 + k * bpp, p1 + k * bpp);
+        px = _mm256_unpacklo_epi8(px, zero);
+        const __m256i q = bpp == 4 ?
+            _mm256_srli_si256(px, 8) : _mm256_srli_si256(px, 6);
+        px = _mm256_unpacklo_epi16(px, q);
+        acc = _mm256_add_epi32(acc, _mm256_madd_epi16(px,
+                ui_resample_pairs_avx2(w0 + k, w1 + k)));
+    }
+    acc = ui_resample_shift_avx2(acc);
+    acc = _mm256_packs_epi32(acc, acc);
+    acc = _mm256_packus_epi16(acc, acc);
+    const int32_t c0 = _mm_cvtsi128_si32(_mm256_castsi256_si128(acc));
+    const int32_t c1 = _mm_cvtsi128_si32(_mm256_extracti128_si256(acc, 1));
+    memcpy(d, &c0, (size_t)bpp);
+    memcpy(d + bpp, &c1, (size_t)bpp);
+}
+
+ui_resample_avx2_target
+static void ui_resample_h_avx2(uint8_t* d, const uint8_t* s,
+        const struct ui_resample_axis* a, int32_t bpp) {
+    const int32_t taps = a->taps;
+    if (taps % 2 != 0 || bpp == 1) {
+        ui_resample_h_scalar(d, s, a, bpp);
+    } else {
+        int32_t i = 0;
+        // first[] is non-decreasing: if i + 1 does not overread i does not
+        while (i + 1 < a->n && !ui_resample_overread(a, i + 1, bpp)) {
+            ui_resample_h2_avx2(d + (int64_t)i * bpp,
+                s + (int64_t)a->first[i] * bpp,
+                s + (int64_t)a->first[i + 1] * bpp,
+                a->w + (int64_t)i * taps, a->w + (int64_t)(i + 1) * taps,
+                taps, bpp);
+            i += 2;
+        }
+        for (; i < a->n; i++) {
+            if (ui_resample_overread(a, i, bpp)) {
+                ui_resample_h_one(d, s, a, i, bpp);
+            } else {
+                ui_resample_h1_sse2(d + (int64_t)i * bpp,
+                    s + (int64_t)a->first[i] * bpp,
+                    a->w + (int64_t)i * taps, taps, bpp);
+            }
+        }
+    }
+}
+
+ui_resample_avx2_target
+static void ui_resample_v_avx2(uint8_t* d, const uint8_t** rows,
+        const int16_t* w, int32_t taps, int32_t bytes) {
+    // as SSE2 per 128 bit lane: packs and packus restore byte order
+    int32_t x = 0;
+    if (taps % 2 == 0) {
+        const __m256i zero = _mm256_setzero_si256();
+        const __m256i bias = _mm256_set1_epi32(1 << (ui_resample_bits - 1));
+        for (; x + 32 <= bytes; x += 32) {
+            __m256i a0 = bias;
+            __m256i a1 = bias;
+            __m256i a2 = bias;
+            __m256i a3 = bias;
+            for (int32_t k = 0; k < taps; k += 2) {
+                const __m256i wk = ui_resample_pairs_avx2(w + k, w + k);
+                const __m256i r0 = _mm256_loadu_si256((const __m256i*)(rows[k] + x));
+                const __m256i r1 = _mm256_loadu_si256((const __m256i*)(rows[k + 1] + x));
+                const __m256i lo = _mm256_unpacklo_epi8(r0, r1);
+                const __m256i hi = _mm256_unpackhi_epi8(r0, r1);
+                a0 = _mm256_add_epi32(a0, _mm256_madd_epi16(_mm256_unpacklo_epi8(lo, zero), wk));
+                a1 = _mm256_add_epi32(a1, _mm256_madd_epi16(_mm256_unpackhi_epi8(lo, zero), wk));
+                a2 = _mm256_add_epi32(a2, _mm256_madd_epi16(_mm256_unpacklo_epi8(hi, zero), wk));
+                a3 = _mm256_add_epi32(a3, _mm256_madd_epi16(_mm256_unpackhi_epi8(hi, zero), wk));
+            }
+            const __m256i l = _mm256_packs_epi32(ui_resample_shift_avx2(a0),
+                                                 ui_resample_shift_avx2(a1));
+            const __m256i h = _mm256_packs_epi32(ui_resample_shift_avx2(a2),
+                                                 ui_resample_shift_avx2(a3));
+            _mm256_storeu_si256((__m256i*)(d + x), _mm256_packus_epi16(l, h));
+        }
+    }
+    ui_resample_v_span(d, rows, w, taps, x, bytes); // tail
+}
+
+static const struct ui_resample_kernels ui_resample_avx2_kernels = {
+    .h = ui_resample_h_avx2,
+    .v = ui_resample_v_avx2
+};
+
+#endif // ui_resample_has_avx2
+
+static const struct ui_resample_kernels* ui_resample_k; // selected kernels
+static int32_t ui_resample_selected;
+
+static const struct ui_resample_kernels* ui_resample_of(int32_t isa) {
+    const struct ui_resample_kernels* k = null;
+    if (ui_pixels.supported(isa)) {
+        switch (isa) {
+            case ui_pixels_scalar: k = &ui_resample_scalar_kernels; break;
+            #if defined(ui_resample_has_sse2)
+            case ui_pixels_sse2: k = &ui_resample_sse2_kernels; break;
+            #endif
+            #if defined(ui_resample_has_avx2)
+            case ui_pixels_avx2: k = &ui_resample_avx2_kernels; break;
+            #endif
+            default: break;
+        }
+    }
+    return k;
+}
+
+static bool ui_resample_use(int32_t isa) {
+    const struct ui_resample_kernels* k = ui_resample_of(isa);
+    if (k != null) {
+        ui_resample_selected = isa;
+        ui_resample_k = k;
+    }
+    return k != null;
+}
+
+static const struct ui_resample_kernels* ui_resample_kernels(void) {
+    if (ui_resample_k == null) {
+        // best available, races are benign: same result on all threads
+        const int32_t isa[] = { ui_pixels_avx2, ui_pixels_sse2 };
+        bool found = false;
+        for (int32_t i = 0; i < posix_countof(isa) && !found; i++) {
+            found = ui_resample_use(isa[i]);
+        }
+        if (!found) { ui_resample_use(ui_pixels_scalar); }
+    }
+    return ui_resample_k;
+}
+
+static int32_t ui_resample_isa(void) {
+    (void)ui_resample_kernels();
+    return ui_resample_selected;
+}
+
+static void ui_resample_task(void* that, int32_t t) {
+    // Destination rows [j0..j1) of the band. Source rows are filtered
+    // horizontally once into ring slot (row % taps) when they first
+    // enter the vertical window. Window start is non-decreasing in j
+    // thus a ring of `taps` rows holds the whole window.
+    struct ui_resample_job* job = (struct ui_resample_job*)that;
+    const struct ui_bitmap* s = job->s;
+    struct ui_bitmap* d = job->d;
+    const int32_t j0 = t * job->band;
+    const int32_t j1 = posix_min(d->h, j0 + job->band);
+    const int32_t taps = job->v.taps;
+    const int64_t bytes = (int64_t)d->w * d->bpp;
+    uint8_t* ring = null;
+    const uint8_t** rows = null;
+    posix_fatal_if(posix_heap.alloc((void**)&ring, bytes * taps) != 0);
+    posix_fatal_if(posix_heap.alloc((void**)&rows,
+                   taps * (int64_t)sizeof(uint8_t*)) != 0);
+    int32_t next = -1; // next source row to filter horizontally
+    for (int32_t j = j0; j < j1; j++) {
+        const int32_t first = job->v.first[j];
+        for (int32_t r = posix_max(next, first); r < first + taps; r++) {
+            const uint8_t* src = (const uint8_t*)s->pixels + (int64_t)r * s->stride;
+            job->k->h(ring + (r % taps) * bytes, src, &job->h, s->bpp);
+        }
+        next = first + taps;
+        for (int32_t k = 0; k < taps; k++) {
+            rows[k] = ring + ((first + k) % taps) * bytes;
+        }
+        uint8_t* dst = (uint8_t*)d->pixels + (int64_t)j * d->stride;
+        job->k->v(dst, rows, job->v.w + (int64_t)j * taps, taps, (int32_t)bytes);
+    }
+    posix_heap.free(rows);
+    posix_heap.free(ring);
+}
+
+static void ui_resample_scale(struct ui_bitmap* d, const struct ui_bitmap* s,
+        int32_t x, int32_t y, fp64_t scale, int32_t filter) {
+    posix_swear(d->bpp == s->bpp && (s->bpp == 1 || s->bpp == 3 || s->bpp == 4),
+                "bpp: %d %d", d->bpp, s->bpp);
+    posix_swear(ui_resample_box <= filter && filter <= ui_resample_lanczos3);
+    posix_swear(scale > 0 && s->w > 0 && s->h > 0);
+    if (d->w > 0 && d->h > 0) {
+        struct ui_resample_job job = { .d = d, .s = s };
+        int r = ui_resample_axis_init(&job.h, x, d->w, s->w, scale, filter);
+        if (r == 0) {
+            r = ui_resample_axis_init(&job.v, y, d->h, s->h, scale, filter);
+        }
+        posix_fatal_if(r != 0, "%s", posix_strerr(r));
+        job.k = ui_resample_kernels();
+        // few bands per thread balance uneven progress of threads
+        // while keeping ring refill at band boundaries cheap
+        const int32_t bands = posix_min(d->h, ui_parallel.threads() * 4);
+        job.band = (d->h + bands - 1) / bands;
+        ui_parallel.for_each((d->h + job.band - 1) / job.band,
+                             ui_resample_task, &job);
+        ui_resample_axis_dispose(&job.h);
+        ui_resample_axis_dispose(&job.v);
+    }
+}
+
+static const char* ui_resample_name(int32_t filter) {
+    switch (filter) {
+        case ui_resample_box     : return "box";
+        case ui_resample_bilinear: return "bilinear";
+        case ui_resample_lanczos3: return "lanczos3";
+        default: posix_swear(false, "filter: %d", filter); return "?";
+    }
+}
+
+static void ui_resample_test_bitmap(struct ui_bitmap* b, int32_t w, int32_t h,
+        int32_t bpp) {
+    b->w = w;
+    b->h = h;
+    b->bpp = bpp;
+    b->stride = (w * bpp + 3) & ~3;
+    posix_fatal_if(posix_heap.alloc_zero(&b->pixels, (int64_t)b->stride * h) != 0);
+}
+
+static void ui_resample_test_random(struct ui_bitmap* b, uint32_t* seed) {
+    uint8_t* p = (uint8_t*)b->pixels;
+    for (int64_t i = 0; i < (int64_t)b->stride * b->h; i++) {
+        p[i] = (uint8_t)posix_num.random32(seed);
+    }
+}
+
+static bool ui_resample_test_equal(const struct ui_bitmap* a,
+        const struct ui_bitmap* b) {
+    bool equal = true;
+    for (int32_t y = 0; y < a->h && equal; y++) {
+        equal = memcmp((const uint8_t*)a->pixels + (int64_t)y * a->stride,
+                       (const uint8_t*)b->pixels + (int64_t)y * b->stride,
+                       (size_t)(a->w * a->bpp)) == 0;
+    }
+    return equal;
+}
+
+static void ui_resample_test_simd(int32_t isa, uint32_t* seed) {
+    // SIMD and multithreaded results are identical to scalar single
+    // threaded ones including tiny images where taps > image size
+    static const fp64_t scales[] = { 0.13, 0.37, 0.5, 1.0, 1.7, 3.0 };
+    static const int32_t sizes[][2] = { {1, 1}, {3, 2}, {5, 7}, {67, 41} };
+    for (int32_t bpp = 1; bpp <= 4; bpp++) {
+        if (bpp == 2) { continue; }
+        for (int32_t z = 0; z < posix_countof(sizes); z++) {
+            struct ui_bitmap s = {0};
+            ui_resample_test_bitmap(&s, sizes[z][0], sizes[z][1], bpp);
+            ui_resample_test_random(&s, seed);
+            for (int32_t k = 0; k < posix_countof(scales); k++) {
+                for (int32_t f = ui_resample_box; f <= ui_resample_lanczos3; f++) {
+                    const int32_t w = (int32_t)(s.w * scales[k]) + 3;
+                    const int32_t h = (int32_t)(s.h * scales[k]) + 2;
+                    const int32_t x = (int32_t)(posix_num.random32(seed) % 5) - 2;
+                    const int32_t y = (int32_t)(posix_num.random32(seed) % 5) - 2;
+                    struct ui_bitmap e = {0};
+                    struct ui_bitmap d = {0};
+                    ui_resample_test_bitmap(&e, w, h, bpp);
+                    ui_resample_test_bitmap(&d, w, h, bpp);
+                    posix_swear(ui_resample.use(ui_pixels_scalar));
+                    ui_parallel.limit(1);
+                    ui_resample.scale(&e, &s, x, y, scales[k], f);
+                    ui_parallel.limit(0);
+                    posix_swear(ui_resample.use(isa));
+                    ui_resample.scale(&d, &s, x, y, scales[k], f);
+                    posix_swear(ui_resample_test_equal(&e, &d),
+                        "%dx%dx%d scale: %.2f %s %s", s.w, s.h, bpp, scales[k],
+                        ui_resample.name(f), ui_pixels.name(isa));
+                    posix_heap.free(d.pixels);
+                    posix_heap.free(e.pixels);
+                }
+            }
+            posix_heap.free(s.pixels);
+        }
+    }
+}
+
+static void ui_resample_test(void) {
+    uint32_t seed = 1;
+    struct ui_bitmap s = {0};
+    struct ui_bitmap d = {0};
+    ui_resample_test_bitmap(&s, 64, 48, 4);
+    ui_resample_test_random(&s, &seed);
+    // box filter at 1:1 is identity
+    ui_resample_test_bitmap(&d, 64, 48, 4);
+    ui_resample.scale(&d, &s, 0, 0, 1.0, ui_resample_box);
+    posix_swear(ui_resample_test_equal(&s, &d));
+    // and part of the image at 1:1
+    struct ui_bitmap p = {0};
+    ui_resample_test_bitmap(&p, 16, 8, 4);
+    ui_resample.scale(&p, &s, 5, 7, 1.0, ui_resample_box);
+    for (int32_t y = 0; y < p.h; y++) {
+        posix_swear(memcmp((uint8_t*)p.pixels + y * p.stride,
+            (uint8_t*)s.pixels + (y + 7) * s.stride + 5 * 4, 16 * 4) == 0);
+    }
+    posix_heap.free(p.pixels);
+    posix_heap.free(d.pixels);
+    // box filter at 1:2 is average of 2x2 (rounded per pass)
+    ui_resample_test_bitmap(&d, 32, 24, 4);
+    ui_resample.scale(&d, &s, 0, 0, 0.5, ui_resample_box);
+    for (int32_t y = 0; y < d.h; y++) {
+        for (int32_t x = 0; x < d.w; x++) {
+            for (int32_t c = 0; c < 4; c++) {
+                const uint8_t* s0 = (uint8_t*)s.pixels + (y * 2) * s.stride;
+                const uint8_t* s1 = s0 + s.stride;
+                const int32_t i = x * 8 + c;
+                const int32_t a = (s0[i] + s0[i + 4] + 1) / 2;
+                const int32_t b = (s1[i] + s1[i + 4] + 1) / 2;
+                const uint8_t e = (uint8_t)((a + b + 1) / 2);
+                posix_swear(((uint8_t*)d.pixels)[y * d.stride + x * 4 + c] == e);
+            }
+        }
+    }
+    posix_heap.free(d.pixels);
+    // uniform image stays uniform at any scale with any filter
+    memset(s.pixels, 0xA5, (size_t)(s.stride * s.h));
+    for (int32_t f = ui_resample_box; f <= ui_resample_lanczos3; f++) {
+        for (fp64_t scale = 0.1; scale < 4.0; scale *= 1.37) {
+            ui_resample_test_bitmap(&d, (int32_t)(s.w * scale) + 1,
+                                        (int32_t)(s.h * scale) + 1, 4);
+            ui_resample.scale(&d, &s, 0, 0, scale, f);
+            for (int32_t y = 0; y < d.h; y++) {
+                for (int32_t x = 0; x < d.w * 4; x++) {
+                    posix_swear(((uint8_t*)d.pixels)[y * d.stride + x] == 0xA5);
+                }
+            }
+            posix_heap.free(d.pixels);
+        }
+    }
+    posix_heap.free(s.pixels);
+    const int32_t saved = ui_resample.isa();
+    for (int32_t isa = ui_pixels_scalar; isa <= ui_pixels_neon; isa++) {
+        if (ui_resample_of(isa) != null) { ui_resample_test_simd(isa, &seed); }
+    }
+    posix_swear(ui_resample.use(saved));
+    if (posix_debug.verbosity.level > posix_debug.verbosity.quiet) {
+        posix_println("done %s", ui_pixels.name(ui_resample.isa()));
+    }
+}
+
+struct ui_resample_if ui_resample = {
+    .scale = ui_resample_scale,
+    .name  = ui_resample_name,
+    .isa   = ui_resample_isa,
+    .use   = ui_resample_use,
+    .test  = ui_resample_test
+};
+
+#ifdef UI_RESAMPLE_TEST
+    posix_static_init(ui_resample) { ui_resample.test(); }
+#endif
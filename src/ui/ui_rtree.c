@@ -0,0 +1,392 @@
+/* Copyright (c) Dmitry "Leo" Kuznetsov 2021-24 see LICENSE for details */
+#include "posix/posix.h"
+#include "ui/ui_core.h"
+#include "ui/ui_colors.h"
+#include "ui/ui_draw.h"
+#include "ui/ui_view.h"
+#include "ui/ui_rtree.h"
+
+#undef UI_RTREE_TEST
+
+#if 0 // flip to 1 to run tests
+
+#define UI_RTREE_TEST
+
+#endif
+
+enum { ui_rtree_leaf = 4 }; // max items in leaf node
+
+static void ui_rtree_reserve(struct ui_rtree* t, int32_t n) {
+    if (n > t->capacity) {
+        const int32_t c = n > t->capacity * 2 ?
+            (n > 16 ? n : 16) : t->capacity * 2;
+        const size_t views = (size_t)c * sizeof(t->views[0]);
+        posix_swear(posix_heap.realloc((void**)&t->items,
+                    (size_t)c * sizeof(t->items[0])) == 0);
+        posix_swear(posix_heap.realloc((void**)&t->nodes,
+                    (size_t)c * 2 * sizeof(t->nodes[0])) == 0);
+        posix_swear(posix_heap.realloc((void**)&t->views,     views) == 0);
+        posix_swear(posix_heap.realloc((void**)&t->next,      views) == 0);
+        posix_swear(posix_heap.realloc((void**)&t->listeners, views) == 0);
+        posix_swear(posix_heap.realloc((void**)&t->hovered,   views) == 0);
+        t->capacity = c;
+    }
+}
+
+static void ui_rtree_collect(struct ui_rtree* t, struct ui_view* v,
+        bool hidden, int32_t* n) {
+    // hover is collected even for hidden views because
+    // ui_view.mouse_move() has to turn it off
+    hidden = hidden || v->state.hidden;
+    ui_rtree_reserve(t, *n + t->hovering + 1);
+    if (v->state.hover) { t->hovered[t->hovering++] = v; }
+    if (!hidden) {
+        t->next[(*n)++] = v;
+        if (v->mouse_move != null || v->mouse_hover != null) {
+            t->listeners[t->listening++] = v;
+        }
+    }
+    ui_view_for_each(v, c, { ui_rtree_collect(t, c, hidden, n); });
+}
+
+static struct ui_ltrb ui_rtree_rect(const struct ui_view* v) {
+    return (struct ui_ltrb){ v->x, v->y, v->x + v->w, v->y + v->h };
+}
+
+static void ui_rtree_union(struct ui_ltrb* b, const struct ui_ltrb* r) {
+    b->left   = posix_min(b->left,   r->left);
+    b->top    = posix_min(b->top,    r->top);
+    b->right  = posix_max(b->right,  r->right);
+    b->bottom = posix_max(b->bottom, r->bottom);
+}
+
+static bool ui_rtree_contains(const struct ui_ltrb* r, struct ui_point pt) {
+    return r->left <= pt.x && pt.x < r->right &&
+           r->top  <= pt.y && pt.y < r->bottom;
+}
+
+static int64_t ui_rtree_center(const struct ui_rtree_item* it, bool vertical) {
+    // doubled center avoids rounding
+    return vertical ? (int64_t)it->r.top  + it->r.bottom :
+                      (int64_t)it->r.left + it->r.right;
+}
+
+static void ui_rtree_select(struct ui_rtree_item* a, int32_t n, int32_t k,
+        bool vertical) {
+    // partial quick select: a[0..k) <= a[k] <= a[k + 1..n) by center
+    int32_t lo = 0;
+    int32_t hi = n - 1;
+    while (lo < hi) {
+        const int64_t pivot = ui_rtree_center(&a[lo + (hi - lo) / 2], vertical);
+        int32_t i = lo;
+        int32_t j = hi;
+        while (i <= j) {
+            while (ui_rtree_center(&a[i], vertical) < pivot) { i++; }
+            while (ui_rtree_center(&a[j], vertical) > pivot) { j--; }
+            if (i <= j) {
+                const struct ui_rtree_item swap = a[i];
+                a[i] = a[j];
+                a[j] = swap;
+                i++;
+                j--;
+            }
+        }
+        if (k <= j) {
+            hi = j;
+        } else if (k >= i) {
+            lo = i;
+        } else {
+            break;
+        }
+    }
+}
+
+static int32_t ui_rtree_build(struct ui_rtree* t, int32_t first, int32_t count) {
+    const int32_t ix = t->count++;
+    struct ui_rtree_node* n = &t->nodes[ix];
+    n->box = t->items[first].r;
+    struct ui_ltrb c = { // bounds of centers
+        .left  = (int32_t)(ui_rtree_center(&t->items[first], false) / 2),
+        .top   = (int32_t)(ui_rtree_center(&t->items[first], true)  / 2)
+    };
+    c.right = c.left;
+    c.bottom = c.top;
+    for (int32_t i = first + 1; i < first + count; i++) {
+        ui_rtree_union(&n->box, &t->items[i].r);
+        const int32_t x = (int32_t)(ui_rtree_center(&t->items[i], false) / 2);
+        const int32_t y = (int32_t)(ui_rtree_center(&t->items[i], true)  / 2);
+        ui_rtree_union(&c, &(struct ui_ltrb){ x, y, x, y });
+    }
+    if (count <= ui_rtree_leaf) {
+        n->first = first;
+        n->count = count;
+    } else {
+        // split at the median of the longer extent of centers
+        const bool vertical = c.bottom - c.top > c.right - c.left;
+        const int32_t half = count / 2;
+        ui_rtree_select(&t->items[first], count, half, vertical);
+        (void)ui_rtree_build(t, first, half); // left child is ix + 1
+        const int32_t right = ui_rtree_build(t, first + half, count - half);
+        n = &t->nodes[ix];
+        n->first = right;
+        n->count = 0;
+    }
+    return ix;
+}
+
+static void ui_rtree_refit(struct ui_rtree* t) {
+    for (int32_t i = 0; i < t->n; i++) {
+        t->items[i].r = ui_rtree_rect(t->items[i].v);
+    }
+    // children always follow their parents in nodes[]
+    for (int32_t ix = t->count - 1; ix >= 0; ix--) {
+        struct ui_rtree_node* n = &t->nodes[ix];
+        if (n->count > 0) {
+            n->box = t->items[n->first].r;
+            for (int32_t i = n->first + 1; i < n->first + n->count; i++) {
+                ui_rtree_union(&n->box, &t->items[i].r);
+            }
+        } else {
+            n->box = t->nodes[ix + 1].box;
+            ui_rtree_union(&n->box, &t->nodes[n->first].box);
+        }
+    }
+    t->stats.refits++;
+}
+
+static void ui_rtree_update(struct ui_rtree* t, const struct ui_view* root) {
+    int32_t n = 0;
+    t->listening = 0;
+    t->hovering = 0;
+    ui_rtree_collect(t, (struct ui_view*)root, false, &n);
+    const bool same = t->root == root && t->n == n &&
+        memcmp(t->views, t->next, (size_t)n * sizeof(t->views[0])) == 0;
+    struct ui_view** swap = t->views;
+    t->views = t->next;
+    t->next = swap;
+    t->root = root;
+    t->n = n;
+    if (same) {
+        ui_rtree_refit(t);
+    } else {
+        for (int32_t i = 0; i < n; i++) {
+            t->items[i] = (struct ui_rtree_item){
+                .r = ui_rtree_rect(t->views[i]), .v = t->views[i], .order = i
+            };
+        }
+        t->count = 0;
+        if (n > 0) { (void)ui_rtree_build(t, 0, n); }
+        t->stats.builds++;
+    }
+}
+
+static int32_t ui_rtree_query(const struct ui_rtree* t, struct ui_point pt,
+        const struct ui_rtree_item* found[], int32_t count) {
+    int32_t k = 0; // number of items found
+    int32_t stack[64]; // depth of the tree is log2(n) + 1
+    int32_t top = 0;
+    if (t->count > 0) { stack[top++] = 0; }
+    while (top > 0) {
+        const int32_t ix = stack[--top];
+        const struct ui_rtree_node* n = &t->nodes[ix];
+        if (!ui_rtree_contains(&n->box, pt)) {
+            // skip subtree
+        } else if (n->count == 0) {
+            posix_assert(top + 2 <= posix_countof(stack));
+            stack[top++] = n->first;
+            stack[top++] = ix + 1;
+        } else {
+            for (int32_t i = n->first; i < n->first + n->count; i++) {
+                const struct ui_rtree_item* it = &t->items[i];
+                if (ui_rtree_contains(&it->r, pt)) {
+                    // insertion sort in pre-order keeping first `count`
+                    int32_t j = posix_min(k, count);
+                    if (j < count || (count > 0 && it->order < found[j - 1]->order)) {
+                        if (j == count) { j--; } // drops the last one
+                        while (j > 0 && found[j - 1]->order > it->order) {
+                            found[j] = found[j - 1];
+                            j--;
+                        }
+                        found[j] = it;
+                    }
+                    k++;
+                }
+            }
+        }
+    }
+    return k;
+}
+
+static bool ui_rtree_inside(const struct ui_view* v, struct ui_point pt) {
+    const int32_t x = pt.x - v->x;
+    const int32_t y = pt.y - v->y;
+    return 0 <= x && x < v->w && 0 <= y && y < v->h;
+}
+
+static int64_t ui_rtree_hit_test(const struct ui_rtree* t,
+        const struct ui_view* v, struct ui_point pt) {
+    int64_t ht = 0;
+    const struct ui_rtree_item* stack[64];
+    const struct ui_rtree_item** found = stack;
+    int32_t k = ui_rtree_query(t, pt, found, posix_countof(stack));
+    if (k > posix_countof(stack)) { // very deep trees
+        posix_swear(posix_heap.alloc((void**)&found,
+                    (size_t)k * sizeof(found[0])) == 0);
+        k = ui_rtree_query(t, pt, found, k);
+    }
+    for (int32_t i = 0; i < k && ht == 0; i++) {
+        const struct ui_view* u = found[i]->v;
+        if (u != v && u->hit_test != null) {
+            // recursive hit test reaches `u` only if all views on
+            // the path from `v` to `u` are visible and contain pt
+            const struct ui_view* p = u;
+            while (p != null && p != v && !p->state.hidden &&
+                   ui_rtree_inside(p, pt)) {
+                p = p->parent;
+            }
+            if (p == v) { ht = u->hit_test(u, pt); }
+        }
+    }
+    if (found != stack) { posix_heap.free(found); }
+    return ht;
+}
+
+static void ui_rtree_dispose(struct ui_rtree* t) {
+    posix_heap.free(t->items);
+    posix_heap.free(t->nodes);
+    posix_heap.free(t->views);
+    posix_heap.free(t->next);
+    posix_heap.free(t->listeners);
+    posix_heap.free(t->hovered);
+    memset(t, 0x00, sizeof(*t));
+}
+
+enum { ui_rtree_test_views = 2000 };
+
+static struct ui_view ui_rtree_test_view[ui_rtree_test_views];
+
+static int64_t ui_rtree_test_hit(const struct ui_view* v, struct ui_point pt) {
+    // claims left half of the view only
+    const int64_t ix = v - ui_rtree_test_view;
+    return pt.x < v->x + v->w / 2 ? ix + 1 : 0;
+}
+
+static int64_t ui_rtree_test_recursive(const struct ui_view* v,
+        struct ui_point pt) {
+    // reference: ui_view.hit_test() for descendants of `v`
+    int64_t ht = 0;
+    ui_view_for_each(v, c, {
+        if (!c->state.hidden && ui_rtree_inside(c, pt)) {
+            if (c->hit_test != null) { ht = c->hit_test(c, pt); }
+            if (ht == 0) { ht = ui_rtree_test_recursive(c, pt); }
+            if (ht != 0) { break; }
+        }
+    });
+    return ht;
+}
+
+static void ui_rtree_test_walk(struct ui_view* v, struct ui_point pt,
+        struct ui_view* found[], int32_t* k) {
+    if (!v->state.hidden) {
+        if (ui_rtree_inside(v, pt)) { found[(*k)++] = v; }
+        ui_view_for_each(v, c, { ui_rtree_test_walk(c, pt, found, k); });
+    }
+}
+
+static void ui_rtree_test_link(struct ui_view* p, struct ui_view* c) {
+    c->parent = p;
+    if (p->child == null) {
+        c->prev = c;
+        c->next = c;
+        p->child = c;
+    } else {
+        c->prev = p->child->prev;
+        c->next = p->child;
+        c->prev->next = c;
+        c->next->prev = c;
+    }
+}
+
+static void ui_rtree_test_verify(struct ui_rtree* t, uint32_t* seed) {
+    static struct ui_view* expected[ui_rtree_test_views];
+    static const struct ui_rtree_item* found[ui_rtree_test_views];
+    struct ui_view* root = &ui_rtree_test_view[0];
+    for (int32_t i = 0; i < 1000; i++) {
+        const struct ui_point pt = {
+            (int32_t)(posix_num.random32(seed) % 1200) - 100,
+            (int32_t)(posix_num.random32(seed) % 1200) - 100
+        };
+        int32_t n = 0;
+        ui_rtree_test_walk(root, pt, expected, &n);
+        const int32_t k = ui_rtree.query(t, pt, found, posix_countof(found));
+        posix_swear(k == n, "k: %d n: %d", k, n);
+        for (int32_t j = 0; j < k; j++) { posix_swear(found[j]->v == expected[j]); }
+        // truncated query returns first views in pre-order
+        const int32_t m = ui_rtree.query(t, pt, found, 2);
+        posix_swear(m == n);
+        for (int32_t j = 0; j < posix_min(m, 2); j++) {
+            posix_swear(found[j]->v == expected[j]);
+        }
+        posix_swear(ui_rtree.hit_test(t, root, pt) ==
+                    ui_rtree_test_recursive(root, pt));
+    }
+}
+
+static void ui_rtree_test(void) {
+    uint32_t seed = 1;
+    struct ui_view* v = ui_rtree_test_view;
+    memset(v, 0x00, sizeof(ui_rtree_test_view));
+    v[0].w = 1000;
+    v[0].h = 1000;
+    for (int32_t i = 1; i < ui_rtree_test_views; i++) {
+        // parents are earlier views: random depth and fan out
+        const int32_t p = (int32_t)(posix_num.random32(&seed) % (uint32_t)i);
+        ui_rtree_test_link(&v[p], &v[i]);
+        v[i].x = (int32_t)(posix_num.random32(&seed) % 1000);
+        v[i].y = (int32_t)(posix_num.random32(&seed) % 1000);
+        v[i].w = (int32_t)(posix_num.random32(&seed) % 300);
+        v[i].h = (int32_t)(posix_num.random32(&seed) % 300);
+        v[i].state.hidden = posix_num.random32(&seed) % 20 == 0;
+        if (posix_num.random32(&seed) % 8 == 0) {
+            v[i].hit_test = ui_rtree_test_hit;
+        }
+    }
+    struct ui_rtree t = {0};
+    ui_rtree.update(&t, &v[0]);
+    posix_swear(t.stats.builds == 1 && t.stats.refits == 0);
+    ui_rtree_test_verify(&t, &seed);
+    // moved views: refit
+    for (int32_t i = 1; i < ui_rtree_test_views; i++) {
+        v[i].x += (int32_t)(posix_num.random32(&seed) % 64) - 32;
+        v[i].h += (int32_t)(posix_num.random32(&seed) % 32);
+    }
+    ui_rtree.update(&t, &v[0]);
+    posix_swear(t.stats.builds == 1 && t.stats.refits == 1);
+    ui_rtree_test_verify(&t, &seed);
+    // hidden views changed: rebuild
+    for (int32_t i = 1; i < ui_rtree_test_views; i += 7) {
+        v[i].state.hidden = !v[i].state.hidden;
+    }
+    ui_rtree.update(&t, &v[0]);
+    posix_swear(t.stats.builds == 2 && t.stats.refits == 1);
+    ui_rtree_test_verify(&t, &seed);
+    // hidden view with hover is collected to be turned off
+    v[1].state.hidden = true;
+    v[1].state.hover = true;
+    ui_rtree.update(&t, &v[0]);
+    posix_swear(t.hovering == 1 && t.hovered[0] == &v[1]);
+    ui_rtree.dispose(&t);
+    if (posix_debug.verbosity.level > posix_debug.verbosity.quiet) { posix_println("done"); }
+}
+
+struct ui_rtree_if ui_rtree = {
+    .update   = ui_rtree_update,
+    .query    = ui_rtree_query,
+    .hit_test = ui_rtree_hit_test,
+    .dispose  = ui_rtree_dispose,
+    .test     = ui_rtree_test
+};
+
+#ifdef UI_RTREE_TEST
+    posix_static_init(ui_rtree) { ui_rtree.test(); }
+#endif
@@ -1,6 +1,12 @@
 #include "posix/posix.h"
 #include "ui/ui.h"
 
+#undef UI_VIEW_TEST
+
+#if 0 // flip to 1 to run tests
+#define UI_VIEW_TEST
+#endif
+
 static const fp64_t ui_view_hover_delay = 1.5; // seconds
 
 #pragma push_macro("ui_view_for_each")
@@ -43,7 +49,7 @@ static struct ui_view* ui_view_add(struct ui_view* p, ...) {
     }
     va_end(va);
     ui_view_call_init(p);
-    ui_app.request_layout();
+    ui_app.request_relayout(p);
     return p;
 }
 
@@ -60,8 +66,9 @@ static void ui_view_add_first(struct ui_view* p, struct ui_view* c) {
         c->next->prev = c;
     }
     p->child = c;
+    ui_nodes.changed(ui_layout.nodes);
     ui_view_call_init(c);
-    ui_app.request_layout();
+    ui_app.request_relayout(p);
 }
 
 static void ui_view_add_last(struct ui_view* p, struct ui_view* c) {
@@ -77,9 +84,10 @@ static void ui_view_add_last(struct ui_view* p, struct ui_view* c) {
         c->prev->next = c;
         c->next->prev = c;
     }
+    ui_nodes.changed(ui_layout.nodes);
     ui_view_call_init(c);
     ui_view_verify(p);
-    ui_app.request_layout();
+    ui_app.request_relayout(p);
 }
 
 static void ui_view_add_after(struct ui_view* c, struct ui_view* a) {
@@ -91,9 +99,10 @@ static void ui_view_add_after(struct ui_view* c, struct ui_view* a) {
     a->next = c;
     c->prev->next = c;
     c->next->prev = c;
+    ui_nodes.changed(ui_layout.nodes);
     ui_view_call_init(c);
     ui_view_verify(c->parent);
-    ui_app.request_layout();
+    ui_app.request_relayout(c->parent);
 }
 
 static void ui_view_add_before(struct ui_view* c, struct ui_view* b) {
@@ -105,9 +114,10 @@ static void ui_view_add_before(struct ui_view* c, struct ui_view* b) {
     b->prev = c;
     c->prev->next = c;
     c->next->prev = c;
+    ui_nodes.changed(ui_layout.nodes);
     ui_view_call_init(c);
     ui_view_verify(c->parent);
-    ui_app.request_layout();
+    ui_app.request_relayout(c->parent);
 }
 
 static void ui_view_remove(struct ui_view* c) {
@@ -127,14 +137,15 @@ static void ui_view_remove(struct ui_view* c) {
     }
     c->prev = null;
     c->next = null;
+    ui_nodes.changed(ui_layout.nodes);
     ui_view_verify(c->parent);
+    ui_app.request_relayout(c->parent);
     c->parent = null;
-    ui_app.request_layout();
 }
 
 static void ui_view_remove_all(struct ui_view* p) {
     while (p->child != null) { ui_view.remove(p->child); }
-    ui_app.request_layout();
+    ui_app.request_relayout(p);
 }
 
 static void ui_view_disband(struct ui_view* p) {
@@ -148,6 +159,17 @@ static void ui_view_disband(struct ui_view* p) {
     ui_app.request_layout();
 }
 
+static struct ui_rect ui_view_paint_rect(const struct ui_view* v) {
+    // view rectangle expanded by padding
+    struct ui_rect rc = (struct ui_rect){ v->x, v->y, v->w, v->h};
+    const struct ui_ltrb p = ui_view.margins(v, &v->padding);
+    rc.x -= p.left;
+    rc.y -= p.top;
+    rc.w += p.left + p.right;
+    rc.h += p.top + p.bottom;
+    return rc;
+}
+
 static void ui_view_invalidate(const struct ui_view* v, const struct ui_rect* r) {
     if (ui_view.is_hidden(v)) {
         posix_println("hidden: %s", ui_view_debug_id(v));
@@ -161,13 +183,7 @@ static void ui_view_invalidate(const struct ui_view* v, const struct ui_rect* r)
                 .h = r->h
             };
         } else {
-            rc = (struct ui_rect){ v->x, v->y, v->w, v->h};
-            // expand view rectangle by padding
-            const struct ui_ltrb p = ui_view.margins(v, &v->padding);
-            rc.x -= p.left;
-            rc.y -= p.top;
-            rc.w += p.left + p.right;
-            rc.h += p.top + p.bottom;
+            rc = ui_view_paint_rect(v);
         }
         if (v->debug.trace.prc) {
             posix_println("%d,%d %dx%d", rc.x, rc.y, rc.w, rc.h);
@@ -176,177 +192,92 @@ static void ui_view_invalidate(const struct ui_view* v, const struct ui_rect* r)
     }
 }
 
+// measure() and layout() are implemented by platform independent
+// ui_layout (see ui_layout.h):
+
 static const char* ui_view_string(struct ui_view* v) {
-    if (v->p.strid == 0) {
-        int32_t id = posix_nls.strid(v->p.text);
-        v->p.strid = id > 0 ? id : -1;
-    }
-    return v->p.strid < 0 ? v->p.text : // not localized
-        posix_nls.string(v->p.strid, v->p.text);
+    return ui_layout.string(v);
 }
 
-static struct ui_wh ui_view_text_metrics_va(int32_t x, int32_t y,
-        bool multiline, int32_t w, const struct ui_fm* fm,
-        const char* format, va_list va) {
-    const struct ui_ta ta = { .fm = fm, .color = ui_colors.transparent,
-                             .measure = true };
-    return multiline ?
-        ui_draw.multiline_va(&ta, x, y, w, format, va) :
-        ui_draw.text_va(&ta, x, y, format, va);
+static bool ui_view_is_orphan(const struct ui_view* v) {
+    return ui_layout.is_orphan(v);
 }
 
-static struct ui_wh ui_view_text_metrics(int32_t x, int32_t y,
-        bool multiline, int32_t w, const struct ui_fm* fm,
-        const char* format, ...) {
-    va_list va;
-    va_start(va, format);
-    struct ui_wh wh = ui_view_text_metrics_va(x, y, multiline, w, fm, format, va);
-    va_end(va);
-    return wh;
+static bool ui_view_is_hidden(const struct ui_view* v) {
+    return ui_layout.is_hidden(v);
+}
+
+static struct ui_ltrb ui_view_margins(const struct ui_view* v,
+        const struct ui_margins* m) {
+    return ui_layout.margins(v, m);
+}
+
+static void ui_view_inbox(const struct ui_view* v, struct ui_rect* r,
+        struct ui_ltrb* insets) {
+    ui_layout.inbox(v, r, insets);
+}
+
+static void ui_view_outbox(const struct ui_view* v, struct ui_rect* r,
+        struct ui_ltrb* padding) {
+    ui_layout.outbox(v, r, padding);
 }
 
 static void ui_view_text_measure(struct ui_view* v, const char* s,
         struct ui_view_text_metrics* tm) {
-    const struct ui_fm* fm = v->fm;
-    tm->wh = (struct ui_wh){ .w = 0, .h = fm->height };
-    if (s[0] == 0) {
-        tm->multiline = false;
-    } else {
-        tm->multiline = strchr(s, '\n') != null;
-        if (v->type == ui_view_label && tm->multiline) {
-            int32_t w = (int32_t)((fp64_t)v->min_w_em * (fp64_t)fm->em.w + 0.5);
-            tm->wh = ui_view.text_metrics(v->x, v->y, true,  w, fm, "%s", s);
-        } else {
-            tm->wh = ui_view.text_metrics(v->x, v->y, false, 0, fm, "%s", s);
-        }
-    }
+    ui_layout.text_measure(v, s, tm);
 }
 
-static void ui_view_text_align(struct ui_view* v, struct ui_view_text_metrics* tm) {
-    tm->xy = (struct ui_point){ .x = -1, .y = -1 };
-    const struct ui_ltrb i = ui_view.margins(v, &v->insets);
-    // i_wh the inside insets w x h:
-    const struct ui_wh i_wh = { .w = v->w - i.left - i.right,
-                           .h = v->h - i.top - i.bottom };
-    const int32_t h_align = v->text_align & ~(ui.align.top|ui.align.bottom);
-    const int32_t v_align = v->text_align & ~(ui.align.left|ui.align.right);
-    tm->xy.x = i.left + (i_wh.w - tm->wh.w + 1) / 2;
-    if (h_align & ui.align.left) {
-        tm->xy.x = i.left;
-    } else if (h_align & ui.align.right) {
-        tm->xy.x = i_wh.w - tm->wh.w - i.right;
-    }
-    // vertical centering is trickier.
-    // mt.h is height of all measured lines of text
-    tm->xy.y = i.top + (i_wh.h - tm->wh.h + 1) / 2;
-    if (v_align & ui.align.top) {
-        tm->xy.y = i.top;
-    } else if (v_align & ui.align.bottom) {
-        tm->xy.y = i_wh.h - tm->wh.h - i.bottom;
-    } else if (!tm->multiline) {
-#if 0 // TODO: doesn't look good or right:
-        // UI controls should have x-height line in the dead center
-        // of the control to be visually balanced.
-        // y offset of "x-line" of the glyph:
-        const struct ui_fm* fm = v->fm;
-        const int32_t y_of_x_line = fm->baseline - fm->x_height;
-        // `dy` offset of the center to x-line (middle of glyph cell)
-        const int32_t dy = tm->wh.h / 2 - y_of_x_line;
-        tm->xy.y += dy / 2;
-        if (v->debug.trace.mt) {
-            posix_println(" x-line: %d mt.h: %d mt.h / 2 - x_line: %d",
-                      y_of_x_line, tm->wh.h, dy);
-        }
-#endif
-    }
+static void ui_view_text_align(struct ui_view* v,
+        struct ui_view_text_metrics* tm) {
+    ui_layout.text_align(v, tm);
 }
 
 static void ui_view_measure_control(struct ui_view* v) {
-    v->p.strid = 0;
-    const char* s = ui_view.string(v);
-    const struct ui_fm* fm = v->fm;
-    const struct ui_ltrb i = ui_view.margins(v, &v->insets);
-    v->w = (int32_t)((fp64_t)fm->em.w * (fp64_t)v->min_w_em + 0.5);
-    v->h = (int32_t)((fp64_t)fm->em.h * (fp64_t)v->min_h_em + 0.5);
-    if (v->debug.trace.mt) {
-        const struct ui_ltrb p = ui_view.margins(v, &v->padding);
-        posix_println(">%dx%d em: %dx%d min: %.3fx%.3f "
-                "i: %d %d %d %d p: %d %d %d %d %s \"%.*s\"",
-            v->w, v->h, fm->em.w, fm->em.h, v->min_w_em, v->min_h_em,
-            i.left, i.top, i.right, i.bottom,
-            p.left, p.top, p.right, p.bottom,
-            ui_view_debug_id(v),
-            (64 < strlen(s) ? 64 : strlen(s)), s);
-        const struct ui_margins in = v->insets;
-        const struct ui_margins pd = v->padding;
-        posix_println(" i: %.3f %.3f %.3f %.3f l+r: %.3f t+b: %.3f"
-                " p: %.3f %.3f %.3f %.3f l+r: %.3f t+b: %.3f",
-            in.left, in.top, in.right, in.bottom,
-            in.left + in.right, in.top + in.bottom,
-            pd.left, pd.top, pd.right, pd.bottom,
-            pd.left + pd.right, pd.top + pd.bottom);
-    }
-    ui_view_text_measure(v, s, &v->text);
-    if (v->debug.trace.mt) {
-        posix_println(" mt: %d %d", v->text.wh.w, v->text.wh.h);
-    }
-    v->w = v->w > i.left + v->text.wh.w + i.right ? v->w : i.left + v->text.wh.w + i.right;
-    v->h = v->h > i.top  + v->text.wh.h + i.bottom ? v->h : i.top  + v->text.wh.h + i.bottom;
-    ui_view_text_align(v, &v->text);
-    if (v->debug.trace.mt) {
-        posix_println("<%dx%d text_align x,y: %d,%d %s",
-                v->w, v->h, v->text.xy.x, v->text.xy.y,
-                ui_view_debug_id(v));
-    }
+    ui_layout.measure_control(v);
 }
 
 static void ui_view_measure_children(struct ui_view* v) {
-    if (!ui_view.is_hidden(v)) {
-        ui_view_for_each(v, c, { ui_view.measure(c); });
-    }
+    ui_layout.measure_children(v);
+}
+
+static void ui_view_layout_children(struct ui_view* v) {
+    ui_layout.layout_children(v);
 }
 
 static void ui_view_measure(struct ui_view* v) {
-    if (!ui_view.is_hidden(v)) {
-        ui_view_measure_children(v);
-        if (v->prepare != null) { v->prepare(v); }
-        if (v->measure != null && v->measure != ui_view_measure) {
-            v->measure(v);
-        } else {
-            ui_view.measure_control(v);
-        }
-        if (v->measured != null) { v->measured(v); }
-    }
+    ui_layout.measure(v);
 }
 
-static void ui_layout_view(struct ui_view* posix_unused(v)) {
-//  struct ui_ltrb i = ui_view.margins(v, &v->insets);
-//  struct ui_ltrb p = ui_view.margins(v, &v->padding);
-//  posix_println(">%s %d,%d %dx%d p: %d %d %d %d  i: %d %d %d %d",
-//               v->p.text, v->x, v->y, v->w, v->h,
-//               p.left, p.top, p.right, p.bottom,
-//               i.left, i.top, i.right, i.bottom);
-//  posix_println("<%s %d,%d %dx%d", v->p.text, v->x, v->y, v->w, v->h);
+static void ui_view_layout(struct ui_view* v) {
+    ui_layout.layout(v);
 }
 
-static void ui_view_layout_children(struct ui_view* v) {
-    if (!ui_view.is_hidden(v)) {
-        ui_view_for_each(v, c, { ui_view.layout(c); });
-    }
+static void ui_view_dirty(struct ui_view* v) {
+    ui_layout.dirty(v);
 }
 
-static void ui_view_layout(struct ui_view* v) {
-//  posix_println(">%s %d,%d %dx%d", v->p.text, v->x, v->y, v->w, v->h);
-    if (!ui_view.is_hidden(v)) {
-        if (v->layout != null && v->layout != ui_view_layout) {
-            v->layout(v);
-        } else {
-            ui_layout_view(v);
-        }
-        if (v->composed != null) { v->composed(v); }
-        ui_view_layout_children(v);
-    }
-//  posix_println("<%s %d,%d %dx%d", v->p.text, v->x, v->y, v->w, v->h);
+static void ui_view_dirty_all(void) {
+    ui_layout.dirty_all();
+}
+
+static struct ui_wh ui_view_text_metrics_va(int32_t x, int32_t y,
+        bool multiline, int32_t w, const struct ui_fm* fm,
+        const char* format, va_list va) {
+    const struct ui_ta ta = { .fm = fm, .color = ui_colors.transparent,
+                             .measure = true };
+    return multiline ?
+        ui_draw.multiline_va(&ta, x, y, w, format, va) :
+        ui_draw.text_va(&ta, x, y, format, va);
+}
+
+static struct ui_wh ui_view_text_metrics(int32_t x, int32_t y,
+        bool multiline, int32_t w, const struct ui_fm* fm,
+        const char* format, ...) {
+    va_list va;
+    va_start(va, format);
+    struct ui_wh wh = ui_view_text_metrics_va(x, y, multiline, w, fm, format, va);
+    va_end(va);
+    return wh;
 }
 
 static bool ui_view_inside(const struct ui_view* v, const struct ui_point* pt) {
@@ -366,56 +297,6 @@ static bool ui_view_is_parent_of(const struct ui_view* parent,
     return false;
 }
 
-static struct ui_ltrb ui_view_margins(const struct ui_view* v, const struct ui_margins* m) {
-    const fp64_t gw = (fp64_t)m->left + (fp64_t)m->right;
-    const fp64_t gh = (fp64_t)m->top  + (fp64_t)m->bottom;
-    const struct ui_fm* fm = v->fm != null ? v->fm : &ui_app.fm.prop.normal;
-    const struct ui_wh* em = &fm->em;
-    const int32_t em_w = (int32_t)(em->w * gw + 0.5);
-    const int32_t em_h = (int32_t)(em->h * gh + 0.5);
-    const int32_t left = (int32_t)((fp64_t)em->w * (fp64_t)m->left + 0.5);
-    const int32_t top  = (int32_t)((fp64_t)em->h * (fp64_t)m->top  + 0.5);
-    return (struct ui_ltrb) {
-        .left   = left,         .top    = top,
-        .right  = em_w - left,  .bottom = em_h - top
-    };
-}
-
-static void ui_view_inbox(const struct ui_view* v, struct ui_rect* r, struct ui_ltrb* insets) {
-    posix_swear(r != null || insets != null);
-    posix_swear(v->max_w >= 0 && v->max_h >= 0);
-    const struct ui_ltrb i = ui_view_margins(v, &v->insets);
-    if (insets != null) { *insets = i; }
-    if (r != null) {
-        *r = (struct ui_rect) {
-            .x = v->x + i.left,
-            .y = v->y + i.top,
-            .w = v->w - i.left - i.right,
-            .h = v->h - i.top  - i.bottom,
-        };
-    }
-}
-
-static void ui_view_outbox(const struct ui_view* v, struct ui_rect* r, struct ui_ltrb* padding) {
-    posix_swear(r != null || padding != null);
-    posix_swear(v->max_w >= 0 && v->max_h >= 0);
-    const struct ui_ltrb p = ui_view_margins(v, &v->padding);
-    if (padding != null) { *padding = p; }
-    if (r != null) {
-//      posix_println("%s %d,%d %dx%d %.1f %.1f %.1f %.1f", v->p.text,
-//          v->x, v->y, v->w, v->h,
-//          v->padding.left, v->padding.top, v->padding.right, v->padding.bottom);
-        *r = (struct ui_rect) {
-            .x = v->x - p.left,
-            .y = v->y - p.top,
-            .w = v->w + p.left + p.right,
-            .h = v->h + p.top  + p.bottom,
-        };
-//      posix_println("%s %d,%d %dx%d", v->p.text,
-//          r->x, r->y, r->w, r->h);
-    }
-}
-
 static void ui_view_update_shortcut(struct ui_view* v) {
     if (ui_view.is_control(v) && v->type != ui_view_text &&
         v->shortcut == 0x00) {
@@ -437,7 +318,7 @@ static void ui_view_set_text_va(struct ui_view* v, const char* format, va_list v
         memcpy(s, t, (size_t)n + 1);
         v->p.strid = 0;  // next call to nls() will localize it
         ui_view_update_shortcut(v);
-        ui_app.request_layout();
+        ui_app.request_relayout(v);
     }
 }
 
@@ -491,20 +372,6 @@ static bool ui_view_is_shortcut_key(struct ui_view* v, int64_t key) {
     return keyboard_shortcut;
 }
 
-static bool ui_view_is_orphan(const struct ui_view* v) {
-    while (v != ui_app.root && v != null) { v = v->parent; }
-    return v == null;
-}
-
-static bool ui_view_is_hidden(const struct ui_view* v) {
-    bool hidden = v->state.hidden || ui_view.is_orphan(v);
-    while (!hidden && v->parent != null) {
-        v = v->parent;
-        hidden = v->state.hidden;
-    }
-    return hidden;
-}
-
 static bool ui_view_is_disabled(const struct ui_view* v) {
     bool disabled = v->state.disabled;
     while (!disabled && v->parent != null) {
@@ -514,20 +381,33 @@ static bool ui_view_is_disabled(const struct ui_view* v) {
     return disabled;
 }
 
+// Timer callbacks are broadcast to the whole tree and most views do
+// not have them. ui_nodes.for_each() iterates flat array of views
+// instead of recursion over linked lists of children.
+
+static void ui_view_call_timer(struct ui_view* v, void* id) {
+    if (v->timer != null) { v->timer(v, *(ui_timer_t*)id); }
+}
+
+static void ui_view_call_every_sec(struct ui_view* v, void* posix_unused(that)) {
+    if (v->every_sec != null) { v->every_sec(v); }
+}
+
+static void ui_view_call_every_100ms(struct ui_view* v, void* posix_unused(that)) {
+    if (v->every_100ms != null) { v->every_100ms(v); }
+}
+
 static void ui_view_timer(struct ui_view* v, ui_timer_t id) {
-    if (v->timer != null) { v->timer(v, id); }
     // timers are delivered even to hidden and disabled views:
-    ui_view_for_each(v, c, { ui_view_timer(c, id); });
+    ui_nodes.for_each(ui_layout.nodes, v, ui_view_call_timer, &id);
 }
 
 static void ui_view_every_sec(struct ui_view* v) {
-    if (v->every_sec != null) { v->every_sec(v); }
-    ui_view_for_each(v, c, { ui_view_every_sec(c); });
+    ui_nodes.for_each(ui_layout.nodes, v, ui_view_call_every_sec, null);
 }
 
 static void ui_view_every_100ms(struct ui_view* v) {
-    if (v->every_100ms != null) { v->every_100ms(v); }
-    ui_view_for_each(v, c, { ui_view_every_100ms(c); });
+    ui_nodes.for_each(ui_layout.nodes, v, ui_view_call_every_100ms, null);
 }
 
 static bool ui_view_key_pressed(struct ui_view* v, int64_t k) {
@@ -592,13 +472,30 @@ static void ui_view_paint(struct ui_view* v) {
                 (64 < strlen(s) ? 64 : strlen(s)), s);
     }
     if (!v->state.hidden && ui_app.crc.w > 0 && ui_app.crc.h > 0) {
-        if (v->erase   != null) { v->erase(v); }
-        if (v->paint   != null) { v->paint(v); }
-        if (v->painted != null) { v->painted(v); }
-        if (v->debug.paint.margins) { ui_view.debug_paint_margins(v); }
-        if (v->debug.paint.fm)   { ui_view.debug_paint_fm(v); }
-        if (v->debug.paint.call && v->debug_paint != null) { v->debug_paint(v); }
-        ui_view_for_each(v, c, { ui_view_paint(c); });
+        // views outside of dirty region are not painted:
+        const struct ui_rect prc = ui_view_paint_rect(v);
+        const bool dirty = ui_region.intersects(&ui_app.dirty, &prc);
+        if (dirty) {
+            if (v->erase   != null) { v->erase(v); }
+            if (v->paint   != null) { v->paint(v); }
+            if (v->painted != null) { v->painted(v); }
+            if (v->debug.paint.margins) { ui_view.debug_paint_margins(v); }
+            if (v->debug.paint.fm)   { ui_view.debug_paint_fm(v); }
+            if (v->debug.paint.call && v->debug_paint != null) { v->debug_paint(v); }
+        }
+        // partially visible rows of ui_vlist are clipped to its bounds
+        const bool clip = v->type == ui_view_vlist;
+        // Invariant: children of containers (and ui_vlist rows) paint
+        // inside of the container's padded rect (ui_view_paint_rect()).
+        // The whole subtree of a container that misses ui_app.dirty is
+        // skipped, so a child painting outside of its parent's bounds
+        // will not be repainted and goes stale. Children of other views
+        // may stick out and are always visited.
+        if (dirty || !(clip || ui_view.is_container(v))) {
+            if (clip) { ui_draw.set_clip(v->x, v->y, v->w, v->h); }
+            ui_view_for_each(v, c, { ui_view_paint(c); });
+            if (clip) { ui_draw.set_clip(0, 0, 0, 0); }
+        }
     }
 }
 
@@ -625,12 +522,41 @@ static void ui_view_set_focus(struct ui_view* v) {
     }
 }
 
+static struct ui_rtree ui_view_rtree; // of the last layout()
+static bool ui_view_indexed;
+static const struct ui_rtree_item** ui_view_found;
+static int32_t ui_view_found_capacity;
+
+static void ui_view_index(struct ui_view* root_or_null) {
+    ui_view_indexed = root_or_null != null;
+    if (ui_view_indexed) { ui_rtree.update(&ui_view_rtree, root_or_null); }
+}
+
+static int32_t ui_view_query(struct ui_point pt) {
+    int32_t k = ui_rtree.query(&ui_view_rtree, pt, ui_view_found,
+                               ui_view_found_capacity);
+    if (k > ui_view_found_capacity) {
+        const size_t bytes = (size_t)k * sizeof(ui_view_found[0]);
+        posix_swear(posix_heap.realloc((void**)&ui_view_found, bytes) == 0);
+        ui_view_found_capacity = k;
+        k = ui_rtree.query(&ui_view_rtree, pt, ui_view_found, k);
+    }
+    return k;
+}
+
 static int64_t ui_view_hit_test(const struct ui_view* v, struct ui_point pt) {
     int64_t ht = ui.hit_test.nowhere;
-    if (!ui_view.is_hidden(v) && v->hit_test != null) {
+    const bool hidden = ui_view.is_hidden(v);
+    if (!hidden && v->hit_test != null) {
          ht = v->hit_test(v, pt);
     }
-    if (ht == ui.hit_test.nowhere) {
+    const struct ui_view* root = ui_view_rtree.root;
+    if (ht != ui.hit_test.nowhere) {
+        // done
+    } else if (ui_view_indexed && !hidden &&
+              (v == root || ui_view.is_parent_of(root, v))) {
+        ht = ui_rtree.hit_test(&ui_view_rtree, v, pt);
+    } else {
         ui_view_for_each(v, c, {
             if (!c->state.hidden && ui_view.inside(c, &pt)) {
                 ht = ui_view_hit_test(c, pt);
@@ -652,15 +578,48 @@ static void ui_view_update_hover(struct ui_view* v, bool hidden) {
     }
 }
 
+static void ui_view_update_hovered(void) {
+    // hover can only change for hovered views and views under the mouse
+    struct ui_rtree* t = &ui_view_rtree;
+    const int32_t k = ui_view_query(ui_app.mouse);
+    int32_t n = 0;
+    for (int32_t i = 0; i < t->hovering; i++) {
+        struct ui_view* h = t->hovered[i];
+        ui_view_update_hover(h, ui_view.is_hidden(h));
+        if (h->state.hover) { t->hovered[n++] = h; }
+    }
+    t->hovering = n;
+    for (int32_t i = 0; i < k; i++) {
+        struct ui_view* f = ui_view_found[i]->v;
+        if (!f->state.hover) {
+            ui_view_update_hover(f, ui_view.is_hidden(f));
+            if (f->state.hover) {
+                posix_assert(t->hovering < t->capacity);
+                t->hovered[t->hovering++] = f;
+            }
+        }
+    }
+}
+
 static void ui_view_mouse_hover(struct ui_view* v) {
 //  posix_println("%d,%d %s", ui_app.mouse.x, ui_app.mouse.y,
 //          ui_app.mouse_left  ? "L" : "_",
 //          ui_app.mouse_right ? "R" : "_");
     // mouse hover over is dispatched even to disabled views
-    const bool hidden = ui_view.is_hidden(v);
-    ui_view_update_hover(v, hidden);
-    if (!hidden && v->mouse_hover != null) { v->mouse_hover(v); }
-    ui_view_for_each(v, c, { ui_view_mouse_hover(c); });
+    if (ui_view_indexed && v == ui_view_rtree.root) {
+        ui_view_update_hovered();
+        for (int32_t i = 0; i < ui_view_rtree.listening; i++) {
+            struct ui_view* l = ui_view_rtree.listeners[i];
+            if (l->mouse_hover != null && !ui_view.is_hidden(l)) {
+                l->mouse_hover(l);
+            }
+        }
+    } else {
+        const bool hidden = ui_view.is_hidden(v);
+        ui_view_update_hover(v, hidden);
+        if (!hidden && v->mouse_hover != null) { v->mouse_hover(v); }
+        ui_view_for_each(v, c, { ui_view_mouse_hover(c); });
+    }
 }
 
 static void ui_view_mouse_move(struct ui_view* v) {
@@ -668,10 +627,20 @@ static void ui_view_mouse_move(struct ui_view* v) {
 //          ui_app.mouse_left  ? "L" : "_",
 //          ui_app.mouse_right ? "R" : "_");
     // mouse move is dispatched even to disabled views
-    const bool hidden = ui_view.is_hidden(v);
-    ui_view_update_hover(v, hidden);
-    if (!hidden && v->mouse_move != null) { v->mouse_move(v); }
-    ui_view_for_each(v, c, { ui_view_mouse_move(c); });
+    if (ui_view_indexed && v == ui_view_rtree.root) {
+        ui_view_update_hovered();
+        for (int32_t i = 0; i < ui_view_rtree.listening; i++) {
+            struct ui_view* l = ui_view_rtree.listeners[i];
+            if (l->mouse_move != null && !ui_view.is_hidden(l)) {
+                l->mouse_move(l);
+            }
+        }
+    } else {
+        const bool hidden = ui_view.is_hidden(v);
+        ui_view_update_hover(v, hidden);
+        if (!hidden && v->mouse_move != null) { v->mouse_move(v); }
+        ui_view_for_each(v, c, { ui_view_mouse_move(c); });
+    }
 }
 
 static void ui_view_double_click(struct ui_view* v, int32_t ix) {
@@ -956,7 +925,7 @@ static void ui_view_test(void) {
         &c1,
         ui_view.add(&c2, &g1, &g2, null),
         ui_view.add(&c3, &g3, &g4, null),
-        &c4);
+        &c4, null);
     ui_view_verify(&p0);
     ui_view_disband(&p0);
     ui_view_no_siblings(&p0);
@@ -995,6 +964,8 @@ struct ui_view_if ui_view = {
     .layout_children     = ui_view_layout_children,
     .measure             = ui_view_measure,
     .layout              = ui_view_layout,
+    .dirty               = ui_view_dirty,
+    .dirty_all           = ui_view_dirty_all,
     .string              = ui_view_string,
     .is_orphan           = ui_view_is_orphan,
     .is_hidden           = ui_view_is_hidden,
@@ -1016,6 +987,7 @@ struct ui_view_if ui_view = {
     .mouse_hover         = ui_view_mouse_hover,
     .mouse_move          = ui_view_mouse_move,
     .mouse_scroll        = ui_view_mouse_scroll,
+    .index               = ui_view_index,
     .hovering            = ui_view_hovering,
     .hover_changed       = ui_view_hover_changed,
     .is_shortcut_key     = ui_view_is_shortcut_key,
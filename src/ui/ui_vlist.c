@@ -0,0 +1,453 @@
+/* Copyright (c) Dmitry "Leo" Kuznetsov 2021-24 see LICENSE for details */
+#include "posix/posix.h"
+#include "ui/ui_core.h"
+#include "ui/ui_colors.h"
+#include "ui/ui_draw.h"
+#include "ui/ui_view.h"
+#include "ui/ui_nodes.h"
+#include "ui/ui_layout.h"
+#include "ui/ui_vlist.h"
+
+#undef UI_VLIST_TEST
+
+#if 0 // flip to 1 to run tests
+
+#define UI_VLIST_TEST
+
+#endif
+
+static void ui_vlist_reserve(struct ui_vlist* vl, int32_t n) {
+    if (n > vl->w.capacity) {
+        const int32_t c = n > vl->w.capacity * 2 ?
+            (n > 16 ? n : 16) : vl->w.capacity * 2;
+        const size_t bytes = (size_t)c * sizeof(vl->w.rows[0]);
+        posix_swear(posix_heap.realloc((void**)&vl->w.rows,  bytes) == 0);
+        posix_swear(posix_heap.realloc((void**)&vl->w.next,  bytes) == 0);
+        posix_swear(posix_heap.realloc((void**)&vl->w.spare, bytes) == 0);
+        vl->w.capacity = c;
+    }
+}
+
+static void ui_vlist_spare(struct ui_vlist* vl, struct ui_view* r) {
+    ui_vlist_reserve(vl, vl->w.spares + 1);
+    r->parent = null;
+    r->prev = null;
+    r->next = null;
+    vl->w.spare[vl->w.spares++] = r;
+}
+
+static void ui_vlist_link(struct ui_view* v, struct ui_view* r) {
+    // appends row to the children list w/o ui_view.add() side effects
+    r->parent = v;
+    if (v->child == null) {
+        r->prev = r;
+        r->next = r;
+        v->child = r;
+    } else {
+        r->prev = v->child->prev;
+        r->next = v->child;
+        r->prev->next = r;
+        r->next->prev = r;
+    }
+}
+
+static int32_t ui_vlist_estimate(const struct ui_vlist* vl) {
+    const struct ui_fm* fm = vl->view.fm != null ? vl->view.fm : ui_layout.fm;
+    return vl->row_h > 0 ? vl->row_h :
+          (vl->w.estimate > 0 ? vl->w.estimate : fm->height);
+}
+
+static int32_t ui_vlist_row_height(const struct ui_vlist* vl,
+        const struct ui_view* r) {
+    int32_t h = vl->row_h;
+    if (h <= 0) {
+        const struct ui_ltrb p = ui_layout.margins(r, &r->padding);
+        h = p.top + r->h + p.bottom;
+    }
+    return h;
+}
+
+static struct ui_view* ui_vlist_row_of(struct ui_vlist* vl, int64_t ix) {
+    const int64_t i = ix - vl->w.first;
+    return 0 <= i && i < vl->w.n ? vl->w.rows[i] : null;
+}
+
+static int32_t ui_vlist_height_of(struct ui_vlist* vl, int64_t ix) {
+    const struct ui_view* r = vl->row_h > 0 ? null : ui_vlist_row_of(vl, ix);
+    return r != null ? ui_vlist_row_height(vl, r) : ui_vlist_estimate(vl);
+}
+
+static void ui_vlist_scroll_by(struct ui_vlist* vl, int32_t dy) {
+    if (vl->count <= 0) {
+        vl->top = 0;
+        vl->offset = 0;
+    } else if (vl->row_h > 0) {
+        // fixed height rows: O(1) for any distance
+        int64_t y = vl->top * vl->row_h + vl->offset + dy;
+        y = posix_max(0, y);
+        vl->top = posix_min(y / vl->row_h, vl->count - 1);
+        vl->offset = (int32_t)(y - vl->top * vl->row_h);
+    } else {
+        vl->offset += dy;
+        while (vl->offset < 0 && vl->top > 0) {
+            vl->top--;
+            vl->offset += ui_vlist_height_of(vl, vl->top);
+        }
+        while (vl->top < vl->count - 1 &&
+               vl->offset >= ui_vlist_height_of(vl, vl->top)) {
+            vl->offset -= ui_vlist_height_of(vl, vl->top);
+            vl->top++;
+        }
+        vl->offset = posix_max(0, vl->offset);
+    }
+    // scrolling past the end is undone by layout()
+}
+
+static void ui_vlist_scroll(struct ui_vlist* vl, int32_t dy) {
+    ui_vlist_scroll_by(vl, dy);
+    ui_layout.dirty(&vl->view);
+}
+
+static void ui_vlist_scroll_to(struct ui_vlist* vl, int64_t ix) {
+    vl->top = posix_max(0, posix_min(ix, vl->count - 1));
+    vl->offset = 0;
+    ui_layout.dirty(&vl->view);
+}
+
+static struct ui_view* ui_vlist_bind(struct ui_vlist* vl, int64_t ix,
+        int64_t* tail) {
+    struct ui_view* r = null;
+    const int64_t i = ix - vl->w.first;
+    if (0 <= i && i < vl->w.n && vl->w.rows[i] != null) {
+        r = vl->w.rows[i]; // keeps binding
+        vl->w.rows[i] = null;
+    } else {
+        struct ui_view* reuse = null;
+        if (vl->w.spares > 0) {
+            reuse = vl->w.spare[--vl->w.spares];
+        }
+        // scrolling up: rows at the end of previous window are
+        // about to fall out of the window below and are reused
+        while (reuse == null && *tail > ix) {
+            const int64_t k = *tail - vl->w.first;
+            (*tail)--;
+            if (0 <= k && k < vl->w.n && vl->w.rows[k] != null) {
+                reuse = vl->w.rows[k];
+                vl->w.rows[k] = null;
+            }
+        }
+        r = vl->row(vl, reuse, ix);
+        posix_swear(r != null && (reuse == null || r == reuse),
+                    "row() must return recycled row");
+        ui_view_call_init(r);
+        r->p.dirty = true; // rebound: needs measure()
+        vl->w.bound++;
+    }
+    r->state.hidden = false;
+    ui_vlist_link(&vl->view, r);
+    ui_layout.measure(r);
+    return r;
+}
+
+static void ui_vlist_place(struct ui_vlist* vl, struct ui_view* r,
+        const struct ui_rect* wr, int32_t y) {
+    // `wr` window rect, `y` top of the row outbox
+    const struct ui_ltrb p = ui_layout.margins(r, &r->padding);
+    const int32_t h = ui_vlist_row_height(vl, r);
+    r->x = wr->x + p.left;
+    r->y = y + p.top;
+    r->w = wr->w - p.left - p.right;
+    r->h = h - p.top - p.bottom;
+    // overscan rows are bound and measured but not painted or hit
+    r->state.hidden = y + h <= wr->y || y >= wr->y + wr->h;
+    ui_layout.layout(r);
+}
+
+static int32_t ui_vlist_window(struct ui_vlist* vl, const struct ui_rect* wr) {
+    // materializes rows [from..top..to). When the last row is inside
+    // the window returns distance from its bottom to the window bottom:
+    // > 0 unfilled window height, < 0 last row is partially visible
+    struct ui_view* v = &vl->view;
+    const int64_t from = vl->top > vl->overscan ? vl->top - vl->overscan : 0;
+    const int64_t first = vl->w.first;
+    const int64_t bound = vl->w.bound;
+    const int32_t n = vl->w.n;
+    for (int32_t i = 0; i < vl->w.n; i++) {
+        if (vl->w.first + i < from && vl->w.rows[i] != null) {
+            ui_vlist_spare(vl, vl->w.rows[i]);
+            vl->w.rows[i] = null;
+        }
+    }
+    int64_t tail = vl->w.first + vl->w.n - 1;
+    v->child = null;
+    int32_t k = 0;
+    for (int64_t ix = from; ix < vl->top; ix++) {
+        ui_vlist_reserve(vl, k + 1);
+        vl->w.next[k++] = ui_vlist_bind(vl, ix, &tail);
+    }
+    int32_t y = wr->y - vl->offset; // top of `top` row
+    int32_t below = 0; // number of rows below the window
+    int64_t ix = vl->top;
+    while (ix < vl->count && below <= vl->overscan) {
+        if (y >= wr->y + wr->h) { below++; }
+        if (below <= vl->overscan) {
+            ui_vlist_reserve(vl, k + 1);
+            struct ui_view* r = ui_vlist_bind(vl, ix, &tail);
+            vl->w.next[k++] = r;
+            ui_vlist_place(vl, r, wr, y);
+            y += ui_vlist_row_height(vl, r);
+            ix++;
+        }
+    }
+    int32_t ya = wr->y - vl->offset;
+    for (int64_t i = vl->top - 1; i >= from; i--) {
+        struct ui_view* r = vl->w.next[i - from];
+        ya -= ui_vlist_row_height(vl, r);
+        ui_vlist_place(vl, r, wr, ya);
+    }
+    for (int32_t i = 0; i < vl->w.n; i++) {
+        if (vl->w.rows[i] != null) { ui_vlist_spare(vl, vl->w.rows[i]); }
+    }
+    struct ui_view** swap = vl->w.rows;
+    vl->w.rows = vl->w.next;
+    vl->w.next = swap;
+    vl->w.n = k;
+    vl->w.first = from;
+    if (k != n || from != first || vl->w.bound != bound) {
+        ui_nodes.changed(ui_layout.nodes); // rows relinked in the same order otherwise
+    }
+    return ix == vl->count ? wr->y + wr->h - y : 0;
+}
+
+static void ui_vlist_measure(struct ui_view* v) {
+    posix_swear(v->type == ui_view_vlist, "type %4.4s 0x%08X", &v->type, v->type);
+    struct ui_vlist* vl = (struct ui_vlist*)v;
+    struct ui_ltrb insets;
+    ui_layout.inbox(v, null, &insets);
+    int32_t w = 0;
+    ui_view_for_each(v, r, {
+        if (!r->state.hidden) {
+            struct ui_rect rbx;
+            ui_layout.outbox(r, &rbx, null);
+            w = posix_max(w, rbx.w);
+        }
+    });
+    // height of the list does not depend on count: usually it is
+    // expanded by the parent (.max_h = ui.infinity)
+    v->w = insets.left + w + insets.right;
+    v->h = insets.top + ui_vlist_estimate(vl) + insets.bottom;
+}
+
+static void ui_vlist_layout(struct ui_view* v) {
+    posix_swear(v->type == ui_view_vlist, "type %4.4s 0x%08X", &v->type, v->type);
+    struct ui_vlist* vl = (struct ui_vlist*)v;
+    struct ui_rect wr;
+    ui_layout.inbox(v, &wr, null);
+    vl->top = posix_max(0, posix_min(vl->top, vl->count - 1));
+    if (vl->count == 0 || wr.h <= 0) { vl->offset = 0; }
+    // scroll() uses estimated heights of rows outside of the window.
+    // More passes are needed when estimate was off and the `top` row
+    // is not visible or when scrolled past the end (the last row is
+    // moved to the bottom edge of the window in a couple of steps).
+    int32_t fit = ui_vlist_window(vl, &wr);
+    bool clamped = false;
+    for (int32_t pass = 0; pass < 8; pass++) {
+        if (vl->row_h <= 0 && vl->top < vl->count - 1 &&
+            vl->offset >= ui_vlist_height_of(vl, vl->top)) {
+            ui_vlist_scroll_by(vl, 0); // measured heights
+        } else if (fit > 0 && (vl->top > 0 || vl->offset > 0)) {
+            clamped = true;
+            ui_vlist_scroll_by(vl, -fit);
+        } else if (clamped && fit < 0) {
+            ui_vlist_scroll_by(vl, -fit);
+        } else {
+            break;
+        }
+        fit = ui_vlist_window(vl, &wr);
+    }
+    if (vl->row_h <= 0 && vl->w.n > 0) {
+        int64_t sum = 0;
+        for (int32_t i = 0; i < vl->w.n; i++) {
+            sum += ui_vlist_row_height(vl, vl->w.rows[i]);
+        }
+        vl->w.estimate = (int32_t)(sum / vl->w.n);
+    }
+}
+
+static void ui_vlist_init(struct ui_vlist* vl) {
+    static_assert(offsetof(struct ui_vlist, view) == 0, "offsetof(.view)");
+    struct ui_view* v = &vl->view;
+    posix_swear(v->type == ui_view_vlist, "type %4.4s 0x%08X", &v->type, v->type);
+    posix_swear(vl->row != null && vl->count >= 0 && vl->overscan >= 0);
+    if (v->measure == null) { v->measure = ui_vlist_measure; }
+    if (v->layout  == null) { v->layout  = ui_vlist_layout;  }
+    v->p.measure = ui_vlist_measure;
+    v->p.layout  = ui_vlist_layout;
+    if (v->max_w == 0) { v->max_w = ui_infinity; }
+    if (v->max_h == 0) { v->max_h = ui_infinity; }
+}
+
+static void ui_vlist_reload(struct ui_vlist* vl) {
+    for (int32_t i = 0; i < vl->w.n; i++) { ui_vlist_spare(vl, vl->w.rows[i]); }
+    vl->w.n = 0;
+    vl->view.child = null;
+    ui_layout.dirty(&vl->view);
+    ui_nodes.changed(ui_layout.nodes);
+}
+
+static void ui_vlist_dispose(struct ui_vlist* vl) {
+    ui_vlist_reload(vl);
+    if (vl->recycle != null) {
+        for (int32_t i = 0; i < vl->w.spares; i++) {
+            vl->recycle(vl, vl->w.spare[i]);
+        }
+    }
+    posix_heap.free(vl->w.rows);
+    posix_heap.free(vl->w.next);
+    posix_heap.free(vl->w.spare);
+    memset(&vl->w, 0x00, sizeof(vl->w));
+}
+
+enum { ui_vlist_test_pool = 256 };
+
+static struct ui_view ui_vlist_test_rows[ui_vlist_test_pool];
+static int64_t ui_vlist_test_ix[ui_vlist_test_pool]; // bound items
+static int32_t ui_vlist_test_created;
+
+static struct ui_view* ui_vlist_test_row(struct ui_vlist* vl,
+        struct ui_view* r, int64_t ix) {
+    if (r == null) {
+        posix_swear(ui_vlist_test_created < ui_vlist_test_pool);
+        r = &ui_vlist_test_rows[ui_vlist_test_created++];
+        memset(r, 0x00, sizeof(*r));
+        r->type = ui_view_label;
+        r->fm = ui_layout.fm;
+        r->p.strid = -1; // not localized
+        r->padding = (struct ui_margins){ 0.375f, 0.25f, 0.375f, 0.25f };
+    }
+    // row_h == 0: every third row is two lines tall
+    const char* format = vl->row_h == 0 && ix % 3 == 0 ? "%lld\n%lld" : "%lld";
+    posix_str.format(r->p.text, posix_countof(r->p.text), format, ix, ix);
+    ui_vlist_test_ix[r - ui_vlist_test_rows] = ix;
+    return r;
+}
+
+static void ui_vlist_test_pass(struct ui_vlist* vl, int32_t w, int32_t h) {
+    struct ui_view* v = &vl->view;
+    const struct ui_view* saved = ui_layout.root;
+    ui_layout.root = v;
+    ui_layout.measure(v);
+    v->x = 0;
+    v->y = 0;
+    v->w = w;
+    v->h = h;
+    ui_layout.layout(v);
+    ui_layout.root = saved;
+}
+
+static void ui_vlist_test_verify(struct ui_vlist* vl) {
+    struct ui_rect wr;
+    ui_layout.inbox(&vl->view, &wr, null);
+    posix_swear(vl->w.n > 0);
+    posix_swear(vl->w.first <= vl->top && vl->top < vl->w.first + vl->w.n);
+    int32_t visible = 0;
+    int32_t y = 0;
+    int32_t i = 0;
+    ui_view_for_each(&vl->view, r, {
+        posix_swear(r == vl->w.rows[i]);
+        posix_swear(ui_vlist_test_ix[r - ui_vlist_test_rows] == vl->w.first + i);
+        const struct ui_ltrb p = ui_layout.margins(r, &r->padding);
+        // rows are adjacent
+        if (i > 0) { posix_swear(r->y - p.top == y); }
+        y = r->y + r->h + p.bottom;
+        if (vl->w.first + i == vl->top) {
+            posix_swear(r->y - p.top == wr.y - vl->offset);
+        }
+        if (!r->state.hidden) { visible++; }
+        i++;
+    });
+    posix_swear(i == vl->w.n && visible > 0);
+    const bool last = vl->w.first + vl->w.n == vl->count;
+    // window is filled unless whole list is shorter than the window
+    posix_swear(y >= wr.y + wr.h || (last && vl->top == 0 && vl->offset == 0));
+    // no more than overscan rows on each side of visible rows
+    posix_swear(vl->w.n <= visible + vl->overscan * 2);
+}
+
+static void ui_vlist_test_scrolling(int32_t row_h) {
+    enum { w = 200, h = 400 };
+    struct ui_vlist vl = {
+        .view = { .type = ui_view_vlist, .fm = ui_layout.fm },
+        .count = 1000 * 1000, .row_h = row_h, .overscan = 2,
+        .row = ui_vlist_test_row
+    };
+    ui_vlist_test_created = 0;
+    ui_vlist.init(&vl);
+    ui_vlist_test_pass(&vl, w, h);
+    ui_vlist_test_verify(&vl);
+    posix_swear(vl.w.first == 0 && vl.top == 0 && vl.offset == 0);
+    // pixel scroll inside the row binds at most one row that
+    // becomes partially visible at the bottom
+    int64_t bound = vl.w.bound;
+    ui_vlist.scroll(&vl, 1);
+    ui_vlist_test_pass(&vl, w, h);
+    ui_vlist_test_verify(&vl);
+    posix_swear(vl.top == 0 && vl.offset == 1 && vl.w.bound - bound <= 1);
+    bound = vl.w.bound;
+    // scrolling by one row binds one row (or two short rows)
+    ui_vlist.scroll(&vl, ui_vlist_height_of(&vl, 0));
+    ui_vlist_test_pass(&vl, w, h);
+    ui_vlist_test_verify(&vl);
+    posix_swear(vl.top == 1 && vl.offset == 1);
+    posix_swear(vl.w.bound - bound <= (row_h > 0 ? 1 : 2));
+    uint32_t seed = 0x1;
+    for (int32_t i = 0; i < 1000; i++) {
+        const uint32_t action = posix_num.random32(&seed) % 8;
+        if (action == 0) {
+            ui_vlist.scroll_to(&vl, (int64_t)(posix_num.random32(&seed) % vl.count));
+        } else {
+            ui_vlist.scroll(&vl, (int32_t)(posix_num.random32(&seed) % 801) - 400);
+        }
+        ui_vlist_test_pass(&vl, w, h);
+        ui_vlist_test_verify(&vl);
+    }
+    // scrolled to the end: last row is at the bottom of the window
+    ui_vlist.scroll_to(&vl, vl.count - 1);
+    ui_vlist_test_pass(&vl, w, h);
+    ui_vlist_test_verify(&vl);
+    const struct ui_view* r = vl.w.rows[vl.w.n - 1];
+    struct ui_rect wr;
+    ui_layout.inbox(&vl.view, &wr, null);
+    posix_swear(ui_vlist_test_ix[r - ui_vlist_test_rows] == vl.count - 1);
+    posix_swear(r->y + r->h + ui_layout.margins(r, &r->padding).bottom == wr.y + wr.h);
+    // only window rows were ever created
+    posix_swear(ui_vlist_test_created <= vl.w.n + vl.w.spares);
+    posix_swear(ui_vlist_test_created < 64);
+    // shrinking list
+    vl.count = 5;
+    ui_vlist.reload(&vl);
+    ui_vlist_test_pass(&vl, w, h);
+    ui_vlist_test_verify(&vl);
+    posix_swear(vl.top == 0 && vl.offset == 0 && vl.w.n == 5);
+    ui_vlist.dispose(&vl);
+}
+
+static void ui_vlist_test(void) {
+    ui_vlist_test_scrolling(20); // fixed row height
+    ui_vlist_test_scrolling(0);  // measured rows of variable height
+    if (posix_debug.verbosity.level > posix_debug.verbosity.quiet) { posix_println("done"); }
+}
+
+struct ui_vlist_if ui_vlist = {
+    .init      = ui_vlist_init,
+    .scroll    = ui_vlist_scroll,
+    .scroll_to = ui_vlist_scroll_to,
+    .reload    = ui_vlist_reload,
+    .row_of    = ui_vlist_row_of,
+    .dispose   = ui_vlist_dispose,
+    .test      = ui_vlist_test
+};
+
+#ifdef UI_VLIST_TEST
+    posix_static_init(ui_vlist) { ui_vlist.test(); }
+#endif
@@ -0,0 +1,497 @@
+#include "posix/posix.h"
+#include "ui/ui_edit_doc.h"
+#include "ui/ui_edit_find.h"
+#include "ui/ui_edit_advance.h"
+#include "ui/ui_edit_lines.h"
+#include "ui/ui_edit_runs.h"
+#include <stdio.h>
+#if defined(_WIN32)
+#include <windows.h>
+#include <psapi.h>
+#else
+#include <sys/resource.h>
+#endif
+
+// Headless ui_edit_doc tests and throughput benchmark.
+// Depends only on core, trace and posix and builds on Linux:
+//
+// cc -std=gnu17 -O2 -Iinclude test/test3.c src/core/core.c
+//    src/trace/trace.c src/posix/posix.c src/ui/ui_edit_doc.c
+//    src/ui/ui_edit_find.c src/ui/ui_edit_advance.c
+//    src/ui/ui_edit_lines.c src/ui/ui_edit_runs.c -lm -lpthread -o test3
+
+static int usage(void) {
+    fprintf(stderr, "Usage: %s [options]\n", posix_args.basename());
+    fprintf(stderr, "Options:\n");
+    fprintf(stderr, "  --help, -h     - this help\n");
+    fprintf(stderr, "  --file <name>  - benchmark on real text corpus\n");
+    fprintf(stderr, "  --mb <n>       - size of synthetic text (default 16)\n");
+    fprintf(stderr, "  --ops <n>      - number of replace() calls (default 10000)\n");
+    fprintf(stderr, "  --bench        - run benchmark after tests\n");
+    fprintf(stderr, "  --save <name>  - benchmark save to file (e.g. --mb 1024)\n");
+    fprintf(stderr, "  --verbosity    - set verbosity level "
+                                "(quiet, info, verbose, debug, trace)\n");
+    return 0;
+}
+
+static const char* test3_words[] = {
+    "lorem", "ipsum", "dolor", "sit", "amet", "consectetur", "adipiscing",
+    "elit", "sed", "do", "eiusmod", "tempor", "incididunt", "ut", "labore",
+    "et", "dolore", "magna", "aliqua", "\xC2\xA3", "\xE2\x82\xAC", "\xF0\x9F\x92\xB0"
+};
+
+static char* test3_synthetic(int64_t bytes) {
+    char* text = null;
+    posix_fatal_if(posix_heap.alloc((void**)&text, bytes + 1) != 0);
+    uint32_t seed = 0x1;
+    int64_t k = 0;
+    int32_t column = 0;
+    while (k < bytes) {
+        const char* w = test3_words[posix_num.random32(&seed) %
+                                    posix_countof(test3_words)];
+        const int32_t b = (int32_t)strlen(w);
+        if (k + b + 1 > bytes) { break; }
+        memcpy(text + k, w, (size_t)b);
+        k += b;
+        column += b + 1;
+        text[k++] = column > 72 ? '\n' : ' ';
+        if (column > 72) { column = 0; }
+    }
+    memset(text + k, ' ', (size_t)(bytes - k));
+    text[bytes] = 0x00;
+    return text;
+}
+
+static int64_t test3_peak_rss(void) { // bytes
+    #if defined(_WIN32)
+        PROCESS_MEMORY_COUNTERS pmc = { .cb = sizeof(pmc) };
+        GetProcessMemoryInfo(GetCurrentProcess(), &pmc, sizeof(pmc));
+        return (int64_t)pmc.PeakWorkingSetSize;
+    #else
+        struct rusage ru = {0};
+        getrusage(RUSAGE_SELF, &ru);
+        return (int64_t)ru.ru_maxrss * 1024; // Linux: KB
+    #endif
+}
+
+static void test3_random_pg(struct ui_edit_doc* d, uint32_t *seed,
+        struct ui_edit_pg* pg) {
+    pg->pn = (int32_t)(posix_num.random32(seed) % (uint32_t)d->text.np);
+    const int32_t g = d->text.ps[pg->pn].g;
+    pg->gp = (int32_t)(posix_num.random32(seed) % (uint32_t)(g + 1));
+}
+
+static void test3_report(const char* what, fp64_t seconds, int64_t bytes,
+        int64_t ops) {
+    if (bytes > 0) {
+        posix_println("%-10s %10.3f ms %10.1f MB/s", what, seconds * 1000.0,
+                      (fp64_t)bytes / (1024.0 * 1024.0) / seconds);
+    } else {
+        posix_println("%-10s %10.3f ms %10.3f us/op", what, seconds * 1000.0,
+                      seconds * 1000000.0 / (fp64_t)ops);
+    }
+}
+
+static int32_t test3_runs(void* that, int32_t pn) {
+    const struct ui_edit_doc* d = (const struct ui_edit_doc*)that;
+    return 1 + d->text.ps[pn].b / 80; // as if wrapped at 80 bytes
+}
+
+static void test3_jumps(struct ui_edit_doc* d, int32_t jumps) {
+    // random scroll positions -> (pn, rn) -> back to line
+    struct ui_edit_lines lines = {0};
+    fp64_t time = posix_clock.seconds();
+    posix_fatal_if(!ui_edit_lines.init(&lines, d->text.np, test3_runs, d));
+    test3_report("lines", posix_clock.seconds() - time, 0, d->text.np);
+    const int32_t total = ui_edit_lines.sum(&lines, lines.n);
+    uint32_t seed = 0x1;
+    time = posix_clock.seconds();
+    for (int32_t i = 0; i < jumps; i++) {
+        const int32_t line = (int32_t)(posix_num.random32(&seed) % (uint32_t)total);
+        int32_t rn = 0;
+        const int32_t pn = ui_edit_lines.find(&lines, line, &rn);
+        posix_fatal_if(ui_edit_lines.sum(&lines, pn) + rn != line);
+    }
+    test3_report("jump", posix_clock.seconds() - time, 0, jumps);
+    posix_println("%d lines", total);
+    ui_edit_lines.dispose(&lines);
+}
+
+static int32_t test3_count(void* that, int32_t i) {
+    return ((const int32_t*)that)[i];
+}
+
+static void test3_paragraphs(int32_t n, int32_t rows) {
+    // random jumps and page scrolls in `n` paragraphs of 1..8 runs:
+    // lines index vs walking runs one by one (as edit view did)
+    int32_t* counts = null;
+    posix_fatal_if(posix_heap.alloc((void**)&counts,
+                   (size_t)n * sizeof(counts[0])) != 0);
+    uint32_t seed = 0x1;
+    for (int32_t i = 0; i < n; i++) {
+        counts[i] = 1 + (int32_t)(posix_num.random32(&seed) % 8);
+    }
+    struct ui_edit_lines lines = {0};
+    fp64_t time = posix_clock.seconds();
+    posix_fatal_if(!ui_edit_lines.init(&lines, n, test3_count, counts));
+    test3_report("lines", posix_clock.seconds() - time, 0, n);
+    const int32_t total = ui_edit_lines.sum(&lines, n);
+    posix_println("%d paragraphs %d lines", n, total);
+    enum { jumps = 1000 * 1000, scans = 1000 };
+    int64_t check = 0;
+    time = posix_clock.seconds();
+    for (int32_t i = 0; i < jumps; i++) {
+        const int32_t line = (int32_t)(posix_num.random32(&seed) % (uint32_t)total);
+        int32_t rn = 0;
+        const int32_t pn = ui_edit_lines.find(&lines, line, &rn);
+        check += ui_edit_lines.sum(&lines, pn) + rn - line;
+    }
+    test3_report("jump", posix_clock.seconds() - time, 0, jumps);
+    posix_fatal_if(check != 0);
+    time = posix_clock.seconds();
+    for (int32_t i = 0; i < scans; i++) {
+        const int32_t line = (int32_t)(posix_num.random32(&seed) % (uint32_t)total);
+        int32_t pn = 0;
+        int32_t s = 0;
+        while (s + counts[pn] <= line) { s += counts[pn]; pn++; }
+        check += pn;
+    }
+    test3_report("jump scan", posix_clock.seconds() - time, 0, scans);
+    posix_fatal_if(check <= 0); // keeps the loop from being optimized away
+    // page down through the whole text:
+    const int32_t pages = total / rows;
+    int32_t rn = 0;
+    int32_t pn = 0;
+    time = posix_clock.seconds();
+    for (int32_t p = 1; p < pages; p++) {
+        pn = ui_edit_lines.find(&lines, ui_edit_lines.sum(&lines, pn) + rn + rows, &rn);
+    }
+    test3_report("page", posix_clock.seconds() - time, 0, pages - 1);
+    const int32_t indexed = ui_edit_lines.sum(&lines, pn) + rn;
+    rn = 0;
+    pn = 0;
+    time = posix_clock.seconds();
+    for (int32_t p = 1; p < pages; p++) {
+        for (int32_t k = 0; k < rows; k++) {
+            // scroll_up() walked to the last fully visible run per line:
+            int32_t v = rows - (counts[pn] - rn);
+            int32_t q = pn;
+            while (v > 0 && q < n - 1) { q++; v -= counts[q]; }
+            check += q;
+            if (rn < counts[pn] - 1) {
+                rn++;
+            } else {
+                pn++;
+                rn = 0;
+            }
+        }
+    }
+    test3_report("page walk", posix_clock.seconds() - time, 0, pages - 1);
+    posix_fatal_if(ui_edit_lines.sum(&lines, pn) + rn != indexed || check <= 0);
+    ui_edit_lines.dispose(&lines);
+    posix_heap.free(counts);
+}
+
+static void test3_wrap(struct ui_edit_doc* d, int32_t width) {
+    // wrap every paragraph into runs of `width` glyphs and compare
+    // memory footprint with heap array of 5 x int32_t per run
+    const struct ui_edit_text* t = &d->text;
+    struct ui_edit_paragraph* para = null;
+    posix_fatal_if(posix_heap.alloc_zero((void**)&para,
+                   (size_t)t->np * sizeof(para[0])) != 0);
+    struct ui_edit_runs rs = {0};
+    int64_t runs = 0;
+    fp64_t time = posix_clock.seconds();
+    for (int32_t pn = 0; pn < t->np; pn++) {
+        const int32_t g = t->ps[pn].g;
+        ui_edit_runs.begin(&rs, para, t->np, 1 + g / width);
+        int32_t gp = 0;
+        int32_t rc = 0;
+        do {
+            const int32_t n = g - gp < width ? g - gp : width;
+            ui_edit_runs.add(&rs, n);
+            gp += n;
+            rc++;
+        } while (gp < g);
+        ui_edit_runs.end(&rs, &para[pn], rc);
+        runs += rc;
+    }
+    test3_report("wrap", posix_clock.seconds() - time, 0, t->np);
+    int64_t glyphs = 0;
+    time = posix_clock.seconds();
+    for (int32_t pn = 0; pn < t->np; pn++) {
+        struct ui_edit_run_it it;
+        ui_edit_runs.seek(&rs, &para[pn], &t->ps[pn], 0, &it);
+        while (it.rn < it.runs) {
+            glyphs += it.run.glyphs;
+            ui_edit_runs.next(&rs, &it);
+        }
+    }
+    test3_report("decode", posix_clock.seconds() - time, 0, runs);
+    posix_println("%d paragraphs %lld runs %lld glyphs", t->np, runs, glyphs);
+    const fp64_t mb = 1024.0 * 1024.0;
+    // before: para[] of {runs, pointer} + alloc() and realloc() per paragraph
+    const int64_t before = (int64_t)t->np * 16 + runs * 5 * sizeof(int32_t);
+    const int64_t after  = (int64_t)t->np * (int64_t)sizeof(para[0]) + rs.capacity;
+    posix_println("runs memory %.3f MB %lld allocations (was %.3f MB %lld)",
+        (fp64_t)after / mb, rs.allocations,
+        (fp64_t)before / mb, (int64_t)t->np * 2);
+    ui_edit_runs.dispose(&rs);
+    posix_heap.free(para);
+}
+
+// Headless replica of ui_edit_view word wrap (ui_edit_paragraph_runs())
+// with fixed pitch glyph advances instead of GDI measurements.
+
+struct test3_view {
+    const struct ui_edit_text* t;
+    struct ui_edit_advance a;
+    struct ui_edit_runs pool;
+    struct ui_edit_paragraph* para; // para[t->np]
+    struct ui_edit_lines lines;
+    int32_t width; // pixels
+};
+
+static int32_t test3_measure(void* that, const char* utf8, int32_t bytes) {
+    (void)that; (void)utf8;
+    return bytes == 1 ? 8 : 16; // ASCII and everything else
+}
+
+static int32_t test3_lines_count(void* that, int32_t pn) {
+    const struct test3_view* v = (const struct test3_view*)that;
+    return v->para[pn].runs > 0 ? v->para[pn].runs : 1;
+}
+
+static int32_t test3_word_break(struct test3_view* v,
+        const struct ui_edit_str* str, int32_t gp) {
+    int32_t k = 1;
+    const int32_t bp = str->g2b[gp];
+    if (gp < str->g - 1) {
+        const char* text = str->u + bp;
+        k = ui_edit_advance.fit(&v->a, text, str->b - bp, v->width, null);
+        if (k == 0) {
+            const int32_t b = ui_edit_advance.cluster(text, str->b - bp);
+            k = posix_str.glyphs(text, b);
+        }
+    }
+    return k;
+}
+
+static int32_t test3_view_runs(struct test3_view* v, int32_t pn) {
+    struct ui_edit_paragraph* p = &v->para[pn];
+    if (p->runs == 0) {
+        const struct ui_edit_str* str = &v->t->ps[pn];
+        const int32_t gc = str->b == 0 ? 0 : test3_word_break(v, str, 0);
+        if (gc == str->g) {
+            ui_edit_runs.begin(&v->pool, v->para, v->t->np, 1);
+            ui_edit_runs.end(&v->pool, p, 1);
+        } else {
+            ui_edit_runs.begin(&v->pool, v->para, v->t->np,
+                               1 + str->g * 8 / v->width);
+            int32_t rc = 0;
+            int32_t ix = 0;
+            const char* text = str->u;
+            int32_t bytes = str->b;
+            while (bytes > 0) {
+                int32_t glyphs = test3_word_break(v, str, ix);
+                int32_t utf8bytes = str->g2b[ix + glyphs] - str->g2b[ix];
+                if (glyphs > 1 && utf8bytes < bytes &&
+                    text[utf8bytes - 1] != 0x20) {
+                    int32_t i = utf8bytes;
+                    while (i > 0 && text[i - 1] != 0x20) { i--; }
+                    if (i > 0 && i != utf8bytes) {
+                        utf8bytes = i;
+                        glyphs = posix_str.glyphs(text, utf8bytes);
+                    }
+                }
+                ui_edit_runs.add(&v->pool, glyphs);
+                rc++;
+                text += utf8bytes;
+                bytes -= utf8bytes;
+                ix += glyphs;
+            }
+            ui_edit_runs.end(&v->pool, p, rc);
+        }
+        if (v->lines.n == v->t->np) {
+            ui_edit_lines.add(&v->lines, pn, p->runs - 1);
+        }
+    }
+    return p->runs;
+}
+
+static void test3_first_screen(struct ui_edit_doc* d, int32_t width,
+        int32_t rows) {
+    // time to the first paint of `rows` lines scrolled to the middle of
+    // the document: only visible paragraphs are wrapped (ui_edit_view
+    // wraps the rest in idle time slices) vs wrapping all of them
+    struct test3_view v = { .t = &d->text, .width = width };
+    ui_edit_advance.init(&v.a, null, test3_measure, null);
+    fp64_t time = posix_clock.seconds();
+    posix_fatal_if(posix_heap.alloc_zero((void**)&v.para,
+                   (size_t)v.t->np * sizeof(v.para[0])) != 0);
+    posix_fatal_if(!ui_edit_lines.init(&v.lines, v.t->np,
+                   test3_lines_count, &v));
+    int32_t rn = 0;
+    int32_t pn = ui_edit_lines.find(&v.lines,
+                 ui_edit_lines.sum(&v.lines, v.lines.n) / 2, &rn);
+    int32_t shown = 0;
+    int32_t wrapped = 0;
+    while (shown < rows && pn < v.t->np) {
+        const int32_t runs = test3_view_runs(&v, pn);
+        shown += runs - (rn < runs ? rn : runs - 1);
+        rn = 0;
+        wrapped++;
+        pn++;
+    }
+    const fp64_t screen = posix_clock.seconds() - time;
+    test3_report("screen", screen, 0, wrapped);
+    time = posix_clock.seconds();
+    for (pn = 0; pn < v.t->np; pn++) { (void)test3_view_runs(&v, pn); }
+    const fp64_t all = posix_clock.seconds() - time;
+    test3_report("wrap all", all, 0, v.t->np);
+    posix_println("first screen of %d lines at %d px: %d paragraphs "
+                  "%.3f ms (wrap all %.1f ms)", rows, width, wrapped,
+                  screen * 1000.0, (screen + all) * 1000.0);
+    ui_edit_lines.dispose(&v.lines);
+    ui_edit_runs.dispose(&v.pool);
+    posix_heap.free(v.para);
+    ui_edit_advance.dispose(&v.a);
+}
+
+static void test3_benchmark(const char* text, int64_t bytes, int32_t ops) {
+    posix_fatal_if(bytes >= INT32_MAX, "text is too big: %lld", bytes);
+    struct ui_edit_doc doc = {0};
+    struct ui_edit_doc* d = &doc;
+    fp64_t time = posix_clock.seconds();
+    posix_fatal_if(!ui_edit_doc.init(d, text, (int32_t)bytes, false));
+    test3_report("load", posix_clock.seconds() - time, bytes, 0);
+    posix_println("%d paragraphs", d->text.np);
+    // copy whole document into utf8 buffer:
+    time = posix_clock.seconds();
+    const int32_t utf8bytes = ui_edit_doc.utf8bytes(d, null);
+    char* utf8 = null;
+    posix_fatal_if(posix_heap.alloc((void**)&utf8, utf8bytes) != 0);
+    ui_edit_doc.copy(d, null, utf8, utf8bytes);
+    test3_report("copy", posix_clock.seconds() - time, utf8bytes, 0);
+    posix_heap.free(utf8);
+    // random typing, deletes and pastes:
+    static const char* texts[] = { "a", "b", " ", "\n", "pasted\ntext", null };
+    uint32_t seed = 0x1;
+    time = posix_clock.seconds();
+    for (int32_t i = 0; i < ops; i++) {
+        union ui_edit_range r = {0};
+        test3_random_pg(d, &seed, &r.from);
+        r.to = r.from;
+        const int32_t k = (int32_t)(posix_num.random32(&seed) % posix_countof(texts));
+        if (texts[k] == null) {
+            r.to.gp = r.to.gp < d->text.ps[r.to.pn].g ? r.to.gp + 1 : r.to.gp;
+            posix_fatal_if(!ui_edit_doc.replace(d, &r, null, 0));
+        } else {
+            posix_fatal_if(!ui_edit_doc.replace(d, &r, texts[k], -1));
+        }
+    }
+    test3_report("replace", posix_clock.seconds() - time, 0, ops);
+    posix_println("undo journal: %lld bytes %d records", d->undo.bytes,
+                  d->undo.count);
+    const int32_t records = d->undo.count;
+    time = posix_clock.seconds();
+    while (ui_edit_doc.undo(d)) { }
+    test3_report("undo", posix_clock.seconds() - time, 0, records);
+    time = posix_clock.seconds();
+    while (ui_edit_doc.redo(d)) { }
+    test3_report("redo", posix_clock.seconds() - time, 0, records);
+    struct ui_edit_find find = {0};
+    posix_fatal_if(!ui_edit_find.init(&find, d, false));
+    time = posix_clock.seconds();
+    const int32_t hits = ui_edit_find.all(&find, "dolore", -1, true, null, 0);
+    test3_report("find", posix_clock.seconds() - time, bytes, 0);
+    posix_println("%d hits", hits);
+    ui_edit_find.dispose(&find);
+    test3_jumps(d, 1000 * 1000);
+    test3_wrap(d, 64);
+    test3_first_screen(d, 480, 50);
+    ui_edit_doc.dispose(d);
+}
+
+static void test3_save(const char* text, int64_t bytes, const char* fn) {
+    posix_fatal_if(bytes >= INT32_MAX, "text is too big: %lld", bytes);
+    struct ui_edit_doc doc = {0};
+    struct ui_edit_doc* d = &doc;
+    posix_fatal_if(!ui_edit_doc.init(d, text, (int32_t)bytes, false));
+    const fp64_t mb = 1024.0 * 1024.0;
+    posix_println("peak RSS %.1f MB after load", (fp64_t)test3_peak_rss() / mb);
+    // streaming save must go first: peak RSS only grows
+    fp64_t time = posix_clock.seconds();
+    int r = ui_edit_doc.save(d, fn);
+    posix_fatal_if(r != 0, "%s %s", fn, posix_strerr(r));
+    test3_report("save", posix_clock.seconds() - time, bytes, 0);
+    posix_println("peak RSS %.1f MB after save()", (fp64_t)test3_peak_rss() / mb);
+    time = posix_clock.seconds();
+    const int32_t utf8bytes = ui_edit_doc.utf8bytes(d, null);
+    char* utf8 = null;
+    posix_fatal_if(posix_heap.alloc((void**)&utf8, utf8bytes) != 0);
+    ui_edit_doc.copy(d, null, utf8, utf8bytes);
+    int64_t transferred = 0;
+    r = posix_files.write_fully(fn, utf8, utf8bytes - 1, &transferred);
+    posix_fatal_if(r != 0, "%s %s", fn, posix_strerr(r));
+    test3_report("copy+write", posix_clock.seconds() - time, bytes, 0);
+    posix_println("peak RSS %.1f MB after copy()+write_fully()",
+                  (fp64_t)test3_peak_rss() / mb);
+    posix_heap.free(utf8);
+    posix_files.unlink(fn);
+    ui_edit_doc.dispose(d);
+}
+
+static int run(void) {
+    if (posix_args.option_bool("--help") || posix_args.option_bool("-h")) {
+        return usage();
+    }
+    const char* v = posix_args.option_str("--verbosity");
+    if (v != null) {
+        posix_debug.verbosity.level = posix_debug.verbosity_from_string(v);
+    }
+    int64_t mb  = 16;
+    int64_t ops = 10 * 1000;
+    posix_args.option_int("--mb", &mb);
+    posix_args.option_int("--ops", &ops);
+    const char* file = posix_args.option_str("--file");
+    const char* save = posix_args.option_str("--save");
+    const bool bench = posix_args.option_bool("--bench") || file != null;
+    ui_edit_str.test();
+    ui_edit_doc.test();
+    ui_edit_find.test();
+    ui_edit_advance.test();
+    ui_edit_lines.test();
+    ui_edit_runs.test();
+    posix_println("all tests passed");
+    if (save != null) {
+        const int64_t bytes = mb * 1024 * 1024;
+        char* text = test3_synthetic(bytes);
+        posix_println("synthetic %lld bytes", bytes);
+        test3_save(text, bytes, save);
+        posix_heap.free(text);
+    } else if (bench && file != null) {
+        void* data = null;
+        int64_t bytes = 0;
+        int r = posix_mem.map_ro(file, &data, &bytes);
+        posix_fatal_if(r != 0, "%s %s", file, posix_strerr(r));
+        posix_println("%s %lld bytes", file, bytes);
+        test3_benchmark((const char*)data, bytes, (int32_t)ops);
+        posix_mem.unmap(data, bytes);
+    } else if (bench) {
+        const int64_t bytes = mb * 1024 * 1024;
+        char* text = test3_synthetic(bytes);
+        posix_println("synthetic %lld bytes", bytes);
+        test3_benchmark(text, bytes, (int32_t)ops);
+        posix_heap.free(text);
+    }
+    if (bench) { test3_paragraphs(1000 * 1000, 50); }
+    return 0;
+}
+
+int main(int argc, const char* argv[], const char *envp[]) {
+    posix_args.main(argc, argv, envp);
+    int r = run();
+    posix_args.fini();
+    return r;
+}
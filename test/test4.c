@@ -0,0 +1,1558 @@
+#include "posix/posix.h"
+#include "ui/ui_glyphs.h"
+#include "ui/ui_core.h"
+#include "ui/ui_colors.h"
+#include "ui/ui_draw.h"
+#include "ui/ui_view.h"
+#include "ui/ui_nodes.h"
+#include "ui/ui_layout.h"
+#include "ui/ui_vlist.h"
+#include "ui/ui_rtree.h"
+#include "ui/ui_region.h"
+#include "ui/ui_pixels.h"
+#include "ui/ui_parallel.h"
+#include "ui/ui_resample.h"
+#include "ui/ui_mipmap.h"
+#include "ui/ui_decode.h"
+#include "ui/ui_gif.h"
+#include "ui/ui_animation.h"
+#include "ui/ui_mandelbrot.h"
+#include "ui/ui_colormap.h"
+#include "ui/ui_raster.h"
+#include <stdio.h>
+
+#define STB_IMAGE_IMPLEMENTATION // for ui_decode benchmark
+#include "stb/stb_image.h"
+
+// Headless ui_layout tests and measure()/layout() benchmark.
+// Depends only on core, trace and posix and builds on Linux:
+//
+// cc -std=gnu17 -O2 -Iinclude -Ivendor test/test4.c src/core/core.c
+//    src/trace/trace.c src/posix/posix.c src/ui/ui_layout.c
+//    src/ui/ui_vlist.c src/ui/ui_rtree.c src/ui/ui_region.c
+//    src/ui/ui_nodes.c src/ui/ui_pixels.c src/ui/ui_parallel.c
+//    src/ui/ui_resample.c src/ui/ui_mipmap.c src/ui/ui_decode.c
+//    src/ui/ui_gif.c src/ui/ui_animation.c src/ui/ui_mandelbrot.c
+//    src/ui/ui_colormap.c src/ui/ui_raster.c
+//    -lm -lpthread -o test4
+
+static int usage(void) {
+    fprintf(stderr, "Usage: %s [options]\n", posix_args.basename());
+    fprintf(stderr, "Options:\n");
+    fprintf(stderr, "  --help, -h     - this help\n");
+    fprintf(stderr, "  --views <n>    - number of views in wide tree (default 10000)\n");
+    fprintf(stderr, "  --depth <n>    - nesting depth of deep tree (default 1000)\n");
+    fprintf(stderr, "  --passes <n>   - number of single view changes (default 1000)\n");
+    fprintf(stderr, "  --items <n>    - number of ui_vlist items (default 1000000)\n");
+    fprintf(stderr, "  --hits <n>     - number of hit tests (default 1000000)\n");
+    fprintf(stderr, "  --images <dir> - *.png *.jpg to decode (default 1000 copies\n"
+                    "                   of docs/screenshots/*.png)\n");
+    fprintf(stderr, "  --scale <n>    - divide image benchmarks dimensions by n\n"
+                    "                   (default 1, CI uses 4)\n");
+    fprintf(stderr, "  --bench        - run benchmark after tests\n");
+    fprintf(stderr, "  --verbosity    - set verbosity level "
+                                "(quiet, info, verbose, debug, trace)\n");
+    return 0;
+}
+
+static struct ui_wh (*test4_text_metrics)(const struct ui_fm* fm,
+    bool multiline, int32_t w, const char* s);
+
+static int64_t test4_text_metrics_calls;
+
+static struct ui_wh test4_counting_text_metrics(const struct ui_fm* fm,
+        bool multiline, int32_t w, const char* s) {
+    test4_text_metrics_calls++;
+    return test4_text_metrics(fm, multiline, w, s);
+}
+
+struct test4_tree {
+    struct ui_view* views;
+    int32_t count;
+    int32_t n; // used
+};
+
+static struct ui_view* test4_view(struct test4_tree* t,
+        enum ui_view_type_t type, const char* text) {
+    posix_swear(t->n < t->count);
+    struct ui_view* v = &t->views[t->n++];
+    v->type = type;
+    v->fm = ui_layout.fm;
+    v->p.strid = -1; // not localized
+    posix_str.format(v->p.text, posix_countof(v->p.text), "%s", text);
+    if (type == ui_view_span || type == ui_view_list || type == ui_view_stack) {
+        ui_layout.init(v);
+        v->insets = (struct ui_margins){ 0.25f, 0.125f, 0.25f, 0.125f };
+    } else {
+        v->padding = (struct ui_margins){ 0.375f, 0.25f, 0.375f, 0.25f };
+    }
+    return v;
+}
+
+static void test4_add(struct ui_view* p, struct ui_view* c) {
+    c->parent = p;
+    if (p->child == null) {
+        c->prev = c;
+        c->next = c;
+        p->child = c;
+    } else {
+        c->prev = p->child->prev;
+        c->next = p->child;
+        c->prev->next = c;
+        c->next->prev = c;
+    }
+    ui_nodes.changed(ui_layout.nodes);
+}
+
+static void test4_set_text(struct ui_view* v, const char* text) {
+    // what ui_view.set_text() does w/o ui_app
+    posix_str.format(v->p.text, posix_countof(v->p.text), "%s", text);
+    ui_layout.dirty(v);
+}
+
+static void test4_pass(struct ui_view* root) {
+    root->x = 0;
+    root->y = 0;
+    root->w = 1920;
+    root->h = 1080;
+    ui_layout.measure(root);
+    ui_layout.layout(root);
+}
+
+static void test4_init(struct test4_tree* t, int32_t count) {
+    t->count = count;
+    t->n = 0;
+    posix_fatal_if(posix_heap.alloc_zero((void**)&t->views,
+                   count * (int64_t)sizeof(t->views[0])) != 0);
+}
+
+static void test4_run(struct test4_tree* t, const char* name,
+        struct ui_view* const leaves[], int32_t count, int32_t passes) {
+    struct ui_view* root = &t->views[0];
+    ui_layout.root = root;
+    fp64_t time = posix_clock.seconds();
+    const int32_t full = passes / 10 > 0 ? passes / 10 : 1;
+    test4_text_metrics_calls = 0;
+    for (int32_t i = 0; i < full; i++) {
+        ui_layout.dirty_all();
+        test4_pass(root);
+    }
+    time = (posix_clock.seconds() - time) / full;
+    posix_println("%-5s full:        %10.3f us per pass %lld text metrics",
+                  name, time * 1000000.0, test4_text_metrics_calls / full);
+    uint32_t seed = 0x1;
+    test4_text_metrics_calls = 0;
+    time = posix_clock.seconds();
+    for (int32_t i = 0; i < passes; i++) {
+        char text[16];
+        posix_str_printf(text, "%d", i);
+        test4_set_text(leaves[posix_num.random32(&seed) % (uint32_t)count], text);
+        test4_pass(root);
+    }
+    time = (posix_clock.seconds() - time) / passes;
+    posix_println("%-5s incremental: %10.3f us per pass %.3f text metrics",
+                  name, time * 1000000.0,
+                  (fp64_t)test4_text_metrics_calls / passes);
+    ui_layout.root = null;
+}
+
+static void test4_wide(int32_t views, int32_t passes) {
+    // list of spans of 100 labels each
+    const int32_t per_span = 100;
+    const int32_t spans = (views + per_span - 1) / per_span;
+    struct test4_tree t = {0};
+    test4_init(&t, 1 + spans * (1 + per_span));
+    struct ui_view** leaves = null;
+    posix_fatal_if(posix_heap.alloc((void**)&leaves,
+                   spans * per_span * (int64_t)sizeof(leaves[0])) != 0);
+    struct ui_view* root = test4_view(&t, ui_view_list, "root");
+    int32_t k = 0;
+    for (int32_t s = 0; s < spans; s++) {
+        struct ui_view* span = test4_view(&t, ui_view_span, "span");
+        for (int32_t i = 0; i < per_span; i++) {
+            char text[16];
+            posix_str_printf(text, "%d", k);
+            leaves[k] = test4_view(&t, ui_view_label, text);
+            test4_add(span, leaves[k++]);
+        }
+        test4_add(root, span);
+    }
+    posix_println("wide: %d views", t.n);
+    test4_run(&t, "wide", leaves, k, passes);
+    posix_heap.free(leaves);
+    posix_heap.free(t.views);
+}
+
+static void test4_deep(int32_t depth, int32_t passes) {
+    // nested spans and lists each with a label and a nested container
+    struct test4_tree t = {0};
+    test4_init(&t, 1 + depth * 2);
+    struct ui_view** leaves = null;
+    posix_fatal_if(posix_heap.alloc((void**)&leaves,
+                   depth * (int64_t)sizeof(leaves[0])) != 0);
+    struct ui_view* p = test4_view(&t, ui_view_list, "root");
+    for (int32_t d = 0; d < depth; d++) {
+        char text[16];
+        posix_str_printf(text, "%d", d);
+        leaves[d] = test4_view(&t, ui_view_label, text);
+        test4_add(p, leaves[d]);
+        if (d < depth - 1) {
+            struct ui_view* c = test4_view(&t,
+                d % 2 == 0 ? ui_view_span : ui_view_list, "nested");
+            test4_add(p, c);
+            p = c;
+        }
+    }
+    posix_println("deep: %d views depth %d", t.n, depth);
+    test4_run(&t, "deep", leaves, depth, passes);
+    posix_heap.free(leaves);
+    posix_heap.free(t.views);
+}
+
+static int64_t test4_ticks;
+
+static void test4_every_100ms(struct ui_view* posix_unused(v)) {
+    test4_ticks++;
+}
+
+static void test4_recursive_100ms(struct ui_view* v) {
+    // what ui_view.every_100ms() did before ui_nodes
+    if (v->every_100ms != null) { v->every_100ms(v); }
+    ui_view_for_each(v, c, { test4_recursive_100ms(c); });
+}
+
+static void test4_call_100ms(struct ui_view* v, void* posix_unused(that)) {
+    if (v->every_100ms != null) { v->every_100ms(v); }
+}
+
+static void test4_timers(int32_t views, int32_t ticks) {
+    // timer broadcast over the tree: recursion vs ui_nodes
+    const int32_t per_span = 100;
+    const int32_t spans = (views + per_span - 1) / per_span;
+    struct test4_tree t = {0};
+    test4_init(&t, 1 + spans * (1 + per_span));
+    struct ui_view* root = test4_view(&t, ui_view_list, "root");
+    for (int32_t s = 0; s < spans; s++) {
+        struct ui_view* span = test4_view(&t, ui_view_span, "span");
+        for (int32_t i = 0; i < per_span; i++) {
+            struct ui_view* label = test4_view(&t, ui_view_label, "label");
+            if (i % 50 == 0) { label->every_100ms = test4_every_100ms; }
+            test4_add(span, label);
+        }
+        test4_add(root, span);
+    }
+    ui_layout.root = root;
+    test4_pass(root);
+    struct ui_nodes* ns = ui_layout.nodes;
+    posix_swear(ui_nodes.index_of(ns, root) == 0 && ns->n == t.n);
+    fp64_t time = posix_clock.seconds();
+    for (int32_t i = 0; i < ticks; i++) {
+        ui_nodes.changed(ns);
+        ui_nodes.update(ns, root);
+    }
+    const fp64_t build = (posix_clock.seconds() - time) / ticks;
+    test4_ticks = 0;
+    time = posix_clock.seconds();
+    for (int32_t i = 0; i < ticks; i++) { test4_recursive_100ms(root); }
+    const fp64_t recursive = (posix_clock.seconds() - time) / ticks;
+    const int64_t expected = test4_ticks;
+    test4_ticks = 0;
+    time = posix_clock.seconds();
+    for (int32_t i = 0; i < ticks; i++) {
+        ui_nodes.for_each(ns, root, test4_call_100ms, null);
+    }
+    const fp64_t flat = (posix_clock.seconds() - time) / ticks;
+    posix_swear(test4_ticks == expected && expected == (int64_t)ticks * spans * 2);
+    posix_println("timers %d views: recursive %.3f us nodes %.3f us "
+                  "(%.2f ns per view) build %.3f us",
+                  t.n, recursive * 1000000.0, flat * 1000000.0,
+                  flat * 1000000000.0 / t.n, build * 1000000.0);
+    ui_layout.root = null;
+    ui_nodes.changed(ns);
+    posix_heap.free(t.views);
+}
+
+static void test4_pixels(int32_t w, int32_t h, int32_t reps) {
+    // GB/s of (read + written) bytes for each kernel and isa
+    const int64_t n = (int64_t)w * h;
+    uint8_t* s = null;
+    uint8_t* d = null;
+    posix_fatal_if(posix_heap.alloc((void**)&s, n * 4) != 0);
+    posix_fatal_if(posix_heap.alloc((void**)&d, n * 4) != 0);
+    uint32_t seed = 1;
+    for (int64_t i = 0; i < n * 4; i++) { s[i] = (uint8_t)posix_num.random32(&seed); }
+    const int32_t saved = ui_pixels.isa();
+    posix_println("pixels %dx%d:        rgb    rgbx   premul   gray  unpremul GB/s", w, h);
+    for (int32_t isa = ui_pixels_scalar; isa <= ui_pixels_neon; isa++) {
+        if (ui_pixels.use(isa)) {
+            fp64_t gbs[5] = {0};
+            const int64_t bytes[5] = { n * 6, n * 8, n * 8, n * 5, n * 8 };
+            for (int32_t k = 0; k < posix_countof(gbs); k++) {
+                fp64_t time = posix_clock.seconds();
+                for (int32_t r = 0; r < reps; r++) {
+                    switch (k) {
+                        case 0: ui_pixels.rgb(d, s, n); break;
+                        case 1: ui_pixels.rgbx(d, s, n, true); break;
+                        case 2: ui_pixels.premultiply(d, s, n, true); break;
+                        case 3: ui_pixels.gray(d, s, n); break;
+                        default: ui_pixels.unpremultiply(d, s, n); break;
+                    }
+                }
+                time = (posix_clock.seconds() - time) / reps;
+                gbs[k] = (fp64_t)bytes[k] / time / (1024.0 * 1024.0 * 1024.0);
+            }
+            posix_println("pixels %-8s %8.2f %7.2f %7.2f %7.2f %7.2f",
+                ui_pixels.name(isa), gbs[0], gbs[1], gbs[2], gbs[3], gbs[4]);
+        }
+    }
+    posix_swear(ui_pixels.use(saved));
+    posix_heap.free(d);
+    posix_heap.free(s);
+}
+
+static fp64_t test4_resample_ms(struct ui_bitmap* d, const struct ui_bitmap* s,
+        int32_t x, int32_t y, fp64_t scale, int32_t filter, int32_t reps,
+        int32_t threads) { // threads: 0 all
+    ui_parallel.limit(threads);
+    fp64_t time = posix_clock.seconds();
+    for (int32_t r = 0; r < reps; r++) {
+        ui_resample.scale(d, s, x, y, scale, filter);
+    }
+    time = posix_clock.seconds() - time;
+    ui_parallel.limit(0);
+    return time * 1000.0 / reps;
+}
+
+static void test4_resample(int32_t w, int32_t h, int32_t reps) {
+    // milliseconds per frame: whole image downscaled and 4K viewport
+    // of the upscaled image, kernels of each isa on one thread and the
+    // selected (best) ones on all threads
+    struct ui_bitmap s = { .w = w, .h = h, .bpp = 4, .stride = w * 4 };
+    struct ui_bitmap d = { .w = 3840, .h = 2160, .bpp = 4, .stride = 3840 * 4 };
+    posix_fatal_if(posix_heap.alloc(&s.pixels, (int64_t)s.stride * h) != 0);
+    posix_fatal_if(posix_heap.alloc(&d.pixels, (int64_t)d.stride * d.h) != 0);
+    uint32_t seed = 1;
+    uint8_t* p = (uint8_t*)s.pixels;
+    for (int32_t y = 0; y < h; y++) { // smooth gradients with noise
+        for (int32_t x = 0; x < w * 4; x++) {
+            p[(int64_t)y * s.stride + x] = (uint8_t)((x / 4 + y + x % 4 * 64) / 8 +
+                                           posix_num.random32(&seed) % 16);
+        }
+    }
+    static const fp64_t scales[] = { 0.37, 0.5, 1.7 };
+    const int32_t saved = ui_resample.isa();
+    char header[128] = "";
+    for (int32_t isa = ui_pixels_scalar; isa <= ui_pixels_neon; isa++) {
+        if (ui_resample.use(isa)) {
+            const size_t n = strlen(header);
+            snprintf(header + n, sizeof(header) - n, " %8s", ui_pixels.name(isa));
+        }
+    }
+    posix_swear(ui_resample.use(saved));
+    posix_println("resample %dx%d threads: %d%s   %s*%d ms", w, h,
+                  ui_parallel.threads(), header, ui_pixels.name(saved),
+                  ui_parallel.threads());
+    for (int32_t k = 0; k < posix_countof(scales); k++) {
+        const fp64_t scale = scales[k];
+        d.w = posix_min(3840, (int32_t)(w * scale));
+        d.h = posix_min(2160, (int32_t)(h * scale));
+        d.stride = d.w * 4;
+        const int32_t x = ((int32_t)(w * scale) - d.w) / 2;
+        const int32_t y = ((int32_t)(h * scale) - d.h) / 2;
+        for (int32_t f = ui_resample_box; f <= ui_resample_lanczos3; f++) {
+            char line[128] = "";
+            for (int32_t isa = ui_pixels_scalar; isa <= ui_pixels_neon; isa++) {
+                if (ui_resample.use(isa)) {
+                    const size_t n = strlen(line);
+                    snprintf(line + n, sizeof(line) - n, " %8.1f",
+                             test4_resample_ms(&d, &s, x, y, scale, f, reps, 1));
+                }
+            }
+            posix_swear(ui_resample.use(saved));
+            const size_t n = strlen(line);
+            snprintf(line + n, sizeof(line) - n, " %8.1f",
+                     test4_resample_ms(&d, &s, x, y, scale, f, reps, 0));
+            posix_println("resample %.2f %4dx%-4d %-8s%s", scale, d.w, d.h,
+                          ui_resample.name(f), line);
+        }
+    }
+    posix_heap.free(d.pixels);
+    posix_heap.free(s.pixels);
+}
+
+struct test4_mipmap_frame {
+    int32_t tiles;
+    int32_t missing;
+    int64_t bytes; // of tiles "uploaded" (copied)
+};
+
+static struct test4_mipmap_frame test4_mipmap_paint(struct ui_mipmap* m,
+        fp64_t scale, fp64_t cx, fp64_t cy, int32_t vw, int32_t vh,
+        uint8_t* upload) {
+    // paints vw x vh viewport centered at (cx, cy) image pixel
+    struct test4_mipmap_frame f = {0};
+    const int32_t l = ui_mipmap.level(m, scale);
+    const fp64_t k = scale * (fp64_t)(1LL << l); // level -> screen pixels
+    const fp64_t zx = cx * scale - vw / 2.0;
+    const fp64_t zy = cy * scale - vh / 2.0;
+    const int32_t x0 = posix_max(0, (int32_t)(zx / k));
+    const int32_t y0 = posix_max(0, (int32_t)(zy / k));
+    const int32_t x1 = posix_min(m->w[l], (int32_t)((zx + vw) / k) + 1);
+    const int32_t y1 = posix_min(m->h[l], (int32_t)((zy + vh) / k) + 1);
+    ui_mipmap.lock(m);
+    for (int32_t ty = y0 / ui_mipmap_tile; ty <= (y1 - 1) / ui_mipmap_tile; ty++) {
+        for (int32_t tx = x0 / ui_mipmap_tile; tx <= (x1 - 1) / ui_mipmap_tile; tx++) {
+            const struct ui_bitmap b = ui_mipmap.tile(m, l, tx, ty);
+            f.tiles++;
+            if (b.pixels == null) {
+                f.missing++;
+            } else {
+                for (int32_t y = 0; y < b.h; y++) {
+                    memcpy(upload + (int64_t)y * b.w * b.bpp,
+                           (const uint8_t*)b.pixels + (int64_t)y * b.stride,
+                           (size_t)(b.w * b.bpp));
+                }
+                f.bytes += (int64_t)b.w * b.h * b.bpp;
+            }
+        }
+    }
+    ui_mipmap.unlock(m);
+    return f;
+}
+
+static void test4_mipmap(int32_t w, int32_t h, int64_t budget) {
+    // zoom out from 1:2 to fit and pan 1920x1080 viewport over w x h
+    // image: time of frame paint on UI thread, background build
+    // latency of missing tiles and memory of cached tiles
+    const int32_t vw = 1920;
+    const int32_t vh = 1080;
+    struct ui_bitmap s = { .w = w, .h = h, .bpp = 4, .stride = w * 4 };
+    posix_fatal_if(posix_heap.alloc(&s.pixels, (int64_t)s.stride * h) != 0);
+    for (int32_t y = 0; y < h; y++) {
+        uint32_t* p = (uint32_t*)((uint8_t*)s.pixels + (int64_t)y * s.stride);
+        for (int32_t x = 0; x < w; x++) {
+            p[x] = 0xFF000000u | (uint32_t)((x ^ y) & 0xFF) << 16 |
+                   (uint32_t)(x / 64 & 0xFF) << 8 | (uint32_t)(y / 64 & 0xFF);
+        }
+    }
+    uint8_t* upload = null;
+    const int64_t tile_bytes = (int64_t)ui_mipmap_tile * ui_mipmap_tile * 4;
+    posix_fatal_if(posix_heap.alloc((void**)&upload, tile_bytes) != 0);
+    const fp64_t fit = posix_min((fp64_t)vw / w, (fp64_t)vh / h);
+    {   // full resolution pixels resampled for every frame:
+        struct ui_bitmap d = { .w = (int32_t)(w * fit), .h = (int32_t)(h * fit),
+                               .bpp = 4 };
+        d.stride = d.w * 4;
+        posix_fatal_if(posix_heap.alloc(&d.pixels, (int64_t)d.stride * d.h) != 0);
+        fp64_t time = posix_clock.seconds();
+        ui_resample.scale(&d, &s, 0, 0, fit, ui_resample_box);
+        time = posix_clock.seconds() - time;
+        posix_println("mipmap %dx%d source %.0f MB fit %.3f without "
+                      "pyramid: %.1f ms per frame", w, h,
+                      (fp64_t)s.stride * h / (1024.0 * 1024.0), fit,
+                      time * 1000.0);
+        posix_heap.free(d.pixels);
+    }
+    struct ui_mipmap m = {0};
+    ui_mipmap.init(&m, &s, budget);
+    const struct { fp64_t scale; fp64_t x; fp64_t y; } frames[] = {
+        { 0.5,   0.5, 0.5 }, { 0.25,  0.5, 0.5 }, { 0.125, 0.5, 0.5 },
+        { 0.0625, 0.5, 0.5 }, { fit,  0.5, 0.5 }, // zoom out to fit
+        { 0.25,  0.2, 0.2 }, { 0.25,  0.4, 0.2 }, { 0.25,  0.6, 0.2 },
+        { 0.25,  0.8, 0.2 }, { 0.25,  0.8, 0.8 }, // pan
+        { 0.5,   0.5, 0.5 }, { 0.3,   0.1, 0.9 }  // back and fractional
+    };
+    int64_t peak = 0;
+    fp64_t built = 0;
+    for (int32_t i = 0; i < posix_countof(frames); i++) {
+        const fp64_t scale = frames[i].scale;
+        const fp64_t cx = frames[i].x * w;
+        const fp64_t cy = frames[i].y * h;
+        fp64_t time = posix_clock.seconds();
+        const struct test4_mipmap_frame f0 =
+            test4_mipmap_paint(&m, scale, cx, cy, vw, vh, upload);
+        const fp64_t first = posix_clock.seconds() - time;
+        time = posix_clock.seconds();
+        while (!ui_mipmap.idle(&m)) { posix_thread.sleep_for(0.0005); }
+        const fp64_t build = posix_clock.seconds() - time;
+        built += build;
+        peak = posix_max(peak, m.bytes);
+        enum { repaints = 100 };
+        struct test4_mipmap_frame f = {0};
+        time = posix_clock.seconds();
+        for (int32_t r = 0; r < repaints; r++) {
+            f = test4_mipmap_paint(&m, scale, cx, cy, vw, vh, upload);
+        }
+        time = (posix_clock.seconds() - time) / repaints;
+        posix_assert(f.missing == 0 || m.budget < f.tiles * tile_bytes);
+        posix_println("mipmap %.3f level %d tiles %3d missing %3d: "
+            "frame %7.1f us build %7.1f ms cached frame %7.1f us "
+            "(%5.1f MB) cache %6.1f MB", scale, ui_mipmap.level(&m, scale),
+            f0.tiles, f0.missing, first * 1000000.0, build * 1000.0,
+            time * 1000000.0, (fp64_t)f.bytes / (1024.0 * 1024.0),
+            (fp64_t)m.bytes / (1024.0 * 1024.0));
+    }
+    posix_println("mipmap built %lld evicted %lld hits %lld misses %lld "
+                  "build %.1f s peak cache %.1f MB of %.1f MB budget",
+                  m.stats.built, m.stats.evicted, m.stats.hits,
+                  m.stats.misses, built, (fp64_t)peak / (1024.0 * 1024.0),
+                  (fp64_t)budget / (1024.0 * 1024.0));
+    ui_mipmap.dispose(&m);
+    posix_heap.free(upload);
+    posix_heap.free(s.pixels);
+}
+
+static bool test4_stbi_info(const void* data, int64_t bytes,
+        int32_t* w, int32_t* h, int32_t* bpp) {
+    return stbi_info_from_memory((const stbi_uc*)data, (int)bytes,
+                                 w, h, bpp) != 0;
+}
+
+static void* test4_stbi_decode(const void* data, int64_t bytes,
+        int32_t* w, int32_t* h, int32_t* bpp, int32_t preferred) {
+    return stbi_load_from_memory((const stbi_uc*)data, (int)bytes,
+                                 w, h, bpp, preferred);
+}
+
+static void test4_stbi_dispose(void* pixels) { stbi_image_free(pixels); }
+
+static bool test4_is_image(const char* name) {
+    return posix_str.iends(name, ".png") || posix_str.iends(name, ".jpg") ||
+           posix_str.iends(name, ".jpeg");
+}
+
+static int32_t test4_list(const char* folder,
+        char (*names)[posix_files_max_path], int32_t count) {
+    int32_t n = 0;
+    struct posix_folder f = {0};
+    if (posix_files.opendir(&f, folder) == 0) {
+        const char* name = posix_files.readdir(&f, null);
+        while (name != null && n < count) {
+            if (test4_is_image(name)) {
+                snprintf(names[n], posix_countof(names[n]), "%s/%s",
+                         folder, name);
+                n++;
+            }
+            name = posix_files.readdir(&f, null);
+        }
+        posix_files.closedir(&f);
+    }
+    return n;
+}
+
+static char (*test4_decode_names)[posix_files_max_path];
+
+static struct {
+    volatile int32_t done;
+    int32_t failed;
+    int32_t previews;
+    int64_t pixels; // bytes
+    fp64_t  first;  // seconds to first decoded image
+    fp64_t  start;
+    struct posix_work_queue queue; // stands for UI thread queue
+} test4_decoded;
+
+static void test4_decode_post(struct posix_work* w) {
+    w->queue = &test4_decoded.queue;
+    posix_work_queue.post(w);
+}
+
+static void test4_decode_preview(struct posix_work* w) {
+    struct ui_decode_image* di = (struct ui_decode_image*)w->data;
+    posix_swear(di->thumbnail.pixels != null);
+    test4_decoded.previews++;
+}
+
+static void test4_decode_done(struct posix_work* w) {
+    struct ui_decode_image* di = (struct ui_decode_image*)w->data;
+    if (test4_decoded.done == 0) {
+        test4_decoded.first = posix_clock.seconds() - test4_decoded.start;
+    }
+    if (di->error != 0) {
+        test4_decoded.failed++;
+    } else {
+        test4_decoded.pixels += (int64_t)di->image.h * di->image.stride;
+    }
+    ui_decode.release(di);
+    test4_decoded.done++;
+}
+
+static void test4_decode_async(int32_t n, int32_t threads, int64_t budget,
+        fp64_t sequential) {
+    struct ui_decode_image* di = null;
+    posix_fatal_if(posix_heap.alloc_zero((void**)&di,
+                   n * (int64_t)sizeof(di[0])) != 0);
+    ui_decode.threads = threads;
+    ui_decode.budget = budget;
+    memset(&test4_decoded, 0x00, sizeof(test4_decoded));
+    test4_decoded.queue.changed = posix_event.create();
+    test4_decoded.start = posix_clock.seconds();
+    for (int32_t i = 0; i < n; i++) {
+        di[i].filename = test4_decode_names[i];
+        di[i].bpp = 4;
+        di[i].post = test4_decode_post;
+        di[i].preview = (struct posix_work){
+            .work = test4_decode_preview, .data = &di[i] };
+        di[i].done = (struct posix_work){
+            .work = test4_decode_done, .data = &di[i] };
+        ui_decode.decode(&di[i]);
+    }
+    while (test4_decoded.done < n) { // UI thread message loop
+        posix_work_queue.dispatch(&test4_decoded.queue);
+        posix_event.wait_or_timeout(test4_decoded.queue.changed, 0.001);
+    }
+    const fp64_t time = posix_clock.seconds() - test4_decoded.start;
+    posix_println("decode %d files %d threads budget %5.1f MB: %6.1f ms "
+                  "(%6.1f files/s %5.2fx) first %5.1f ms previews %d "
+                  "failed %d peak %5.1f MB", n, ui_decode.threads > 0 ?
+                  ui_decode.threads : ui_parallel.cores(),
+                  (fp64_t)budget / (1024.0 * 1024.0), time * 1000.0, n / time,
+                  sequential / time, test4_decoded.first * 1000.0,
+                  test4_decoded.previews, test4_decoded.failed,
+                  (fp64_t)ui_decode.peak() / (1024.0 * 1024.0));
+    posix_assert(ui_decode.bytes() == 0);
+    ui_decode.dispose();
+    posix_event.dispose(test4_decoded.queue.changed);
+    posix_heap.free(di);
+}
+
+static void test4_decode(const char* folder, int32_t files) {
+    // decode all images of the folder sequentially on one thread and
+    // with ui_decode worker pool posting results to the "UI" queue.
+    // Without --images <dir> the folder is populated with copies of
+    // docs/screenshots/*.png (run from the root of repository)
+    char tmp[posix_files_max_path] = {0};
+    int32_t n = 0;
+    posix_fatal_if(posix_heap.alloc((void**)&test4_decode_names,
+                   files * (int64_t)sizeof(test4_decode_names[0])) != 0);
+    if (folder == null) {
+        n = test4_list("docs/screenshots", test4_decode_names, files);
+        const int k = snprintf(tmp, posix_countof(tmp), "%s/test4_decode",
+                               posix_files.tmp());
+        posix_fatal_if(k < 0 || k >= posix_countof(tmp), "\"%s\" too long",
+                       posix_files.tmp());
+        posix_files.rmdirs(tmp);
+        posix_fatal_if(posix_files.mkdirs(tmp) != 0);
+        for (int32_t i = 0; i < files && n > 0; i++) {
+            char fn[posix_files_max_path];
+            const char* from = test4_decode_names[i % n];
+            const int m = snprintf(fn, posix_countof(fn), "%s/%04d%s",
+                                   tmp, i, strrchr(from, '.'));
+            // truncated name would copy over some other file
+            posix_fatal_if(m < 0 || m >= posix_countof(fn),
+                           "\"%s/%04d%s\" too long", tmp, i,
+                           strrchr(from, '.'));
+            posix_fatal_if(posix_files.copy(from, fn) != 0);
+        }
+        folder = tmp;
+    }
+    n = test4_list(folder, test4_decode_names, files);
+    if (n == 0) {
+        posix_println("decode: no images in \"%s\"", folder);
+    } else {
+        int64_t pixels = 0;
+        int64_t encoded = 0;
+        fp64_t time = posix_clock.seconds();
+        for (int32_t i = 0; i < n; i++) {
+            void* data = null;
+            int64_t bytes = 0;
+            posix_fatal_if(posix_mem.map_ro(test4_decode_names[i],
+                           &data, &bytes) != 0);
+            int32_t w = 0;
+            int32_t h = 0;
+            int32_t bpp = 0;
+            void* p = test4_stbi_decode(data, bytes, &w, &h, &bpp, 4);
+            if (p != null) { pixels += (int64_t)w * h * 4; }
+            test4_stbi_dispose(p);
+            posix_mem.unmap(data, bytes);
+            encoded += bytes;
+        }
+        time = posix_clock.seconds() - time;
+        posix_println("decode %d files %.1f MB -> %.1f MB sequential: "
+                      "%6.1f ms (%6.1f files/s)", n,
+                      (fp64_t)encoded / (1024.0 * 1024.0),
+                      (fp64_t)pixels / (1024.0 * 1024.0),
+                      time * 1000.0, n / time);
+        const struct ui_decode_codec codec = ui_decode.codec;
+        ui_decode.codec = (struct ui_decode_codec){
+            .info    = test4_stbi_info,
+            .decode  = test4_stbi_decode,
+            .dispose = test4_stbi_dispose
+        };
+        const int64_t mb = 1024 * 1024;
+        test4_decode_async(n, 0, 256 * mb, time);
+        test4_decode_async(n, 0, 8 * mb, time);
+        if (ui_parallel.cores() < 4) { // oversubscribed: I/O overlap
+            test4_decode_async(n, 4, 256 * mb, time);
+        }
+        ui_decode.codec = codec;
+        ui_decode.threads = 0;
+        ui_decode.budget = 256 * mb;
+    }
+    if (tmp[0] != 0) { posix_files.rmdirs(tmp); }
+    posix_heap.free(test4_decode_names);
+}
+
+static void test4_gif(const char* filename) {
+    // fully decoded animation (stb_image) versus ui_gif streaming
+    // decoder and ui_animation ring of 3 frames: memory and decode
+    // time per second of animation
+    void* data = null;
+    int64_t bytes = 0;
+    if (posix_mem.map_ro(filename, &data, &bytes) != 0) {
+        posix_println("gif: \"%s\" not found", filename);
+    } else {
+        int32_t* delays = null;
+        int32_t w = 0;
+        int32_t h = 0;
+        int32_t frames = 0;
+        int32_t bpp = 0;
+        fp64_t time = posix_clock.seconds();
+        uint8_t* pixels = stbi_load_gif_from_memory((const stbi_uc*)data,
+            (int)bytes, &delays, &w, &h, &frames, &bpp, 4);
+        const fp64_t full = posix_clock.seconds() - time;
+        posix_swear(pixels != null && frames > 0);
+        const int64_t frame_bytes = (int64_t)w * h * 4;
+        struct ui_gif g = {0};
+        posix_swear(ui_gif.init(&g, data, bytes) == 0);
+        fp64_t decode = 0;
+        fp64_t played = 0;
+        bool compare = true; // stb_image restores disposal 2 differently
+        for (int32_t i = 0; i < frames; i++) {
+            time = posix_clock.seconds();
+            posix_swear(ui_gif.next(&g) == 0 && g.index == i);
+            decode += posix_clock.seconds() - time;
+            played += g.delay / 1000.0;
+            compare = compare && (i == 0 || g.disposal < 2);
+            if (compare) {
+                posix_swear(memcmp(g.canvas, pixels + i * frame_bytes,
+                                   (size_t)frame_bytes) == 0,
+                            "%s frame %d differs", filename, i);
+            }
+        }
+        posix_swear(ui_gif.next(&g) == 0 && g.index == 0 && g.frames == frames);
+        const int64_t streaming = ui_gif.memory(&g);
+        ui_gif.dispose(&g);
+        struct ui_animation a = {0};
+        posix_swear(ui_animation.init(&a, data, bytes, 3) == 0);
+        fp64_t now = 0;
+        int64_t peak = 0;
+        for (int32_t i = 0; i < frames * 2; i++) { // virtual time
+            while (posix_atomics.load32(&a.ready) == 0) {
+                posix_thread.sleep_for(0.0001);
+            }
+            now = ui_animation.advance(&a, now);
+            peak = posix_max(peak, ui_animation.memory(&a));
+        }
+        ui_animation.dispose(&a);
+        const fp64_t mb = 1024.0 * 1024.0;
+        posix_println("gif %s %dx%d %d frames %.1f s: fully decoded "
+                      "%6.1f MB %6.1f ms", posix_files.basename(filename),
+                      w, h, frames, played,
+                      (fp64_t)(frame_bytes * frames + frames * 4) / mb,
+                      full * 1000.0);
+        posix_println("gif %s streaming %.2f MB ring of 3: %.2f MB "
+                      "decode %5.1f ms per second of animation (%.1f%% "
+                      "of one core)%s", posix_files.basename(filename),
+                      (fp64_t)streaming / mb, (fp64_t)peak / mb,
+                      decode * 1000.0 / played, decode * 100.0 / played,
+                      compare ? " same as stb_image" : "");
+        stbi_image_free(pixels);
+        stbi_image_free(delays);
+        posix_mem.unmap(data, bytes);
+    }
+}
+
+static void test4_mandelbrot(int32_t w, int32_t h) {
+    // megapixels/s at several zoom depths: plain escape() per pixel
+    // (like samples/fractal.c did), each isa kernel on one thread and
+    // the best isa on all threads
+    int32_t* counts = null;
+    posix_fatal_if(posix_heap.alloc((void**)&counts,
+                   (int64_t)w * h * (int64_t)sizeof(int32_t)) != 0);
+    static const struct { fp64_t x; fp64_t y; fp64_t size; int32_t n; } v[] = {
+        { -0.75,              0.0,               3.0,   256 },
+        { -0.745,             0.113,             1e-2,  1000 },
+        { -0.743643887037151, 0.131825904205330, 1e-6,  1000 },
+        { -0.743643887037151, 0.131825904205330, 1e-11, 2000 }
+    };
+    const int32_t saved = ui_mandelbrot.isa();
+    posix_println("mandelbrot %dx%d: zoom iterations   plain  scalar    sse2"
+                  "    avx2    neon    *%d Mpixels/s", w, h,
+                  ui_parallel.threads());
+    for (int32_t k = 0; k < posix_countof(v); k++) {
+        struct ui_mandelbrot m = {
+            .x = v[k].x - v[k].size / 2, .y = v[k].y - v[k].size * h / w / 2,
+            .dx = v[k].size / w, .dy = v[k].size / w, .w = w, .h = h,
+            .iterations = v[k].n, .counts = counts, .stride = w
+        };
+        fp64_t time = posix_clock.seconds();
+        for (int32_t j = 0; j < h; j++) {
+            for (int32_t i = 0; i < w; i++) {
+                counts[j * w + i] = ui_mandelbrot.escape(m.x + i * m.dx,
+                    m.y + j * m.dy, m.iterations);
+            }
+        }
+        const fp64_t plain = (fp64_t)w * h / (posix_clock.seconds() - time) /
+                             (1000.0 * 1000.0);
+        fp64_t mps[5] = {0};
+        for (int32_t isa = ui_pixels_scalar; isa <= ui_pixels_neon + 1; isa++) {
+            const bool all = isa > ui_pixels_neon; // best isa on all threads
+            if (all ? ui_mandelbrot.use(saved) : ui_mandelbrot.use(isa)) {
+                ui_parallel.limit(all ? 0 : 1);
+                time = posix_clock.seconds();
+                ui_mandelbrot.render(&m);
+                time = posix_clock.seconds() - time;
+                mps[isa] = (fp64_t)w * h / time / (1000.0 * 1000.0);
+            }
+        }
+        ui_parallel.limit(0);
+        posix_println("mandelbrot %8.0e %10d %7.2f %7.2f %7.2f %7.2f %7.2f %7.2f",
+            v[k].size / 3.0, v[k].n, plain, mps[0], mps[1], mps[2], mps[3],
+            mps[4]);
+    }
+    posix_swear(ui_mandelbrot.use(saved));
+    posix_heap.free(counts);
+}
+
+static void test4_mandelbrot_deep(int32_t w, int32_t h) {
+    // deep() milliseconds per frame on all threads at zoom depths far
+    // beyond fp64 (pixel size ~1e-13): reference orbit in fixed point,
+    // iterations skipped by series approximation, perturbation per pixel;
+    // differ: % of pixels where fp64 render() is off by more than 2
+    int32_t* counts = null;
+    posix_fatal_if(posix_heap.alloc((void**)&counts,
+                   (int64_t)w * h * (int64_t)sizeof(int32_t)) != 0);
+    int32_t* rendered = null;
+    posix_fatal_if(posix_heap.alloc((void**)&rendered,
+                   (int64_t)w * h * (int64_t)sizeof(int32_t)) != 0);
+    static const struct { fp64_t x; fp64_t y; fp64_t size; int32_t n; } v[] = {
+        { -0.743643887037151, 0.131825904205330, 1e-6,   1000 },
+        { -0.743643887037151, 0.131825904205330, 1e-9,   3000 },
+        { -0.743643887037151, 0.131825904205330, 1e-11,  2000 },
+        { -0.743643887037151, 0.131825904205330, 1e-12,  3000 },
+        { 0.0,                1.0,               1e-20,  4000 },
+        { 0.0,                1.0,               1e-50,  4000 },
+        { 0.0,                1.0,               1e-100, 4000 },
+        { 0.0,                1.0,               1e-120, 4000 },
+        { -2.0,               0.0,               1e-60,  4000 },
+        { -2.0,               0.0,               1e-120, 4000 }
+    };
+    posix_println("mandelbrot deep %dx%d: zoom iterations reference series"
+                  "  render ms   deep ms Mpixels/s differ", w, h);
+    struct ui_mandelbrot m = { .w = w, .h = h, .counts = counts, .stride = w };
+    for (int32_t k = 0; k < posix_countof(v); k++) {
+        m.dx = v[k].size / w;
+        m.dy = v[k].size / w;
+        m.iterations = v[k].n;
+        // c = i and c = -2 are Misiurewicz points: view next to them
+        const bool misiurewicz = v[k].size < 1e-13;
+        ui_mandelbrot.fixed(&m.deep.cx, v[k].x);
+        ui_mandelbrot.fixed(&m.deep.cy, v[k].y);
+        if (misiurewicz) {
+            ui_mandelbrot.add(&m.deep.cx, (v[k].x < 0 ? 1.5 : 0.37) * v[k].size);
+            ui_mandelbrot.add(&m.deep.cy, 0.21 * v[k].size);
+        }
+        fp64_t render = 0;
+        if (!misiurewicz) { // fp64 render() of the same view
+            m.x = v[k].x - (w / 2) * m.dx;
+            m.y = v[k].y - (h / 2) * m.dy;
+            render = posix_clock.seconds();
+            ui_mandelbrot.render(&m);
+            render = posix_clock.seconds() - render;
+            memcpy(rendered, counts, (size_t)w * h * sizeof(int32_t));
+        }
+        fp64_t time = posix_clock.seconds();
+        posix_fatal_if(ui_mandelbrot.deep(&m) != 0);
+        time = posix_clock.seconds() - time;
+        int64_t differ = 0;
+        if (!misiurewicz) {
+            for (int32_t i = 0; i < w * h; i++) {
+                differ += abs(rendered[i] - counts[i]) > 2;
+            }
+        }
+        posix_println("mandelbrot deep %8.0e %10d %9d %6d %10.2f %9.2f %9.2f %5.1f%%",
+            v[k].size / 3.0, v[k].n, m.deep.n, m.deep.skip, render * 1000,
+            time * 1000, (fp64_t)w * h / time / (1000.0 * 1000.0),
+            differ * 100.0 / ((fp64_t)w * h));
+    }
+    ui_mandelbrot.dispose(&m);
+    posix_heap.free(rendered);
+    posix_heap.free(counts);
+}
+
+static void test4_mandelbrot_cache(int32_t w, int32_t h) {
+    // interactions of samples/mandelbrot.c: update() with .cache of the
+    // previous view against update() from scratch (computed pixels, ms)
+    int32_t* counts = null;
+    posix_fatal_if(posix_heap.alloc((void**)&counts,
+                   (int64_t)w * h * (int64_t)sizeof(int32_t)) != 0);
+    // x, y in 1/1024 of the view so that --scale keeps zoom points
+    // inside the view (and pans overlapping)
+    static const struct {
+        const char* name;
+        int32_t x; int32_t y; // pan by or zoom at x * w / 1024, y * h / 1024
+        int32_t zoom;         // +1 zoom in, -1 zoom out, 0 pan
+    } a[] = {
+        { "pan right 1/8",  128,    0,  0 },
+        { "pan down 1/32",    0,   32,  0 },
+        { "pan 1/256",        4,   -4,  0 },
+        { "zoom in",        700,  300, +1 },
+        { "zoom in",        321,  600, +1 },
+        { "zoom out",       321,  600, -1 },
+        { "zoom in center", 512,  512, +1 }
+    };
+    struct ui_mandelbrot m = { .w = w, .h = h, .counts = counts, .stride = w };
+    fp64_t zoom = 0;
+    posix_println("mandelbrot update %dx%d: interaction  iterations "
+                  "computed%%  cached ms    full ms", w, h);
+    // pass 0: render() with iterations of the sample (grow with zoom),
+    // pass 1: render() with fixed iterations, pass 2: deep() pixels
+    for (int32_t pass = 0; pass < 3; pass++) {
+        if (pass < 2) {
+            zoom = 1.0 / 64;
+            ui_mandelbrot.fixed(&m.deep.cx, -0.745);
+            ui_mandelbrot.fixed(&m.deep.cy, 0.113);
+        } else {
+            zoom = 1e-30;
+            ui_mandelbrot.fixed(&m.deep.cx, 3.7e-31);
+            ui_mandelbrot.fixed(&m.deep.cy, 1.0);
+        }
+        m.cache.w = 0;
+        for (int32_t k = -1; k < posix_countof(a); k++) {
+            const int32_t x = k < 0 ? 0 : a[k].x * w / 1024;
+            const int32_t y = k < 0 ? 0 : a[k].y * h / 1024;
+            if (k >= 0 && a[k].zoom == 0) {
+                ui_mandelbrot.add(&m.deep.cx, x * m.dx);
+                ui_mandelbrot.add(&m.deep.cy, y * m.dy);
+            } else if (k >= 0) { // keep complex point of pixel x, y
+                const fp64_t f = a[k].zoom > 0 ? 0.5 : -1.0;
+                ui_mandelbrot.add(&m.deep.cx, (x - w / 2) * m.dx * f);
+                ui_mandelbrot.add(&m.deep.cy, (y - h / 2) * m.dy * f);
+                zoom = a[k].zoom > 0 ? zoom / 2 : zoom * 2;
+            }
+            m.dx = zoom * 2.47 / w;
+            m.dy = zoom * 2.24 / h;
+            // like the sample: deeper views need more iterations
+            m.iterations = pass == 1 ?
+                1000 : 100 + 20 * (int32_t)(-log2(zoom));
+            fp64_t cached = posix_clock.seconds();
+            posix_fatal_if(ui_mandelbrot.update(&m) != 0);
+            cached = posix_clock.seconds() - cached;
+            const int64_t computed = m.cache.computed;
+            struct ui_mandelbrot full = {
+                .dx = m.dx, .dy = m.dy, .w = w, .h = h,
+                .iterations = m.iterations, .counts = counts, .stride = w
+            };
+            full.deep.cx = m.deep.cx;
+            full.deep.cy = m.deep.cy;
+            fp64_t time = posix_clock.seconds();
+            posix_fatal_if(ui_mandelbrot.update(&full) != 0);
+            time = posix_clock.seconds() - time;
+            ui_mandelbrot.dispose(&full);
+            posix_println("mandelbrot update %8.0e %-15s %5d %9.1f "
+                "%10.2f %10.2f", m.dx, k < 0 ? "first" : a[k].name,
+                m.iterations, computed * 100.0 / ((int64_t)w * h),
+                cached * 1000,
+                time * 1000);
+        }
+    }
+    ui_mandelbrot.dispose(&m);
+    posix_heap.free(counts);
+}
+
+static void test4_colormap(int32_t n, int32_t reps) {
+    // Mpixels/s of each kernel and isa (to_linear() and to_srgb() of
+    // 4 channels per pixel, scalar kernels on SSE2 and NEON) and
+    // microseconds per colormap
+    uint32_t* c = null;
+    uint32_t* d = null;
+    fp32_t* f = null; // h, s, i planes or 4 linear channels per pixel
+    posix_fatal_if(posix_heap.alloc((void**)&c, (int64_t)n * 4) != 0);
+    posix_fatal_if(posix_heap.alloc((void**)&d, (int64_t)n * 4) != 0);
+    posix_fatal_if(posix_heap.alloc((void**)&f, (int64_t)n * 4 * 4) != 0);
+    uint32_t seed = 1;
+    for (int32_t i = 0; i < n; i++) { c[i] = posix_num.random32(&seed); }
+    fp32_t* h = f;
+    fp32_t* s = f + n;
+    fp32_t* v = f + n * 2;
+    const int32_t saved = ui_colormap.isa();
+    posix_println("colormap %d:     to_hsi  to_hsv  to_rgb  linear    srgb"
+                  "  interpolate Mpixels/s", n);
+    for (int32_t isa = ui_pixels_scalar; isa <= ui_pixels_neon; isa++) {
+        if (ui_colormap.use(isa)) {
+            fp64_t mps[6] = {0};
+            for (int32_t k = 0; k < posix_countof(mps); k++) {
+                if (k == 5) { // t in [0..1] for interpolate()
+                    for (int32_t i = 0; i < n; i++) {
+                        v[i] = (fp32_t)(i % 1001) / 1000.0f;
+                    }
+                }
+                fp64_t time = posix_clock.seconds();
+                for (int32_t r = 0; r < reps; r++) {
+                    switch (k) {
+                        case 0: ui_colormap.rgb_to_hsi(c, h, s, v, n); break;
+                        case 1: ui_colormap.rgb_to_hsv(c, h, s, v, n); break;
+                        case 2: ui_colormap.hsi_to_rgb(d, h, s, v, 0xFF, n); break;
+                        case 3: ui_colormap.to_linear(f, (uint8_t*)c, (int64_t)n * 4); break;
+                        case 4: ui_colormap.to_srgb((uint8_t*)d, f, (int64_t)n * 4); break;
+                        default: ui_colormap.interpolate(d, c, d, v, n); break;
+                    }
+                }
+                time = (posix_clock.seconds() - time) / reps;
+                mps[k] = n / time / (1000.0 * 1000.0);
+            }
+            posix_println("colormap %-8s %7.1f %7.1f %7.1f %7.1f %7.1f %10.1f",
+                ui_pixels.name(isa), mps[0], mps[1], mps[2], mps[3], mps[4],
+                mps[5]);
+        }
+    }
+    posix_swear(ui_colormap.use(saved));
+    // samples/fractal.c palette as cyclic gradients:
+    static const uint32_t stops[17] = {
+        0xFF0F1E42, 0xFF1A0719, 0xFF2F0109, 0xFF490404, 0xFF640700, 0xFF8A2C0C,
+        0xFFB15218, 0xFFD17D39, 0xFFE5B586, 0xFFF8ECD3, 0xFFBFE9F1, 0xFF5FC9F8,
+        0xFF00AAFF, 0xFF0080CC, 0xFF005799, 0xFF03346A, 0xFF0F1E42
+    };
+    static const char* spaces[] = { "srgb", "linear", "hsv" };
+    for (int32_t space = ui_colormap_srgb; space <= ui_colormap_hsv; space++) {
+        fp64_t us[2] = {0};
+        for (int32_t k = 0; k < posix_countof(us); k++) {
+            const int32_t entries = k == 0 ? 256 : 4096;
+            fp64_t time = posix_clock.seconds();
+            for (int32_t r = 0; r < reps * 10; r++) {
+                ui_colormap.gradient(d, entries, stops, null,
+                                     posix_countof(stops), space);
+            }
+            us[k] = (posix_clock.seconds() - time) / (reps * 10) * 1000 * 1000;
+        }
+        posix_println("colormap gradient %-6s 256: %7.1f 4096: %7.1f us",
+                      spaces[space], us[0], us[1]);
+    }
+    posix_heap.free(f);
+    posix_heap.free(d);
+    posix_heap.free(c);
+}
+
+static void test4_raster_text(struct ui_raster* r, int32_t x, int32_t y,
+        const char* text, ui_color_t c) {
+    // no font engine headless: synthetic 8x16 glyph coverage of each
+    // character (as ui_draw.text() produces with GDI on Windows)
+    static uint8_t coverage[16][128 * 8];
+    const int32_t n = posix_min((int32_t)strlen(text), 128);
+    const int32_t w = n * 8;
+    for (int32_t j = 0; j < 16; j++) {
+        for (int32_t i = 0; i < w; i++) {
+            const uint8_t ch = (uint8_t)text[i / 8];
+            const int32_t gx = i % 8;
+            const bool ink = ch > 0x20 && 1 <= gx && gx <= 6 && 3 <= j &&
+                             j <= 12 && ((ch >> (gx + j) % 7) & 1) != 0;
+            const bool edge = gx == 1 || gx == 6 || j == 3 || j == 12;
+            coverage[j][i] = ink ? (edge ? 0x60 : 0xFF) : 0;
+        }
+    }
+    ui_raster.mask(r, x, y, w, 16, &coverage[0][0], posix_countof(coverage[0]), c);
+}
+
+static void test4_raster_paint(struct ui_raster* r, const struct ui_view* v,
+        const struct ui_view* hover) {
+    // replay of ui_view.paint() of samples/layout.c views
+    const ui_color_t window = ui_color_rgb(0x1E, 0x1E, 0x1E);
+    const ui_color_t green  = ui_color_rgba(0x3C, 0xB0, 0x43, 0xA0);
+    const ui_color_t orange = ui_color_rgba(0xFF, 0x8C, 0x00, 0xA0);
+    const ui_color_t onyx   = ui_color_rgb(0x35, 0x38, 0x39);
+    const ui_color_t text   = ui_color_rgb(0xDD, 0xDD, 0xDD);
+    const ui_color_t red    = ui_color_rgb(0xFF, 0x00, 0x00);
+    const int32_t tx = v->x + v->text.xy.x;
+    const int32_t ty = v->y + v->text.xy.y;
+    const bool container = v->type == ui_view_span ||
+        v->type == ui_view_list || v->type == ui_view_stack;
+    if (v->type == ui_view_stack) {
+        ui_raster.fill(r, v->x, v->y, v->w, v->h, window);
+    }
+    if (v->type == ui_view_button) {
+        const int32_t radius = posix_max(3, v->fm->em.h / 4) | 1; // odd
+        if (v == hover) { // flat button on hover
+            ui_raster.gradient(r, v->x, v->y, v->w, v->h,
+                ui_color_rgb(0x50, 0x50, 0x58), ui_color_rgb(0x30, 0x30, 0x34),
+                true);
+        } else {
+            ui_raster.rounded(r, v->x, v->y, v->w, v->h, radius,
+                              ui_color_rgb(0x60, 0x60, 0x60),
+                              ui_color_rgb(0x2B, 0x2B, 0x2B));
+        }
+        test4_raster_text(r, tx, ty, v->p.text, text);
+    } else if (v->type == ui_view_label) {
+        if (v == hover) {
+            ui_raster.rounded(r, v->x, v->y, v->w, v->h, 5,
+                              ui_color_rgb(0x80, 0x80, 0x80),
+                              ui_color_transparent);
+        }
+        test4_raster_text(r, tx, ty, v->p.text, onyx);
+    }
+    if (v->debug.paint.margins) {
+        const struct ui_ltrb p = ui_layout.margins(v, &v->padding);
+        const struct ui_ltrb i = ui_layout.margins(v, &v->insets);
+        ui_raster.frame(r, v->x - p.left, v->y - p.top,
+            v->w + p.left + p.right, v->h + p.top + p.bottom, green);
+        ui_raster.frame(r, v->x + i.left, v->y + i.top,
+            v->w - i.left - i.right, v->h - i.top - i.bottom, orange);
+        if (container) {
+            test4_raster_text(r, v->x + i.left, v->y + i.top,
+                              v->p.text, red);
+        }
+    }
+    const struct ui_view* c = v->child;
+    if (c != null) {
+        do {
+            test4_raster_paint(r, c, hover);
+            c = c->next;
+        } while (c != v->child);
+    }
+}
+
+static void test4_raster(int32_t w, int32_t h, int32_t frames) {
+    // samples/layout.c stack test laid out headless, painted into the
+    // display list once and rendered by each isa on 1 and all threads
+    static const struct { const char* text; int32_t align; } labels[] = {
+        { " left ",         ui_align_left                    },
+        { " right ",        ui_align_right                   },
+        { " top ",          ui_align_top                     },
+        { " bottom ",       ui_align_bottom                  },
+        { " left|top ",     ui_align_left  | ui_align_top    },
+        { " right|bottom ", ui_align_right | ui_align_bottom },
+        { " right|top ",    ui_align_right | ui_align_top    },
+        { " left|bottom ",  ui_align_left  | ui_align_bottom },
+        { " center ",       ui_align_center                  }
+    };
+    static const char* buttons[] = {
+        "Stack", "Span", "List", "Controls", "Edit 1"
+    };
+    struct test4_tree t = {0};
+    test4_init(&t, 4 + posix_countof(buttons) + posix_countof(labels));
+    struct ui_view* root = test4_view(&t, ui_view_list, "#root");
+    struct ui_view* span = test4_view(&t, ui_view_span, "#span");
+    struct ui_view* tools = test4_view(&t, ui_view_list, "#tools");
+    struct ui_view* stack = test4_view(&t, ui_view_stack, "#stack");
+    for (int32_t i = 0; i < posix_countof(buttons); i++) {
+        struct ui_view* b = test4_view(&t, ui_view_button, buttons[i]);
+        b->min_w_em = 4.25f;
+        test4_add(tools, b);
+    }
+    stack->insets = (struct ui_margins){ 1.0f, 0.5f, 0.25f, 2.0f };
+    stack->max_w = ui_infinity;
+    stack->max_h = ui_infinity;
+    stack->debug.paint.margins = true;
+    for (int32_t i = 0; i < posix_countof(labels); i++) {
+        struct ui_view* v = test4_view(&t, ui_view_label, labels[i].text);
+        v->align = labels[i].align;
+        v->padding = (struct ui_margins){ 2.0f, 0.25f, 0.5f, 1.0f };
+        v->debug.paint.margins = true;
+        test4_add(stack, v);
+    }
+    span->max_w = ui_infinity;
+    span->max_h = ui_infinity;
+    root->max_w = ui_infinity;
+    root->max_h = ui_infinity;
+    test4_add(span, tools);
+    test4_add(span, stack);
+    test4_add(root, span);
+    ui_layout.root = root;
+    test4_pass(root);
+    uint32_t* pixels = null;
+    posix_fatal_if(posix_heap.alloc((void**)&pixels, (int64_t)w * h * 4) != 0);
+    struct ui_bitmap b = { .pixels = pixels, .w = w, .h = h, .bpp = 4,
+                           .stride = w * 4 };
+    struct ui_raster r = {0};
+    ui_raster.begin(&r, &b);
+    ui_raster.fill(&r, 0, 0, w, h, ui_color_rgb(0x20, 0x20, 0x20));
+    test4_raster_paint(&r, root, stack->child->next); // hover "right"
+    test4_raster_paint(&r, root, tools->child->next); // hover "Span"
+    for (int32_t i = 0; i < 2; i++) { // app window frame
+        ui_raster.frame(&r, i, i, w - i * 2, h - i * 2,
+                        ui_color_rgb(0x40, 0x40, 0x40));
+    }
+    posix_fatal_if(ui_raster.end(&r) != 0);
+    const int32_t saved = ui_raster.isa();
+    posix_println("raster %dx%d %d commands ms per frame", w, h, r.count);
+    posix_println("raster isa       1 thread %2d threads", ui_parallel.threads());
+    for (int32_t isa = ui_pixels_scalar; isa <= ui_pixels_neon; isa++) {
+        if (ui_raster.use(isa)) {
+            fp64_t ms[2] = {0};
+            for (int32_t k = 0; k < posix_countof(ms); k++) {
+                ui_parallel.limit(k == 0 ? 1 : 0);
+                fp64_t time = posix_clock.seconds();
+                for (int32_t f = 0; f < frames; f++) { ui_raster.render(&r); }
+                ms[k] = (posix_clock.seconds() - time) * 1000.0 / frames;
+            }
+            ui_parallel.limit(0);
+            posix_println("raster %-8s %8.3f %10.3f", ui_pixels.name(isa),
+                          ms[0], ms[1]);
+        }
+    }
+    posix_swear(ui_raster.use(saved));
+    ui_raster.dispose(&r);
+    posix_heap.free(pixels);
+    ui_layout.root = null;
+    ui_nodes.changed(ui_layout.nodes);
+    posix_heap.free(t.views);
+}
+
+static struct ui_view* test4_rows;
+static int32_t test4_created;
+
+static struct ui_view* test4_row(struct ui_vlist* vl, struct ui_view* r,
+        int64_t ix) {
+    if (r == null) {
+        posix_swear(test4_created < 1024);
+        r = &test4_rows[test4_created++];
+        r->type = ui_view_label;
+        r->fm = ui_layout.fm;
+        r->p.strid = -1; // not localized
+        r->padding = (struct ui_margins){ 0.375f, 0.25f, 0.375f, 0.25f };
+    }
+    // variable height rows: every 8th item is two lines tall
+    const char* format = vl->row_h == 0 && ix % 8 == 0 ?
+        "item %lld\ndetails" : "item %lld";
+    posix_str.format(r->p.text, posix_countof(r->p.text), format, ix);
+    return r;
+}
+
+static void test4_vlist_pass(struct ui_vlist* vl) {
+    struct ui_view* v = &vl->view;
+    ui_layout.measure(v);
+    v->x = 0;
+    v->y = 0;
+    v->w = 1920;
+    v->h = 1080;
+    ui_layout.layout(v);
+}
+
+static void test4_vlist(int64_t items, int32_t row_h, int32_t frames) {
+    // wheel scrolling (3 rows per notch mostly down) and random jumps
+    posix_fatal_if(posix_heap.alloc_zero((void**)&test4_rows,
+                   1024 * (int64_t)sizeof(test4_rows[0])) != 0);
+    test4_created = 0;
+    struct ui_vlist vl = {
+        .view = { .type = ui_view_vlist, .fm = ui_layout.fm },
+        .count = items, .row_h = row_h, .overscan = 2, .row = test4_row
+    };
+    ui_vlist.init(&vl);
+    ui_layout.root = &vl.view;
+    test4_vlist_pass(&vl);
+    uint32_t seed = 0x1;
+    const int32_t notch = 3 * ui_layout.fm->height;
+    int64_t bound = vl.w.bound;
+    fp64_t time = posix_clock.seconds();
+    for (int32_t i = 0; i < frames; i++) {
+        const uint32_t r = posix_num.random32(&seed) % 16;
+        if (r == 0) {
+            ui_vlist.scroll_to(&vl, (int64_t)(posix_num.random32(&seed) % items));
+        } else {
+            ui_vlist.scroll(&vl, r < 4 ? -notch : notch);
+        }
+        test4_vlist_pass(&vl);
+    }
+    time = (posix_clock.seconds() - time) / frames;
+    posix_println("vlist %lld items row_h %d: %d rows %d views "
+                  "%.3f us per frame %.3f rows bound per frame",
+                  items, row_h, vl.w.n, test4_created, time * 1000000.0,
+                  (fp64_t)(vl.w.bound - bound) / frames);
+    ui_layout.root = null;
+    ui_vlist.dispose(&vl);
+    posix_heap.free(test4_rows);
+    test4_rows = null;
+}
+
+static int64_t test4_hit(const struct ui_view* v, struct ui_point pt) {
+    return pt.x < v->x + v->w / 2 ? 1 : 0; // HTCLIENT on left half
+}
+
+static int64_t test4_hit_test(const struct ui_view* v, struct ui_point pt) {
+    // what ui_view.hit_test() does w/o ui_app
+    int64_t ht = v->hit_test != null ? v->hit_test(v, pt) : 0;
+    ui_view_for_each(v, c, {
+        if (ht != 0) { break; }
+        if (!c->state.hidden && pt.x >= c->x && pt.x < c->x + c->w &&
+             pt.y >= c->y && pt.y < c->y + c->h) {
+            ht = test4_hit_test(c, pt);
+        }
+    });
+    return ht;
+}
+
+static int32_t test4_hover(const struct ui_view* v, struct ui_point pt) {
+    // what ui_view.mouse_move() does w/o ui_app: visits all views
+    int32_t n = pt.x >= v->x && pt.x < v->x + v->w &&
+                pt.y >= v->y && pt.y < v->y + v->h;
+    ui_view_for_each(v, c, { n += test4_hover(c, pt); });
+    return n;
+}
+
+static void test4_hits(int32_t views, int32_t hits) {
+    // wide tree: list of spans of 100 labels each laid out
+    const int32_t per_span = 100;
+    const int32_t spans = (views + per_span - 1) / per_span;
+    struct test4_tree t = {0};
+    test4_init(&t, 1 + spans * (1 + per_span));
+    struct ui_view* root = test4_view(&t, ui_view_list, "root");
+    for (int32_t s = 0; s < spans; s++) {
+        struct ui_view* span = test4_view(&t, ui_view_span, "span");
+        for (int32_t i = 0; i < per_span; i++) {
+            struct ui_view* label = test4_view(&t, ui_view_label, "label");
+            label->hit_test = test4_hit;
+            test4_add(span, label);
+        }
+        test4_add(root, span);
+    }
+    ui_layout.root = root;
+    test4_pass(root);
+    struct ui_rtree rt = {0};
+    fp64_t time = posix_clock.seconds();
+    ui_rtree.update(&rt, root);
+    const fp64_t build = posix_clock.seconds() - time;
+    time = posix_clock.seconds();
+    ui_rtree.update(&rt, root); // same views: refit
+    const fp64_t refit = posix_clock.seconds() - time;
+    posix_println("hits: %d views build %.3f ms refit %.3f ms",
+                  t.n, build * 1000.0, refit * 1000.0);
+    // points are inside of the laid out content
+    const int32_t w = root->child->child->prev->x + root->child->child->prev->w;
+    const int32_t h = root->h;
+    uint32_t seed = 0x1;
+    int64_t sum = 0;
+    time = posix_clock.seconds();
+    for (int32_t i = 0; i < hits; i++) {
+        const struct ui_point pt = {
+            (int32_t)(posix_num.random32(&seed) % (uint32_t)w),
+            (int32_t)(posix_num.random32(&seed) % (uint32_t)h)
+        };
+        sum += ui_rtree.hit_test(&rt, root, pt);
+    }
+    const fp64_t indexed = (posix_clock.seconds() - time) / hits;
+    seed = 0x1;
+    int64_t check = 0;
+    time = posix_clock.seconds();
+    for (int32_t i = 0; i < hits; i++) {
+        const struct ui_point pt = {
+            (int32_t)(posix_num.random32(&seed) % (uint32_t)w),
+            (int32_t)(posix_num.random32(&seed) % (uint32_t)h)
+        };
+        check += test4_hit_test(root, pt);
+    }
+    const fp64_t recursive = (posix_clock.seconds() - time) / hits;
+    posix_swear(sum == check);
+    posix_println("hits: %d hit tests %.3f us indexed %.3f us recursive",
+                  hits, indexed * 1000000.0, recursive * 1000000.0);
+    // mouse_move() hover: query vs visiting every view
+    const struct ui_rtree_item* found[64];
+    const int32_t moves = hits / 100 > 0 ? hits / 100 : 1;
+    seed = 0x1;
+    sum = 0;
+    time = posix_clock.seconds();
+    for (int32_t i = 0; i < moves * 100; i++) {
+        const struct ui_point pt = {
+            (int32_t)(posix_num.random32(&seed) % (uint32_t)w),
+            (int32_t)(posix_num.random32(&seed) % (uint32_t)h)
+        };
+        sum += ui_rtree.query(&rt, pt, found, posix_countof(found));
+    }
+    const fp64_t query = (posix_clock.seconds() - time) / (moves * 100);
+    seed = 0x1;
+    check = 0;
+    time = posix_clock.seconds();
+    for (int32_t i = 0; i < moves; i++) {
+        const struct ui_point pt = {
+            (int32_t)(posix_num.random32(&seed) % (uint32_t)w),
+            (int32_t)(posix_num.random32(&seed) % (uint32_t)h)
+        };
+        check += test4_hover(root, pt);
+    }
+    const fp64_t walk = (posix_clock.seconds() - time) / moves;
+    posix_println("hits: hover %.3f us indexed %.3f us visiting all views",
+                  query * 1000000.0, walk * 1000000.0);
+    ui_rtree.dispose(&rt);
+    ui_layout.root = null;
+    posix_heap.free(t.views);
+}
+
+struct test4_canvas {
+    uint32_t* pixels; // 1920x1080
+    int64_t filled;   // pixels
+    int32_t painted;  // views
+};
+
+static void test4_fill(struct test4_canvas* c, const struct ui_region* rg,
+        const struct ui_view* v) {
+    // what GDI does with fill() clipped to update region
+    for (int32_t i = 0; i < rg->count; i++) {
+        const struct ui_rect* r = &rg->r[i];
+        const int32_t x0 = posix_max(posix_max(r->x, v->x), 0);
+        const int32_t y0 = posix_max(posix_max(r->y, v->y), 0);
+        const int32_t x1 = posix_min(posix_min(r->x + r->w, v->x + v->w), 1920);
+        const int32_t y1 = posix_min(posix_min(r->y + r->h, v->y + v->h), 1080);
+        for (int32_t y = y0; y < y1; y++) {
+            uint32_t* p = c->pixels + (size_t)y * 1920;
+            for (int32_t x = x0; x < x1; x++) { p[x] = (uint32_t)v->type; }
+        }
+        if (x0 < x1 && y0 < y1) { c->filled += (int64_t)(x1 - x0) * (y1 - y0); }
+    }
+}
+
+static void test4_paint(struct test4_canvas* c, const struct ui_region* rg,
+        struct ui_view* v) {
+    // what ui_view.paint() does w/o ui_app
+    if (!v->state.hidden) {
+        const struct ui_ltrb p = ui_layout.margins(v, &v->padding);
+        const struct ui_rect prc = { v->x - p.left, v->y - p.top,
+            v->w + p.left + p.right, v->h + p.top + p.bottom };
+        const bool dirty = ui_region.intersects(rg, &prc);
+        if (dirty) {
+            test4_fill(c, rg, v);
+            c->painted++;
+        }
+        const bool container = v->type == ui_view_span ||
+            v->type == ui_view_list || v->type == ui_view_stack;
+        if (dirty || !container) {
+            ui_view_for_each(v, it, { test4_paint(c, rg, it); });
+        }
+    }
+}
+
+static void test4_typing(int32_t lines, int32_t keys) {
+    // editor window: toolbar, `lines` of text and status bar
+    struct test4_tree t = {0};
+    test4_init(&t, 4 + 100 + lines + 20);
+    struct ui_view* root = test4_view(&t, ui_view_list, "root");
+    struct ui_view* tools = test4_view(&t, ui_view_span, "tools");
+    struct ui_view* edit = test4_view(&t, ui_view_list, "edit");
+    struct ui_view* status = test4_view(&t, ui_view_span, "status");
+    for (int32_t i = 0; i < 100; i++) {
+        test4_add(tools, test4_view(&t, ui_view_label, "tool"));
+    }
+    for (int32_t i = 0; i < lines; i++) {
+        struct ui_view* line = test4_view(&t, ui_view_label, "");
+        line->align = ui_align_left;
+        test4_add(edit, line);
+    }
+    for (int32_t i = 0; i < 20; i++) {
+        test4_add(status, test4_view(&t, ui_view_label, "status"));
+    }
+    test4_add(root, tools);
+    test4_add(root, edit);
+    test4_add(root, status);
+    ui_layout.root = root;
+    test4_pass(root);
+    struct test4_canvas c = {0};
+    posix_fatal_if(posix_heap.alloc((void**)&c.pixels,
+                   1920 * 1080 * (int64_t)sizeof(c.pixels[0])) != 0);
+    for (int32_t pass = 0; pass < 2; pass++) {
+        const bool full = pass == 0;
+        uint32_t seed = 0x1;
+        c.filled = 0;
+        c.painted = 0;
+        fp64_t time = posix_clock.seconds();
+        for (int32_t k = 0; k < keys; k++) {
+            // type a character at the end of a random line
+            const int32_t ln = (int32_t)(posix_num.random32(&seed) % (uint32_t)lines);
+            struct ui_view* line = &t.views[4 + 100 + ln];
+            char text[posix_countof(line->p.text)];
+            posix_str_printf(text, "%s%c", line->p.text,
+                             (char)('a' + k % 26));
+            if (strlen(text) > 80) { text[0] = 0; }
+            test4_set_text(line, text);
+            test4_pass(root);
+            struct ui_region rg = {0};
+            if (full) {
+                ui_region.add(&rg, &(struct ui_rect){ 0, 0, 1920, 1080 });
+            } else {
+                const struct ui_ltrb p = ui_layout.margins(line, &line->padding);
+                ui_region.add(&rg, &(struct ui_rect){ line->x - p.left,
+                    line->y - p.top, line->w + p.left + p.right,
+                    line->h + p.top + p.bottom });
+            }
+            test4_paint(&c, &rg, root);
+        }
+        time = (posix_clock.seconds() - time) / keys;
+        posix_println("typing %d lines %s: %8.3f us per key %6.1f views "
+                      "%9lld pixels painted per key", lines,
+                      full ? "full repaint " : "dirty region",
+                      time * 1000000.0, (fp64_t)c.painted / keys,
+                      c.filled / keys);
+    }
+    posix_heap.free(c.pixels);
+    ui_layout.root = null;
+    posix_heap.free(t.views);
+}
+
+static int run(void) {
+    if (posix_args.option_bool("--help") || posix_args.option_bool("-h")) {
+        return usage();
+    }
+    const char* v = posix_args.option_str("--verbosity");
+    if (v != null) {
+        posix_debug.verbosity.level = posix_debug.verbosity_from_string(v);
+    }
+    int64_t views  = 10 * 1000;
+    int64_t depth  = 1000;
+    int64_t passes = 1000;
+    int64_t items  = 1000 * 1000;
+    int64_t hits   = 1000 * 1000;
+    int64_t scale  = 1;
+    posix_args.option_int("--views", &views);
+    posix_args.option_int("--items", &items);
+    posix_args.option_int("--depth", &depth);
+    posix_args.option_int("--passes", &passes);
+    posix_args.option_int("--hits", &hits);
+    posix_args.option_int("--scale", &scale);
+    const int32_t s = (int32_t)posix_max((int64_t)1, scale);
+    const bool bench = posix_args.option_bool("--bench");
+    ui_layout.test();
+    ui_vlist.test();
+    ui_rtree.test();
+    ui_region.test();
+    ui_nodes.test();
+    ui_pixels.test();
+    ui_parallel.test();
+    ui_resample.test();
+    ui_mipmap.test();
+    ui_decode.test();
+    ui_gif.test();
+    ui_animation.test();
+    ui_mandelbrot.test();
+    ui_colormap.test();
+    ui_raster.test();
+    posix_println("all tests passed");
+    if (bench) {
+        test4_text_metrics = ui_layout.text_metrics;
+        ui_layout.text_metrics = test4_counting_text_metrics;
+        test4_wide((int32_t)views, (int32_t)passes);
+        test4_deep((int32_t)depth, (int32_t)passes);
+        test4_vlist(items, 24, (int32_t)passes * 10); // fixed row height
+        test4_vlist(items, 0,  (int32_t)passes * 10); // measured rows
+        test4_hits((int32_t)views, (int32_t)hits);
+        test4_typing(50, (int32_t)passes);
+        test4_timers((int32_t)views, (int32_t)passes / 10);
+        test4_timers((int32_t)views * 10, (int32_t)passes / 10);
+        test4_pixels(3840 / s, 2160 / s, 20);
+        test4_resample(7680 / s, 4320 / s, 2);
+        test4_mipmap(20000 / s, 20000 / s, 256LL * 1024 * 1024);
+        test4_decode(posix_args.option_str("--images"), 1000 / s);
+        test4_gif("samples/gotg.gif");
+        test4_gif("samples/groot.gif");
+        test4_mandelbrot(640 / s, 360 / s);
+        test4_mandelbrot_deep(640 / s, 360 / s);
+        test4_mandelbrot_cache(1024 / s, 1024 / s);
+        test4_colormap(1024 * 1024 / (s * s), 20);
+        test4_raster(1920 / s, 1080 / s, 20);
+        ui_layout.text_metrics = test4_text_metrics;
+    }
+    return 0;
+}
+
+int main(int argc, const char* argv[], const char *envp[]) {
+    posix_args.main(argc, argv, envp);
+    int r = run();
+    posix_args.fini();
+    return r;
+}